@@ -25,8 +25,9 @@
 
 /*attribute initiative to report */
 #define TAKE_THE_INITIATIVE_TO_REPORT
-/*oc request id*/
-#define CN_COMMADN_INDEX                    "commands/request_id="
+/*the oc topics routed to the demo, the others go to DemoMsgRcvCallBack*/
+#define CN_DEMO_TOPIC_PROPERTYGET "$oc/devices/" CONFIG_DEVICE_ID "/sys/properties/get/#"
+#define CN_DEMO_TOPIC_COMMAND     "$oc/devices/" CONFIG_DEVICE_ID "/sys/commands/#"
 
 int app_demo_iot(void);
 
@@ -1,38 +1,50 @@
 #include "app_demo.iot.h"
 #include "iot_car_control.h"
+#include "iot_shadow.h"
 
+/*the car status is reported when it changes, and all of it every 5min*/
+#define CN_SHADOW_MIN_INTERVAL_MS 0
+#define CN_SHADOW_RESYNC_MS 300000
 
-///< this is the callback function, set to the mqtt, and if any messages come, it will be called
+
+///< this is the callback function, set to the mqtt, and if any messages no route takes come, it will be called
 ///< The payload here is the json string
 void DemoMsgRcvCallBack(int qos, const char *topic, const char *payload)
 {
-    const char *requesID;
-    char *tmp;
-    IoTCmdResp_t resp;
     IOT_LOG_DEBUG("RCVMSG:QOS:%d TOPIC:%s PAYLOAD:%s\r\n",qos,topic, payload);
     /*app 下发的操作*/
     // 执行本次创新工程时间的车辆控制逻辑
     MQTT_car_ctrl(qos,topic, payload);
 
+    return;
+}
 
+/*属性查询由影子直接回复*/
+static void DemoPropertyGet(int qos, const char *topic, const char *requestID, const char *payload, void *arg)
+{
+    (void)IoTShadowHandleGet(requestID, payload);
+    return;
+}
 
-    // Response
-    tmp = strstr(topic,CN_COMMADN_INDEX);
-    if(tmp != NULL){
-        ///< now you could deal your own works here --THE COMMAND FROM THE PLATFORM
-
-            ///< now report the command execute result to the platform
-            requesID = tmp + strlen(CN_COMMADN_INDEX);
-            resp.requestID = requesID;
-            resp.respName = NULL;
-            resp.retCode = 0;   ////< which means 0 success and others failed
-            resp.paras = NULL;
-            // IOT_LOG_DEBUG("respose paras------------------------------ = %s\r\n", resp.paras);
-            printf("===========response=============\n");
-            (void)IoTProfileCmdResp(CONFIG_DEVICE_PWD,&resp);          
-    }   
-    
+///< the command from the platform, the route gives the request id of the topic
+static void DemoCommand(int qos, const char *topic, const char *requestID, const char *payload, void *arg)
+{
+    IoTCmdResp_t resp;
+
+    IOT_LOG_DEBUG("RCVCMD:QOS:%d TOPIC:%s PAYLOAD:%s\r\n", qos, topic, payload);
+    // 执行本次创新工程时间的车辆控制逻辑
+    MQTT_car_ctrl(qos, topic, payload);
 
+    // Response
+    if (requestID != NULL) {
+        ///< now report the command execute result to the platform
+        resp.requestID = requestID;
+        resp.respName = NULL;
+        resp.retCode = 0;   ////< which means 0 success and others failed
+        resp.paras = NULL;
+        printf("===========response=============\n");
+        (void)IoTProfileCmdResp(CONFIG_DEVICE_PWD, &resp);
+    }
     return;
 }
 
@@ -52,7 +64,8 @@ hi_void iot_publish_car_action(hi_u32 action_code)
       service.serviceID = "CAR_CTRL";//
       service.serviceProperty = &property;
   
-      IoTProfilePropertyReport(CONFIG_DEVICE_ID,&service);
+      (void)IoTShadowReport(&service);
+      (void)IoTProfileReportFlush(HI_TRUE);
 }
 
 
@@ -68,11 +81,17 @@ static hi_void *DemoEntry(hi_void *arg)
 
     extern void cJsonInit(void);
     cJsonInit();
+
+    (void)IoTCarSchedInit();
     
     printf("=========before IotMain=========\n");
     IoTMain();
+    (void)IoTProfileReportInit(CONFIG_DEVICE_ID, 0, CN_PROFILE_REPORT_SIZECAP);
+    (void)IoTShadowInit(CN_SHADOW_MIN_INTERVAL_MS, CN_SHADOW_RESYNC_MS);
     
     /*云端下发*/
+    (void)IoTSetMsgRoute(CN_DEMO_TOPIC_PROPERTYGET, DemoPropertyGet, NULL);
+    (void)IoTSetMsgRoute(CN_DEMO_TOPIC_COMMAND, DemoCommand, NULL);
     IoTSetMsgCallback(DemoMsgRcvCallBack);
 /*主动上报*/
 #ifdef TAKE_THE_INITIATIVE_TO_REPORT
@@ -83,6 +102,9 @@ static hi_void *DemoEntry(hi_void *arg)
        // ///< here you could add your own works here--we report the data to the IoTplatform
        /*用户可以在这调用发布函数进行发布，需要用户自己写调用函数*/
        iot_publish_car_action(1000);//发布例程      这里报错IotSendMsg Wrie queue failed！！！！！
+       /*the changes hold back by the min interval go out when they are due*/
+       (void)IoTShadowPoll();
+       (void)IoTProfileReportFlush(HI_TRUE);
        hi_sleep(1000);
        //printf("========in iot_publish_car_action=========\n");
     }
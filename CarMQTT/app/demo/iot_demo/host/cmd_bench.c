@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, cost of decoding a car command against the strstr cascade it replaced
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-30
+ */
+
+/**
+ * The car commands from the platform go to their handler by IoTCmdDecode() and IoTCmdDispatch(),
+ * one pass over the payload and one hash. Before that MQTT_car_ctrl() looked for every command name
+ * in the payload with strstr() one after the other, and for the DURATION with one more; that cascade
+ * is kept here as it was, so both ways run on the same payloads.
+ *
+ * The payloads are the commands of the car with and without a DURATION, with the fields in both
+ * orders. The old way writes into the payload, so both ways copy it first. Both ways must find the
+ * same command and DURATION, the exit code is not 0 if they do not.
+ *
+ * One "name key=value ..." line per way.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <hi_types_base.h>
+#include <hi_time.h>
+#include "iot_cmd.h"
+
+#define CN_CMD_BENCH_MSGS 1000000
+#define CN_CMD_BENCH_PAYLOADSIZE 160
+#define CN_CMD_BENCH_MASK 15  ///< the mask and seed of the table in iot_car_control.c
+#define CN_CMD_BENCH_SEED 359
+#define CN_CMD_BENCH_NONE 0xff
+
+///< the command names of iot_car_control.h, in the order the old cascade tried them
+enum
+{
+    EN_CMD_BENCH_GO_FORWARD = 0,
+    EN_CMD_BENCH_GO_BACK,
+    EN_CMD_BENCH_TURN_LEFT,
+    EN_CMD_BENCH_TURN_RIGHT,
+    EN_CMD_BENCH_STOP,
+    EN_CMD_BENCH_SPEED_UP,
+    EN_CMD_BENCH_TRACE_ON,
+    EN_CMD_BENCH_STEER_ON,
+    EN_CMD_BENCH_CAR_AWAY,
+    EN_CMD_BENCH_TRACE_FORWARD,
+    EN_CMD_BENCH_TRAFFIC_LIGHT,
+    EN_CMD_BENCH_TRACE,
+    EN_CMD_BENCH_NUM,
+};
+
+static const char *gCmdBenchName[EN_CMD_BENCH_NUM] = {
+    "GO_FORWARD", "GO_BACK", "TURN_LEFT", "TURN_RIGHT", "STOP", "SPEED_UP", "TRACE_ON", "STEER_ON",
+    "CAR_AWAY", "TRACE_FORWARD", "TRAFFIC_LIGHT", "TRACE",
+};
+
+static const char *gCmdBenchPayload[] = {
+    "{\"service_id\":\"CAR_CTRL\",\"command_name\":\"GO_FORWARD\",\"paras\":{\"DURATION\":1000}}",
+    "{\"service_id\":\"CAR_CTRL\",\"command_name\":\"GO_BACK\",\"paras\":{\"DURATION\":500}}",
+    "{\"service_id\":\"CAR_CTRL\",\"command_name\":\"TURN_LEFT\",\"paras\":{\"DURATION\":300}}",
+    "{\"paras\":{\"DURATION\":300},\"command_name\":\"TURN_RIGHT\",\"service_id\":\"CAR_CTRL\"}",
+    "{\"service_id\":\"CAR_CTRL\",\"command_name\":\"STOP\",\"paras\":{}}",
+    "{\"service_id\":\"CAR_CTRL\",\"command_name\":\"SPEED_UP\",\"paras\":{}}",
+    "{\"service_id\":\"CAR_CTRL\",\"command_name\":\"TRACE_ON\",\"paras\":{}}",
+    "{\"command_name\":\"STEER_ON\",\"service_id\":\"CAR_CTRL\",\"paras\":{}}",
+    "{\"service_id\":\"CAR_CTRL\",\"command_name\":\"CAR_AWAY\",\"paras\":{\"DURATION\":2000}}",
+    "{\"service_id\":\"CAR_CTRL\",\"command_name\":\"TRACE_FORWARD\",\"paras\":{\"DURATION\":800}}",
+    "{\"service_id\":\"CAR_CTRL\",\"command_name\":\"TRAFFIC_LIGHT\",\"paras\":{\"LIGHT\":\"RED_LIGHT_ON\"}}",
+    "{\"service_id\":\"CAR_CTRL\",\"command_name\":\"TRACE\",\"paras\":{}}",
+    "{\"service_id\":\"CAR_CTRL\",\"command_name\":\"GO_FORWARD\",\"paras\":{}}",
+    "{\"paras\":{\"DURATION\":150},\"service_id\":\"CAR_CTRL\",\"command_name\":\"GO_BACK\"}",
+};
+
+#define CN_CMD_BENCH_PAYLOADNUM (sizeof(gCmdBenchPayload) / sizeof(gCmdBenchPayload[0]))
+
+static struct
+{
+    hi_u32 msgs;
+    hi_u8 cmd;       ///< what the last message came to, by either way
+    hi_s32 duration;
+    hi_u8 expectCmd[CN_CMD_BENCH_PAYLOADNUM];
+    hi_s32 expectDuration[CN_CMD_BENCH_PAYLOADNUM];
+} gCmdBench;
+
+///< the handlers do what the car ones do with the paras, and leave the driving out
+#define CMD_BENCH_HANDLER(name, index) \
+    static int name(const IoTCmd_t *cmd) \
+    { \
+        gCmdBench.cmd = (index); \
+        gCmdBench.duration = IoTCmdGetParaInt(cmd, "DURATION", 0); \
+        return 0; \
+    }
+
+CMD_BENCH_HANDLER(CmdBenchGoForward, EN_CMD_BENCH_GO_FORWARD)
+CMD_BENCH_HANDLER(CmdBenchGoBack, EN_CMD_BENCH_GO_BACK)
+CMD_BENCH_HANDLER(CmdBenchTurnLeft, EN_CMD_BENCH_TURN_LEFT)
+CMD_BENCH_HANDLER(CmdBenchTurnRight, EN_CMD_BENCH_TURN_RIGHT)
+CMD_BENCH_HANDLER(CmdBenchStop, EN_CMD_BENCH_STOP)
+CMD_BENCH_HANDLER(CmdBenchSpeedUp, EN_CMD_BENCH_SPEED_UP)
+CMD_BENCH_HANDLER(CmdBenchTraceOn, EN_CMD_BENCH_TRACE_ON)
+CMD_BENCH_HANDLER(CmdBenchSteerOn, EN_CMD_BENCH_STEER_ON)
+CMD_BENCH_HANDLER(CmdBenchCarAway, EN_CMD_BENCH_CAR_AWAY)
+CMD_BENCH_HANDLER(CmdBenchTraceForward, EN_CMD_BENCH_TRACE_FORWARD)
+CMD_BENCH_HANDLER(CmdBenchTrace, EN_CMD_BENCH_TRACE)
+
+static int CmdBenchLight(const IoTCmd_t *cmd)
+{
+    gCmdBench.cmd = EN_CMD_BENCH_TRAFFIC_LIGHT;
+    gCmdBench.duration = (IoTCmdHasStrValue(cmd, "RED_LIGHT_ON") || IoTCmdHasStrValue(cmd, "YELLOW_LIGHT_ON")) ? 1 : 0;
+    return 0;
+}
+
+///< the slots of gCarCmdEntry in iot_car_control.c
+static const IoTCmdEntry_t gCmdBenchEntry[CN_CMD_BENCH_MASK + 1] = {
+    [0]  = {"STEER_ON",      CmdBenchSteerOn},
+    [1]  = {"SPEED_UP",      CmdBenchSpeedUp},
+    [3]  = {"TRACE",         CmdBenchTrace},
+    [4]  = {"TURN_LEFT",     CmdBenchTurnLeft},
+    [5]  = {"TRACE_FORWARD", CmdBenchTraceForward},
+    [7]  = {"TRAFFIC_LIGHT", CmdBenchLight},
+    [10] = {"GO_BACK",       CmdBenchGoBack},
+    [11] = {"STOP",          CmdBenchStop},
+    [12] = {"CAR_AWAY",      CmdBenchCarAway},
+    [13] = {"TRACE_ON",      CmdBenchTraceOn},
+    [14] = {"TURN_RIGHT",    CmdBenchTurnRight},
+    [15] = {"GO_FORWARD",    CmdBenchGoForward},
+};
+
+static const IoTCmdTable_t gCmdBenchTable = {
+    .entry = gCmdBenchEntry,
+    .mask = CN_CMD_BENCH_MASK,
+    .seed = CN_CMD_BENCH_SEED,
+};
+
+///< MQTT_car_ctrl() as it is now
+static hi_void CmdBenchDecode(char *payload)
+{
+    IoTCmd_t cmd;
+
+    if ((IoTCmdDecode(payload, &cmd) != 0) || (!IoTCmdSliceEq(&cmd.serviceID, "CAR_CTRL")))
+    {
+        return;
+    }
+    (void)IoTCmdDispatch(&gCmdBenchTable, &cmd);
+    return;
+}
+
+///< ValofJson() and itoa_key() of the old iot_car_control.c, the DURATION must be the last para
+static hi_s32 CmdBenchValofJson(char *jStr)
+{
+    char *tmp = NULL;
+    int i = 0;
+    int val = 0;
+
+    if ((tmp = strstr(jStr, "DURATION")) == NULL)
+    {
+        return 0;
+    }
+    while (*tmp++ != ':')
+    {
+    }
+    while (tmp[i++] != '}')
+    {
+    }
+    tmp[i - 1] = 0;
+    for (i = 0; tmp[i] != 0; i++)
+    {
+        val = val * 10 + (tmp[i] - '0');
+    }
+    return val;
+}
+
+///< the old MQTT_car_ctrl(), the names are tried in the order of the else if chain
+static hi_void CmdBenchStrstr(char *payload)
+{
+    hi_u8 i;
+
+    if (strstr(payload, "CAR_CTRL") == NULL)
+    {
+        return;
+    }
+    for (i = 0; i < EN_CMD_BENCH_NUM; i++)
+    {
+        if (strstr(payload, gCmdBenchName[i]) != NULL)
+        {
+            break;
+        }
+    }
+    switch (i)
+    {
+        case EN_CMD_BENCH_GO_FORWARD:
+        case EN_CMD_BENCH_GO_BACK:
+        case EN_CMD_BENCH_TURN_LEFT:
+        case EN_CMD_BENCH_TURN_RIGHT:
+        case EN_CMD_BENCH_CAR_AWAY:
+        case EN_CMD_BENCH_TRACE_FORWARD:
+            gCmdBench.cmd = i;
+            gCmdBench.duration = CmdBenchValofJson(payload);
+            break;
+        case EN_CMD_BENCH_TRAFFIC_LIGHT:
+            gCmdBench.cmd = i;
+            gCmdBench.duration = ((strstr(payload, "RED_LIGHT_ON") != NULL) ||
+                (strstr(payload, "YELLOW_LIGHT_ON") != NULL)) ? 1 : 0;
+            break;
+        case EN_CMD_BENCH_NUM:
+            break;
+        default:
+            gCmdBench.cmd = i;
+            gCmdBench.duration = 0;
+            break;
+    }
+    return;
+}
+
+///< the command and DURATION each way finds must be the expected ones
+static int CmdBenchCheck(const char *way, hi_void (*run)(char *payload))
+{
+    char buf[CN_CMD_BENCH_PAYLOADSIZE];
+    hi_u32 i;
+
+    for (i = 0; i < CN_CMD_BENCH_PAYLOADNUM; i++)
+    {
+        gCmdBench.cmd = CN_CMD_BENCH_NONE;
+        gCmdBench.duration = -1;
+        (void)strcpy(buf, gCmdBenchPayload[i]);
+        run(buf);
+        if ((gCmdBench.cmd != gCmdBench.expectCmd[i]) || (gCmdBench.duration != gCmdBench.expectDuration[i]))
+        {
+            (void)printf("cmd failed=mismatch way=%s payload=%u cmd=%u duration=%d\n", way, i, gCmdBench.cmd,
+                gCmdBench.duration);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static hi_u64 CmdBenchTime(hi_void (*run)(char *payload))
+{
+    char buf[CN_CMD_BENCH_PAYLOADNUM][CN_CMD_BENCH_PAYLOADSIZE];
+    hi_u64 startUs;
+    hi_u32 i;
+    hi_u32 n;
+
+    startUs = hi_get_us();
+    for (i = 0; i < gCmdBench.msgs; i++)
+    {
+        n = i % CN_CMD_BENCH_PAYLOADNUM;
+        (void)strcpy(buf[n], gCmdBenchPayload[n]);
+        run(buf[n]);
+    }
+    return hi_get_us() - startUs;
+}
+
+static hi_void CmdBenchExpect(hi_void)
+{
+    static const hi_s32 duration[CN_CMD_BENCH_PAYLOADNUM] = {1000, 500, 300, 300, 0, 0, 0, 0, 2000, 800, 1, 0, 0, 150};
+    static const hi_u8 cmd[CN_CMD_BENCH_PAYLOADNUM] = {
+        EN_CMD_BENCH_GO_FORWARD, EN_CMD_BENCH_GO_BACK, EN_CMD_BENCH_TURN_LEFT, EN_CMD_BENCH_TURN_RIGHT,
+        EN_CMD_BENCH_STOP, EN_CMD_BENCH_SPEED_UP, EN_CMD_BENCH_TRACE_ON, EN_CMD_BENCH_STEER_ON,
+        EN_CMD_BENCH_CAR_AWAY, EN_CMD_BENCH_TRACE_FORWARD, EN_CMD_BENCH_TRAFFIC_LIGHT, EN_CMD_BENCH_TRACE,
+        EN_CMD_BENCH_GO_FORWARD, EN_CMD_BENCH_GO_BACK,
+    };
+
+    (void)memcpy(gCmdBench.expectCmd, cmd, sizeof(cmd));
+    (void)memcpy(gCmdBench.expectDuration, duration, sizeof(duration));
+    return;
+}
+
+int main(int argc, char *argv[])
+{
+    hi_u64 decodeUs;
+    hi_u64 strstrUs;
+    int opt;
+
+    gCmdBench.msgs = CN_CMD_BENCH_MSGS;
+    while ((opt = getopt(argc, argv, "n:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                gCmdBench.msgs = (hi_u32)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                (void)fprintf(stderr, "usage: %s [-n messages]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (gCmdBench.msgs == 0)
+    {
+        gCmdBench.msgs = 1;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    CmdBenchExpect();
+    if ((IoTCmdTableCheck(&gCmdBenchTable) != 0) || (CmdBenchCheck("decode", CmdBenchDecode) != 0) ||
+        (CmdBenchCheck("strstr", CmdBenchStrstr) != 0))
+    {
+        return 1;
+    }
+
+    decodeUs = CmdBenchTime(CmdBenchDecode);
+    strstrUs = CmdBenchTime(CmdBenchStrstr);
+    (void)printf("cmd.decode payloads=%u ns_per_msg=%.1f\n", (hi_u32)CN_CMD_BENCH_PAYLOADNUM,
+        (double)decodeUs * 1000 / gCmdBench.msgs);
+    (void)printf("cmd.strstr payloads=%u ns_per_msg=%.1f\n", (hi_u32)CN_CMD_BENCH_PAYLOADNUM,
+        (double)strstrUs * 1000 / gCmdBench.msgs);
+    return 0;
+}
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, cost of the paho heap with and without the pools
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-16
+ */
+
+/**
+ * Paho's Heap.c is built twice, heap_bench with HEAP_POOLS and heap_bench_tree without, which
+ * records each item in the heap tree as the board build does.
+ *
+ * load=alloc allocates and frees the blocks one qos1 publish needs, the Messages, the
+ * Publications, the list element, the topic and payload copies, the packet and its ack, with
+ * the paho malloc and free alone.
+ *
+ * load=publish is a client of paho's protocol layer with a window of qos1 publishes inflight.
+ * For each one the puback and a qos0 command come back and are framed with MQTTPacket_Factory,
+ * the puback goes through MQTTProtocol_handlePubacks and the next message is published. The
+ * publishes go to a local socket pair, a thread reads them away.
+ *
+ * One "name key=value ..." line per load, sys_allocs is the system heap calls per message and
+ * rss_kb the peak of the process so far. The exit code is not 0 if a packet was lost or the
+ * heap was not back where it started.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <hi_types_base.h>
+#include <hi_time.h>
+#include "Heap.h"
+#include "MQTTClient.h" ///< MQTTVERSION_3_1_1
+#include "MQTTPacket.h"
+#include "MQTTProtocolClient.h"
+#include "Socket.h"
+#include "host.h"
+
+#if defined(HEAP_POOLS)
+#define CN_HEAP_BENCH_VARIANT "pools"
+#else
+#define CN_HEAP_BENCH_VARIANT "tree"
+#endif
+#define CN_HEAP_BENCH_ALLOCS 200000
+#define CN_HEAP_BENCH_MSGS 20000
+#define CN_HEAP_BENCH_DRAIN 4096
+#define CN_HEAP_BENCH_PACKETMAX 256
+#define CN_HEAP_BENCH_TOPIC "$oc/devices/5f0c2f1a_car/sys/properties/report"
+#define CN_HEAP_BENCH_PAYLOAD "{\"services\":[{\"service_id\":\"CarStatus\",\"properties\":{\"speed\":50}}]}"
+#define CN_HEAP_BENCH_COMMAND_TOPIC "$oc/devices/5f0c2f1a_car/sys/commands/request_id=1"
+#define CN_HEAP_BENCH_COMMAND "{\"service_id\":\"CarControl\",\"command_name\":\"Forward\",\"paras\":{\"speed\":50}}"
+
+int Socket_addSocket(int newSd); ///< Socket.c has it, Socket.h does not
+extern ClientStates* bstate; ///< the client states of MQTTClient.c
+
+static const hi_u32 gHeapBenchWindow[] = {16, 10000};
+
+static void *HeapBenchDrain(void *arg)
+{
+    char buf[CN_HEAP_BENCH_DRAIN];
+    int fd = *(int *)arg;
+
+    while (read(fd, buf, sizeof(buf)) > 0)
+    {
+    }
+    return NULL;
+}
+
+static long HeapBenchRssKb(hi_void)
+{
+    struct rusage usage;
+
+    (void)getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static hi_void HeapBenchPrintPools(const char *load)
+{
+#if defined(HEAP_POOLS)
+    heap_info *info = Heap_get_info();
+    int i;
+
+    for (i = 0; i <= HEAP_POOL_CLASSES; i++)
+    {
+        if (info->pools[i].allocs > 0)
+        {
+            (void)printf("heap.%s load=%s pool=%u chunks=%d max_in_use=%d allocs=%lu\n", CN_HEAP_BENCH_VARIANT, load,
+                (unsigned int)info->pools[i].size, info->pools[i].chunks, info->pools[i].max_in_use,
+                info->pools[i].allocs);
+        }
+    }
+#else
+    (void)load;
+#endif
+    return;
+}
+
+///< the blocks of one qos1 publish, freed in the order paho frees them
+static int HeapBenchAlloc(hi_void)
+{
+    static const size_t sizes[] = {sizeof(Messages), sizeof(Publications), sizeof(ListElement),
+        sizeof(CN_HEAP_BENCH_TOPIC), sizeof(CN_HEAP_BENCH_PAYLOAD), sizeof(Publish), sizeof(Ack)};
+    void *blocks[sizeof(sizes) / sizeof(sizes[0])];
+    HostAllocStat_t before;
+    HostAllocStat_t after;
+    size_t heapStart = Heap_get_info()->current_size;
+    hi_u64 startUs;
+    hi_u64 costUs;
+    hi_u32 n;
+    hi_u32 i;
+
+    HostAllocGetStat(&before);
+    startUs = hi_get_us();
+    for (n = 0; n < CN_HEAP_BENCH_ALLOCS; n++)
+    {
+        for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        {
+            blocks[i] = malloc(sizes[i]);
+            *(char *)blocks[i] = (char)n;
+        }
+        for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        {
+            free(blocks[i]);
+        }
+    }
+    costUs = hi_get_us() - startUs;
+    HostAllocGetStat(&after);
+
+    n = CN_HEAP_BENCH_ALLOCS * (hi_u32)(sizeof(sizes) / sizeof(sizes[0]));
+    (void)printf("heap.%s load=alloc blocks=%u ns_per_alloc_free=%.1f sys_allocs=%.2f\n", CN_HEAP_BENCH_VARIANT, n,
+        (double)costUs * 1000 / n, (double)(after.allocCnt - before.allocCnt) / n);
+    return (Heap_get_info()->current_size == heapStart) ? 0 : -1;
+}
+
+static hi_void HeapBenchPutString(char **ptr, const char *str)
+{
+    size_t len = strlen(str);
+
+    *(*ptr)++ = (char)(len >> 8);
+    *(*ptr)++ = (char)(len & 0xff);
+    (void)memcpy(*ptr, str, len);
+    *ptr += len;
+    return;
+}
+
+///< the puback of a message and a qos0 command after it, as the broker sends them
+static int HeapBenchEncodeReply(char *buf, int msgid)
+{
+    char body[CN_HEAP_BENCH_PACKETMAX];
+    char *ptr = body;
+    int len;
+
+    buf[0] = (char)(PUBACK << 4);
+    buf[1] = 2;
+    buf[2] = (char)(msgid >> 8);
+    buf[3] = (char)(msgid & 0xff);
+    HeapBenchPutString(&ptr, CN_HEAP_BENCH_COMMAND_TOPIC);
+    (void)memcpy(ptr, CN_HEAP_BENCH_COMMAND, strlen(CN_HEAP_BENCH_COMMAND));
+    ptr += strlen(CN_HEAP_BENCH_COMMAND);
+    buf[4] = (char)(PUBLISH << 4);
+    len = 5 + MQTTPacket_encode(&buf[5], (size_t)(ptr - body));
+    (void)memcpy(&buf[len], body, (size_t)(ptr - body));
+    return len + (int)(ptr - body);
+}
+
+static int HeapBenchPublish(Clients *client)
+{
+    Publish publish;
+    Messages *m = NULL;
+
+    (void)memset(&publish, 0, sizeof(publish));
+    publish.header.bits.type = PUBLISH;
+    publish.header.bits.qos = 1;
+    publish.msgId = MQTTProtocol_assignMsgId(client);
+    publish.MQTTVersion = MQTTVERSION_3_1_1;
+    publish.topic = MQTTStrdup(CN_HEAP_BENCH_TOPIC); ///< the message keeps the topic, the payload is copied
+    publish.topiclen = (int)strlen(CN_HEAP_BENCH_TOPIC);
+    publish.payload = MQTTStrdup(CN_HEAP_BENCH_PAYLOAD);
+    publish.payloadlen = (int)strlen(CN_HEAP_BENCH_PAYLOAD);
+    if ((publish.msgId == 0) || (TCPSOCKET_COMPLETE != MQTTProtocol_startPublish(client, &publish, 1, 0, &m)))
+    {
+        publish.msgId = -1;
+    }
+    free(publish.payload);
+    return publish.msgId;
+}
+
+///< frames the puback of the oldest message and a command after it
+static int HeapBenchReply(Clients *client, int peer)
+{
+    char buf[CN_HEAP_BENCH_PACKETMAX];
+    Messages *m = (Messages *)client->outboundMsgs->first->content;
+    int len = HeapBenchEncodeReply(buf, m->msgid);
+    int got = 0;
+
+    if (len != write(peer, buf, (size_t)len))
+    {
+        return -1;
+    }
+    while (got < 2)
+    {
+        MQTTPacket *pack;
+        int rc;
+
+        pack = MQTTPacket_Factory(MQTTVERSION_3_1_1, &client->net, &rc);
+        if (pack == NULL)
+        {
+            if (rc == TCPSOCKET_INTERRUPTED || rc == TCPSOCKET_COMPLETE)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if (pack->header.bits.type == PUBACK)
+        {
+            (void)MQTTProtocol_handlePubacks(pack, client->net.socket);
+        }
+        else
+        {
+            MQTTPacket_freePublish((Publish *)pack); ///< the app has taken the command
+        }
+        got++;
+    }
+    return 0;
+}
+
+static int HeapBenchLoad(Clients *client, int peer, hi_u32 window)
+{
+    HostAllocStat_t before;
+    HostAllocStat_t after;
+    size_t heapStart;
+    hi_u64 startUs;
+    hi_u64 costUs;
+    hi_u32 n;
+    char load[32];
+
+    ///< one message first, for what paho allocates once and keeps
+    if ((HeapBenchPublish(client) <= 0) || (0 != HeapBenchReply(client, peer)))
+    {
+        return -1;
+    }
+    heapStart = Heap_get_info()->current_size;
+    for (n = 0; n < window; n++)
+    {
+        if (HeapBenchPublish(client) <= 0)
+        {
+            return -1;
+        }
+    }
+    HostAllocGetStat(&before);
+    startUs = hi_get_us();
+    for (n = 0; n < CN_HEAP_BENCH_MSGS; n++)
+    {
+        if ((0 != HeapBenchReply(client, peer)) || (HeapBenchPublish(client) <= 0))
+        {
+            break;
+        }
+    }
+    costUs = hi_get_us() - startUs;
+    HostAllocGetStat(&after);
+    (void)printf("heap.%s load=publish window=%u msgs=%u us_per_msg=%.2f sys_allocs=%.2f heap_max_kb=%lu "
+        "rss_kb=%ld lost=%u\n", CN_HEAP_BENCH_VARIANT, window, n, (double)costUs / CN_HEAP_BENCH_MSGS,
+        (double)(after.allocCnt - before.allocCnt) / CN_HEAP_BENCH_MSGS,
+        (unsigned long)(Heap_get_info()->max_size / 1024), HeapBenchRssKb(), CN_HEAP_BENCH_MSGS - n);
+    (void)snprintf(load, sizeof(load), "publish_%u", window);
+    HeapBenchPrintPools(load);
+
+    while (client->outboundMsgs->count > 0)
+    {
+        if (0 != HeapBenchReply(client, peer))
+        {
+            return -1;
+        }
+    }
+    return ((n == CN_HEAP_BENCH_MSGS) && (Heap_get_info()->current_size == heapStart)) ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    Clients client;
+    pthread_t drain;
+    int pair[2];
+    hi_u32 i;
+    int ret = 0;
+
+    (void)argc;
+    (void)argv;
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    Heap_initialize(); ///< as MQTTClient_create and MQTTAsync_create do
+    Socket_outInitialize();
+    bstate->clients = ListInitialize();
+    if ((0 != socketpair(AF_UNIX, SOCK_STREAM, 0, pair)) || (0 != Socket_addSocket(pair[0])))
+    {
+        (void)printf("heap.%s failed=socketpair\n", CN_HEAP_BENCH_VARIANT);
+        return 1;
+    }
+    ///< the publishes wait for the reader rather than going to the pending writes
+    (void)fcntl(pair[0], F_SETFL, fcntl(pair[0], F_GETFL) & ~O_NONBLOCK);
+    if (0 != pthread_create(&drain, NULL, HeapBenchDrain, &pair[1]))
+    {
+        return 1;
+    }
+
+    (void)memset(&client, 0, sizeof(client));
+    client.clientID = "bench";
+    client.MQTTVersion = MQTTVERSION_3_1_1;
+    client.connected = 1;
+    client.good = 1;
+    client.net.socket = pair[0];
+    client.outboundMsgs = ListInitialize();
+    client.inboundMsgs = ListInitialize();
+    client.messageQueue = ListInitialize();
+    ListAppend(bstate->clients, &client, sizeof(client));
+
+    ret |= HeapBenchAlloc();
+    HeapBenchPrintPools("alloc");
+    for (i = 0; i < sizeof(gHeapBenchWindow) / sizeof(gHeapBenchWindow[0]); i++)
+    {
+        ret |= HeapBenchLoad(&client, pair[1], gHeapBenchWindow[i]);
+    }
+
+    (void)shutdown(pair[0], SHUT_WR);
+    (void)pthread_join(drain, NULL);
+    (void)close(pair[1]); ///< first, the blocking socket would wait in the recv of Socket_close
+    Socket_close(pair[0]);
+    return (ret == 0) ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, what the shim records for the tests and the benchmark
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-10
+ */
+#ifndef HOST_H_
+#define HOST_H_
+
+#include <hi_types_base.h>
+
+typedef enum
+{
+    EN_HOST_HAL_IO_FUNC = 0,
+    EN_HOST_HAL_GPIO_DIR,
+    EN_HOST_HAL_GPIO_VAL,
+    EN_HOST_HAL_PWM_INIT,
+    EN_HOST_HAL_PWM_CLOCK,
+    EN_HOST_HAL_PWM_START,
+    EN_HOST_HAL_PWM_STOP,
+    EN_HOST_HAL_MAX,
+} en_host_hal_op_t;
+
+///< one io/gpio/pwm call, recorded instead of touching the pins
+typedef struct
+{
+    hi_u64 us;       ///< hi_get_us when it was called
+    hi_u8 op;        ///< en_host_hal_op_t
+    hi_u32 id;       ///< the io, gpio or pwm port
+    hi_u32 val;      ///< the function, direction, level or duty
+} HostHalRecord_t;
+
+typedef hi_void (*fnHostHalHook)(const HostHalRecord_t *rec);
+
+/**
+ * Called in the calling task after each record, NULL to remove
+*/
+hi_void HostHalSetHook(fnHostHalHook hook);
+
+/**
+ * Copy the last records, the oldest first
+ *
+ * @return the number copied
+*/
+hi_u32 HostHalGetRecords(HostHalRecord_t *buf, hi_u32 num);
+
+/**
+ * @return the number of calls recorded since the start or the last reset
+*/
+hi_u32 HostHalGetCount(hi_void);
+
+hi_void HostHalReset(hi_void);
+
+/**
+ * Move the clock of hi_get_us, hi_get_milli_seconds and hi_get_seconds forward, so the tests step
+ * over the intervals instead of sleeping. The timeouts of the waits still run on the real time.
+*/
+hi_void HostClockStep(hi_u32 ms);
+
+typedef struct
+{
+    hi_u64 allocCnt;  ///< malloc, calloc and the realloc of NULL
+    hi_u64 freeCnt;   ///< free and the realloc to 0, of not NULL
+    hi_u64 allocBytes;
+} HostAllocStat_t;
+
+/**
+ * Heap calls made by the linked objects, the libc internal ones are not seen
+*/
+hi_void HostAllocGetStat(HostAllocStat_t *stat);
+
+/**
+ * @return the writev calls made by the linked objects, paho writes every packet with one
+*/
+hi_u64 HostWritevGetCount(hi_void);
+
+#endif /* HOST_H_ */
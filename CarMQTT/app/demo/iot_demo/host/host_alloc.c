@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, counts the heap calls and the socket writes, linked with -Wl,--wrap=malloc,...
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-10
+ */
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <hi_types_base.h>
+#include "host.h"
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t num, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+ssize_t __real_writev(int fd, const struct iovec *iov, int iovcnt);
+
+static HostAllocStat_t gHostAlloc;
+static hi_u64 gHostWritevCnt;
+
+static hi_void HostAllocCount(hi_u64 *counter, hi_u64 val)
+{
+    (void)__atomic_fetch_add(counter, val, __ATOMIC_RELAXED);
+}
+
+void *__wrap_malloc(size_t size)
+{
+    HostAllocCount(&gHostAlloc.allocCnt, 1);
+    HostAllocCount(&gHostAlloc.allocBytes, size);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t num, size_t size)
+{
+    HostAllocCount(&gHostAlloc.allocCnt, 1);
+    HostAllocCount(&gHostAlloc.allocBytes, num * size);
+    return __real_calloc(num, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    if (ptr == NULL)
+    {
+        HostAllocCount(&gHostAlloc.allocCnt, 1);
+    }
+    else if (size == 0)
+    {
+        HostAllocCount(&gHostAlloc.freeCnt, 1);
+    }
+    HostAllocCount(&gHostAlloc.allocBytes, size);
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr)
+{
+    if (ptr != NULL)
+    {
+        HostAllocCount(&gHostAlloc.freeCnt, 1);
+    }
+    __real_free(ptr);
+}
+
+hi_void HostAllocGetStat(HostAllocStat_t *stat)
+{
+    stat->allocCnt = __atomic_load_n(&gHostAlloc.allocCnt, __ATOMIC_RELAXED);
+    stat->freeCnt = __atomic_load_n(&gHostAlloc.freeCnt, __ATOMIC_RELAXED);
+    stat->allocBytes = __atomic_load_n(&gHostAlloc.allocBytes, __ATOMIC_RELAXED);
+}
+
+///< the lwip_writev of paho on the board, one system call per packet or per corked batch
+ssize_t __wrap_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    HostAllocCount(&gHostWritevCnt, 1);
+    return __real_writev(fd, iov, iovcnt);
+}
+
+hi_u64 HostWritevGetCount(hi_void)
+{
+    return __atomic_load_n(&gHostWritevCnt, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, the board: recorded io/gpio/pwm, the car state and a ready wifi
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-10
+ */
+
+/**
+ * car_control.c is built as it is, so a command runs the same pin sequence as on the board;
+ * the hal calls under it only land in a ring of records, which the tests and the benchmark read.
+*/
+#include <pthread.h>
+#include <hi_types_base.h>
+#include <hi_errno.h>
+#include <hi_io.h>
+#include <hi_gpio.h>
+#include <hi_pwm.h>
+#include <hi_time.h>
+#include "host.h"
+
+#define CN_HOST_HAL_RECORDS 256
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    HostHalRecord_t record[CN_HOST_HAL_RECORDS];
+    hi_u32 count;
+    fnHostHalHook hook;
+} HostHalCb_t;
+static HostHalCb_t gHostHal = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+///< the car state of app_demo_robot_car.c, which is not built for the host
+hi_u8 g_car_control_mode = 0;
+hi_u8 g_car_speed_control = 0;
+hi_u8 g_car_status = 0;
+hi_u16 g_car_modular_control_module = 0;
+hi_u16 g_car_direction_control_module = 0;
+hi_u32 g_car_speed = 1000;
+
+///< the wifi state of iot_sta.c, the host network is always up
+hi_u8 wifi_status = 0;
+hi_u8 wifi_first_connecting = 0;
+hi_u8 wifi_second_connecting = 0;
+hi_u8 wifi_second_connected = 0;
+
+hi_void WifiStaReadyWait(hi_void)
+{
+    return;
+}
+
+static hi_void HostHalRecord(hi_u8 op, hi_u32 id, hi_u32 val)
+{
+    HostHalRecord_t rec;
+    fnHostHalHook hook;
+
+    rec.us = hi_get_us();
+    rec.op = op;
+    rec.id = id;
+    rec.val = val;
+    (void)pthread_mutex_lock(&gHostHal.lock);
+    gHostHal.record[gHostHal.count % CN_HOST_HAL_RECORDS] = rec;
+    gHostHal.count++;
+    hook = gHostHal.hook;
+    (void)pthread_mutex_unlock(&gHostHal.lock);
+    if (hook != NULL)
+    {
+        hook(&rec);
+    }
+}
+
+hi_void HostHalSetHook(fnHostHalHook hook)
+{
+    (void)pthread_mutex_lock(&gHostHal.lock);
+    gHostHal.hook = hook;
+    (void)pthread_mutex_unlock(&gHostHal.lock);
+}
+
+hi_u32 HostHalGetRecords(HostHalRecord_t *buf, hi_u32 num)
+{
+    hi_u32 i;
+    hi_u32 first;
+
+    (void)pthread_mutex_lock(&gHostHal.lock);
+    if (num > gHostHal.count)
+    {
+        num = gHostHal.count;
+    }
+    if (num > CN_HOST_HAL_RECORDS)
+    {
+        num = CN_HOST_HAL_RECORDS;
+    }
+    first = gHostHal.count - num;
+    for (i = 0; i < num; i++)
+    {
+        buf[i] = gHostHal.record[(first + i) % CN_HOST_HAL_RECORDS];
+    }
+    (void)pthread_mutex_unlock(&gHostHal.lock);
+    return num;
+}
+
+hi_u32 HostHalGetCount(hi_void)
+{
+    hi_u32 count;
+
+    (void)pthread_mutex_lock(&gHostHal.lock);
+    count = gHostHal.count;
+    (void)pthread_mutex_unlock(&gHostHal.lock);
+    return count;
+}
+
+hi_void HostHalReset(hi_void)
+{
+    (void)pthread_mutex_lock(&gHostHal.lock);
+    gHostHal.count = 0;
+    (void)pthread_mutex_unlock(&gHostHal.lock);
+}
+
+hi_u32 hi_io_set_func(hi_io_name id, hi_u8 val)
+{
+    HostHalRecord(EN_HOST_HAL_IO_FUNC, id, val);
+    return HI_ERR_SUCCESS;
+}
+
+hi_u32 hi_gpio_set_dir(hi_gpio_idx id, hi_gpio_dir dir)
+{
+    HostHalRecord(EN_HOST_HAL_GPIO_DIR, id, dir);
+    return HI_ERR_SUCCESS;
+}
+
+hi_u32 hi_gpio_set_ouput_val(hi_gpio_idx id, hi_gpio_value val)
+{
+    HostHalRecord(EN_HOST_HAL_GPIO_VAL, id, val);
+    return HI_ERR_SUCCESS;
+}
+
+hi_u32 hi_pwm_init(hi_pwm_port port)
+{
+    HostHalRecord(EN_HOST_HAL_PWM_INIT, port, 0);
+    return HI_ERR_SUCCESS;
+}
+
+hi_u32 hi_pwm_set_clock(hi_pwm_clk_source clk_type)
+{
+    HostHalRecord(EN_HOST_HAL_PWM_CLOCK, 0, clk_type);
+    return HI_ERR_SUCCESS;
+}
+
+hi_u32 hi_pwm_start(hi_pwm_port port, hi_u16 duty, hi_u16 freq)
+{
+    (void)freq;
+    HostHalRecord(EN_HOST_HAL_PWM_START, port, duty);
+    return HI_ERR_SUCCESS;
+}
+
+hi_u32 hi_pwm_stop(hi_pwm_port port)
+{
+    HostHalRecord(EN_HOST_HAL_PWM_STOP, port, 0);
+    return HI_ERR_SUCCESS;
+}
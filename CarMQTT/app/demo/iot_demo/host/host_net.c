@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, the mbedtls socket callbacks on the host sockets
+ * Author: HiSpark Product Team.
+ * Create: 2020-8-3
+ */
+
+/**
+ * net_sockets.c of the board is built on lwip, paho and the stand-in broker only need the send
+ * and the receive of the TLS records, on the fd the context points at. The entropy of the board
+ * trng is read from /dev/urandom.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <hi_types_base.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/entropy_poll.h>
+#include <mbedtls/net_sockets.h>
+
+static int HostNetError(hi_bool reading)
+{
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+    {
+        return reading ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+    if ((errno == EPIPE) || (errno == ECONNRESET))
+    {
+        return MBEDTLS_ERR_NET_CONN_RESET;
+    }
+    return reading ? MBEDTLS_ERR_NET_RECV_FAILED : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+int mbedtls_net_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    ssize_t ret = recv(*(int *)ctx, buf, len, 0);
+
+    return (ret < 0) ? HostNetError(HI_TRUE) : (int)ret;
+}
+
+int mbedtls_net_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    ssize_t ret = send(*(int *)ctx, buf, len, MSG_NOSIGNAL);
+
+    return (ret < 0) ? HostNetError(HI_FALSE) : (int)ret;
+}
+
+int mbedtls_hardware_poll(void *data, unsigned char *output, size_t len, size_t *olen)
+{
+    FILE *file = fopen("/dev/urandom", "rb");
+
+    (void)data;
+    *olen = 0;
+    if (file == NULL)
+    {
+        return MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
+    }
+    *olen = fread(output, 1, len, file);
+    (void)fclose(file);
+    return (*olen == len) ? 0 : MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
+}
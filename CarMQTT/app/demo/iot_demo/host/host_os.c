@@ -0,0 +1,561 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, the hi_* kernel services on pthreads
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-10
+ */
+
+/**
+ * Only what the iot demo uses is here. The ids are indexes into static tables like the LiteOS
+ * ones, so an id is never a pointer and a deleted object may be reused. The task priorities are
+ * ignored, every task is a plain thread; hi_task_lock is one recursive mutex, which is enough
+ * for the short critical sections it guards in the demo.
+*/
+#define _GNU_SOURCE ///< the recursive mutex initializer
+#include <pthread.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <hi_types_base.h>
+#include <hi_errno.h>
+#include <hi_task.h>
+#include <hi_msg.h>
+#include <hi_mux.h>
+#include <hi_sem.h>
+#include <hi_mem.h>
+#include <hi_time.h>
+#include <hi_cipher.h>
+#include <securec.h>
+
+#define CN_HOST_QUEUE_NUM 8
+#define CN_HOST_MUX_NUM 16
+#define CN_HOST_SEM_NUM 16
+#define CN_HOST_SEM_MAX 0xFFFF
+
+typedef struct
+{
+    hi_bool used;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    hi_u8 *buf;
+    hi_u16 len;
+    hi_u32 msgSize;
+    hi_u16 head;
+    hi_u16 num;
+} HostQueue_t;
+
+typedef struct
+{
+    hi_bool used;
+    pthread_mutex_t lock;
+} HostMux_t;
+
+typedef struct
+{
+    hi_bool used;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    hi_u32 count;
+    hi_u32 max;
+} HostSem_t;
+
+typedef struct
+{
+    hi_void *(*route)(hi_void *);
+    hi_void *arg;
+} HostTaskArg_t;
+
+static pthread_mutex_t gHostTableLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t gHostTaskLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static HostQueue_t gHostQueue[CN_HOST_QUEUE_NUM];
+static HostMux_t gHostMux[CN_HOST_MUX_NUM];
+static HostSem_t gHostSem[CN_HOST_SEM_NUM];
+static volatile hi_u64 gHostClockStepUs; ///< added to the time the app reads, not to the waits
+
+static hi_u64 HostNowUs(hi_void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (hi_u64)ts.tv_sec * 1000000 + (hi_u64)ts.tv_nsec / 1000;
+}
+
+static hi_void HostCondInit(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+
+    (void)pthread_condattr_init(&attr);
+    (void)pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    (void)pthread_cond_init(cond, &attr);
+    (void)pthread_condattr_destroy(&attr);
+}
+
+///< wait on the cond until the deadline, the lock is held by the caller; returns ETIMEDOUT at the end
+static int HostCondWait(pthread_cond_t *cond, pthread_mutex_t *lock, hi_u32 timeoutMs, const struct timespec *deadline)
+{
+    if (timeoutMs == HI_SYS_WAIT_FOREVER)
+    {
+        return pthread_cond_wait(cond, lock);
+    }
+    return pthread_cond_timedwait(cond, lock, deadline);
+}
+
+static hi_void HostDeadline(struct timespec *deadline, hi_u32 timeoutMs)
+{
+    (void)clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeoutMs / 1000;
+    deadline->tv_nsec += (long)(timeoutMs % 1000) * 1000000;
+    if (deadline->tv_nsec >= 1000000000)
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+static hi_void *HostTaskEntry(hi_void *arg)
+{
+    HostTaskArg_t task = *(HostTaskArg_t *)arg;
+
+    free(arg);
+    return task.route(task.arg);
+}
+
+hi_u32 hi_task_create(hi_u32 *taskid, const hi_task_attr *attr,
+                      hi_void* (*task_route)(hi_void *), hi_void *arg)
+{
+    pthread_t thread;
+    HostTaskArg_t *task;
+
+    (void)attr;
+    if ((taskid == NULL) || (task_route == NULL))
+    {
+        return HI_ERR_TASK_INVALID_PARAM;
+    }
+    task = malloc(sizeof(HostTaskArg_t));
+    if (task == NULL)
+    {
+        return HI_ERR_TASK_CREATE_FAIL;
+    }
+    task->route = task_route;
+    task->arg = arg;
+    if (0 != pthread_create(&thread, NULL, HostTaskEntry, task))
+    {
+        free(task);
+        return HI_ERR_TASK_CREATE_FAIL;
+    }
+    (void)pthread_detach(thread);
+    *taskid = (hi_u32)(uintptr_t)thread;
+    return HI_ERR_SUCCESS;
+}
+
+hi_u32 hi_task_get_current_id(hi_void)
+{
+    return (hi_u32)(uintptr_t)pthread_self();
+}
+
+hi_void hi_task_lock(hi_void)
+{
+    (void)pthread_mutex_lock(&gHostTaskLock);
+}
+
+hi_void hi_task_unlock(hi_void)
+{
+    (void)pthread_mutex_unlock(&gHostTaskLock);
+}
+
+hi_u32 hi_sleep(hi_u32 ms)
+{
+    struct timespec ts;
+
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000;
+    while ((0 != nanosleep(&ts, &ts)) && (errno == EINTR))
+    {
+    }
+    return HI_ERR_SUCCESS;
+}
+
+hi_u32 hi_msg_queue_create(HI_OUT hi_u32 *id, hi_u16 queue_len, hi_u32 msg_size)
+{
+    hi_u32 i;
+    HostQueue_t *q;
+
+    if ((id == NULL) || (queue_len == 0) || (msg_size == 0))
+    {
+        return HI_ERR_MSG_INVALID_PARAM;
+    }
+    (void)pthread_mutex_lock(&gHostTableLock);
+    for (i = 0; i < CN_HOST_QUEUE_NUM; i++)
+    {
+        if (!gHostQueue[i].used)
+        {
+            break;
+        }
+    }
+    if (i == CN_HOST_QUEUE_NUM)
+    {
+        (void)pthread_mutex_unlock(&gHostTableLock);
+        return HI_ERR_MSG_CREATE_Q_FAIL;
+    }
+    q = &gHostQueue[i];
+    q->buf = malloc((size_t)queue_len * msg_size);
+    if (q->buf == NULL)
+    {
+        (void)pthread_mutex_unlock(&gHostTableLock);
+        return HI_ERR_MSG_CREATE_Q_FAIL;
+    }
+    (void)pthread_mutex_init(&q->lock, NULL);
+    HostCondInit(&q->cond);
+    q->len = queue_len;
+    q->msgSize = msg_size;
+    q->head = 0;
+    q->num = 0;
+    q->used = HI_TRUE;
+    (void)pthread_mutex_unlock(&gHostTableLock);
+    *id = i;
+    return HI_ERR_SUCCESS;
+}
+
+hi_u32 hi_msg_queue_delete(hi_u32 id)
+{
+    HostQueue_t *q;
+
+    if ((id >= CN_HOST_QUEUE_NUM) || !gHostQueue[id].used)
+    {
+        return HI_ERR_MSG_INVALID_PARAM;
+    }
+    q = &gHostQueue[id];
+    (void)pthread_mutex_lock(&gHostTableLock);
+    q->used = HI_FALSE;
+    free(q->buf);
+    q->buf = NULL;
+    (void)pthread_cond_destroy(&q->cond);
+    (void)pthread_mutex_destroy(&q->lock);
+    (void)pthread_mutex_unlock(&gHostTableLock);
+    return HI_ERR_SUCCESS;
+}
+
+hi_u32 hi_msg_queue_send(hi_u32 id, hi_pvoid msg, hi_u32 timeout_ms, hi_u32 msg_size)
+{
+    HostQueue_t *q;
+    struct timespec deadline;
+    hi_u32 ret = HI_ERR_SUCCESS;
+
+    if ((id >= CN_HOST_QUEUE_NUM) || !gHostQueue[id].used || (msg == NULL) || (msg_size > gHostQueue[id].msgSize))
+    {
+        return HI_ERR_MSG_INVALID_PARAM;
+    }
+    q = &gHostQueue[id];
+    HostDeadline(&deadline, timeout_ms);
+    (void)pthread_mutex_lock(&q->lock);
+    while (q->num == q->len)
+    {
+        if ((timeout_ms == 0) || (ETIMEDOUT == HostCondWait(&q->cond, &q->lock, timeout_ms, &deadline)))
+        {
+            ret = HI_ERR_MSG_SEND_FAIL;
+            goto EXIT;
+        }
+    }
+    (void)memcpy(q->buf + (size_t)((q->head + q->num) % q->len) * q->msgSize, msg, msg_size);
+    q->num++;
+    (void)pthread_cond_broadcast(&q->cond);
+EXIT:
+    (void)pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+hi_u32 hi_msg_queue_wait(hi_u32 id, HI_OUT hi_pvoid msg, hi_u32 timeout_ms, hi_u32* msg_size)
+{
+    HostQueue_t *q;
+    struct timespec deadline;
+    hi_u32 ret = HI_ERR_SUCCESS;
+
+    if ((id >= CN_HOST_QUEUE_NUM) || !gHostQueue[id].used || (msg == NULL) || (msg_size == NULL))
+    {
+        return HI_ERR_MSG_INVALID_PARAM;
+    }
+    q = &gHostQueue[id];
+    HostDeadline(&deadline, timeout_ms);
+    (void)pthread_mutex_lock(&q->lock);
+    while (q->num == 0)
+    {
+        if ((timeout_ms == 0) || (ETIMEDOUT == HostCondWait(&q->cond, &q->lock, timeout_ms, &deadline)))
+        {
+            ret = HI_ERR_MSG_WAIT_TIME_OUT;
+            goto EXIT;
+        }
+    }
+    if (*msg_size > q->msgSize)
+    {
+        *msg_size = q->msgSize;
+    }
+    (void)memcpy(msg, q->buf + (size_t)q->head * q->msgSize, *msg_size);
+    q->head = (q->head + 1) % q->len;
+    q->num--;
+    (void)pthread_cond_broadcast(&q->cond);
+EXIT:
+    (void)pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+hi_u32 hi_mux_create(hi_u32 *mux_id)
+{
+    hi_u32 i;
+    pthread_mutexattr_t attr;
+
+    if (mux_id == NULL)
+    {
+        return HI_ERR_MUX_INVALID_PARAM;
+    }
+    (void)pthread_mutex_lock(&gHostTableLock);
+    for (i = 0; i < CN_HOST_MUX_NUM; i++)
+    {
+        if (!gHostMux[i].used)
+        {
+            break;
+        }
+    }
+    if (i == CN_HOST_MUX_NUM)
+    {
+        (void)pthread_mutex_unlock(&gHostTableLock);
+        return HI_ERR_MUX_CREATE_FAIL;
+    }
+    ///< the LiteOS mutex may be taken again by its owner
+    (void)pthread_mutexattr_init(&attr);
+    (void)pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    (void)pthread_mutex_init(&gHostMux[i].lock, &attr);
+    (void)pthread_mutexattr_destroy(&attr);
+    gHostMux[i].used = HI_TRUE;
+    (void)pthread_mutex_unlock(&gHostTableLock);
+    *mux_id = i;
+    return HI_ERR_SUCCESS;
+}
+
+hi_u32 hi_mux_delete(hi_u32 mux_id)
+{
+    if ((mux_id >= CN_HOST_MUX_NUM) || !gHostMux[mux_id].used)
+    {
+        return HI_ERR_MUX_INVALID_PARAM;
+    }
+    (void)pthread_mutex_lock(&gHostTableLock);
+    gHostMux[mux_id].used = HI_FALSE;
+    (void)pthread_mutex_destroy(&gHostMux[mux_id].lock);
+    (void)pthread_mutex_unlock(&gHostTableLock);
+    return HI_ERR_SUCCESS;
+}
+
+hi_u32 hi_mux_pend(hi_u32 mux_id, hi_u32 timeout_ms)
+{
+    struct timespec deadline;
+
+    if ((mux_id >= CN_HOST_MUX_NUM) || !gHostMux[mux_id].used)
+    {
+        return HI_ERR_MUX_INVALID_PARAM;
+    }
+    if (timeout_ms == HI_SYS_WAIT_FOREVER)
+    {
+        return (0 == pthread_mutex_lock(&gHostMux[mux_id].lock)) ? HI_ERR_SUCCESS : HI_ERR_MUX_PEND_FAIL;
+    }
+    if (timeout_ms == 0)
+    {
+        return (0 == pthread_mutex_trylock(&gHostMux[mux_id].lock)) ? HI_ERR_SUCCESS : HI_ERR_MUX_PEND_FAIL;
+    }
+    (void)clock_gettime(CLOCK_REALTIME, &deadline); ///< the mutex timeout only takes the realtime clock
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    return (0 == pthread_mutex_timedlock(&gHostMux[mux_id].lock, &deadline)) ? HI_ERR_SUCCESS : HI_ERR_MUX_PEND_FAIL;
+}
+
+hi_u32 hi_mux_post(hi_u32 mux_id)
+{
+    if ((mux_id >= CN_HOST_MUX_NUM) || !gHostMux[mux_id].used)
+    {
+        return HI_ERR_MUX_INVALID_PARAM;
+    }
+    return (0 == pthread_mutex_unlock(&gHostMux[mux_id].lock)) ? HI_ERR_SUCCESS : HI_ERR_MUX_POST_FAIL;
+}
+
+static hi_u32 HostSemCreate(hi_u32 *sem_id, hi_u32 init_value, hi_u32 max)
+{
+    hi_u32 i;
+
+    if ((sem_id == NULL) || (init_value > max))
+    {
+        return HI_ERR_SEM_INVALID_PARAM;
+    }
+    (void)pthread_mutex_lock(&gHostTableLock);
+    for (i = 0; i < CN_HOST_SEM_NUM; i++)
+    {
+        if (!gHostSem[i].used)
+        {
+            break;
+        }
+    }
+    if (i == CN_HOST_SEM_NUM)
+    {
+        (void)pthread_mutex_unlock(&gHostTableLock);
+        return HI_ERR_SEM_CREATE_FAIL;
+    }
+    (void)pthread_mutex_init(&gHostSem[i].lock, NULL);
+    HostCondInit(&gHostSem[i].cond);
+    gHostSem[i].count = init_value;
+    gHostSem[i].max = max;
+    gHostSem[i].used = HI_TRUE;
+    (void)pthread_mutex_unlock(&gHostTableLock);
+    *sem_id = i;
+    return HI_ERR_SUCCESS;
+}
+
+hi_u32 hi_sem_create(hi_u32 *sem_id, hi_u16 init_value)
+{
+    return HostSemCreate(sem_id, init_value, CN_HOST_SEM_MAX);
+}
+
+hi_u32 hi_sem_bcreate(hi_u32 *sem_id, hi_u8 init_value)
+{
+    return HostSemCreate(sem_id, init_value, 1);
+}
+
+hi_u32 hi_sem_delete(hi_u32 sem_id)
+{
+    if ((sem_id >= CN_HOST_SEM_NUM) || !gHostSem[sem_id].used)
+    {
+        return HI_ERR_SEM_INVALID_PARAM;
+    }
+    (void)pthread_mutex_lock(&gHostTableLock);
+    gHostSem[sem_id].used = HI_FALSE;
+    (void)pthread_cond_destroy(&gHostSem[sem_id].cond);
+    (void)pthread_mutex_destroy(&gHostSem[sem_id].lock);
+    (void)pthread_mutex_unlock(&gHostTableLock);
+    return HI_ERR_SUCCESS;
+}
+
+hi_u32 hi_sem_wait(hi_u32 sem_id, hi_u32 timeout_ms)
+{
+    HostSem_t *sem;
+    struct timespec deadline;
+    hi_u32 ret = HI_ERR_SUCCESS;
+
+    if ((sem_id >= CN_HOST_SEM_NUM) || !gHostSem[sem_id].used)
+    {
+        return HI_ERR_SEM_INVALID_PARAM;
+    }
+    sem = &gHostSem[sem_id];
+    HostDeadline(&deadline, timeout_ms);
+    (void)pthread_mutex_lock(&sem->lock);
+    while (sem->count == 0)
+    {
+        if ((timeout_ms == 0) || (ETIMEDOUT == HostCondWait(&sem->cond, &sem->lock, timeout_ms, &deadline)))
+        {
+            ret = HI_ERR_SEM_WAIT_TIME_OUT;
+            goto EXIT;
+        }
+    }
+    sem->count--;
+EXIT:
+    (void)pthread_mutex_unlock(&sem->lock);
+    return ret;
+}
+
+hi_u32 hi_sem_signal(hi_u32 sem_id)
+{
+    HostSem_t *sem;
+    hi_u32 ret = HI_ERR_SUCCESS;
+
+    if ((sem_id >= CN_HOST_SEM_NUM) || !gHostSem[sem_id].used)
+    {
+        return HI_ERR_SEM_INVALID_PARAM;
+    }
+    sem = &gHostSem[sem_id];
+    (void)pthread_mutex_lock(&sem->lock);
+    if (sem->count < sem->max)
+    {
+        sem->count++;
+        (void)pthread_cond_signal(&sem->cond);
+    }
+    else
+    {
+        ret = HI_ERR_SEM_SIG_FAIL;
+    }
+    (void)pthread_mutex_unlock(&sem->lock);
+    return ret;
+}
+
+hi_pvoid hi_malloc(hi_u32 mod_id, hi_u32 size)
+{
+    (void)mod_id;
+    return malloc(size);
+}
+
+hi_void hi_free(hi_u32 mod_id, const hi_pvoid addr)
+{
+    (void)mod_id;
+    free(addr);
+}
+
+hi_void HostClockStep(hi_u32 ms)
+{
+    gHostClockStepUs += (hi_u64)ms * 1000;
+}
+
+hi_u64 hi_get_us(hi_void)
+{
+    return HostNowUs() + gHostClockStepUs;
+}
+
+hi_u32 hi_get_milli_seconds(hi_void)
+{
+    return (hi_u32)(hi_get_us() / 1000);
+}
+
+hi_u32 hi_get_seconds(hi_void)
+{
+    return (hi_u32)(hi_get_us() / 1000000);
+}
+
+hi_u32 hi_cipher_trng_get_random(hi_u32 *randnum)
+{
+    static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    static unsigned int seed;
+
+    if (randnum == NULL)
+    {
+        return HI_ERR_FAILURE;
+    }
+    (void)pthread_mutex_lock(&lock);
+    if (seed == 0)
+    {
+        seed = (unsigned int)HostNowUs() ^ (unsigned int)getpid();
+    }
+    *randnum = ((hi_u32)rand_r(&seed) << 16) ^ (hi_u32)rand_r(&seed);
+    (void)pthread_mutex_unlock(&lock);
+    return HI_ERR_SUCCESS;
+}
+
+///< libsec is not built for the host, the demo only needs these two
+errno_t memcpy_s(void *dest, size_t destMax, const void *src, size_t count)
+{
+    if ((dest == NULL) || (src == NULL) || (count > destMax))
+    {
+        return EINVAL;
+    }
+    (void)memmove(dest, src, count);
+    return EOK;
+}
+
+errno_t memset_s(void *dest, size_t destMax, int c, size_t count)
+{
+    if ((dest == NULL) || (count > destMax))
+    {
+        return EINVAL;
+    }
+    (void)memset(dest, c, count);
+    return EOK;
+}
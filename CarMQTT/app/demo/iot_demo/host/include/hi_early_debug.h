@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, wraps the target hi_early_debug.h
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-10
+ */
+#ifndef HOST_HI_EARLY_DEBUG_H_
+#define HOST_HI_EARLY_DEBUG_H_
+
+///< the target dprintf has no fd and conflicts with the libc one, nothing here calls it
+#include <stdio.h>
+#define dprintf hi_early_dprintf
+#include_next <hi_early_debug.h>
+#undef dprintf
+
+#endif /* HOST_HI_EARLY_DEBUG_H_ */
@@ -0,0 +1,21 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, wraps the target hi_types_base.h for a 64 bits libc
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-10
+ */
+#ifndef HOST_HI_TYPES_BASE_H_
+#define HOST_HI_TYPES_BASE_H_
+
+///< the target header fixes intptr_t to 32 bits and NULL to 0, keep the libc ones instead
+#include <stdint.h>
+#include <stddef.h>
+#define intptr_t hi_target_intptr_t
+#define uintptr_t hi_target_uintptr_t
+#include_next <hi_types_base.h>
+#undef intptr_t
+#undef uintptr_t
+#undef NULL
+#define NULL ((void *)0)
+
+#endif /* HOST_HI_TYPES_BASE_H_ */
@@ -0,0 +1,15 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, the lwip resolver is the libc one
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-10
+ */
+#ifndef HOST_LWIP_NETDB_H_
+#define HOST_LWIP_NETDB_H_
+
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#endif /* HOST_LWIP_NETDB_H_ */
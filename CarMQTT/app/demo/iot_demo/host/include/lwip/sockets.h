@@ -0,0 +1,21 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, the lwip sockets are the libc ones
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-10
+ */
+#ifndef HOST_LWIP_SOCKETS_H_
+#define HOST_LWIP_SOCKETS_H_
+
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+#define lwip_writev writev
+#define lwip_ioctl ioctl
+#define closesocket close
+
+#endif /* HOST_LWIP_SOCKETS_H_ */
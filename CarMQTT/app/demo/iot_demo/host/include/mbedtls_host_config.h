@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, the board mbedtls config without the hardware hashes
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-10
+ */
+#ifndef MBEDTLS_HOST_CONFIG_H_
+#define MBEDTLS_HOST_CONFIG_H_
+
+#include <mbedtls/config.h>
+
+///< these are done by the hi_cipher engine on the board, take the mbedtls code on the host
+#undef MBEDTLS_MD5_ALT
+#undef MBEDTLS_SHA512_ALT
+#undef MBEDTLS_PLATFORM_TIME_ALT
+#undef MBEDTLS_AES_ALT
+#undef MBEDTLS_GCM_ALT
+#undef MBEDTLS_ECP_ALT
+
+///< the TLS end of the stand-in broker, with the mbedtls test certificate
+#define MBEDTLS_SSL_SRV_C
+#define MBEDTLS_CERTS_C
+///< SSLSocket.c reads the certificates from files out of LiteOS
+#define MBEDTLS_FS_IO
+
+#endif /* MBEDTLS_HOST_CONFIG_H_ */
@@ -0,0 +1,528 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, command latency and publish benchmark of the iot demo
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-10
+ */
+
+/**
+ * The whole demo runs as on the board: app_demo_iot starts the IoTMain, the car scheduler and
+ * the message callback, and IoTMain connects to the stand-in broker of this process.
+ *
+ * cmd: the broker publishes a CAR_CTRL GO_BACK command, the latency is taken from the publish
+ *      to the first recorded pin call, the round trip until the command response is back at
+ *      the broker. The commands go one after another, so the cpu and the heap calls of the
+ *      device side divided by the number are the per message cost.
+ * pub: IotSendMsgEx of property reports at qos 0 and 1 as fast as the window lets, the latency
+ *      is taken from the call to the completion callback.
+ * wire: the PUBLISH packets of the device in each of them, their bytes on air per message as
+ *      paho counted them and as the broker got them. With MQTT 5 the property reports go with a
+ *      topic alias, the command responses each have a topic of their own and go in full. The
+ *      writev are all the writes of paho per message, the acks too; corked, the packets a thread
+ *      sends together go in one.
+ * msg.store: before the demo starts, the messages of the IoTMain queue built and freed a queue
+ *      depth at a time, in the slab of IoTMsgSlabAlloc and with hi_malloc and hi_free as before
+ *      the slab, with the heap calls per message.
+ *
+ * The demo logs to the stdout, so that goes to /dev/null and the results to the saved stdout,
+ * one "name key=value ..." line each. The exit code is not 0 if a command or publish got lost.
+*/
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <hi_types_base.h>
+#include <hi_time.h>
+#include <hi_mem.h>
+#include "iot_config.h"
+#include "iot_main.h"
+#include "iot_car_sched.h"
+#include "iot_msg_slab.h"
+#include "host.h"
+#include "mqtt_standin.h"
+
+#ifndef HOST_MQTT_PORT
+#define HOST_MQTT_PORT 18830
+#endif
+#define CN_BENCH_CMD_NUM 1000
+#define CN_BENCH_PUB_NUM 2000
+#define CN_BENCH_READY_MS 10000
+#define CN_BENCH_WAIT_MS 2000
+#define CN_BENCH_PUB_WAIT_MS 10000 ///< after the last IotSendMsgEx, for the window to drain
+#define CN_BENCH_WARMUP_NUM 50
+#define CN_BENCH_STORE_NUM 1000000 ///< messages through the store of each way
+#define CN_BENCH_STORE_DEPTH 16 ///< the queue depth of iot_main.c
+#define CN_BENCH_STORE_SLOTSIZE 512 ///< the slot of iot_main.c
+#define CN_BENCH_STORE_HEADSIZE 56 ///< an IoTMsg_t on a 64 bit host
+#ifndef CONFIG_MQTT_ASYNC
+#define CN_BENCH_SYNC_QOS1_NUM 20 ///< MQTTClient keeps one qos1 in flight and yields 200ms for its puback
+#endif
+#define CN_BENCH_CMD_TOPIC "$oc/devices/" CONFIG_DEVICE_ID "/sys/commands/request_id="
+#define CN_BENCH_CMD_PAYLOAD \
+    "{\"paras\":{\"DURATION\":0},\"service_id\":\"CAR_CTRL\",\"command_name\":\"GO_BACK\"}"
+#define CN_BENCH_PUB_TOPIC "$oc/devices/" CONFIG_DEVICE_ID "/sys/properties/report"
+#define CN_BENCH_PUB_PAYLOAD \
+    "{\"services\":[{\"service_id\":\"CAR_CTRL\",\"properties\":{\"CAR_STATUS\":1000,\"SPEED\":12}}]}"
+#ifdef CONFIG_MQTT_V5
+#define CN_BENCH_MQTT_VERSION 5
+#else
+#define CN_BENCH_MQTT_VERSION 4
+#endif
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    hi_bool armed;        ///< waiting for the first pin call after armUs
+    hi_u64 armUs;
+    hi_u64 halUs;
+    hi_u32 pubDone;
+    hi_u32 pubFail;
+    hi_u64 *pubStartUs;
+    hi_u64 *pubDoneUs;
+    FILE *out;
+} BenchCb_t;
+static BenchCb_t gBench = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+typedef struct
+{
+    hi_u64 cpuUs;
+    hi_u64 brokerCpuUs;
+    hi_u64 benchCpuUs;
+    HostAllocStat_t alloc;
+    hi_u64 writev;
+    IoTPubStat_t pub;
+    MqttStandinStat_t broker;
+} BenchCost_t;
+
+static hi_u64 BenchClockUs(clockid_t cid)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(cid, &ts);
+    return (hi_u64)ts.tv_sec * 1000000 + (hi_u64)ts.tv_nsec / 1000;
+}
+
+static hi_void BenchCostGet(BenchCost_t *cost)
+{
+    MqttStandinStat_t stat;
+
+    MqttStandinGetStat(&stat);
+    cost->cpuUs = BenchClockUs(CLOCK_PROCESS_CPUTIME_ID);
+    cost->brokerCpuUs = stat.cpuUs;
+    cost->benchCpuUs = BenchClockUs(CLOCK_THREAD_CPUTIME_ID);
+    HostAllocGetStat(&cost->alloc);
+    cost->writev = HostWritevGetCount();
+    (void)IoTGetPubStat(&cost->pub);
+    cost->broker = stat;
+}
+
+///< the PUBLISH packets of the device since the start, as paho sent them and as the broker got them
+static hi_void BenchWirePrint(const char *name, const BenchCost_t *start)
+{
+    BenchCost_t end;
+    hi_u32 packets;
+    hi_u32 received;
+
+    BenchCostGet(&end);
+    packets = end.pub.packetCnt - start->pub.packetCnt;
+    received = end.broker.publishCnt - start->broker.publishCnt;
+    (void)fprintf(gBench.out, "%s mqtt=%d packets=%u aliased=%u bytes_per_msg=%.1f broker_bytes_per_msg=%.1f "
+        "writev_per_msg=%.2f\n",
+        name, CN_BENCH_MQTT_VERSION, packets, end.pub.aliasedCnt - start->pub.aliasedCnt,
+        (double)(end.pub.packetBytes - start->pub.packetBytes) / (packets ? packets : 1),
+        (double)(end.broker.publishWire - start->broker.publishWire) / (received ? received : 1),
+        (double)(end.writev - start->writev) / (packets ? packets : 1));
+}
+
+///< the cpu and heap calls of the device side, the broker thread and this one taken out
+static hi_void BenchCostPrint(const char *name, const BenchCost_t *start, hi_u32 num)
+{
+    BenchCost_t end;
+    hi_u64 cpuUs;
+
+    BenchCostGet(&end);
+    cpuUs = (end.cpuUs - start->cpuUs) - (end.brokerCpuUs - start->brokerCpuUs) -
+        (end.benchCpuUs - start->benchCpuUs);
+    (void)fprintf(gBench.out, "%s cpu_us_per_msg=%.2f allocs_per_msg=%.2f frees_per_msg=%.2f bytes_per_msg=%.1f\n",
+        name, (double)cpuUs / num, (double)(end.alloc.allocCnt - start->alloc.allocCnt) / num,
+        (double)(end.alloc.freeCnt - start->alloc.freeCnt) / num,
+        (double)(end.alloc.allocBytes - start->alloc.allocBytes) / num);
+}
+
+static int BenchCmpU64(const void *a, const void *b)
+{
+    hi_u64 x = *(const hi_u64 *)a;
+    hi_u64 y = *(const hi_u64 *)b;
+
+    return (x > y) - (x < y);
+}
+
+///< sorts the samples in place
+static hi_void BenchLatencyPrint(const char *name, hi_u64 *us, hi_u32 num)
+{
+    hi_u64 sum = 0;
+    hi_u32 i;
+
+    if (num == 0)
+    {
+        (void)fprintf(gBench.out, "%s n=0\n", name);
+        return;
+    }
+    qsort(us, num, sizeof(hi_u64), BenchCmpU64);
+    for (i = 0; i < num; i++)
+    {
+        sum += us[i];
+    }
+    (void)fprintf(gBench.out, "%s n=%u avg_us=%llu p50_us=%llu p90_us=%llu p99_us=%llu max_us=%llu\n",
+        name, num, (unsigned long long)(sum / num), (unsigned long long)us[num / 2],
+        (unsigned long long)us[num * 9 / 10], (unsigned long long)us[num * 99 / 100],
+        (unsigned long long)us[num - 1]);
+}
+
+///< a queue depth of messages built, then freed in the order the IoTMain task takes them
+static int BenchMsgStore(hi_bool slab)
+{
+    static hi_u64 mem[CN_BENCH_STORE_DEPTH][CN_BENCH_STORE_SLOTSIZE / sizeof(hi_u64)];
+    static hi_u16 freeList[CN_BENCH_STORE_DEPTH];
+    IoTMsgSlab_t store;
+    char *msg[CN_BENCH_STORE_DEPTH];
+    HostAllocStat_t start;
+    HostAllocStat_t end;
+    hi_u32 size = CN_BENCH_STORE_HEADSIZE + sizeof(CN_BENCH_PUB_TOPIC) + sizeof(CN_BENCH_PUB_PAYLOAD);
+    hi_u32 failed = 0;
+    hi_u32 done;
+    hi_u32 i;
+    hi_u64 startUs;
+    hi_u64 us;
+
+    if (0 != IoTMsgSlabInit(&store, mem, freeList, CN_BENCH_STORE_SLOTSIZE, CN_BENCH_STORE_DEPTH))
+    {
+        return -1;
+    }
+    HostAllocGetStat(&start);
+    startUs = hi_get_us();
+    for (done = 0; done < CN_BENCH_STORE_NUM; done += CN_BENCH_STORE_DEPTH)
+    {
+        for (i = 0; i < CN_BENCH_STORE_DEPTH; i++)
+        {
+            msg[i] = slab ? IoTMsgSlabAlloc(&store, size) : hi_malloc(0, size);
+            if (msg[i] == NULL)
+            {
+                failed++;
+                continue;
+            }
+            (void)memcpy(msg[i] + CN_BENCH_STORE_HEADSIZE, CN_BENCH_PUB_TOPIC, sizeof(CN_BENCH_PUB_TOPIC));
+            (void)memcpy(msg[i] + CN_BENCH_STORE_HEADSIZE + sizeof(CN_BENCH_PUB_TOPIC), CN_BENCH_PUB_PAYLOAD,
+                sizeof(CN_BENCH_PUB_PAYLOAD));
+        }
+        for (i = 0; i < CN_BENCH_STORE_DEPTH; i++)
+        {
+            if (slab)
+            {
+                IoTMsgSlabFree(&store, msg[i]);
+            }
+            else if (msg[i] != NULL)
+            {
+                hi_free(0, msg[i]);
+            }
+        }
+    }
+    us = hi_get_us() - startUs;
+    HostAllocGetStat(&end);
+    (void)fprintf(gBench.out, "msg.store way=%s bytes=%u n=%u ns_per_msg=%.1f allocs_per_msg=%.2f%s\n",
+        slab ? "slab" : "malloc", size, done, (double)us * 1000 / done,
+        (double)(end.allocCnt - start.allocCnt) / done, (failed == 0) ? "" : " failed=no_memory");
+    return (failed == 0) ? 0 : -1;
+}
+
+static hi_void BenchHalHook(const HostHalRecord_t *rec)
+{
+    (void)pthread_mutex_lock(&gBench.lock);
+    if (gBench.armed && (rec->us >= gBench.armUs))
+    {
+        gBench.armed = HI_FALSE;
+        gBench.halUs = rec->us;
+        (void)pthread_cond_broadcast(&gBench.cond);
+    }
+    (void)pthread_mutex_unlock(&gBench.lock);
+}
+
+static hi_void BenchDeadline(struct timespec *deadline, hi_u32 timeoutMs)
+{
+    (void)clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += timeoutMs / 1000;
+    deadline->tv_nsec += (long)(timeoutMs % 1000) * 1000000;
+    if (deadline->tv_nsec >= 1000000000)
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+///< inject one command, returns the publish to pin call latency or 0 if no pin moved in time
+static hi_u64 BenchCmdOnce(hi_u32 requestID, hi_u32 timeoutMs)
+{
+    char topic[sizeof(CN_BENCH_CMD_TOPIC) + 12];
+    struct timespec deadline;
+    hi_u64 latency = 0;
+
+    (void)snprintf(topic, sizeof(topic), CN_BENCH_CMD_TOPIC "%u", requestID);
+    BenchDeadline(&deadline, timeoutMs);
+    (void)pthread_mutex_lock(&gBench.lock);
+    gBench.armed = HI_TRUE;
+    gBench.armUs = hi_get_us();
+    (void)pthread_mutex_unlock(&gBench.lock);
+    if (0 != MqttStandinPublish(topic, CN_BENCH_CMD_PAYLOAD, 0))
+    {
+        gBench.armed = HI_FALSE;
+        return 0;
+    }
+    (void)pthread_mutex_lock(&gBench.lock);
+    while (gBench.armed)
+    {
+        if (0 != pthread_cond_timedwait(&gBench.cond, &gBench.lock, &deadline))
+        {
+            break;
+        }
+    }
+    if (!gBench.armed)
+    {
+        latency = gBench.halUs - gBench.armUs;
+    }
+    gBench.armed = HI_FALSE;
+    (void)pthread_mutex_unlock(&gBench.lock);
+    return latency;
+}
+
+static int BenchCmd(hi_u32 num)
+{
+    hi_u64 *latency = calloc(num, sizeof(hi_u64));
+    hi_u64 *rtt = calloc(num, sizeof(hi_u64));
+    hi_u32 i;
+    hi_u32 ok = 0;
+    hi_u32 lost = 0;
+    hi_u64 startUs;
+    hi_u64 us;
+    MqttStandinStat_t stat;
+    IoTCarSchedStat_t sched;
+    BenchCost_t cost;
+
+    if ((latency == NULL) || (rtt == NULL))
+    {
+        free(latency);
+        free(rtt);
+        return -1;
+    }
+    ///< the message callback is set after the subscribe, go on once a command moves the car
+    for (i = 0; i < CN_BENCH_WARMUP_NUM; i++)
+    {
+        MqttStandinGetStat(&stat);
+        if ((BenchCmdOnce(i, 100) > 0) && (0 == MqttStandinWaitPublish(stat.publishCnt + 1, CN_BENCH_WAIT_MS)))
+        {
+            break;
+        }
+    }
+
+    BenchCostGet(&cost);
+    for (i = 0; i < num; i++)
+    {
+        MqttStandinGetStat(&stat);
+        startUs = hi_get_us();
+        us = BenchCmdOnce(CN_BENCH_WARMUP_NUM + i, CN_BENCH_WAIT_MS);
+        ///< the command response is the publish that follows
+        if ((us == 0) || (0 != MqttStandinWaitPublish(stat.publishCnt + 1, CN_BENCH_WAIT_MS)))
+        {
+            lost++;
+            continue;
+        }
+        latency[ok] = us;
+        rtt[ok] = hi_get_us() - startUs;
+        ok++;
+    }
+    BenchCostPrint("cmd.cost", &cost, num);
+    BenchWirePrint("cmd.wire", &cost);
+    BenchLatencyPrint("cmd.latency", latency, ok);
+    BenchLatencyPrint("cmd.rtt", rtt, ok);
+    IoTCarSchedGetStat(&sched);
+    (void)fprintf(gBench.out, "cmd.sched submit=%u preempt=%u max_latency_us=%u lost=%u\n",
+        sched.submitCnt, sched.preemptCnt, sched.maxLatencyUs, lost);
+    free(latency);
+    free(rtt);
+    return (lost == 0) ? 0 : -1;
+}
+
+static hi_void BenchPubDone(void *arg, int result)
+{
+    hi_u32 i = (hi_u32)(uintptr_t)arg;
+    hi_u64 us = hi_get_us();
+
+    (void)pthread_mutex_lock(&gBench.lock);
+    if (gBench.pubDoneUs == NULL)
+    {
+        (void)pthread_mutex_unlock(&gBench.lock); ///< a late one of a run given up
+        return;
+    }
+    gBench.pubDoneUs[i] = us;
+    gBench.pubDone++;
+    if (result != 0)
+    {
+        gBench.pubFail++;
+    }
+    (void)pthread_cond_broadcast(&gBench.cond);
+    (void)pthread_mutex_unlock(&gBench.lock);
+}
+
+static int BenchPub(int qos, hi_u32 num)
+{
+    char name[32];
+    hi_u32 i;
+    hi_u32 sent = 0;
+    hi_u32 done;
+    hi_u64 startUs;
+    hi_u64 costUs;
+    struct timespec deadline;
+    IoTPubStat_t stat;
+    BenchCost_t cost;
+    int ret = 0;
+
+    gBench.pubStartUs = calloc(num, sizeof(hi_u64));
+    gBench.pubDoneUs = calloc(num, sizeof(hi_u64));
+    if ((gBench.pubStartUs == NULL) || (gBench.pubDoneUs == NULL))
+    {
+        ret = -1;
+        goto EXIT;
+    }
+    gBench.pubDone = 0;
+    gBench.pubFail = 0;
+
+    BenchCostGet(&cost);
+    startUs = hi_get_us();
+    for (i = 0; i < num; i++)
+    {
+        gBench.pubStartUs[i] = hi_get_us();
+        if (0 == IotSendMsgEx(qos, CN_BENCH_PUB_TOPIC, CN_BENCH_PUB_PAYLOAD, BenchPubDone, (void *)(uintptr_t)i))
+        {
+            sent++;
+        }
+    }
+    BenchDeadline(&deadline, CN_BENCH_PUB_WAIT_MS);
+    (void)pthread_mutex_lock(&gBench.lock);
+    while (gBench.pubDone < sent)
+    {
+        if (0 != pthread_cond_timedwait(&gBench.cond, &gBench.lock, &deadline))
+        {
+            break;
+        }
+    }
+    (void)pthread_mutex_unlock(&gBench.lock);
+    costUs = hi_get_us() - startUs;
+
+    (void)fprintf(gBench.out, "pub.qos%d.rate msgs_per_s=%.0f sent=%u done=%u fail=%u\n", qos,
+        (double)gBench.pubDone * 1000000 / (costUs ? costUs : 1), sent, gBench.pubDone, gBench.pubFail);
+    (void)snprintf(name, sizeof(name), "pub.qos%d.cost", qos);
+    BenchCostPrint(name, &cost, num);
+    (void)snprintf(name, sizeof(name), "pub.qos%d.wire", qos);
+    BenchWirePrint(name, &cost);
+    ///< the latency of the done ones, packed to the front
+    for (i = 0, done = 0; i < num; i++)
+    {
+        if (gBench.pubDoneUs[i] > 0)
+        {
+            gBench.pubDoneUs[done++] = gBench.pubDoneUs[i] - gBench.pubStartUs[i];
+        }
+    }
+    (void)snprintf(name, sizeof(name), "pub.qos%d.latency", qos);
+    BenchLatencyPrint(name, gBench.pubDoneUs, done);
+    (void)IoTGetPubStat(&stat);
+    (void)fprintf(gBench.out, "pub.stat window=%u high_water=%u ok=%u fail=%u retry=%u busy=%u\n",
+        stat.window, stat.highWater, stat.okCnt, stat.failCnt, stat.retryCnt, stat.busyCnt);
+    if ((sent != num) || (gBench.pubDone != sent) || (gBench.pubFail != 0))
+    {
+        ret = -1;
+    }
+EXIT:
+    (void)pthread_mutex_lock(&gBench.lock);
+    free(gBench.pubStartUs);
+    free(gBench.pubDoneUs);
+    gBench.pubStartUs = NULL;
+    gBench.pubDoneUs = NULL;
+    (void)pthread_mutex_unlock(&gBench.lock);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    extern int app_demo_iot(void);
+    hi_u32 cmdNum = CN_BENCH_CMD_NUM;
+    hi_u32 pubNum = CN_BENCH_PUB_NUM;
+    IoTConnStat_t conn;
+    MqttStandinStat_t broker;
+    int fd;
+    int opt;
+    int ret = 0;
+
+    while ((opt = getopt(argc, argv, "n:p:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                cmdNum = (hi_u32)strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                pubNum = (hi_u32)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                (void)fprintf(stderr, "usage: %s [-n commands] [-p publishes]\n", argv[0]);
+                return 2;
+        }
+    }
+    fd = dup(STDOUT_FILENO);
+    gBench.out = (fd < 0) ? stderr : fdopen(fd, "w");
+    if ((gBench.out == NULL) || (NULL == freopen("/dev/null", "w", stdout)))
+    {
+        return 1;
+    }
+    setvbuf(gBench.out, NULL, _IOLBF, 0);
+    ret |= BenchMsgStore(HI_FALSE);
+    ret |= BenchMsgStore(HI_TRUE);
+
+    if (0 != MqttStandinStart(HOST_MQTT_PORT))
+    {
+        (void)fprintf(stderr, "listen on %d failed\n", HOST_MQTT_PORT);
+        return 1;
+    }
+    HostHalSetHook(BenchHalHook);
+    (void)app_demo_iot();
+    if (0 != MqttStandinWaitReady(CN_BENCH_READY_MS))
+    {
+        (void)fprintf(stderr, "the device did not connect\n");
+        return 1;
+    }
+
+    ret |= BenchCmd(cmdNum);
+    if (pubNum > 0)
+    {
+        ret |= BenchPub(0, pubNum);
+#ifdef CN_BENCH_SYNC_QOS1_NUM
+        ret |= BenchPub(1, (pubNum < CN_BENCH_SYNC_QOS1_NUM) ? pubNum : CN_BENCH_SYNC_QOS1_NUM);
+#else
+        ret |= BenchPub(1, pubNum);
+#endif
+    }
+
+    (void)IoTGetConnStat(&conn);
+    MqttStandinGetStat(&broker);
+    (void)fprintf(gBench.out, "conn connect=%u fail=%u resume=%u last_connect_ms=%u\n",
+        conn.connectCnt, conn.failCnt, conn.resumeCnt, conn.lastConnectMs);
+    (void)fprintf(gBench.out, "broker publish=%u bytes=%u wire_bytes=%u aliased=%u inject=%u puback=%u drop=%u\n",
+        broker.publishCnt, broker.publishBytes, broker.publishWire, broker.aliasCnt, broker.injectCnt,
+        broker.pubackCnt, broker.dropCnt);
+    (void)fflush(gBench.out);
+    _exit((ret == 0) ? 0 : 1); ///< the demo tasks never end
+}
@@ -0,0 +1,682 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, checks of the command path and the profile payloads
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-10
+ */
+
+/**
+ * profile: the payloads of iot_profile_fmt.c must stay byte for byte what the cJSON tree of the
+ *          earlier iot_profile.c printed, which profile_ref.c rebuilds as the reference, the event
+ *          the same way and against the documented payload.
+ * cmd:     the decoder, the dispatch table and the car commands down to the recorded pins.
+ * router:  the topic filters with the wildcards, the '$' topics and the request id of the topic.
+ * slab:    the message slab of the IoTMain queue running out, taking the slots back and putting
+ *          the messages larger than a slot on the heap.
+ * shadow:  the reports through the shadow and the report builder on a stepped clock: the unchanged
+ *          values dropped, a change within the min interval held back until it passes, the resync,
+ *          the more services than one report takes and the answer to sys/properties/get.
+ * report:  the report builder taking a replaced property at the size of its new value, writing the
+ *          strings over in place, refusing what no report takes and flushing after the window.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <cJSON.h>
+#include <hi_types_base.h>
+#include <hi_pwm.h>
+#include <hi_time.h>
+#include "iot_config.h"
+#include "iot_cmd.h"
+#include "iot_car_control.h"
+#include "iot_car_sched.h"
+#include "iot_profile.h"
+#include "iot_profile_fmt.h"
+#include "iot_router.h"
+#include "iot_msg_slab.h"
+#include "iot_shadow.h"
+#include "host.h"
+#include "profile_ref.h"
+
+#define CN_TEST_BUF_SIZE 1024
+#define CN_TEST_WAIT_MS 1000
+
+static int gTestFails;
+static int gTestChecks;
+
+#define TEST_CHECK(cond, ...) \
+    do \
+    { \
+        gTestChecks++; \
+        if (!(cond)) \
+        { \
+            gTestFails++; \
+            (void)printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            (void)printf(__VA_ARGS__); \
+            (void)printf("\n"); \
+        } \
+    } while (0)
+
+static hi_void TestProfile(hi_void)
+{
+    static const double dv[] = {0.1, -0.0, 1e15, 123456789012345.0, 3.14159265358979, 1e-7, -2.5, 1e300, NAN, 1.0 / 3};
+    static const char *strs[] = {"plain", "quo\"te\\back", "ctl\x01\n\t\r\b\f", "utf8 \xe4\xbd\xa0"};
+    float fv = 0.3f;
+    long lv = -1234567;
+    IoTProfileKV_t kv[5];
+    IoTProfileService_t service[2];
+    IoTCmdResp_t resp;
+    IoTProfileEvent_t event;
+    char buf[CN_TEST_BUF_SIZE];
+    char *ref;
+    int len;
+    hi_u32 i;
+    hi_u32 j;
+
+    for (i = 0; i < sizeof(dv) / sizeof(dv[0]); i++)
+    {
+        for (j = 0; j < sizeof(strs) / sizeof(strs[0]); j++)
+        {
+            (void)memset(kv, 0, sizeof(kv));
+            (void)memset(service, 0, sizeof(service));
+            kv[0] = (IoTProfileKV_t){&kv[1], "a", (const char *)&dv[i], 0, EN_IOT_DATATYPE_DOUBLE};
+            kv[1] = (IoTProfileKV_t){&kv[2], strs[j], strs[(j + 1) % 4], 0, EN_IOT_DATATYPE_STRING};
+            kv[2] = (IoTProfileKV_t){&kv[3], "i", NULL, 4000000000u - i, EN_IOT_DATATYPE_INT};
+            kv[3] = (IoTProfileKV_t){&kv[4], "f", (const char *)&fv, 0, EN_IOT_DATATYPE_FLOAT};
+            kv[4] = (IoTProfileKV_t){NULL, "l", (const char *)&lv, 0, EN_IOT_DATATYPE_LONG};
+            service[0].serviceID = "Svc";
+            service[0].serviceProperty = &kv[0];
+            service[0].nxt = (j & 1) ? &service[1] : NULL;
+            service[0].eventTime = (j & 2) ? "20200101T000000Z" : NULL;
+            service[1].serviceID = "Two";
+            service[1].serviceProperty = &kv[2];
+
+            len = IoTProfileFmtPropertyReport(buf, sizeof(buf), &service[0]);
+            ref = RefPropertyReport(&service[0]);
+            TEST_CHECK((len == (int)strlen(ref)) && (0 == strcmp(buf, ref)), "report %u/%u\n  %s\n  %s", i, j, buf, ref);
+            cJSON_free(ref);
+
+            resp.retCode = (int)i - 3;
+            resp.respName = (j & 1) ? "resp" : NULL;
+            resp.requestID = "req-1";
+            resp.paras = (j & 2) ? &kv[0] : NULL;
+            len = IoTProfileFmtCmdResp(buf, sizeof(buf), &resp);
+            ref = RefCmdResp(&resp);
+            TEST_CHECK((len == (int)strlen(ref)) && (0 == strcmp(buf, ref)), "cmdresp %u/%u\n  %s\n  %s", i, j, buf, ref);
+            cJSON_free(ref);
+
+            event.serviceID = strs[j];
+            event.eventType = strs[(j + 2) % 4];
+            event.eventTime = (j & 1) ? "20200101T000000Z" : NULL;
+            event.paras = (j & 2) ? &kv[0] : &kv[3];
+            len = IoTProfileFmtEvent(buf, sizeof(buf), (j & 1) ? "other" : NULL, &event);
+            ref = RefEvent((j & 1) ? "other" : NULL, &event);
+            TEST_CHECK((len == (int)strlen(ref)) && (0 == strcmp(buf, ref)), "event %u/%u\n  %s\n  %s", i, j, buf, ref);
+            cJSON_free(ref);
+        }
+    }
+
+    len = IoTProfileFmtTopic(buf, sizeof(buf), EN_PROFILE_TOPIC_CMDRESP, CONFIG_DEVICE_ID, "42");
+    TEST_CHECK(0 == strcmp(buf, "$oc/devices/" CONFIG_DEVICE_ID "/sys/commands/response/request_id=42"), "topic %s", buf);
+    len = IoTProfileFmtTopic(buf, sizeof(buf), EN_PROFILE_TOPIC_PROPERTYREPORT, "other", NULL);
+    TEST_CHECK(0 == strcmp(buf, "$oc/devices/other/sys/properties/report"), "topic %s", buf);
+    len = IoTProfileFmtTopic(buf, 8, EN_PROFILE_TOPIC_PROPERTYREPORT, "other", NULL);
+    TEST_CHECK(len == -1, "small topic buffer %d", len);
+    len = IoTProfileFmtPropertyReport(buf, 16, &service[0]);
+    TEST_CHECK(len == -1, "small report buffer %d", len);
+
+    ///< the event as the platform documents it, with -0 printed as 0
+    kv[0] = (IoTProfileKV_t){&kv[1], "dist", (const char *)&dv[1], 0, EN_IOT_DATATYPE_DOUBLE};
+    kv[1] = (IoTProfileKV_t){NULL, "state", "RED_LIGHT_ON", 0, EN_IOT_DATATYPE_STRING};
+    event.serviceID = "$ota";
+    event.eventType = "version_report";
+    event.eventTime = NULL;
+    event.paras = &kv[0];
+    len = IoTProfileFmtEvent(buf, sizeof(buf), NULL, &event);
+    TEST_CHECK((len == (int)strlen(buf)) && (0 == strcmp(buf, "{\"object_device_id\":\"" CONFIG_DEVICE_ID "\",\"services\":"
+        "[{\"service_id\":\"$ota\",\"event_type\":\"version_report\",\"paras\":{\"dist\":0,\"state\":\"RED_LIGHT_ON\"}}]}")),
+        "event %s", buf);
+    event.paras = NULL;
+    len = IoTProfileFmtEvent(buf, sizeof(buf), "other", &event);
+    TEST_CHECK(0 == strcmp(buf, "{\"object_device_id\":\"other\",\"services\":"
+        "[{\"service_id\":\"$ota\",\"event_type\":\"version_report\",\"paras\":{}}]}"), "event no paras %s", buf);
+    len = IoTProfileFmtEvent(buf, 32, NULL, &event);
+    TEST_CHECK(len == -1, "small event buffer %d", len);
+}
+
+///< the publishes, iot_test is linked with --wrap=IotSendMsg so they stop here instead of the IoTMain queue
+#define CN_TEST_PUBNUM 8
+static char gTestPubTopic[CN_TEST_PUBNUM][CN_PROFILE_TOPIC_SIZE];
+static char gTestPub[CN_TEST_PUBNUM][CN_PROFILE_MSG_SIZE];
+static hi_u32 gTestPubNum;
+
+int __wrap_IotSendMsg(int qos, const char *topic, const char *payload);
+int __wrap_IotSendMsg(int qos, const char *topic, const char *payload)
+{
+    if (gTestPubNum < CN_TEST_PUBNUM)
+    {
+        (void)snprintf(gTestPubTopic[gTestPubNum], CN_PROFILE_TOPIC_SIZE, "%s", topic);
+        (void)snprintf(gTestPub[gTestPubNum], CN_PROFILE_MSG_SIZE, "%s", payload);
+    }
+    gTestPubNum++;
+    return 0;
+}
+
+#define CN_TEST_REPORT_WINDOW_MS 100
+#define CN_TEST_SHADOW_INTERVAL_MS 1000
+#define CN_TEST_SHADOW_RESYNC_MS 300000
+#define CN_TEST_COUNTER_INTERVAL_MS 10000
+#define CN_TEST_REFRESHES 70
+
+///< one refresh of the app: the properties to the shadow and the report out
+static hi_void TestShadowRefresh(IoTProfileService_t *service)
+{
+    (void)IoTShadowReport(service);
+    (void)IoTProfileReportFlush(HI_TRUE);
+}
+
+static hi_void TestShadow(hi_void)
+{
+    double speed = 50;
+    hi_u32 tc;
+    hi_u32 i;
+    IoTProfileKV_t kv[2];
+    IoTProfileKV_t many[5];
+    IoTProfileService_t service[5];
+    IoTShadowStat_t stat;
+    IoTShadowStat_t end;
+
+    TEST_CHECK(0 == IoTProfileReportInit(CONFIG_DEVICE_ID, CN_TEST_REPORT_WINDOW_MS, 0), "report init");
+    TEST_CHECK(0 == IoTShadowInit(CN_TEST_SHADOW_INTERVAL_MS, CN_TEST_SHADOW_RESYNC_MS), "shadow init");
+    (void)memset(kv, 0, sizeof(kv));
+    (void)memset(service, 0, sizeof(service));
+    kv[0] = (IoTProfileKV_t){&kv[1], "speed", (const char *)&speed, 0, EN_IOT_DATATYPE_DOUBLE};
+    kv[1] = (IoTProfileKV_t){NULL, "dir", "fwd", 0, EN_IOT_DATATYPE_STRING};
+    service[0].serviceID = "Car";
+    service[0].serviceProperty = &kv[0];
+
+    ///< the first values go out, the same ones again are dropped
+    gTestPubNum = 0;
+    TestShadowRefresh(&service[0]);
+    TEST_CHECK((gTestPubNum == 1) &&
+        (0 == strcmp(gTestPub[0], "{\"services\":[{\"service_id\":\"Car\",\"properties\":{\"dir\":\"fwd\",\"speed\":50}}]}")),
+        "first %u %s", gTestPubNum, gTestPub[0]);
+    TEST_CHECK(0 == strcmp(gTestPubTopic[0], "$oc/devices/" CONFIG_DEVICE_ID "/sys/properties/report"), "topic %s",
+        gTestPubTopic[0]);
+    (void)IoTShadowGetStat(&stat);
+    TestShadowRefresh(&service[0]);
+    (void)IoTShadowGetStat(&end);
+    TEST_CHECK((gTestPubNum == 1) && (end.unchangedCnt - stat.unchangedCnt == 2), "unchanged %u %u", gTestPubNum,
+        end.unchangedCnt - stat.unchangedCnt);
+
+    ///< a change within the min interval waits for it, then goes out alone
+    speed = 60;
+    TestShadowRefresh(&service[0]);
+    (void)IoTShadowPoll();
+    (void)IoTProfileReportFlush(HI_TRUE);
+    (void)IoTShadowGetStat(&stat);
+    TEST_CHECK((gTestPubNum == 1) && (stat.deferCnt - end.deferCnt == 1), "deferred %u %u", gTestPubNum,
+        stat.deferCnt - end.deferCnt);
+    HostClockStep(CN_TEST_SHADOW_INTERVAL_MS);
+    (void)IoTShadowPoll();
+    (void)IoTProfileReportFlush(HI_TRUE);
+    TEST_CHECK((gTestPubNum == 2) &&
+        (0 == strcmp(gTestPub[1], "{\"services\":[{\"service_id\":\"Car\",\"properties\":{\"speed\":60}}]}")),
+        "released %u %s", gTestPubNum, gTestPub[1]);
+
+    ///< the get is answered from the shadow, for the service asked or all of them
+    gTestPubNum = 0;
+    TEST_CHECK(0 == IoTShadowHandleGet("7", "{\"service_id\":\"Car\"}"), "get");
+    TEST_CHECK((gTestPubNum == 1) &&
+        (0 == strcmp(gTestPubTopic[0], "$oc/devices/" CONFIG_DEVICE_ID "/sys/properties/get/response/request_id=7")) &&
+        (0 == strcmp(gTestPub[0], "{\"services\":[{\"service_id\":\"Car\",\"properties\":{\"dir\":\"fwd\",\"speed\":60}}]}")),
+        "get %u %s %s", gTestPubNum, gTestPubTopic[0], gTestPub[0]);
+    TEST_CHECK(0 == IoTShadowHandleGet("8", "{\"service_id\":\"Other\"}"), "get other");
+    TEST_CHECK((gTestPubNum == 2) && (0 == strcmp(gTestPub[1], "{\"services\":[]}")), "get other %s", gTestPub[1]);
+    TEST_CHECK(0 == IoTShadowHandleGet("9", NULL), "get all");
+    TEST_CHECK((gTestPubNum == 3) && (0 == strcmp(gTestPub[2], gTestPub[0])), "get all %s", gTestPub[2]);
+
+    ///< the traffic light: its state does not change and its counter changes every refresh, the counter
+    ///< goes out every CN_TEST_COUNTER_INTERVAL_MS
+    (void)memset(kv, 0, sizeof(kv));
+    kv[0] = (IoTProfileKV_t){&kv[1], "mode", "auto", 0, EN_IOT_DATATYPE_STRING};
+    kv[1] = (IoTProfileKV_t){NULL, "tc", NULL, 0, EN_IOT_DATATYPE_INT};
+    service[0].serviceID = "Light";
+    TEST_CHECK(0 == IoTShadowSetMinInterval("Light", "tc", CN_TEST_COUNTER_INTERVAL_MS), "min interval");
+    gTestPubNum = 0;
+    for (tc = 0; tc < CN_TEST_REFRESHES; tc++)
+    {
+        kv[1].i_value = tc;
+        TestShadowRefresh(&service[0]);
+        HostClockStep(1000);
+    }
+    TEST_CHECK(gTestPubNum == CN_TEST_REFRESHES * 1000 / CN_TEST_COUNTER_INTERVAL_MS, "%u refreshes %u publishes",
+        CN_TEST_REFRESHES, gTestPubNum);
+
+    ///< more services than one list takes, with the counter held back since the last refresh: all of
+    ///< them go out, the ones past the first list in the next one
+    (void)memset(many, 0, sizeof(many));
+    for (i = 0; i < 5; i++)
+    {
+        many[i] = (IoTProfileKV_t){NULL, "v", NULL, i, EN_IOT_DATATYPE_INT};
+        service[i].serviceID = (char *)((const char *[]){"S0", "S1", "S2", "S3", "S4"})[i];
+        service[i].serviceProperty = &many[i];
+        service[i].nxt = (i < 4) ? &service[i + 1] : NULL;
+    }
+    (void)IoTShadowGetStat(&stat);
+    gTestPubNum = 0;
+    TestShadowRefresh(&service[0]);
+    (void)IoTShadowGetStat(&end);
+    TEST_CHECK((gTestPubNum == 2) && (NULL != strstr(gTestPub[1], "\"S4\"")) && (end.sentCnt - stat.sentCnt == 6),
+        "five services %u sent %u %s", gTestPubNum, end.sentCnt - stat.sentCnt, gTestPub[1]);
+
+    ///< the resync reports every property again, changed or not
+    gTestPubNum = 0;
+    HostClockStep(CN_TEST_SHADOW_RESYNC_MS);
+    (void)IoTShadowPoll();
+    (void)IoTProfileReportFlush(HI_TRUE);
+    (void)IoTShadowGetStat(&stat);
+    TEST_CHECK((stat.resyncCnt == 1) && (stat.sentCnt - end.sentCnt == 9) && (gTestPubNum >= 1) &&
+        (NULL != strstr(gTestPub[0], "\"speed\":60")), "resync %u sent %u %s", stat.resyncCnt,
+        stat.sentCnt - end.sentCnt, gTestPub[0]);
+}
+
+#define CN_TEST_REPORT_NUMS 10
+#define CN_TEST_REPORT_STRLEN 100
+
+///< the report builder: a replaced property takes the room of the new value, the strings written over
+///< in place, a property no report takes refused, and the flush window
+static hi_void TestReport(hi_void)
+{
+    static const char *keys[CN_TEST_REPORT_NUMS] = {"n0", "n1", "n2", "n3", "n4", "n5", "n6", "n7", "n8", "n9"};
+    char str[4][CN_TEST_REPORT_STRLEN + 1];
+    char big[CN_PROFILE_REPORT_SIZECAP];
+    IoTProfileKV_t kv;
+    IoTProfileService_t service;
+    IoTProfileReportStat_t stat;
+    IoTProfileReportStat_t end;
+    hi_u32 i;
+
+    (void)memset(&service, 0, sizeof(service));
+    service.serviceID = "R";
+    service.serviceProperty = &kv;
+    for (i = 0; i < 4; i++)
+    {
+        (void)memset(str[i], 'a' + (int)i, CN_TEST_REPORT_STRLEN);
+        str[i][CN_TEST_REPORT_STRLEN] = '\0';
+    }
+    (void)IoTProfileReportFlush(HI_TRUE);
+
+    ///< ten numbers and one of them a string fit, the second string does not
+    gTestPubNum = 0;
+    for (i = 0; i < CN_TEST_REPORT_NUMS; i++)
+    {
+        kv = (IoTProfileKV_t){NULL, keys[i], NULL, i, EN_IOT_DATATYPE_INT};
+        (void)IoTProfileReportAdd(&service);
+    }
+    kv = (IoTProfileKV_t){NULL, "n0", str[0], 0, EN_IOT_DATATYPE_STRING};
+    (void)IoTProfileReportAdd(&service);
+    TEST_CHECK(gTestPubNum == 0, "one string flushed %u", gTestPubNum);
+    kv = (IoTProfileKV_t){NULL, "n1", str[1], 0, EN_IOT_DATATYPE_STRING};
+    (void)IoTProfileReportAdd(&service);
+    TEST_CHECK(gTestPubNum == 1, "two strings not flushed %u", gTestPubNum);
+    (void)IoTProfileReportFlush(HI_TRUE);
+    TEST_CHECK((gTestPubNum == 2) && (strlen(gTestPub[0]) <= CN_PROFILE_REPORT_SIZECAP) &&
+        (NULL != strstr(gTestPub[0], str[0])) && (0 == strcmp(gTestPub[1], "{\"services\":[{\"service_id\":\"R\","
+        "\"properties\":{\"n1\":\"" "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb"
+        "\"}}]}")), "replaced %u %zu %s", gTestPubNum, strlen(gTestPub[0]), gTestPub[1]);
+
+    ///< a string replaced by as long ones is written over, the strings buffer does not fill up
+    (void)IoTProfileReportGetStat(&stat);
+    gTestPubNum = 0;
+    for (i = 0; i < 8; i++)
+    {
+        kv = (IoTProfileKV_t){NULL, "s", str[i % 4], 0, EN_IOT_DATATYPE_STRING};
+        (void)IoTProfileReportAdd(&service);
+    }
+    (void)IoTProfileReportFlush(HI_TRUE);
+    (void)IoTProfileReportGetStat(&end);
+    TEST_CHECK((gTestPubNum == 1) && (NULL != strstr(gTestPub[0], str[3])) && (end.publishCnt - stat.publishCnt == 1) &&
+        (end.publishSaved - stat.publishSaved == 7), "written over %u %s", gTestPubNum, gTestPub[0]);
+
+    ///< a property no report could take is refused, not dropped in the flush
+    (void)memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    kv = (IoTProfileKV_t){NULL, "big", big, 0, EN_IOT_DATATYPE_STRING};
+    TEST_CHECK(0 != IoTProfileReportAdd(&service), "too big added");
+    (void)IoTProfileReportFlush(HI_TRUE);
+    (void)IoTProfileReportGetStat(&stat);
+    TEST_CHECK((gTestPubNum == 1) && (stat.dropCnt - end.dropCnt == 1), "too big %u %u", gTestPubNum,
+        stat.dropCnt - end.dropCnt);
+
+    ///< the first property waits the window for the others, then goes out without a forced flush
+    kv = (IoTProfileKV_t){NULL, "w", NULL, 1, EN_IOT_DATATYPE_INT};
+    (void)IoTProfileReportAdd(&service);
+    (void)IoTProfileReportFlush(HI_FALSE);
+    TEST_CHECK(gTestPubNum == 1, "within the window %u", gTestPubNum);
+    HostClockStep(CN_TEST_REPORT_WINDOW_MS);
+    (void)IoTProfileReportFlush(HI_FALSE);
+    TEST_CHECK((gTestPubNum == 2) &&
+        (0 == strcmp(gTestPub[1], "{\"services\":[{\"service_id\":\"R\",\"properties\":{\"w\":1}}]}")),
+        "window passed %u %s", gTestPubNum, gTestPub[1]);
+}
+
+static int gTestHandled;
+static hi_s32 gTestDuration;
+
+static int TestHandler(const IoTCmd_t *cmd)
+{
+    gTestHandled++;
+    gTestDuration = IoTCmdGetParaInt(cmd, "DURATION", -7);
+    return 5;
+}
+
+static hi_void TestCmdDecode(hi_void)
+{
+    static const char *names[] = {"STEER_ON", "SPEED_UP", NULL, "TRACE", "TURN_LEFT", "TRACE_FORWARD", NULL,
+        "TRAFFIC_LIGHT", NULL, NULL, "GO_BACK", "STOP", "CAR_AWAY", "TRACE_ON", "TURN_RIGHT", "GO_FORWARD"};
+    IoTCmdEntry_t entry[16];
+    IoTCmdTable_t table = {entry, 15, 359};
+    IoTCmd_t cmd;
+    const IoTCmdPara_t *para;
+    hi_u32 i;
+    int ret;
+
+    for (i = 0; i < 16; i++)
+    {
+        entry[i].name = names[i];
+        entry[i].handler = TestHandler;
+    }
+    TEST_CHECK(0 == IoTCmdTableCheck(&table), "the car table of iot_car_control.c");
+
+    ///< the nested values, the quoted brace and the escaped quote must not confuse the decoder
+    ret = IoTCmdDecode(" {\"service_id\" : \"CAR_CTRL\",\"x\":[1,{\"a\":\"}\"}],\"command_name\":\"GO_FORWARD\","
+        "\"paras\":{\"DURATION\":1000,\"L\":\"RED\\\"X\"}}", &cmd);
+    TEST_CHECK(ret == 0, "decode %d", ret);
+    TEST_CHECK(IoTCmdSliceEq(&cmd.serviceID, "CAR_CTRL"), "service %.*s", cmd.serviceID.len, cmd.serviceID.str);
+    TEST_CHECK(IoTCmdSliceEq(&cmd.cmdName, "GO_FORWARD"), "command %.*s", cmd.cmdName.len, cmd.cmdName.str);
+    TEST_CHECK(cmd.paraNum == 2, "paras %u", cmd.paraNum);
+    para = IoTCmdGetPara(&cmd, "L");
+    TEST_CHECK((para != NULL) && para->isStr && (para->str.len == 6), "string para");
+    ret = IoTCmdDispatch(&table, &cmd);
+    TEST_CHECK((ret == 5) && (gTestHandled == 1) && (gTestDuration == 1000), "dispatch %d %d", ret, gTestDuration);
+
+    TEST_CHECK(0 != IoTCmdDecode("{\"a\":", &cmd), "truncated payload");
+    TEST_CHECK(0 != IoTCmdDecode("[1,2]", &cmd), "not an object");
+    ret = IoTCmdDecode("{\"command_name\":\"GO\"}", &cmd);
+    TEST_CHECK((ret == 0) && (IoTCmdDispatch(&table, &cmd) != 5), "unknown command");
+    ret = IoTCmdDecode("{\"command_name\":\"GO_BACK\"}", &cmd);
+    TEST_CHECK((ret == 0) && (IoTCmdDispatch(&table, &cmd) == 5) && (gTestDuration == -7), "default para");
+
+    ///< the numbers past hi_s32 are not paras, the ones at its bounds are
+    ret = IoTCmdDecode("{\"paras\":{\"a\":2147483647,\"b\":-2147483648,\"c\":2147483648,\"d\":-2147483649,"
+        "\"e\":99999999999999999999,\"f\":12.5e3}}", &cmd);
+    TEST_CHECK((ret == 0) && (cmd.paraNum == 3), "number paras %d %u", ret, cmd.paraNum);
+    TEST_CHECK((IoTCmdGetParaInt(&cmd, "a", 0) == 2147483647) && (IoTCmdGetParaInt(&cmd, "b", 0) == (-2147483647 - 1)),
+        "the bounds %d %d", IoTCmdGetParaInt(&cmd, "a", 0), IoTCmdGetParaInt(&cmd, "b", 0));
+    TEST_CHECK((IoTCmdGetParaInt(&cmd, "c", -7) == -7) && (IoTCmdGetParaInt(&cmd, "d", -7) == -7) &&
+        (IoTCmdGetParaInt(&cmd, "e", -7) == -7) && (IoTCmdGetParaInt(&cmd, "f", 0) == 12), "out of the range");
+
+    ///< a literal skipped in an array ends at any white space, not only at ' '
+    ret = IoTCmdDecode("{\"paras\":{\"x\":[true\n\"a]b\",null\t\"c}\"\r,false],\"DURATION\":5}}", &cmd);
+    TEST_CHECK((ret == 0) && (IoTCmdGetParaInt(&cmd, "DURATION", 0) == 5), "literals before white space %d", ret);
+}
+
+static hi_u32 gTestRouted;
+static char gTestRequestID[CN_IOT_ROUTE_REQIDSIZE];
+
+///< arg is the bit of the filter, so the checks see which of them matched
+static hi_void TestRoute(int qos, const char *topic, const char *requestID, const char *payload, hi_pvoid arg)
+{
+    gTestRouted |= (hi_u32)(hi_size_t)arg;
+    (void)snprintf(gTestRequestID, sizeof(gTestRequestID), "%s", (requestID == NULL) ? "-" : requestID);
+}
+
+static hi_u32 TestRouteTopic(const IoTRouter_t *router, const char *topic)
+{
+    gTestRouted = 0;
+    (void)IoTRouterDispatch(router, 1, topic, "{}");
+    return gTestRouted;
+}
+
+static hi_void TestRouter(hi_void)
+{
+    static const char *filters[] = {"$oc/devices/d1/sys/commands/#", "$oc/devices/+/sys/messages/down",
+        "$oc/devices/d1/sys/properties/get/#", "a/+/c", "a/#", "#", "+/b/c", "a/b/c"};
+    IoTRouteNode_t node[32];
+    hi_u16 edge[64];
+    IoTRouter_t router;
+    hi_u32 i;
+
+    TEST_CHECK(0 != IoTRouterInit(&router, node, 32, edge, 48), "edges not a power of 2");
+    TEST_CHECK(0 != IoTRouterInit(&router, node, 32, edge, 32), "edges not more than the nodes");
+    TEST_CHECK(0 == IoTRouterInit(&router, node, 32, edge, 64), "init");
+    for (i = 0; i < sizeof(filters) / sizeof(filters[0]); i++)
+    {
+        TEST_CHECK(0 == IoTRouterAdd(&router, filters[i], TestRoute, (hi_pvoid)(hi_size_t)(1u << i)), "add %s",
+            filters[i]);
+    }
+    TEST_CHECK(0 != IoTRouterAdd(&router, "a/b#", TestRoute, NULL), "# in a level");
+    TEST_CHECK(0 != IoTRouterAdd(&router, "a/#/c", TestRoute, NULL), "# not last");
+    TEST_CHECK(0 != IoTRouterAdd(&router, "a+/c", TestRoute, NULL), "+ in a level");
+    TEST_CHECK(router.filterNum == 8, "filters %u", router.filterNum);
+
+    TEST_CHECK(TestRouteTopic(&router, "$oc/devices/d1/sys/commands/request_id=42") == 0x01, "command");
+    TEST_CHECK(0 == strcmp(gTestRequestID, "42"), "request id %s", gTestRequestID);
+    TEST_CHECK(TestRouteTopic(&router, "$oc/devices/d1/sys/commands/request_id=7/x") == 0x01, "copied request id");
+    TEST_CHECK(0 == strcmp(gTestRequestID, "7"), "request id %s", gTestRequestID);
+    TEST_CHECK(TestRouteTopic(&router, "$oc/devices/d1/sys/properties/get/request_id=9") == 0x04, "properties get");
+    TEST_CHECK(TestRouteTopic(&router, "$oc/devices/d2/sys/messages/down") == 0x02, "+ device");
+    TEST_CHECK(0 == strcmp(gTestRequestID, "-"), "no request id %s", gTestRequestID);
+    TEST_CHECK(TestRouteTopic(&router, "$oc/devices/d2/sys/commands/request_id=1") == 0, "other device");
+    ///< every filter but the $oc ones, the root # does not take the $ topics
+    TEST_CHECK(TestRouteTopic(&router, "a/b/c") == 0xf8, "all the wildcards %x", gTestRouted);
+    TEST_CHECK(TestRouteTopic(&router, "a") == 0x30, "a/# matches a %x", gTestRouted);
+    TEST_CHECK(TestRouteTopic(&router, "a/b/c/d") == 0x30, "deeper %x", gTestRouted);
+    TEST_CHECK(TestRouteTopic(&router, "x/b/c") == 0x60, "+ first %x", gTestRouted);
+    TEST_CHECK(TestRouteTopic(&router, "a//c") == 0x38, "empty level %x", gTestRouted);
+
+    ///< the same filter again replaces the handler
+    TEST_CHECK(0 == IoTRouterAdd(&router, "a/b/c", TestRoute, (hi_pvoid)(hi_size_t)0x100), "replace");
+    TEST_CHECK((TestRouteTopic(&router, "a/b/c") == 0x178) && (router.filterNum == 8), "replaced %x", gTestRouted);
+
+    TEST_CHECK(0 == IoTRouterInit(&router, node, 4, edge, 64), "small init");
+    TEST_CHECK(0 != IoTRouterAdd(&router, "a/b/c/d", TestRoute, NULL), "out of nodes");
+    TEST_CHECK(TestRouteTopic(&router, "a/b/c") == 0, "the partial filter matches nothing");
+}
+
+#define CN_TEST_SLOTSIZE 64
+#define CN_TEST_SLOTNUM 4
+
+static hi_void TestMsgSlab(hi_void)
+{
+    static hi_u64 mem[CN_TEST_SLOTNUM][CN_TEST_SLOTSIZE / sizeof(hi_u64)];
+    hi_u16 freeList[CN_TEST_SLOTNUM];
+    IoTMsgSlab_t slab;
+    IoTMsgSlabStat_t stat;
+    HostAllocStat_t heap;
+    HostAllocStat_t heapEnd;
+    hi_pvoid slot[CN_TEST_SLOTNUM];
+    hi_pvoid big;
+    hi_u32 i;
+    hi_u32 j;
+
+    TEST_CHECK(0 != IoTMsgSlabInit(&slab, mem, freeList, 0, CN_TEST_SLOTNUM), "slot size 0");
+    TEST_CHECK(0 != IoTMsgSlabInit(&slab, mem, NULL, CN_TEST_SLOTSIZE, CN_TEST_SLOTNUM), "no free list");
+    TEST_CHECK(0 == IoTMsgSlabInit(&slab, mem, freeList, CN_TEST_SLOTSIZE, CN_TEST_SLOTNUM), "init");
+
+    for (i = 0; i < CN_TEST_SLOTNUM; i++)
+    {
+        slot[i] = IoTMsgSlabAlloc(&slab, CN_TEST_SLOTSIZE);
+        TEST_CHECK((slot[i] >= (hi_pvoid)mem) && (slot[i] < (hi_pvoid)(mem + CN_TEST_SLOTNUM)),
+            "slot %u", i);
+        for (j = 0; j < i; j++)
+        {
+            TEST_CHECK(slot[i] != slot[j], "slot %u given twice", j);
+        }
+    }
+    TEST_CHECK(NULL == IoTMsgSlabAlloc(&slab, 1), "alloc from the full slab");
+    IoTMsgSlabGetStat(&slab, &stat);
+    TEST_CHECK((stat.used == CN_TEST_SLOTNUM) && (stat.highWater == CN_TEST_SLOTNUM) &&
+        (stat.allocCnt == CN_TEST_SLOTNUM) && (stat.dropCnt == 1), "full %u %u %u %u", stat.used, stat.highWater,
+        stat.allocCnt, stat.dropCnt);
+
+    IoTMsgSlabFree(&slab, slot[2]);
+    TEST_CHECK(slot[2] == IoTMsgSlabAlloc(&slab, 1), "the freed slot again");
+    for (i = 0; i < CN_TEST_SLOTNUM; i++)
+    {
+        IoTMsgSlabFree(&slab, slot[i]);
+    }
+    IoTMsgSlabFree(&slab, NULL);
+    IoTMsgSlabGetStat(&slab, &stat);
+    TEST_CHECK((stat.used == 0) && (stat.highWater == CN_TEST_SLOTNUM), "empty %u %u", stat.used, stat.highWater);
+
+    HostAllocGetStat(&heap);
+    big = IoTMsgSlabAlloc(&slab, CN_TEST_SLOTSIZE + 1);
+    TEST_CHECK((big != NULL) && ((big < (hi_pvoid)mem) || (big >= (hi_pvoid)(mem + CN_TEST_SLOTNUM))),
+        "oversize on the heap");
+    if (big != NULL)
+    {
+        (void)memset(big, 0x5a, CN_TEST_SLOTSIZE + 1);
+    }
+    IoTMsgSlabFree(&slab, big);
+    HostAllocGetStat(&heapEnd);
+    TEST_CHECK((heapEnd.allocCnt - heap.allocCnt == 1) && (heapEnd.freeCnt - heap.freeCnt == 1),
+        "oversize heap calls %llu %llu", (unsigned long long)(heapEnd.allocCnt - heap.allocCnt),
+        (unsigned long long)(heapEnd.freeCnt - heap.freeCnt));
+    IoTMsgSlabGetStat(&slab, &stat);
+    TEST_CHECK((stat.used == 0) && (stat.oversizeCnt == 1) && (stat.dropCnt == 1), "oversize %u %u %u", stat.used,
+        stat.oversizeCnt, stat.dropCnt);
+}
+
+///< wait until so many pin calls are recorded, returns the pwm starts among them
+static hi_u32 TestPwmStarts(hi_u32 calls, HostHalRecord_t *pwm, hi_u32 num)
+{
+    HostHalRecord_t rec[64];
+    hi_u32 start = hi_get_milli_seconds();
+    hi_u32 got;
+    hi_u32 i;
+    hi_u32 n = 0;
+
+    while ((HostHalGetCount() < calls) && (hi_get_milli_seconds() - start < CN_TEST_WAIT_MS))
+    {
+        hi_sleep(1);
+    }
+    got = HostHalGetRecords(rec, sizeof(rec) / sizeof(rec[0]));
+    for (i = 0; (i < got) && (n < num); i++)
+    {
+        if (rec[i].op == EN_HOST_HAL_PWM_START)
+        {
+            pwm[n++] = rec[i];
+        }
+    }
+    return n;
+}
+
+static hi_u32 gTestPlanSlow;
+static hi_u32 gTestPlanLast;
+
+static hi_void TestPlanSlow(hi_void)
+{
+    gTestPlanSlow++;
+}
+
+static hi_void TestPlanLast(hi_void)
+{
+    gTestPlanLast++;
+}
+
+///< a burst of plans faster than the scheduler takes them, the last one must run
+static hi_void TestCarSchedBurst(hi_void)
+{
+    IoTCarPlan_t plan;
+    IoTCarSchedStat_t stat;
+    IoTCarSchedStat_t end;
+    hi_u32 start;
+    hi_u32 failed = 0;
+    hi_u32 i;
+
+    IoTCarSchedGetStat(&stat);
+    plan.stepNum = 1;
+    plan.step[0].action = TestPlanSlow;
+    plan.step[0].holdMs = 10000;
+    for (i = 0; i < 32; i++)
+    {
+        failed += (0 != IoTCarSchedSubmit(&plan));
+    }
+    plan.step[0].action = TestPlanLast;
+    plan.step[0].holdMs = 0;
+    failed += (0 != IoTCarSchedSubmit(&plan));
+    start = hi_get_milli_seconds();
+    while ((gTestPlanLast == 0) && (hi_get_milli_seconds() - start < CN_TEST_WAIT_MS))
+    {
+        hi_sleep(1);
+    }
+    IoTCarSchedGetStat(&end);
+    TEST_CHECK(failed == 0, "%u submits failed", failed);
+    TEST_CHECK(gTestPlanLast == 1, "the last plan ran %u times", gTestPlanLast);
+    ///< every slow plan was replaced, waiting or running
+    TEST_CHECK((end.submitCnt - stat.submitCnt == 33) && (end.preemptCnt - stat.preemptCnt >= 32),
+        "submit %u preempt %u", end.submitCnt - stat.submitCnt, end.preemptCnt - stat.preemptCnt);
+}
+
+static hi_void TestCarCommand(hi_void)
+{
+    extern hi_u32 g_car_speed;
+    extern hi_u8 g_car_status;
+    extern hi_u16 g_car_direction_control_module;
+    HostHalRecord_t pwm[8];
+    IoTCarSchedStat_t stat;
+    hi_u32 n;
+
+    TEST_CHECK(0 == IoTCarSchedInit(), "scheduler init");
+
+    ///< go back and stop at once: pwm3 and pwm0 at the speed, then both at the stop duty
+    HostHalReset();
+    (void)MQTT_car_ctrl(0, "commands/request_id=1",
+        "{\"service_id\":\"CAR_CTRL\",\"command_name\":\"GO_BACK\",\"paras\":{\"DURATION\":0}}");
+    n = TestPwmStarts(24, pwm, 8);
+    TEST_CHECK(n == 4, "go back pwm starts %u", n);
+    if (n == 4)
+    {
+        TEST_CHECK((pwm[0].id == HI_PWM_PORT_PWM3) && (pwm[0].val == g_car_speed), "go back pwm %u %u", pwm[0].id, pwm[0].val);
+        TEST_CHECK((pwm[1].id == HI_PWM_PORT_PWM0) && (pwm[1].val == g_car_speed), "go back pwm %u %u", pwm[1].id, pwm[1].val);
+        TEST_CHECK((pwm[2].id == HI_PWM_PORT_PWM3) && (pwm[2].val == 100), "stop pwm %u %u", pwm[2].id, pwm[2].val);
+        TEST_CHECK((pwm[3].id == HI_PWM_PORT_PWM0) && (pwm[3].val == 100), "stop pwm %u %u", pwm[3].id, pwm[3].val);
+    }
+
+    ///< another service or an unknown command moves nothing
+    HostHalReset();
+    (void)MQTT_car_ctrl(0, "t", "{\"service_id\":\"LIGHT\",\"command_name\":\"GO_BACK\"}");
+    (void)MQTT_car_ctrl(0, "t", "{\"service_id\":\"CAR_CTRL\",\"command_name\":\"FLY\"}");
+    hi_sleep(50);
+    TEST_CHECK(HostHalGetCount() == 0, "ignored commands moved %u pins", HostHalGetCount());
+
+    ///< a stop preempts the forward which holds for 10 s, and the car_stop of its plan never runs
+    IoTCarSchedGetStat(&stat);
+    n = stat.preemptCnt;
+    (void)MQTT_car_ctrl(0, "t", "{\"service_id\":\"CAR_CTRL\",\"command_name\":\"GO_FORWARD\",\"paras\":{\"DURATION\":10000}}");
+    hi_sleep(600); ///< the forward stops 500 ms first to switch the mode
+    HostHalReset();
+    (void)MQTT_car_ctrl(0, "t", "{\"service_id\":\"CAR_CTRL\",\"command_name\":\"STOP\"}");
+    hi_sleep(50);
+    IoTCarSchedGetStat(&stat);
+    TEST_CHECK(stat.preemptCnt == n + 1, "preempt %u", stat.preemptCnt - n);
+    TEST_CHECK(HostHalGetCount() == 0, "stop moved %u pins", HostHalGetCount());
+    TEST_CHECK((g_car_status == CAR_STOP_STATUS) && (g_car_direction_control_module == CAR_STOP_TYPE), "stop mode %u %u",
+        g_car_status, g_car_direction_control_module);
+}
+
+int main(void)
+{
+    TestProfile();
+    TestShadow();
+    TestReport();
+    TestCmdDecode();
+    TestRouter();
+    TestMsgSlab();
+    TestCarCommand();
+    TestCarSchedBurst();
+    (void)printf("%d checks, %d failed\n", gTestChecks, gTestFails);
+    return (gTestFails == 0) ? 0 : 1;
+}
@@ -0,0 +1,774 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, cost of parsing the platform payloads with cJSON, on the heap and in an arena
+ * Author: HiSpark Product Team.
+ * Create: 2020-8-5
+ */
+
+/**
+ * A command, a property report of a few services and a message with escapes, parsed and freed
+ * over and over:
+ *
+ * heap: cJSON_Parse and cJSON_Delete, an allocation for each item and string.
+ * arena: cJSON_ParseInArena into a buffer big enough for the payload, and cJSON_ArenaReset.
+ * chain: cJSON_ParseInArena into an arena of small chunks only.
+ * inplace: cJSON_ParseInPlace into the buffer, the strings stay in a copy of the payload, which
+ *      the time includes.
+ *
+ * The heap calls per parse are counted by host_alloc.c. One "name key=value ..." line per payload
+ * and way, the exit code is not 0 if a way parses a payload to another tree than cJSON_Parse.
+ *
+ * Then the string scans: documents of long strings, plain and with escapes, parsed into the arena
+ * and printed with cJSON_PrintPreallocated, in MB/s of the document. The documents are written as
+ * cJSON prints, so they must print back byte for byte. The Makefile builds it once per scan of
+ * cJSON.c, the scan= of the lines.
+ *
+ * Then the lookups by name in objects of 10, 100 and 10000 keys: a walk of the list with strcmp as
+ * cJSON does without the index, cJSON_GetObjectItemCaseSensitive, cJSON_GetObjectItem and
+ * cJSONUtils_GetPointerCaseSensitive, and the gateway filling an object with get or add for each
+ * key, with the walk and with cJSON. Each lookup must find the item of its key. The Makefile builds
+ * json_bench_index with CJSON_OBJECT_INDEX, the index= of the lines.
+ *
+ * Then the streaming parse: a batch of the reports of 16 and of 256 devices, of which only the
+ * number of devices, the sum of their speeds and the longest distance are wanted. cJSON_Parse makes
+ * the tree and walks it, cJSON_SaxFeed is fed the batch in segments of a TCP packet. The peak of
+ * the heap in use is taken through cJSON_InitHooks, state_bytes is what the streaming parse holds
+ * outside the heap, the cJSON_Sax and its token. Both must find the same three fields.
+ *
+ * Then the print of the same batches, parsed: cJSON_PrintUnformatted against cJSON_PrintToWriter
+ * through a buffer of 256 bytes into the publish buffer, with the peak of the heap the print takes.
+ * The writer must hand over the text cJSON_PrintUnformatted makes, and formatted that of cJSON_Print.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <hi_types_base.h>
+#include <hi_time.h>
+#include <cJSON.h>
+#include <cJSON_Utils.h>
+#include "host.h"
+
+#define CN_JSON_BENCH_PARSES 200000
+#define CN_JSON_BENCH_ARENASIZE 4096
+#define CN_JSON_BENCH_CHUNKSIZE 256
+#define CN_JSON_BENCH_TEXTSIZE 1024
+#define CN_JSON_BENCH_DOCSIZE 32768
+#define CN_JSON_BENCH_DOCITEMS 64
+#define CN_JSON_BENCH_DOCWORDS 32 ///< in the string of an item
+#define CN_JSON_BENCH_DOCPARSES 100 ///< the payload parses for one document parse
+#define CN_JSON_BENCH_KEYSIZE 16
+#define CN_JSON_BENCH_WALKSTEPS 20000000 ///< the most compares the walk way takes for a size
+#define CN_JSON_BENCH_DEVICESIZE 256 ///< the most text of a device in a batch
+#define CN_JSON_BENCH_SEGMENT 1460
+#define CN_JSON_BENCH_TOKENSIZE 128
+#define CN_JSON_BENCH_CHUNKPRINT 256
+
+#if defined(CJSON_SCAN_BYTES)
+#define CN_JSON_BENCH_SCAN "bytes"
+#elif defined(CJSON_SCAN_SWAR)
+#define CN_JSON_BENCH_SCAN "swar"
+#elif defined(__AVX2__)
+#define CN_JSON_BENCH_SCAN "avx2"
+#elif defined(__SSE2__)
+#define CN_JSON_BENCH_SCAN "sse2"
+#else
+#define CN_JSON_BENCH_SCAN "swar"
+#endif
+
+#ifdef CJSON_OBJECT_INDEX
+#define CN_JSON_BENCH_INDEX "on"
+#else
+#define CN_JSON_BENCH_INDEX "off"
+#endif
+
+typedef enum
+{
+    EN_JSON_BENCH_HEAP = 0,
+    EN_JSON_BENCH_ARENA,
+    EN_JSON_BENCH_CHAIN,
+    EN_JSON_BENCH_INPLACE,
+    EN_JSON_BENCH_WAYS,
+} JsonBenchWay_t;
+
+typedef struct
+{
+    const char *name;
+    const char *text;
+} JsonBenchPayload_t;
+
+static const char *gJsonBenchWays[EN_JSON_BENCH_WAYS] = {"heap", "arena", "chain", "inplace"};
+
+static const JsonBenchPayload_t gJsonBenchPayloads[] = {
+    {"command", "{\"object_device_id\":\"5f0c2f1a_car\",\"service_id\":\"CarControl\",\"command_name\":\"Forward\","
+        "\"paras\":{\"speed\":50,\"duration\":1000,\"light\":\"RED\"}}"},
+    {"report", "{\"services\":[{\"service_id\":\"CarStatus\",\"properties\":{\"speed\":50,\"direction\":\"forward\","
+        "\"battery\":87.5,\"obstacle\":false,\"distance\":132},\"event_time\":\"20200805T081500Z\"},"
+        "{\"service_id\":\"TrafficLight\",\"properties\":{\"light\":\"RED\",\"remaining\":12,\"mode\":\"auto\"}},"
+        "{\"service_id\":\"Sensor\",\"properties\":{\"temperature\":23.4,\"humidity\":61,\"values\":[1,2,3,4,5,6,7,8]}}]}"},
+    {"escaped", "{\"service_id\":\"Display\",\"command_name\":\"Show\",\"paras\":{\"text\":\"line \\\"one\\\"\\nline two\","
+        "\"unicode\":\"caf\\u00e9 \\u4e2d\\u6587\",\"path\":\"a\\/b\\\\c\"}}"},
+};
+
+static struct
+{
+    hi_u32 parses;
+    cJSON_Arena arena;
+    cJSON_Arena chain;
+    char arenaBuf[CN_JSON_BENCH_ARENASIZE];
+    char text[CN_JSON_BENCH_TEXTSIZE];
+    cJSON_Arena docArena;
+    char docArenaBuf[CN_JSON_BENCH_DOCSIZE * 2];
+    char doc[CN_JSON_BENCH_DOCSIZE];
+    char printed[CN_JSON_BENCH_DOCSIZE];
+} gJsonBench;
+
+///< parse the payload one way, NULL if it fails
+static cJSON *JsonBenchParse(JsonBenchWay_t way, const char *text)
+{
+    switch (way)
+    {
+        case EN_JSON_BENCH_ARENA:
+            return cJSON_ParseInArena(&gJsonBench.arena, text, NULL, 1);
+        case EN_JSON_BENCH_CHAIN:
+            return cJSON_ParseInArena(&gJsonBench.chain, text, NULL, 1);
+        case EN_JSON_BENCH_INPLACE:
+            (void)strcpy(gJsonBench.text, text);
+            return cJSON_ParseInPlace(&gJsonBench.arena, gJsonBench.text, NULL, 1);
+        default:
+            return cJSON_ParseWithOpts(text, NULL, 1);
+    }
+}
+
+static hi_void JsonBenchFree(JsonBenchWay_t way, cJSON *root)
+{
+    switch (way)
+    {
+        case EN_JSON_BENCH_ARENA:
+        case EN_JSON_BENCH_INPLACE:
+            cJSON_ArenaReset(&gJsonBench.arena);
+            break;
+        case EN_JSON_BENCH_CHAIN:
+            cJSON_ArenaReset(&gJsonBench.chain);
+            break;
+        default:
+            cJSON_Delete(root);
+            break;
+    }
+    return;
+}
+
+///< the payload parsed one way must print as parsed by cJSON_Parse
+static int JsonBenchCheck(JsonBenchWay_t way, const JsonBenchPayload_t *payload)
+{
+    cJSON *root;
+    char *want;
+    char *got;
+    int ret = -1;
+
+    root = cJSON_Parse(payload->text);
+    want = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    root = JsonBenchParse(way, payload->text);
+    got = (root == NULL) ? NULL : cJSON_PrintUnformatted(root);
+    if ((want != NULL) && (got != NULL) && (0 == strcmp(want, got)))
+    {
+        ret = 0;
+    }
+    JsonBenchFree(way, root);
+    cJSON_free(want);
+    cJSON_free(got);
+    return ret;
+}
+
+static int JsonBenchRun(JsonBenchWay_t way, const JsonBenchPayload_t *payload)
+{
+    HostAllocStat_t start;
+    HostAllocStat_t end;
+    hi_u64 startUs;
+    hi_u64 us;
+    hi_u32 failed = 0;
+    hi_u32 i;
+    cJSON *root;
+
+    if (0 != JsonBenchCheck(way, payload))
+    {
+        (void)printf("json.parse payload=%s way=%s failed=mismatch\n", payload->name, gJsonBenchWays[way]);
+        return -1;
+    }
+    HostAllocGetStat(&start);
+    startUs = hi_get_us();
+    for (i = 0; i < gJsonBench.parses; i++)
+    {
+        root = JsonBenchParse(way, payload->text);
+        failed += (root == NULL);
+        JsonBenchFree(way, root);
+    }
+    us = hi_get_us() - startUs;
+    HostAllocGetStat(&end);
+
+    (void)printf("json.parse payload=%s bytes=%zu way=%s n=%u ns_per_parse=%.1f allocs_per_parse=%.2f "
+        "frees_per_parse=%.2f\n", payload->name, strlen(payload->text), gJsonBenchWays[way], gJsonBench.parses,
+        (double)us * 1000 / gJsonBench.parses, (double)(end.allocCnt - start.allocCnt) / gJsonBench.parses,
+        (double)(end.freeCnt - start.freeCnt) / gJsonBench.parses);
+    return (failed == 0) ? 0 : -1;
+}
+
+typedef enum
+{
+    EN_JSON_LOOKUP_WALK = 0,
+    EN_JSON_LOOKUP_CASE,
+    EN_JSON_LOOKUP_NOCASE,
+    EN_JSON_LOOKUP_POINTER,
+    EN_JSON_LOOKUP_WAYS,
+} JsonLookupWay_t;
+
+static const char *gJsonLookupWays[EN_JSON_LOOKUP_WAYS] = {"walk", "case", "nocase", "pointer"};
+
+///< the names of the keys, "/device_<n>", the pointer way looks up the name with the slash
+static char (*gJsonBenchKeys)[CN_JSON_BENCH_KEYSIZE];
+
+///< get_object_item as it was, a walk of the list
+static cJSON *JsonBenchWalk(const cJSON *object, const char *name)
+{
+    cJSON *item = object->child;
+
+    while ((item != NULL) && (item->string != NULL) && (0 != strcmp(name, item->string)))
+    {
+        item = item->next;
+    }
+    return item;
+}
+
+static cJSON *JsonBenchLookup(JsonLookupWay_t way, cJSON *object, hi_u32 key)
+{
+    switch (way)
+    {
+        case EN_JSON_LOOKUP_WALK:
+            return JsonBenchWalk(object, gJsonBenchKeys[key] + 1);
+        case EN_JSON_LOOKUP_CASE:
+            return cJSON_GetObjectItemCaseSensitive(object, gJsonBenchKeys[key] + 1);
+        case EN_JSON_LOOKUP_NOCASE:
+            return cJSON_GetObjectItem(object, gJsonBenchKeys[key] + 1);
+        default:
+            return cJSONUtils_GetPointerCaseSensitive(object, gJsonBenchKeys[key]);
+    }
+}
+
+///< the gateway filling an object with a report of each key, looking the key up before adding it
+static int JsonBenchAggregate(hi_u32 keys, hi_bool walk)
+{
+    cJSON *object = cJSON_CreateObject();
+    hi_u64 startUs;
+    hi_u64 us;
+    hi_u32 failed = 0;
+    hi_u32 i;
+    cJSON *item;
+
+    if (object == NULL)
+    {
+        return -1;
+    }
+    startUs = hi_get_us();
+    for (i = 0; i < keys; i++)
+    {
+        item = walk ? JsonBenchWalk(object, gJsonBenchKeys[i] + 1) :
+            cJSON_GetObjectItemCaseSensitive(object, gJsonBenchKeys[i] + 1);
+        if (item == NULL)
+        {
+            failed += (NULL == cJSON_AddNumberToObject(object, gJsonBenchKeys[i] + 1, i));
+        }
+    }
+    us = hi_get_us() - startUs;
+    for (i = 0; i < keys; i++)
+    {
+        item = cJSON_GetObjectItemCaseSensitive(object, gJsonBenchKeys[i] + 1);
+        failed += ((item == NULL) || (item->valueint != (int)i));
+    }
+    cJSON_Delete(object);
+
+    (void)printf("json.aggregate keys=%u index=%s way=%s ns_per_key=%.1f%s\n", keys, CN_JSON_BENCH_INDEX,
+        walk ? "walk" : "case", (double)us * 1000 / keys, (failed == 0) ? "" : " failed=mismatch");
+    return (failed == 0) ? 0 : -1;
+}
+
+static int JsonBenchLookups(hi_u32 keys)
+{
+    cJSON *object = cJSON_CreateObject();
+    hi_u32 way;
+    hi_u32 lookups;
+    hi_u32 failed;
+    hi_u32 i;
+    hi_u32 key;
+    hi_u64 startUs;
+    hi_u64 us;
+    cJSON *item;
+    int ret = 0;
+
+    if (object == NULL)
+    {
+        return -1;
+    }
+    for (i = 0; i < keys; i++)
+    {
+        (void)snprintf(gJsonBenchKeys[i], sizeof(gJsonBenchKeys[i]), "/device_%u", i);
+        ret |= (NULL == cJSON_AddNumberToObject(object, gJsonBenchKeys[i] + 1, i)) ? -1 : 0;
+    }
+
+    for (way = 0; way < EN_JSON_LOOKUP_WAYS; way++)
+    {
+        lookups = gJsonBench.parses;
+        if ((way == EN_JSON_LOOKUP_WALK) && (lookups > (CN_JSON_BENCH_WALKSTEPS / keys)))
+        {
+            lookups = CN_JSON_BENCH_WALKSTEPS / keys;
+        }
+        failed = 0;
+        startUs = hi_get_us();
+        for (i = 0; i < lookups; i++)
+        {
+            key = (hi_u32)(((hi_u64)i * 7919) % keys);
+            item = JsonBenchLookup((JsonLookupWay_t)way, object, key);
+            failed += ((item == NULL) || (item->valueint != (int)key));
+        }
+        us = hi_get_us() - startUs;
+        (void)printf("json.lookup keys=%u index=%s way=%s n=%u ns_per_lookup=%.1f%s\n", keys, CN_JSON_BENCH_INDEX,
+            gJsonLookupWays[way], lookups, (double)us * 1000 / lookups, (failed == 0) ? "" : " failed=mismatch");
+        ret |= (failed == 0) ? 0 : -1;
+    }
+    cJSON_Delete(object);
+
+    ret |= JsonBenchAggregate(keys, HI_TRUE);
+    ret |= JsonBenchAggregate(keys, HI_FALSE);
+    return ret;
+}
+
+///< the fields wanted from a batch
+typedef struct
+{
+    hi_u32 devices;
+    double speeds;
+    double distance;
+    char key[CN_JSON_BENCH_KEYSIZE]; ///< of the value the streaming parse is at, cut short
+} JsonBenchFields_t;
+
+static struct
+{
+    size_t used;
+    size_t peak;
+} gJsonBenchHeap;
+
+///< the hooks of cJSON for the batch, a size before each block to keep the heap in use
+static void *JsonBenchHeapMalloc(size_t size)
+{
+    size_t *block = malloc(sizeof(size_t) * 2 + size);
+
+    if (block == NULL)
+    {
+        return NULL;
+    }
+    block[0] = size;
+    gJsonBenchHeap.used += size;
+    if (gJsonBenchHeap.used > gJsonBenchHeap.peak)
+    {
+        gJsonBenchHeap.peak = gJsonBenchHeap.used;
+    }
+    return block + 2;
+}
+
+static void JsonBenchHeapFree(void *ptr)
+{
+    size_t *block = (size_t *)ptr - 2;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+    gJsonBenchHeap.used -= block[0];
+    free(block);
+}
+
+///< the reports of the devices, each with a speed, a distance and a text
+static char *JsonBenchBatchMake(hi_u32 devices)
+{
+    size_t size = (size_t)devices * CN_JSON_BENCH_DEVICESIZE + CN_JSON_BENCH_DEVICESIZE;
+    char *batch = malloc(size);
+    size_t len = 0;
+    hi_u32 i;
+
+    if (batch == NULL)
+    {
+        return NULL;
+    }
+    len += (size_t)snprintf(batch + len, size - len, "{\"devices\":[");
+    for (i = 0; i < devices; i++)
+    {
+        len += (size_t)snprintf(batch + len, size - len, "%s{\"device_id\":\"car_%u\",\"services\":[{\"service_id\":"
+            "\"CarStatus\",\"properties\":{\"speed\":%u,\"distance\":%u.5,\"obstacle\":%s,\"light\":\"RED\","
+            "\"text\":\"front wheel \\\"left\\\" sensor\\nreported\"},\"event_time\":\"20200805T081500Z\"}]}",
+            (i == 0) ? "" : ",", i, (i * 7) % 100, (i * 13) % 500, ((i % 3) == 0) ? "true" : "false");
+    }
+    (void)snprintf(batch + len, size - len, "]}");
+    return batch;
+}
+
+static hi_void JsonBenchFieldsTree(const cJSON *root, JsonBenchFields_t *fields)
+{
+    const cJSON *device;
+    const cJSON *service;
+    const cJSON *properties;
+    const cJSON *speed;
+    const cJSON *distance;
+
+    cJSON_ArrayForEach(device, cJSON_GetObjectItemCaseSensitive(root, "devices"))
+    {
+        fields->devices += (NULL != cJSON_GetObjectItemCaseSensitive(device, "device_id"));
+        cJSON_ArrayForEach(service, cJSON_GetObjectItemCaseSensitive(device, "services"))
+        {
+            properties = cJSON_GetObjectItemCaseSensitive(service, "properties");
+            speed = cJSON_GetObjectItemCaseSensitive(properties, "speed");
+            fields->speeds += cJSON_IsNumber(speed) ? speed->valuedouble : 0;
+            distance = cJSON_GetObjectItemCaseSensitive(properties, "distance");
+            if (cJSON_IsNumber(distance) && (distance->valuedouble > fields->distance))
+            {
+                fields->distance = distance->valuedouble;
+            }
+        }
+    }
+    return;
+}
+
+static cJSON_bool JsonBenchSaxKey(void *context, const char *key)
+{
+    JsonBenchFields_t *fields = context;
+
+    (void)strncpy(fields->key, key, sizeof(fields->key) - 1);
+    return 1;
+}
+
+static cJSON_bool JsonBenchSaxValue(void *context, const cJSON *value)
+{
+    JsonBenchFields_t *fields = context;
+
+    if (0 == strcmp(fields->key, "device_id"))
+    {
+        fields->devices++;
+    }
+    else if (0 == strcmp(fields->key, "speed"))
+    {
+        fields->speeds += value->valuedouble;
+    }
+    else if ((0 == strcmp(fields->key, "distance")) && (value->valuedouble > fields->distance))
+    {
+        fields->distance = value->valuedouble;
+    }
+    return 1;
+}
+
+static const cJSON_SaxHandler gJsonBenchSax = {NULL, NULL, NULL, NULL, JsonBenchSaxKey, JsonBenchSaxValue};
+
+static hi_bool JsonBenchFieldsSax(const char *batch, size_t bytes, JsonBenchFields_t *fields)
+{
+    char token[CN_JSON_BENCH_TOKENSIZE];
+    cJSON_Sax sax;
+    size_t offset;
+    size_t segment;
+
+    cJSON_SaxInit(&sax, &gJsonBenchSax, fields, token, sizeof(token));
+    for (offset = 0; offset < bytes; offset += segment)
+    {
+        segment = ((bytes - offset) < CN_JSON_BENCH_SEGMENT) ? (bytes - offset) : CN_JSON_BENCH_SEGMENT;
+        if (!cJSON_SaxFeed(&sax, batch + offset, segment))
+        {
+            return HI_FALSE;
+        }
+    }
+    return cJSON_SaxFinish(&sax) ? HI_TRUE : HI_FALSE;
+}
+
+static int JsonBenchSax(hi_u32 devices)
+{
+    cJSON_Hooks hooks = {JsonBenchHeapMalloc, JsonBenchHeapFree};
+    hi_u32 passes = (gJsonBench.parses + 999) / 1000;
+    JsonBenchFields_t tree;
+    JsonBenchFields_t sax;
+    hi_u64 startUs;
+    hi_u64 treeUs;
+    hi_u64 saxUs;
+    size_t treePeak;
+    size_t bytes;
+    hi_u32 failed = 0;
+    hi_u32 i;
+    cJSON *root;
+    char *batch = JsonBenchBatchMake(devices);
+
+    if (batch == NULL)
+    {
+        return -1;
+    }
+    bytes = strlen(batch);
+    cJSON_InitHooks(&hooks);
+    (void)memset(&gJsonBenchHeap, 0, sizeof(gJsonBenchHeap));
+    startUs = hi_get_us();
+    for (i = 0; i < passes; i++)
+    {
+        (void)memset(&tree, 0, sizeof(tree));
+        root = cJSON_Parse(batch);
+        failed += (root == NULL);
+        JsonBenchFieldsTree(root, &tree);
+        cJSON_Delete(root);
+    }
+    treeUs = hi_get_us() - startUs;
+    treePeak = gJsonBenchHeap.peak;
+
+    (void)memset(&gJsonBenchHeap, 0, sizeof(gJsonBenchHeap));
+    startUs = hi_get_us();
+    for (i = 0; i < passes; i++)
+    {
+        (void)memset(&sax, 0, sizeof(sax));
+        failed += !JsonBenchFieldsSax(batch, bytes, &sax);
+    }
+    saxUs = hi_get_us() - startUs;
+    cJSON_InitHooks(NULL);
+    free(batch);
+
+    failed += (tree.devices != devices) || (sax.devices != tree.devices) || (sax.speeds != tree.speeds) ||
+        (sax.distance != tree.distance);
+    (void)printf("json.sax devices=%u bytes=%zu way=tree n=%u us_per_parse=%.1f peak_heap_bytes=%zu\n", devices,
+        bytes, passes, (double)treeUs / passes, treePeak);
+    (void)printf("json.sax devices=%u bytes=%zu way=sax n=%u us_per_parse=%.1f peak_heap_bytes=%zu "
+        "state_bytes=%zu%s\n", devices, bytes, passes, (double)saxUs / passes, gJsonBenchHeap.peak,
+        sizeof(cJSON_Sax) + CN_JSON_BENCH_TOKENSIZE, (failed == 0) ? "" : " failed=mismatch");
+    return (failed == 0) ? 0 : -1;
+}
+
+///< the publish buffer the writer hands the text to
+typedef struct
+{
+    char *buffer;
+    size_t size;
+    size_t length;
+} JsonBenchPublish_t;
+
+static cJSON_bool JsonBenchWrite(void *context, const char *chunk, size_t length)
+{
+    JsonBenchPublish_t *publish = context;
+
+    if (length > (publish->size - publish->length - 1))
+    {
+        return 0;
+    }
+    (void)memcpy(publish->buffer + publish->length, chunk, length);
+    publish->length += length;
+    publish->buffer[publish->length] = '\0';
+    return 1;
+}
+
+///< the text of the writer against the one of the print, formatted or not
+static hi_bool JsonBenchPrintSame(const cJSON *root, JsonBenchPublish_t *publish, hi_bool format)
+{
+    char chunk[CN_JSON_BENCH_CHUNKPRINT];
+    char *printed = format ? cJSON_Print(root) : cJSON_PrintUnformatted(root);
+    hi_bool same;
+
+    publish->length = 0;
+    same = (printed != NULL) && cJSON_PrintToWriter(root, chunk, sizeof(chunk), format, JsonBenchWrite, publish) &&
+        (0 == strcmp(printed, publish->buffer));
+    cJSON_free(printed);
+    return same;
+}
+
+static int JsonBenchPrint(hi_u32 devices)
+{
+    cJSON_Hooks hooks = {JsonBenchHeapMalloc, JsonBenchHeapFree};
+    hi_u32 passes = (gJsonBench.parses + 999) / 1000;
+    char chunk[CN_JSON_BENCH_CHUNKPRINT];
+    JsonBenchPublish_t publish;
+    hi_u64 startUs;
+    hi_u64 printUs;
+    hi_u64 writerUs;
+    size_t printPeak;
+    size_t writerPeak;
+    size_t bytes;
+    hi_u32 failed = 0;
+    hi_u32 i;
+    char *printed;
+    cJSON *root;
+    char *batch = JsonBenchBatchMake(devices);
+
+    publish.size = (size_t)devices * CN_JSON_BENCH_DEVICESIZE * 2;
+    publish.buffer = malloc(publish.size);
+    cJSON_InitHooks(&hooks);
+    root = (batch == NULL) ? NULL : cJSON_Parse(batch);
+    free(batch);
+    if ((root == NULL) || (publish.buffer == NULL))
+    {
+        cJSON_Delete(root);
+        cJSON_InitHooks(NULL);
+        free(publish.buffer);
+        return -1;
+    }
+    failed += !JsonBenchPrintSame(root, &publish, HI_FALSE) + !JsonBenchPrintSame(root, &publish, HI_TRUE);
+
+    gJsonBenchHeap.peak = gJsonBenchHeap.used;
+    startUs = hi_get_us();
+    for (i = 0; i < passes; i++)
+    {
+        printed = cJSON_PrintUnformatted(root);
+        failed += (printed == NULL);
+        cJSON_free(printed);
+    }
+    printUs = hi_get_us() - startUs;
+    printPeak = gJsonBenchHeap.peak - gJsonBenchHeap.used;
+
+    gJsonBenchHeap.peak = gJsonBenchHeap.used;
+    startUs = hi_get_us();
+    for (i = 0; i < passes; i++)
+    {
+        publish.length = 0;
+        failed += !cJSON_PrintToWriter(root, chunk, sizeof(chunk), 0, JsonBenchWrite, &publish);
+    }
+    writerUs = hi_get_us() - startUs;
+    writerPeak = gJsonBenchHeap.peak - gJsonBenchHeap.used;
+    bytes = publish.length;
+
+    (void)printf("json.print devices=%u bytes=%zu way=unformatted n=%u us_per_print=%.1f peak_heap_bytes=%zu\n",
+        devices, bytes, passes, (double)printUs / passes, printPeak);
+    (void)printf("json.print devices=%u bytes=%zu way=writer n=%u us_per_print=%.1f peak_heap_bytes=%zu "
+        "chunk_bytes=%u%s\n", devices, bytes, passes, (double)writerUs / passes,
+        writerPeak, CN_JSON_BENCH_CHUNKPRINT,
+        (failed == 0) ? "" : " failed=mismatch");
+    cJSON_Delete(root);
+    cJSON_InitHooks(NULL);
+    free(publish.buffer);
+    return (failed == 0) ? 0 : -1;
+}
+
+///< a document of objects with a long string each, escaped as cJSON prints them if escapes
+static hi_void JsonBenchDocMake(hi_bool escapes)
+{
+    static const char *words[] = {"front", "wheel", "speed", "sensor", "reported", "distance", "light",
+        "\xe4\xb8\xad\xe6\x96\x87", "obstacle", "battery"};
+    static const char *escaped[] = {"\\\"", "\\\\", "\\n", "\\t", "\\u0001", "/"};
+    hi_u32 len = 0;
+    hi_u32 i;
+    hi_u32 j;
+
+    len += (hi_u32)snprintf(gJsonBench.doc + len, sizeof(gJsonBench.doc) - len, "[");
+    for (i = 0; i < CN_JSON_BENCH_DOCITEMS; i++)
+    {
+        len += (hi_u32)snprintf(gJsonBench.doc + len, sizeof(gJsonBench.doc) - len,
+            "%s{\"id\":%u,\"name\":\"device_%u\",\"description\":\"", (i == 0) ? "" : ",", i, i);
+        for (j = 0; j < CN_JSON_BENCH_DOCWORDS; j++)
+        {
+            len += (hi_u32)snprintf(gJsonBench.doc + len, sizeof(gJsonBench.doc) - len, "%s%s",
+                (j == 0) ? "" : " ", words[(i + j * 7) % (sizeof(words) / sizeof(words[0]))]);
+            if (escapes && ((j % 4) == 3))
+            {
+                len += (hi_u32)snprintf(gJsonBench.doc + len, sizeof(gJsonBench.doc) - len, "%s",
+                    escaped[(i + j) % (sizeof(escaped) / sizeof(escaped[0]))]);
+            }
+        }
+        len += (hi_u32)snprintf(gJsonBench.doc + len, sizeof(gJsonBench.doc) - len, "\"}");
+    }
+    (void)snprintf(gJsonBench.doc + len, sizeof(gJsonBench.doc) - len, "]");
+    return;
+}
+
+static int JsonBenchDoc(const char *name, hi_bool escapes)
+{
+    hi_u32 passes = (gJsonBench.parses + CN_JSON_BENCH_DOCPARSES - 1) / CN_JSON_BENCH_DOCPARSES;
+    hi_u64 startUs;
+    hi_u64 parseUs;
+    hi_u64 printUs;
+    hi_u32 failed = 0;
+    hi_u32 i;
+    size_t bytes;
+    cJSON *root;
+
+    JsonBenchDocMake(escapes);
+    bytes = strlen(gJsonBench.doc);
+    root = cJSON_ParseInArena(&gJsonBench.docArena, gJsonBench.doc, NULL, 1);
+    if ((root == NULL) || !cJSON_PrintPreallocated(root, gJsonBench.printed, sizeof(gJsonBench.printed), 0) ||
+        (0 != strcmp(gJsonBench.doc, gJsonBench.printed)))
+    {
+        (void)printf("json.string doc=%s scan=%s failed=mismatch\n", name, CN_JSON_BENCH_SCAN);
+        cJSON_ArenaReset(&gJsonBench.docArena);
+        return -1;
+    }
+
+    startUs = hi_get_us();
+    for (i = 0; i < passes; i++)
+    {
+        failed += !cJSON_PrintPreallocated(root, gJsonBench.printed, sizeof(gJsonBench.printed), 0);
+    }
+    printUs = hi_get_us() - startUs;
+    cJSON_ArenaReset(&gJsonBench.docArena);
+
+    startUs = hi_get_us();
+    for (i = 0; i < passes; i++)
+    {
+        failed += (NULL == cJSON_ParseInArena(&gJsonBench.docArena, gJsonBench.doc, NULL, 1));
+        cJSON_ArenaReset(&gJsonBench.docArena);
+    }
+    parseUs = hi_get_us() - startUs;
+
+    (void)printf("json.string doc=%s scan=%s bytes=%zu n=%u parse_mb_per_s=%.1f print_mb_per_s=%.1f\n", name,
+        CN_JSON_BENCH_SCAN, bytes, passes, (double)bytes * passes / (parseUs + 1),
+        (double)bytes * passes / (printUs + 1));
+    return (failed == 0) ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    hi_u32 i;
+    hi_u32 way;
+    int opt;
+    int ret = 0;
+
+    gJsonBench.parses = CN_JSON_BENCH_PARSES;
+    while ((opt = getopt(argc, argv, "n:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                gJsonBench.parses = (hi_u32)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                (void)fprintf(stderr, "usage: %s [-n parses]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (gJsonBench.parses == 0)
+    {
+        gJsonBench.parses = 1;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    cJSON_ArenaInit(&gJsonBench.arena, gJsonBench.arenaBuf, sizeof(gJsonBench.arenaBuf), 0);
+    cJSON_ArenaInit(&gJsonBench.chain, NULL, 0, CN_JSON_BENCH_CHUNKSIZE);
+    cJSON_ArenaInit(&gJsonBench.docArena, gJsonBench.docArenaBuf, sizeof(gJsonBench.docArenaBuf), 0);
+    for (i = 0; i < sizeof(gJsonBenchPayloads) / sizeof(gJsonBenchPayloads[0]); i++)
+    {
+        for (way = 0; way < EN_JSON_BENCH_WAYS; way++)
+        {
+            ret |= JsonBenchRun((JsonBenchWay_t)way, &gJsonBenchPayloads[i]);
+        }
+    }
+    ret |= JsonBenchDoc("text", HI_FALSE);
+    ret |= JsonBenchDoc("escaped", HI_TRUE);
+
+    gJsonBenchKeys = malloc(sizeof(gJsonBenchKeys[0]) * 10000);
+    if (gJsonBenchKeys == NULL)
+    {
+        return 1;
+    }
+    ret |= JsonBenchLookups(10);
+    ret |= JsonBenchLookups(100);
+    ret |= JsonBenchLookups(10000);
+    free(gJsonBenchKeys);
+
+    ret |= JsonBenchSax(16);
+    ret |= JsonBenchSax(256);
+    ret |= JsonBenchPrint(16);
+    ret |= JsonBenchPrint(256);
+    return (ret == 0) ? 0 : 1;
+}
@@ -0,0 +1,705 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, checks of the cJSON additions
+ * Author: HiSpark Product Team.
+ * Create: 2020-8-5
+ */
+
+/**
+ * scan: the string scan of cJSON.c against a byte at a time, through the parse, the print and the
+ *       streaming parse of strings of every length up to a few blocks, with a byte to stop at in
+ *       every place and starting at every offset of a word. The Makefile builds it once per scan,
+ *       the scan= of the first line.
+ * arena: cJSON_ParseInArena running out of the buffer, failing on every cut of a document and
+ *       parsing again after cJSON_ArenaReset, the heap calls counted by host_alloc.c: none in a
+ *       buffer, only the chunks in a chained arena and never a free of what was carved from it
+ *       before the reset. cJSON_ParseInPlace unescaping the strings into the text it is given.
+ * sax:  the events of cJSON_SaxFeed in the order of a nested document, the same fed whole, a byte
+ *       at a time and cut in three at every pair of places, through the escapes, the surrogate
+ *       pairs, the numbers and the literals. Every cut short of the end fails cJSON_SaxFinish.
+ * writer: cJSON_PrintToWriter handing over the text of cJSON_PrintUnformatted and cJSON_Print in
+ *       chunks no longer than its buffer takes, for texts around every multiple of the chunk, and
+ *       stopping at once, without the heap, when the writer fails at any of its calls.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <hi_types_base.h>
+#include <cJSON.h>
+#include "host.h"
+
+#define CN_JSON_TEST_SCANLEN 72 ///< more than two AVX2 blocks
+#define CN_JSON_TEST_SCANALIGN 8
+#define CN_JSON_TEST_TEXTSIZE 512
+#define CN_JSON_TEST_TOKENSIZE 128
+#define CN_JSON_TEST_SHOWN 8 ///< the failed strings printed
+#define CN_JSON_TEST_ARENASIZE 2048
+#define CN_JSON_TEST_SMALLARENA 256 ///< less than the items of the report
+#define CN_JSON_TEST_CHUNKSIZE 256
+#define CN_JSON_TEST_REUSES 16
+#define CN_JSON_TEST_EVENTSIZE 512
+#define CN_JSON_TEST_WRITERSIZE 32 ///< the smallest buffer cJSON_PrintToWriter takes
+#define CN_JSON_TEST_WRITTENSIZE 1024
+#define CN_JSON_TEST_WRITERCHUNKS 4 ///< the multiples of the chunk the texts go past
+
+#if defined(CJSON_SCAN_BYTES)
+#define CN_JSON_TEST_SCAN "bytes"
+#elif defined(CJSON_SCAN_SWAR)
+#define CN_JSON_TEST_SCAN "swar"
+#elif defined(__AVX2__)
+#define CN_JSON_TEST_SCAN "avx2"
+#elif defined(__SSE2__)
+#define CN_JSON_TEST_SCAN "sse2"
+#else
+#define CN_JSON_TEST_SCAN "swar"
+#endif
+
+static int gTestFails;
+static int gTestChecks;
+
+#define TEST_CHECK(cond, ...) \
+    do \
+    { \
+        gTestChecks++; \
+        if (!(cond)) \
+        { \
+            gTestFails++; \
+            (void)printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            (void)printf(__VA_ARGS__); \
+            (void)printf("\n"); \
+        } \
+    } while (0)
+
+///< the bytes a string scan goes over, around the bounds of the ones it stops at
+static const unsigned char gJsonTestPlain[] = {'a', ' ', '!', '#', '[', '~', 0x7f, 0x80, 0xe9, 0xff};
+///< the bytes it stops at, the quote and the backslash in the text and the control ones printing
+static const unsigned char gJsonTestSpecial[] = {'\"', '\\', 0x01, '\n', 0x1f};
+
+///< the reference, the text cJSON prints for the string, written a byte at a time
+static size_t JsonTestEscape(const unsigned char *str, size_t len, char *out)
+{
+    size_t n = 0;
+    size_t i;
+
+    out[n++] = '\"';
+    for (i = 0; i < len; i++)
+    {
+        switch (str[i])
+        {
+            case '\"':
+                n += (size_t)sprintf(out + n, "\\\"");
+                break;
+            case '\\':
+                n += (size_t)sprintf(out + n, "\\\\");
+                break;
+            case '\n':
+                n += (size_t)sprintf(out + n, "\\n");
+                break;
+            default:
+                if (str[i] < 32)
+                {
+                    n += (size_t)sprintf(out + n, "\\u%04x", str[i]);
+                }
+                else
+                {
+                    out[n++] = (char)str[i];
+                }
+                break;
+        }
+    }
+    out[n++] = '\"';
+    out[n] = '\0';
+    return n;
+}
+
+static cJSON_bool JsonTestSaxValue(void *context, const cJSON *value)
+{
+    const char *str = (const char *)context;
+
+    return cJSON_IsString(value) && (strcmp(value->valuestring, str) == 0);
+}
+
+static const cJSON_SaxHandler gJsonTestSaxString = {NULL, NULL, NULL, NULL, NULL, JsonTestSaxValue};
+
+///< one string through the three ways, 0 if all of them agree with the reference
+static int JsonTestScanOne(const unsigned char *str, size_t len, size_t align)
+{
+    static char text[CN_JSON_TEST_TEXTSIZE];
+    static char printed[CN_JSON_TEST_TEXTSIZE];
+    static char buf[CN_JSON_TEST_SCANLEN + CN_JSON_TEST_SCANALIGN + 1];
+    char token[CN_JSON_TEST_TOKENSIZE];
+    cJSON_Sax sax;
+    cJSON *item;
+    size_t textLen;
+    int ret = 0;
+
+    ///< the string starts align bytes into a word, in the text after as many spaces
+    (void)memcpy(buf + align, str, len);
+    buf[align + len] = '\0';
+    (void)memset(text, ' ', align);
+    textLen = align + JsonTestEscape(str, len, text + align);
+
+    item = cJSON_Parse(text);
+    if ((item == NULL) || !cJSON_IsString(item) || (strcmp(item->valuestring, buf + align) != 0))
+    {
+        ret = -1;
+    }
+    cJSON_Delete(item);
+
+    item = cJSON_CreateStringReference(buf + align);
+    if ((item == NULL) || !cJSON_PrintPreallocated(item, printed, sizeof(printed), HI_FALSE) ||
+        (strcmp(printed, text + align) != 0))
+    {
+        ret = -1;
+    }
+    cJSON_Delete(item);
+
+    cJSON_SaxInit(&sax, &gJsonTestSaxString, buf + align, token, sizeof(token));
+    if (!cJSON_SaxFeed(&sax, text, textLen) || !cJSON_SaxFinish(&sax))
+    {
+        ret = -1;
+    }
+    return ret;
+}
+
+static hi_void TestScan(hi_void)
+{
+    unsigned char str[CN_JSON_TEST_SCANLEN];
+    size_t len;
+    size_t pos;
+    size_t align;
+    size_t i;
+    size_t special;
+    hi_u32 strings = 0;
+    hi_u32 failed = 0;
+
+    for (len = 0; len <= CN_JSON_TEST_SCANLEN; len++)
+    {
+        for (i = 0; i < len; i++)
+        {
+            str[i] = gJsonTestPlain[i % sizeof(gJsonTestPlain)];
+        }
+        for (align = 0; align < CN_JSON_TEST_SCANALIGN; align++)
+        {
+            strings++;
+            if ((JsonTestScanOne(str, len, align) != 0) && (++failed <= CN_JSON_TEST_SHOWN))
+            {
+                (void)printf("plain len=%zu align=%zu\n", len, align);
+            }
+            for (pos = 0; pos < len; pos++)
+            {
+                for (special = 0; special < sizeof(gJsonTestSpecial); special++)
+                {
+                    str[pos] = gJsonTestSpecial[special];
+                    strings++;
+                    if ((JsonTestScanOne(str, len, align) != 0) && (++failed <= CN_JSON_TEST_SHOWN))
+                    {
+                        (void)printf("len=%zu align=%zu byte 0x%02x at %zu\n", len, align, str[pos], pos);
+                    }
+                }
+                str[pos] = gJsonTestPlain[pos % sizeof(gJsonTestPlain)];
+            }
+        }
+    }
+    TEST_CHECK(failed == 0, "scan=%s %u of %u strings", CN_JSON_TEST_SCAN, failed, strings);
+}
+
+static const char gJsonTestReport[] = "{\"services\":[{\"service_id\":\"CarStatus\",\"properties\":{\"speed\":50,"
+    "\"direction\":\"for\\u0077ard\",\"battery\":87.5,\"obstacle\":false,\"distance\":132,\"note\":\"a\\\"b\\nc\"}},"
+    "{\"service_id\":\"Sensor\",\"properties\":{\"values\":[1,2,3,4],\"ok\":true,\"none\":null}}]}";
+
+///< the heap calls made since start
+static hi_void JsonTestHeapDelta(const HostAllocStat_t *start, hi_u64 *allocs, hi_u64 *frees)
+{
+    HostAllocStat_t now;
+
+    HostAllocGetStat(&now);
+    *allocs = now.allocCnt - start->allocCnt;
+    *frees = now.freeCnt - start->freeCnt;
+}
+
+///< a buffer arena too small for the report fails it without the heap, and parses after a reset
+static hi_void TestArenaExhaust(hi_void)
+{
+    static hi_u64 mem[CN_JSON_TEST_SMALLARENA / sizeof(hi_u64)];
+    cJSON_Arena arena;
+    HostAllocStat_t heap;
+    hi_u64 allocs;
+    hi_u64 frees;
+    cJSON *root;
+
+    cJSON_ArenaInit(&arena, mem, sizeof(mem), 0);
+    HostAllocGetStat(&heap);
+    root = cJSON_ParseInArena(&arena, gJsonTestReport, NULL, 1);
+    JsonTestHeapDelta(&heap, &allocs, &frees);
+    TEST_CHECK(root == NULL, "the report in %u bytes", (hi_u32)sizeof(mem));
+    TEST_CHECK(arena.offset <= arena.size, "carved %zu of %zu", arena.offset, arena.size);
+    TEST_CHECK((allocs == 0) && (frees == 0), "heap calls of the exhausted parse %llu %llu",
+        (unsigned long long)allocs, (unsigned long long)frees);
+
+    cJSON_ArenaReset(&arena);
+    TEST_CHECK(arena.offset == 0, "offset after the reset %zu", arena.offset);
+    root = cJSON_ParseInArena(&arena, "[1,\"two\"]", NULL, 1);
+    TEST_CHECK((root != NULL) && (cJSON_GetArraySize(root) == 2) &&
+        (strcmp(cJSON_GetArrayItem(root, 1)->valuestring, "two") == 0), "parse after the reset");
+    TEST_CHECK((cJSON_ParseInArena(NULL, "[]", NULL, 1) == NULL) && (cJSON_ParseInPlace(NULL, "[]", NULL, 1) == NULL),
+        "no arena");
+}
+
+///< the same buffer parsed into over and over, the same tree each time and never the heap
+static hi_void TestArenaReuse(hi_void)
+{
+    static hi_u64 mem[CN_JSON_TEST_ARENASIZE / sizeof(hi_u64)];
+    cJSON_Arena arena;
+    HostAllocStat_t heap;
+    hi_u64 allocs;
+    hi_u64 frees;
+    cJSON *ref = cJSON_Parse(gJsonTestReport);
+    cJSON *root;
+    cJSON *first = NULL;
+    size_t used = 0;
+    hi_u32 same = 0;
+    hi_u32 i;
+
+    cJSON_ArenaInit(&arena, mem, sizeof(mem), 0);
+    HostAllocGetStat(&heap);
+    for (i = 0; i < CN_JSON_TEST_REUSES; i++)
+    {
+        root = cJSON_ParseInArena(&arena, gJsonTestReport, NULL, 1);
+        if (i == 0)
+        {
+            first = root;
+            used = arena.offset;
+        }
+        if ((root != NULL) && (root == first) && (arena.offset == used) && cJSON_Compare(root, ref, 1))
+        {
+            same++;
+        }
+        cJSON_ArenaReset(&arena);
+    }
+    JsonTestHeapDelta(&heap, &allocs, &frees);
+    TEST_CHECK((first != NULL) && (used > 0) && (used <= arena.size), "the report carved %zu bytes", used);
+    TEST_CHECK(same == CN_JSON_TEST_REUSES, "%u of %u parses the same tree at the same place", same,
+        CN_JSON_TEST_REUSES);
+    TEST_CHECK((allocs == 0) && (frees == 0), "heap calls of the buffer parses %llu %llu",
+        (unsigned long long)allocs, (unsigned long long)frees);
+    cJSON_Delete(ref);
+}
+
+///< a chained arena takes chunks and nothing else, and frees them on the reset only, parsed or not
+static hi_void TestArenaChunks(hi_void)
+{
+    static char text[sizeof(gJsonTestReport)];
+    cJSON_Arena arena;
+    HostAllocStat_t heap;
+    hi_u64 allocs;
+    hi_u64 frees;
+    cJSON *root;
+    size_t cut;
+    hi_u32 failed = 0;
+    hi_u32 freed = 0;
+
+    cJSON_ArenaInit(&arena, NULL, 0, CN_JSON_TEST_CHUNKSIZE);
+    HostAllocGetStat(&heap);
+    root = cJSON_ParseInArena(&arena, gJsonTestReport, NULL, 1);
+    JsonTestHeapDelta(&heap, &allocs, &frees);
+    TEST_CHECK((root != NULL) && (allocs > 1) && (frees == 0), "chunks of the report %llu %llu",
+        (unsigned long long)allocs, (unsigned long long)frees);
+    cJSON_ArenaReset(&arena);
+    JsonTestHeapDelta(&heap, &allocs, &frees);
+    TEST_CHECK((arena.chunks == NULL) && (frees == allocs), "reset freed %llu of %llu", (unsigned long long)frees,
+        (unsigned long long)allocs);
+
+    ///< every cut of the report fails, what it made stays in the arena until the reset
+    for (cut = 0; cut + 1 < sizeof(gJsonTestReport); cut++)
+    {
+        (void)memcpy(text, gJsonTestReport, cut);
+        text[cut] = '\0';
+        HostAllocGetStat(&heap);
+        if (cJSON_ParseInArena(&arena, text, NULL, 1) != NULL)
+        {
+            failed++;
+        }
+        JsonTestHeapDelta(&heap, &allocs, &frees);
+        cJSON_ArenaReset(&arena);
+        freed += (frees != 0);
+        JsonTestHeapDelta(&heap, &allocs, &frees);
+        failed += (frees != allocs);
+    }
+    TEST_CHECK(failed == 0, "%u cuts parsed or kept chunks", failed);
+    TEST_CHECK(freed == 0, "%u failed parses freed before the reset", freed);
+}
+
+///< the strings are unescaped into the text and point into it, only the items are carved
+static hi_void TestArenaInPlace(hi_void)
+{
+    static hi_u64 mem[CN_JSON_TEST_ARENASIZE / sizeof(hi_u64)];
+    static char text[sizeof(gJsonTestReport)];
+    cJSON_Arena arena;
+    HostAllocStat_t heap;
+    hi_u64 allocs;
+    hi_u64 frees;
+    cJSON *root;
+    cJSON *props;
+    cJSON *item;
+    const char *end = NULL;
+    size_t carved;
+
+    cJSON_ArenaInit(&arena, mem, sizeof(mem), 0);
+    root = cJSON_ParseInArena(&arena, gJsonTestReport, NULL, 1);
+    carved = arena.offset;
+    cJSON_ArenaReset(&arena);
+
+    (void)memcpy(text, gJsonTestReport, sizeof(text));
+    HostAllocGetStat(&heap);
+    root = cJSON_ParseInPlace(&arena, text, &end, 1);
+    JsonTestHeapDelta(&heap, &allocs, &frees);
+    TEST_CHECK((root != NULL) && (end == text + sizeof(text) - 1), "in place parse");
+    TEST_CHECK((allocs == 0) && (frees == 0), "heap calls of the in place parse %llu %llu",
+        (unsigned long long)allocs, (unsigned long long)frees);
+    TEST_CHECK((arena.offset > 0) && (arena.offset < carved), "in place carved %zu, the copies %zu", arena.offset,
+        carved);
+    TEST_CHECK(memcmp(text, gJsonTestReport, sizeof(text)) != 0, "the text is not changed");
+
+    props = cJSON_GetObjectItem(cJSON_GetArrayItem(cJSON_GetObjectItem(root, "services"), 0), "properties");
+    item = cJSON_GetObjectItem(props, "direction");
+    TEST_CHECK((item != NULL) && (strcmp(item->valuestring, "forward") == 0) &&
+        (item->valuestring > text) && (item->valuestring < text + sizeof(text)), "the escaped string in the text");
+    TEST_CHECK((item != NULL) && (item->string > text) && (item->string < text + sizeof(text)),
+        "the key in the text");
+    item = cJSON_GetObjectItem(props, "note");
+    TEST_CHECK((item != NULL) && (strcmp(item->valuestring, "a\"b\nc") == 0), "the escapes unescaped");
+    cJSON_ArenaReset(&arena);
+
+    (void)memcpy(text, "{\"a\":\"x\\ty\",\"b\":", sizeof("{\"a\":\"x\\ty\",\"b\":"));
+    HostAllocGetStat(&heap);
+    root = cJSON_ParseInPlace(&arena, text, NULL, 1);
+    JsonTestHeapDelta(&heap, &allocs, &frees);
+    TEST_CHECK((root == NULL) && (allocs == 0) && (frees == 0), "failed in place parse");
+    cJSON_ArenaReset(&arena);
+}
+
+static const char gJsonTestNested[] = "{\"a\":[1,-2.5e+3,true,false,null,{\"b\":\"x\\\"y\\u00e9\\ud83d\\ude00z\","
+    "\"n\":[[0.125]]}],\"c\":{},\"d\":[],\"e\":\"\\\\\\/\\t\"}";
+///< the events of gJsonTestNested, each ended by a '|'
+static const char gJsonTestNestedEvents[] = "{|k:a|[|n:1|n:-2500|t|f|z|{|k:b|s:x\"y\xc3\xa9\xf0\x9f\x98\x80z|k:n|[|[|n:0.125|]|]|}|]|"
+    "k:c|{|}|k:d|[|]|k:e|s:\\/\t|}|";
+
+typedef struct
+{
+    char text[CN_JSON_TEST_EVENTSIZE];
+    size_t length;
+} JsonTestEvents_t;
+
+static cJSON_bool JsonTestEventAdd(void *context, const char *fmt, const char *str, double number)
+{
+    JsonTestEvents_t *events = (JsonTestEvents_t *)context;
+    int ret;
+
+    if (str != NULL)
+    {
+        ret = snprintf(events->text + events->length, sizeof(events->text) - events->length, fmt, str);
+    }
+    else
+    {
+        ret = snprintf(events->text + events->length, sizeof(events->text) - events->length, fmt, number);
+    }
+    if ((ret < 0) || ((size_t)ret >= sizeof(events->text) - events->length))
+    {
+        return 0;
+    }
+    events->length += (size_t)ret;
+    return 1;
+}
+
+static cJSON_bool JsonTestStartObject(void *context)
+{
+    return JsonTestEventAdd(context, "{|", "", 0);
+}
+
+static cJSON_bool JsonTestEndObject(void *context)
+{
+    return JsonTestEventAdd(context, "}|", "", 0);
+}
+
+static cJSON_bool JsonTestStartArray(void *context)
+{
+    return JsonTestEventAdd(context, "[|", "", 0);
+}
+
+static cJSON_bool JsonTestEndArray(void *context)
+{
+    return JsonTestEventAdd(context, "]|", "", 0);
+}
+
+static cJSON_bool JsonTestKey(void *context, const char *key)
+{
+    return JsonTestEventAdd(context, "k:%s|", key, 0);
+}
+
+static cJSON_bool JsonTestValue(void *context, const cJSON *value)
+{
+    if (cJSON_IsString(value))
+    {
+        return JsonTestEventAdd(context, "s:%s|", value->valuestring, 0);
+    }
+    if (cJSON_IsNumber(value))
+    {
+        return JsonTestEventAdd(context, "n:%.17g|", NULL, value->valuedouble);
+    }
+    return JsonTestEventAdd(context, cJSON_IsTrue(value) ? "t|" : (cJSON_IsFalse(value) ? "f|" : "z|"), "", 0);
+}
+
+static const cJSON_SaxHandler gJsonTestSaxEvents = {JsonTestStartObject, JsonTestEndObject, JsonTestStartArray,
+    JsonTestEndArray, JsonTestKey, JsonTestValue};
+
+///< feed the text cut at first and second, 0 if it parses to the events
+static int JsonTestSaxCut(const char *text, size_t len, size_t first, size_t second, const char *expect)
+{
+    char token[CN_JSON_TEST_TOKENSIZE];
+    JsonTestEvents_t events;
+    cJSON_Sax sax;
+
+    events.length = 0;
+    events.text[0] = '\0';
+    cJSON_SaxInit(&sax, &gJsonTestSaxEvents, &events, token, sizeof(token));
+    if (!cJSON_SaxFeed(&sax, text, first) || !cJSON_SaxFeed(&sax, text + first, second - first) ||
+        !cJSON_SaxFeed(&sax, text + second, len - second) || !cJSON_SaxFinish(&sax))
+    {
+        return -1;
+    }
+    return (strcmp(events.text, expect) == 0) ? 0 : -1;
+}
+
+///< every cut of the text in three the same events, and every byte fed alone
+static hi_void JsonTestSaxCuts(const char *text, const char *expect)
+{
+    char token[CN_JSON_TEST_TOKENSIZE];
+    JsonTestEvents_t events;
+    cJSON_Sax sax;
+    size_t len = strlen(text);
+    size_t first;
+    size_t second;
+    size_t i;
+    hi_u32 failed = 0;
+    cJSON_bool fed = 1;
+
+    for (first = 0; first <= len; first++)
+    {
+        for (second = first; second <= len; second++)
+        {
+            if ((JsonTestSaxCut(text, len, first, second, expect) != 0) && (++failed <= CN_JSON_TEST_SHOWN))
+            {
+                (void)printf("%s cut at %zu and %zu\n", text, first, second);
+            }
+        }
+    }
+    TEST_CHECK(failed == 0, "%s: %u cuts", text, failed);
+
+    events.length = 0;
+    events.text[0] = '\0';
+    cJSON_SaxInit(&sax, &gJsonTestSaxEvents, &events, token, sizeof(token));
+    for (i = 0; (i < len) && fed; i++)
+    {
+        fed = cJSON_SaxFeed(&sax, text + i, 1);
+    }
+    TEST_CHECK(fed && cJSON_SaxFinish(&sax) && (strcmp(events.text, expect) == 0), "%s a byte at a time: %s", text,
+        events.text);
+}
+
+///< every cut short of the whole text feeds and fails at the finish
+static hi_void JsonTestSaxShort(const char *text)
+{
+    char token[CN_JSON_TEST_TOKENSIZE];
+    JsonTestEvents_t events;
+    cJSON_Sax sax;
+    size_t len;
+    hi_u32 failed = 0;
+
+    for (len = 0; len < strlen(text); len++)
+    {
+        events.length = 0;
+        cJSON_SaxInit(&sax, &gJsonTestSaxEvents, &events, token, sizeof(token));
+        if ((!cJSON_SaxFeed(&sax, text, len) || cJSON_SaxFinish(&sax)) && (++failed <= CN_JSON_TEST_SHOWN))
+        {
+            (void)printf("%s cut to %zu\n", text, len);
+        }
+    }
+    TEST_CHECK(failed == 0, "%s: %u cuts short not failed at the finish", text, failed);
+}
+
+static hi_void TestSax(hi_void)
+{
+    char token[CN_JSON_TEST_TOKENSIZE];
+    JsonTestEvents_t events;
+    cJSON_Sax sax;
+
+    TEST_CHECK(JsonTestSaxCut(gJsonTestNested, strlen(gJsonTestNested), 0, 0, gJsonTestNestedEvents) == 0,
+        "the nested events");
+    JsonTestSaxCuts(gJsonTestNested, gJsonTestNestedEvents);
+    JsonTestSaxCuts(" -12.5e-3 ", "n:-0.012500000000000001|");
+    JsonTestSaxCuts("-12.5E+3", "n:-12500|");
+    JsonTestSaxCuts("\"\\uD834\\uDD1E\\\\\\\"\"", "s:\xf0\x9d\x84\x9e\\\"|");
+    JsonTestSaxCuts("[true,false,null]", "[|t|f|z|]|");
+
+    JsonTestSaxShort(gJsonTestNested);
+    JsonTestSaxShort("\"a\\u00e9\"");
+    JsonTestSaxShort("true");
+    JsonTestSaxShort("null");
+
+    events.length = 0;
+    ///< a number ends at the finish only if it is whole
+    cJSON_SaxInit(&sax, &gJsonTestSaxEvents, &events, token, sizeof(token));
+    TEST_CHECK(cJSON_SaxFeed(&sax, "1e", 2) && !cJSON_SaxFinish(&sax), "1e at the finish");
+    cJSON_SaxInit(&sax, &gJsonTestSaxEvents, &events, token, sizeof(token));
+    TEST_CHECK(cJSON_SaxFeed(&sax, "-", 1) && !cJSON_SaxFinish(&sax), "- at the finish");
+    cJSON_SaxInit(&sax, &gJsonTestSaxEvents, &events, token, sizeof(token));
+    TEST_CHECK(!cJSON_SaxFeed(&sax, "[1}", 3), "[1} fed");
+    cJSON_SaxInit(&sax, &gJsonTestSaxEvents, &events, token, sizeof(token));
+    TEST_CHECK(!cJSON_SaxFeed(&sax, "tru", 3) || !cJSON_SaxFeed(&sax, "x", 1), "trux fed");
+}
+
+typedef struct
+{
+    char text[CN_JSON_TEST_WRITTENSIZE];
+    size_t length;
+    hi_u32 calls;
+    hi_u32 failAt; ///< the call which fails, 0 for none
+    hi_bool afterFail; ///< called again after it failed
+    hi_bool badChunk; ///< an empty chunk or one longer than the buffer takes
+} JsonTestWritten_t;
+
+static cJSON_bool JsonTestWrite(void *context, const char *chunk, size_t length)
+{
+    JsonTestWritten_t *written = (JsonTestWritten_t *)context;
+
+    if ((written->failAt != 0) && (written->calls >= written->failAt))
+    {
+        written->afterFail = HI_TRUE;
+    }
+    written->calls++;
+    if ((length == 0) || (length >= CN_JSON_TEST_WRITERSIZE))
+    {
+        written->badChunk = HI_TRUE;
+    }
+    if ((written->calls == written->failAt) || (length > sizeof(written->text) - written->length - 1))
+    {
+        return 0;
+    }
+    (void)memcpy(written->text + written->length, chunk, length);
+    written->length += length;
+    written->text[written->length] = '\0';
+    return 1;
+}
+
+///< print through the writer, failing at the failAt call, 0 if it comes out as cJSON prints it
+static int JsonTestWriteOne(const cJSON *item, hi_bool format, hi_u32 failAt, hi_u32 *calls)
+{
+    char buf[CN_JSON_TEST_WRITERSIZE];
+    JsonTestWritten_t written;
+    HostAllocStat_t heap;
+    hi_u64 allocs;
+    hi_u64 frees;
+    char *expect;
+    cJSON_bool ret;
+    int same;
+
+    (void)memset(&written, 0, sizeof(written));
+    written.failAt = failAt;
+    HostAllocGetStat(&heap);
+    ret = cJSON_PrintToWriter(item, buf, sizeof(buf), format, JsonTestWrite, &written);
+    JsonTestHeapDelta(&heap, &allocs, &frees);
+    *calls = written.calls;
+    if ((allocs != 0) || (frees != 0) || written.badChunk || written.afterFail)
+    {
+        return -1;
+    }
+    if (failAt != 0)
+    {
+        return (!ret && (written.calls == failAt)) ? 0 : -1;
+    }
+
+    expect = format ? cJSON_Print(item) : cJSON_PrintUnformatted(item);
+    same = ret && (expect != NULL) && (strcmp(written.text, expect) == 0) && (written.length == strlen(expect));
+    cJSON_free(expect);
+    return same ? 0 : -1;
+}
+
+///< an array of strings, the text of which is around every multiple of the chunk, and each one failing
+static hi_void TestWriter(hi_void)
+{
+    static char str[CN_JSON_TEST_WRITERSIZE * CN_JSON_TEST_WRITERCHUNKS];
+    const size_t chunk = CN_JSON_TEST_WRITERSIZE - 1;
+    cJSON *root = cJSON_CreateArray();
+    cJSON *item = cJSON_CreateStringReference(str);
+    cJSON *obj = cJSON_CreateObject();
+    char *text;
+    size_t len;
+    size_t textLen;
+    hi_u32 calls;
+    hi_u32 failAt;
+    hi_u32 multiples = 0;
+    hi_u32 failed = 0;
+    hi_u32 stopped = 0;
+    hi_u32 fails = 0;
+    hi_bool format;
+
+    cJSON_AddItemToArray(root, cJSON_CreateString(""));
+    cJSON_AddItemToArray(root, obj);
+    (void)cJSON_AddNumberToObject(obj, "speed", 50);
+    (void)cJSON_AddStringToObject(obj, "light", "RED\n");
+    for (len = 0; len < sizeof(str); len++)
+    {
+        (void)memset(str, (len % 7 == 3) ? '"' : 'a', len);
+        str[len] = '\0';
+        cJSON_ReplaceItemInArray(root, 0, cJSON_CreateString(str));
+        for (format = HI_FALSE; format <= HI_TRUE; format++)
+        {
+            text = format ? cJSON_Print(root) : cJSON_PrintUnformatted(root);
+            textLen = (text != NULL) ? strlen(text) : 0;
+            cJSON_free(text);
+            multiples += ((textLen % chunk) == 0);
+            if ((JsonTestWriteOne(root, format, 0, &calls) != 0) || (calls < (textLen + chunk - 1) / chunk))
+            {
+                if (++failed <= CN_JSON_TEST_SHOWN)
+                {
+                    (void)printf("string of %zu, format %d, %zu bytes in %u calls\n", len, format, textLen, calls);
+                }
+                continue;
+            }
+            for (failAt = 1; failAt <= calls; failAt++)
+            {
+                fails++;
+                stopped += (JsonTestWriteOne(root, format, failAt, &calls) == 0);
+            }
+        }
+    }
+    TEST_CHECK(failed == 0, "%u texts not written as printed", failed);
+    TEST_CHECK(multiples >= CN_JSON_TEST_WRITERCHUNKS, "only %u texts a multiple of the chunk", multiples);
+    TEST_CHECK(stopped == fails, "%u of %u failing writes stopped the print at once", stopped, fails);
+
+    ///< a text of exactly one and two chunks, the last chunk full and no empty call after it
+    (void)memset(str, 'a', chunk - 2);
+    str[chunk - 2] = '\0';
+    TEST_CHECK((JsonTestWriteOne(item, HI_FALSE, 0, &calls) == 0) && (calls == 1), "one chunk in %u calls", calls);
+    (void)memset(str, 'a', 2 * chunk - 2);
+    str[2 * chunk - 2] = '\0';
+    TEST_CHECK((JsonTestWriteOne(item, HI_FALSE, 0, &calls) == 0) && (calls == 2), "two chunks in %u calls", calls);
+    TEST_CHECK(!cJSON_PrintToWriter(root, str, CN_JSON_TEST_WRITERSIZE - 1, 0, JsonTestWrite, NULL),
+        "a buffer too small");
+    cJSON_Delete(item);
+    cJSON_Delete(root);
+}
+
+int main(void)
+{
+    (void)printf("scan=%s\n", CN_JSON_TEST_SCAN);
+    TestScan();
+    TestArenaExhaust();
+    TestArenaReuse();
+    TestArenaChunks();
+    TestArenaInPlace();
+    TestSax();
+    TestWriter();
+    (void)printf("%d checks, %d failed\n", gTestChecks, gTestFails);
+    return (gTestFails == 0) ? 0 : 1;
+}
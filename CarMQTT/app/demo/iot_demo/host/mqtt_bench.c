@@ -0,0 +1,648 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, publish rate, round trip and connect time of paho against the stand-in broker
+ * Author: HiSpark Product Team.
+ * Create: 2020-8-3
+ */
+
+/**
+ * paho alone, without the demo, against the stand-in broker of mqtt_standin.c, built with
+ * MQTTClient (mqtt_bench) and with MQTTAsync (mqtt_bench_async, CONFIG_MQTT_ASYNC):
+ *
+ * pub: -n publishes at qos 0, 1 and 2 with at most -w of them not completed. A qos 1 or 2 publish
+ *      completes when its PUBACK or PUBCOMP is back, a qos 0 one when the broker has it.
+ * rtt: -r publishes one after the other, each echoed back by the broker at the same qos, 2 is
+ *      echoed at 1 as the stand-in sends no qos 2. The time is from the publish call to the echo
+ *      in the message callback, with the percentiles and a histogram of power of two buckets,
+ *      "16:x" the samples under 16us.
+ * connect: -c connects with a clean session and disconnects, over TCP and TLS.
+ * reconnect: -c drops of the connection by the broker and connects with the session kept, from
+ *      the drop to the connect done, over TCP and TLS.
+ *
+ * TLS is mbedtls with the test certificate of the library on the broker, the device does not
+ * verify it. The sessions are MQTT 3.1.1.
+ *
+ * One "name key=value ..." line per result, the exit code is not 0 if a publish, an echo or a
+ * connect got lost.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <hi_types_base.h>
+#include <hi_time.h>
+#ifdef CONFIG_MQTT_ASYNC
+#include "MQTTAsync.h"
+#else
+#include "MQTTClient.h"
+#endif
+#include "host.h"
+#include "mqtt_standin.h"
+
+#ifndef HOST_MQTT_PORT
+#define HOST_MQTT_PORT 18830
+#endif
+#define CN_MQTT_BENCH_PUB_NUM 20000
+#define CN_MQTT_BENCH_RTT_NUM 500
+#define CN_MQTT_BENCH_CONNECT_NUM 50
+#define CN_MQTT_BENCH_WINDOW 64
+#define CN_MQTT_BENCH_INFLIGHT 65535  ///< MQTTClient yields 200ms when the window is full, the bench has its own
+#define CN_MQTT_BENCH_WAIT_MS 10000
+#define CN_MQTT_BENCH_HIST_MIN_US 16
+#define CN_MQTT_BENCH_HIST_NUM 17     ///< 16us to 1s, the last one takes the rest
+#define CN_MQTT_BENCH_URI_LEN 64
+#define CN_MQTT_BENCH_PAYLOAD_LEN 32
+#define CN_MQTT_BENCH_CLIENTID "mqtt_bench"
+#define CN_MQTT_BENCH_PUB_TOPIC "$oc/devices/5f0c2f1a_car/sys/properties/report"
+#define CN_MQTT_BENCH_PUB_PAYLOAD "{\"services\":[{\"service_id\":\"CarStatus\",\"properties\":{\"speed\":50}}]}"
+#define CN_MQTT_BENCH_RTT_TOPIC "bench/rtt/" ///< and the qos
+#define CN_MQTT_BENCH_ECHO_TOPIC "bench/echo"
+
+#ifdef CONFIG_MQTT_ASYNC
+#define CN_MQTT_BENCH_CLIENT "async"
+typedef MQTTAsync MqttBenchClient_t;
+#else
+#define CN_MQTT_BENCH_CLIENT "sync"
+typedef MQTTClient MqttBenchClient_t;
+#endif
+
+static struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    MqttBenchClient_t client;
+    hi_bool tls;
+    hi_u32 connectCnt;   ///< the callbacks, each counts up from the start
+    hi_u32 lostCnt;
+    hi_u32 doneCnt;      ///< the completed publishes, subscribes and disconnects
+    hi_u32 failCnt;
+    hi_u32 echoCnt;
+    hi_u32 echoSeq;      ///< the payload of the last echo
+    hi_u32 pubNum;
+    hi_u32 rttNum;
+    hi_u32 connectNum;
+    hi_u32 window;
+    hi_u64 *samples;
+} gMqttBench = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+static hi_void MqttBenchCount(hi_u32 *counter)
+{
+    (void)pthread_mutex_lock(&gMqttBench.lock);
+    (*counter)++;
+    (void)pthread_cond_broadcast(&gMqttBench.cond);
+    (void)pthread_mutex_unlock(&gMqttBench.lock);
+}
+
+///< wait until the counter is at least the target, or a failure came
+static int MqttBenchWait(const hi_u32 *counter, hi_u32 target)
+{
+    struct timespec deadline;
+    hi_u32 failCnt;
+    int ret = 0;
+
+    (void)clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += CN_MQTT_BENCH_WAIT_MS / 1000;
+    (void)pthread_mutex_lock(&gMqttBench.lock);
+    failCnt = gMqttBench.failCnt;
+    while ((*counter < target) && (ret == 0))
+    {
+        if (failCnt != gMqttBench.failCnt)
+        {
+            ret = -1;
+        }
+        else if (ETIMEDOUT == pthread_cond_timedwait(&gMqttBench.cond, &gMqttBench.lock, &deadline))
+        {
+            ret = (*counter < target) ? -1 : 0;
+        }
+    }
+    (void)pthread_mutex_unlock(&gMqttBench.lock);
+    return ret;
+}
+
+static hi_u32 MqttBenchGet(const hi_u32 *counter)
+{
+    hi_u32 val;
+
+    (void)pthread_mutex_lock(&gMqttBench.lock);
+    val = *counter;
+    (void)pthread_mutex_unlock(&gMqttBench.lock);
+    return val;
+}
+
+///< the broker echoes bench/rtt/<qos> to bench/echo, in its thread
+static hi_void MqttBenchEcho(const char *topic, hi_u32 topicLen, const char *payload, hi_u32 payloadLen)
+{
+    char buf[CN_MQTT_BENCH_PAYLOAD_LEN];
+    int qos;
+
+    if ((topicLen != strlen(CN_MQTT_BENCH_RTT_TOPIC) + 1) ||
+        (0 != memcmp(topic, CN_MQTT_BENCH_RTT_TOPIC, strlen(CN_MQTT_BENCH_RTT_TOPIC))) ||
+        (payloadLen >= sizeof(buf)))
+    {
+        return;
+    }
+    qos = topic[topicLen - 1] - '0';
+    (void)memcpy(buf, payload, payloadLen);
+    buf[payloadLen] = '\0';
+    (void)MqttStandinPublish(CN_MQTT_BENCH_ECHO_TOPIC, buf, (qos > 1) ? 1 : qos);
+    return;
+}
+
+static void MqttBenchConnectionLost(void *context, char *cause)
+{
+    (void)context;
+    (void)cause;
+    MqttBenchCount(&gMqttBench.lostCnt);
+}
+
+static int MqttBenchMessageArrived(void *context, char *topicName, int topicLen, void *payload, int payloadLen)
+{
+    char buf[CN_MQTT_BENCH_PAYLOAD_LEN];
+
+    (void)context;
+    (void)topicLen;
+    if ((0 == strcmp(topicName, CN_MQTT_BENCH_ECHO_TOPIC)) && (payloadLen < (int)sizeof(buf)))
+    {
+        (void)memcpy(buf, payload, (size_t)payloadLen);
+        buf[payloadLen] = '\0';
+        (void)pthread_mutex_lock(&gMqttBench.lock);
+        gMqttBench.echoSeq = (hi_u32)strtoul(buf, NULL, 0);
+        gMqttBench.echoCnt++;
+        (void)pthread_cond_broadcast(&gMqttBench.cond);
+        (void)pthread_mutex_unlock(&gMqttBench.lock);
+    }
+    return 1;
+}
+
+#ifdef CONFIG_MQTT_ASYNC
+static void MqttBenchOnConnect(void *context, MQTTAsync_successData *response)
+{
+    (void)context;
+    (void)response;
+    MqttBenchCount(&gMqttBench.connectCnt);
+}
+
+static void MqttBenchOnSuccess(void *context, MQTTAsync_successData *response)
+{
+    (void)context;
+    (void)response;
+    MqttBenchCount(&gMqttBench.doneCnt);
+}
+
+static void MqttBenchOnFailure(void *context, MQTTAsync_failureData *response)
+{
+    (void)context;
+    (void)response;
+    MqttBenchCount(&gMqttBench.failCnt);
+}
+
+static int MqttBenchOnMessage(void *context, char *topicName, int topicLen, MQTTAsync_message *message)
+{
+    (void)MqttBenchMessageArrived(context, topicName, topicLen, message->payload, message->payloadlen);
+    MQTTAsync_freeMessage(&message);
+    MQTTAsync_free(topicName);
+    return 1;
+}
+
+static int MqttBenchCreate(hi_bool tls)
+{
+    char uri[CN_MQTT_BENCH_URI_LEN];
+
+    (void)snprintf(uri, sizeof(uri), "%s://127.0.0.1:%u", tls ? "ssl" : "tcp", (unsigned)HOST_MQTT_PORT);
+    if (MQTTASYNC_SUCCESS != MQTTAsync_create(&gMqttBench.client, uri, CN_MQTT_BENCH_CLIENTID,
+        MQTTCLIENT_PERSISTENCE_NONE, NULL))
+    {
+        return -1;
+    }
+    gMqttBench.tls = tls;
+    return (MQTTASYNC_SUCCESS == MQTTAsync_setCallbacks(gMqttBench.client, NULL, MqttBenchConnectionLost,
+        MqttBenchOnMessage, NULL)) ? 0 : -1;
+}
+
+static hi_void MqttBenchDestroy(hi_void)
+{
+    MQTTAsync_destroy(&gMqttBench.client);
+}
+
+static int MqttBenchConnect(int clean)
+{
+    MQTTAsync_connectOptions options = MQTTAsync_connectOptions_initializer;
+    MQTTAsync_SSLOptions ssl = MQTTAsync_SSLOptions_initializer;
+    hi_u32 connectCnt = MqttBenchGet(&gMqttBench.connectCnt);
+
+    options.keepAliveInterval = 60;
+    options.cleansession = clean;
+    options.maxInflight = CN_MQTT_BENCH_INFLIGHT;
+    options.onSuccess = MqttBenchOnConnect;
+    options.onFailure = MqttBenchOnFailure;
+    ssl.enableServerCertAuth = 0;
+    ssl.verify = 0;
+    options.ssl = gMqttBench.tls ? &ssl : NULL;
+    if (MQTTASYNC_SUCCESS != MQTTAsync_connect(gMqttBench.client, &options))
+    {
+        return -1;
+    }
+    return MqttBenchWait(&gMqttBench.connectCnt, connectCnt + 1);
+}
+
+static int MqttBenchDisconnect(hi_void)
+{
+    MQTTAsync_disconnectOptions options = MQTTAsync_disconnectOptions_initializer;
+    hi_u32 doneCnt = MqttBenchGet(&gMqttBench.doneCnt);
+
+    options.onSuccess = MqttBenchOnSuccess;
+    options.onFailure = MqttBenchOnFailure;
+    if (MQTTASYNC_SUCCESS != MQTTAsync_disconnect(gMqttBench.client, &options))
+    {
+        return -1;
+    }
+    return MqttBenchWait(&gMqttBench.doneCnt, doneCnt + 1);
+}
+
+static int MqttBenchSubscribe(const char *topic, int qos)
+{
+    MQTTAsync_responseOptions options = MQTTAsync_responseOptions_initializer;
+    hi_u32 doneCnt = MqttBenchGet(&gMqttBench.doneCnt);
+
+    options.onSuccess = MqttBenchOnSuccess;
+    options.onFailure = MqttBenchOnFailure;
+    if (MQTTASYNC_SUCCESS != MQTTAsync_subscribe(gMqttBench.client, topic, qos, &options))
+    {
+        return -1;
+    }
+    return MqttBenchWait(&gMqttBench.doneCnt, doneCnt + 1);
+}
+
+///< the completion of a qos 1 or 2 publish counts in doneCnt, that of qos 0 does not
+static int MqttBenchPublish(const char *topic, const char *payload, int qos)
+{
+    MQTTAsync_responseOptions options = MQTTAsync_responseOptions_initializer;
+
+    options.onSuccess = (qos > 0) ? MqttBenchOnSuccess : NULL;
+    options.onFailure = MqttBenchOnFailure;
+    return (MQTTASYNC_SUCCESS == MQTTAsync_send(gMqttBench.client, topic, (int)strlen(payload), payload, qos, 0,
+        &options)) ? 0 : -1;
+}
+#else
+static int MqttBenchOnMessage(void *context, char *topicName, int topicLen, MQTTClient_message *message)
+{
+    (void)MqttBenchMessageArrived(context, topicName, topicLen, message->payload, message->payloadlen);
+    MQTTClient_freeMessage(&message);
+    MQTTClient_free(topicName);
+    return 1;
+}
+
+static void MqttBenchDeliveryComplete(void *context, MQTTClient_deliveryToken dt)
+{
+    (void)context;
+    (void)dt;
+    MqttBenchCount(&gMqttBench.doneCnt);
+}
+
+static int MqttBenchCreate(hi_bool tls)
+{
+    char uri[CN_MQTT_BENCH_URI_LEN];
+
+    (void)snprintf(uri, sizeof(uri), "%s://127.0.0.1:%u", tls ? "ssl" : "tcp", (unsigned)HOST_MQTT_PORT);
+    if (MQTTCLIENT_SUCCESS != MQTTClient_create(&gMqttBench.client, uri, CN_MQTT_BENCH_CLIENTID,
+        MQTTCLIENT_PERSISTENCE_NONE, NULL))
+    {
+        return -1;
+    }
+    gMqttBench.tls = tls;
+    return (MQTTCLIENT_SUCCESS == MQTTClient_setCallbacks(gMqttBench.client, NULL, MqttBenchConnectionLost,
+        MqttBenchOnMessage, MqttBenchDeliveryComplete)) ? 0 : -1;
+}
+
+static hi_void MqttBenchDestroy(hi_void)
+{
+    MQTTClient_destroy(&gMqttBench.client);
+}
+
+static int MqttBenchConnect(int clean)
+{
+    MQTTClient_connectOptions options = MQTTClient_connectOptions_initializer;
+    MQTTClient_SSLOptions ssl = MQTTClient_SSLOptions_initializer;
+
+    options.keepAliveInterval = 60;
+    options.cleansession = clean;
+    options.maxInflightMessages = CN_MQTT_BENCH_INFLIGHT;
+    ssl.enableServerCertAuth = 0;
+    ssl.verify = 0;
+    options.ssl = gMqttBench.tls ? &ssl : NULL;
+    if (MQTTCLIENT_SUCCESS != MQTTClient_connect(gMqttBench.client, &options))
+    {
+        return -1;
+    }
+    MqttBenchCount(&gMqttBench.connectCnt);
+    return 0;
+}
+
+static int MqttBenchDisconnect(hi_void)
+{
+    return (MQTTCLIENT_SUCCESS == MQTTClient_disconnect(gMqttBench.client, 0)) ? 0 : -1;
+}
+
+static int MqttBenchSubscribe(const char *topic, int qos)
+{
+    return (MQTTCLIENT_SUCCESS == MQTTClient_subscribe(gMqttBench.client, topic, qos)) ? 0 : -1;
+}
+
+///< the completion of a qos 1 or 2 publish counts in doneCnt, that of qos 0 does not
+static int MqttBenchPublish(const char *topic, const char *payload, int qos)
+{
+    return (MQTTCLIENT_SUCCESS == MQTTClient_publish(gMqttBench.client, topic, (int)strlen(payload), payload, qos, 0,
+        NULL)) ? 0 : -1;
+}
+#endif
+
+static int MqttBenchPub(int qos)
+{
+    MqttStandinStat_t stat;
+    hi_u64 startUs;
+    hi_u64 costUs;
+    hi_u64 writev;
+    hi_u32 doneCnt = MqttBenchGet(&gMqttBench.doneCnt);
+    hi_u32 i;
+    int ret = 0;
+
+    MqttStandinGetStat(&stat);
+    writev = HostWritevGetCount();
+    startUs = hi_get_us();
+    for (i = 0; (i < gMqttBench.pubNum) && (ret == 0); i++)
+    {
+        if ((qos > 0) && (i >= gMqttBench.window))
+        {
+            ret = MqttBenchWait(&gMqttBench.doneCnt, doneCnt + i + 1 - gMqttBench.window);
+        }
+        if (ret == 0)
+        {
+            ret = MqttBenchPublish(CN_MQTT_BENCH_PUB_TOPIC, CN_MQTT_BENCH_PUB_PAYLOAD, qos);
+        }
+    }
+    if (ret == 0)
+    {
+        ret = (qos > 0) ? MqttBenchWait(&gMqttBench.doneCnt, doneCnt + gMqttBench.pubNum) :
+            MqttStandinWaitPublish(stat.publishCnt + gMqttBench.pubNum, CN_MQTT_BENCH_WAIT_MS);
+    }
+    costUs = hi_get_us() - startUs;
+    writev = HostWritevGetCount() - writev;
+
+    if (ret != 0)
+    {
+        (void)printf("mqtt.pub.qos%d client=%s failed=1 sent=%u\n", qos, CN_MQTT_BENCH_CLIENT, i);
+        return -1;
+    }
+    (void)printf("mqtt.pub.qos%d client=%s msgs=%u window=%u msgs_per_s=%.0f writev_per_msg=%.2f\n", qos,
+        CN_MQTT_BENCH_CLIENT, gMqttBench.pubNum, (qos > 0) ? gMqttBench.window : 0,
+        (costUs > 0) ? (double)gMqttBench.pubNum * 1000000 / costUs : 0.0, (double)writev / gMqttBench.pubNum);
+    return 0;
+}
+
+static int MqttBenchCompare(const void *a, const void *b)
+{
+    hi_u64 x = *(const hi_u64 *)a;
+    hi_u64 y = *(const hi_u64 *)b;
+
+    return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+///< the samples sorted, with the percentiles and the histogram after the name
+static hi_void MqttBenchPrintTimes(const char *name, hi_u64 *samples, hi_u32 num)
+{
+    hi_u32 hist[CN_MQTT_BENCH_HIST_NUM] = {0};
+    char buf[CN_MQTT_BENCH_HIST_NUM * 16];
+    hi_u64 sum = 0;
+    hi_u32 last = 0;
+    hi_u32 len = 0;
+    hi_u32 i;
+    hi_u32 k;
+
+    qsort(samples, num, sizeof(samples[0]), MqttBenchCompare);
+    for (i = 0; i < num; i++)
+    {
+        sum += samples[i];
+        for (k = 0; (k < CN_MQTT_BENCH_HIST_NUM - 1) && (samples[i] >= ((hi_u64)CN_MQTT_BENCH_HIST_MIN_US << k)); k++)
+        {
+        }
+        hist[k]++;
+        last = (k > last) ? k : last;
+    }
+    buf[0] = '\0';
+    for (k = 0; k <= last; k++)
+    {
+        len += (hi_u32)snprintf(buf + len, sizeof(buf) - len, "%s%u:%u", (k == 0) ? "" : ",",
+            CN_MQTT_BENCH_HIST_MIN_US << k, hist[k]);
+    }
+    (void)printf("%s n=%u avg_us=%.1f p50_us=%llu p90_us=%llu p99_us=%llu max_us=%llu hist_us=%s\n", name, num,
+        (double)sum / num, (unsigned long long)samples[num * 50 / 100], (unsigned long long)samples[num * 90 / 100],
+        (unsigned long long)samples[num * 99 / 100], (unsigned long long)samples[num - 1], buf);
+    return;
+}
+
+static int MqttBenchRtt(int qos)
+{
+    char topic[CN_MQTT_BENCH_URI_LEN];
+    char payload[CN_MQTT_BENCH_PAYLOAD_LEN];
+    char name[CN_MQTT_BENCH_URI_LEN];
+    hi_u32 echoCnt = MqttBenchGet(&gMqttBench.echoCnt);
+    hi_u32 doneCnt = MqttBenchGet(&gMqttBench.doneCnt);
+    hi_u64 startUs;
+    hi_u32 i;
+
+    (void)snprintf(topic, sizeof(topic), "%s%d", CN_MQTT_BENCH_RTT_TOPIC, qos);
+    for (i = 0; i < gMqttBench.rttNum; i++)
+    {
+        (void)snprintf(payload, sizeof(payload), "%u", i);
+        startUs = hi_get_us();
+        if ((0 != MqttBenchPublish(topic, payload, qos)) || (0 != MqttBenchWait(&gMqttBench.echoCnt, echoCnt + i + 1)))
+        {
+            break;
+        }
+        gMqttBench.samples[i] = hi_get_us() - startUs;
+        if (MqttBenchGet(&gMqttBench.echoSeq) != i)
+        {
+            break;
+        }
+        ///< the publish completes too before the next one, so that they do not overlap
+        if ((qos > 0) && (0 != MqttBenchWait(&gMqttBench.doneCnt, doneCnt + i + 1)))
+        {
+            break;
+        }
+    }
+    if (i < gMqttBench.rttNum)
+    {
+        (void)printf("mqtt.rtt.qos%d client=%s failed=1 echoed=%u\n", qos, CN_MQTT_BENCH_CLIENT, i);
+        return -1;
+    }
+    (void)snprintf(name, sizeof(name), "mqtt.rtt.qos%d client=%s", qos, CN_MQTT_BENCH_CLIENT);
+    MqttBenchPrintTimes(name, gMqttBench.samples, gMqttBench.rttNum);
+    return 0;
+}
+
+static int MqttBenchConnectTime(hi_bool tls)
+{
+    char name[CN_MQTT_BENCH_URI_LEN];
+    hi_u64 startUs;
+    hi_u32 i;
+
+    if ((0 != MqttStandinSetTls(tls)) || (0 != MqttBenchCreate(tls)))
+    {
+        (void)printf("mqtt.connect client=%s tls=%d failed=create\n", CN_MQTT_BENCH_CLIENT, tls);
+        return -1;
+    }
+    for (i = 0; i < gMqttBench.connectNum; i++)
+    {
+        startUs = hi_get_us();
+        if (0 != MqttBenchConnect(1))
+        {
+            break;
+        }
+        gMqttBench.samples[i] = hi_get_us() - startUs;
+        if (0 != MqttBenchDisconnect())
+        {
+            break;
+        }
+    }
+    MqttBenchDestroy();
+    if (i < gMqttBench.connectNum)
+    {
+        (void)printf("mqtt.connect client=%s tls=%d failed=1 connected=%u\n", CN_MQTT_BENCH_CLIENT, tls, i);
+        return -1;
+    }
+    (void)snprintf(name, sizeof(name), "mqtt.connect client=%s tls=%d", CN_MQTT_BENCH_CLIENT, tls);
+    MqttBenchPrintTimes(name, gMqttBench.samples, gMqttBench.connectNum);
+    return 0;
+}
+
+static int MqttBenchReconnectTime(hi_bool tls)
+{
+    char name[CN_MQTT_BENCH_URI_LEN];
+    hi_u64 startUs;
+    hi_u32 lostCnt;
+    hi_u32 i;
+
+    if ((0 != MqttStandinSetTls(tls)) || (0 != MqttBenchCreate(tls)) || (0 != MqttBenchConnect(0)) ||
+        (0 != MqttBenchSubscribe(CN_MQTT_BENCH_ECHO_TOPIC, 1)))
+    {
+        (void)printf("mqtt.reconnect client=%s tls=%d failed=connect\n", CN_MQTT_BENCH_CLIENT, tls);
+        return -1;
+    }
+    for (i = 0; i < gMqttBench.connectNum; i++)
+    {
+        lostCnt = MqttBenchGet(&gMqttBench.lostCnt);
+        startUs = hi_get_us();
+        MqttStandinDrop();
+        if ((0 != MqttBenchWait(&gMqttBench.lostCnt, lostCnt + 1)) || (0 != MqttBenchConnect(0)))
+        {
+            break;
+        }
+        gMqttBench.samples[i] = hi_get_us() - startUs;
+    }
+    if (i == gMqttBench.connectNum)
+    {
+        (void)MqttBenchDisconnect();
+    }
+    MqttBenchDestroy();
+    if (i < gMqttBench.connectNum)
+    {
+        (void)printf("mqtt.reconnect client=%s tls=%d failed=1 reconnected=%u\n", CN_MQTT_BENCH_CLIENT, tls, i);
+        return -1;
+    }
+    (void)snprintf(name, sizeof(name), "mqtt.reconnect client=%s tls=%d", CN_MQTT_BENCH_CLIENT, tls);
+    MqttBenchPrintTimes(name, gMqttBench.samples, gMqttBench.connectNum);
+    return 0;
+}
+
+static int MqttBenchTraffic(hi_void)
+{
+    int qos;
+    int ret = 0;
+
+    if ((0 != MqttBenchCreate(HI_FALSE)) || (0 != MqttBenchConnect(1)) ||
+        (0 != MqttBenchSubscribe(CN_MQTT_BENCH_ECHO_TOPIC, 1)) || (0 != MqttStandinWaitReady(CN_MQTT_BENCH_WAIT_MS)))
+    {
+        (void)printf("mqtt client=%s failed=connect\n", CN_MQTT_BENCH_CLIENT);
+        return -1;
+    }
+    for (qos = 0; qos <= 2; qos++)
+    {
+        ret |= MqttBenchPub(qos);
+    }
+    for (qos = 0; qos <= 2; qos++)
+    {
+        ret |= MqttBenchRtt(qos);
+    }
+    (void)MqttBenchDisconnect();
+    MqttBenchDestroy();
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    hi_u32 num;
+    int opt;
+    int ret = 0;
+
+    gMqttBench.pubNum = CN_MQTT_BENCH_PUB_NUM;
+    gMqttBench.rttNum = CN_MQTT_BENCH_RTT_NUM;
+    gMqttBench.connectNum = CN_MQTT_BENCH_CONNECT_NUM;
+    gMqttBench.window = CN_MQTT_BENCH_WINDOW;
+    while ((opt = getopt(argc, argv, "n:r:c:w:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                gMqttBench.pubNum = (hi_u32)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                gMqttBench.rttNum = (hi_u32)strtoul(optarg, NULL, 0);
+                break;
+            case 'c':
+                gMqttBench.connectNum = (hi_u32)strtoul(optarg, NULL, 0);
+                break;
+            case 'w':
+                gMqttBench.window = (hi_u32)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                (void)fprintf(stderr, "usage: %s [-n publishes] [-r round trips] [-c connects] [-w window]\n",
+                    argv[0]);
+                return 2;
+        }
+    }
+    if ((gMqttBench.pubNum == 0) || (gMqttBench.rttNum == 0) || (gMqttBench.connectNum == 0) ||
+        (gMqttBench.window == 0))
+    {
+        (void)fprintf(stderr, "the numbers are 1 or more\n");
+        return 2;
+    }
+    num = (gMqttBench.rttNum > gMqttBench.connectNum) ? gMqttBench.rttNum : gMqttBench.connectNum;
+    if ((gMqttBench.samples = malloc(num * sizeof(hi_u64))) == NULL)
+    {
+        return 1;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    if (0 != MqttStandinStart(HOST_MQTT_PORT))
+    {
+        (void)printf("mqtt failed=listen port=%d\n", HOST_MQTT_PORT);
+        return 1;
+    }
+    MqttStandinSetHook(MqttBenchEcho);
+
+    ret |= MqttBenchTraffic();
+    ret |= MqttBenchConnectTime(HI_FALSE);
+    ret |= MqttBenchConnectTime(HI_TRUE);
+    ret |= MqttBenchReconnectTime(HI_FALSE);
+    ret |= MqttBenchReconnectTime(HI_TRUE);
+
+    MqttStandinSetHook(NULL);
+    MqttStandinStop();
+    free(gMqttBench.samples);
+    return (ret == 0) ? 0 : 1;
+}
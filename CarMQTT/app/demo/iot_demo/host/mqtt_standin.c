@@ -0,0 +1,977 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, a local MQTT 3.1.1 and 5 broker standing in for the IoT platform
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-10
+ */
+
+/**
+ * Only what the device side needs: connect with a kept session, subscribe, publish both ways
+ * at qos 0/1 (qos 2 from the device is acked too), ping and disconnect. There is no routing,
+ * the publishes from the device are counted and passed to the hook, and the test side injects
+ * the commands with MqttStandinPublish.
+ *
+ * An MQTT 5 client is offered the topic aliases of MqttStandinSetTopicAliasMax, the publishes
+ * with an alias are given to the hook with the topic of the alias. The other properties are
+ * skipped, none is sent.
+ *
+ * Built with HOST_MQTT_TLS, the connections are TLS after MqttStandinSetTls, with the mbedtls test
+ * certificate. One mbedtls context is not to be read and written by two threads, so over TLS only
+ * the hook publishes to the device.
+*/
+#include <pthread.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#ifdef HOST_MQTT_TLS
+#include <mbedtls/certs.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/ssl.h>
+#endif
+#include "mqtt_standin.h"
+
+#define CN_STANDIN_PACKET_SIZE 0x10000
+#define CN_STANDIN_CLIENTID_SIZE 128
+#define CN_STANDIN_POLL_MS 100
+#define CN_STANDIN_ALIASNUM 64    ///< the topic aliases taken at most
+#define CN_STANDIN_TOPIC_SIZE 256 ///< the longest topic an alias is kept for
+#define CN_STANDIN_ALIAS_MAX 16   ///< the topic alias maximum by default
+
+#define CN_MQTT_VERSION_5 5
+#define CN_MQTT_PROP_TOPIC_ALIAS_MAX 0x22
+#define CN_MQTT_PROP_TOPIC_ALIAS 0x23
+
+#define CN_MQTT_CONNECT 1
+#define CN_MQTT_CONNACK 2
+#define CN_MQTT_PUBLISH 3
+#define CN_MQTT_PUBACK 4
+#define CN_MQTT_PUBREC 5
+#define CN_MQTT_PUBREL 6
+#define CN_MQTT_PUBCOMP 7
+#define CN_MQTT_SUBSCRIBE 8
+#define CN_MQTT_SUBACK 9
+#define CN_MQTT_UNSUBSCRIBE 10
+#define CN_MQTT_UNSUBACK 11
+#define CN_MQTT_PINGREQ 12
+#define CN_MQTT_PINGRESP 13
+#define CN_MQTT_DISCONNECT 14
+
+typedef struct
+{
+    pthread_t thread;
+    pthread_mutex_t lock;     ///< the stat, the session and the client fd
+    pthread_cond_t cond;
+    pthread_mutex_t sendLock; ///< the broker thread and the injecting one both write
+    int listenFd;
+    int clientFd;
+    hi_bool stop;
+    hi_bool running;
+    hi_bool session;          ///< a session of sessionID is kept
+    char sessionID[CN_STANDIN_CLIENTID_SIZE];
+    hi_u32 subNum;            ///< topic filters of the kept session
+    hi_u16 msgID;
+    hi_u8 version;            ///< the protocol level of the connection
+    hi_u16 aliasMax;          ///< the topic alias maximum offered to the MQTT 5 clients
+    hi_u16 aliasOffered;      ///< that of the connection
+    hi_u16 aliasLen[CN_STANDIN_ALIASNUM + 1];  ///< the topics of the aliases of the connection, 0 not set
+    char alias[CN_STANDIN_ALIASNUM + 1][CN_STANDIN_TOPIC_SIZE];
+    fnMqttStandinHook hook;
+    MqttStandinStat_t stat;
+    hi_u8 packet[CN_STANDIN_PACKET_SIZE];
+#ifdef HOST_MQTT_TLS
+    hi_bool tls;              ///< the next connections are TLS
+    hi_bool tlsReady;         ///< the config below is set up
+    mbedtls_ssl_context *ssl; ///< of the connection, NULL for plain TCP
+    int sslFd;                ///< the fd the TLS records go on
+    mbedtls_ssl_context sslCtx;
+    mbedtls_ssl_config conf;
+    mbedtls_x509_crt crt;
+    mbedtls_pk_context key;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context drbg;
+#endif
+} MqttStandinCb_t;
+static MqttStandinCb_t gStandin = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .sendLock = PTHREAD_MUTEX_INITIALIZER,
+    .listenFd = -1,
+    .clientFd = -1,
+    .aliasMax = CN_STANDIN_ALIAS_MAX,
+};
+
+///< one send or recv on the connection, through TLS if it is; 0 when it is closed or broken
+static ssize_t StandinWrite(int fd, const hi_u8 *buf, hi_u32 len)
+{
+#ifdef HOST_MQTT_TLS
+    int ret;
+
+    if (gStandin.ssl != NULL)
+    {
+        ret = mbedtls_ssl_write(gStandin.ssl, buf, len);
+        if ((ret == MBEDTLS_ERR_SSL_WANT_READ) || (ret == MBEDTLS_ERR_SSL_WANT_WRITE))
+        {
+            errno = EINTR;
+            return -1;
+        }
+        return (ret < 0) ? 0 : ret;
+    }
+#endif
+    return send(fd, buf, len, MSG_NOSIGNAL);
+}
+
+static ssize_t StandinRead(int fd, hi_u8 *buf, hi_u32 len)
+{
+#ifdef HOST_MQTT_TLS
+    int ret;
+
+    if (gStandin.ssl != NULL)
+    {
+        ret = mbedtls_ssl_read(gStandin.ssl, buf, len);
+        if ((ret == MBEDTLS_ERR_SSL_WANT_READ) || (ret == MBEDTLS_ERR_SSL_WANT_WRITE))
+        {
+            errno = EINTR;
+            return -1;
+        }
+        return (ret < 0) ? 0 : ret;
+    }
+#endif
+    return recv(fd, buf, len, 0);
+}
+
+static int StandinSend(int fd, const hi_u8 *buf, hi_u32 len)
+{
+    ssize_t ret;
+
+    while (len > 0)
+    {
+        ret = StandinWrite(fd, buf, len);
+        if (ret <= 0)
+        {
+            if ((ret < 0) && (errno == EINTR))
+            {
+                continue;
+            }
+            return -1;
+        }
+        buf += ret;
+        len -= (hi_u32)ret;
+    }
+    return 0;
+}
+
+static int StandinRecv(int fd, hi_u8 *buf, hi_u32 len)
+{
+    ssize_t ret;
+
+    while (len > 0)
+    {
+        ret = StandinRead(fd, buf, len);
+        if (ret <= 0)
+        {
+            if ((ret < 0) && (errno == EINTR))
+            {
+                continue;
+            }
+            return -1;
+        }
+        buf += ret;
+        len -= (hi_u32)ret;
+    }
+    return 0;
+}
+
+static hi_u32 StandinPutLen(hi_u8 *buf, hi_u32 len)
+{
+    hi_u32 n = 0;
+
+    do
+    {
+        buf[n] = len % 128;
+        len /= 128;
+        if (len > 0)
+        {
+            buf[n] |= 0x80;
+        }
+        n++;
+    } while (len > 0);
+    return n;
+}
+
+///< the variable byte integer at pos, pos is moved past it; returns -1 if it runs over len
+static int StandinGetLen(const hi_u8 *pkt, hi_u32 len, hi_u32 *pos, hi_u32 *value)
+{
+    hi_u32 mul = 1;
+    int i;
+
+    *value = 0;
+    for (i = 0; i < 4; i++)
+    {
+        if (*pos >= len)
+        {
+            return -1;
+        }
+        *value += (pkt[*pos] & 0x7F) * mul;
+        mul *= 128;
+        if ((pkt[(*pos)++] & 0x80) == 0)
+        {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+///< read one packet into gStandin.packet, returns the remaining length or -1 when the connection is gone
+static int StandinReadPacket(int fd, hi_u8 *header)
+{
+    hi_u8 c;
+    hi_u32 len = 0;
+    hi_u32 mul = 1;
+    int i;
+
+    if (0 != StandinRecv(fd, header, 1))
+    {
+        return -1;
+    }
+    for (i = 0; i < 4; i++)
+    {
+        if (0 != StandinRecv(fd, &c, 1))
+        {
+            return -1;
+        }
+        len += (c & 0x7F) * mul;
+        mul *= 128;
+        if ((c & 0x80) == 0)
+        {
+            break;
+        }
+    }
+    if ((i == 4) || (len > CN_STANDIN_PACKET_SIZE))
+    {
+        return -1;
+    }
+    if (0 != StandinRecv(fd, gStandin.packet, len))
+    {
+        return -1;
+    }
+    return (int)len;
+}
+
+static int StandinSendAck(int fd, hi_u8 type, const hi_u8 *msgID)
+{
+    hi_u8 buf[4];
+    int ret;
+
+    buf[0] = (hi_u8)(type << 4) | ((type == CN_MQTT_PUBREL) ? 0x02 : 0x00);
+    buf[1] = 2;
+    buf[2] = msgID[0];
+    buf[3] = msgID[1];
+    (void)pthread_mutex_lock(&gStandin.sendLock);
+    ret = StandinSend(fd, buf, sizeof(buf));
+    (void)pthread_mutex_unlock(&gStandin.sendLock);
+    return ret;
+}
+
+static int StandinOnConnect(int fd, const hi_u8 *pkt, hi_u32 len)
+{
+    hi_u32 pos;
+    hi_u32 nameLen;
+    hi_u32 idLen;
+    hi_u8 flags;
+    hi_u32 propLen;
+    hi_bool present;
+    hi_u8 version;
+    hi_u8 ack[9] = {CN_MQTT_CONNACK << 4, 2, 0, 0};
+    hi_u32 ackLen = 4;
+    int ret;
+
+    if (len < 2)
+    {
+        return -1;
+    }
+    nameLen = ((hi_u32)pkt[0] << 8) | pkt[1];
+    pos = 2 + nameLen;
+    if (pos + 6 > len)
+    {
+        return -1;
+    }
+    version = pkt[pos];
+    flags = pkt[pos + 1];
+    pos += 4; ///< level, flags and keepalive
+    if (version >= CN_MQTT_VERSION_5)
+    {
+        if ((0 != StandinGetLen(pkt, len, &pos, &propLen)) || (pos + propLen + 2 > len))
+        {
+            return -1;
+        }
+        pos += propLen;
+    }
+    idLen = ((hi_u32)pkt[pos] << 8) | pkt[pos + 1];
+    pos += 2;
+    if ((pos + idLen > len) || (idLen >= CN_STANDIN_CLIENTID_SIZE))
+    {
+        return -1;
+    }
+
+    (void)pthread_mutex_lock(&gStandin.lock);
+    present = (0 == (flags & 0x02)) && gStandin.session && (strlen(gStandin.sessionID) == idLen) &&
+        (0 == memcmp(gStandin.sessionID, pkt + pos, idLen));
+    if (!present)
+    {
+        gStandin.subNum = 0;
+    }
+    gStandin.session = (0 == (flags & 0x02));
+    (void)memcpy(gStandin.sessionID, pkt + pos, idLen);
+    gStandin.sessionID[idLen] = '\0';
+    gStandin.stat.connectCnt++;
+    if (present)
+    {
+        gStandin.stat.sessionCnt++;
+    }
+    gStandin.clientFd = fd;
+    gStandin.version = version;
+    gStandin.aliasOffered = (version >= CN_MQTT_VERSION_5) ? gStandin.aliasMax : 0;
+    (void)memset(gStandin.aliasLen, 0, sizeof(gStandin.aliasLen));
+    (void)pthread_cond_broadcast(&gStandin.cond);
+    (void)pthread_mutex_unlock(&gStandin.lock);
+
+    ack[2] = present ? 1 : 0;
+    if ((version >= CN_MQTT_VERSION_5) && (gStandin.aliasOffered == 0))
+    {
+        ack[1] = 3;
+        ack[ackLen++] = 0; ///< no properties
+    }
+    else if (version >= CN_MQTT_VERSION_5)
+    {
+        ack[1] = 6;
+        ack[ackLen++] = 3;
+        ack[ackLen++] = CN_MQTT_PROP_TOPIC_ALIAS_MAX;
+        ack[ackLen++] = (hi_u8)(gStandin.aliasOffered >> 8);
+        ack[ackLen++] = (hi_u8)gStandin.aliasOffered;
+    }
+    (void)pthread_mutex_lock(&gStandin.sendLock);
+    ret = StandinSend(fd, ack, ackLen);
+    (void)pthread_mutex_unlock(&gStandin.sendLock);
+    return ret;
+}
+
+static int StandinOnSubscribe(int fd, const hi_u8 *pkt, hi_u32 len, hi_bool unsub)
+{
+    hi_u8 ack[5 + 64];
+    hi_u32 head = 4;          ///< the ack before the return codes
+    hi_u32 pos = 2;
+    hi_u32 propLen;
+    hi_u32 topicLen;
+    hi_u32 num = 0;
+    int ret;
+
+    if (len < 2)
+    {
+        return -1;
+    }
+    if (gStandin.version >= CN_MQTT_VERSION_5)
+    {
+        if (0 != StandinGetLen(pkt, len, &pos, &propLen))
+        {
+            return -1;
+        }
+        pos += propLen;
+        ack[head++] = 0; ///< no properties
+    }
+    while (pos + 2 <= len)
+    {
+        topicLen = ((hi_u32)pkt[pos] << 8) | pkt[pos + 1];
+        pos += 2 + topicLen;
+        if (num >= sizeof(ack) - head)
+        {
+            return -1;
+        }
+        if (!unsub)
+        {
+            if (pos >= len)
+            {
+                return -1;
+            }
+            ack[head + num] = (pkt[pos] & 0x03) > 1 ? 1 : (pkt[pos] & 0x03);
+            pos++;
+        }
+        else
+        {
+            ack[head + num] = 0; ///< success, MQTT 5 only
+        }
+        num++;
+    }
+
+    (void)pthread_mutex_lock(&gStandin.lock);
+    if (unsub)
+    {
+        gStandin.subNum = (gStandin.subNum > num) ? (gStandin.subNum - num) : 0;
+    }
+    else
+    {
+        gStandin.subNum += num;
+        gStandin.stat.subscribeCnt += num;
+    }
+    (void)pthread_cond_broadcast(&gStandin.cond);
+    (void)pthread_mutex_unlock(&gStandin.lock);
+
+    ///< the MQTT 3 UNSUBACK has no return codes
+    if (unsub && (gStandin.version < CN_MQTT_VERSION_5))
+    {
+        num = 0;
+    }
+    ack[0] = (hi_u8)((unsub ? CN_MQTT_UNSUBACK : CN_MQTT_SUBACK) << 4);
+    ack[1] = (hi_u8)(head - 2 + num);
+    ack[2] = pkt[0];
+    ack[3] = pkt[1];
+    (void)pthread_mutex_lock(&gStandin.sendLock);
+    ret = StandinSend(fd, ack, head + num);
+    (void)pthread_mutex_unlock(&gStandin.sendLock);
+    return ret;
+}
+
+///< the topic alias among the publish properties at pos, 0 if none; pos is moved past them
+static int StandinGetAlias(const hi_u8 *pkt, hi_u32 len, hi_u32 *pos, hi_u32 *alias)
+{
+    hi_u32 propLen;
+    hi_u32 end;
+    hi_u32 value;
+    hi_u8 id;
+
+    *alias = 0;
+    if ((0 != StandinGetLen(pkt, len, pos, &propLen)) || (*pos + propLen > len))
+    {
+        return -1;
+    }
+    end = *pos + propLen;
+    while (*pos < end)
+    {
+        id = pkt[(*pos)++];
+        switch (id)
+        {
+            case 0x01: ///< payload format
+                *pos += 1;
+                break;
+            case 0x02: ///< message expiry
+                *pos += 4;
+                break;
+            case CN_MQTT_PROP_TOPIC_ALIAS:
+                if (*pos + 2 > end)
+                {
+                    return -1;
+                }
+                *alias = ((hi_u32)pkt[*pos] << 8) | pkt[*pos + 1];
+                *pos += 2;
+                break;
+            case 0x0B: ///< subscription identifier
+                if (0 != StandinGetLen(pkt, end, pos, &value))
+                {
+                    return -1;
+                }
+                break;
+            case 0x03: ///< content type
+            case 0x08: ///< response topic
+            case 0x09: ///< correlation data
+            case 0x26: ///< user property, a pair of strings
+                if (*pos + 2 > end)
+                {
+                    return -1;
+                }
+                *pos += 2 + (((hi_u32)pkt[*pos] << 8) | pkt[*pos + 1]);
+                if ((id == 0x26) && (*pos + 2 <= end))
+                {
+                    *pos += 2 + (((hi_u32)pkt[*pos] << 8) | pkt[*pos + 1]);
+                }
+                break;
+            default:
+                return -1;
+        }
+    }
+    return (*pos == end) ? 0 : -1;
+}
+
+static int StandinOnPublish(int fd, hi_u8 header, const hi_u8 *pkt, hi_u32 len)
+{
+    hi_u8 qos = (header >> 1) & 0x03;
+    const char *topic = (const char *)pkt + 2;
+    const hi_u8 *msgID;
+    hi_u32 topicLen;
+    hi_u32 alias = 0;
+    hi_u32 pos;
+    hi_u8 lenBuf[4];
+    fnMqttStandinHook hook;
+
+    if (len < 2)
+    {
+        return -1;
+    }
+    topicLen = ((hi_u32)pkt[0] << 8) | pkt[1];
+    pos = 2 + topicLen + ((qos > 0) ? 2 : 0);
+    if (pos > len)
+    {
+        return -1;
+    }
+    msgID = pkt + 2 + topicLen;
+    if (gStandin.version >= CN_MQTT_VERSION_5)
+    {
+        if ((0 != StandinGetAlias(pkt, len, &pos, &alias)) || (alias > gStandin.aliasOffered))
+        {
+            return -1;
+        }
+        if ((alias > 0) && (topicLen > 0))
+        {
+            if (topicLen > CN_STANDIN_TOPIC_SIZE)
+            {
+                return -1;
+            }
+            (void)memcpy(gStandin.alias[alias], topic, topicLen);
+            gStandin.aliasLen[alias] = (hi_u16)topicLen;
+        }
+        else if (alias > 0)
+        {
+            if (gStandin.aliasLen[alias] == 0)
+            {
+                return -1; ///< a protocol error, an alias never set
+            }
+            topic = gStandin.alias[alias];
+            topicLen = gStandin.aliasLen[alias];
+        }
+    }
+
+    (void)pthread_mutex_lock(&gStandin.lock);
+    gStandin.stat.publishCnt++;
+    gStandin.stat.publishBytes += topicLen + (len - pos);
+    gStandin.stat.publishWire += 1 + StandinPutLen(lenBuf, len) + len;
+    if (topic != (const char *)pkt + 2)
+    {
+        gStandin.stat.aliasCnt++;
+    }
+    hook = gStandin.hook;
+    (void)pthread_cond_broadcast(&gStandin.cond);
+    (void)pthread_mutex_unlock(&gStandin.lock);
+    if (hook != NULL)
+    {
+        hook(topic, topicLen, (const char *)pkt + pos, len - pos);
+    }
+
+    if (qos == 1)
+    {
+        return StandinSendAck(fd, CN_MQTT_PUBACK, msgID);
+    }
+    if (qos == 2)
+    {
+        return StandinSendAck(fd, CN_MQTT_PUBREC, msgID);
+    }
+    return 0;
+}
+
+#ifdef HOST_MQTT_TLS
+static int StandinTlsInit(hi_void)
+{
+    static const char pers[] = "mqtt_standin";
+
+    mbedtls_ssl_config_init(&gStandin.conf);
+    mbedtls_x509_crt_init(&gStandin.crt);
+    mbedtls_pk_init(&gStandin.key);
+    mbedtls_entropy_init(&gStandin.entropy);
+    mbedtls_ctr_drbg_init(&gStandin.drbg);
+    if ((0 != mbedtls_ctr_drbg_seed(&gStandin.drbg, mbedtls_entropy_func, &gStandin.entropy,
+        (const unsigned char *)pers, sizeof(pers))) ||
+        (0 != mbedtls_x509_crt_parse(&gStandin.crt, (const unsigned char *)mbedtls_test_srv_crt,
+        mbedtls_test_srv_crt_len)) ||
+        (0 != mbedtls_pk_parse_key(&gStandin.key, (const unsigned char *)mbedtls_test_srv_key,
+        mbedtls_test_srv_key_len, NULL, 0)) ||
+        (0 != mbedtls_ssl_config_defaults(&gStandin.conf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM,
+        MBEDTLS_SSL_PRESET_DEFAULT)) ||
+        (0 != mbedtls_ssl_conf_own_cert(&gStandin.conf, &gStandin.crt, &gStandin.key)))
+    {
+        mbedtls_ssl_config_free(&gStandin.conf);
+        mbedtls_x509_crt_free(&gStandin.crt);
+        mbedtls_pk_free(&gStandin.key);
+        mbedtls_ctr_drbg_free(&gStandin.drbg);
+        mbedtls_entropy_free(&gStandin.entropy);
+        return -1;
+    }
+    mbedtls_ssl_conf_rng(&gStandin.conf, mbedtls_ctr_drbg_random, &gStandin.drbg);
+    gStandin.tlsReady = HI_TRUE;
+    return 0;
+}
+
+///< the server handshake on an accepted connection, if the connections are TLS
+static int StandinTlsAccept(int fd)
+{
+    hi_bool tls;
+    int ret;
+
+    (void)pthread_mutex_lock(&gStandin.lock);
+    tls = gStandin.tls;
+    (void)pthread_mutex_unlock(&gStandin.lock);
+    if (!tls)
+    {
+        return 0;
+    }
+    gStandin.sslFd = fd;
+    mbedtls_ssl_init(&gStandin.sslCtx);
+    if (0 != mbedtls_ssl_setup(&gStandin.sslCtx, &gStandin.conf))
+    {
+        mbedtls_ssl_free(&gStandin.sslCtx);
+        return -1;
+    }
+    mbedtls_ssl_set_bio(&gStandin.sslCtx, &gStandin.sslFd, mbedtls_net_send, mbedtls_net_recv, NULL);
+    do
+    {
+        ret = mbedtls_ssl_handshake(&gStandin.sslCtx);
+    } while ((ret == MBEDTLS_ERR_SSL_WANT_READ) || (ret == MBEDTLS_ERR_SSL_WANT_WRITE));
+    if (ret != 0)
+    {
+        mbedtls_ssl_free(&gStandin.sslCtx);
+        return -1;
+    }
+    (void)pthread_mutex_lock(&gStandin.sendLock);
+    gStandin.ssl = &gStandin.sslCtx;
+    (void)pthread_mutex_unlock(&gStandin.sendLock);
+    return 0;
+}
+
+///< with the sendLock held
+static hi_void StandinTlsClose(hi_void)
+{
+    if (gStandin.ssl != NULL)
+    {
+        mbedtls_ssl_free(gStandin.ssl);
+        gStandin.ssl = NULL;
+    }
+}
+#endif
+
+///< serve the packets of one connection until it closes, returns HI_TRUE on a DISCONNECT
+static hi_bool StandinServe(int fd)
+{
+    hi_u8 header;
+    hi_u8 resp[2] = {CN_MQTT_PINGRESP << 4, 0};
+    int len;
+    int ret;
+
+    for (;;)
+    {
+        len = StandinReadPacket(fd, &header);
+        if (len < 0)
+        {
+            return HI_FALSE;
+        }
+        switch (header >> 4)
+        {
+            case CN_MQTT_CONNECT:
+                ret = StandinOnConnect(fd, gStandin.packet, (hi_u32)len);
+                break;
+            case CN_MQTT_SUBSCRIBE:
+                ret = StandinOnSubscribe(fd, gStandin.packet, (hi_u32)len, HI_FALSE);
+                break;
+            case CN_MQTT_UNSUBSCRIBE:
+                ret = StandinOnSubscribe(fd, gStandin.packet, (hi_u32)len, HI_TRUE);
+                break;
+            case CN_MQTT_PUBLISH:
+                ret = StandinOnPublish(fd, header, gStandin.packet, (hi_u32)len);
+                break;
+            case CN_MQTT_PUBACK:
+                (void)pthread_mutex_lock(&gStandin.lock);
+                gStandin.stat.pubackCnt++;
+                (void)pthread_cond_broadcast(&gStandin.cond);
+                (void)pthread_mutex_unlock(&gStandin.lock);
+                ret = 0;
+                break;
+            case CN_MQTT_PUBREL:
+                ret = (len >= 2) ? StandinSendAck(fd, CN_MQTT_PUBCOMP, gStandin.packet) : -1;
+                break;
+            case CN_MQTT_PINGREQ:
+                (void)pthread_mutex_lock(&gStandin.lock);
+                gStandin.stat.pingCnt++;
+                (void)pthread_mutex_unlock(&gStandin.lock);
+                (void)pthread_mutex_lock(&gStandin.sendLock);
+                ret = StandinSend(fd, resp, sizeof(resp));
+                (void)pthread_mutex_unlock(&gStandin.sendLock);
+                break;
+            case CN_MQTT_DISCONNECT:
+                return HI_TRUE;
+            default:
+                ret = 0;
+                break;
+        }
+        if (ret != 0)
+        {
+            return HI_FALSE;
+        }
+    }
+}
+
+static hi_void *StandinEntry(hi_void *arg)
+{
+    int fd;
+    int one = 1;
+    hi_bool clean;
+    struct pollfd pfd;
+
+    (void)arg;
+    while (!gStandin.stop)
+    {
+        pfd.fd = gStandin.listenFd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, CN_STANDIN_POLL_MS) <= 0)
+        {
+            continue;
+        }
+        fd = accept(gStandin.listenFd, NULL, NULL);
+        if (fd < 0)
+        {
+            continue;
+        }
+        (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef HOST_MQTT_TLS
+        if (0 != StandinTlsAccept(fd))
+        {
+            (void)close(fd);
+            continue;
+        }
+#endif
+        clean = StandinServe(fd);
+
+        (void)pthread_mutex_lock(&gStandin.lock);
+        gStandin.clientFd = -1;
+        if (!clean)
+        {
+            gStandin.stat.dropCnt++;
+        }
+        (void)pthread_cond_broadcast(&gStandin.cond);
+        (void)pthread_mutex_unlock(&gStandin.lock);
+        (void)pthread_mutex_lock(&gStandin.sendLock);
+#ifdef HOST_MQTT_TLS
+        StandinTlsClose();
+#endif
+        (void)close(fd);
+        (void)pthread_mutex_unlock(&gStandin.sendLock);
+    }
+    return NULL;
+}
+
+int MqttStandinStart(hi_u16 port)
+{
+    int fd;
+    int one = 1;
+    struct sockaddr_in addr;
+
+    if (gStandin.running)
+    {
+        return -1;
+    }
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    (void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    (void)memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ((0 != bind(fd, (struct sockaddr *)&addr, sizeof(addr))) || (0 != listen(fd, 4)))
+    {
+        (void)close(fd);
+        return -1;
+    }
+    gStandin.listenFd = fd;
+    gStandin.stop = HI_FALSE;
+    if (0 != pthread_create(&gStandin.thread, NULL, StandinEntry, NULL))
+    {
+        (void)close(fd);
+        gStandin.listenFd = -1;
+        return -1;
+    }
+    gStandin.running = HI_TRUE;
+    return 0;
+}
+
+hi_void MqttStandinStop(hi_void)
+{
+    if (!gStandin.running)
+    {
+        return;
+    }
+    gStandin.stop = HI_TRUE;
+    MqttStandinDrop();
+    (void)pthread_join(gStandin.thread, NULL);
+    (void)close(gStandin.listenFd);
+    gStandin.listenFd = -1;
+    gStandin.running = HI_FALSE;
+}
+
+static int StandinWait(hi_u32 timeoutMs, hi_bool (*done)(hi_u32 arg), hi_u32 arg)
+{
+    struct timespec deadline;
+    int ret = 0;
+
+    (void)clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (long)(timeoutMs % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    (void)pthread_mutex_lock(&gStandin.lock);
+    while (!done(arg))
+    {
+        if (ETIMEDOUT == pthread_cond_timedwait(&gStandin.cond, &gStandin.lock, &deadline))
+        {
+            ret = done(arg) ? 0 : -1;
+            break;
+        }
+    }
+    (void)pthread_mutex_unlock(&gStandin.lock);
+    return ret;
+}
+
+static hi_bool StandinIsReady(hi_u32 arg)
+{
+    (void)arg;
+    return (gStandin.clientFd >= 0) && (gStandin.subNum > 0);
+}
+
+static hi_bool StandinHasPublish(hi_u32 arg)
+{
+    return gStandin.stat.publishCnt >= arg;
+}
+
+int MqttStandinWaitReady(hi_u32 timeoutMs)
+{
+    return StandinWait(timeoutMs, StandinIsReady, 0);
+}
+
+int MqttStandinWaitPublish(hi_u32 publishCnt, hi_u32 timeoutMs)
+{
+    return StandinWait(timeoutMs, StandinHasPublish, publishCnt);
+}
+
+int MqttStandinPublish(const char *topic, const char *payload, int qos)
+{
+    hi_u8 *buf;
+    hi_u32 topicLen = (hi_u32)strlen(topic);
+    hi_u32 payloadLen = (hi_u32)strlen(payload);
+    hi_u32 len = 2 + topicLen + ((qos > 0) ? 2 : 0) + payloadLen;
+    hi_u32 pos;
+    hi_bool props;
+    int fd;
+    int ret = -1;
+    static hi_u8 packet[CN_STANDIN_PACKET_SIZE + 5];
+
+    if ((qos < 0) || (qos > 1) || (len > CN_STANDIN_PACKET_SIZE))
+    {
+        return -1;
+    }
+    (void)pthread_mutex_lock(&gStandin.sendLock); ///< also guards the static packet
+    (void)pthread_mutex_lock(&gStandin.lock);
+    props = (gStandin.version >= CN_MQTT_VERSION_5);
+    (void)pthread_mutex_unlock(&gStandin.lock);
+    len += props ? 1 : 0;
+    buf = packet;
+    buf[0] = (hi_u8)((CN_MQTT_PUBLISH << 4) | (qos << 1));
+    pos = 1 + StandinPutLen(buf + 1, len);
+    buf[pos++] = (hi_u8)(topicLen >> 8);
+    buf[pos++] = (hi_u8)topicLen;
+    (void)memcpy(buf + pos, topic, topicLen);
+    pos += topicLen;
+    if (qos > 0)
+    {
+        gStandin.msgID = (gStandin.msgID == 0xFFFF) ? 1 : (gStandin.msgID + 1);
+        buf[pos++] = (hi_u8)(gStandin.msgID >> 8);
+        buf[pos++] = (hi_u8)gStandin.msgID;
+    }
+    if (props)
+    {
+        buf[pos++] = 0;
+    }
+    (void)memcpy(buf + pos, payload, payloadLen);
+    pos += payloadLen;
+
+    (void)pthread_mutex_lock(&gStandin.lock);
+    fd = gStandin.clientFd;
+    (void)pthread_mutex_unlock(&gStandin.lock);
+    if (fd >= 0)
+    {
+        ret = StandinSend(fd, buf, pos);
+    }
+    (void)pthread_mutex_unlock(&gStandin.sendLock);
+
+    if (ret == 0)
+    {
+        (void)pthread_mutex_lock(&gStandin.lock);
+        gStandin.stat.injectCnt++;
+        (void)pthread_mutex_unlock(&gStandin.lock);
+    }
+    return ret;
+}
+
+hi_void MqttStandinDrop(hi_void)
+{
+    (void)pthread_mutex_lock(&gStandin.lock);
+    if (gStandin.clientFd >= 0)
+    {
+        (void)shutdown(gStandin.clientFd, SHUT_RDWR); ///< the broker thread sees it and closes
+    }
+    (void)pthread_mutex_unlock(&gStandin.lock);
+}
+
+hi_void MqttStandinSetTopicAliasMax(hi_u16 max)
+{
+    (void)pthread_mutex_lock(&gStandin.lock);
+    gStandin.aliasMax = (max > CN_STANDIN_ALIASNUM) ? CN_STANDIN_ALIASNUM : max;
+    (void)pthread_mutex_unlock(&gStandin.lock);
+}
+
+int MqttStandinSetTls(hi_bool tls)
+{
+#ifdef HOST_MQTT_TLS
+    int ret = 0;
+
+    (void)pthread_mutex_lock(&gStandin.lock);
+    if (tls && !gStandin.tlsReady)
+    {
+        ret = StandinTlsInit();
+    }
+    gStandin.tls = (ret == 0) ? tls : HI_FALSE;
+    (void)pthread_mutex_unlock(&gStandin.lock);
+    return ret;
+#else
+    return tls ? -1 : 0;
+#endif
+}
+
+hi_void MqttStandinSetHook(fnMqttStandinHook hook)
+{
+    (void)pthread_mutex_lock(&gStandin.lock);
+    gStandin.hook = hook;
+    (void)pthread_mutex_unlock(&gStandin.lock);
+}
+
+hi_void MqttStandinGetStat(MqttStandinStat_t *stat)
+{
+    clockid_t cid;
+    struct timespec ts;
+
+    (void)pthread_mutex_lock(&gStandin.lock);
+    *stat = gStandin.stat;
+    (void)pthread_mutex_unlock(&gStandin.lock);
+    stat->cpuUs = 0;
+    if (gStandin.running && (0 == pthread_getcpuclockid(gStandin.thread, &cid)) &&
+        (0 == clock_gettime(cid, &ts)))
+    {
+        stat->cpuUs = (hi_u64)ts.tv_sec * 1000000 + (hi_u64)ts.tv_nsec / 1000;
+    }
+}
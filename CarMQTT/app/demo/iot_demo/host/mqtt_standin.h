@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, a local MQTT 3.1.1 and 5 broker standing in for the IoT platform
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-10
+ */
+#ifndef MQTT_STANDIN_H_
+#define MQTT_STANDIN_H_
+
+#include <hi_types_base.h>
+
+typedef struct
+{
+    hi_u32 connectCnt;
+    hi_u32 sessionCnt;    ///< the connects answered with session present
+    hi_u32 subscribeCnt;  ///< topic filters subscribed
+    hi_u32 publishCnt;    ///< publishes from the device
+    hi_u32 publishBytes;  ///< their topic and payload bytes
+    hi_u32 publishWire;   ///< their whole packets, as they were on air
+    hi_u32 aliasCnt;      ///< of them, those which came with an MQTT 5 topic alias and no topic
+    hi_u32 injectCnt;     ///< publishes to the device
+    hi_u32 pubackCnt;     ///< the device acks of the qos1 ones
+    hi_u32 pingCnt;
+    hi_u32 dropCnt;       ///< connections closed without a DISCONNECT
+    hi_u64 cpuUs;         ///< cpu time of the broker thread
+} MqttStandinStat_t;
+
+typedef hi_void (*fnMqttStandinHook)(const char *topic, hi_u32 topicLen, const char *payload, hi_u32 payloadLen);
+
+/**
+ * Listen on 127.0.0.1:port and serve one client at a time in a thread
+ *
+ * @return 0 success while others failed
+*/
+int MqttStandinStart(hi_u16 port);
+
+hi_void MqttStandinStop(hi_void);
+
+/**
+ * Wait until a client is connected and has its subscriptions
+ *
+ * @return 0 success while -1 timeout
+*/
+int MqttStandinWaitReady(hi_u32 timeoutMs);
+
+/**
+ * Wait until so many publishes came from the device since the start
+ *
+ * @return 0 success while -1 timeout
+*/
+int MqttStandinWaitPublish(hi_u32 publishCnt, hi_u32 timeoutMs);
+
+/**
+ * Send a publish to the connected client, qos 0 or 1
+ *
+ * @return 0 success while others failed
+*/
+int MqttStandinPublish(const char *topic, const char *payload, int qos);
+
+/**
+ * Close the client connection as a network loss would, the session is kept
+*/
+hi_void MqttStandinDrop(hi_void);
+
+/**
+ * The topic alias maximum the next MQTT 5 connects are offered, 0 for none
+*/
+hi_void MqttStandinSetTopicAliasMax(hi_u16 max);
+
+/**
+ * Whether the next connections are TLS, with the mbedtls test certificate. Over TLS only the hook
+ * may call MqttStandinPublish
+ *
+ * @return 0 success while -1 failed or not built with HOST_MQTT_TLS
+*/
+int MqttStandinSetTls(hi_bool tls);
+
+/**
+ * Called in the broker thread for every publish from the device, NULL to remove.
+ * The topic is that of the alias if the publish came with one
+*/
+hi_void MqttStandinSetHook(fnMqttStandinHook hook);
+
+hi_void MqttStandinGetStat(MqttStandinStat_t *stat);
+
+#endif /* MQTT_STANDIN_H_ */
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, cost of the message id handling of paho against the inflight messages
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-14
+ */
+
+/**
+ * A client of paho's protocol layer publishes n qos1 messages without an ack, each with a new id
+ * from MQTTProtocol_assignMsgId, then gets the pubacks of all of them through
+ * MQTTProtocol_handlePubacks, in the order they were sent and shuffled. This is what a gateway
+ * with a large inflight window does when the broker is slow for a while.
+ *
+ * The publishes go to a local socket pair, a thread reads them away. The times are per message
+ * and the writes are in the publish time, the same for any n.
+ *
+ * One "name key=value ..." line per n and ack order, the exit code is not 0 if messages were
+ * left inflight.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <hi_types_base.h>
+#include <hi_time.h>
+#include "Heap.h"
+#include "MQTTClient.h" ///< MQTTVERSION_3_1_1
+#include "MQTTPacket.h"
+#include "MQTTProtocolClient.h"
+#include "Socket.h"
+
+#define CN_MSGID_BENCH_TOPIC "$oc/devices/5f0c2f1a_car/sys/properties/report"
+#define CN_MSGID_BENCH_PAYLOAD "{\"services\":[]}"
+#define CN_MSGID_BENCH_DRAIN 4096
+
+int Socket_addSocket(int newSd); ///< Socket.c has it, Socket.h does not
+extern ClientStates* bstate; ///< the client states of MQTTClient.c
+
+static const hi_u32 gMsgIdBenchInflight[] = {1000, 2000, 5000, 10000};
+
+static void *MsgIdBenchDrain(void *arg)
+{
+    char buf[CN_MSGID_BENCH_DRAIN];
+    int fd = *(int *)arg;
+
+    while (read(fd, buf, sizeof(buf)) > 0)
+    {
+    }
+    return NULL;
+}
+
+static int MsgIdBenchPublish(Clients *client, hi_u64 *assignUs, hi_u64 *publishUs)
+{
+    Publish publish;
+    Messages *m = NULL;
+    hi_u64 startUs;
+    int msgid;
+
+    startUs = hi_get_us();
+    msgid = MQTTProtocol_assignMsgId(client);
+    *assignUs += hi_get_us() - startUs;
+    if (msgid == 0)
+    {
+        return -1;
+    }
+    (void)memset(&publish, 0, sizeof(publish));
+    publish.header.bits.type = PUBLISH;
+    publish.header.bits.qos = 1;
+    publish.msgId = msgid;
+    publish.MQTTVersion = MQTTVERSION_3_1_1;
+    publish.topic = MQTTStrdup(CN_MSGID_BENCH_TOPIC); ///< the message keeps the topic, the payload is copied
+    publish.topiclen = (int)strlen(CN_MSGID_BENCH_TOPIC);
+    publish.payload = MQTTStrdup(CN_MSGID_BENCH_PAYLOAD);
+    publish.payloadlen = (int)strlen(CN_MSGID_BENCH_PAYLOAD);
+    startUs = hi_get_us();
+    if (TCPSOCKET_COMPLETE != MQTTProtocol_startPublish(client, &publish, 1, 0, &m))
+    {
+        msgid = -1;
+    }
+    *publishUs += hi_get_us() - startUs;
+    free(publish.payload);
+    return msgid;
+}
+
+static int MsgIdBenchRun(Clients *client, hi_u32 inflight, int shuffle)
+{
+    int *msgids;
+    hi_u64 assignUs = 0;
+    hi_u64 publishUs = 0;
+    hi_u64 ackUs;
+    hi_u32 seed = inflight;
+    hi_u32 i;
+    int ret = -1;
+
+    msgids = malloc(inflight * sizeof(int));
+    if (msgids == NULL)
+    {
+        return -1;
+    }
+    for (i = 0; i < inflight; i++)
+    {
+        if ((msgids[i] = MsgIdBenchPublish(client, &assignUs, &publishUs)) <= 0)
+        {
+            goto EXIT;
+        }
+    }
+    for (i = inflight - 1; shuffle && (i > 0); i--)
+    {
+        hi_u32 j;
+        int tmp;
+
+        seed = seed * 1103515245 + 12345; ///< the same order every run
+        j = (seed >> 8) % (i + 1);
+        tmp = msgids[i];
+        msgids[i] = msgids[j];
+        msgids[j] = tmp;
+    }
+
+    ackUs = hi_get_us();
+    for (i = 0; i < inflight; i++)
+    {
+        Puback *ack = malloc(sizeof(Puback)); ///< handlePubacks frees it, as it does the received ones
+
+        if (ack == NULL)
+        {
+            goto EXIT;
+        }
+        (void)memset(ack, 0, sizeof(Puback));
+        ack->header.bits.type = PUBACK;
+        ack->msgId = msgids[i];
+        ack->MQTTVersion = MQTTVERSION_3_1_1;
+        (void)MQTTProtocol_handlePubacks(ack, client->net.socket);
+    }
+    ackUs = hi_get_us() - ackUs;
+
+    (void)printf("msgid.inflight n=%u acks=%s assign_us=%.3f publish_us=%.3f ack_us=%.3f left=%d\n", inflight,
+        shuffle ? "shuffled" : "in_order", (double)assignUs / inflight, (double)publishUs / inflight,
+        (double)ackUs / inflight, client->outboundMsgs->count);
+    ret = (client->outboundMsgs->count == 0) ? 0 : -1;
+
+EXIT:
+    free(msgids);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    Clients client;
+    pthread_t drain;
+    int pair[2];
+    hi_u32 i;
+    int ret = 0;
+
+    (void)argc;
+    (void)argv;
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    Heap_initialize(); ///< as MQTTClient_create and MQTTAsync_create do
+    Socket_outInitialize();
+    bstate->clients = ListInitialize();
+    if ((0 != socketpair(AF_UNIX, SOCK_STREAM, 0, pair)) || (0 != Socket_addSocket(pair[0])))
+    {
+        (void)printf("msgid.inflight failed=socketpair\n");
+        return 1;
+    }
+    ///< the publishes wait for the reader rather than going to the pending writes
+    (void)fcntl(pair[0], F_SETFL, fcntl(pair[0], F_GETFL) & ~O_NONBLOCK);
+    if (0 != pthread_create(&drain, NULL, MsgIdBenchDrain, &pair[1]))
+    {
+        return 1;
+    }
+
+    (void)memset(&client, 0, sizeof(client));
+    client.clientID = "bench";
+    client.MQTTVersion = MQTTVERSION_3_1_1;
+    client.connected = 1;
+    client.good = 1;
+    client.net.socket = pair[0];
+    client.outboundMsgs = ListInitialize();
+    client.inboundMsgs = ListInitialize();
+    client.messageQueue = ListInitialize();
+    ListAppend(bstate->clients, &client, sizeof(client));
+
+    for (i = 0; i < sizeof(gMsgIdBenchInflight) / sizeof(gMsgIdBenchInflight[0]); i++)
+    {
+        ret |= MsgIdBenchRun(&client, gMsgIdBenchInflight[i], 0);
+        ret |= MsgIdBenchRun(&client, gMsgIdBenchInflight[i], 1);
+    }
+
+    (void)shutdown(pair[0], SHUT_WR);
+    (void)pthread_join(drain, NULL);
+    (void)close(pair[1]); ///< first, the blocking socket would wait in the recv of Socket_close
+    Socket_close(pair[0]);
+    return (ret == 0) ? 0 : 1;
+}
@@ -0,0 +1,416 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, publish rate of MQTTClient handles driven from several threads
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-24
+ */
+
+/**
+ * A gateway or a device simulator drives many MQTTClient handles from its own threads. Here each
+ * thread has a handle of its own and publishes -n messages at qos 0, or at qos 1 with all of them
+ * allowed in flight and the pubacks read afterwards, until none is pending. The rate is of all the
+ * threads together, for 1, 2, 4 ... up to -t threads. Handles that do not share state should not
+ * wait for each other, so it should grow with the threads until the cpus run out.
+ *
+ * The broker is a sink of this file, not the stand-in of mqtt_standin.c, which takes one client:
+ * a thread per connection acks the CONNECT and the qos 1 PUBLISHes and drops the rest.
+ *
+ * paho is built with HIGH_PERFORMANCE and NOSTACKTRACE for this, as on the board, the heap
+ * tracking and the function trace of the other host programs take global locks in every call.
+ *
+ * One "name key=value ..." line per qos and thread count, the exit code is not 0 if a publish
+ * failed or a puback did not come.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <hi_types_base.h>
+#include <hi_time.h>
+#include "MQTTClient.h"
+
+#define CN_MT_BENCH_MSGS 20000
+#define CN_MT_BENCH_THREADS 8
+#define CN_MT_BENCH_INFLIGHT 65535
+#define CN_MT_BENCH_DRAIN_BATCH 64   ///< MQTTClient_receive calls between looks at the pending tokens
+#define CN_MT_BENCH_DRAIN_MS 30000
+#define CN_MT_BENCH_BUF 65536
+#define CN_MT_BENCH_URI_LEN 64
+#define CN_MT_BENCH_TOPIC "$oc/devices/5f0c2f1a_car/sys/properties/report"
+#define CN_MT_BENCH_PAYLOAD "{\"services\":[{\"service_id\":\"CarStatus\",\"properties\":{\"speed\":50}}]}"
+
+#define CN_MQTT_CONNECT 1
+#define CN_MQTT_PUBLISH 3
+#define CN_MQTT_PINGREQ 12
+#define CN_MQTT_DISCONNECT 14
+
+typedef struct
+{
+    int fd;
+    hi_u32 inLen;    ///< bytes read into in
+    hi_u32 inPos;    ///< the next byte of in to parse
+    hi_u32 outLen;   ///< acks not written yet
+    unsigned char in[CN_MT_BENCH_BUF];
+    unsigned char out[CN_MT_BENCH_BUF];
+    unsigned char body[CN_MT_BENCH_BUF];
+} MtBenchConn_t;
+
+typedef struct
+{
+    MQTTClient client;
+    int qos;
+    int failed;
+    pthread_t thread;
+} MtBenchWorker_t;
+
+static struct
+{
+    int listenFd;
+    char uri[CN_MT_BENCH_URI_LEN];
+    hi_u32 msgs;
+    hi_u32 threads;
+    pthread_barrier_t start;
+    MtBenchWorker_t workers[CN_MT_BENCH_THREADS];
+} gMtBench;
+
+static int MtBenchFlush(MtBenchConn_t *conn)
+{
+    hi_u32 done = 0;
+    ssize_t ret;
+
+    while (done < conn->outLen)
+    {
+        if ((ret = write(conn->fd, conn->out + done, conn->outLen - done)) <= 0)
+        {
+            return -1;
+        }
+        done += (hi_u32)ret;
+    }
+    conn->outLen = 0;
+    return 0;
+}
+
+///< the acks wait in out until there is nothing more to parse, one write for a burst of publishes
+static int MtBenchGet(MtBenchConn_t *conn, unsigned char *dst, hi_u32 len)
+{
+    hi_u32 done = 0;
+    ssize_t ret;
+
+    while (done < len)
+    {
+        if (conn->inPos == conn->inLen)
+        {
+            if ((conn->outLen > 0) && (0 != MtBenchFlush(conn)))
+            {
+                return -1;
+            }
+            if ((ret = read(conn->fd, conn->in, sizeof(conn->in))) <= 0)
+            {
+                return -1;
+            }
+            conn->inLen = (hi_u32)ret;
+            conn->inPos = 0;
+        }
+        while ((done < len) && (conn->inPos < conn->inLen))
+        {
+            dst[done++] = conn->in[conn->inPos++];
+        }
+    }
+    return 0;
+}
+
+static int MtBenchAck(MtBenchConn_t *conn, const unsigned char *ack, hi_u32 len)
+{
+    if ((conn->outLen + len > sizeof(conn->out)) && (0 != MtBenchFlush(conn)))
+    {
+        return -1;
+    }
+    (void)memcpy(conn->out + conn->outLen, ack, len);
+    conn->outLen += len;
+    return 0;
+}
+
+static void *MtBenchConnThread(void *arg)
+{
+    static const unsigned char connack[] = {0x20, 2, 0, 0};
+    static const unsigned char pingresp[] = {0xd0, 0};
+    MtBenchConn_t *conn = arg;
+    unsigned char puback[] = {0x40, 2, 0, 0};
+    unsigned char header;
+    unsigned char c;
+    hi_u32 remaining;
+    hi_u32 multiplier;
+    hi_u32 topicLen;
+
+    while (0 == MtBenchGet(conn, &header, 1))
+    {
+        remaining = 0;
+        multiplier = 1;
+        do
+        {
+            if (0 != MtBenchGet(conn, &c, 1))
+            {
+                goto EXIT;
+            }
+            remaining += (c & 127) * multiplier;
+            multiplier *= 128;
+        } while ((c & 128) != 0);
+        if ((remaining > sizeof(conn->body)) || (0 != MtBenchGet(conn, conn->body, remaining)))
+        {
+            break;
+        }
+
+        switch (header >> 4)
+        {
+            case CN_MQTT_CONNECT:
+                (void)MtBenchAck(conn, connack, sizeof(connack));
+                break;
+            case CN_MQTT_PUBLISH:
+                topicLen = ((hi_u32)conn->body[0] << 8) | conn->body[1];
+                if ((((header >> 1) & 3) == 1) && (topicLen + 4 <= remaining))
+                {
+                    puback[2] = conn->body[topicLen + 2];
+                    puback[3] = conn->body[topicLen + 3];
+                    (void)MtBenchAck(conn, puback, sizeof(puback));
+                }
+                break;
+            case CN_MQTT_PINGREQ:
+                (void)MtBenchAck(conn, pingresp, sizeof(pingresp));
+                break;
+            case CN_MQTT_DISCONNECT:
+                goto EXIT;
+            default:
+                break;
+        }
+    }
+EXIT:
+    (void)close(conn->fd);
+    free(conn);
+    return NULL;
+}
+
+static void *MtBenchAcceptThread(void *arg)
+{
+    MtBenchConn_t *conn;
+    pthread_t thread;
+    int fd;
+
+    (void)arg;
+    while ((fd = accept(gMtBench.listenFd, NULL, NULL)) >= 0)
+    {
+        if ((conn = calloc(1, sizeof(MtBenchConn_t))) == NULL)
+        {
+            (void)close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        if (0 != pthread_create(&thread, NULL, MtBenchConnThread, conn))
+        {
+            (void)close(fd);
+            free(conn);
+            continue;
+        }
+        (void)pthread_detach(thread);
+    }
+    return NULL;
+}
+
+static int MtBenchListen(hi_void)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    pthread_t thread;
+
+    if ((gMtBench.listenFd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+    {
+        return -1;
+    }
+    (void)memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0; ///< any free port, the host build may run while another bench has its own
+    if ((0 != bind(gMtBench.listenFd, (struct sockaddr *)&addr, sizeof(addr))) ||
+        (0 != listen(gMtBench.listenFd, CN_MT_BENCH_THREADS)) ||
+        (0 != getsockname(gMtBench.listenFd, (struct sockaddr *)&addr, &len)))
+    {
+        return -1;
+    }
+    (void)snprintf(gMtBench.uri, sizeof(gMtBench.uri), "tcp://127.0.0.1:%u", (unsigned)ntohs(addr.sin_port));
+    if (0 != pthread_create(&thread, NULL, MtBenchAcceptThread, NULL))
+    {
+        return -1;
+    }
+    return pthread_detach(thread);
+}
+
+///< reads the pubacks of this handle, and of the others if they come first, until none is pending
+static int MtBenchComplete(MQTTClient client)
+{
+    MQTTClient_deliveryToken *tokens = NULL;
+    MQTTClient_message *msg = NULL;
+    char *topic = NULL;
+    int topicLen;
+    hi_u64 startUs = hi_get_us();
+    int i;
+
+    while (hi_get_us() - startUs < (hi_u64)CN_MT_BENCH_DRAIN_MS * 1000)
+    {
+        for (i = 0; i < CN_MT_BENCH_DRAIN_BATCH; i++)
+        {
+            (void)MQTTClient_receive(client, &topic, &topicLen, &msg, 0);
+            if (msg != NULL)
+            {
+                MQTTClient_freeMessage(&msg);
+                MQTTClient_free(topic);
+            }
+        }
+        if (MQTTCLIENT_SUCCESS != MQTTClient_getPendingDeliveryTokens(client, &tokens))
+        {
+            return -1;
+        }
+        if (tokens == NULL)
+        {
+            return 0;
+        }
+        MQTTClient_free(tokens);
+    }
+    return -1;
+}
+
+static void *MtBenchPublisher(void *arg)
+{
+    MtBenchWorker_t *worker = arg;
+    hi_u32 i;
+
+    (void)pthread_barrier_wait(&gMtBench.start);
+    for (i = 0; i < gMtBench.msgs; i++)
+    {
+        if (MQTTCLIENT_SUCCESS != MQTTClient_publish(worker->client, CN_MT_BENCH_TOPIC,
+            (int)strlen(CN_MT_BENCH_PAYLOAD), CN_MT_BENCH_PAYLOAD, worker->qos, 0, NULL))
+        {
+            worker->failed = 1;
+            break;
+        }
+    }
+    if ((worker->failed == 0) && (worker->qos > 0) && (0 != MtBenchComplete(worker->client)))
+    {
+        worker->failed = 1;
+    }
+    (void)pthread_barrier_wait(&gMtBench.start); ///< the last one to finish stops the clock
+    return NULL;
+}
+
+static int MtBenchRun(int qos, hi_u32 threads)
+{
+    hi_u64 costUs;
+    hi_u32 i;
+    int failed = 0;
+
+    if (0 != pthread_barrier_init(&gMtBench.start, NULL, threads + 1))
+    {
+        return -1;
+    }
+    for (i = 0; i < threads; i++)
+    {
+        gMtBench.workers[i].qos = qos;
+        gMtBench.workers[i].failed = 0;
+        if (0 != pthread_create(&gMtBench.workers[i].thread, NULL, MtBenchPublisher, &gMtBench.workers[i]))
+        {
+            return -1; ///< the started ones wait at the barrier for good, the bench is over anyway
+        }
+    }
+    (void)pthread_barrier_wait(&gMtBench.start);
+    costUs = hi_get_us();
+    (void)pthread_barrier_wait(&gMtBench.start);
+    costUs = hi_get_us() - costUs;
+    for (i = 0; i < threads; i++)
+    {
+        (void)pthread_join(gMtBench.workers[i].thread, NULL);
+        failed |= gMtBench.workers[i].failed;
+    }
+    (void)pthread_barrier_destroy(&gMtBench.start);
+
+    if (failed != 0)
+    {
+        (void)printf("mt.qos%d threads=%u failed=1\n", qos, threads);
+        return -1;
+    }
+    (void)printf("mt.qos%d threads=%u msgs=%u msgs_per_s=%.0f\n", qos, threads, gMtBench.msgs * threads,
+        (costUs > 0) ? (double)gMtBench.msgs * threads * 1000000 / costUs : 0.0);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    MQTTClient_connectOptions options = MQTTClient_connectOptions_initializer;
+    char clientId[CN_MT_BENCH_URI_LEN];
+    hi_u32 threads;
+    hi_u32 i;
+    int qos;
+    int opt;
+    int ret = 0;
+
+    gMtBench.msgs = CN_MT_BENCH_MSGS;
+    gMtBench.threads = CN_MT_BENCH_THREADS;
+    while ((opt = getopt(argc, argv, "n:t:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                gMtBench.msgs = (hi_u32)strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                gMtBench.threads = (hi_u32)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                (void)fprintf(stderr, "usage: %s [-n messages per thread] [-t threads]\n", argv[0]);
+                return 2;
+        }
+    }
+    if ((gMtBench.threads == 0) || (gMtBench.threads > CN_MT_BENCH_THREADS))
+    {
+        (void)fprintf(stderr, "the threads are 1 to %d\n", CN_MT_BENCH_THREADS);
+        return 2;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    if (0 != MtBenchListen())
+    {
+        (void)printf("mt failed=listen\n");
+        return 1;
+    }
+
+    options.keepAliveInterval = 60;
+    options.cleansession = 1;
+    options.maxInflightMessages = CN_MT_BENCH_INFLIGHT; ///< MQTTClient yields 200ms when the window is full
+    for (i = 0; i < gMtBench.threads; i++)
+    {
+        (void)snprintf(clientId, sizeof(clientId), "mt_bench%u", i);
+        if ((MQTTCLIENT_SUCCESS != MQTTClient_create(&gMtBench.workers[i].client, gMtBench.uri, clientId,
+            MQTTCLIENT_PERSISTENCE_NONE, NULL)) ||
+            (MQTTCLIENT_SUCCESS != MQTTClient_connect(gMtBench.workers[i].client, &options)))
+        {
+            (void)printf("mt failed=connect\n");
+            return 1;
+        }
+    }
+
+    for (qos = 0; qos <= 1; qos++)
+    {
+        for (threads = 1; threads <= gMtBench.threads; threads *= 2)
+        {
+            ret |= MtBenchRun(qos, threads);
+        }
+    }
+
+    for (i = 0; i < gMtBench.threads; i++)
+    {
+        (void)MQTTClient_disconnect(gMtBench.workers[i].client, 0);
+        MQTTClient_destroy(&gMtBench.workers[i].client);
+    }
+    (void)close(gMtBench.listenFd);
+    return (ret == 0) ? 0 : 1;
+}
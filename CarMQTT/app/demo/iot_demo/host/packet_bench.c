@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, cost of the paho packet coding: the length encoding, the packet reading and the publish writing
+ * Author: HiSpark Product Team.
+ * Create: 2020-8-3
+ */
+
+/**
+ * The calls every packet of the device goes through, one by one, with nothing around them:
+ *
+ * encode: MQTTPacket_encode of remaining lengths of 1 to 4 bytes.
+ * factory: MQTTPacket_Factory of a batch of packets written to the peer of a local socket pair,
+ *      without the wait on the socket, a qos1 command in MQTT 3.1.1 and 5 and a puback.
+ * send: MQTTPacket_send_publish of a property report at qos 0 and 1 in MQTT 3.1.1, and at qos 1
+ *      in MQTT 5 with a topic alias, to the socket pair, whose peer is read after each batch.
+ *
+ * The heap calls and the writev calls per packet are counted by host_alloc.c. One "name key=value
+ * ..." line per call and packet kind, the exit code is not 0 if a packet came back wrong.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <hi_types_base.h>
+#include <hi_time.h>
+#include "Heap.h"
+#include "MQTTClient.h" ///< MQTTVERSION_3_1_1
+#include "MQTTPacket.h"
+#include "MQTTProtocolClient.h"
+#include "Socket.h"
+#include "host.h"
+
+#define CN_PACKET_BENCH_ENCODES 10000000
+#define CN_PACKET_BENCH_PACKETS 200000
+#define CN_PACKET_BENCH_BATCH 32
+#define CN_PACKET_BENCH_PACKETMAX 256
+#define CN_PACKET_BENCH_TOPIC "$oc/devices/5f0c2f1a_car/sys/commands/request_id=1"
+#define CN_PACKET_BENCH_PAYLOAD "{\"service_id\":\"CarControl\",\"command_name\":\"Forward\",\"paras\":{\"speed\":50}}"
+#define CN_PACKET_BENCH_REPORT "$oc/devices/5f0c2f1a_car/sys/properties/report"
+#define CN_PACKET_BENCH_PROPS "{\"services\":[{\"service_id\":\"CarStatus\",\"properties\":{\"speed\":50}}]}"
+#define CN_PACKET_BENCH_MSGID 0x1234
+#define CN_PACKET_BENCH_EXPIRY 0x02 ///< the MQTT 5 message expiry property
+
+typedef struct
+{
+    const char *name;
+    int version;
+    hi_u8 type;
+    char buf[CN_PACKET_BENCH_PACKETMAX];
+    int len;
+} PacketBenchPacket_t;
+
+typedef struct
+{
+    hi_u64 us;
+    HostAllocStat_t alloc;
+    hi_u64 writev;
+} PacketBenchCost_t;
+
+int Socket_addSocket(int newSd); ///< Socket.c has it, Socket.h does not
+extern ClientStates* bstate; ///< the client states of MQTTClient.c
+
+static const size_t gPacketBenchLens[] = {100, 1000, 100000, 10000000};
+
+static struct
+{
+    int pair[2];
+    Clients client; ///< of the socket pair, the qos1 publishes look it up for its persistence
+    hi_u32 packets;
+    char drain[CN_PACKET_BENCH_PACKETMAX * CN_PACKET_BENCH_BATCH];
+} gPacketBench;
+
+static hi_void PacketBenchCostGet(PacketBenchCost_t *cost)
+{
+    cost->us = hi_get_us();
+    HostAllocGetStat(&cost->alloc);
+    cost->writev = HostWritevGetCount();
+    return;
+}
+
+static hi_void PacketBenchCostPrint(const char *name, const PacketBenchCost_t *start, hi_u32 num)
+{
+    PacketBenchCost_t end;
+
+    PacketBenchCostGet(&end);
+    num = (num == 0) ? 1 : num;
+    (void)printf("%s n=%u ns_per_packet=%.1f allocs_per_packet=%.2f writev_per_packet=%.2f\n", name, num,
+        (double)(end.us - start->us) * 1000 / num, (double)(end.alloc.allocCnt - start->alloc.allocCnt) / num,
+        (double)(end.writev - start->writev) / num);
+    return;
+}
+
+static hi_void PacketBenchEncode(hi_void)
+{
+    char buf[4];
+    hi_u32 sink = 0;
+    hi_u64 startUs;
+    hi_u32 i;
+    hi_u32 j;
+
+    for (i = 0; i < sizeof(gPacketBenchLens) / sizeof(gPacketBenchLens[0]); i++)
+    {
+        startUs = hi_get_us();
+        for (j = 0; j < CN_PACKET_BENCH_ENCODES; j++)
+        {
+            sink += (hi_u32)MQTTPacket_encode(buf, gPacketBenchLens[i] + (j & 1));
+            sink += (hi_u8)buf[0];
+        }
+        (void)printf("packet.encode length=%zu bytes=%d ns_per_call=%.2f sink=%u\n", gPacketBenchLens[i],
+            MQTTPacket_encode(buf, gPacketBenchLens[i]), (double)(hi_get_us() - startUs) * 1000 / CN_PACKET_BENCH_ENCODES,
+            sink);
+    }
+    return;
+}
+
+static hi_void PacketBenchPutString(char **ptr, const char *str)
+{
+    size_t len = strlen(str);
+
+    *(*ptr)++ = (char)(len >> 8);
+    *(*ptr)++ = (char)(len & 0xff);
+    (void)memcpy(*ptr, str, len);
+    *ptr += len;
+    return;
+}
+
+///< a qos1 command as the platform sends it, in MQTT 3.1.1 or 5 with a message expiry
+static hi_void PacketBenchMakePublish(PacketBenchPacket_t *packet, int version)
+{
+    char body[CN_PACKET_BENCH_PACKETMAX];
+    char *ptr = body;
+    int bodyLen;
+
+    PacketBenchPutString(&ptr, CN_PACKET_BENCH_TOPIC);
+    *ptr++ = (char)(CN_PACKET_BENCH_MSGID >> 8);
+    *ptr++ = (char)(CN_PACKET_BENCH_MSGID & 0xff);
+    if (version >= MQTTVERSION_5)
+    {
+        *ptr++ = 5;
+        *ptr++ = CN_PACKET_BENCH_EXPIRY;
+        (void)memset(ptr, 0, 3);
+        ptr += 3;
+        *ptr++ = 60;
+    }
+    (void)memcpy(ptr, CN_PACKET_BENCH_PAYLOAD, strlen(CN_PACKET_BENCH_PAYLOAD));
+    ptr += strlen(CN_PACKET_BENCH_PAYLOAD);
+    bodyLen = (int)(ptr - body);
+
+    packet->name = (version >= MQTTVERSION_5) ? "publish5" : "publish";
+    packet->version = version;
+    packet->type = PUBLISH;
+    packet->buf[0] = (char)((PUBLISH << 4) | (1 << 1));
+    packet->len = 1 + MQTTPacket_encode(&packet->buf[1], (size_t)bodyLen);
+    (void)memcpy(&packet->buf[packet->len], body, (size_t)bodyLen);
+    packet->len += bodyLen;
+    return;
+}
+
+static hi_void PacketBenchMakePuback(PacketBenchPacket_t *packet)
+{
+    packet->name = "puback";
+    packet->version = MQTTVERSION_3_1_1;
+    packet->type = PUBACK;
+    packet->buf[0] = (char)(PUBACK << 4);
+    packet->buf[1] = 2;
+    packet->buf[2] = (char)(CN_PACKET_BENCH_MSGID >> 8);
+    packet->buf[3] = (char)(CN_PACKET_BENCH_MSGID & 0xff);
+    packet->len = 4;
+    return;
+}
+
+static int PacketBenchCheck(const PacketBenchPacket_t *packet, MQTTPacket *pack)
+{
+    Publish *pub;
+
+    if (pack->header.bits.type != packet->type)
+    {
+        return -1;
+    }
+    if (packet->type != PUBLISH)
+    {
+        return (((Puback *)pack)->msgId == CN_PACKET_BENCH_MSGID) ? 0 : -1;
+    }
+    pub = (Publish *)pack;
+    if ((pub->msgId != CN_PACKET_BENCH_MSGID) || (pub->payloadlen != (int)strlen(CN_PACKET_BENCH_PAYLOAD)) ||
+        (0 != memcmp(pub->payload, CN_PACKET_BENCH_PAYLOAD, (size_t)pub->payloadlen)) ||
+        (0 != strcmp(pub->topic, CN_PACKET_BENCH_TOPIC)) ||
+        ((packet->version >= MQTTVERSION_5) && (pub->properties.count != 1)))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static int PacketBenchFactory(const PacketBenchPacket_t *packet)
+{
+    PacketBenchCost_t cost;
+    networkHandles net;
+    char out[CN_PACKET_BENCH_PACKETMAX * CN_PACKET_BENCH_BATCH];
+    char name[CN_PACKET_BENCH_PACKETMAX];
+    MQTTPacket *pack;
+    hi_u32 got = 0;
+    hi_u32 bad = 0;
+    hi_u32 n;
+    hi_u32 i;
+    int rc;
+
+    for (i = 0; i < CN_PACKET_BENCH_BATCH; i++)
+    {
+        (void)memcpy(out + (size_t)packet->len * i, packet->buf, (size_t)packet->len);
+    }
+    (void)memset(&net, 0, sizeof(net));
+    net.socket = gPacketBench.pair[0];
+
+    PacketBenchCostGet(&cost);
+    for (n = 0; n < gPacketBench.packets / CN_PACKET_BENCH_BATCH; n++)
+    {
+        ///< the batch is smaller than the socket buffer, so it is all there for the reads
+        if ((ssize_t)((size_t)packet->len * CN_PACKET_BENCH_BATCH) !=
+            write(gPacketBench.pair[1], out, (size_t)packet->len * CN_PACKET_BENCH_BATCH))
+        {
+            break;
+        }
+        for (i = 0; i < CN_PACKET_BENCH_BATCH; i++)
+        {
+            if ((pack = MQTTPacket_Factory(packet->version, &net, &rc)) == NULL)
+            {
+                break;
+            }
+            bad += (0 == PacketBenchCheck(packet, pack)) ? 0 : 1;
+            MQTTPacket_free_packet(pack);
+            got++;
+        }
+        if (i < CN_PACKET_BENCH_BATCH)
+        {
+            break;
+        }
+    }
+    (void)snprintf(name, sizeof(name), "packet.factory packet=%s bytes=%d", packet->name, packet->len);
+    PacketBenchCostPrint(name, &cost, got);
+    if ((got != n * CN_PACKET_BENCH_BATCH) || (got == 0) || (bad != 0))
+    {
+        (void)printf("packet.factory packet=%s failed=1 got=%u bad=%u\n", packet->name, got, bad);
+        return -1;
+    }
+    return 0;
+}
+
+static int PacketBenchSend(const char *kind, int version, int qos)
+{
+    PacketBenchCost_t cost;
+    networkHandles net;
+    Publish pub;
+    MQTTProperty alias;
+    char name[CN_PACKET_BENCH_PACKETMAX];
+    ssize_t len;
+    hi_u64 bytes = 0;
+    hi_u32 sent = 0;
+    hi_u32 n;
+    hi_u32 i;
+
+    (void)memset(&net, 0, sizeof(net));
+    net.socket = gPacketBench.pair[0];
+    (void)memset(&pub, 0, sizeof(pub));
+    pub.topic = CN_PACKET_BENCH_REPORT;
+    pub.topiclen = (int)strlen(CN_PACKET_BENCH_REPORT);
+    pub.payload = CN_PACKET_BENCH_PROPS;
+    pub.payloadlen = (int)strlen(CN_PACKET_BENCH_PROPS);
+    pub.msgId = CN_PACKET_BENCH_MSGID;
+    pub.MQTTVersion = version;
+    pub.properties = (MQTTProperties)MQTTProperties_initializer;
+    if (version >= MQTTVERSION_5)
+    {
+        alias.identifier = MQTTPROPERTY_CODE_TOPIC_ALIAS;
+        alias.value.integer2 = 1;
+        (void)MQTTProperties_add(&pub.properties, &alias);
+    }
+
+    gPacketBench.client.MQTTVersion = version;
+    PacketBenchCostGet(&cost);
+    for (n = 0; n < gPacketBench.packets / CN_PACKET_BENCH_BATCH; n++)
+    {
+        for (i = 0; i < CN_PACKET_BENCH_BATCH; i++)
+        {
+            if (TCPSOCKET_COMPLETE != MQTTPacket_send_publish(&pub, 0, qos, 0, &net, "packet_bench"))
+            {
+                break;
+            }
+            sent++;
+        }
+        ///< the peer reads what the batch wrote, the batch is smaller than the socket buffer
+        while ((len = recv(gPacketBench.pair[1], gPacketBench.drain, sizeof(gPacketBench.drain), MSG_DONTWAIT)) > 0)
+        {
+            bytes += (hi_u64)len;
+        }
+        if (i < CN_PACKET_BENCH_BATCH)
+        {
+            break;
+        }
+    }
+    (void)snprintf(name, sizeof(name), "packet.send packet=%s qos=%d bytes=%.0f", kind, qos,
+        (double)bytes / ((sent == 0) ? 1 : sent));
+    PacketBenchCostPrint(name, &cost, sent);
+    MQTTProperties_free(&pub.properties);
+    if ((sent != n * CN_PACKET_BENCH_BATCH) || (sent == 0))
+    {
+        (void)printf("packet.send packet=%s qos=%d failed=1 sent=%u\n", kind, qos, sent);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    PacketBenchPacket_t packets[3];
+    hi_u32 i;
+    int opt;
+    int ret = 0;
+
+    gPacketBench.packets = CN_PACKET_BENCH_PACKETS;
+    while ((opt = getopt(argc, argv, "n:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                gPacketBench.packets = (hi_u32)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                (void)fprintf(stderr, "usage: %s [-n packets]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (gPacketBench.packets < CN_PACKET_BENCH_BATCH)
+    {
+        gPacketBench.packets = CN_PACKET_BENCH_BATCH;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    Heap_initialize(); ///< as MQTTClient_create and MQTTAsync_create do
+    Socket_outInitialize();
+    if ((0 != socketpair(AF_UNIX, SOCK_STREAM, 0, gPacketBench.pair)) || (0 != Socket_addSocket(gPacketBench.pair[0])))
+    {
+        (void)printf("packet failed=socketpair\n");
+        return 1;
+    }
+    bstate->clients = ListInitialize();
+    gPacketBench.client.clientID = "packet_bench";
+    gPacketBench.client.MQTTVersion = MQTTVERSION_3_1_1;
+    gPacketBench.client.connected = 1;
+    gPacketBench.client.good = 1;
+    gPacketBench.client.net.socket = gPacketBench.pair[0];
+    ListAppend(bstate->clients, &gPacketBench.client, sizeof(gPacketBench.client));
+
+    PacketBenchEncode();
+    PacketBenchMakePublish(&packets[0], MQTTVERSION_3_1_1);
+    PacketBenchMakePublish(&packets[1], MQTTVERSION_5);
+    PacketBenchMakePuback(&packets[2]);
+    for (i = 0; i < sizeof(packets) / sizeof(packets[0]); i++)
+    {
+        ret |= PacketBenchFactory(&packets[i]);
+    }
+    ret |= PacketBenchSend("publish", MQTTVERSION_3_1_1, 0);
+    ret |= PacketBenchSend("publish", MQTTVERSION_3_1_1, 1);
+    ret |= PacketBenchSend("publish5", MQTTVERSION_5, 1);
+
+    (void)close(gPacketBench.pair[1]); ///< first, so that the recv of Socket_close does not wait
+    Socket_close(gPacketBench.pair[0]);
+    ListFreeNoContent(bstate->clients);
+    Socket_outTerminate();
+    Heap_terminate();
+    return (ret == 0) ? 0 : 1;
+}
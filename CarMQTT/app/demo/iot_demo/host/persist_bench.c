@@ -0,0 +1,345 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, qos1 publish rate and restore time of the paho persistence stores
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-18
+ */
+
+/**
+ * A client of paho's protocol layer publishes qos1 messages with a window of them inflight, the
+ * puback of the oldest going through MQTTProtocol_handlePubacks before the next is published, so
+ * each message is one put and one remove of the persistence. Then it publishes messages without
+ * an ack, closes the persistence as a restart would and opens it again, which restores them.
+ *
+ * The stores are the default one, a file per message, and the log store of MQTTPersistenceLog.c
+ * with no sync, with a sync per 64 records or 50 ms, and with a sync per record. The default
+ * store does not sync at all, log is the one to compare it with.
+ *
+ * The publishes go to a local socket pair, a thread reads them away. The stores are under the
+ * directory of -d, out/persist by default. -s is the segment size of the log store, small ones
+ * have it compact as it goes.
+ *
+ * The default store looks through its directory for each message it restores, which is why it
+ * restores fewer than it publishes by default.
+ *
+ * One "name key=value ..." line per store, the exit code is not 0 if a store failed or did not
+ * restore all the messages.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <hi_types_base.h>
+#include <hi_time.h>
+#include "Heap.h"
+#include "MQTTClient.h" ///< MQTTVERSION_3_1_1
+#include "MQTTPacket.h"
+#include "MQTTPersistence.h"
+#include "MQTTPersistenceLog.h"
+#include "MQTTProtocolClient.h"
+#include "Socket.h"
+
+#define CN_PERSIST_BENCH_MSGS 5000
+#define CN_PERSIST_BENCH_WINDOW 10
+#define CN_PERSIST_BENCH_RESTORE 1000
+#define CN_PERSIST_BENCH_DIR "out/persist"
+#define CN_PERSIST_BENCH_URI "tcp://127.0.0.1:1883"
+#define CN_PERSIST_BENCH_DRAIN 4096
+#define CN_PERSIST_BENCH_TOPIC "$oc/devices/5f0c2f1a_car/sys/properties/report"
+#define CN_PERSIST_BENCH_PAYLOAD "{\"services\":[{\"service_id\":\"CarStatus\",\"properties\":{\"speed\":50}}]}"
+
+int Socket_addSocket(int newSd); ///< Socket.c has it, Socket.h does not
+extern ClientStates* bstate; ///< the client states of MQTTClient.c
+
+typedef struct
+{
+    const char *name;
+    int type;         ///< MQTTCLIENT_PERSISTENCE_DEFAULT or MQTTCLIENT_PERSISTENCE_USER for the log store
+    int syncRecords;  ///< of the log store
+    int syncMs;       ///< of the log store
+} PersistBenchStore_t;
+
+static const PersistBenchStore_t gPersistBenchStores[] = {
+    {"default", MQTTCLIENT_PERSISTENCE_DEFAULT, 0, 0},
+    {"log", MQTTCLIENT_PERSISTENCE_USER, 0, 0},
+    {"log_group", MQTTCLIENT_PERSISTENCE_USER, 64, 50},
+    {"log_sync", MQTTCLIENT_PERSISTENCE_USER, 1, 0},
+};
+
+static struct
+{
+    char *dir;
+    hi_u32 msgs;
+    hi_u32 window;
+    hi_u32 restore;
+    size_t segmentSize;
+    MQTTClient_persistence logPersistence;  ///< the user persistence, valid while it is open
+    MQTTPersistenceLog_options logOptions;
+} gPersistBench;
+
+static void *PersistBenchDrain(void *arg)
+{
+    char buf[CN_PERSIST_BENCH_DRAIN];
+    int fd = *(int *)arg;
+
+    while (read(fd, buf, sizeof(buf)) > 0)
+    {
+    }
+    return NULL;
+}
+
+static int PersistBenchOpen(Clients *client, const PersistBenchStore_t *store)
+{
+    MQTTPersistenceLog_options options = MQTTPersistenceLog_options_initializer;
+    void *context = gPersistBench.dir;
+
+    if (store->type == MQTTCLIENT_PERSISTENCE_USER)
+    {
+        options.directory = gPersistBench.dir;
+        options.segment_size = gPersistBench.segmentSize;
+        options.sync_records = store->syncRecords;
+        options.sync_ms = store->syncMs;
+        gPersistBench.logOptions = options;
+        if (0 != MQTTPersistenceLog_create(&gPersistBench.logPersistence, &gPersistBench.logOptions))
+        {
+            return -1;
+        }
+        context = &gPersistBench.logPersistence;
+    }
+    if (0 != MQTTPersistence_create(&client->persistence, store->type, context))
+    {
+        return -1;
+    }
+    return MQTTPersistence_initialize(client, CN_PERSIST_BENCH_URI);
+}
+
+///< as a restart, the messages inflight are only in the store
+static int PersistBenchClose(Clients *client)
+{
+    int ret = MQTTPersistence_close(client);
+
+    MQTTProtocol_emptyMessageList(client->outboundMsgs);
+    MessageIDs_clear(&client->outboundIDs);
+    return ret;
+}
+
+static int PersistBenchPublish(Clients *client)
+{
+    Publish publish;
+    Messages *m = NULL;
+    int msgid;
+
+    if ((msgid = MQTTProtocol_assignMsgId(client)) == 0)
+    {
+        return -1;
+    }
+    (void)memset(&publish, 0, sizeof(publish));
+    publish.header.bits.type = PUBLISH;
+    publish.header.bits.qos = 1;
+    publish.msgId = msgid;
+    publish.MQTTVersion = MQTTVERSION_3_1_1;
+    publish.topic = MQTTStrdup(CN_PERSIST_BENCH_TOPIC); ///< the message keeps the topic, the payload is copied
+    publish.topiclen = (int)strlen(CN_PERSIST_BENCH_TOPIC);
+    publish.payload = MQTTStrdup(CN_PERSIST_BENCH_PAYLOAD);
+    publish.payloadlen = (int)strlen(CN_PERSIST_BENCH_PAYLOAD);
+    if (TCPSOCKET_COMPLETE != MQTTProtocol_startPublish(client, &publish, 1, 0, &m))
+    {
+        msgid = -1;
+    }
+    free(publish.payload);
+    return msgid;
+}
+
+static int PersistBenchAck(Clients *client, int msgid)
+{
+    Puback *ack = malloc(sizeof(Puback)); ///< handlePubacks frees it, as it does the received ones
+
+    if (ack == NULL)
+    {
+        return -1;
+    }
+    (void)memset(ack, 0, sizeof(Puback));
+    ack->header.bits.type = PUBACK;
+    ack->msgId = msgid;
+    ack->MQTTVersion = MQTTVERSION_3_1_1;
+    return MQTTProtocol_handlePubacks(ack, client->net.socket);
+}
+
+///< acks what is inflight, the restored messages among them
+static int PersistBenchAckAll(Clients *client)
+{
+    int ret = 0;
+
+    while ((ret == 0) && (client->outboundMsgs->count > 0))
+    {
+        ret = PersistBenchAck(client, ((Messages *)(client->outboundMsgs->first->content))->msgid);
+    }
+    return ret;
+}
+
+static int PersistBenchRun(Clients *client, const PersistBenchStore_t *store)
+{
+    int *window;
+    hi_u64 publishUs;
+    hi_u64 restoreUs;
+    hi_u32 restored = 0;
+    hi_u32 i;
+    int ret = -1;
+
+    window = malloc(gPersistBench.window * sizeof(int));
+    if (window == NULL)
+    {
+        return -1;
+    }
+    ///< what a run before left behind is not restored
+    if ((0 != PersistBenchOpen(client, store)) || (0 != PersistBenchAckAll(client)) ||
+        (0 != MQTTPersistence_clear(client)))
+    {
+        goto EXIT;
+    }
+
+    publishUs = hi_get_us();
+    for (i = 0; i < gPersistBench.msgs; i++)
+    {
+        if ((i >= gPersistBench.window) && (0 != PersistBenchAck(client, window[i % gPersistBench.window])))
+        {
+            goto EXIT;
+        }
+        if ((window[i % gPersistBench.window] = PersistBenchPublish(client)) <= 0)
+        {
+            goto EXIT;
+        }
+    }
+    if (0 != PersistBenchAckAll(client))
+    {
+        goto EXIT;
+    }
+    publishUs = hi_get_us() - publishUs;
+
+    for (i = 0; i < gPersistBench.restore; i++)
+    {
+        if (PersistBenchPublish(client) <= 0)
+        {
+            goto EXIT;
+        }
+    }
+    if (0 != PersistBenchClose(client))
+    {
+        goto EXIT;
+    }
+    restoreUs = hi_get_us();
+    if (0 != PersistBenchOpen(client, store))
+    {
+        goto EXIT;
+    }
+    restoreUs = hi_get_us() - restoreUs;
+    restored = (hi_u32)client->outboundMsgs->count;
+    if (0 != PersistBenchAckAll(client))
+    {
+        goto EXIT;
+    }
+
+    (void)printf("persist.%s msgs=%u window=%u msgs_per_s=%.0f restore=%u restored=%u restore_ms=%.3f\n",
+        store->name, gPersistBench.msgs, gPersistBench.window,
+        (publishUs > 0) ? (double)gPersistBench.msgs * 1000000 / publishUs : 0.0, gPersistBench.restore,
+        restored, (double)restoreUs / 1000);
+    ret = (restored == gPersistBench.restore) ? 0 : -1;
+
+EXIT:
+    if (ret != 0)
+    {
+        (void)printf("persist.%s failed=1\n", store->name);
+    }
+    (void)PersistBenchClose(client); ///< nothing is left in the store, it removes its directory
+    free(window);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    MQTTPersistenceLog_options options = MQTTPersistenceLog_options_initializer;
+    Clients client;
+    pthread_t drain;
+    int pair[2];
+    hi_u32 i;
+    int opt;
+    int ret = 0;
+
+    gPersistBench.dir = CN_PERSIST_BENCH_DIR;
+    gPersistBench.msgs = CN_PERSIST_BENCH_MSGS;
+    gPersistBench.window = CN_PERSIST_BENCH_WINDOW;
+    gPersistBench.restore = CN_PERSIST_BENCH_RESTORE;
+    gPersistBench.segmentSize = options.segment_size;
+    while ((opt = getopt(argc, argv, "d:n:w:r:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'd':
+                gPersistBench.dir = optarg;
+                break;
+            case 'n':
+                gPersistBench.msgs = (hi_u32)strtoul(optarg, NULL, 0);
+                break;
+            case 'w':
+                gPersistBench.window = (hi_u32)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                gPersistBench.restore = (hi_u32)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                gPersistBench.segmentSize = (size_t)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                (void)fprintf(stderr, "usage: %s [-d dir] [-n messages] [-w window] [-r restored] [-s segment bytes]\n",
+                    argv[0]);
+                return 2;
+        }
+    }
+    if ((gPersistBench.window == 0) || (gPersistBench.window >= MAX_MSG_ID) || (gPersistBench.restore >= MAX_MSG_ID))
+    {
+        (void)fprintf(stderr, "the window and the restored messages are message ids, 1 to %d\n", MAX_MSG_ID - 1);
+        return 2;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    (void)mkdir(gPersistBench.dir, S_IRWXU);
+    Heap_initialize(); ///< as MQTTClient_create and MQTTAsync_create do
+    Socket_outInitialize();
+    bstate->clients = ListInitialize();
+    if ((0 != socketpair(AF_UNIX, SOCK_STREAM, 0, pair)) || (0 != Socket_addSocket(pair[0])))
+    {
+        (void)printf("persist failed=socketpair\n");
+        return 1;
+    }
+    ///< the publishes wait for the reader rather than going to the pending writes
+    (void)fcntl(pair[0], F_SETFL, fcntl(pair[0], F_GETFL) & ~O_NONBLOCK);
+    if (0 != pthread_create(&drain, NULL, PersistBenchDrain, &pair[1]))
+    {
+        return 1;
+    }
+
+    (void)memset(&client, 0, sizeof(client));
+    client.clientID = "bench";
+    client.MQTTVersion = MQTTVERSION_3_1_1;
+    client.connected = 1;
+    client.good = 1;
+    client.net.socket = pair[0];
+    client.outboundMsgs = ListInitialize();
+    client.inboundMsgs = ListInitialize();
+    client.messageQueue = ListInitialize();
+    ListAppend(bstate->clients, &client, sizeof(client));
+
+    for (i = 0; i < sizeof(gPersistBenchStores) / sizeof(gPersistBenchStores[0]); i++)
+    {
+        ret |= PersistBenchRun(&client, &gPersistBenchStores[i]);
+    }
+
+    (void)shutdown(pair[0], SHUT_WR);
+    (void)pthread_join(drain, NULL);
+    (void)close(pair[1]); ///< first, the blocking socket would wait in the recv of Socket_close
+    Socket_close(pair[0]);
+    return (ret == 0) ? 0 : 1;
+}
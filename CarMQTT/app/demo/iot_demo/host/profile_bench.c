@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, cost of writing the profile payloads against the cJSON tree they were printed from
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-30
+ */
+
+/**
+ * The property reports and the command responses are written by iot_profile_fmt.c into the caller
+ * buffer. Before that iot_profile.c built a cJSON tree of them and printed it, which profile_ref.c
+ * keeps as the reference of iot_test; both ways run here on the same payloads.
+ *
+ * report: the car status of the demo, one service with an int, a double and a string.
+ * reports: three services of four properties each, as the shadow sends after a resync.
+ * cmdresp: a response with its name and two paras.
+ *
+ * Both ways must print the same bytes, the exit code is not 0 if they do not.
+ *
+ * One "name key=value ..." line per way and payload.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <cJSON.h>
+#include <hi_types_base.h>
+#include <hi_time.h>
+#include "iot_profile.h"
+#include "iot_profile_fmt.h"
+#include "profile_ref.h"
+
+#define CN_PROFILE_BENCH_MSGS 200000
+#define CN_PROFILE_BENCH_SERVICES 3
+#define CN_PROFILE_BENCH_KVS 4
+
+static struct
+{
+    IoTProfileKV_t kv[CN_PROFILE_BENCH_SERVICES][CN_PROFILE_BENCH_KVS];
+    IoTProfileService_t service[CN_PROFILE_BENCH_SERVICES];
+    IoTCmdResp_t resp;
+    double speed;
+    double temp;
+    hi_u32 msgs;
+} gProfileBench;
+
+static hi_void ProfileBenchMake(hi_void)
+{
+    static char *serviceID[CN_PROFILE_BENCH_SERVICES] = {"CAR_CTRL", "SENSOR", "LIGHT"};
+    IoTProfileKV_t *kv;
+    hi_u32 i;
+
+    gProfileBench.speed = 12.5;
+    gProfileBench.temp = 23.375;
+    for (i = 0; i < CN_PROFILE_BENCH_SERVICES; i++)
+    {
+        kv = gProfileBench.kv[i];
+        kv[0] = (IoTProfileKV_t){&kv[1], "CAR_STATUS", NULL, 1000 + i, EN_IOT_DATATYPE_INT};
+        kv[1] = (IoTProfileKV_t){&kv[2], "SPEED", (const char *)&gProfileBench.speed, 0, EN_IOT_DATATYPE_DOUBLE};
+        kv[2] = (IoTProfileKV_t){&kv[3], "DIRECTION", "GO_FORWARD", 0, EN_IOT_DATATYPE_STRING};
+        kv[3] = (IoTProfileKV_t){NULL, "TEMPERATURE", (const char *)&gProfileBench.temp, 0, EN_IOT_DATATYPE_DOUBLE};
+        gProfileBench.service[i].serviceID = serviceID[i];
+        gProfileBench.service[i].serviceProperty = &kv[0];
+        gProfileBench.service[i].nxt = ((i + 1) < CN_PROFILE_BENCH_SERVICES) ? &gProfileBench.service[i + 1] : NULL;
+    }
+    gProfileBench.resp.retCode = 0;
+    gProfileBench.resp.respName = "CAR_CTRL_RESP";
+    gProfileBench.resp.requestID = "3a4b1c2d";
+    gProfileBench.resp.paras = &gProfileBench.kv[0][2];
+    return;
+}
+
+///< one payload each way, NULL service for the response
+static int ProfileBenchRun(const char *name, IoTProfileService_t *service)
+{
+    char buf[CN_PROFILE_MSG_SIZE];
+    char *ref;
+    hi_u64 startUs;
+    hi_u64 fmtUs;
+    hi_u64 refUs;
+    hi_u32 i;
+    int len = -1;
+    int ret;
+
+    ref = (service != NULL) ? RefPropertyReport(service) : RefCmdResp(&gProfileBench.resp);
+    len = (service != NULL) ? IoTProfileFmtPropertyReport(buf, sizeof(buf), service) :
+        IoTProfileFmtCmdResp(buf, sizeof(buf), &gProfileBench.resp);
+    ret = ((ref != NULL) && (len == (int)strlen(ref)) && (0 == strcmp(buf, ref))) ? 0 : -1;
+    cJSON_free(ref);
+    if (ret != 0)
+    {
+        (void)printf("profile failed=mismatch payload=%s\n", name);
+        return -1;
+    }
+
+    startUs = hi_get_us();
+    for (i = 0; i < gProfileBench.msgs; i++)
+    {
+        gProfileBench.kv[0][0].i_value = i;
+        len = (service != NULL) ? IoTProfileFmtPropertyReport(buf, sizeof(buf), service) :
+            IoTProfileFmtCmdResp(buf, sizeof(buf), &gProfileBench.resp);
+    }
+    fmtUs = hi_get_us() - startUs;
+
+    startUs = hi_get_us();
+    for (i = 0; i < gProfileBench.msgs; i++)
+    {
+        gProfileBench.kv[0][0].i_value = i;
+        ref = (service != NULL) ? RefPropertyReport(service) : RefCmdResp(&gProfileBench.resp);
+        cJSON_free(ref);
+    }
+    refUs = hi_get_us() - startUs;
+
+    (void)printf("profile.fmt payload=%s bytes=%d ns_per_msg=%.1f\n", name, len,
+        (double)fmtUs * 1000 / gProfileBench.msgs);
+    (void)printf("profile.cjson payload=%s bytes=%d ns_per_msg=%.1f\n", name, len,
+        (double)refUs * 1000 / gProfileBench.msgs);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    IoTProfileService_t one;
+    int opt;
+    int ret = 0;
+
+    gProfileBench.msgs = CN_PROFILE_BENCH_MSGS;
+    while ((opt = getopt(argc, argv, "n:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                gProfileBench.msgs = (hi_u32)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                (void)fprintf(stderr, "usage: %s [-n messages]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (gProfileBench.msgs == 0)
+    {
+        gProfileBench.msgs = 1;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    ProfileBenchMake();
+
+    one = gProfileBench.service[0];
+    one.nxt = NULL;
+    gProfileBench.kv[0][2].nxt = NULL;
+    ret |= ProfileBenchRun("report", &one);
+    gProfileBench.kv[0][2].nxt = &gProfileBench.kv[0][3];
+    ret |= ProfileBenchRun("reports", &gProfileBench.service[0]);
+    ret |= ProfileBenchRun("cmdresp", NULL);
+    return (ret == 0) ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, the profile payloads as the cJSON tree of the earlier iot_profile.c printed them
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-30
+ */
+#include <cJSON.h>
+#include <hi_types_base.h>
+#include "iot_config.h"
+#include "profile_ref.h"
+
+static cJSON *RefKvs(IoTProfileKV_t *kv)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON *item;
+
+    for (; kv != NULL; kv = kv->nxt)
+    {
+        switch (kv->type)
+        {
+            case EN_IOT_DATATYPE_INT:
+                item = cJSON_CreateNumber(kv->i_value);
+                break;
+            case EN_IOT_DATATYPE_LONG:
+                item = cJSON_CreateNumber((double)(*(long *)kv->value));
+                break;
+            ///< -0 goes in as 0: this cJSON prints it "-0", the payloads print "0" as later cJSON does
+            case EN_IOT_DATATYPE_FLOAT:
+                item = cJSON_CreateNumber((*(float *)kv->value == 0) ? 0 : (double)(*(float *)kv->value));
+                break;
+            case EN_IOT_DATATYPE_DOUBLE:
+                item = cJSON_CreateNumber((*(double *)kv->value == 0) ? 0 : *(double *)kv->value);
+                break;
+            default:
+                item = cJSON_CreateString(kv->value);
+                break;
+        }
+        cJSON_AddItemToObject(root, kv->key, item);
+    }
+    return root;
+}
+
+char *RefPropertyReport(IoTProfileService_t *service)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON *services = cJSON_CreateArray();
+    cJSON *item;
+    char *ret;
+
+    for (; service != NULL; service = service->nxt)
+    {
+        item = cJSON_CreateObject();
+        cJSON_AddItemToObject(item, "service_id", cJSON_CreateString(service->serviceID));
+        cJSON_AddItemToObject(item, "properties", RefKvs(service->serviceProperty));
+        if (service->eventTime != NULL)
+        {
+            cJSON_AddItemToObject(item, "event_time", cJSON_CreateString(service->eventTime));
+        }
+        cJSON_AddItemToArray(services, item);
+    }
+    cJSON_AddItemToObject(root, "services", services);
+    ret = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return ret;
+}
+
+char *RefCmdResp(IoTCmdResp_t *resp)
+{
+    cJSON *root = cJSON_CreateObject();
+    char *ret;
+
+    cJSON_AddItemToObject(root, "result_code", cJSON_CreateNumber(resp->retCode));
+    if (resp->respName != NULL)
+    {
+        cJSON_AddItemToObject(root, "response_name", cJSON_CreateString(resp->respName));
+    }
+    if (resp->paras != NULL)
+    {
+        cJSON_AddItemToObject(root, "paras", RefKvs(resp->paras));
+    }
+    ret = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return ret;
+}
+
+char *RefEvent(const char *deviceID, IoTProfileEvent_t *event)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON *services = cJSON_CreateArray();
+    cJSON *item = cJSON_CreateObject();
+    char *ret;
+
+    cJSON_AddItemToObject(root, "object_device_id", cJSON_CreateString((deviceID != NULL) ? deviceID : CONFIG_DEVICE_ID));
+    cJSON_AddItemToObject(item, "service_id", cJSON_CreateString(event->serviceID));
+    cJSON_AddItemToObject(item, "event_type", cJSON_CreateString(event->eventType));
+    if (event->eventTime != NULL)
+    {
+        cJSON_AddItemToObject(item, "event_time", cJSON_CreateString(event->eventTime));
+    }
+    cJSON_AddItemToObject(item, "paras", RefKvs(event->paras));
+    cJSON_AddItemToArray(services, item);
+    cJSON_AddItemToObject(root, "services", services);
+    ret = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return ret;
+}
@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, the profile payloads as the cJSON tree of the earlier iot_profile.c printed them
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-30
+ */
+#ifndef PROFILE_REF_H_
+#define PROFILE_REF_H_
+
+#include "iot_profile.h"
+
+/**
+ * The reference iot_profile_fmt.c must match byte for byte, -0 goes in as 0 as later cJSON prints it.
+ * The returned string is freed with cJSON_free().
+*/
+char *RefPropertyReport(IoTProfileService_t *service);
+
+char *RefCmdResp(IoTCmdResp_t *resp);
+
+char *RefEvent(const char *deviceID, IoTProfileEvent_t *event);
+
+#endif /* PROFILE_REF_H_ */
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, cost of framing the received MQTT packets with and without the read ahead
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-12
+ */
+
+/**
+ * Paho's Socket.c and SocketBuffer.c are built twice, recv_bench with the read ahead buffer and
+ * recv_bench_direct with SOCKETBUFFER_READAHEAD 0, which reads only what is asked for as paho did.
+ *
+ * The packets are written to the peer of a local socket pair, a batch of them at once, and taken
+ * back with Socket_getReadySocket and MQTTPacket_Factory as the paho threads do. A batch of 1 is a
+ * device getting a command now and then, the larger ones a burst of acks or messages. recv is
+ * wrapped to count the calls.
+ *
+ * One "name key=value ..." line per packet kind and batch, the exit code is not 0 if a packet was
+ * lost or came back wrong.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <hi_types_base.h>
+#include <hi_time.h>
+#include "Heap.h"
+#include "MQTTClient.h" ///< MQTTVERSION_3_1_1
+#include "MQTTPacket.h"
+#include "Socket.h"
+#include "SocketBuffer.h"
+#include "Thread.h"
+
+#if SOCKETBUFFER_READAHEAD > 0
+#define CN_RECV_BENCH_VARIANT "readahead"
+#else
+#define CN_RECV_BENCH_VARIANT "direct"
+#endif
+#define CN_RECV_BENCH_PACKETS 50000
+#define CN_RECV_BENCH_WAIT_MS 100 ///< a batch that needs it has lost a packet
+#define CN_RECV_BENCH_PACKETMAX 256
+#define CN_RECV_BENCH_TOPIC "$oc/devices/5f0c2f1a_car/sys/commands/request_id=1"
+#define CN_RECV_BENCH_PAYLOAD "{\"service_id\":\"CarControl\",\"command_name\":\"Forward\",\"paras\":{\"speed\":50}}"
+
+typedef struct
+{
+    const char *name;
+    hi_u8 type;
+    char buf[CN_RECV_BENCH_PACKETMAX];
+    int len;
+} RecvBenchPacket_t;
+
+int Socket_addSocket(int newSd); ///< Socket.c has it, Socket.h does not
+int __real_recv(int sockfd, void *buf, size_t len, int flags);
+
+static hi_u32 gRecvCalls = 0;
+
+int __wrap_recv(int sockfd, void *buf, size_t len, int flags)
+{
+    gRecvCalls++;
+    return __real_recv(sockfd, buf, len, flags);
+}
+
+static const hi_u32 gRecvBenchBatch[] = {1, 8, 32};
+
+static hi_void RecvBenchPutString(char **ptr, const char *str)
+{
+    size_t len = strlen(str);
+
+    *(*ptr)++ = (char)(len >> 8);
+    *(*ptr)++ = (char)(len & 0xff);
+    (void)memcpy(*ptr, str, len);
+    *ptr += len;
+    return;
+}
+
+///< a qos0 command as the platform sends it, and the puback of a qos1 publish
+static hi_void RecvBenchEncode(RecvBenchPacket_t *publish, RecvBenchPacket_t *puback)
+{
+    char body[CN_RECV_BENCH_PACKETMAX];
+    char *ptr = body;
+    int bodyLen;
+
+    RecvBenchPutString(&ptr, CN_RECV_BENCH_TOPIC);
+    (void)memcpy(ptr, CN_RECV_BENCH_PAYLOAD, strlen(CN_RECV_BENCH_PAYLOAD));
+    ptr += strlen(CN_RECV_BENCH_PAYLOAD);
+    bodyLen = (int)(ptr - body);
+
+    publish->name = "publish";
+    publish->type = PUBLISH;
+    publish->buf[0] = (char)(PUBLISH << 4);
+    publish->len = 1 + MQTTPacket_encode(&publish->buf[1], (size_t)bodyLen);
+    (void)memcpy(&publish->buf[publish->len], body, (size_t)bodyLen);
+    publish->len += bodyLen;
+
+    puback->name = "puback";
+    puback->type = PUBACK;
+    puback->buf[0] = (char)(PUBACK << 4);
+    puback->buf[1] = 2;
+    puback->buf[2] = 0;
+    puback->buf[3] = 1;
+    puback->len = 4;
+    return;
+}
+
+static int RecvBenchCheck(const RecvBenchPacket_t *packet, MQTTPacket *pack)
+{
+    if (pack->header.bits.type != packet->type)
+    {
+        return -1;
+    }
+    if (packet->type == PUBLISH)
+    {
+        Publish *pub = (Publish *)pack;
+
+        if ((pub->payloadlen != (int)strlen(CN_RECV_BENCH_PAYLOAD)) ||
+            (0 != memcmp(pub->payload, CN_RECV_BENCH_PAYLOAD, (size_t)pub->payloadlen)) ||
+            (0 != strcmp(pub->topic, CN_RECV_BENCH_TOPIC)))
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int RecvBenchRun(mutex_type mutex, int pair[2], const RecvBenchPacket_t *packet, hi_u32 batch, hi_u32 packets)
+{
+    struct timeval tp = {0, CN_RECV_BENCH_WAIT_MS * 1000};
+    networkHandles net;
+    char *out;
+    hi_u32 n;
+    hi_u32 got = 0;
+    hi_u32 bad = 0;
+    hi_u32 lost = 0;
+    hi_u32 calls;
+    hi_u64 startUs;
+    hi_u64 costUs;
+
+    out = malloc((size_t)packet->len * batch);
+    if (out == NULL)
+    {
+        return -1;
+    }
+    for (n = 0; n < batch; n++)
+    {
+        (void)memcpy(out + (size_t)packet->len * n, packet->buf, (size_t)packet->len);
+    }
+    (void)memset(&net, 0, sizeof(net));
+    net.socket = pair[0];
+
+    calls = gRecvCalls;
+    startUs = hi_get_us();
+    for (n = 0; n < packets / batch; n++)
+    {
+        hi_u32 left = batch;
+
+        if ((ssize_t)((size_t)packet->len * batch) != write(pair[1], out, (size_t)packet->len * batch))
+        {
+            lost += batch;
+            break;
+        }
+        while (left > 0)
+        {
+            MQTTPacket *pack;
+            int rc;
+
+            if (Socket_getReadySocket(0, &tp, mutex) != pair[0])
+            {
+                lost += left;
+                break;
+            }
+            pack = MQTTPacket_Factory(MQTTVERSION_3_1_1, &net, &rc);
+            if (pack == NULL)
+            {
+                if (rc == TCPSOCKET_INTERRUPTED || rc == TCPSOCKET_COMPLETE)
+                {
+                    continue; ///< the rest comes with the next wait
+                }
+                lost += left;
+                break;
+            }
+            bad += (0 == RecvBenchCheck(packet, pack)) ? 0 : 1;
+            MQTTPacket_free_packet(pack);
+            got++;
+            left--;
+        }
+        if (left > 0)
+        {
+            break;
+        }
+    }
+    costUs = hi_get_us() - startUs;
+    calls = gRecvCalls - calls;
+    free(out);
+
+    (void)printf("recv.%s packet=%s bytes=%d batch=%u msgs_per_s=%.0f recv_per_msg=%.2f cpu_us_per_msg=%.2f "
+        "lost=%u bad=%u\n", CN_RECV_BENCH_VARIANT, packet->name, packet->len, batch,
+        (costUs == 0) ? 0.0 : (double)got * 1000000 / costUs, (got == 0) ? 0.0 : (double)calls / got,
+        (got == 0) ? 0.0 : (double)costUs / got, lost, bad);
+    return ((lost == 0) && (bad == 0)) ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    RecvBenchPacket_t packets[2];
+    mutex_type mutex;
+    hi_u32 count = CN_RECV_BENCH_PACKETS;
+    int pair[2];
+    hi_u32 i;
+    hi_u32 j;
+    int ret = 0;
+
+    if (argc > 1)
+    {
+        count = (hi_u32)strtoul(argv[1], NULL, 0);
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    Heap_initialize(); ///< as MQTTClient_create and MQTTAsync_create do
+    mutex = Thread_create_mutex();
+    Socket_outInitialize();
+    RecvBenchEncode(&packets[0], &packets[1]);
+    if ((0 != socketpair(AF_UNIX, SOCK_STREAM, 0, pair)) || (0 != Socket_addSocket(pair[0])))
+    {
+        (void)printf("recv.%s failed=socketpair\n", CN_RECV_BENCH_VARIANT);
+        return 1;
+    }
+    for (i = 0; i < sizeof(packets) / sizeof(packets[0]); i++)
+    {
+        for (j = 0; j < sizeof(gRecvBenchBatch) / sizeof(gRecvBenchBatch[0]); j++)
+        {
+            ret |= RecvBenchRun(mutex, pair, &packets[i], gRecvBenchBatch[j], count);
+        }
+    }
+    Socket_close(pair[0]);
+    (void)close(pair[1]);
+    Socket_outTerminate();
+    Heap_terminate();
+    return (ret == 0) ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, cost of routing a received topic to its handlers against the filters
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-28
+ */
+
+/**
+ * A gateway subscribes for its devices: the commands, the properties get and the messages of each
+ * one, and the events of all of them through '+'. The received topics go to the handlers of the
+ * filters they match, by the trie of iot_router.c and by matching the filters one after the other,
+ * which is what the strstr of the message callback comes to with more filters.
+ *
+ * The topics are of random devices and kinds, a few of them match no filter. Both ways must call
+ * the same handlers, the exit code is not 0 if they do not.
+ *
+ * One "name key=value ..." line per way and number of filters.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <hi_types_base.h>
+#include <hi_time.h>
+#include "iot_router.h"
+
+#define CN_ROUTE_BENCH_MSGS 200000
+#define CN_ROUTE_BENCH_FILTERS 1000
+#define CN_ROUTE_BENCH_NODENUM 4096
+#define CN_ROUTE_BENCH_EDGENUM 8192
+#define CN_ROUTE_BENCH_TOPICNUM 256
+#define CN_ROUTE_BENCH_STRSIZE 80
+#define CN_ROUTE_BENCH_KINDS 3  ///< the filters of one device
+
+static const hi_u32 gRouteBenchFilters[] = {10, 100, 1000};
+
+static struct
+{
+    char filter[CN_ROUTE_BENCH_FILTERS][CN_ROUTE_BENCH_STRSIZE];
+    char topic[CN_ROUTE_BENCH_TOPICNUM][CN_ROUTE_BENCH_STRSIZE];
+    IoTRouteNode_t node[CN_ROUTE_BENCH_NODENUM];
+    hi_u16 edge[CN_ROUTE_BENCH_EDGENUM];
+    IoTRouter_t router;
+    hi_u32 msgs;
+    hi_u32 called;
+} gRouteBench;
+
+static hi_void RouteBenchHandler(int qos, const char *topic, const char *requestID, const char *payload,
+                                 hi_pvoid arg)
+{
+    (void)qos;
+    (void)topic;
+    (void)requestID;
+    (void)payload;
+    gRouteBench.called += (hi_u32)(hi_size_t)arg;
+    return;
+}
+
+///< the MQTT match of one filter, as a linear router does it for each of them
+static hi_bool RouteBenchMatch(const char *filter, const char *topic)
+{
+    if ((topic[0] == '$') && ((filter[0] == '+') || (filter[0] == '#')))
+    {
+        return HI_FALSE;
+    }
+    for (;;)
+    {
+        if (filter[0] == '#')
+        {
+            return HI_TRUE;
+        }
+        if (filter[0] == '+')
+        {
+            filter++;
+            while ((*topic != '/') && (*topic != '\0'))
+            {
+                topic++;
+            }
+        }
+        else
+        {
+            while ((*filter != '/') && (*filter != '\0') && (*filter == *topic))
+            {
+                filter++;
+                topic++;
+            }
+            if (((*filter != '/') && (*filter != '\0')) || ((*topic != '/') && (*topic != '\0')))
+            {
+                return HI_FALSE;
+            }
+        }
+        if ((*filter == '\0') || (*topic == '\0'))
+        {
+            ///< "a/#" matches "a" too
+            return ((*filter == '\0') && (*topic == '\0')) ||
+                ((*topic == '\0') && (0 == strcmp(filter, "/#")));
+        }
+        filter++;
+        topic++;
+    }
+}
+
+static hi_u32 RouteBenchLinear(hi_u32 filters, const char *topic)
+{
+    hi_u32 i;
+    hi_u32 num = 0;
+
+    for (i = 0; i < filters; i++)
+    {
+        if (RouteBenchMatch(gRouteBench.filter[i], topic))
+        {
+            RouteBenchHandler(1, topic, NULL, "{}", (hi_pvoid)(hi_size_t)(i + 1));
+            num++;
+        }
+    }
+    return num;
+}
+
+static hi_void RouteBenchMake(hi_void)
+{
+    static const char *kinds[CN_ROUTE_BENCH_KINDS] = {"sys/commands/#", "sys/properties/get/#", "sys/messages/down"};
+    static const char *topics[] = {"sys/commands/request_id=%u", "sys/properties/get/request_id=%u",
+        "sys/messages/down", "sys/events/down", "sys/shadow/get/response/request_id=%u"};
+    char kind[CN_ROUTE_BENCH_STRSIZE / 2];
+    hi_u32 i;
+
+    ///< the first filter is the '+' one, so even 10 filters take the events of every device
+    (void)snprintf(gRouteBench.filter[0], CN_ROUTE_BENCH_STRSIZE, "$oc/devices/+/sys/events/down");
+    for (i = 1; i < CN_ROUTE_BENCH_FILTERS; i++)
+    {
+        (void)snprintf(gRouteBench.filter[i], CN_ROUTE_BENCH_STRSIZE, "$oc/devices/dev%u/%s",
+            (i - 1) / CN_ROUTE_BENCH_KINDS, kinds[(i - 1) % CN_ROUTE_BENCH_KINDS]);
+    }
+    srand(1);
+    for (i = 0; i < CN_ROUTE_BENCH_TOPICNUM; i++)
+    {
+        (void)snprintf(kind, sizeof(kind), topics[rand() % (sizeof(topics) / sizeof(topics[0]))], i);
+        (void)snprintf(gRouteBench.topic[i], CN_ROUTE_BENCH_STRSIZE, "$oc/devices/dev%u/%s",
+            (hi_u32)rand() % (CN_ROUTE_BENCH_FILTERS / CN_ROUTE_BENCH_KINDS), kind);
+    }
+    return;
+}
+
+static int RouteBenchRun(hi_u32 filters)
+{
+    hi_u64 startUs;
+    hi_u64 trieUs;
+    hi_u64 linearUs;
+    hi_u32 trieCalled;
+    hi_u32 routed = 0;
+    hi_u32 i;
+
+    if (0 != IoTRouterInit(&gRouteBench.router, gRouteBench.node, CN_ROUTE_BENCH_NODENUM, gRouteBench.edge,
+        CN_ROUTE_BENCH_EDGENUM))
+    {
+        return -1;
+    }
+    for (i = 0; i < filters; i++)
+    {
+        if (0 != IoTRouterAdd(&gRouteBench.router, gRouteBench.filter[i], RouteBenchHandler, (hi_pvoid)(hi_size_t)(i + 1)))
+        {
+            return -1;
+        }
+    }
+
+    gRouteBench.called = 0;
+    startUs = hi_get_us();
+    for (i = 0; i < gRouteBench.msgs; i++)
+    {
+        routed += (IoTRouterDispatch(&gRouteBench.router, 1, gRouteBench.topic[i % CN_ROUTE_BENCH_TOPICNUM], "{}") > 0);
+    }
+    trieUs = hi_get_us() - startUs;
+    trieCalled = gRouteBench.called;
+
+    gRouteBench.called = 0;
+    startUs = hi_get_us();
+    for (i = 0; i < gRouteBench.msgs; i++)
+    {
+        (void)RouteBenchLinear(filters, gRouteBench.topic[i % CN_ROUTE_BENCH_TOPICNUM]);
+    }
+    linearUs = hi_get_us() - startUs;
+
+    (void)printf("route.trie filters=%u nodes=%u routed=%u ns_per_msg=%.1f\n", filters, gRouteBench.router.nodeUsed,
+        routed, (double)trieUs * 1000 / gRouteBench.msgs);
+    (void)printf("route.linear filters=%u ns_per_msg=%.1f\n", filters, (double)linearUs * 1000 / gRouteBench.msgs);
+    if (trieCalled != gRouteBench.called)
+    {
+        (void)printf("route failed=mismatch filters=%u\n", filters);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    hi_u32 i;
+    int opt;
+    int ret = 0;
+
+    gRouteBench.msgs = CN_ROUTE_BENCH_MSGS;
+    while ((opt = getopt(argc, argv, "n:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                gRouteBench.msgs = (hi_u32)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                (void)fprintf(stderr, "usage: %s [-n messages]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (gRouteBench.msgs == 0)
+    {
+        gRouteBench.msgs = 1;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    RouteBenchMake();
+    for (i = 0; i < sizeof(gRouteBenchFilters) / sizeof(gRouteBenchFilters[0]); i++)
+    {
+        ret |= RouteBenchRun(gRouteBenchFilters[i]);
+    }
+    return (ret == 0) ? 0 : 1;
+}
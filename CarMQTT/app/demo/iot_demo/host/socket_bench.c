@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: host build, cycle time of the paho socket wait against the number of clients
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-10
+ */
+
+/**
+ * Paho's Socket.c is built once per wait backend (socket_bench_epoll, socket_bench_poll and
+ * socket_bench_select), this is the same for all of them.
+ *
+ * For each client count the sockets are local socket pairs added with Socket_addSocket, all idle
+ * but a few. One cycle writes a byte to the peers of the busy ones and calls Socket_getReadySocket
+ * until each of them came back and got its byte read, that is what a gateway does for every few
+ * messages among many idle devices. select stops at FD_SETSIZE.
+ *
+ * One "name key=value ..." line per client count, the exit code is not 0 if a cycle did not get
+ * all the busy sockets back.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <hi_types_base.h>
+#include <hi_time.h>
+#include "Heap.h"
+#include "Socket.h"
+#include "Thread.h"
+
+#if defined(SOCKET_USE_SELECT)
+#define CN_SOCKET_BACKEND "select"
+#elif defined(SOCKET_USE_POLL)
+#define CN_SOCKET_BACKEND "poll"
+#else
+#define CN_SOCKET_BACKEND "epoll"
+#endif
+#define CN_SOCKET_BENCH_CYCLES 2000
+#define CN_SOCKET_BENCH_BUSY 4
+#define CN_SOCKET_BENCH_WAIT_MS 100 ///< a cycle that needs it has lost a socket
+
+int Socket_addSocket(int newSd); ///< Socket.c has it, Socket.h does not
+
+static const hi_u32 gSocketBenchClients[] = {16, 64, 256, 1024, 4096};
+
+static int SocketBenchRun(mutex_type mutex, hi_u32 clients, hi_u32 cycles)
+{
+    struct timeval tp = {0, CN_SOCKET_BENCH_WAIT_MS * 1000};
+    int (*pairs)[2];
+    hi_u32 opened = 0;
+    hi_u32 i;
+    hi_u32 n;
+    hi_u32 calls = 0;
+    hi_u32 lost = 0;
+    hi_u64 startUs;
+    hi_u64 costUs;
+    int ret = -1;
+
+    pairs = calloc(clients, sizeof(*pairs));
+    if (pairs == NULL)
+    {
+        goto EXIT;
+    }
+    for (opened = 0; opened < clients; opened++)
+    {
+        if (0 != socketpair(AF_UNIX, SOCK_STREAM, 0, pairs[opened]))
+        {
+            goto EXIT;
+        }
+        if (0 != Socket_addSocket(pairs[opened][0]))
+        {
+            (void)close(pairs[opened][0]);
+            (void)close(pairs[opened][1]);
+            goto EXIT;
+        }
+    }
+
+    startUs = hi_get_us();
+    for (n = 0; n < cycles; n++)
+    {
+        hi_u32 busy = (clients < CN_SOCKET_BENCH_BUSY) ? clients : CN_SOCKET_BENCH_BUSY;
+        hi_u32 got = 0;
+        char c = 0;
+
+        ///< a different few each cycle, spread over the whole range
+        for (i = 0; i < busy; i++)
+        {
+            (void)write(pairs[(n * 7 + i * (clients / busy)) % clients][1], &c, 1);
+        }
+        while (got < busy)
+        {
+            int sock = Socket_getReadySocket(0, &tp, mutex);
+
+            calls++;
+            if (sock <= 0)
+            {
+                lost++;
+                break;
+            }
+            if (1 == recv(sock, &c, 1, 0))
+            {
+                got++;
+            }
+        }
+    }
+    costUs = hi_get_us() - startUs;
+    (void)printf("socket.%s clients=%u busy=%d cycle_us=%.2f calls_per_cycle=%.2f lost=%u\n", CN_SOCKET_BACKEND,
+        clients, CN_SOCKET_BENCH_BUSY, (double)costUs / cycles, (double)calls / cycles, lost);
+    ret = (lost == 0) ? 0 : -1;
+
+EXIT:
+    for (i = 0; i < opened; i++)
+    {
+        Socket_close(pairs[i][0]);
+        (void)close(pairs[i][1]);
+    }
+    free(pairs);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    struct rlimit lim = {RLIM_INFINITY, RLIM_INFINITY};
+    mutex_type mutex;
+    hi_u32 cycles = CN_SOCKET_BENCH_CYCLES;
+    hi_u32 i;
+    int ret = 0;
+
+    if (argc > 1)
+    {
+        cycles = (hi_u32)strtoul(argv[1], NULL, 0);
+    }
+    ///< two descriptors a client
+    if ((0 == getrlimit(RLIMIT_NOFILE, &lim)) && (lim.rlim_cur < lim.rlim_max))
+    {
+        lim.rlim_cur = lim.rlim_max;
+        (void)setrlimit(RLIMIT_NOFILE, &lim);
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    Heap_initialize(); ///< as MQTTClient_create and MQTTAsync_create do
+    mutex = Thread_create_mutex();
+    Socket_outInitialize();
+    for (i = 0; i < sizeof(gSocketBenchClients) / sizeof(gSocketBenchClients[0]); i++)
+    {
+        hi_u32 clients = gSocketBenchClients[i];
+
+#if defined(SOCKET_USE_SELECT)
+        if (clients * 2 + 3 > FD_SETSIZE)
+        {
+            (void)printf("socket.%s clients=%u skipped=FD_SETSIZE\n", CN_SOCKET_BACKEND, clients);
+            continue;
+        }
+#endif
+        if ((uint64_t)clients * 2 + 16 > (uint64_t)lim.rlim_cur)
+        {
+            (void)printf("socket.%s clients=%u skipped=RLIMIT_NOFILE\n", CN_SOCKET_BACKEND, clients);
+            continue;
+        }
+        ret |= SocketBenchRun(mutex, clients, cycles);
+    }
+    Socket_outTerminate();
+    Heap_terminate();
+    return (ret == 0) ? 0 : 1;
+}
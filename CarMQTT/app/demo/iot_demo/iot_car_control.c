@@ -1,154 +1,198 @@
 #include "iot_car_control.h"
 
-#define BEGIN_SEPRATOR ':'
-#define END_SEPRATOR '}'
 #define DURATION_PARAM "DURATION"
+#define CN_CAR_CMD_MASK 15
+#define CN_CAR_CMD_SEED 359
 
 extern hi_u8 g_car_control_mode;
-extern hi_u8 g_car_modular_control_module;
-extern hi_u32 g_car_status;
+extern hi_u16 g_car_modular_control_module; ///< the types must match app_demo_robot_car.c
+extern hi_u8 g_car_status;
 extern hi_u16 g_car_direction_control_module;
 
 hi_u16 global_red_on = HI_FALSE;
 
-int MQTT_car_ctrl(int qos, const char *topic, const char *payload)
+///< the mode switches below are picked up by the robot car task
+static hi_void CarEnterStopMode(hi_void)
 {
-    char *tmp = NULL;
-    IOT_LOG_DEBUG("CAR CTRL RCVMSG:QOS:%d TOPIC:%s PAYLOAD:%s\r\n", qos, topic, payload);
-    /*app 下发的操作*/
-    printf("=============   val:%d  \n", strstr(payload, CAR_CTRL_GO_FORWARD));
-    printf("=============   val:%d  \n", strstr(payload, CAR_CTRL_TRACE_ON));
-    if (strstr(payload, CAR_CTRL_CMD_SERVICE_ID) != NULL)
-    { //小车控制
-        if ((tmp = strstr(payload, CAR_CTRL_GO_FORWARD)) != NULL)
-        { //前进
-            printf("============forward============\n");
-            g_car_control_mode = CAR_DIRECTION_CONTROL_MODE;
-            g_car_direction_control_module = CAR_STOP_TYPE; //先停止，切换模式
-            g_car_status = CAR_STOP_STATUS;
-            hi_sleep(500);
-            int val = ValofJson(payload);
-            car_go_forward();
-            hi_sleep(val);
-            car_stop();
-        }
-        else if ((tmp = strstr(payload, CAR_CTRL_GO_BACK)) != NULL)
-        { //后退
-            int val = ValofJson(payload);
-            car_go_back();
-            hi_sleep(val);
-            car_stop();
-        }
-        else if ((tmp = strstr(payload, CAR_CTRL_TURN_LEFT)) != NULL)
-        { //左转
-            int val = ValofJson(payload);
-            car_turn_left();
-            hi_sleep(val);
-            car_stop();
-        }
-        else if ((tmp = strstr(payload, CAR_CTRL_TURN_RIGHT)) != NULL)
-        { //右转
-            int val = ValofJson(payload);
-            car_turn_right();
-            hi_sleep(val);
-            car_stop();
-        }
-        else if ((tmp = strstr(payload, CAR_CTRL_STOP)) != NULL)
-        { //停止
-            // int val = ValofJson(payload);
-            // car_stop();
-            // hi_sleep(val);
-            g_car_control_mode = CAR_DIRECTION_CONTROL_MODE;
-            g_car_direction_control_module = CAR_STOP_TYPE; //停止
-            g_car_status = CAR_STOP_STATUS;
-        }
-        else if ((tmp = strstr(payload, CAR_CTRL_SPPEED_UP)) != NULL)
-        { //前进
-            car_speed_up();
-        }
-        else if ((tmp = strstr(payload, CAR_CTRL_TRACE_ON)) != NULL)
-        {
-            printf("=============TRACE_ON=============\n");
-            g_car_control_mode = CAR_MODULE_CONTROL_MODE;
-            g_car_modular_control_module = CAR_CONTROL_TRACE_TYPE; //开始寻迹
-            g_car_status = CAR_TRACE_STATUS;
-        }
-        else if ((tmp = strstr(payload, CAR_CTRL_STEER_ON)) != NULL)
-        {
-            printf("=============STEER_ON=============\n");
-            g_car_control_mode = CAR_MODULE_CONTROL_MODE;
-            g_car_modular_control_module = CAR_CONTROL_STEER_ENGINE_TYPE; //开始超声波
-            g_car_status = CAR_RUNNING_STATUS;
-        }
-        else if ((tmp = strstr(payload, CAR_CTRL_DODGE)) != NULL)
-        {
-            printf("=============CAR_AWAY=============\n");
-            int val = ValofJson(payload);
-            car_turn_left();
-            hi_sleep(val);
-            car_stop();
-            car_go_forward();
-            hi_sleep(val);
-            car_stop();
-        }
-        else if ((tmp = strstr(payload, CAR_CTRL_TRACE_FORWARD)) != NULL)
-        {
-            g_car_control_mode = CAR_DIRECTION_CONTROL_MODE;
-            g_car_direction_control_module = CAR_STOP_TYPE; //先停止，切换模式
-            g_car_status = CAR_STOP_STATUS;
-            hi_sleep(100);
-            int val = ValofJson(payload);
-            car_go_forward();
-            hi_sleep(val);
-            g_car_control_mode = CAR_MODULE_CONTROL_MODE;
-            g_car_modular_control_module = CAR_CONTROL_TRACE_TYPE; //开始寻迹
-            g_car_status = CAR_TRACE_STATUS;
-        }
-        else if ((tmp = strstr(payload, CAR_CTRL_LIGHT)) != NULL)
-        { //判断红绿灯
-            if ((tmp = strstr(payload, CAR_CTRL_RED_LIGHT_ON)) != NULL || (tmp = strstr(payload, CAR_CTRL_YELLOW_LIGHT_ON)) != NULL)
-            {
-                global_red_on = HI_TRUE;
-            }
-            else
-            {
-                global_red_on = HI_FALSE;
-            }
-        }
-        else if (strstr(payload, CAR_TRACE_CMD_NAME) != NULL)
-        { //Auto module
-            IOT_LOG_DEBUG("CAR TRACE RCVMSG:QOS:%d TOPIC:%s PAYLOAD:%s\r\n", qos, topic, payload);
-        }
+    g_car_control_mode = CAR_DIRECTION_CONTROL_MODE;
+    g_car_direction_control_module = CAR_STOP_TYPE; //停止
+    g_car_status = CAR_STOP_STATUS;
+}
+
+static hi_void CarEnterTraceMode(hi_void)
+{
+    g_car_control_mode = CAR_MODULE_CONTROL_MODE;
+    g_car_modular_control_module = CAR_CONTROL_TRACE_TYPE; //开始寻迹
+    g_car_status = CAR_TRACE_STATUS;
+}
+
+static hi_void CarEnterSteerMode(hi_void)
+{
+    g_car_control_mode = CAR_MODULE_CONTROL_MODE;
+    g_car_modular_control_module = CAR_CONTROL_STEER_ENGINE_TYPE; //开始超声波
+    g_car_status = CAR_RUNNING_STATUS;
+}
+
+static hi_void CarPlanAdd(IoTCarPlan_t *plan, IoTCarAction action, hi_u32 holdMs)
+{
+    if (plan->stepNum < CN_CAR_PLAN_STEPNUM)
+    {
+        plan->step[plan->stepNum].action = action;
+        plan->step[plan->stepNum].holdMs = holdMs;
+        plan->stepNum++;
     }
+}
+
+static int CarCmdGoForward(const IoTCmd_t *cmd)
+{
+    IoTCarPlan_t plan = {0};
+    hi_u32 val = (hi_u32)IoTCmdGetParaInt(cmd, DURATION_PARAM, DURATION_FOREVER);
+
+    printf("============forward============\n");
+    CarPlanAdd(&plan, CarEnterStopMode, 500); //先停止，切换模式
+    CarPlanAdd(&plan, car_go_forward, val);
+    CarPlanAdd(&plan, car_stop, 0);
+    return IoTCarSchedSubmit(&plan);
+}
+
+static int CarCmdGoBack(const IoTCmd_t *cmd)
+{
+    IoTCarPlan_t plan = {0};
+
+    CarPlanAdd(&plan, car_go_back, (hi_u32)IoTCmdGetParaInt(cmd, DURATION_PARAM, DURATION_FOREVER));
+    CarPlanAdd(&plan, car_stop, 0);
+    return IoTCarSchedSubmit(&plan);
+}
+
+static int CarCmdTurnLeft(const IoTCmd_t *cmd)
+{
+    IoTCarPlan_t plan = {0};
+
+    CarPlanAdd(&plan, car_turn_left, (hi_u32)IoTCmdGetParaInt(cmd, DURATION_PARAM, DURATION_FOREVER));
+    CarPlanAdd(&plan, car_stop, 0);
+    return IoTCarSchedSubmit(&plan);
+}
+
+static int CarCmdTurnRight(const IoTCmd_t *cmd)
+{
+    IoTCarPlan_t plan = {0};
+
+    CarPlanAdd(&plan, car_turn_right, (hi_u32)IoTCmdGetParaInt(cmd, DURATION_PARAM, DURATION_FOREVER));
+    CarPlanAdd(&plan, car_stop, 0);
+    return IoTCarSchedSubmit(&plan);
+}
+
+static int CarCmdStop(const IoTCmd_t *cmd)
+{
+    IoTCarPlan_t plan = {0};
+
+    (void)cmd;
+    CarPlanAdd(&plan, CarEnterStopMode, 0); //停止, 同时取消正在执行的动作
+    return IoTCarSchedSubmit(&plan);
+}
+
+static int CarCmdSpeedUp(const IoTCmd_t *cmd)
+{
+    (void)cmd;
+    car_speed_up();
     return 0;
 }
 
-int ValofJson(char *jStr) // 查找整型数据
+static int CarCmdTraceOn(const IoTCmd_t *cmd)
 {
-    char *tmp = NULL;
-    int i = 0;
-    if ((tmp = strstr(jStr, DURATION_PARAM)) == NULL)
-        return 0;
+    IoTCarPlan_t plan = {0};
 
-    while (*tmp++ != BEGIN_SEPRATOR)
-        ;
-    while (tmp[i++] != END_SEPRATOR)
-        ;
-    if (i > 0)
-        tmp[i - 1] = 0;
-    // IOT_LOG_DEBUG("pos is %d,TMP is %s\n",i,tmp);
-    int val = itoa_key(tmp);
-    return val;
+    (void)cmd;
+    printf("=============TRACE_ON=============\n");
+    CarPlanAdd(&plan, CarEnterTraceMode, 0);
+    return IoTCarSchedSubmit(&plan);
 }
 
-int itoa_key(char *key)
+static int CarCmdSteerOn(const IoTCmd_t *cmd)
 {
-    int val = 0;
-    int i = 0;
-    // IOT_LOG_DEBUG("itoa val  is %d,key is %s\n",val,key);
-    while (key[i] != 0)
+    IoTCarPlan_t plan = {0};
+
+    (void)cmd;
+    printf("=============STEER_ON=============\n");
+    CarPlanAdd(&plan, CarEnterSteerMode, 0);
+    return IoTCarSchedSubmit(&plan);
+}
+
+static int CarCmdDodge(const IoTCmd_t *cmd)
+{
+    IoTCarPlan_t plan = {0};
+    hi_u32 val = (hi_u32)IoTCmdGetParaInt(cmd, DURATION_PARAM, DURATION_FOREVER);
+
+    printf("=============CAR_AWAY=============\n");
+    CarPlanAdd(&plan, car_turn_left, val);
+    CarPlanAdd(&plan, car_stop, 0);
+    CarPlanAdd(&plan, car_go_forward, val);
+    CarPlanAdd(&plan, car_stop, 0);
+    return IoTCarSchedSubmit(&plan);
+}
+
+static int CarCmdTraceForward(const IoTCmd_t *cmd)
+{
+    IoTCarPlan_t plan = {0};
+
+    CarPlanAdd(&plan, CarEnterStopMode, 100); //先停止，切换模式
+    CarPlanAdd(&plan, car_go_forward, (hi_u32)IoTCmdGetParaInt(cmd, DURATION_PARAM, DURATION_FOREVER));
+    CarPlanAdd(&plan, CarEnterTraceMode, 0);
+    return IoTCarSchedSubmit(&plan);
+}
+
+static int CarCmdLight(const IoTCmd_t *cmd)
+{
+    //判断红绿灯
+    if (IoTCmdHasStrValue(cmd, CAR_CTRL_RED_LIGHT_ON) || IoTCmdHasStrValue(cmd, CAR_CTRL_YELLOW_LIGHT_ON))
+    {
+        global_red_on = HI_TRUE;
+    }
+    else
     {
-        val = val * 10 + (key[i++] - '0');
+        global_red_on = HI_FALSE;
     }
-    return val;
+    return 0;
+}
+
+static int CarCmdTrace(const IoTCmd_t *cmd)
+{
+    //Auto module
+    IOT_LOG_DEBUG("CAR TRACE CMD:%.*s\r\n", cmd->cmdName.len, cmd->cmdName.str);
+    return 0;
+}
+
+///< indexed by IoTCmdHash(name, CN_CAR_CMD_SEED) & CN_CAR_CMD_MASK, rerun IoTCmdTableCheck after editing
+static const IoTCmdEntry_t gCarCmdEntry[CN_CAR_CMD_MASK + 1] = {
+    [0]  = {CAR_CTRL_STEER_ON,      CarCmdSteerOn},
+    [1]  = {CAR_CTRL_SPPEED_UP,     CarCmdSpeedUp},
+    [3]  = {CAR_TRACE_CMD_NAME,     CarCmdTrace},
+    [4]  = {CAR_CTRL_TURN_LEFT,     CarCmdTurnLeft},
+    [5]  = {CAR_CTRL_TRACE_FORWARD, CarCmdTraceForward},
+    [7]  = {CAR_CTRL_LIGHT,         CarCmdLight},
+    [10] = {CAR_CTRL_GO_BACK,       CarCmdGoBack},
+    [11] = {CAR_CTRL_STOP,          CarCmdStop},
+    [12] = {CAR_CTRL_DODGE,         CarCmdDodge},
+    [13] = {CAR_CTRL_TRACE_ON,      CarCmdTraceOn},
+    [14] = {CAR_CTRL_TURN_RIGHT,    CarCmdTurnRight},
+    [15] = {CAR_CTRL_GO_FORWARD,    CarCmdGoForward},
+};
+
+static const IoTCmdTable_t gCarCmdTable = {
+    .entry = gCarCmdEntry,
+    .mask = CN_CAR_CMD_MASK,
+    .seed = CN_CAR_CMD_SEED,
+};
+
+int MQTT_car_ctrl(int qos, const char *topic, const char *payload)
+{
+    IoTCmd_t cmd;
+    IOT_LOG_DEBUG("CAR CTRL RCVMSG:QOS:%d TOPIC:%s PAYLOAD:%s\r\n", qos, topic, payload);
+    /*app 下发的操作, 定时的动作交给调度任务执行, 这里立即返回*/
+    if ((IoTCmdDecode(payload, &cmd) != 0) || (!IoTCmdSliceEq(&cmd.serviceID, CAR_CTRL_CMD_SERVICE_ID)))
+    {
+        return 0;
+    }
+    (void)IoTCmdDispatch(&gCarCmdTable, &cmd);
+    return 0;
 }
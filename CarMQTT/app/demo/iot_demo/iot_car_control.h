@@ -5,6 +5,8 @@
 #include "iot_log.h"
 #include "iot_main.h"
 #include "iot_profile.h"
+#include "iot_car_sched.h"
+#include "iot_cmd.h"
 #include <hi_task.h>
 #include <string.h>
 #include <hi_wifi_api.h>
@@ -31,8 +33,6 @@
 #define DURATION_FOREVER                      0
 
 #define CAR_TRACE_CMD_NAME                    "TRACE"
-int itoa_key(char *key);
-int ValofJson(char* jStr);
 int MQTT_car_ctrl(int qos, const char *topic, const char *payload);
 
 
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: timed actuator scheduler for the car commands
+ * Author: HiSpark Product Team.
+ * Create: 2020-5-20
+ */
+
+/**
+ * The scheduler task owns the running plan. It sleeps on its semaphore until either a newer plan
+ * comes (which replaces the running one) or the hold time of the current step expires. Since
+ * only one plan runs at a time, there is only one deadline to keep and no timer list is needed.
+ * A submitted plan waits in a single slot, a newer one overwrites it, so a submit never fails
+ * for want of room and the latest command, a STOP above all, is the one that runs.
+*/
+#include "iot_car_sched.h"
+#include "iot_log.h"
+#include <hi_task.h>
+#include <hi_mux.h>
+#include <hi_sem.h>
+#include <hi_time.h>
+#include <hi_errno.h>
+
+#define CN_CAR_SCHED_TASK_PRIOR 24 ///< higher than the IoTMain and the car task, the actuation should not wait
+#define CN_CAR_SCHED_TASK_STACKSIZE 0x800
+#define CN_CAR_SCHED_TASK_NAME "IoTCarSched"
+
+typedef struct
+{
+    hi_u32 mux;           ///< guards the next plan and the counters
+    hi_u32 sem;           ///< signaled when a next plan is there
+    hi_u32 taskID;
+    IoTCarPlan_t next;    ///< the latest submitted plan, not taken by the scheduler task yet
+    hi_bool nextReady;
+    IoTCarPlan_t plan;    ///< the running plan, only touched by the scheduler task
+    hi_u8 curStep;        ///< the step being hold, equals stepNum when the plan is done
+    hi_u32 deadline;      ///< in ms, when the current step ends
+    IoTCarSchedStat_t stat;
+} IoTCarSchedCb_t;
+static IoTCarSchedCb_t gCarSched;
+
+///< run the steps from curStep until one should be hold or the plan is done
+static hi_void CarSchedRun(hi_void)
+{
+    IoTCarStep_t *step;
+    hi_u32 latency;
+
+    while (gCarSched.curStep < gCarSched.plan.stepNum)
+    {
+        step = &gCarSched.plan.step[gCarSched.curStep];
+        if (step->action != NULL)
+        {
+            step->action();
+        }
+        if (gCarSched.curStep == 0)
+        {
+            latency = (hi_u32)(hi_get_us() - gCarSched.plan.submitUs);
+            gCarSched.stat.lastLatencyUs = latency;
+            if (latency > gCarSched.stat.maxLatencyUs)
+            {
+                gCarSched.stat.maxLatencyUs = latency;
+            }
+        }
+        if (step->holdMs > 0)
+        {
+            gCarSched.deadline = hi_get_milli_seconds() + step->holdMs;
+            return;
+        }
+        gCarSched.curStep++;
+    }
+    return;
+}
+
+static hi_u32 CarSchedTimeout(hi_void)
+{
+    hi_s32 left;
+
+    if (gCarSched.curStep >= gCarSched.plan.stepNum)
+    {
+        return HI_SYS_WAIT_FOREVER;
+    }
+    left = (hi_s32)(gCarSched.deadline - hi_get_milli_seconds());
+    return (left > 0) ? (hi_u32)left : 0;
+}
+
+///< take the next plan if there is one, it replaces the running one
+static hi_bool CarSchedTake(hi_void)
+{
+    hi_bool taken = HI_FALSE;
+
+    (void)hi_mux_pend(gCarSched.mux, HI_SYS_WAIT_FOREVER);
+    if (gCarSched.nextReady)
+    {
+        if (gCarSched.curStep < gCarSched.plan.stepNum)
+        {
+            gCarSched.stat.preemptCnt++;
+        }
+        gCarSched.plan = gCarSched.next;
+        gCarSched.curStep = 0;
+        gCarSched.nextReady = HI_FALSE;
+        taken = HI_TRUE;
+    }
+    (void)hi_mux_post(gCarSched.mux);
+    return taken;
+}
+
+static hi_void *CarSchedEntry(hi_void *arg)
+{
+    (void)arg;
+    while (1)
+    {
+        if (hi_sem_wait(gCarSched.sem, CarSchedTimeout()) == HI_ERR_SUCCESS)
+        {
+            if (!CarSchedTake())
+            {
+                continue; ///< the signal of a plan taken with an earlier one, keep holding the step
+            }
+        }
+        else if (gCarSched.curStep < gCarSched.plan.stepNum)
+        {
+            gCarSched.curStep++; ///< the hold time is over, go to the next step
+        }
+        CarSchedRun();
+    }
+    return NULL;
+}
+
+int IoTCarSchedInit(hi_void)
+{
+    hi_u32 ret;
+    hi_task_attr attr = {0};
+
+    ret = hi_mux_create(&gCarSched.mux);
+    if (ret != HI_ERR_SUCCESS)
+    {
+        IOT_LOG_ERROR("Create the car sched mux Failed\r\n");
+        return -1;
+    }
+    ret = hi_sem_bcreate(&gCarSched.sem, HI_SEM_ZERO);
+    if (ret != HI_ERR_SUCCESS)
+    {
+        IOT_LOG_ERROR("Create the car sched sem Failed\r\n");
+        (void)hi_mux_delete(gCarSched.mux);
+        return -1;
+    }
+
+    attr.stack_size = CN_CAR_SCHED_TASK_STACKSIZE;
+    attr.task_prio = CN_CAR_SCHED_TASK_PRIOR;
+    attr.task_name = CN_CAR_SCHED_TASK_NAME;
+    ret = hi_task_create(&gCarSched.taskID, &attr, CarSchedEntry, NULL);
+    if (ret != HI_ERR_SUCCESS)
+    {
+        IOT_LOG_ERROR("Create the car sched task Failed\r\n");
+        (void)hi_sem_delete(gCarSched.sem);
+        (void)hi_mux_delete(gCarSched.mux);
+        return -1;
+    }
+    return 0;
+}
+
+int IoTCarSchedSubmit(IoTCarPlan_t *plan)
+{
+    if ((NULL == plan) || (plan->stepNum > CN_CAR_PLAN_STEPNUM))
+    {
+        return -1;
+    }
+    plan->submitUs = hi_get_us();
+    (void)hi_mux_pend(gCarSched.mux, HI_SYS_WAIT_FOREVER);
+    if (gCarSched.nextReady)
+    {
+        gCarSched.stat.preemptCnt++; ///< the one waiting never runs
+    }
+    gCarSched.next = *plan;
+    gCarSched.nextReady = HI_TRUE;
+    gCarSched.stat.submitCnt++;
+    (void)hi_mux_post(gCarSched.mux);
+    (void)hi_sem_signal(gCarSched.sem); ///< fails when already signaled, which is as good
+    return 0;
+}
+
+hi_void IoTCarSchedGetStat(IoTCarSchedStat_t *stat)
+{
+    if (NULL != stat)
+    {
+        *stat = gCarSched.stat;
+    }
+    return;
+}
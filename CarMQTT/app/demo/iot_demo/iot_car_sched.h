@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: timed actuator scheduler for the car commands
+ * Author: HiSpark Product Team.
+ * Create: 2020-5-20
+ */
+#ifndef IOT_CAR_SCHED_H_
+#define IOT_CAR_SCHED_H_
+
+#include <hi_types_base.h>
+
+#define CN_CAR_PLAN_STEPNUM 4
+
+typedef hi_void (*IoTCarAction)(hi_void);
+
+typedef struct
+{
+    IoTCarAction action;  ///< the actuator call, must not block
+    hi_u32 holdMs;        ///< how long to keep it before the next step, 0 means go on at once
+} IoTCarStep_t;
+
+///< a timed motion primitive, like forward for DURATION and then stop
+typedef struct
+{
+    IoTCarStep_t step[CN_CAR_PLAN_STEPNUM];
+    hi_u8 stepNum;
+    hi_u64 submitUs;      ///< filled by IoTCarSchedSubmit
+} IoTCarPlan_t;
+
+typedef struct
+{
+    hi_u32 submitCnt;     ///< plans accepted
+    hi_u32 preemptCnt;    ///< plans replaced by a newer one before they finished
+    hi_u32 lastLatencyUs; ///< submit to the first step executed, of the last plan
+    hi_u32 maxLatencyUs;
+} IoTCarSchedStat_t;
+
+/**
+ * Create the scheduler task, call it once before submit
+ *
+ * @return 0 success while others failed
+*/
+int IoTCarSchedInit(hi_void);
+
+/**
+ * Run the plan in the scheduler task and return at once, the plan is copied.
+ * A running plan is dropped where it is and a plan not started yet is replaced, so the newer
+ * command always wins and a submit only fails for a bad plan.
+ *
+ * @return 0 success while others failed
+*/
+int IoTCarSchedSubmit(IoTCarPlan_t *plan);
+
+/**
+ * Get the scheduler counters
+*/
+hi_void IoTCarSchedGetStat(IoTCarSchedStat_t *stat);
+
+#endif /* IOT_CAR_SCHED_H_ */
@@ -11,20 +11,30 @@
  * 1, CONNECT TO THE IOT SERVER
  * 2, SUBSCRIBE  THE DEFAULT TOPIC
  * 3, WAIT FOR ANY MESSAGE COMES OR ANY MESSAGE TO SEND
- * 
+ *
 */
 #include "iot_config.h"
 #include "iot_log.h"
 #include "iot_main.h"
 #include "iot_hmac.h"
+#include "iot_msg_slab.h"
+#include "iot_router.h"
 #include <securec.h>
 #include <hi_task.h>
 #include <hi_msg.h>
 #include <hi_mem.h>
+#ifdef CONFIG_MQTT_ASYNC
+#include <MQTTAsync.h>
+#else
 #include <MQTTClient.h>
+#endif
 #include <string.h>
 #include <hi_mux.h>
+#include <hi_sem.h>
+#include <hi_time.h>
+#include <hi_cipher.h>
 #include <hi_wifi_api.h>
+#include "lwip/netdb.h"
 
 // extern hi_u8 wifi_status;
 extern hi_u8 wifi_first_connecting;
@@ -32,34 +42,99 @@ extern hi_u8 wifi_second_connecting;
 extern hi_u8 wifi_second_connected;
 hi_bool mqtt_connect_success = HI_FALSE;
 ///< this is the configuration head
+#ifndef CN_IOT_SERVER ///< the host build points it to the local broker
 #define CN_IOT_SERVER ".st1.iotda-device.cn-north-4.myhuaweicloud.com:"
+#endif
 
 #define CONFIG_COMMAND_TIMEOUT 10000L
 #define CN_KEEPALIVE_TIME 50
-#define CN_CLEANSESSION 1
+#define CN_CLEANSESSION 0 ///< the server keeps the subscriptions and the qos1 messages over a reconnect
 #define CN_HMAC_PWD_LEN 65 ///< SHA256 IS 32 BYTES AND END APPEND '\0'
 #define CN_EVENT_TIME "1970000100"
 #define CN_CLIENTID_FMT "%s_0_0_%s" ///< This is the cient ID format, deviceID_0_0_TIME
+#define CN_CLIENTID_SIZE (sizeof(CONFIG_DEVICE_ID) + sizeof(CN_EVENT_TIME) + 4)
+#define CN_SERVERHOST_SIZE 64
+#define CN_SERVERURI_SIZE 32 ///< tcp://255.255.255.255:65535
+#define CN_RECONNECT_FIRST_MS 200 ///< most of the losses are short, so the first retry does not wait long
+#define CN_RECONNECT_BASE_MS 1000
+#define CN_RECONNECT_MAX_MS 60000
+#define CN_RESOLVE_FAILS 3 ///< resolve the server name again after so many connects failed in a row
 #define CN_QUEUE_WAITTIMEOUT 5000
 #define CN_QUEUE_MSGNUM 16
 #define CN_QUEUE_MSGSIZE (sizeof(hi_pvoid))
+#define CN_QUEUE_SLOTSIZE 512 ///< IoTMsg_t + topic + payload, larger messages are put on the heap
+#define CN_PUBLISH_RETRY 2 ///< a failed publish is sent again so many times before the callback is told
+#define CN_ROUTE_NODENUM 32 ///< the levels of the routed filters, the common ones like "$oc" counted once
+#define CN_ROUTE_EDGENUM 64
+#define CN_SESSION_EXPIRY 0xFFFFFFFF ///< MQTT 5 ends the session at the loss unless told, this one never ends as in 3.1.1
+
+#ifdef CONFIG_MQTT_ASYNC
+#if (CONFIG_MQTT_INFLIGHT <= 0) || (CONFIG_MQTT_INFLIGHT >= CN_QUEUE_MSGNUM)
+#error "CONFIG_MQTT_INFLIGHT must leave some queue slots to the received messages"
+#endif
+#define CN_PUBLISH_WINDOW CONFIG_MQTT_INFLIGHT
+#else
+#define CN_PUBLISH_WINDOW (CN_QUEUE_MSGNUM / 2) ///< the sync client sends one at a time, this bounds the queued ones
+#endif
 
 #define CN_TASK_PRIOR 28
 #define CN_TASK_STACKSIZE 0X2000
 #define CN_TASK_NAME "IoTMain"
 
+///< the two paho clients could not be linked together, the config picks one of them
+#ifdef CONFIG_MQTT_ASYNC
+typedef MQTTAsync MqttClient_t;
+typedef MQTTAsync_message MqttMessage_t;
+typedef MQTTAsync_publishStats MqttPublishStats_t;
+#define CN_MQTT_SUCCESS MQTTASYNC_SUCCESS
+#define MqttFreeMessage MQTTAsync_freeMessage
+#define MqttFree MQTTAsync_free
+#define MqttGetPublishStats MQTTAsync_getPublishStats
+#define MqttCork() ((void)0) ///< the paho send thread corks the commands it sends together
+#define MqttUncork() ((void)0)
+///< the MQTT 5 client takes the callbacks with the reason codes and the properties only
+#ifdef CONFIG_MQTT_V5
+typedef MQTTAsync_successData5 MqttSuccessData_t;
+typedef MQTTAsync_failureData5 MqttFailureData_t;
+#define MqttOnSuccess onSuccess5
+#define MqttOnFailure onFailure5
+#else
+typedef MQTTAsync_successData MqttSuccessData_t;
+typedef MQTTAsync_failureData MqttFailureData_t;
+#define MqttOnSuccess onSuccess
+#define MqttOnFailure onFailure
+#endif
+#else
+typedef MQTTClient MqttClient_t;
+typedef MQTTClient_message MqttMessage_t;
+typedef MQTTClient_publishStats MqttPublishStats_t;
+#define CN_MQTT_SUCCESS MQTTCLIENT_SUCCESS
+#define MqttFreeMessage MQTTClient_freeMessage
+#define MqttFree MQTTClient_free
+#define MqttGetPublishStats MQTTClient_getPublishStats
+#define MqttCork MQTTClient_cork
+#define MqttUncork MQTTClient_uncork
+#endif
+
 typedef enum
 {
     EN_IOT_MSG_PUBLISH = 0,
     EN_IOT_MSG_RECV,
+    EN_IOT_MSG_CONNLOST, ///< no payload, only wakes up the IoTMain task
 } en_iot_msg_t;
 
-typedef struct
+typedef struct IoTMsg
 {
     en_iot_msg_t type;
     int qos;
     const char *topic;
     const char *payload;
+    fnPubCallBack pubCallBack;
+    hi_pvoid pubArg;
+    hi_u32 startUs;     ///< when it was put, for the latency
+    int result;         ///< the paho result, while in the done list
+    hi_u8 retry;
+    struct IoTMsg *next; ///< in the done list
 } IoTMsg_t;
 
 typedef struct
@@ -67,12 +142,52 @@ typedef struct
     hi_bool stop;
     hi_u32 conLost;
     hi_u32 queueID;
+    hi_bool queueReady;
     hi_u32 iotTaskID;
-    fnMsgCallBack msgCallBack;
+    fnMsgCallBack msgCallBack;          ///< the messages no route takes
+    fnDueCallBack dueCallBack;          ///< called by the IoTMain task at dueMs, NULL if none is set
+    hi_u32 dueMs;
+    IoTRouter_t router;
+#ifndef CONFIG_MQTT_ASYNC
     MQTTClient_deliveryToken tocken;
+#endif
+    IoTMsgSlab_t msgSlab;
+    hi_u32 queueDropCnt;                ///< messages which had a slot but found the queue full
+    ///< the connection is set up once and kept over the reconnects
+    MqttClient_t client;
+    hi_bool clientReady;
+    hi_bool subscribed;                 ///< the server has the subscriptions in the kept session
+    char clientID[CN_CLIENTID_SIZE];
+    char userPwd[CN_HMAC_PWD_LEN];
+    char serverURI[CN_SERVERURI_SIZE];  ///< the resolved server address, empty if not resolved
+    hi_u32 connFails;                   ///< connects failed in a row
+    hi_bool lost;                       ///< the connection was lost and not connected again yet
+    hi_u32 lostMs;
+    IoTConnStat_t connStat;
+    ///< the publishes wait here when they could not be handed to paho, in the put order
+    IoTMsg_t *pending[CN_QUEUE_MSGNUM];
+    hi_u8 pendingHead;
+    hi_u8 pendingNum;
+    hi_u32 pubSem;                      ///< the free places of the inflight window
+    IoTPubStat_t pubStat;
+#ifdef CONFIG_MQTT_ASYNC
+    hi_u32 waitSem;                     ///< posted when the connect or the subscribe is done
+    int waitRc;
+    hi_bool sessionPresent;
+    ///< the publishes paho is done with, in the done order, kept off the queue so none is ever lost
+    hi_u32 doneMux;
+    IoTMsg_t *doneHead;
+    IoTMsg_t *doneTail;
+#endif
 } IotAppCb_t;
 static IotAppCb_t gIoTAppCb;
 
+///< the queue carries the slot pointer only, the message itself lives in the slab
+static hi_u64 gIoTMsgMem[CN_QUEUE_MSGNUM][CN_QUEUE_SLOTSIZE / sizeof(hi_u64)];
+static hi_u16 gIoTMsgFreeList[CN_QUEUE_MSGNUM];
+static IoTRouteNode_t gIoTRouteNode[CN_ROUTE_NODENUM];
+static hi_u16 gIoTRouteEdge[CN_ROUTE_EDGENUM];
+
 static const char *gDefaultSubscribeTopic[] = {
     "$oc/devices/" CONFIG_DEVICE_ID "/sys/messages/down",
     "$oc/devices/" CONFIG_DEVICE_ID "/sys/properties/set/#",
@@ -82,43 +197,64 @@ static const char *gDefaultSubscribeTopic[] = {
     "$oc/devices/" CONFIG_DEVICE_ID "/sys/commands/#"};
 #define CN_TOPIC_SUBSCRIBE_NUM (sizeof(gDefaultSubscribeTopic) / sizeof(const char *))
 
-static int MsgRcvCallBack(void *context, char *topic, int topicLen, MQTTClient_message *message)
+///< build the message in a slab slot and put it to the queue, the slot is freed by ProcessQueueMsg
+static int MsgQueuePut(en_iot_msg_t type, int qos, const char *topic, hi_u32 topicLen,
+                       const char *payload, hi_u32 payloadLen, fnPubCallBack cb, hi_pvoid arg)
 {
     IoTMsg_t *msg;
     char *buf;
     hi_u32 bufSize;
 
+    bufSize = topicLen + 1 + payloadLen + 1 + sizeof(IoTMsg_t);
+    msg = IoTMsgSlabAlloc(&gIoTAppCb.msgSlab, bufSize);
+    if (msg == NULL)
+    {
+        IOT_LOG_ERROR("No slot for the message:%u bytes, dropped\r\n", bufSize);
+        return -1;
+    }
+    buf = (char *)msg + sizeof(IoTMsg_t);
+    bufSize -= sizeof(IoTMsg_t);
+    msg->qos = qos;
+    msg->type = type;
+    msg->pubCallBack = cb;
+    msg->pubArg = arg;
+    msg->startUs = (hi_u32)hi_get_us();
+    msg->result = 0;
+    msg->retry = 0;
+    (void)memcpy_s(buf, bufSize, topic, topicLen);
+    buf[topicLen] = '\0';
+    msg->topic = buf;
+    buf += topicLen + 1;
+    bufSize -= (topicLen + 1);
+    (void)memcpy_s(buf, bufSize, payload, payloadLen);
+    buf[payloadLen] = '\0';
+    msg->payload = buf;
+
+    if (HI_ERR_SUCCESS != hi_msg_queue_send(gIoTAppCb.queueID, &msg, CN_QUEUE_WAITTIMEOUT, sizeof(hi_pvoid)))
+    {
+        gIoTAppCb.queueDropCnt++;
+        IOT_LOG_ERROR("Queue full for the message:%u bytes, dropped\r\n", bufSize);
+        IoTMsgSlabFree(&gIoTAppCb.msgSlab, msg);
+        return -1;
+    }
+    return 0;
+}
+
+static int MsgRcvCallBack(void *context, char *topic, int topicLen, MqttMessage_t *message)
+{
     if (topicLen == 0)
     {
         topicLen = strlen(topic);
     }
-    bufSize = topicLen + 1 + message->payloadlen + 1 + sizeof(IoTMsg_t);
-    buf = hi_malloc(0, bufSize);
-    if (buf != NULL)
-    {
-        msg = (IoTMsg_t *)buf;
-        buf += sizeof(IoTMsg_t);
-        bufSize -= sizeof(IoTMsg_t);
-        msg->qos = message->qos;
-        msg->type = EN_IOT_MSG_RECV;
-        (void)memcpy_s(buf, bufSize, topic, topicLen);
-        buf[topicLen] = '\0';
-        msg->topic = buf;
-        buf += topicLen + 1;
-        bufSize -= (topicLen + 1);
-        (void)memcpy_s(buf, bufSize, message->payload, message->payloadlen);
-        buf[message->payloadlen] = '\0';
-        msg->payload = buf;
-        // IOT_LOG_DEBUG("RCVMSG:QOS:%d TOPIC:%s PAYLOAD:%s\r\n",msg->qos,msg->topic,msg->payload);
-        if (HI_ERR_SUCCESS != hi_msg_queue_send(gIoTAppCb.queueID, &msg, CN_QUEUE_WAITTIMEOUT, sizeof(hi_pvoid)))
-        {
-            IOT_LOG_ERROR("========MsgRcvCallBack Wrie queue failed==========\r\n");
-            hi_free(0, msg);
-        }
+    // IOT_LOG_DEBUG("RCVMSG:QOS:%d TOPIC:%s PAYLOAD:%s\r\n",message->qos,topic,message->payload);
+    if (0 != MsgQueuePut(EN_IOT_MSG_RECV, message->qos, topic, topicLen, message->payload, message->payloadlen,
+                         NULL, NULL))
+    {
+        IOT_LOG_ERROR("========MsgRcvCallBack Wrie queue failed==========\r\n");
     }
 
-    MQTTClient_freeMessage(&message);
-    MQTTClient_free(topic);
+    MqttFreeMessage(&message);
+    MqttFree(topic);
 
     return 1;
 }
@@ -126,73 +262,510 @@ static int MsgRcvCallBack(void *context, char *topic, int topicLen, MQTTClient_m
 ///< when the connect lost and this callback will be called
 static void ConnLostCallBack(void *context, char *cause)
 {
+    gIoTAppCb.lostMs = hi_get_milli_seconds();
+    gIoTAppCb.lost = HI_TRUE;
     IOT_LOG_DEBUG("Connection lost:caused by:%s\r\n", cause == NULL ? "Unknown" : cause);
+    (void)MsgQueuePut(EN_IOT_MSG_CONNLOST, 0, "", 0, "", 0, NULL, NULL);
+    return;
+}
+
+///< the publish is done for good: tell the sender, free the slot and the place in the window
+static hi_void PubComplete(IoTMsg_t *msg, int result)
+{
+    hi_u32 latencyUs;
+
+    latencyUs = (hi_u32)hi_get_us() - msg->startUs;
+    if (result == 0)
+    {
+        gIoTAppCb.pubStat.okCnt++;
+        gIoTAppCb.pubStat.lastLatencyUs = latencyUs;
+        if (latencyUs > gIoTAppCb.pubStat.maxLatencyUs)
+        {
+            gIoTAppCb.pubStat.maxLatencyUs = latencyUs;
+        }
+    }
+    else
+    {
+        gIoTAppCb.pubStat.failCnt++;
+        IOT_LOG_ERROR("MSGSEND:failed:%d\r\n", result);
+    }
+    if (msg->pubCallBack != NULL)
+    {
+        msg->pubCallBack(msg->pubArg, result);
+    }
+    IoTMsgSlabFree(&gIoTAppCb.msgSlab, msg);
+    (void)hi_sem_signal(gIoTAppCb.pubSem);
+    return;
+}
+
+///< keep the publish to send it again later, the pending ones are sent before the new ones
+static hi_void PubPendingPut(IoTMsg_t *msg)
+{
+    hi_u8 tail;
+
+    tail = (gIoTAppCb.pendingHead + gIoTAppCb.pendingNum) % CN_QUEUE_MSGNUM;
+    gIoTAppCb.pending[tail] = msg;
+    gIoTAppCb.pendingNum++; ///< every slot is here once at most, so it never overflows
+    return;
+}
+
+///< the result of a publish, failed ones are sent again until the retries are used up
+static hi_void PubDone(IoTMsg_t *msg, int result)
+{
+    if ((result != 0) && (msg->retry < CN_PUBLISH_RETRY))
+    {
+        msg->retry++;
+        gIoTAppCb.pubStat.retryCnt++;
+        msg->type = EN_IOT_MSG_PUBLISH;
+        PubPendingPut(msg);
+        return;
+    }
+    PubComplete(msg, result);
+    return;
+}
+
+#ifdef CONFIG_MQTT_ASYNC
+///< the paho thread gives the publish back to the IoTMain task through the done list. The first one
+///< in the list wakes the task with an empty message; when the queue is full the task is busy with
+///< it anyway and takes the list after every message, so the paho thread never waits here
+static hi_void PubPostDone(IoTMsg_t *msg, int result)
+{
+    hi_bool wake;
+    IoTMsg_t *none = NULL;
+
+    msg->result = result;
+    msg->next = NULL;
+    (void)hi_mux_pend(gIoTAppCb.doneMux, HI_SYS_WAIT_FOREVER);
+    wake = (gIoTAppCb.doneHead == NULL);
+    if (wake)
+    {
+        gIoTAppCb.doneHead = msg;
+    }
+    else
+    {
+        gIoTAppCb.doneTail->next = msg;
+    }
+    gIoTAppCb.doneTail = msg;
+    (void)hi_mux_post(gIoTAppCb.doneMux);
+    if (wake)
+    {
+        (void)hi_msg_queue_send(gIoTAppCb.queueID, &none, 0, sizeof(hi_pvoid));
+    }
     return;
 }
 
+static void PubOnSuccess(void *context, MqttSuccessData_t *response)
+{
+    PubPostDone((IoTMsg_t *)context, 0);
+    return;
+}
+
+static void PubOnFailure(void *context, MqttFailureData_t *response)
+{
+    PubPostDone((IoTMsg_t *)context, (response == NULL || response->code == 0) ? MQTTASYNC_FAILURE : response->code);
+    return;
+}
+
+///< the connect and the subscribe are waited for, they are rare and nothing could be done before them
+static void WaitOnSuccess(void *context, MqttSuccessData_t *response)
+{
+    gIoTAppCb.waitRc = MQTTASYNC_SUCCESS;
+    if ((context != NULL) && (response != NULL))
+    {
+        gIoTAppCb.sessionPresent = (response->alt.connect.sessionPresent != 0);
+    }
+    (void)hi_sem_signal(gIoTAppCb.waitSem);
+    return;
+}
+
+static void WaitOnFailure(void *context, MqttFailureData_t *response)
+{
+    gIoTAppCb.waitRc = (response == NULL || response->code == 0) ? MQTTASYNC_FAILURE : response->code;
+    (void)hi_sem_signal(gIoTAppCb.waitSem);
+    return;
+}
+
+static int WaitDone(hi_void)
+{
+    if (HI_ERR_SUCCESS != hi_sem_wait(gIoTAppCb.waitSem, CONFIG_COMMAND_TIMEOUT))
+    {
+        return MQTTASYNC_FAILURE;
+    }
+    return gIoTAppCb.waitRc;
+}
+
+///< a late callback of the last wait should not finish the next one
+static hi_void WaitReset(hi_void)
+{
+    while (HI_ERR_SUCCESS == hi_sem_wait(gIoTAppCb.waitSem, 0))
+    {
+    }
+    return;
+}
+#endif
+
+///< hand the publish to paho: 0 it is on the way, 1 it waits for the connection, others failed
+static int MqttPublish(MqttClient_t client, IoTMsg_t *msg)
+{
+    int ret;
+#ifdef CONFIG_MQTT_ASYNC
+    MQTTAsync_message pubmsg = MQTTAsync_message_initializer;
+    MQTTAsync_responseOptions opts = MQTTAsync_responseOptions_initializer;
+#else
+    MQTTClient_message pubmsg = MQTTClient_message_initializer;
+#ifdef CONFIG_MQTT_V5
+    MQTTResponse response;
+#endif
+#endif
+
+    pubmsg.payload = (void *)msg->payload;
+    pubmsg.payloadlen = (int)strlen(msg->payload);
+    pubmsg.qos = msg->qos;
+    pubmsg.retained = 0;
+#ifdef CONFIG_MQTT_ASYNC
+    opts.MqttOnSuccess = PubOnSuccess;
+    opts.MqttOnFailure = PubOnFailure;
+    opts.context = msg;
+    ret = MQTTAsync_sendMessage(client, msg->topic, &pubmsg, &opts);
+    if (ret == MQTTASYNC_SUCCESS)
+    {
+        return 0;
+    }
+    return ((ret == MQTTASYNC_DISCONNECTED) || (ret == MQTTASYNC_MAX_MESSAGES_INFLIGHT)) ? 1 : ret;
+#else
+#ifdef CONFIG_MQTT_V5
+    response = MQTTClient_publishMessage5(client, msg->topic, &pubmsg, &gIoTAppCb.tocken);
+    ret = response.reasonCode;
+    MQTTResponse_free(response);
+#else
+    ret = MQTTClient_publishMessage(client, msg->topic, &pubmsg, &gIoTAppCb.tocken);
+#endif
+    if (ret == MQTTCLIENT_DISCONNECTED)
+    {
+        return 1;
+    }
+    gIoTAppCb.tocken++;
+    PubDone(msg, ret); ///< the sync client is done when it returns
+    return 0;
+#endif
+}
+
+///< send the publish, or keep it when paho could not take it now
+static hi_void PubSend(MqttClient_t client, IoTMsg_t *msg)
+{
+    int ret;
+
+    ret = MqttPublish(client, msg);
+    if (ret == 0)
+    {
+#ifdef CONFIG_MQTT_ASYNC
+        gIoTAppCb.pubStat.inflight++;
+        if (gIoTAppCb.pubStat.inflight > gIoTAppCb.pubStat.highWater)
+        {
+            gIoTAppCb.pubStat.highWater = gIoTAppCb.pubStat.inflight;
+        }
+#endif
+        IOT_LOG_DEBUG("MSGSEND:SUCCESS\r\n");
+    }
+    else if (ret == 1)
+    {
+        PubPendingPut(msg);
+    }
+    else
+    {
+        PubDone(msg, ret);
+    }
+    return;
+}
+
+///< send the publishes kept before, stop at the first one paho could not take
+static hi_void PubSendPending(MqttClient_t client)
+{
+    hi_u8 num;
+    IoTMsg_t *msg;
+
+    for (num = gIoTAppCb.pendingNum; num > 0; num--)
+    {
+        msg = gIoTAppCb.pending[gIoTAppCb.pendingHead];
+        gIoTAppCb.pendingHead = (gIoTAppCb.pendingHead + 1) % CN_QUEUE_MSGNUM;
+        gIoTAppCb.pendingNum--;
+        PubSend(client, msg);
+        if ((gIoTAppCb.pendingNum > 0) &&
+            (gIoTAppCb.pending[(gIoTAppCb.pendingHead + gIoTAppCb.pendingNum - 1) % CN_QUEUE_MSGNUM] == msg))
+        {
+            break; ///< it went back to the tail, the ones after it would not go either
+        }
+    }
+    return;
+}
+
+///< call the due callback if it is due, return how long the queue may be waited on
+static hi_u32 DueRun(hi_void)
+{
+    fnDueCallBack dueCallBack = gIoTAppCb.dueCallBack;
+    hi_s32 leftMs;
+
+    if (dueCallBack == NULL)
+    {
+        return CN_QUEUE_WAITTIMEOUT;
+    }
+    leftMs = (hi_s32)(gIoTAppCb.dueMs - hi_get_milli_seconds());
+    if (leftMs > 0)
+    {
+        return ((hi_u32)leftMs < CN_QUEUE_WAITTIMEOUT) ? (hi_u32)leftMs : CN_QUEUE_WAITTIMEOUT;
+    }
+    gIoTAppCb.dueCallBack = NULL;
+    dueCallBack();
+    return CN_QUEUE_WAITTIMEOUT;
+}
+
+#ifdef CONFIG_MQTT_ASYNC
+///< finish the publishes paho is done with, the failed ones go to the pending ones to be sent again
+static hi_void PubTakeDone(MqttClient_t client)
+{
+    IoTMsg_t *msg;
+    IoTMsg_t *next;
+
+    (void)hi_mux_pend(gIoTAppCb.doneMux, HI_SYS_WAIT_FOREVER);
+    msg = gIoTAppCb.doneHead;
+    gIoTAppCb.doneHead = NULL;
+    gIoTAppCb.doneTail = NULL;
+    (void)hi_mux_post(gIoTAppCb.doneMux);
+    if (msg == NULL)
+    {
+        return;
+    }
+    for (; msg != NULL; msg = next)
+    {
+        next = msg->next;
+        gIoTAppCb.pubStat.inflight--;
+        PubDone(msg, msg->result);
+    }
+    PubSendPending(client);
+    return;
+}
+#else
+#define PubTakeDone(client) ((void)0) ///< the sync client is done with the publish when it returns
+#endif
+
 ///<use this function to deal all the comming message
-static int ProcessQueueMsg(MQTTClient client)
+///<the queue is the only thing the IoTMain task waits on: the inbound messages are put by the paho receive
+///<thread, the outbound messages by IotSendMsg and the connection lost by ConnLostCallBack, so whichever
+///<comes first wakes us up without any polling. The done publishes are in the done list and the due callback
+///<has a time, an empty message wakes us up for them
+static int ProcessQueueMsg(MqttClient_t client)
 {
     hi_u32 ret;
     hi_u32 msgSize;
     IoTMsg_t *msg;
     hi_u32 timeout;
-    MQTTClient_message pubmsg = MQTTClient_message_initializer;
+    hi_bool corked = HI_FALSE;
 
-    timeout = CN_QUEUE_WAITTIMEOUT;
+    timeout = DueRun();
+    PubTakeDone(client);
+    PubSendPending(client);
     do
     {
         msg = NULL;
         msgSize = sizeof(hi_pvoid);
         ret = hi_msg_queue_wait(gIoTAppCb.queueID, &msg, timeout, &msgSize);
+        if ((ret == HI_ERR_SUCCESS) && !corked)
+        {
+            ///< the messages queued together are sent together, only the first wait blocks
+            MqttCork();
+            corked = HI_TRUE;
+        }
         if (msg != NULL)
         {
             // IOT_LOG_DEBUG("QUEUEMSG:QOS:%d TOPIC:%s PAYLOAD:%s\r\n",msg->qos,msg->topic,msg->payload);
             switch (msg->type)
             {
             case EN_IOT_MSG_PUBLISH:
-                pubmsg.payload = (void *)msg->payload;
-                pubmsg.payloadlen = (int)strlen(msg->payload);
-                pubmsg.qos = msg->qos;
-                pubmsg.retained = 0;
-                ret = MQTTClient_publishMessage(client, msg->topic, &pubmsg, &gIoTAppCb.tocken);
-                if (ret != MQTTCLIENT_SUCCESS)
-                {
-                    IOT_LOG_ERROR("MSGSEND:failed\r\n");
-                }
-                IOT_LOG_DEBUG("MSGSEND:SUCCESS\r\n");
-                gIoTAppCb.tocken++;
+                PubSend(client, msg); ///< the slot is kept until the publish is done
+                msg = NULL;
                 break;
             case EN_IOT_MSG_RECV:
-                if (gIoTAppCb.msgCallBack != NULL)
+                if ((0 == IoTRouterDispatch(&gIoTAppCb.router, msg->qos, msg->topic, msg->payload)) &&
+                    (gIoTAppCb.msgCallBack != NULL))
                 {
                     printf("=========deal the comming message=======\n");
                     gIoTAppCb.msgCallBack(msg->qos, msg->topic, msg->payload);
                 }
                 break;
+            case EN_IOT_MSG_CONNLOST:
             default:
                 break;
             }
-            hi_free(0, msg);
+            if (msg != NULL)
+            {
+                IoTMsgSlabFree(&gIoTAppCb.msgSlab, msg);
+            }
         }
+        PubTakeDone(client);
         timeout = 0; ///< continous to deal the message without wait here
     } while (ret == HI_ERR_SUCCESS);
+    if (corked)
+    {
+        MqttUncork();
+    }
 
     return 0;
 }
 
-static hi_void MainEntryProcess(hi_void)
+///< make the clientID and the password once, they do not change over the reconnects
+static int ConnPrepare(hi_void)
 {
-    int subQos[CN_TOPIC_SUBSCRIBE_NUM] = {1};
     int rc;
-    char *clientID = NULL;
-    char *userID = NULL;
-    char *userPwd = NULL;
+#ifdef CONFIG_MQTT_V5
+#ifdef CONFIG_MQTT_ASYNC
+    MQTTAsync_createOptions createOpts = MQTTAsync_createOptions_initializer;
+#else
+    MQTTClient_createOptions createOpts = MQTTClient_createOptions_initializer;
+#endif
+#endif
+
+    if (gIoTAppCb.clientReady)
+    {
+        return 0;
+    }
+    (void)snprintf(gIoTAppCb.clientID, sizeof(gIoTAppCb.clientID), CN_CLIENTID_FMT, CONFIG_DEVICE_ID, CN_EVENT_TIME);
+    if (NULL != CONFIG_DEVICE_PWD)
+    {
+        (void)HmacGeneratePwd((const unsigned char *)CONFIG_DEVICE_PWD, strlen(CONFIG_DEVICE_PWD),
+                              (const unsigned char *)CN_EVENT_TIME, strlen(CN_EVENT_TIME),
+                              (unsigned char *)gIoTAppCb.userPwd, CN_HMAC_PWD_LEN);
+    }
+    IOT_LOG_DEBUG("IOTSERVER:%s\r\n", CN_IOT_SERVER);
+    IOT_LOG_DEBUG("CLIENTID:%s USERID:%s USERPWD:%s\r\n", gIoTAppCb.clientID, CONFIG_DEVICE_ID,
+                  NULL == CONFIG_DEVICE_PWD ? "NULL" : gIoTAppCb.userPwd);
+
+#ifdef CONFIG_MQTT_V5
+    createOpts.MQTTVersion = MQTTVERSION_5; ///< the version is fixed when the client is created
+#ifdef CONFIG_MQTT_ASYNC
+    rc = MQTTAsync_createWithOptions(&gIoTAppCb.client, CN_IOT_SERVER, gIoTAppCb.clientID,
+                                     MQTTCLIENT_PERSISTENCE_NONE, NULL, &createOpts);
+#else
+    rc = MQTTClient_createWithOptions(&gIoTAppCb.client, CN_IOT_SERVER, gIoTAppCb.clientID,
+                                      MQTTCLIENT_PERSISTENCE_NONE, NULL, &createOpts);
+#endif
+#elif defined(CONFIG_MQTT_ASYNC)
+    rc = MQTTAsync_create(&gIoTAppCb.client, CN_IOT_SERVER, gIoTAppCb.clientID, MQTTCLIENT_PERSISTENCE_NONE, NULL);
+#else
+    rc = MQTTClient_create(&gIoTAppCb.client, CN_IOT_SERVER, gIoTAppCb.clientID, MQTTCLIENT_PERSISTENCE_NONE, NULL);
+#endif
+    if (rc != CN_MQTT_SUCCESS)
+    {
+        IOT_LOG_ERROR("Create Client failed,Please check the parameters--%d\r\n", rc);
+        return -1;
+    }
+#ifdef CONFIG_MQTT_ASYNC
+    rc = MQTTAsync_setCallbacks(gIoTAppCb.client, NULL, ConnLostCallBack, MsgRcvCallBack, NULL);
+#else
+    rc = MQTTClient_setCallbacks(gIoTAppCb.client, NULL, ConnLostCallBack, MsgRcvCallBack, NULL);
+#endif
+    if (rc != CN_MQTT_SUCCESS)
+    {
+        IOT_LOG_ERROR("Set the callback failed,Please check the callback paras\r\n");
+#ifdef CONFIG_MQTT_ASYNC
+        MQTTAsync_destroy(&gIoTAppCb.client);
+#else
+        MQTTClient_destroy(&gIoTAppCb.client);
+#endif
+        return -1;
+    }
+    gIoTAppCb.clientReady = HI_TRUE;
+    return 0;
+}
+
+///< resolve the server name once, the later connects go to the address directly. With the tls the
+///< name is kept, the handshake needs it for the SNI and the certificate check
+static hi_void ConnResolve(hi_void)
+{
+#ifndef CONFIG_MQTT_SSL
+    const char *host;
+    const char *port;
+    char name[CN_SERVERHOST_SIZE];
+    hi_u8 *ip;
+    struct addrinfo hints;
+    struct addrinfo *res = NULL;
 
-    MQTTClient client;
+    if (gIoTAppCb.serverURI[0] != '\0')
+    {
+        return;
+    }
+    host = CN_IOT_SERVER;
+    if (0 == strncmp(host, "tcp://", strlen("tcp://")))
+    {
+        host += strlen("tcp://");
+    }
+    port = strrchr(host, ':');
+    if ((NULL == port) || (port == host) || ((hi_u32)(port - host) >= sizeof(name)))
+    {
+        return;
+    }
+    (void)memcpy_s(name, sizeof(name), host, port - host);
+    name[port - host] = '\0';
+    (void)memset_s(&hints, sizeof(hints), 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if ((0 != getaddrinfo(name, NULL, &hints, &res)) || (NULL == res))
+    {
+        IOT_LOG_ERROR("Resolve %s failed\r\n", name);
+        return;
+    }
+    ip = (hi_u8 *)&((struct sockaddr_in *)res->ai_addr)->sin_addr;
+    (void)snprintf(gIoTAppCb.serverURI, sizeof(gIoTAppCb.serverURI), "tcp://%u.%u.%u.%u%s",
+                   ip[0], ip[1], ip[2], ip[3], port);
+    freeaddrinfo(res);
+    gIoTAppCb.connStat.resolveCnt++;
+    IOT_LOG_DEBUG("SERVERADDR:%s\r\n", gIoTAppCb.serverURI);
+#endif
+    return;
+}
+
+///< the wait before the next connect: fast after a loss, then doubled each failure with a random half
+static hi_u32 ConnBackoffMs(hi_u32 attempt)
+{
+    hi_u32 ceil;
+    hi_u32 rnd = 0;
+
+    if (attempt == 0)
+    {
+        return CN_RECONNECT_FIRST_MS;
+    }
+    ceil = (attempt > 6) ? CN_RECONNECT_MAX_MS : (CN_RECONNECT_BASE_MS << (attempt - 1));
+    if (ceil > CN_RECONNECT_MAX_MS)
+    {
+        ceil = CN_RECONNECT_MAX_MS;
+    }
+    (void)hi_cipher_trng_get_random(&rnd);
+    return ceil / 2 + rnd % (ceil / 2 + 1); ///< the devices lost together do not come back together
+}
+
+///< connect to the server, the sessionPresent tells whether the server kept the last session
+static int MqttConnect(MqttClient_t client, hi_bool *sessionPresent)
+{
+    int rc;
+    char *serverURIs[1];
+#ifdef CONFIG_MQTT_V5
+    MQTTProperties props = MQTTProperties_initializer;
+    MQTTProperty expiry;
+#ifndef CONFIG_MQTT_ASYNC
+    MQTTResponse response;
+#endif
+#endif
+#ifdef CONFIG_MQTT_ASYNC
+    MQTTAsync_connectOptions conn_opts = MQTTAsync_connectOptions_initializer;
+#ifdef CONFIG_MQTT_SSL
+    MQTTAsync_SSLOptions ssl_opts = MQTTAsync_SSLOptions_initializer;
+#endif
+#else
     MQTTClient_connectOptions conn_opts = MQTTClient_connectOptions_initializer;
 #ifdef CONFIG_MQTT_SSL
     MQTTClient_SSLOptions ssl_opts = MQTTClient_SSLOptions_initializer;
+#endif
+#endif
+#ifdef CONFIG_MQTT_SSL
     cert_string trustStore = {(const unsigned char *)gIotCA, sizeof(gIotCA)};
 #ifdef CONFIG_MQTT_SSL_X509
     cert_string keyStore = {(const unsigned char *)gDeviceCA, sizeof(gDeviceCA)};
@@ -205,108 +778,210 @@ static hi_void MainEntryProcess(hi_void)
     conn_opts.ssl = &ssl_opts;
 #endif
 
-    IOT_LOG_DEBUG("IoT machine start here\r\n");
-    ///< make the clientID userID userPwd
-    clientID = hi_malloc(0, strlen(CN_CLIENTID_FMT) + strlen(CONFIG_DEVICE_ID) + strlen(CN_EVENT_TIME) + 1);
-    if (NULL == clientID)
+    conn_opts.keepAliveInterval = CN_KEEPALIVE_TIME;
+    conn_opts.username = CONFIG_DEVICE_ID;
+    conn_opts.password = (NULL == CONFIG_DEVICE_PWD) ? NULL : gIoTAppCb.userPwd;
+#ifdef CONFIG_MQTT_V5
+    ///< the server tells the topic aliases it takes in the CONNACK, paho uses them for the publishes
+    conn_opts.cleansession = 0;
+    conn_opts.cleanstart = CN_CLEANSESSION;
+    conn_opts.MQTTVersion = MQTTVERSION_5;
+    expiry.identifier = MQTTPROPERTY_CODE_SESSION_EXPIRY_INTERVAL;
+    expiry.value.integer4 = CN_SESSION_EXPIRY;
+    (void)MQTTProperties_add(&props, &expiry);
+#else
+    conn_opts.cleansession = CN_CLEANSESSION;
+    conn_opts.MQTTVersion = MQTTVERSION_3_1_1;
+#endif
+    if (gIoTAppCb.serverURI[0] != '\0')
     {
-        IOT_LOG_ERROR("No memory for the clientID\r\n");
-        goto EXIT_CLIENTID;
+        serverURIs[0] = gIoTAppCb.serverURI;
+        conn_opts.serverURIs = serverURIs;
+        conn_opts.serverURIcount = 1;
     }
-    (void)snprintf(clientID, strlen(CN_CLIENTID_FMT) + strlen(CONFIG_DEVICE_ID) + strlen(CN_EVENT_TIME) + 1,
-                   CN_CLIENTID_FMT, CONFIG_DEVICE_ID, CN_EVENT_TIME);
-    userID = CONFIG_DEVICE_ID;
-    if (NULL != CONFIG_DEVICE_PWD)
+#ifdef CONFIG_MQTT_ASYNC
+    conn_opts.maxInflight = CN_PUBLISH_WINDOW;
+    conn_opts.MqttOnSuccess = WaitOnSuccess;
+    conn_opts.MqttOnFailure = WaitOnFailure;
+    conn_opts.context = &gIoTAppCb;  ///< tells WaitOnSuccess it is the connect
+#ifdef CONFIG_MQTT_V5
+    conn_opts.connectProperties = &props;
+#endif
+    WaitReset();
+    gIoTAppCb.sessionPresent = HI_FALSE;
+    rc = MQTTAsync_connect(client, &conn_opts);
+    if (rc == MQTTASYNC_SUCCESS)
     {
-        userPwd = hi_malloc(0, CN_HMAC_PWD_LEN);
-        if (NULL == userPwd)
-        {
-            IOT_LOG_ERROR("No memory for the user passwd\r\n");
-            goto EXIT_USERPWD;
-        }
-        (void)HmacGeneratePwd((const unsigned char *)CONFIG_DEVICE_PWD, strlen(CONFIG_DEVICE_PWD),
-                              (const unsigned char *)CN_EVENT_TIME, strlen(CN_EVENT_TIME),
-                              (unsigned char *)userPwd, CN_HMAC_PWD_LEN);
+        rc = WaitDone();
     }
+    *sessionPresent = gIoTAppCb.sessionPresent;
+#elif defined(CONFIG_MQTT_V5)
+    response = MQTTClient_connect5(client, &conn_opts, &props, NULL);
+    rc = response.reasonCode;
+    MQTTResponse_free(response);
+    *sessionPresent = (conn_opts.returned.sessionPresent != 0);
+#else
+    rc = MQTTClient_connect(client, &conn_opts);
+    *sessionPresent = (conn_opts.returned.sessionPresent != 0);
+#endif
+#ifdef CONFIG_MQTT_V5
+    MQTTProperties_free(&props);
+#endif
+    return rc;
+}
 
-    conn_opts.keepAliveInterval = CN_KEEPALIVE_TIME;
-    conn_opts.cleansession = CN_CLEANSESSION;
-    conn_opts.username = userID;
-    conn_opts.password = userPwd;
-    conn_opts.MQTTVersion = MQTTVERSION_3_1_1;
+static int MqttSubscribe(MqttClient_t client)
+{
+    int rc;
+    int subQos[CN_TOPIC_SUBSCRIBE_NUM] = {1};
+#if defined(CONFIG_MQTT_V5) && !defined(CONFIG_MQTT_ASYNC)
+    MQTTResponse response;
+#endif
+#ifdef CONFIG_MQTT_ASYNC
+    MQTTAsync_responseOptions opts = MQTTAsync_responseOptions_initializer;
 
-    ///< wait for the wifi connect ok
-    IOT_LOG_DEBUG("IOTSERVER:%s\r\n", CN_IOT_SERVER);
-    IOT_LOG_DEBUG("CLIENTID:%s USERID:%s USERPWD:%s\r\n", clientID, userID, userPwd == NULL ? "NULL" : userPwd);
-    /*check wifi */
+    opts.MqttOnSuccess = WaitOnSuccess;
+    opts.MqttOnFailure = WaitOnFailure;
+    WaitReset();
+    rc = MQTTAsync_subscribeMany(client, CN_TOPIC_SUBSCRIBE_NUM, (char *const *)gDefaultSubscribeTopic,
+                                 (int *)&subQos[0], &opts);
+    if (rc == MQTTASYNC_SUCCESS)
+    {
+        rc = WaitDone();
+    }
+#elif defined(CONFIG_MQTT_V5)
+    response = MQTTClient_subscribeMany5(client, CN_TOPIC_SUBSCRIBE_NUM, (char *const *)gDefaultSubscribeTopic,
+                                         (int *)&subQos[0], NULL, NULL);
+    ///< the reason code of the first filter, the granted qos or a failure
+    rc = (response.reasonCode < MQTTREASONCODE_UNSPECIFIED_ERROR) ? MQTTCLIENT_SUCCESS : response.reasonCode;
+    MQTTResponse_free(response);
+#else
+    rc = MQTTClient_subscribeMany(client, CN_TOPIC_SUBSCRIBE_NUM, (char *const *)gDefaultSubscribeTopic, (int *)&subQos[0]);
+#endif
+    return rc;
+}
+
+static hi_bool MqttIsConnected(MqttClient_t client)
+{
+#ifdef CONFIG_MQTT_ASYNC
+    return MQTTAsync_isConnected(client) ? HI_TRUE : HI_FALSE;
+#else
+    return MQTTClient_isConnected(client) ? HI_TRUE : HI_FALSE;
+#endif
+}
+
+static hi_void MqttDisconnect(MqttClient_t client)
+{
+#ifdef CONFIG_MQTT_ASYNC
+    MQTTAsync_disconnectOptions opts = MQTTAsync_disconnectOptions_initializer;
+
+    opts.timeout = CONFIG_COMMAND_TIMEOUT;
+    (void)MQTTAsync_disconnect(client, &opts);
+#else
+    MQTTClient_disconnect(client, CONFIG_COMMAND_TIMEOUT);
+#endif
+    return;
+}
+
+///< connect and serve the queue until the connection is lost, return -1 if it could not connect
+static int MainEntryProcess(hi_void)
+{
+    int rc;
+    hi_u32 startMs;
+    hi_u32 costMs;
+    hi_bool sessionPresent = HI_FALSE;
+    MqttClient_t client;
 
+    IOT_LOG_DEBUG("IoT machine start here\r\n");
+    /*check wifi */
     if (wifi_second_connected)
     {
-        IOT_LOG_ERROR("Wifi disconnect, Please Check...%d\r\n", rc);
-        goto EXIT_CREATE;
+        IOT_LOG_ERROR("Wifi disconnect, Please Check...\r\n");
+        return -1;
     }
-    rc = MQTTClient_create(&client, CN_IOT_SERVER, clientID, MQTTCLIENT_PERSISTENCE_NONE, NULL);
-    if (rc != MQTTCLIENT_SUCCESS)
+    if (0 != ConnPrepare())
     {
-        IOT_LOG_ERROR("Create Client failed,Please check the parameters--%d\r\n", rc);
-        goto EXIT_CREATE;
+        return -1;
     }
+    client = gIoTAppCb.client;
+    ConnResolve();
 
-    rc = MQTTClient_setCallbacks(client, NULL, ConnLostCallBack, MsgRcvCallBack, NULL);
-    if (rc != MQTTCLIENT_SUCCESS)
+    startMs = hi_get_milli_seconds();
+    rc = MqttConnect(client, &sessionPresent);
+    if (rc != CN_MQTT_SUCCESS)
     {
-        IOT_LOG_ERROR("Set the callback failed,Please check the callback paras\r\n");
-        goto EXIT_SETCALLBACK;
+        IOT_LOG_ERROR("Connect IoT server failed,please check the network and parameters:%d\r\n", rc);
+        gIoTAppCb.connStat.failCnt++;
+        if (++gIoTAppCb.connFails >= CN_RESOLVE_FAILS)
+        {
+            gIoTAppCb.serverURI[0] = '\0'; ///< the address may have moved
+            gIoTAppCb.connFails = 0;
+        }
+        return -1;
     }
+    gIoTAppCb.connFails = 0;
+    costMs = hi_get_milli_seconds() - startMs;
+    IOT_LOG_DEBUG("Connect success:%u ms session present:%d\r\n", costMs, sessionPresent);
 
-    rc = MQTTClient_connect(client, &conn_opts);
-    if (rc != MQTTCLIENT_SUCCESS)
+    ///< the kept session has the subscriptions already
+    if (sessionPresent && gIoTAppCb.subscribed)
     {
-        IOT_LOG_ERROR("Connect IoT server failed,please check the network and parameters:%d\r\n", rc);
-        goto EXIT_CONNECT;
+        gIoTAppCb.connStat.resumeCnt++;
     }
-    IOT_LOG_DEBUG("Connect success\r\n");
-
-    rc = MQTTClient_subscribeMany(client, CN_TOPIC_SUBSCRIBE_NUM, (char *const *)gDefaultSubscribeTopic, (int *)&subQos[0]);
-    if (rc != MQTTCLIENT_SUCCESS)
+    else
     {
-        IOT_LOG_ERROR("Subscribe the default topic failed,Please check the parameters\r\n");
-        goto EXIT_SUBSCRIBE;
+        gIoTAppCb.subscribed = HI_FALSE;
+        rc = MqttSubscribe(client);
+        if (rc != CN_MQTT_SUCCESS)
+        {
+            IOT_LOG_ERROR("Subscribe the default topic failed,Please check the parameters\r\n");
+            MqttDisconnect(client);
+            gIoTAppCb.connStat.failCnt++;
+            return -1;
+        }
+        gIoTAppCb.subscribed = HI_TRUE;
+        IOT_LOG_DEBUG("Subscribe success\r\n");
+    }
+    gIoTAppCb.connStat.connectCnt++;
+    gIoTAppCb.connStat.lastConnectMs = costMs;
+    if (gIoTAppCb.lost)
+    {
+        gIoTAppCb.lost = HI_FALSE;
+        gIoTAppCb.connStat.reconnectCnt++;
+        gIoTAppCb.connStat.lastReconnectMs = hi_get_milli_seconds() - gIoTAppCb.lostMs;
+        if (gIoTAppCb.connStat.lastReconnectMs > gIoTAppCb.connStat.maxReconnectMs)
+        {
+            gIoTAppCb.connStat.maxReconnectMs = gIoTAppCb.connStat.lastReconnectMs;
+        }
     }
-    IOT_LOG_DEBUG("Subscribe success\r\n");
     mqtt_connect_success = HI_TRUE;
-    while (MQTTClient_isConnected(client))
+    while (MqttIsConnected(client))
     {
         printf("=========ProcessQueueMsg=========\n");
-        ProcessQueueMsg(client); ///< do the job here
-        MQTTClient_yield();      ///< make the keepalive done
+        ProcessQueueMsg(client); ///< do the job here, the keepalive is done by the paho receive thread
+#if defined(HOST_IOT_POLL) && !defined(CONFIG_MQTT_ASYNC)
+        MQTTClient_yield(); ///< host build only: the polling loop this replaced, to compare the latencies with
+#endif
     }
-    IOT_LOG_ERROR("disconnect and begin to quit\r\n");
-    MQTTClient_disconnect(client, CONFIG_COMMAND_TIMEOUT);
+    mqtt_connect_success = HI_FALSE;
+    IOT_LOG_ERROR("disconnect and wait for the reconnect\r\n");
+    MqttDisconnect(client); ///< the client is kept for the next connect
 
-EXIT_SUBSCRIBE:
-EXIT_CONNECT:
-EXIT_SETCALLBACK:
-    MQTTClient_destroy(&client);
-EXIT_CREATE:
-    if (NULL != userPwd)
-    {
-        hi_free(0, userPwd);
-    }
-EXIT_USERPWD:
-    hi_free(0, clientID);
-EXIT_CLIENTID:
-    return;
+    return 0;
 }
 
 static hi_void *MainEntry(hi_void *arg)
 {
+    hi_u32 attempt = 0;
+    hi_u32 waitMs;
+
     while (gIoTAppCb.stop == HI_FALSE)
     {
         printf("=========before MainEntryProcess========\n");
-        MainEntryProcess();
-        IOT_LOG_DEBUG("The connection lost and we will try another connect\r\n");
-        hi_sleep(1000 * 5);
+        attempt = (0 == MainEntryProcess()) ? 0 : (attempt + 1);
+        waitMs = ConnBackoffMs(attempt);
+        IOT_LOG_DEBUG("The connection lost and we will try another connect in %u ms\r\n", waitMs);
+        hi_sleep(waitMs);
     }
     return NULL;
 }
@@ -316,11 +991,32 @@ int IoTMain(void)
     hi_u32 ret;
     hi_task_attr attr = {0};
 
+    (void)IoTMsgSlabInit(&gIoTAppCb.msgSlab, gIoTMsgMem, gIoTMsgFreeList, CN_QUEUE_SLOTSIZE, CN_QUEUE_MSGNUM);
+    (void)IoTRouterInit(&gIoTAppCb.router, gIoTRouteNode, CN_ROUTE_NODENUM, gIoTRouteEdge, CN_ROUTE_EDGENUM);
     ret = hi_msg_queue_create(&gIoTAppCb.queueID, CN_QUEUE_MSGNUM, CN_QUEUE_MSGSIZE);
     if (ret != HI_ERR_SUCCESS)
     {
         IOT_LOG_ERROR("Create the msg queue Failed\r\n");
     }
+    gIoTAppCb.queueReady = (ret == HI_ERR_SUCCESS);
+    gIoTAppCb.pubStat.window = CN_PUBLISH_WINDOW;
+    ret = hi_sem_create(&gIoTAppCb.pubSem, CN_PUBLISH_WINDOW);
+    if (ret != HI_ERR_SUCCESS)
+    {
+        IOT_LOG_ERROR("Create the publish window Failed\r\n");
+    }
+#ifdef CONFIG_MQTT_ASYNC
+    ret = hi_sem_bcreate(&gIoTAppCb.waitSem, HI_SEM_ZERO);
+    if (ret != HI_ERR_SUCCESS)
+    {
+        IOT_LOG_ERROR("Create the wait sem Failed\r\n");
+    }
+    ret = hi_mux_create(&gIoTAppCb.doneMux);
+    if (ret != HI_ERR_SUCCESS)
+    {
+        IOT_LOG_ERROR("Create the done list mux Failed\r\n");
+    }
+#endif
 
     attr.stack_size = CN_TASK_STACKSIZE;
     attr.task_prio = CN_TASK_PRIOR;
@@ -341,41 +1037,103 @@ int IoTSetMsgCallback(fnMsgCallBack msgCallback)
     return 0;
 }
 
-int IotSendMsg(int qos, const char *topic, const char *payload)
+int IoTSetMsgRoute(const char *filter, fnMsgRouteCallBack routeCallback, void *arg)
 {
-    int rc = -1;
-    IoTMsg_t *msg;
-    char *buf;
-    hi_u32 bufSize;
+    if (0 != IoTRouterAdd(&gIoTAppCb.router, filter, routeCallback, arg))
+    {
+        IOT_LOG_ERROR("Add the route of %s failed\r\n", (filter == NULL) ? "NULL" : filter);
+        return -1;
+    }
+    return 0;
+}
 
-    bufSize = strlen(topic) + 1 + strlen(payload) + 1 + sizeof(IoTMsg_t);
-    buf = hi_malloc(0, bufSize);
-    if (buf != NULL)
+int IoTSetDueCallback(fnDueCallBack dueCallback, uint32_t delayMs)
+{
+    IoTMsg_t *none = NULL;
+
+    gIoTAppCb.dueMs = hi_get_milli_seconds() + delayMs;
+    gIoTAppCb.dueCallBack = dueCallback;
+    ///< the IoTMain task may be waiting longer than that, wake it to wait again to the new time
+    if (gIoTAppCb.queueReady)
     {
-        msg = (IoTMsg_t *)buf;
-        buf += sizeof(IoTMsg_t);
-        bufSize -= sizeof(IoTMsg_t);
-        msg->qos = qos;
-        msg->type = EN_IOT_MSG_PUBLISH;
-        (void)memcpy_s(buf, bufSize, topic, strlen(topic));
-        buf[strlen(topic)] = '\0';
-        msg->topic = buf;
-        buf += strlen(topic) + 1;
-        bufSize -= (strlen(topic) + 1);
-        (void)memcpy_s(buf, bufSize, payload, strlen(payload));
-        buf[strlen(payload)] = '\0';
-        msg->payload = buf;
-        // IOT_LOG_DEBUG("SNDMSG:QOS:%d TOPIC:%s PAYLOAD:%s\r\n",msg->qos,msg->topic,msg->payload);
-
-        if (HI_ERR_SUCCESS != hi_msg_queue_send(gIoTAppCb.queueID, &msg, CN_QUEUE_WAITTIMEOUT, sizeof(hi_pvoid)))
-        {
-            IOT_LOG_ERROR("=============IotSendMsg Wrie queue failed==============\r\n");
-            hi_free(0, msg);
-        }
-        else
-        {
-            rc = 0;
-        }
+        (void)hi_msg_queue_send(gIoTAppCb.queueID, &none, 0, sizeof(hi_pvoid));
+    }
+    return 0;
+}
+
+int IotSendMsgEx(int qos, const char *topic, const char *payload, fnPubCallBack pubCallback, void *arg)
+{
+    int rc;
+    hi_u32 waitMs;
+
+    // IOT_LOG_DEBUG("SNDMSG:QOS:%d TOPIC:%s PAYLOAD:%s\r\n",qos,topic,payload);
+    ///< wait for a place in the window, so the sender slows down to what the link takes. Only the
+    ///< IoTMain task frees places, so when it sends itself (a command response from the message
+    ///< callback) it takes a free place or fails at once instead of waiting for itself
+    waitMs = (hi_task_get_current_id() == gIoTAppCb.iotTaskID) ? 0 : CN_QUEUE_WAITTIMEOUT;
+    if (HI_ERR_SUCCESS != hi_sem_wait(gIoTAppCb.pubSem, waitMs))
+    {
+        gIoTAppCb.pubStat.busyCnt++;
+        IOT_LOG_ERROR("=============IotSendMsg window full==============\r\n");
+        return -1;
+    }
+    rc = MsgQueuePut(EN_IOT_MSG_PUBLISH, qos, topic, strlen(topic), payload, strlen(payload), pubCallback, arg);
+    if (rc != 0)
+    {
+        (void)hi_sem_signal(gIoTAppCb.pubSem);
+        IOT_LOG_ERROR("=============IotSendMsg Wrie queue failed==============\r\n");
     }
     return rc;
 }
+
+int IotSendMsg(int qos, const char *topic, const char *payload)
+{
+    return IotSendMsgEx(qos, topic, payload, NULL, NULL);
+}
+
+int IoTGetMsgStat(IoTMsgStat_t *stat)
+{
+    IoTMsgSlabStat_t slabStat;
+
+    if (NULL == stat)
+    {
+        return -1;
+    }
+    IoTMsgSlabGetStat(&gIoTAppCb.msgSlab, &slabStat);
+    stat->capacity = slabStat.slotNum;
+    stat->slotSize = slabStat.slotSize;
+    stat->used = slabStat.used;
+    stat->highWater = slabStat.highWater;
+    stat->total = slabStat.allocCnt;
+    stat->drops = slabStat.dropCnt + gIoTAppCb.queueDropCnt;
+    stat->oversize = slabStat.oversizeCnt;
+    return 0;
+}
+
+int IoTGetConnStat(IoTConnStat_t *stat)
+{
+    if (NULL == stat)
+    {
+        return -1;
+    }
+    *stat = gIoTAppCb.connStat;
+    return 0;
+}
+
+int IoTGetPubStat(IoTPubStat_t *stat)
+{
+    MqttPublishStats_t packets;
+
+    if (NULL == stat)
+    {
+        return -1;
+    }
+    *stat = gIoTAppCb.pubStat;
+    if (gIoTAppCb.clientReady && (CN_MQTT_SUCCESS == MqttGetPublishStats(gIoTAppCb.client, &packets)))
+    {
+        stat->packetCnt = packets.count;
+        stat->aliasedCnt = packets.aliased;
+        stat->packetBytes = packets.bytes;
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: fixed-capacity message slab for the IoT main queue
+ * Author: HiSpark Product Team.
+ * Create: 2020-5-20
+ */
+#ifndef IOT_MSG_SLAB_H_
+#define IOT_MSG_SLAB_H_
+
+#include <hi_types_base.h>
+
+/**
+ * The slab owns slotNum fixed-size slots carved from a caller supplied buffer.
+ * Producers take a slot, build the message in place and pass the slot pointer
+ * through the message queue; the consumer gives the slot back when it is done.
+ * A message larger than a slot is put on the heap instead, so it is not lost; the
+ * slots are sized for the usual messages and the heap is only used for the rare ones.
+*/
+typedef struct
+{
+    hi_u8 *mem;          ///< slotNum * slotSize bytes, supplied by the caller
+    hi_u16 *freeList;    ///< slotNum indexes, supplied by the caller
+    hi_u16 slotSize;     ///< bytes per slot
+    hi_u16 slotNum;      ///< number of slots
+    hi_u16 freeNum;      ///< free slots left in the freeList
+    hi_u16 highWater;    ///< the max slots ever in use at the same time
+    hi_u32 allocCnt;     ///< slots handed out since init
+    hi_u32 dropCnt;      ///< alloc requests failed because the slab is full or the heap has no room
+    hi_u32 oversizeCnt;  ///< alloc requests larger than slotSize, served from the heap
+} IoTMsgSlab_t;
+
+typedef struct
+{
+    hi_u16 slotSize;
+    hi_u16 slotNum;
+    hi_u16 used;         ///< current occupancy
+    hi_u16 highWater;
+    hi_u32 allocCnt;
+    hi_u32 dropCnt;
+    hi_u32 oversizeCnt;
+} IoTMsgSlabStat_t;
+
+/**
+ * Use this function to bind the slab to its storage
+ * @param mem: slotNum * slotSize bytes, should be aligned for the message header
+ * @param freeList: slotNum hi_u16 for the free index list
+ *
+ * @return 0 success while others failed
+*/
+int IoTMsgSlabInit(IoTMsgSlab_t *slab, hi_pvoid mem, hi_u16 *freeList, hi_u16 slotSize, hi_u16 slotNum);
+
+/**
+ * Take a free slot which could hold size bytes, or a heap block if size is larger than a slot
+ *
+ * @return the slot, or NULL if the slab is full or the heap has no room(counted as drop)
+*/
+hi_pvoid IoTMsgSlabAlloc(IoTMsgSlab_t *slab, hi_u32 size);
+
+/**
+ * Give the slot back to the slab or the heap, the slot must come from IoTMsgSlabAlloc
+*/
+hi_void IoTMsgSlabFree(IoTMsgSlab_t *slab, hi_pvoid slot);
+
+/**
+ * Get a snapshot of the slab counters
+*/
+hi_void IoTMsgSlabGetStat(IoTMsgSlab_t *slab, IoTMsgSlabStat_t *stat);
+
+#endif /* IOT_MSG_SLAB_H_ */
@@ -6,317 +6,412 @@
  */
 
 #include "iot_profile.h"
+#include "iot_profile_fmt.h"
 #include "iot_main.h"
 #include "iot_log.h"
-#include <hi_mem.h>
-#include <cJSON.h>
+#include <hi_mux.h>
+#include <hi_time.h>
+#include <hi_errno.h>
 #include <string.h>
 
-
-///< format the report data to json string mode
-static cJSON  *FormateProflleValue(IoTProfileKV_t  *kv)
-{
-    cJSON  *ret = NULL;
-    switch (kv->type)
-    {
-        case EN_IOT_DATATYPE_INT:
-            ret = cJSON_CreateNumber(kv->i_value);
-            // ret = cJSON_CreateNumber((double)(*(int *)kv->value));
-            break;
-        case EN_IOT_DATATYPE_LONG:
-            ret = cJSON_CreateNumber((double)(*(long *)kv->value));
-            break;
-        case EN_IOT_DATATYPE_FLOAT:
-            ret = cJSON_CreateNumber((double)(*(float *)kv->value));
-            break;
-        case EN_IOT_DATATYPE_DOUBLE:
-            ret = cJSON_CreateNumber((*(double *)kv->value));
-            break;
-        case EN_IOT_DATATYPE_STRING:
-            ret = cJSON_CreateString((const char *)kv->value);
-            break;
-        default:
-            break;
-    }
-    return ret;
-}
-
-static cJSON *MakeKvs(IoTProfileKV_t *kvlst)
+///< the topic and the payload are written on the stack, they must fit one IoT queue slot anyway
+int IoTProfileCmdResp(const char *deviceID,IoTCmdResp_t *payload)
 {
+    char topic[CN_PROFILE_TOPIC_SIZE];
+    char msg[CN_PROFILE_MSG_SIZE];
 
-    cJSON *root;
-    cJSON *kv;
-    IoTProfileKV_t  *kv_info;
+    if((NULL == deviceID)||(NULL == payload) || (NULL == payload->requestID)){
+        return -1;
+    }
 
-    ///< build a root node
-    root = cJSON_CreateObject();
-    if(NULL == root){
-       goto EXIT_MEM;
+    if((IoTProfileFmtTopic(topic, sizeof(topic), EN_PROFILE_TOPIC_CMDRESP, deviceID, payload->requestID) < 0) ||
+        (IoTProfileFmtCmdResp(msg, sizeof(msg), payload) < 0)){
+        return -1;
     }
+    return IotSendMsg(0, topic, msg);
+}
 
-    ///< add all the property to the properties
-    kv_info = kvlst;
-    while(NULL != kv_info){
-        kv = FormateProflleValue( kv_info);
-        if(NULL == kv){
-            goto EXIT_MEM;
-        }
+int IoTProfilePropertyReport(char *deviceID,IoTProfileService_t *payload)
+{
+    char topic[CN_PROFILE_TOPIC_SIZE];
+    char msg[CN_PROFILE_MSG_SIZE];
 
-        cJSON_AddItemToObject(root,kv_info->key,kv);
-        kv_info = kv_info->nxt;
+    if((NULL == deviceID) || (NULL== payload) || (NULL== payload->serviceID) || (NULL == payload->serviceProperty)){
+        return -1;
     }
-    ///< OK, now we return it
-    return root;
 
-EXIT_MEM:
-    if(NULL != root){
-       cJSON_Delete(root);
-       root = NULL;
+    if((IoTProfileFmtTopic(topic, sizeof(topic), EN_PROFILE_TOPIC_PROPERTYREPORT, deviceID, NULL) < 0) ||
+        (IoTProfileFmtPropertyReport(msg, sizeof(msg), payload) < 0)){
+        return -1;
     }
-    return root;
+    return IotSendMsg(0, topic, msg);
 }
 
-#define CN_PROFILE_SERVICE_KEY_SERVICEID "service_id"
-#define CN_PROFILE_SERVICE_KEY_PROPERTIIES "properties"
-#define CN_PROFILE_SERVICE_KEY_EVENTTIME "event_time"
-#define CN_PROFILE_KEY_SERVICES   "services"
-static cJSON *MakeService(IoTProfileService_t *serviceInfo)
+int IoTProfilePropertyGetResp(const char *deviceID, const char *requestID, IoTProfileService_t *payload)
 {
-    cJSON *root;
-    cJSON *serviceID;
-    cJSON *properties;
-    cJSON *eventTime;
+    char topic[CN_PROFILE_TOPIC_SIZE];
+    char msg[CN_PROFILE_MSG_SIZE];
 
-    ///< build a root node
-    root = cJSON_CreateObject();
-    if(NULL == root){
-       goto EXIT_MEM;
+    if((NULL == deviceID) || (NULL == requestID)){
+        return -1;
     }
 
-    ///< add the serviceID node to the root node
-    serviceID = cJSON_CreateString(serviceInfo->serviceID);
-    if(NULL == serviceID){
-       goto EXIT_MEM;
+    ///< NULL payload makes an empty services array, for the device knows nothing yet
+    if((IoTProfileFmtTopic(topic, sizeof(topic), EN_PROFILE_TOPIC_PROPERTYGETRESP, deviceID, requestID) < 0) ||
+        (IoTProfileFmtPropertyReport(msg, sizeof(msg), payload) < 0)){
+        return -1;
     }
-    cJSON_AddItemToObjectCS(root,CN_PROFILE_SERVICE_KEY_SERVICEID,serviceID);
+    return IotSendMsg(0, topic, msg);
+}
 
-    ///< add the properties node to the root
-    properties = MakeKvs(serviceInfo->serviceProperty);
-    if(NULL == properties){
-       goto EXIT_MEM;
+int IoTProfileEventReport(const char *deviceID, IoTProfileEvent_t *payload)
+{
+    char topic[CN_PROFILE_TOPIC_SIZE];
+    char msg[CN_PROFILE_MSG_SIZE];
+
+    if((NULL == deviceID) || (NULL == payload) || (NULL == payload->serviceID) || (NULL == payload->eventType)){
+        return -1;
     }
-    cJSON_AddItemToObjectCS(root,CN_PROFILE_SERVICE_KEY_PROPERTIIES,properties);
 
-    ///< add the event time (optional) to the root
-    if(NULL != serviceInfo->eventTime){
-        eventTime = cJSON_CreateString(serviceInfo->eventTime);
-        if(NULL == eventTime){
-           goto EXIT_MEM;
-        }
-        cJSON_AddItemToObjectCS(root,CN_PROFILE_SERVICE_KEY_EVENTTIME,eventTime);
+    if((IoTProfileFmtTopic(topic, sizeof(topic), EN_PROFILE_TOPIC_EVENTREPORT, deviceID, NULL) < 0) ||
+        (IoTProfileFmtEvent(msg, sizeof(msg), deviceID, payload) < 0)){
+        return -1;
     }
+    return IotSendMsg(0, topic, msg);
+}
 
-    ///< OK, now we return it
-    return root;
+///< the report builder: the properties are kept here and go out in one report
+#define CN_PROFILE_REPORT_SERVICENUM        4
+#define CN_PROFILE_REPORT_PROPERTYNUM       16
+#define CN_PROFILE_REPORT_STRSIZE           256
+#define CN_PROFILE_REPORT_SIZE_ROOT         16  ///< {"services":[]}
+#define CN_PROFILE_REPORT_SIZE_SERVICE      34  ///< {"service_id":"","properties":{}},
+#define CN_PROFILE_REPORT_SIZE_PROPERTY     6   ///< "":"",
+#define CN_PROFILE_REPORT_SIZE_NUMBER       16  ///< up to 17 digits, mostly far less
+typedef struct
+{
+    const char *key;
+    char       *str;                  ///< in the strBuf, NULL means the number
+    double      num;
+    hi_u8       service;              ///< index of the serviceID
+}ReportProperty_t;
 
-EXIT_MEM:
-    if(NULL != root){
-       cJSON_Delete(root);
-       root = NULL;
+typedef struct
+{
+    hi_bool              init;
+    hi_u32               mux;
+    char                 topic[CN_PROFILE_TOPIC_SIZE];
+    hi_u32               topicLen;
+    char                 msg[CN_PROFILE_MSG_SIZE];
+    hi_u32               windowMs;
+    hi_u32               sizeCap;
+    const char          *serviceID[CN_PROFILE_REPORT_SERVICENUM];
+    hi_u8                serviceNum;
+    ReportProperty_t     property[CN_PROFILE_REPORT_PROPERTYNUM];
+    hi_u8                propertyNum;
+    hi_u16               strUsed;
+    char                 strBuf[CN_PROFILE_REPORT_STRSIZE];
+    hi_u32               size;        ///< the estimated payload length
+    hi_u32               addNum;      ///< properties added since the last flush, including the replaced ones
+    hi_u32               firstMs;     ///< when the first pending property was added
+    IoTProfileService_t  flushService[CN_PROFILE_REPORT_SERVICENUM];
+    IoTProfileKV_t       flushKv[CN_PROFILE_REPORT_PROPERTYNUM];
+    IoTProfileReportStat_t stat;
+}ReportBuilder_t;
+static ReportBuilder_t gReport;
+
+///< the number properties are kept as double by the report builder and the shadow
+hi_bool IoTProfileKvNumber(IoTProfileKV_t *kv, double *num)
+{
+    switch (kv->type)
+    {
+        case EN_IOT_DATATYPE_INT:
+            *num = kv->i_value;
+            break;
+        case EN_IOT_DATATYPE_LONG:
+            *num = (double)(*(long *)kv->value);
+            break;
+        case EN_IOT_DATATYPE_FLOAT:
+            *num = (double)(*(float *)kv->value);
+            break;
+        case EN_IOT_DATATYPE_DOUBLE:
+            *num = *(double *)kv->value;
+            break;
+        default:
+            return HI_FALSE;
     }
-    return root;
+    return HI_TRUE;
 }
 
-static cJSON *MakeServices(IoTProfileService_t *serviceInfo)
+///< publish the pending properties, called with the mux hold
+static int ReportFlush(void)
 {
-    cJSON *services = NULL;
-    cJSON *service;
-    IoTProfileService_t  *serviceTmp;
+    int ret = -1;
+    int len;
+    hi_u8 i;
+    ReportProperty_t *property;
+    IoTProfileKV_t *kv;
+    IoTProfileService_t *service;
 
-    ///< create the services array node
-    services = cJSON_CreateArray();
-    if(NULL == services){
-       goto EXIT_MEM;
+    if(0 == gReport.propertyNum){
+        return 0;
     }
 
-    serviceTmp = serviceInfo;
-    while(NULL != serviceTmp){
-        service = MakeService(serviceTmp);
-        if(NULL == service){
-            goto EXIT_MEM;
+    ///< link the pending properties to the profile services, so the report is made the same way
+    (void) memset(gReport.flushService, 0, sizeof(gReport.flushService));
+    for(i = 0; i < gReport.serviceNum; i++){
+        gReport.flushService[i].serviceID = (char *)gReport.serviceID[i];
+        gReport.flushService[i].nxt = (i + 1 < gReport.serviceNum) ? &gReport.flushService[i + 1] : NULL;
+    }
+    for(i = gReport.propertyNum; i > 0; i--){
+        property = &gReport.property[i - 1];
+        kv = &gReport.flushKv[i - 1];
+        service = &gReport.flushService[property->service];
+        (void) memset(kv, 0, sizeof(IoTProfileKV_t));
+        kv->key = property->key;
+        if(NULL != property->str){
+            kv->type = EN_IOT_DATATYPE_STRING;
+            kv->value = property->str;
+        }
+        else{
+            kv->type = EN_IOT_DATATYPE_DOUBLE;
+            kv->value = (const char *)&property->num;
         }
+        kv->nxt = service->serviceProperty;
+        service->serviceProperty = kv;
+    }
 
-        cJSON_AddItemToArray(services,service);
-        serviceTmp = serviceTmp->nxt;
+    len = IoTProfileFmtPropertyReport(gReport.msg, sizeof(gReport.msg), gReport.flushService);
+    if(len >= 0){
+        ret = IotSendMsg(0, gReport.topic, gReport.msg);
+        if(0 == ret){
+            gReport.stat.publishCnt++;
+            gReport.stat.publishSaved += gReport.addNum - 1;
+            gReport.stat.bytesOnAir += gReport.topicLen + (hi_u32)len;
+        }
+    }
+    if(0 != ret){
+        gReport.stat.dropCnt += gReport.addNum; ///< the status will be reported again by the next refresh
     }
 
-    ///< now we return the services
-    return services;
+    gReport.serviceNum = 0;
+    gReport.propertyNum = 0;
+    gReport.strUsed = 0;
+    gReport.size = CN_PROFILE_REPORT_SIZE_ROOT;
+    gReport.addNum = 0;
+    return ret;
+}
+
+///< return the index of the service, or serviceNum if it is not pending
+static hi_u8 ReportFindService(const char *serviceID)
+{
+    hi_u8 svc;
 
-EXIT_MEM:
-    if(NULL != services){
-       cJSON_Delete(services);
-       services = NULL;
+    for(svc = 0; svc < gReport.serviceNum; svc++){
+        if(0 == strcmp(gReport.serviceID[svc], serviceID)){
+            break;
+        }
     }
-    return services;
+    return svc;
 }
 
-///< use this function to make a topic to publish
-///< if request_id  is needed depends on the fmt
-static char *MakeTopic(const char *fmt, const char *device_id, const char *requestID)
+///< a new service costs its own object in the payload
+static hi_u32 ReportServiceSize(hi_u8 svc, const char *serviceID)
 {
-    int len;
-    char *ret = NULL;
+    return (svc < gReport.serviceNum) ? 0 : (strlen(serviceID) + CN_PROFILE_REPORT_SIZE_SERVICE);
+}
 
-    len = strlen(fmt) + strlen(device_id);
-    if(NULL != requestID){
-        len += strlen(requestID);
-    }
+///< the pending property of the service with the key, NULL if none
+static ReportProperty_t *ReportFindProperty(hi_u8 svc, const char *key)
+{
+    hi_u8 i;
 
-    ret = hi_malloc(0,len);
-    if(NULL != ret){
-        if(NULL !=  requestID){
-            (void) snprintf(ret,len,fmt,device_id,requestID);
+    for(i = 0; i < gReport.propertyNum; i++){
+        if((gReport.property[i].service == svc) && (0 == strcmp(gReport.property[i].key, key))){
+            return &gReport.property[i];
         }
-        else {
-            (void) snprintf(ret,len,fmt,device_id);
-        }   
     }
-    return ret;
+    return NULL;
 }
 
-#define CN_PROFILE_CMDRESP_KEY_RETCODE        "result_code"
-#define CN_PROFILE_CMDRESP_KEY_RESPNAME       "response_name"
-#define CN_PROFILE_CMDRESP_KEY_PARAS          "paras"
-static char *MakeProfileCmdResp(IoTCmdResp_t *payload)
+///< the payload bytes of one property, the number when str is NULL
+static hi_u32 ReportPropertySize(const char *key, const char *str)
 {
-    char *ret = NULL;
-    cJSON *root;
-    cJSON *retCode;
-    cJSON *respName;
-    cJSON *paras;
+    return strlen(key) + CN_PROFILE_REPORT_SIZE_PROPERTY +
+        ((NULL == str) ? CN_PROFILE_REPORT_SIZE_NUMBER : (strlen(str) + 1));
+}
 
-    ///< create the root node
-    root = cJSON_CreateObject();
-    if(NULL == root){
-       goto EXIT_MEM;
-    }
+///< the window has passed with no later add or flush to see it, the IoTMain task calls this
+static void ReportWindowDue(void)
+{
+    (void) IoTProfileReportFlush(HI_FALSE);
+}
 
-    ///< create retcode and retdesc and add it to the root
-    retCode = cJSON_CreateNumber(payload->retCode);
-    if(NULL == retCode){
-        goto EXIT_MEM;
+///< add or replace one property, called with the mux hold
+static int ReportAddProperty(const char *serviceID, IoTProfileKV_t *kv)
+{
+    hi_u8 svc;
+    hi_u32 size;
+    hi_u32 oldSize = 0;
+    hi_u32 strLen = 0;
+    hi_u32 strNeed;
+    double num = 0;
+    hi_bool isNum;
+    ReportProperty_t *property;
+
+    isNum = IoTProfileKvNumber(kv, &num);
+    if((!isNum) && ((EN_IOT_DATATYPE_STRING != kv->type) || (NULL == kv->value))){
+        return -1;
     }
-    cJSON_AddItemToObjectCS(root,CN_PROFILE_CMDRESP_KEY_RETCODE,retCode);
 
-    if(NULL != payload->respName){
-        respName = cJSON_CreateString(payload->respName);
-        if(NULL == respName){
-            goto EXIT_MEM;
-        }
-        cJSON_AddItemToObjectCS(root,CN_PROFILE_CMDRESP_KEY_RESPNAME,respName);
+    size = ReportPropertySize(kv->key, isNum ? NULL : kv->value);
+    if(!isNum){
+        strLen = strlen(kv->value) + 1;
     }
-
-    if(NULL != payload->paras)
-    {
-        paras = MakeKvs(payload->paras);
-        if(NULL == paras){
-            goto EXIT_MEM;
+    svc = ReportFindService(serviceID);
+
+    ///< the latest value wins if the property is already pending: it gives its room back, and its
+    ///< string is written over when the new one fits there
+    property = (svc < gReport.serviceNum) ? ReportFindProperty(svc, kv->key) : NULL;
+    strNeed = strLen;
+    if(NULL != property){
+        oldSize = ReportPropertySize(property->key, property->str);
+        if((NULL != property->str) && (strLen <= strlen(property->str) + 1)){
+            strNeed = 0;
         }
-        cJSON_AddItemToObjectCS(root,CN_PROFILE_CMDRESP_KEY_PARAS,paras);
     }
 
-    ///< OK, now we make it to a buffer
-    ret = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    return ret;
+    ///< no room for it, send the pending ones first
+    if((gReport.propertyNum > 0) &&
+        ((gReport.size - oldSize + size + ReportServiceSize(svc, serviceID) > gReport.sizeCap) ||
+        ((NULL == property) && (gReport.propertyNum == CN_PROFILE_REPORT_PROPERTYNUM)) ||
+        (svc == CN_PROFILE_REPORT_SERVICENUM) ||
+        (gReport.strUsed + strNeed > CN_PROFILE_REPORT_STRSIZE))){
+        (void) ReportFlush();
+        svc = 0;
+        property = NULL;
+        oldSize = 0;
+        strNeed = strLen;
+    }
+    size += ReportServiceSize(svc, serviceID);
+    ///< it could not fit in a report alone
+    if((strLen > CN_PROFILE_REPORT_STRSIZE) || (gReport.size - oldSize + size > gReport.sizeCap)){
+        gReport.stat.dropCnt++;
+        return -1;
+    }
+    if(svc == gReport.serviceNum){
+        gReport.serviceNum++;
+        gReport.serviceID[svc] = serviceID;
+    }
 
-EXIT_MEM:
-    if(NULL != root){
-       cJSON_Delete(root);
+    if(NULL == property){
+        property = &gReport.property[gReport.propertyNum++];
+        property->key = kv->key;
+        property->service = svc;
+    }
+    gReport.size = gReport.size - oldSize + size;
+    if(isNum){
+        property->str = NULL;
+        property->num = num;
+    }
+    else{
+        if(0 != strNeed){
+            property->str = &gReport.strBuf[gReport.strUsed];
+            gReport.strUsed += strLen;
+        }
+        (void) memcpy(property->str, kv->value, strLen);
     }
 
-    return ret;
+    if(0 == gReport.addNum){
+        gReport.firstMs = hi_get_milli_seconds();
+        if(gReport.windowMs > 0){
+            (void) IoTSetDueCallback(ReportWindowDue, gReport.windowMs);
+        }
+    }
+    gReport.addNum++;
+    gReport.stat.propertyCnt++;
+    return 0;
 }
-#define CN_PROFILE_TOPICFMT_CMDRESP   "$oc/devices/%s/sys/commands/response/request_id=%s"
-int IoTProfileCmdResp(const char *deviceID,IoTCmdResp_t *payload)
+
+int IoTProfileReportInit(const char *deviceID, hi_u32 windowMs, hi_u32 sizeCap)
 {
-    int ret = -1;
-    const char *topic;
-    const char *msg;
+    int len;
 
-    if((NULL == deviceID)||(NULL == payload) || (NULL == payload->requestID)){
-        return ret;
+    if((NULL == deviceID) || gReport.init){
+        return -1;
     }
-
-    topic = MakeTopic(CN_PROFILE_TOPICFMT_CMDRESP, deviceID,payload->requestID);
-    msg = MakeProfileCmdResp(payload);
-    if((NULL != topic) && (NULL != msg)){
-        ret = IotSendMsg(0,topic,msg);
+    len = IoTProfileFmtTopic(gReport.topic, sizeof(gReport.topic), EN_PROFILE_TOPIC_PROPERTYREPORT, deviceID, NULL);
+    if(len < 0){
+        return -1;
     }
-
-    hi_free(0,topic);
-    cJSON_free(msg);
-
-    return ret;
+    if(HI_ERR_SUCCESS != hi_mux_create(&gReport.mux)){
+        return -1;
+    }
+    gReport.topicLen = (hi_u32)len;
+    gReport.windowMs = windowMs;
+    gReport.sizeCap = (0 == sizeCap) ? CN_PROFILE_REPORT_SIZECAP : sizeCap;
+    if(gReport.sizeCap >= CN_PROFILE_MSG_SIZE){
+        gReport.sizeCap = CN_PROFILE_MSG_SIZE - 1;
+    }
+    gReport.size = CN_PROFILE_REPORT_SIZE_ROOT;
+    gReport.init = HI_TRUE;
+    return 0;
 }
 
-static char *MakeProfilePropertyReport(IoTProfileService_t *payload)
+int IoTProfileReportAdd(IoTProfileService_t *payload)
 {
-    char *ret = NULL;
-    cJSON *root;
-    cJSON *services;
+    int ret = 0;
+    IoTProfileService_t *service;
+    IoTProfileKV_t *kv;
 
-    ///< create the root node
-    root = cJSON_CreateObject();
-    if(NULL == root){
-       goto EXIT_MEM;
+    if((!gReport.init) || (NULL == payload)){
+        return -1;
     }
 
-    ///< create the services array node to the root
-    services = MakeServices(payload);
-    if(NULL == services){
-        goto EXIT_MEM;
+    (void) hi_mux_pend(gReport.mux, HI_SYS_WAIT_FOREVER);
+    for(service = payload; (NULL != service) && (0 == ret); service = service->nxt){
+        if(NULL == service->serviceID){
+            ret = -1;
+            break;
+        }
+        for(kv = service->serviceProperty; NULL != kv; kv = kv->nxt){
+            if((NULL == kv->key) || (0 != ReportAddProperty(service->serviceID, kv))){
+                ret = -1;
+                break;
+            }
+        }
     }
-    cJSON_AddItemToObjectCS(root,CN_PROFILE_KEY_SERVICES,services);
-
-    ///< OK, now we make it to a buffer
-    ret = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    return ret;
-
-EXIT_MEM:
-    if(NULL != root){
-       cJSON_Delete(root);
+    if((gReport.propertyNum > 0) && ((hi_u32)(hi_get_milli_seconds() - gReport.firstMs) >= gReport.windowMs)){
+        (void) ReportFlush();
     }
+    (void) hi_mux_post(gReport.mux);
+
     return ret;
 }
-#define CN_PROFILE_TOPICFMT_PROPERTYREPORT   "$oc/devices/%s/sys/properties/report"
-int IoTProfilePropertyReport(char *deviceID,IoTProfileService_t *payload)
+
+int IoTProfileReportFlush(hi_bool force)
 {
-    int ret = -1;
-    char *topic;
-    char *msg;
+    int ret = 0;
 
-    if((NULL == deviceID) || (NULL== payload) || (NULL== payload->serviceID) || (NULL == payload->serviceProperty)){
-        return ret;
-    }
-    
-    topic = MakeTopic(CN_PROFILE_TOPICFMT_PROPERTYREPORT, deviceID,NULL);
-    msg = MakeProfilePropertyReport(payload);
-    
-    if((NULL != topic) && (NULL != msg)){
-        ret = IotSendMsg(0,topic,msg);
+    if(!gReport.init){
+        return -1;
     }
 
-    hi_free(0,topic);
-    cJSON_free(msg);
+    (void) hi_mux_pend(gReport.mux, HI_SYS_WAIT_FOREVER);
+    if((gReport.propertyNum > 0) &&
+        (force || ((hi_u32)(hi_get_milli_seconds() - gReport.firstMs) >= gReport.windowMs))){
+        ret = ReportFlush();
+    }
+    (void) hi_mux_post(gReport.mux);
 
     return ret;
 }
 
-
-
-
-
-
+int IoTProfileReportGetStat(IoTProfileReportStat_t *stat)
+{
+    if(NULL == stat){
+        return -1;
+    }
+    *stat = gReport.stat;
+    return 0;
+}
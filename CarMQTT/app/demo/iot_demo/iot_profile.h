@@ -53,6 +53,14 @@ typedef struct
     const char   *requestID;///< specified by the message command
     IoTProfileKV_t  *paras;  ///< the command paras
 }IoTCmdResp_t;
+typedef struct
+{
+    const char *serviceID;            ///< the service id in the profile, which could not be NULL
+    const char *eventType;            ///< the event type, which could not be NULL
+    const char *eventTime;            ///< eventtime, which could be NULL means use the platform time
+    IoTProfileKV_t *paras;            ///< the event paras, which could be NULL
+}IoTProfileEvent_t;
+
 /**
  * Use this function to make the command response here
  * and you must supplied the device id, and the payload defines as IoTCmdResp_t
@@ -67,4 +75,70 @@ int IoTProfileCmdResp(const char *deviceid,IoTCmdResp_t *payload);
 int IoTProfilePropertyReport(char *deviceID,IoTProfileService_t *payload);
 /**/
 
+/**
+ * use this function to report the event to the iot platform
+ *
+*/
+int IoTProfileEventReport(const char *deviceID, IoTProfileEvent_t *payload);
+
+/**
+ * get the value of a number property as double
+ *
+ * @return HI_FALSE if the property is not a number
+*/
+hi_bool IoTProfileKvNumber(IoTProfileKV_t *kv, double *num);
+
+/**
+ * use this function to answer the sys/properties/get request of the iot platform
+ * the payload could be NULL, which means no property to return
+*/
+int IoTProfilePropertyGetResp(const char *deviceID, const char *requestID, IoTProfileService_t *payload);
+
+#define CN_PROFILE_REPORT_SIZECAP 384 ///< the default payload cap, the report must fit in one IoT queue slot
+
+typedef struct
+{
+    hi_u32 propertyCnt;    ///< properties added to the report builder
+    hi_u32 publishCnt;     ///< reports published by the builder
+    hi_u32 publishSaved;   ///< publishes saved against one report per property
+    hi_u32 bytesOnAir;     ///< topic and payload bytes of the reports published
+    hi_u32 dropCnt;        ///< properties lost because the report could not be made or sent
+}IoTProfileReportStat_t;
+
+/**
+ * Set up the report builder, which puts the properties of many services into one report
+ *
+ * @param deviceID: the device the reports are sent for
+ * @param windowMs: how long the first added property may wait for the others, 0 means no wait
+ * @param sizeCap: the payload size to flush at, 0 means CN_PROFILE_REPORT_SIZECAP
+ *
+ * @return 0 success while others failed
+*/
+int IoTProfileReportInit(const char *deviceID, hi_u32 windowMs, hi_u32 sizeCap);
+
+/**
+ * Add the properties to the pending report, a pending property with the same key is replaced.
+ * The values are copied, while the serviceID and the keys are kept by reference, so use the
+ * constant strings. The eventTime is not kept, the platform time is used.
+ *
+ * @return 0 success while others failed
+*/
+int IoTProfileReportAdd(IoTProfileService_t *payload);
+
+/**
+ * Publish the pending report, call it when a refresh is done
+ *
+ * @param force: HI_FALSE only publishes if the flush window has expired
+ *
+ * @return 0 success while others failed
+*/
+int IoTProfileReportFlush(hi_bool force);
+
+/**
+ * Get the report builder counters
+ *
+ * @return 0 success while others failed
+*/
+int IoTProfileReportGetStat(IoTProfileReportStat_t *stat);
+
 #endif
\ No newline at end of file
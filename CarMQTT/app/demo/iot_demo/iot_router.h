@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: topic router of the received messages
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-28
+ */
+#ifndef IOT_ROUTER_H_
+#define IOT_ROUTER_H_
+
+#include <hi_types_base.h>
+
+#define CN_IOT_ROUTE_NONE      0xffff
+#define CN_IOT_ROUTE_LEVELNUM  16    ///< the topics and filters with more levels are not routed
+#define CN_IOT_ROUTE_MATCHNUM  8     ///< the handlers called for one topic at most
+#define CN_IOT_ROUTE_REQID     "request_id="
+#define CN_IOT_ROUTE_REQIDSIZE 64    ///< a request id not at the end of the topic is copied, longer ones are dropped
+
+/**
+ * The handler of a filter
+ *
+ * @param requestID: the value of the first "request_id=" level of the topic, NULL if it has none
+ * @param arg: as given to IoTRouterAdd
+*/
+typedef hi_void (*fnIoTRouteHandler)(int qos, const char *topic, const char *requestID, const char *payload,
+                                     hi_pvoid arg);
+
+typedef struct
+{
+    const char *level;          ///< points into the filter, not ended with '\0'
+    fnIoTRouteHandler handler;  ///< of the filter that ends here, NULL if none
+    hi_pvoid arg;
+    hi_u16 levelLen;
+    hi_u16 parent;
+    hi_u16 plus;                ///< the '+' child, CN_IOT_ROUTE_NONE if none
+    hi_u16 multi;               ///< the '#' child, CN_IOT_ROUTE_NONE if none
+} IoTRouteNode_t;
+
+/**
+ * The filters are compiled into a trie of their levels. The '+' and '#' children hang on their
+ * parent, the other children are found in one hash table keyed by the parent and the level, so a
+ * topic costs one hash per level however many filters there are. As the message slab, the
+ * storage is supplied by the caller and no heap is used.
+*/
+typedef struct
+{
+    IoTRouteNode_t *node;   ///< nodeNum nodes, node 0 is the root
+    hi_u16 *edge;           ///< edgeMask + 1 node indexes, CN_IOT_ROUTE_NONE for the empty slot
+    hi_u16 nodeNum;
+    hi_u16 nodeUsed;
+    hi_u16 edgeMask;
+    hi_u16 filterNum;
+} IoTRouter_t;
+
+/**
+ * Use this function to bind the router to its storage
+ * @param node: nodeNum nodes, one for each distinct level of the filters and one for the root
+ * @param edge: edgeNum hi_u16, edgeNum is a power of 2 and larger than nodeNum
+ *
+ * @return 0 success while others failed
+*/
+int IoTRouterInit(IoTRouter_t *router, IoTRouteNode_t *node, hi_u16 nodeNum, hi_u16 *edge, hi_u16 edgeNum);
+
+/**
+ * Route the topics matching the filter to the handler, the handler of the same filter added
+ * before is replaced. The filter is kept by reference, so use the constant strings. The routes
+ * could be added while the messages are dispatched, a node is linked only after it is written.
+ *
+ * @return 0 success while others failed(bad filter or no node left)
+*/
+int IoTRouterAdd(IoTRouter_t *router, const char *filter, fnIoTRouteHandler handler, hi_pvoid arg);
+
+/**
+ * Match the topic in one walk of the trie and call the handler of every filter it matches.
+ * As MQTT, the wildcards at the first level do not match the topics beginning with '$'.
+ *
+ * @return the number of the handlers called, 0 if no filter matches
+*/
+int IoTRouterDispatch(const IoTRouter_t *router, int qos, const char *topic, const char *payload);
+
+#endif /* IOT_ROUTER_H_ */
@@ -208,6 +208,175 @@ CJSON_PUBLIC(void) cJSON_InitHooks(cJSON_Hooks* hooks)
     }
 }
 
+#ifdef CJSON_OBJECT_INDEX
+/* The index of the children of an object by name: open addressing over a power of 2 of slots, at
+ * most half of them used, probed one after the other. The children go in in the order of the list,
+ * so of the children with one name a lookup finds the first, as the walk of the list does. The
+ * slots follow the header in one allocation. */
+struct cJSON_Index
+{
+    size_t mask;
+    size_t count;
+};
+
+#define index_slots(index) ((cJSON**)(void*)((index) + 1))
+
+/* the index of the objects parsed into an arena, they are never indexed as nothing would free it */
+static struct cJSON_Index arena_index = { 0, 0 };
+
+#define index_is_built(item) (((item)->index != NULL) && ((item)->index != &arena_index))
+
+/* FNV-1a of the name in lower case, as case_insensitive_strcmp compares */
+static size_t index_hash(const unsigned char *name)
+{
+    size_t hash = 2166136261u;
+
+    while (*name != '\0')
+    {
+        hash = (hash ^ (size_t)tolower(*name)) * 16777619u;
+        name++;
+    }
+
+    return hash;
+}
+
+static void index_add(struct cJSON_Index * const index, cJSON * const item)
+{
+    cJSON **slots = index_slots(index);
+    size_t slot = index_hash((const unsigned char*)item->string) & index->mask;
+
+    while (slots[slot] != NULL)
+    {
+        slot = (slot + 1) & index->mask;
+    }
+    slots[slot] = item;
+    index->count++;
+}
+
+/* Index the children of the object, NULL if one of them has no name or there is no memory. */
+static struct cJSON_Index *index_build(const cJSON * const object)
+{
+    struct cJSON_Index *index = NULL;
+    cJSON *child = NULL;
+    size_t count = 0;
+    size_t size = 1;
+
+    for (child = object->child; child != NULL; child = child->next)
+    {
+        if (child->string == NULL)
+        {
+            return NULL;
+        }
+        count++;
+    }
+    while (size < (count * 2))
+    {
+        size *= 2;
+    }
+
+    index = (struct cJSON_Index*)global_hooks.allocate(sizeof(struct cJSON_Index) + (size * sizeof(cJSON*)));
+    if (index == NULL)
+    {
+        return NULL;
+    }
+    memset(index_slots(index), '\0', size * sizeof(cJSON*));
+    index->mask = size - 1;
+    index->count = 0;
+    for (child = object->child; child != NULL; child = child->next)
+    {
+        index_add(index, child);
+    }
+
+    return index;
+}
+
+static cJSON *index_get(const struct cJSON_Index * const index, const char * const name, const cJSON_bool case_sensitive)
+{
+    cJSON **slots = index_slots(index);
+    size_t slot = index_hash((const unsigned char*)name) & index->mask;
+
+    while (slots[slot] != NULL)
+    {
+        if (case_sensitive ? (strcmp(name, slots[slot]->string) == 0) : (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)slots[slot]->string) == 0))
+        {
+            return slots[slot];
+        }
+        slot = (slot + 1) & index->mask;
+    }
+
+    return NULL;
+}
+
+static void index_drop(cJSON * const object)
+{
+    if (index_is_built(object))
+    {
+        global_hooks.deallocate(object->index);
+        object->index = NULL;
+    }
+}
+
+/* Index the item appended to the object, or drop the index if it would be more than half used. */
+static void index_append(cJSON * const object, cJSON * const item)
+{
+    if (!index_is_built(object))
+    {
+        return;
+    }
+
+    if ((item->string != NULL) && (((object->index->count + 1) * 2) <= (object->index->mask + 1)))
+    {
+        index_add(object->index, item);
+        return;
+    }
+    index_drop(object);
+}
+
+/* Put the replacement in the slot of the item if it has the same name, drop the index otherwise. */
+static void index_replace(cJSON * const object, const cJSON * const item, cJSON * const replacement)
+{
+    cJSON **slots = NULL;
+    size_t slot = 0;
+
+    if (!index_is_built(object))
+    {
+        return;
+    }
+
+    if ((item->string != NULL) && (replacement->string != NULL) && (case_insensitive_strcmp((const unsigned char*)item->string, (const unsigned char*)replacement->string) == 0))
+    {
+        slots = index_slots(object->index);
+        for (slot = index_hash((const unsigned char*)item->string) & object->index->mask; slots[slot] != NULL; slot = (slot + 1) & object->index->mask)
+        {
+            if (slots[slot] == item)
+            {
+                slots[slot] = replacement;
+                return;
+            }
+        }
+    }
+    index_drop(object);
+}
+
+CJSON_PUBLIC(void) cJSON_DropIndex(cJSON *object)
+{
+    if (object != NULL)
+    {
+        index_drop(object);
+    }
+}
+#else
+/* no index to keep, the lookups walk the list */
+#define index_drop(object) ((void)(object))
+#define index_append(object, item) ((void)(object), (void)(item))
+#define index_replace(object, item, replacement) ((void)(object), (void)(item), (void)(replacement))
+
+CJSON_PUBLIC(void) cJSON_DropIndex(cJSON *object)
+{
+    (void)object;
+}
+#endif /* CJSON_OBJECT_INDEX */
+
 /* Internal constructor. */
 static cJSON *cJSON_New_Item(const internal_hooks * const hooks)
 {
@@ -239,11 +408,117 @@ CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
         {
             global_hooks.deallocate(item->string);
         }
+        index_drop(item);
         global_hooks.deallocate(item);
         item = next;
     }
 }
 
+/* A chunk an arena took from the hooks, its memory follows the header. */
+struct cJSON_ArenaChunk
+{
+    struct cJSON_ArenaChunk *next;
+    size_t size;
+    size_t offset;
+};
+
+/* what the memory carved from an arena is aligned to, for the double of the items */
+typedef union
+{
+    double number;
+    void *pointer;
+} arena_alignment;
+
+#define arena_align(size) (((size) + sizeof(arena_alignment) - 1) & ~(sizeof(arena_alignment) - 1))
+
+CJSON_PUBLIC(void) cJSON_ArenaInit(cJSON_Arena *arena, void *buffer, size_t size, size_t chunk_size)
+{
+    size_t skipped_bytes = 0;
+
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    if (buffer != NULL)
+    {
+        skipped_bytes = arena_align((size_t)buffer) - (size_t)buffer;
+    }
+    if ((buffer == NULL) || (size < skipped_bytes))
+    {
+        buffer = NULL;
+        size = 0;
+        skipped_bytes = 0;
+    }
+
+    arena->buffer = (unsigned char*)buffer + skipped_bytes;
+    arena->size = size - skipped_bytes;
+    arena->offset = 0;
+    arena->chunk_size = chunk_size;
+    arena->chunks = NULL;
+}
+
+CJSON_PUBLIC(void) cJSON_ArenaReset(cJSON_Arena *arena)
+{
+    struct cJSON_ArenaChunk *next = NULL;
+
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    while (arena->chunks != NULL)
+    {
+        next = arena->chunks->next;
+        global_hooks.deallocate(arena->chunks);
+        arena->chunks = next;
+    }
+    arena->offset = 0;
+}
+
+/* Carve size bytes from the buffer of the arena, or from its last chunk, or from a new chunk. */
+static void *arena_allocate(cJSON_Arena * const arena, size_t size)
+{
+    const size_t header_size = arena_align(sizeof(struct cJSON_ArenaChunk));
+    struct cJSON_ArenaChunk *chunk = arena->chunks;
+    unsigned char *memory = NULL;
+
+    size = arena_align(size);
+    if (size <= (arena->size - arena->offset))
+    {
+        memory = arena->buffer + arena->offset;
+        arena->offset += size;
+        return memory;
+    }
+
+    if ((chunk == NULL) || (size > (chunk->size - chunk->offset)))
+    {
+        size_t chunk_size = arena->chunk_size;
+
+        if (chunk_size == 0)
+        {
+            return NULL; /* the arena does not grow */
+        }
+        if (size > chunk_size)
+        {
+            chunk_size = size;
+        }
+        chunk = (struct cJSON_ArenaChunk*)global_hooks.allocate(header_size + chunk_size);
+        if (chunk == NULL)
+        {
+            return NULL;
+        }
+        chunk->size = chunk_size;
+        chunk->offset = 0;
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+
+    memory = (unsigned char*)chunk + header_size + chunk->offset;
+    chunk->offset += size;
+    return memory;
+}
+
 /* get the decimal point character of the current locale */
 static unsigned char get_decimal_point(void)
 {
@@ -262,8 +537,41 @@ typedef struct
     size_t offset;
     size_t depth; /* How deeply nested (in arrays/objects) is the input at the current offset. */
     internal_hooks hooks;
+    cJSON_Arena *arena; /* where the items and the strings are carved from, NULL to take them from the hooks */
+    cJSON_bool in_place; /* unescape the strings in the content, which is not const then */
 } parse_buffer;
 
+/* Allocate from the arena of the parse if it has one, from the hooks otherwise. */
+static void *parse_allocate(parse_buffer * const input_buffer, size_t size)
+{
+    if (input_buffer->arena != NULL)
+    {
+        return arena_allocate(input_buffer->arena, size);
+    }
+
+    return input_buffer->hooks.allocate(size);
+}
+
+static cJSON *parse_new_item(parse_buffer * const input_buffer)
+{
+    cJSON* node = (cJSON*)parse_allocate(input_buffer, sizeof(cJSON));
+    if (node)
+    {
+        memset(node, '\0', sizeof(cJSON));
+    }
+
+    return node;
+}
+
+/* Delete what a failed parse made, what is in an arena stays until the reset. */
+static void parse_delete(parse_buffer * const input_buffer, cJSON *item)
+{
+    if (input_buffer->arena == NULL)
+    {
+        cJSON_Delete(item);
+    }
+}
+
 /* check if the given size is left to read in a given parse buffer (starting with 1) */
 #define can_read(buffer, size) ((buffer != NULL) && (((buffer)->offset + size) <= (buffer)->length))
 /* check if the buffer can be accessed at the given index (starting with 0) */
@@ -377,8 +685,20 @@ typedef struct
     cJSON_bool noalloc;
     cJSON_bool format; /* is this print a formatted print */
     internal_hooks hooks;
+    cJSON_Writer writer; /* takes the buffer each time it is full, instead of a bigger one */
+    void *context;
 } printbuffer;
 
+/* The smallest buffer of a print through a writer, the longest number fits in it at once. */
+#define writer_min_length 32
+
+/* What is left of the buffer of the writer before it is handed over. */
+#define print_space(buffer) ((buffer)->length - (buffer)->offset - 1)
+/* At most count bytes of the output: what fills the buffer of the writer if they do not fit in what is
+ * left of it, so that it is handed over full, and what fits in it at once after that. */
+#define print_piece(buffer, count) ((((buffer)->writer == NULL) || ((count) <= print_space(buffer))) ? (count) : \
+    ((print_space(buffer) > 0) ? print_space(buffer) : (((count) >= (buffer)->length) ? ((buffer)->length - 1) : (count))))
+
 /* realloc printbuffer if necessary to have at least "needed" bytes more */
 static unsigned char* ensure(printbuffer * const p, size_t needed)
 {
@@ -408,6 +728,20 @@ static unsigned char* ensure(printbuffer * const p, size_t needed)
         return p->buffer + p->offset;
     }
 
+    if (p->writer != NULL)
+    {
+        /* hand what is printed to the writer and start the buffer over */
+        if ((p->offset > 0) && !p->writer(p->context, (const char*)p->buffer, p->offset))
+        {
+            return NULL;
+        }
+        needed -= p->offset;
+        p->offset = 0;
+        p->buffer[0] = '\0';
+
+        return (needed <= p->length) ? p->buffer : NULL;
+    }
+
     if (p->noalloc) {
         return NULL;
     }
@@ -467,6 +801,53 @@ static unsigned char* ensure(printbuffer * const p, size_t needed)
     return newbuffer + p->offset;
 }
 
+/* Copy the bytes to the output, through the writer in pieces if they do not fit in its buffer at once.
+ * The output is terminated even if there are no bytes. */
+static cJSON_bool print_bytes(printbuffer * const output_buffer, const unsigned char *bytes, size_t length)
+{
+    unsigned char *output = NULL;
+    size_t piece = 0;
+
+    do
+    {
+        piece = print_piece(output_buffer, length);
+        output = ensure(output_buffer, piece);
+        if (output == NULL)
+        {
+            return false;
+        }
+        memcpy(output, bytes, piece);
+        output[piece] = '\0';
+        output_buffer->offset += piece;
+        bytes += piece;
+        length -= piece;
+    } while (length > 0);
+
+    return true;
+}
+
+/* Indent by depth tabs, in pieces as print_bytes. */
+static cJSON_bool print_indent(printbuffer * const output_buffer, size_t depth)
+{
+    unsigned char *output = NULL;
+    size_t piece = 0;
+
+    while (depth > 0)
+    {
+        piece = print_piece(output_buffer, depth);
+        output = ensure(output_buffer, piece);
+        if (output == NULL)
+        {
+            return false;
+        }
+        memset(output, '\t', piece);
+        output_buffer->offset += piece;
+        depth -= piece;
+    }
+
+    return true;
+}
+
 /* calculate the new length of the string in a printbuffer and update the offset */
 static void update_offset(printbuffer * const buffer)
 {
@@ -704,6 +1085,114 @@ fail:
     return 0;
 }
 
+/* The string scans find the first byte of [pointer, end) a string stops at: a quote or a backslash,
+ * and a control character too when printing. They test a block of bytes at once with AVX2 or SSE2
+ * where the compiler targets them, and 32 bit words elsewhere, as on RISC-V and ARM. Define
+ * CJSON_SCAN_SWAR or CJSON_SCAN_BYTES to have the words or a byte at a time anyway. */
+#if !defined(CJSON_SCAN_SWAR) && !defined(CJSON_SCAN_BYTES) && defined(__GNUC__)
+#if defined(__AVX2__)
+#define CJSON_SCAN_AVX2
+#elif defined(__SSE2__)
+#define CJSON_SCAN_SSE2
+#endif
+#endif
+#if !defined(CJSON_SCAN_AVX2) && !defined(CJSON_SCAN_SSE2) && !defined(CJSON_SCAN_BYTES) && (UINT_MAX == 0xFFFFFFFFu)
+#ifndef CJSON_SCAN_SWAR
+#define CJSON_SCAN_SWAR
+#endif
+#endif
+
+#if defined(CJSON_SCAN_AVX2)
+#include <immintrin.h>
+#elif defined(CJSON_SCAN_SSE2)
+#include <emmintrin.h>
+#endif
+
+#define string_special(character, control) (((character) == '\"') || ((character) == '\\') || ((control) && ((character) < 32)))
+/* not 0 if a byte of the word is 0, or less than n (n at most 128) */
+#define swar_zero(word) (((word) - 0x01010101u) & ~(word) & 0x80808080u)
+#define swar_less(word, n) (((word) - (0x01010101u * (n))) & ~(word) & 0x80808080u)
+
+static const unsigned char *scan_string(const unsigned char *pointer, const unsigned char * const end, const cJSON_bool control)
+{
+#if defined(CJSON_SCAN_AVX2)
+    const __m256i quote = _mm256_set1_epi8('\"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i last_control = _mm256_set1_epi8(31);
+    while ((end - pointer) >= 32)
+    {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(const void*)pointer);
+        __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, backslash));
+        unsigned int mask = 0;
+        if (control)
+        {
+            /* the bytes not above 31, unsigned */
+            special = _mm256_or_si256(special, _mm256_cmpeq_epi8(_mm256_min_epu8(block, last_control), block));
+        }
+        mask = (unsigned int)_mm256_movemask_epi8(special);
+        if (mask != 0)
+        {
+            return pointer + __builtin_ctz(mask);
+        }
+        pointer += 32;
+    }
+#elif defined(CJSON_SCAN_SSE2)
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i last_control = _mm_set1_epi8(31);
+    while ((end - pointer) >= 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i*)(const void*)pointer);
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash));
+        unsigned int mask = 0;
+        if (control)
+        {
+            /* the bytes not above 31, unsigned */
+            special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_min_epu8(block, last_control), block));
+        }
+        mask = (unsigned int)_mm_movemask_epi8(special);
+        if (mask != 0)
+        {
+            return pointer + __builtin_ctz(mask);
+        }
+        pointer += 16;
+    }
+#elif defined(CJSON_SCAN_SWAR)
+    /* the words are read aligned, up to the first one a byte at a time, and copied out of the
+     * bytes so that the compiler makes a load without the string being taken as an unsigned int */
+    while ((pointer < end) && (((size_t)pointer & (sizeof(unsigned int) - 1)) != 0))
+    {
+        if (string_special(*pointer, control))
+        {
+            return pointer;
+        }
+        pointer++;
+    }
+    while ((size_t)(end - pointer) >= sizeof(unsigned int))
+    {
+        unsigned int word = 0;
+        unsigned int special = 0;
+        memcpy(&word, pointer, sizeof(word));
+        special = swar_zero(word ^ 0x22222222u) | swar_zero(word ^ 0x5C5C5C5Cu);
+        if (control)
+        {
+            special |= swar_less(word, 32u);
+        }
+        if (special != 0)
+        {
+            break; /* the bytes below find which */
+        }
+        pointer += sizeof(unsigned int);
+    }
+#endif
+    while ((pointer < end) && !string_special(*pointer, control))
+    {
+        pointer++;
+    }
+
+    return pointer;
+}
+
 /* Parse the input text into an unescaped cinput, and populate item. */
 static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
 {
@@ -722,20 +1211,21 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
         /* calculate approximate size of the output (overestimate) */
         size_t allocation_length = 0;
         size_t skipped_bytes = 0;
-        while (((size_t)(input_end - input_buffer->content) < input_buffer->length) && (*input_end != '\"'))
+        for (;;)
         {
+            input_end = scan_string(input_end, input_buffer->content + input_buffer->length, false);
+            if (((size_t)(input_end - input_buffer->content) >= input_buffer->length) || (*input_end == '\"'))
+            {
+                break;
+            }
             /* is escape sequence */
-            if (input_end[0] == '\\')
+            if ((size_t)(input_end + 1 - input_buffer->content) >= input_buffer->length)
             {
-                if ((size_t)(input_end + 1 - input_buffer->content) >= input_buffer->length)
-                {
-                    /* prevent buffer overflow when last input character is a backslash */
-                    goto fail;
-                }
-                skipped_bytes++;
-                input_end++;
+                /* prevent buffer overflow when last input character is a backslash */
+                goto fail;
             }
-            input_end++;
+            skipped_bytes++;
+            input_end += 2;
         }
         if (((size_t)(input_end - input_buffer->content) >= input_buffer->length) || (*input_end != '\"'))
         {
@@ -744,7 +1234,15 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
 
         /* This is at most how much we need for the output */
         allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
-        output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
+        if (input_buffer->in_place)
+        {
+            /* the output never gets ahead of the input, and ends at the latest on the closing quote */
+            output = (unsigned char*)input_pointer;
+        }
+        else
+        {
+            output = (unsigned char*)parse_allocate(input_buffer, allocation_length + sizeof(""));
+        }
         if (output == NULL)
         {
             goto fail; /* allocation failure */
@@ -757,7 +1255,11 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     {
         if (*input_pointer != '\\')
         {
-            *output_pointer++ = *input_pointer++;
+            /* copy up to the next escape sequence, the output may be in the input */
+            const unsigned char *run_end = scan_string(input_pointer + 1, input_end, false);
+            memmove(output_pointer, input_pointer, (size_t)(run_end - input_pointer));
+            output_pointer += run_end - input_pointer;
+            input_pointer = run_end;
         }
         /* escape sequence */
         else
@@ -820,7 +1322,7 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     return true;
 
 fail:
-    if (output != NULL)
+    if ((output != NULL) && !input_buffer->in_place && (input_buffer->arena == NULL))
     {
         input_buffer->hooks.deallocate(output);
     }
@@ -833,10 +1335,78 @@ fail:
     return false;
 }
 
+/* Write the escape sequence of the character, return its length. */
+static size_t escape_character(const unsigned char character, unsigned char * const output)
+{
+    output[0] = '\\';
+    switch (character)
+    {
+        case '\\':
+            output[1] = '\\';
+            break;
+        case '\"':
+            output[1] = '\"';
+            break;
+        case '\b':
+            output[1] = 'b';
+            break;
+        case '\f':
+            output[1] = 'f';
+            break;
+        case '\n':
+            output[1] = 'n';
+            break;
+        case '\r':
+            output[1] = 'r';
+            break;
+        case '\t':
+            output[1] = 't';
+            break;
+        default:
+            /* escape and print as unicode codepoint */
+            sprintf((char*)output + 1, "u%04x", character);
+            return sizeof("\\u0000") - 1;
+    }
+
+    return 2;
+}
+
+/* Print the string a run at a time, through a writer whose buffer it does not fit in at once. */
+static cJSON_bool print_string_runs(const unsigned char *input, const unsigned char * const input_end, printbuffer * const output_buffer)
+{
+    unsigned char escape[sizeof("\\u0000")];
+    const unsigned char *run_end = NULL;
+
+    if (!print_bytes(output_buffer, (const unsigned char*)"\"", 1))
+    {
+        return false;
+    }
+    while (input < input_end)
+    {
+        run_end = scan_string(input, input_end, true);
+        if (!print_bytes(output_buffer, input, (size_t)(run_end - input)))
+        {
+            return false;
+        }
+        if (run_end == input_end)
+        {
+            break;
+        }
+        if (!print_bytes(output_buffer, escape, escape_character(*run_end, escape)))
+        {
+            return false;
+        }
+        input = run_end + 1;
+    }
+
+    return print_bytes(output_buffer, (const unsigned char*)"\"", 1);
+}
+
 /* Render the cstring provided to an escaped version that can be printed. */
 static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffer * const output_buffer)
 {
     const unsigned char *input_pointer = NULL;
+    const unsigned char *input_end = NULL;
     unsigned char *output = NULL;
     unsigned char *output_pointer = NULL;
     size_t output_length = 0;
@@ -862,7 +1432,8 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
     }
 
     /* set "flag" to 1 if something needs to be escaped */
-    for (input_pointer = input; *input_pointer; input_pointer++)
+    input_end = input + strlen((const char*)input);
+    for (input_pointer = scan_string(input, input_end, true); input_pointer < input_end; input_pointer = scan_string(input_pointer + 1, input_end, true))
     {
         switch (*input_pointer)
         {
@@ -885,7 +1456,12 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
                 break;
         }
     }
-    output_length = (size_t)(input_pointer - input) + escape_characters;
+    output_length = (size_t)(input_end - input) + escape_characters;
+
+    if ((output_buffer->writer != NULL) && ((output_length + sizeof("\"\"")) >= output_buffer->length))
+    {
+        return print_string_runs(input, input_end, output_buffer);
+    }
 
     output = ensure(output_buffer, output_length + sizeof("\"\""));
     if (output == NULL)
@@ -907,46 +1483,20 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
     output[0] = '\"';
     output_pointer = output + 1;
     /* copy the string */
-    for (input_pointer = input; *input_pointer != '\0'; (void)input_pointer++, output_pointer++)
+    for (input_pointer = input; input_pointer < input_end; (void)input_pointer++, output_pointer++)
     {
         if ((*input_pointer > 31) && (*input_pointer != '\"') && (*input_pointer != '\\'))
         {
-            /* normal character, copy */
-            *output_pointer = *input_pointer;
+            /* normal characters, copy up to the next one to escape */
+            const unsigned char *run_end = scan_string(input_pointer + 1, input_end, true);
+            memcpy(output_pointer, input_pointer, (size_t)(run_end - input_pointer));
+            output_pointer += (run_end - input_pointer) - 1;
+            input_pointer = run_end - 1;
         }
         else
         {
             /* character needs to be escaped */
-            *output_pointer++ = '\\';
-            switch (*input_pointer)
-            {
-                case '\\':
-                    *output_pointer = '\\';
-                    break;
-                case '\"':
-                    *output_pointer = '\"';
-                    break;
-                case '\b':
-                    *output_pointer = 'b';
-                    break;
-                case '\f':
-                    *output_pointer = 'f';
-                    break;
-                case '\n':
-                    *output_pointer = 'n';
-                    break;
-                case '\r':
-                    *output_pointer = 'r';
-                    break;
-                case '\t':
-                    *output_pointer = 't';
-                    break;
-                default:
-                    /* escape and print as unicode codepoint */
-                    sprintf((char*)output_pointer, "u%04x", *input_pointer);
-                    output_pointer += 4;
-                    break;
-            }
+            output_pointer += escape_character(*input_pointer, output_pointer) - 1;
         }
     }
     output[output_length + 1] = '\"';
@@ -961,135 +1511,546 @@ static cJSON_bool print_string(const cJSON * const item, printbuffer * const p)
     return print_string_ptr((unsigned char*)item->valuestring, p);
 }
 
-/* Predeclare these prototypes. */
-static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer);
-static cJSON_bool print_value(const cJSON * const item, printbuffer * const output_buffer);
-static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buffer);
-static cJSON_bool print_array(const cJSON * const item, printbuffer * const output_buffer);
-static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_buffer);
-static cJSON_bool print_object(const cJSON * const item, printbuffer * const output_buffer);
+/* Predeclare these prototypes. */
+static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer);
+static cJSON_bool print_value(const cJSON * const item, printbuffer * const output_buffer);
+static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buffer);
+static cJSON_bool print_array(const cJSON * const item, printbuffer * const output_buffer);
+static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_buffer);
+static cJSON_bool print_object(const cJSON * const item, printbuffer * const output_buffer);
+
+/* Utility to jump whitespace and cr/lf */
+static parse_buffer *buffer_skip_whitespace(parse_buffer * const buffer)
+{
+    if ((buffer == NULL) || (buffer->content == NULL))
+    {
+        return NULL;
+    }
+
+    while (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] <= 32))
+    {
+       buffer->offset++;
+    }
+
+    if (buffer->offset == buffer->length)
+    {
+        buffer->offset--;
+    }
+
+    return buffer;
+}
+
+/* skip the UTF-8 BOM (byte order mark) if it is at the beginning of a buffer */
+static parse_buffer *skip_utf8_bom(parse_buffer * const buffer)
+{
+    if ((buffer == NULL) || (buffer->content == NULL) || (buffer->offset != 0))
+    {
+        return NULL;
+    }
+
+    if (can_access_at_index(buffer, 4) && (strncmp((const char*)buffer_at_offset(buffer), "\xEF\xBB\xBF", 3) == 0))
+    {
+        buffer->offset += 3;
+    }
+
+    return buffer;
+}
+
+/* Parse an object - create a new root, and populate. */
+static cJSON *parse_root(const char *value, cJSON_Arena * const arena, const cJSON_bool in_place, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, NULL, false };
+    cJSON *item = NULL;
+
+    /* reset error position */
+    global_error.json = NULL;
+    global_error.position = 0;
+
+    if (value == NULL)
+    {
+        goto fail;
+    }
+
+    buffer.content = (const unsigned char*)value;
+    buffer.length = strlen((const char*)value) + sizeof("");
+    buffer.offset = 0;
+    buffer.hooks = global_hooks;
+    buffer.arena = arena;
+    buffer.in_place = in_place;
+
+    item = parse_new_item(&buffer);
+    if (item == NULL) /* memory fail */
+    {
+        goto fail;
+    }
+
+    if (!parse_value(item, buffer_skip_whitespace(skip_utf8_bom(&buffer))))
+    {
+        /* parse failure. ep is set. */
+        goto fail;
+    }
+
+    /* if we require null-terminated JSON without appended garbage, skip and then check for a null terminator */
+    if (require_null_terminated)
+    {
+        buffer_skip_whitespace(&buffer);
+        if ((buffer.offset >= buffer.length) || buffer_at_offset(&buffer)[0] != '\0')
+        {
+            goto fail;
+        }
+    }
+    if (return_parse_end)
+    {
+        *return_parse_end = (const char*)buffer_at_offset(&buffer);
+    }
+
+    return item;
+
+fail:
+    if (item != NULL)
+    {
+        parse_delete(&buffer, item);
+    }
+
+    if (value != NULL)
+    {
+        error local_error;
+        local_error.json = (const unsigned char*)value;
+        local_error.position = 0;
+
+        if (buffer.offset < buffer.length)
+        {
+            local_error.position = buffer.offset;
+        }
+        else if (buffer.length > 0)
+        {
+            local_error.position = buffer.length - 1;
+        }
+
+        if (return_parse_end != NULL)
+        {
+            *return_parse_end = (const char*)local_error.json + local_error.position;
+        }
+
+        global_error = local_error;
+    }
+
+    return NULL;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    return parse_root(value, NULL, false, return_parse_end, require_null_terminated);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseInArena(cJSON_Arena *arena, const char *value, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+
+    return parse_root(value, arena, false, return_parse_end, require_null_terminated);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseInPlace(cJSON_Arena *arena, char *value, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+
+    return parse_root(value, arena, true, return_parse_end, require_null_terminated);
+}
+
+/* Default options for cJSON_Parse */
+CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value)
+{
+    return cJSON_ParseWithOpts(value, 0, 0);
+}
+
+/* Where a streaming parse is between two bytes of the document. */
+enum sax_state
+{
+    sax_value,
+    sax_first_value, /* or the end of the array just started */
+    sax_key,
+    sax_first_key, /* or the end of the object just started */
+    sax_colon,
+    sax_next, /* a comma or the end of the array or object */
+    sax_done,
+    sax_string,
+    sax_key_string,
+    sax_number,
+    sax_literal,
+    sax_failed
+};
+
+#define sax_is_number(character) ((((character) >= '0') && ((character) <= '9')) || ((character) == '+') || ((character) == '-') || ((character) == '.') || ((character) == 'e') || ((character) == 'E'))
+
+static cJSON_bool sax_append(cJSON_Sax * const sax, const unsigned char *bytes, const size_t length)
+{
+    if (length > (sax->token_size - sax->token_length))
+    {
+        return false;
+    }
+    memcpy(sax->token + sax->token_length, bytes, length);
+    sax->token_length += length;
+
+    return true;
+}
+
+static cJSON_bool sax_in_object(const cJSON_Sax * const sax)
+{
+    return (sax->depth > 0) && ((sax->objects[(sax->depth - 1) / 8] & (1u << ((sax->depth - 1) % 8))) != 0);
+}
+
+/* Call back the handler, stopping the parse if it returns false. */
+static cJSON_bool sax_event(cJSON_Sax * const sax, cJSON_bool (*event)(void *context))
+{
+    if ((event != NULL) && !event(sax->context))
+    {
+        sax->stopped = true;
+        return false;
+    }
+
+    return true;
+}
+
+/* A scalar value is over, the parse goes on in its array or object. */
+static cJSON_bool sax_scalar(cJSON_Sax * const sax, const cJSON * const item)
+{
+    sax->state = (sax->depth == 0) ? sax_done : sax_next;
+    if ((sax->handler->value != NULL) && !sax->handler->value(sax->context, item))
+    {
+        sax->stopped = true;
+        return false;
+    }
+
+    return true;
+}
 
-/* Utility to jump whitespace and cr/lf */
-static parse_buffer *buffer_skip_whitespace(parse_buffer * const buffer)
+static cJSON_bool sax_open(cJSON_Sax * const sax, const cJSON_bool object)
 {
-    if ((buffer == NULL) || (buffer->content == NULL))
+    if (sax->depth >= CJSON_NESTING_LIMIT)
     {
-        return NULL;
+        return false; /* to deeply nested */
     }
 
-    while (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] <= 32))
+    if (object)
     {
-       buffer->offset++;
+        sax->objects[sax->depth / 8] |= (unsigned char)(1u << (sax->depth % 8));
+    }
+    else
+    {
+        sax->objects[sax->depth / 8] &= (unsigned char)~(1u << (sax->depth % 8));
     }
+    sax->depth++;
+    sax->state = object ? sax_first_key : sax_first_value;
 
-    if (buffer->offset == buffer->length)
+    return sax_event(sax, object ? sax->handler->start_object : sax->handler->start_array);
+}
+
+static cJSON_bool sax_close(cJSON_Sax * const sax, const cJSON_bool object)
+{
+    if ((sax->depth == 0) || (sax_in_object(sax) != object))
     {
-        buffer->offset--;
+        return false;
     }
+    sax->depth--;
+    sax->state = (sax->depth == 0) ? sax_done : sax_next;
 
-    return buffer;
+    return sax_event(sax, object ? sax->handler->end_object : sax->handler->end_array);
 }
 
-/* skip the UTF-8 BOM (byte order mark) if it is at the beginning of a buffer */
-static parse_buffer *skip_utf8_bom(parse_buffer * const buffer)
+/* Decode the string in the token in place, as parse_string does for cJSON_ParseInPlace. */
+static cJSON_bool sax_string_end(cJSON_Sax * const sax, const cJSON_bool key)
 {
-    if ((buffer == NULL) || (buffer->content == NULL) || (buffer->offset != 0))
+    cJSON item;
+    parse_buffer buffer;
+
+    memset(&item, '\0', sizeof(item));
+    memset(&buffer, '\0', sizeof(buffer));
+    buffer.content = (const unsigned char*)sax->token;
+    buffer.length = sax->token_length;
+    buffer.hooks = global_hooks;
+    buffer.in_place = true;
+    if (!parse_string(&item, &buffer))
     {
-        return NULL;
+        return false;
     }
 
-    if (can_access_at_index(buffer, 4) && (strncmp((const char*)buffer_at_offset(buffer), "\xEF\xBB\xBF", 3) == 0))
+    if (!key)
     {
-        buffer->offset += 3;
+        return sax_scalar(sax, &item);
+    }
+    sax->state = sax_colon;
+    if ((sax->handler->key != NULL) && !sax->handler->key(sax->context, item.valuestring))
+    {
+        sax->stopped = true;
+        return false;
     }
 
-    return buffer;
+    return true;
 }
 
-/* Parse an object - create a new root, and populate. */
-CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated)
+static cJSON_bool sax_number_end(cJSON_Sax * const sax)
 {
-    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
-    cJSON *item = NULL;
-
-    /* reset error position */
-    global_error.json = NULL;
-    global_error.position = 0;
+    cJSON item;
+    parse_buffer buffer;
 
-    if (value == NULL)
+    memset(&item, '\0', sizeof(item));
+    memset(&buffer, '\0', sizeof(buffer));
+    buffer.content = (const unsigned char*)sax->token;
+    buffer.length = sax->token_length;
+    if (!parse_number(&item, &buffer) || (buffer.offset != buffer.length))
     {
-        goto fail;
+        return false;
     }
 
-    buffer.content = (const unsigned char*)value;
-    buffer.length = strlen((const char*)value) + sizeof("");
-    buffer.offset = 0;
-    buffer.hooks = global_hooks;
+    return sax_scalar(sax, &item);
+}
 
-    item = cJSON_New_Item(&global_hooks);
-    if (item == NULL) /* memory fail */
+static cJSON_bool sax_literal_end(cJSON_Sax * const sax)
+{
+    cJSON item;
+
+    memset(&item, '\0', sizeof(item));
+    if ((sax->token_length == 4) && (strncmp(sax->token, "null", 4) == 0))
     {
-        goto fail;
+        item.type = cJSON_NULL;
+    }
+    else if ((sax->token_length == 5) && (strncmp(sax->token, "false", 5) == 0))
+    {
+        item.type = cJSON_False;
+    }
+    else if ((sax->token_length == 4) && (strncmp(sax->token, "true", 4) == 0))
+    {
+        item.type = cJSON_True;
+        item.valueint = 1;
+    }
+    else
+    {
+        return false;
     }
 
-    if (!parse_value(item, buffer_skip_whitespace(skip_utf8_bom(&buffer))))
+    return sax_scalar(sax, &item);
+}
+
+/* Start the value the character starts, as parse_value tells them apart. */
+static cJSON_bool sax_value_start(cJSON_Sax * const sax, const unsigned char character)
+{
+    sax->token_length = 0;
+    switch (character)
     {
-        /* parse failure. ep is set. */
-        goto fail;
+        case '\"':
+            sax->state = sax_string;
+            sax->escaped = false;
+            break;
+        case '{':
+            return sax_open(sax, true);
+        case '[':
+            return sax_open(sax, false);
+        case 't':
+        case 'f':
+        case 'n':
+            sax->state = sax_literal;
+            break;
+        default:
+            if ((character != '-') && ((character < '0') || (character > '9')))
+            {
+                return false;
+            }
+            sax->state = sax_number;
+            break;
     }
 
-    /* if we require null-terminated JSON without appended garbage, skip and then check for a null terminator */
-    if (require_null_terminated)
+    return sax_append(sax, &character, 1);
+}
+
+/* A character between the values, where only the structure and white space may be. */
+static cJSON_bool sax_structure(cJSON_Sax * const sax, const unsigned char character)
+{
+    switch (sax->state)
     {
-        buffer_skip_whitespace(&buffer);
-        if ((buffer.offset >= buffer.length) || buffer_at_offset(&buffer)[0] != '\0')
-        {
-            goto fail;
-        }
+        case sax_first_value:
+            if (character == ']')
+            {
+                return sax_close(sax, false);
+            }
+            return sax_value_start(sax, character);
+        case sax_value:
+            return sax_value_start(sax, character);
+        case sax_first_key:
+            if (character == '}')
+            {
+                return sax_close(sax, true);
+            }
+            /* fall through */
+        case sax_key:
+            if (character != '\"')
+            {
+                return false;
+            }
+            sax->token_length = 0;
+            sax->state = sax_key_string;
+            sax->escaped = false;
+            return sax_append(sax, &character, 1);
+        case sax_colon:
+            if (character != ':')
+            {
+                return false;
+            }
+            sax->state = sax_value;
+            return true;
+        case sax_next:
+            if (character == ',')
+            {
+                sax->state = sax_in_object(sax) ? sax_key : sax_value;
+                return true;
+            }
+            if ((character == '}') || (character == ']'))
+            {
+                return sax_close(sax, character == '}');
+            }
+            return false;
+        default:
+            return false;
     }
-    if (return_parse_end)
+}
+
+CJSON_PUBLIC(void) cJSON_SaxInit(cJSON_Sax *sax, const cJSON_SaxHandler *handler, void *context, char *token, size_t token_size)
+{
+    if (sax == NULL)
     {
-        *return_parse_end = (const char*)buffer_at_offset(&buffer);
+        return;
     }
 
-    return item;
+    memset(sax, '\0', sizeof(cJSON_Sax));
+    sax->handler = handler;
+    sax->context = context;
+    sax->token = token;
+    sax->token_size = (token == NULL) ? 0 : token_size;
+    sax->state = (handler == NULL) ? sax_failed : sax_value;
+}
 
-fail:
-    if (item != NULL)
+CJSON_PUBLIC(cJSON_bool) cJSON_SaxFeed(cJSON_Sax *sax, const char *chunk, size_t length)
+{
+    const unsigned char *input = (const unsigned char*)chunk;
+    const unsigned char *run_end = NULL;
+    size_t position = 0;
+
+    if ((sax == NULL) || (sax->state == sax_failed) || ((chunk == NULL) && (length != 0)))
     {
-        cJSON_Delete(item);
+        return false;
     }
 
-    if (value != NULL)
+    while (position < length)
     {
-        error local_error;
-        local_error.json = (const unsigned char*)value;
-        local_error.position = 0;
-
-        if (buffer.offset < buffer.length)
-        {
-            local_error.position = buffer.offset;
-        }
-        else if (buffer.length > 0)
+        switch (sax->state)
         {
-            local_error.position = buffer.length - 1;
-        }
+            case sax_string:
+            case sax_key_string:
+                if (sax->escaped)
+                {
+                    /* the byte after a backslash never ends the string */
+                    sax->escaped = false;
+                    run_end = input + position + 1;
+                }
+                else
+                {
+                    run_end = scan_string(input + position, input + length, false);
+                }
+                if (run_end != (input + position))
+                {
+                    if (!sax_append(sax, input + position, (size_t)(run_end - (input + position))))
+                    {
+                        goto fail;
+                    }
+                    position = (size_t)(run_end - input);
+                    break;
+                }
+                if (!sax_append(sax, input + position, 1))
+                {
+                    goto fail;
+                }
+                if (input[position] == '\\')
+                {
+                    sax->escaped = true;
+                }
+                else if (!sax_string_end(sax, sax->state == sax_key_string))
+                {
+                    goto fail;
+                }
+                position++;
+                break;
 
-        if (return_parse_end != NULL)
-        {
-            *return_parse_end = (const char*)local_error.json + local_error.position;
-        }
+            case sax_number:
+                if (!sax_is_number(input[position]))
+                {
+                    /* the byte after the number is read again in the state after it */
+                    if (!sax_number_end(sax))
+                    {
+                        goto fail;
+                    }
+                    break;
+                }
+                if (!sax_append(sax, input + position, 1))
+                {
+                    goto fail;
+                }
+                position++;
+                break;
 
-        global_error = local_error;
+            case sax_literal:
+                if (!sax_append(sax, input + position, 1))
+                {
+                    goto fail;
+                }
+                if ((sax->token_length == ((sax->token[0] == 'f') ? 5u : 4u)) && !sax_literal_end(sax))
+                {
+                    goto fail;
+                }
+                position++;
+                break;
+
+            default:
+                if ((input[position] > 32) && !sax_structure(sax, input[position]))
+                {
+                    goto fail;
+                }
+                position++;
+                break;
+        }
     }
 
-    return NULL;
+    sax->offset += position;
+    return true;
+
+fail:
+    sax->offset += position;
+    sax->state = sax_failed;
+    return false;
 }
 
-/* Default options for cJSON_Parse */
-CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value)
+CJSON_PUBLIC(cJSON_bool) cJSON_SaxFinish(cJSON_Sax *sax)
 {
-    return cJSON_ParseWithOpts(value, 0, 0);
+    if (sax == NULL)
+    {
+        return false;
+    }
+
+    if ((sax->state == sax_number) && !sax_number_end(sax))
+    {
+        sax->state = sax_failed;
+    }
+    if (sax->state != sax_done)
+    {
+        sax->state = sax_failed;
+        return false;
+    }
+
+    return true;
 }
 
 #define cjson_min(a, b) ((a < b) ? a : b)
@@ -1171,7 +2132,7 @@ CJSON_PUBLIC(char *) cJSON_PrintUnformatted(const cJSON *item)
 
 CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON_bool fmt)
 {
-    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 }, 0, 0 };
 
     if (prebuffer < 0)
     {
@@ -1201,7 +2162,7 @@ CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON
 
 CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buf, const int len, const cJSON_bool fmt)
 {
-    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 }, 0, 0 };
 
     if ((len < 0) || (buf == NULL))
     {
@@ -1218,6 +2179,34 @@ CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buf, const i
     return print_value(item, &p);
 }
 
+CJSON_PUBLIC(cJSON_bool) cJSON_PrintToWriter(const cJSON *item, char *buffer, const int length, const cJSON_bool format, cJSON_Writer writer, void *context)
+{
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 }, 0, 0 };
+
+    if ((item == NULL) || (buffer == NULL) || (length < writer_min_length) || (writer == NULL))
+    {
+        return false;
+    }
+
+    p.buffer = (unsigned char*)buffer;
+    p.length = (size_t)length;
+    p.offset = 0;
+    p.noalloc = true;
+    p.format = format;
+    p.hooks = global_hooks;
+    p.writer = writer;
+    p.context = context;
+
+    if (!print_value(item, &p))
+    {
+        return false;
+    }
+    update_offset(&p);
+
+    /* the rest of the text */
+    return (p.offset == 0) || writer(context, buffer, p.offset);
+}
+
 /* Parser core - when encountering text, process appropriately. */
 static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer)
 {
@@ -1323,14 +2312,8 @@ static cJSON_bool print_value(const cJSON * const item, printbuffer * const outp
                 return false;
             }
 
-            raw_length = strlen(item->valuestring) + sizeof("");
-            output = ensure(output_buffer, raw_length);
-            if (output == NULL)
-            {
-                return false;
-            }
-            memcpy(output, item->valuestring, raw_length);
-            return true;
+            raw_length = strlen(item->valuestring);
+            return print_bytes(output_buffer, (const unsigned char*)item->valuestring, raw_length);
         }
 
         case cJSON_String:
@@ -1386,7 +2369,7 @@ static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buf
     do
     {
         /* allocate next item */
-        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
+        cJSON *new_item = parse_new_item(input_buffer);
         if (new_item == NULL)
         {
             goto fail; /* allocation failure */
@@ -1435,7 +2418,7 @@ success:
 fail:
     if (head != NULL)
     {
-        cJSON_Delete(head);
+        parse_delete(input_buffer, head);
     }
 
     return false;
@@ -1540,7 +2523,7 @@ static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_bu
     do
     {
         /* allocate next item */
-        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
+        cJSON *new_item = parse_new_item(input_buffer);
         if (new_item == NULL)
         {
             goto fail; /* allocation failure */
@@ -1599,6 +2582,12 @@ success:
 
     item->type = cJSON_Object;
     item->child = head;
+#ifdef CJSON_OBJECT_INDEX
+    if (input_buffer->arena != NULL)
+    {
+        item->index = &arena_index;
+    }
+#endif
 
     input_buffer->offset++;
     return true;
@@ -1606,7 +2595,7 @@ success:
 fail:
     if (head != NULL)
     {
-        cJSON_Delete(head);
+        parse_delete(input_buffer, head);
     }
 
     return false;
@@ -1642,19 +2631,9 @@ static cJSON_bool print_object(const cJSON * const item, printbuffer * const out
 
     while (current_item)
     {
-        if (output_buffer->format)
+        if (output_buffer->format && !print_indent(output_buffer, output_buffer->depth))
         {
-            size_t i;
-            output_pointer = ensure(output_buffer, output_buffer->depth);
-            if (output_pointer == NULL)
-            {
-                return false;
-            }
-            for (i = 0; i < output_buffer->depth; i++)
-            {
-                *output_pointer++ = '\t';
-            }
-            output_buffer->offset += output_buffer->depth;
+            return false;
         }
 
         /* print key */
@@ -1706,18 +2685,14 @@ static cJSON_bool print_object(const cJSON * const item, printbuffer * const out
         current_item = current_item->next;
     }
 
-    output_pointer = ensure(output_buffer, output_buffer->format ? (output_buffer->depth + 1) : 2);
-    if (output_pointer == NULL)
+    if (output_buffer->format && !print_indent(output_buffer, output_buffer->depth - 1))
     {
         return false;
     }
-    if (output_buffer->format)
+    output_pointer = ensure(output_buffer, 2);
+    if (output_pointer == NULL)
     {
-        size_t i;
-        for (i = 0; i < (output_buffer->depth - 1); i++)
-        {
-            *output_pointer++ = '\t';
-        }
+        return false;
     }
     *output_pointer++ = '}';
     *output_pointer = '\0';
@@ -1782,18 +2757,27 @@ CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index)
 static cJSON *get_object_item(const cJSON * const object, const char * const name, const cJSON_bool case_sensitive)
 {
     cJSON *current_element = NULL;
+    size_t walked = 0;
 
     if ((object == NULL) || (name == NULL))
     {
         return NULL;
     }
 
+#ifdef CJSON_OBJECT_INDEX
+    if (index_is_built(object))
+    {
+        return index_get(object->index, name, case_sensitive);
+    }
+#endif
+
     current_element = object->child;
     if (case_sensitive)
     {
         while ((current_element != NULL) && (current_element->string != NULL) && (strcmp(name, current_element->string) != 0))
         {
             current_element = current_element->next;
+            walked++;
         }
     }
     else
@@ -1801,9 +2785,20 @@ static cJSON *get_object_item(const cJSON * const object, const char * const nam
         while ((current_element != NULL) && (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)(current_element->string)) != 0))
         {
             current_element = current_element->next;
+            walked++;
         }
     }
 
+#ifdef CJSON_OBJECT_INDEX
+    if ((walked >= CJSON_INDEX_THRESHOLD) && (object->index == NULL) && !(object->type & cJSON_IsReference))
+    {
+        /* a wide object looked up by name, index it for the next lookups */
+        ((cJSON*)object)->index = index_build(object);
+    }
+#else
+    (void)walked;
+#endif
+
     if ((current_element == NULL) || (current_element->string == NULL)) {
         return NULL;
     }
@@ -1850,6 +2845,9 @@ static cJSON *create_reference(const cJSON *item, const internal_hooks * const h
 
     memcpy(reference, item, sizeof(cJSON));
     reference->string = NULL;
+#ifdef CJSON_OBJECT_INDEX
+    reference->index = NULL;
+#endif
     reference->type |= cJSON_IsReference;
     reference->next = reference->prev = NULL;
     return reference;
@@ -1880,6 +2878,7 @@ static cJSON_bool add_item_to_array(cJSON *array, cJSON *item)
         }
         suffix_object(child, item);
     }
+    index_append(array, item);
 
     return true;
 }
@@ -2089,6 +3088,7 @@ CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON * const it
         return NULL;
     }
 
+    index_drop(parent);
     if (item->prev != NULL)
     {
         /* not the first element */
@@ -2168,6 +3168,7 @@ CJSON_PUBLIC(void) cJSON_InsertItemInArray(cJSON *array, int which, cJSON *newit
         return;
     }
 
+    index_drop(array);
     newitem->next = after_inserted;
     newitem->prev = after_inserted->prev;
     after_inserted->prev = newitem;
@@ -2193,6 +3194,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON
         return true;
     }
 
+    index_replace(parent, item, replacement);
     replacement->next = item->next;
     replacement->prev = item->prev;
 
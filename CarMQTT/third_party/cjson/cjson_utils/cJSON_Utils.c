@@ -285,9 +285,42 @@ static cJSON_bool decode_array_index_from_pointer(const unsigned char * const po
     return 1;
 }
 
+/* Decode the ~0 and ~1 escapes of the path token the pointer starts with into name, false if the
+ * token has an invalid escape or does not fit. */
+static cJSON_bool decode_pointer_token(const unsigned char *pointer, unsigned char * const name, const size_t name_size)
+{
+    size_t length = 0;
+
+    for (; (*pointer != '\0') && (*pointer != '/'); pointer++)
+    {
+        if (length == (name_size - 1))
+        {
+            return false;
+        }
+
+        if (*pointer == '~')
+        {
+            if ((pointer[1] != '0') && (pointer[1] != '1'))
+            {
+                return false;
+            }
+            pointer++;
+            name[length++] = (*pointer == '0') ? '~' : '/';
+        }
+        else
+        {
+            name[length++] = *pointer;
+        }
+    }
+    name[length] = '\0';
+
+    return true;
+}
+
 static cJSON *get_item_from_pointer(cJSON * const object, const char * pointer, const cJSON_bool case_sensitive)
 {
     cJSON *current_element = object;
+    unsigned char name[64];
 
     if (pointer == NULL)
     {
@@ -308,6 +341,11 @@ static cJSON *get_item_from_pointer(cJSON * const object, const char * pointer,
 
             current_element = get_array_item(current_element, index);
         }
+        else if (cJSON_IsObject(current_element) && decode_pointer_token((const unsigned char*)pointer, name, sizeof(name)))
+        {
+            /* through GetObjectItem, which indexes wide objects */
+            current_element = case_sensitive ? cJSON_GetObjectItemCaseSensitive(current_element, (const char*)name) : cJSON_GetObjectItem(current_element, (const char*)name);
+        }
         else if (cJSON_IsObject(current_element))
         {
             current_element = current_element->child;
@@ -582,6 +620,8 @@ static void sort_object(cJSON * const object, const cJSON_bool case_sensitive)
         return;
     }
     object->child = sort_list(object->child, case_sensitive);
+    /* the order of the index follows the list */
+    cJSON_DropIndex(object);
 }
 
 static cJSON_bool compare_json(cJSON *a, cJSON *b, const cJSON_bool case_sensitive)
@@ -783,6 +823,7 @@ static void overwrite_item(cJSON * const root, const cJSON replacement)
     {
         cJSON_Delete(root->child);
     }
+    cJSON_DropIndex(root);
 
     memcpy(root, &replacement, sizeof(cJSON));
 }
@@ -823,7 +864,11 @@ static int apply_patch(cJSON *object, const cJSON *patch, const cJSON_bool case_
     {
         if (opcode == REMOVE)
         {
-            static const cJSON invalid = { NULL, NULL, NULL, cJSON_Invalid, NULL, 0, 0, NULL};
+            static const cJSON invalid = { NULL, NULL, NULL, cJSON_Invalid, NULL, 0, 0, NULL
+#ifdef CJSON_OBJECT_INDEX
+                , NULL
+#endif
+            };
 
             overwrite_item(object, invalid);
 
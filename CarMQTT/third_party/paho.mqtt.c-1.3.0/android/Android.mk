@@ -24,6 +24,7 @@ libpaho-mqtt3_local_src_c_files_common := \
 	$(libpaho-mqtt3_lib_path)/MQTTProtocolClient.c \
 	$(libpaho-mqtt3_lib_path)/Tree.c \
 	$(libpaho-mqtt3_lib_path)/Heap.c \
+	$(libpaho-mqtt3_lib_path)/HeapPool.c \
 	$(libpaho-mqtt3_lib_path)/MQTTPacket.c \
 	$(libpaho-mqtt3_lib_path)/Clients.c \
 	$(libpaho-mqtt3_lib_path)/Thread.c \
@@ -34,10 +35,13 @@ libpaho-mqtt3_local_src_c_files_common := \
 	$(libpaho-mqtt3_lib_path)/Log.c \
 	$(libpaho-mqtt3_lib_path)/Messages.c \
 	$(libpaho-mqtt3_lib_path)/LinkedList.c \
+	$(libpaho-mqtt3_lib_path)/MessageIDs.c \
+	$(libpaho-mqtt3_lib_path)/TopicAliases.c \
 	$(libpaho-mqtt3_lib_path)/MQTTPersistence.c \
 	$(libpaho-mqtt3_lib_path)/MQTTPacketOut.c \
 	$(libpaho-mqtt3_lib_path)/SocketBuffer.c \
 	$(libpaho-mqtt3_lib_path)/MQTTPersistenceDefault.c \
+	$(libpaho-mqtt3_lib_path)/MQTTPersistenceLog.c \
 
 libpaho-mqtt3_local_src_c_files_c := \
 	$(libpaho-mqtt3_lib_path)/MQTTClient.c \
@@ -41,6 +41,7 @@ char* Broker_recordFFDC(char* symptoms);
 #include <stddef.h>
 
 #include "Heap.h"
+#include "HeapPool.h"
 
 #undef malloc
 #undef realloc
@@ -53,7 +54,7 @@ static pthread_mutex_t heap_mutex_store = PTHREAD_MUTEX_INITIALIZER;
 static mutex_type heap_mutex = &heap_mutex_store;
 #endif
 
-static heap_info state = {0, 0}; /**< global heap state information */
+static heap_info state; /**< global heap state information, all 0 at the start */
 static int eyecatcher = 0x88888888;
 
 /*#define HEAP_STACK 1 */
@@ -145,7 +146,8 @@ static void Heap_check(char* string, void* ptr)
 /**
  * Allocates a block of memory.  A direct replacement for malloc, but keeps track of items
  * allocated in a list, so that free can check that a item is being freed correctly and that
- * we can check that all memory is freed at shutdown.
+ * we can check that all memory is freed at shutdown.  With HEAP_POOLS the small items come
+ * from the pools instead, which only count them.
  * @param file use the __FILE__ macro to indicate which file this item was allocated in
  * @param line use the __LINE__ macro to indicate which line this item was allocated at
  * @param size the size of the item to be allocated
@@ -159,6 +161,20 @@ void* mymalloc(char* file, int line, size_t size)
 
 	Thread_lock_mutex(heap_mutex);
 	size = Heap_roundup(size);
+#if defined(HEAP_POOLS)
+	{
+		void* p = HeapPool_malloc(&size);
+
+		if (p)
+		{
+			state.current_size += size;
+			if (state.current_size > state.max_size)
+				state.max_size = state.current_size;
+			Thread_unlock_mutex(heap_mutex);
+			return p;
+		}
+	}
+#endif
 	if ((s = malloc(sizeof(storageElement))) == NULL)
 	{
 		Log(LOG_ERROR, 13, errmsg);
@@ -266,6 +282,18 @@ void myfree(char* file, int line, void* p)
 	if (p) /* it is legal und usual to call free(NULL) */
 	{
 		Thread_lock_mutex(heap_mutex);
+#if defined(HEAP_POOLS)
+		{
+			size_t size = HeapPool_free(p);
+
+			if (size)
+			{
+				state.current_size -= size;
+				Thread_unlock_mutex(heap_mutex);
+				return;
+			}
+		}
+#endif
 		if (Internal_heap_unlink(file, line, p))
 			free(((int*)p)-1);
 		Thread_unlock_mutex(heap_mutex);
@@ -310,6 +338,23 @@ void *myrealloc(char* file, int line, void* p, size_t size)
 	storageElement* s = NULL;
 
 	Thread_lock_mutex(heap_mutex);
+#if defined(HEAP_POOLS)
+	{
+		size_t oldsize = HeapPool_size(p);
+
+		if (oldsize)
+		{
+			/* into a new item, from the pools or not as its new size decides */
+			Thread_unlock_mutex(heap_mutex);
+			if ((rc = mymalloc(file, line, size)) != NULL)
+			{
+				memcpy(rc, p, (oldsize < size) ? oldsize : size);
+				myfree(file, line, p);
+			}
+			return rc;
+		}
+	}
+#endif
 	s = TreeRemoveKey(&heap, ((int*)p)-1);
 	if (s == NULL)
 		Log(LOG_ERROR, 13, "Failed to reallocate heap item at file %s line %d", file, line);
@@ -349,16 +394,22 @@ void *myrealloc(char* file, int line, void* p, size_t size)
  * Utility to find an item in the heap.  Lets you know if the heap already contains
  * the memory location in question.
  * @param p pointer to a memory location
- * @return pointer to the storage element if found, or NULL
+ * @return pointer to the storage element if found, or the pool chunk holding it, or NULL
  */
 void* Heap_findItem(void* p)
 {
 	Node* e = NULL;
+	void* rc = NULL;
 
 	Thread_lock_mutex(heap_mutex);
-	e = TreeFind(&heap, ((int*)p)-1);
+#if defined(HEAP_POOLS)
+	rc = HeapPool_findItem(p);
+	if (rc == NULL)
+#endif
+	if ((e = TreeFind(&heap, ((int*)p)-1)) != NULL)
+		rc = e->content;
 	Thread_unlock_mutex(heap_mutex);
-	return (e == NULL) ? NULL : e->content;
+	return rc;
 }
 
 
@@ -403,6 +454,22 @@ int Heap_initialize(void)
 void Heap_terminate(void)
 {
 	Log(TRACE_MIN, -1, "Maximum heap use was %d bytes", (int)state.max_size);
+#if defined(HEAP_POOLS)
+	Thread_lock_mutex(heap_mutex);
+	HeapPool_trim();
+	HeapPool_get_info(state.pools);
+	Thread_unlock_mutex(heap_mutex);
+	{
+		int i;
+
+		for (i = 0; i <= HEAP_POOL_CLASSES; ++i)
+		{
+			if (state.pools[i].in_use > 0)
+				Log(LOG_ERROR, -1, "Heap pool of %d bytes has %d blocks not freed", (int)state.pools[i].size,
+						state.pools[i].in_use);
+		}
+	}
+#endif
 	if (state.current_size > 20) /* One log list is freed after this function is called */
 	{
 		Log(LOG_ERROR, -1, "Some memory not freed at shutdown, possible memory leak");
@@ -413,10 +480,15 @@ void Heap_terminate(void)
 
 /**
  * Access to heap state
- * @return pointer to the heap state structure
+ * @return pointer to the heap state structure, with HEAP_POOLS the pool statistics as of this call
  */
 heap_info* Heap_get_info(void)
 {
+#if defined(HEAP_POOLS)
+	Thread_lock_mutex(heap_mutex);
+	HeapPool_get_info(state.pools);
+	Thread_unlock_mutex(heap_mutex);
+#endif
 	return &state;
 }
 
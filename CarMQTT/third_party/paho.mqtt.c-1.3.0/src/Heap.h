@@ -50,6 +50,23 @@
 
 #endif
 
+#if defined(HEAP_POOLS)
+/** number of size classes of the heap pools, the arena comes after them */
+#define HEAP_POOL_CLASSES 8
+
+/**
+ * Information about one heap pool.
+ */
+typedef struct
+{
+	size_t size;			/**< size of the blocks, for the arena the largest it takes */
+	int chunks;				/**< chunks of memory the pool holds */
+	int in_use;				/**< blocks allocated now */
+	int max_in_use;			/**< the most blocks allocated at once */
+	unsigned long allocs;	/**< blocks allocated in all */
+} heap_pool_info;
+#endif
+
 /**
  * Information about the state of the heap.
  */
@@ -57,6 +74,9 @@ typedef struct
 {
 	size_t current_size;	/**< current size of the heap in bytes */
 	size_t max_size;		/**< max size the heap has reached in bytes */
+#if defined(HEAP_POOLS)
+	heap_pool_info pools[HEAP_POOL_CLASSES + 1];	/**< the size classes, then the arena */
+#endif
 } heap_info;
 
 #if defined(__cplusplus)
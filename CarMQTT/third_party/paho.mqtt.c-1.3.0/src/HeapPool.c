@@ -0,0 +1,461 @@
+/*******************************************************************************
+ * Copyright (c) 2020 HiHope Community.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    HiSpark Product Team - pools of the tracked heap
+ *******************************************************************************/
+
+/**
+ * @file
+ * \brief Pools for the small blocks of the tracked heap, built with HEAP_POOLS.
+ *
+ * The packets, list elements and messages are a few fixed sizes, each taken from the size
+ * class it rounds up to, where a free block goes back on the free list of its chunk.  The
+ * topic and payload copies up to HEAP_POOL_ARENA_MAX are cut one after the other from an
+ * arena chunk, which is reused once all its blocks are freed, as they are in about the order
+ * they were allocated.  Neither needs an allocation record, so the blocks are not in the heap
+ * tree.
+ *
+ * All the chunks are HEAP_POOL_CHUNK bytes, kept in address order so that a pointer leads to
+ * its chunk.  A chunk with no blocks left goes back to the system, but for one per size class.
+ *
+ * Heap.c calls these with the heap mutex held.
+ */
+
+#include "HeapPool.h"
+
+#if defined(HEAP_POOLS)
+
+#include <stdlib.h>
+#include <string.h>
+
+#undef malloc
+#undef realloc
+#undef free
+
+/** alignment of the blocks, the same as the tracked ones */
+#define HEAP_POOL_ALIGN 16
+#define HEAP_POOL_ROUNDUP(x) (((x) + HEAP_POOL_ALIGN - 1) & ~(size_t)(HEAP_POOL_ALIGN - 1))
+
+/** index of the arena in the pools */
+#define HEAP_POOL_ARENA HEAP_POOL_CLASSES
+
+/**
+ * The start of each chunk
+ */
+typedef struct HeapPool_chunk_s
+{
+	struct HeapPool_chunk_s* next;	/**< next chunk of the pool with room, or the older arena chunks */
+	struct HeapPool_chunk_s* prev;	/**< previous chunk of the pool with room */
+	int pool;						/**< index of the pool */
+	int live;						/**< blocks allocated from the chunk */
+	int listed;						/**< whether the chunk is in the list of its pool */
+	void* free;						/**< freed blocks, each holding a pointer to the next one */
+	size_t used;					/**< bytes of the chunk given out once, after the header */
+} HeapPool_chunk;
+
+/** the blocks of a chunk start after its header */
+#define HEAP_POOL_HEADER HEAP_POOL_ROUNDUP(sizeof(HeapPool_chunk))
+/** an arena block starts with its size */
+#define HEAP_POOL_ARENA_HEADER HEAP_POOL_ROUNDUP(sizeof(size_t))
+
+/**
+ * One size class or the arena
+ */
+typedef struct
+{
+	HeapPool_chunk* chunks;	/**< chunks with room, the arena allocates from the first one only */
+	heap_pool_info info;	/**< the statistics */
+} HeapPool;
+
+static struct
+{
+	HeapPool pools[HEAP_POOL_CLASSES + 1];
+	HeapPool_chunk** chunks;	/**< all the chunks in address order */
+	int count;					/**< number of chunks */
+	int size;					/**< room in chunks */
+} state =
+{
+	{
+		{NULL, {16, 0, 0, 0, 0}}, {NULL, {32, 0, 0, 0, 0}}, {NULL, {48, 0, 0, 0, 0}},
+		{NULL, {64, 0, 0, 0, 0}}, {NULL, {96, 0, 0, 0, 0}}, {NULL, {128, 0, 0, 0, 0}},
+		{NULL, {192, 0, 0, 0, 0}}, {NULL, {HEAP_POOL_CLASS_MAX, 0, 0, 0, 0}},
+		{NULL, {HEAP_POOL_ARENA_MAX, 0, 0, 0, 0}}
+	},
+	NULL, 0, 0
+};
+
+
+static int HeapPool_class(size_t size);
+static int HeapPool_search(void* p, int* index);
+static HeapPool_chunk* HeapPool_newChunk(int pool);
+static void HeapPool_freeChunk(HeapPool_chunk* c);
+static void HeapPool_link(HeapPool_chunk* c);
+static void HeapPool_unlink(HeapPool_chunk* c);
+static void* HeapPool_classMalloc(int pool, size_t* size);
+static void* HeapPool_arenaMalloc(size_t* size);
+
+
+/**
+ * Find the size class for a block size
+ * @param size the block size, a multiple of HEAP_POOL_ALIGN
+ * @return the index of the class, or HEAP_POOL_ARENA if it is larger than all
+ */
+static int HeapPool_class(size_t size)
+{
+	int i;
+
+	for (i = 0; i < HEAP_POOL_CLASSES && state.pools[i].info.size < size; ++i)
+		;
+	return i;
+}
+
+
+/**
+ * Binary search of the chunk table
+ * @param p a pointer
+ * @param index set to the position of the chunk holding p, or where a chunk at p would go
+ * @return whether a chunk holds p
+ */
+static int HeapPool_search(void* p, int* index)
+{
+	int lo = 0;
+	int hi = state.count - 1;
+
+	while (lo <= hi)
+	{
+		int mid = (lo + hi) / 2;
+		char* start = (char*)(state.chunks[mid]);
+
+		if ((char*)p < start)
+			hi = mid - 1;
+		else if ((char*)p >= start + HEAP_POOL_CHUNK)
+			lo = mid + 1;
+		else
+		{
+			*index = mid;
+			return 1;
+		}
+	}
+	*index = lo;
+	return 0;
+}
+
+
+/**
+ * Get a new chunk from the system and add it to the chunk table
+ * @param pool the index of the pool it is for
+ * @return the chunk, or NULL if there was no memory
+ */
+static HeapPool_chunk* HeapPool_newChunk(int pool)
+{
+	HeapPool_chunk* c = NULL;
+	int i;
+
+	if (state.count == state.size)
+	{
+		int size = (state.size == 0) ? 16 : state.size * 2;
+		HeapPool_chunk** chunks = realloc(state.chunks, size * sizeof(HeapPool_chunk*));
+
+		if (chunks == NULL)
+			goto exit;
+		state.chunks = chunks;
+		state.size = size;
+	}
+	if ((c = malloc(HEAP_POOL_CHUNK)) == NULL)
+		goto exit;
+	memset(c, '\0', sizeof(HeapPool_chunk));
+	c->pool = pool;
+	(void)HeapPool_search(c, &i);
+	memmove(&state.chunks[i + 1], &state.chunks[i], (state.count - i) * sizeof(HeapPool_chunk*));
+	state.chunks[i] = c;
+	++(state.count);
+	++(state.pools[pool].info.chunks);
+exit:
+	return c;
+}
+
+
+/**
+ * Give a chunk with no blocks back to the system
+ * @param c the chunk, already out of the list of its pool
+ */
+static void HeapPool_freeChunk(HeapPool_chunk* c)
+{
+	int i;
+
+	if (HeapPool_search(c, &i))
+	{
+		memmove(&state.chunks[i], &state.chunks[i + 1], (state.count - i - 1) * sizeof(HeapPool_chunk*));
+		--(state.count);
+	}
+	--(state.pools[c->pool].info.chunks);
+	free(c);
+}
+
+
+/**
+ * Put a chunk first in the list of its pool
+ * @param c the chunk
+ */
+static void HeapPool_link(HeapPool_chunk* c)
+{
+	HeapPool* pool = &state.pools[c->pool];
+
+	c->prev = NULL;
+	c->next = pool->chunks;
+	if (pool->chunks)
+		pool->chunks->prev = c;
+	pool->chunks = c;
+	c->listed = 1;
+}
+
+
+/**
+ * Take a chunk out of the list of its pool
+ * @param c the chunk
+ */
+static void HeapPool_unlink(HeapPool_chunk* c)
+{
+	if (c->prev)
+		c->prev->next = c->next;
+	else
+		state.pools[c->pool].chunks = c->next;
+	if (c->next)
+		c->next->prev = c->prev;
+	c->next = c->prev = NULL;
+	c->listed = 0;
+}
+
+
+/**
+ * Allocate a block of a size class
+ * @param pool the index of the class
+ * @param size set to the block size
+ * @return the block, or NULL if there was no memory
+ */
+static void* HeapPool_classMalloc(int pool, size_t* size)
+{
+	HeapPool_chunk* c = state.pools[pool].chunks;
+	size_t blocksize = state.pools[pool].info.size;
+	char* p = NULL;
+
+	if (c == NULL)
+	{
+		if ((c = HeapPool_newChunk(pool)) == NULL)
+			goto exit;
+		HeapPool_link(c);
+	}
+	if (c->free)
+	{
+		p = c->free;
+		c->free = *(void**)p;
+	}
+	else
+	{
+		p = (char*)c + HEAP_POOL_HEADER + c->used;
+		c->used += blocksize;
+	}
+	++(c->live);
+	if (c->free == NULL && HEAP_POOL_HEADER + c->used + blocksize > HEAP_POOL_CHUNK)
+		HeapPool_unlink(c); /* full */
+	*size = blocksize;
+exit:
+	return p;
+}
+
+
+/**
+ * Allocate a block from the arena
+ * @param size the size wanted, set to the block size
+ * @return the block, or NULL if there was no memory
+ */
+static void* HeapPool_arenaMalloc(size_t* size)
+{
+	HeapPool* arena = &state.pools[HEAP_POOL_ARENA];
+	HeapPool_chunk* c = arena->chunks;
+	size_t blocksize = HEAP_POOL_ROUNDUP(*size);
+	char* p = NULL;
+
+	if (c && c->live == 0)
+		c->used = 0; /* all given back, start again */
+	if (c == NULL || HEAP_POOL_HEADER + c->used + HEAP_POOL_ARENA_HEADER + blocksize > HEAP_POOL_CHUNK)
+	{
+		HeapPool_chunk* full = c;
+
+		if ((c = HeapPool_newChunk(HEAP_POOL_ARENA)) == NULL)
+			goto exit;
+		if (full)
+			HeapPool_unlink(full); /* given back to the system when its last block is freed */
+		HeapPool_link(c);
+	}
+	p = (char*)c + HEAP_POOL_HEADER + c->used;
+	*(size_t*)p = blocksize;
+	p += HEAP_POOL_ARENA_HEADER;
+	c->used += HEAP_POOL_ARENA_HEADER + blocksize;
+	++(c->live);
+	*size = blocksize;
+exit:
+	return p;
+}
+
+
+/**
+ * Allocate a block from the pools
+ * @param size the size wanted, a multiple of HEAP_POOL_ALIGN; set to the size of the block
+ * @return the block, or NULL if the size is too large for the pools or there was no memory
+ */
+void* HeapPool_malloc(size_t* size)
+{
+	int pool = HeapPool_class(*size);
+	void* p = NULL;
+
+	if (pool < HEAP_POOL_ARENA)
+		p = HeapPool_classMalloc(pool, size);
+	else if (*size <= HEAP_POOL_ARENA_MAX)
+		p = HeapPool_arenaMalloc(size);
+	if (p)
+	{
+		heap_pool_info* info = &state.pools[pool].info;
+
+		++(info->allocs);
+		if (++(info->in_use) > info->max_in_use)
+			info->max_in_use = info->in_use;
+	}
+	return p;
+}
+
+
+/**
+ * Free a block if it is from the pools
+ * @param p the block
+ * @return the size of the block, or 0 if it is not from the pools
+ */
+size_t HeapPool_free(void* p)
+{
+	HeapPool_chunk* c = NULL;
+	size_t size = 0;
+	int i;
+
+	if (!HeapPool_search(p, &i))
+		goto exit;
+	c = state.chunks[i];
+	--(state.pools[c->pool].info.in_use);
+	--(c->live);
+	if (c->pool == HEAP_POOL_ARENA)
+	{
+		size = *(size_t*)((char*)p - HEAP_POOL_ARENA_HEADER);
+		if (c->live == 0 && !c->listed)
+			HeapPool_freeChunk(c);
+	}
+	else
+	{
+		HeapPool* pool = &state.pools[c->pool];
+
+		size = pool->info.size;
+		*(void**)p = c->free;
+		c->free = p;
+		if (!c->listed)
+			HeapPool_link(c);
+		if (c->live == 0 && (pool->chunks != c || c->next != NULL))
+		{
+			HeapPool_unlink(c); /* keep only the last one */
+			HeapPool_freeChunk(c);
+		}
+	}
+exit:
+	return size;
+}
+
+
+/**
+ * Size of a block from the pools
+ * @param p the block
+ * @return the size of the block, or 0 if it is not from the pools
+ */
+size_t HeapPool_size(void* p)
+{
+	size_t size = 0;
+	int i;
+
+	if (HeapPool_search(p, &i))
+	{
+		HeapPool_chunk* c = state.chunks[i];
+
+		if (c->pool == HEAP_POOL_ARENA)
+			size = *(size_t*)((char*)p - HEAP_POOL_ARENA_HEADER);
+		else
+			size = state.pools[c->pool].info.size;
+	}
+	return size;
+}
+
+
+/**
+ * Whether a pointer is to memory of the pools
+ * @param p a pointer
+ * @return the chunk holding p, or NULL
+ */
+void* HeapPool_findItem(void* p)
+{
+	int i;
+
+	return HeapPool_search(p, &i) ? state.chunks[i] : NULL;
+}
+
+
+/**
+ * Give the chunks with no blocks in use back to the system, and the chunk table if that
+ * leaves it empty
+ */
+void HeapPool_trim(void)
+{
+	int i;
+
+	for (i = 0; i <= HEAP_POOL_ARENA; ++i)
+	{
+		HeapPool_chunk* c = state.pools[i].chunks;
+
+		while (c)
+		{
+			HeapPool_chunk* next = c->next;
+
+			if (c->live == 0)
+			{
+				HeapPool_unlink(c);
+				HeapPool_freeChunk(c);
+			}
+			c = next;
+		}
+	}
+	if (state.count == 0)
+	{
+		free(state.chunks);
+		state.chunks = NULL;
+		state.size = 0;
+	}
+}
+
+
+/**
+ * Copy out the statistics of the pools
+ * @param info HEAP_POOL_CLASSES + 1 entries, the size classes then the arena
+ */
+void HeapPool_get_info(heap_pool_info* info)
+{
+	int i;
+
+	for (i = 0; i <= HEAP_POOL_ARENA; ++i)
+		info[i] = state.pools[i].info;
+}
+
+#endif
@@ -1794,13 +1794,17 @@ static thread_return_type WINAPI MQTTAsync_sendThread(void* n)
 	MQTTAsync_unlock_mutex(mqttasync_mutex);
 	while (!tostop)
 	{
-		int rc;
+		int rc, processed = 1;
 
-		while (commands->count > 0)
+		/* a command queued while the corked packets are written is not signalled, so look again */
+		while (processed && commands->count > 0)
 		{
-			if (MQTTAsync_processCommand() == 0)
-				break;  /* no commands were processed, so go into a wait */
+			Socket_cork(); /* the packets of the commands queued together go together */
+			while ((processed = MQTTAsync_processCommand()) != 0 && commands->count > 0)
+				;
+			Socket_uncork();
 		}
+		/* no commands, or none could be processed, so go into a wait */
 #if !defined(WIN32) && !defined(WIN64)
 		if ((rc = Thread_wait_cond(send_cond, 1)) != 0 && rc != ETIMEDOUT)
 			Log(LOG_ERROR, -1, "Error %d waiting for condition variable", rc);
@@ -2029,6 +2033,7 @@ static int MQTTAsync_completeConnection(MQTTAsyncs* m, Connack* connack)
 			m->c->connected = 1;
 			m->c->good = 1;
 			m->c->connect_state = NOT_IN_PROGRESS;
+			MQTTProtocol_setTopicAliasMax(m->c, (m->c->MQTTVersion >= MQTTVERSION_5) ? &connack->properties : NULL);
 			if (m->c->cleansession || m->c->cleanstart)
 				rc = MQTTAsync_cleanSession(m->c);
 			else if (m->c->MQTTVersion >= MQTTVERSION_3_1_1 && connack->flags.bits.sessionPresent == 0)
@@ -2626,6 +2631,8 @@ static int MQTTAsync_cleanSession(Clients* client)
 #endif
 	MQTTProtocol_emptyMessageList(client->inboundMsgs);
 	MQTTProtocol_emptyMessageList(client->outboundMsgs);
+	MessageIDs_clear(&client->inboundIDs);
+	MessageIDs_clear(&client->outboundIDs);
 	MQTTAsync_emptyMessageQueue(client);
 	client->msgID = 0;
 
@@ -3150,6 +3157,26 @@ int MQTTAsync_isConnected(MQTTAsync handle)
 }
 
 
+int MQTTAsync_getPublishStats(MQTTAsync handle, MQTTAsync_publishStats* stats)
+{
+	MQTTAsyncs* m = handle;
+	int rc = MQTTASYNC_FAILURE;
+
+	FUNC_ENTRY;
+	MQTTAsync_lock_mutex(mqttasync_mutex);
+	if (m && m->c && stats)
+	{
+		stats->count = m->c->publishCount;
+		stats->aliased = m->c->publishAliased;
+		stats->bytes = m->c->publishBytes;
+		rc = MQTTASYNC_SUCCESS;
+	}
+	MQTTAsync_unlock_mutex(mqttasync_mutex);
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
 static int cmdMessageIDCompare(void* a, void* b)
 {
 	MQTTAsync_queuedCommand* cmd = (MQTTAsync_queuedCommand*)a;
@@ -3609,7 +3636,7 @@ static int MQTTAsync_connecting(MQTTAsyncs* m)
 						m->c->session = SSL_get1_session(m->c->net.ssl);
 #endif
 #if defined(MBEDTLS)
-						mbedtls_ssl_get_session(m->c->net.ssl, m->c->session);
+						SSLSocket_saveSession(m->c->net.ssl, &m->c->session);
 #endif
 #if defined(OPENSSL) || defined(MBEDTLS)
 				}
@@ -3657,7 +3684,7 @@ static int MQTTAsync_connecting(MQTTAsyncs* m)
 			m->c->session = SSL_get1_session(m->c->net.ssl);
 #endif
 #if defined(MBEDTLS)
-			mbedtls_ssl_get_session(m->c->net.ssl, m->c->session);
+			SSLSocket_saveSession(m->c->net.ssl, &m->c->session);
 #endif
 #if defined(OPENSSL) || defined(MBEDTLS)
 
@@ -3755,10 +3782,22 @@ static MQTTPacket* MQTTAsync_cycle(int* sock, unsigned long timeout, int* rc)
 			else if (pack->header.bits.type == PUBACK || pack->header.bits.type == PUBCOMP ||
 					pack->header.bits.type == PUBREC)
 			{
-				int msgid;
+				int msgid = 0,
+					msgtype = 0,
+					ackrc = 0,
+					mqttversion = 0;
+				MQTTProperties msgprops = MQTTProperties_initializer;
 
 				ack = *(Ack*)pack;
+				/* these values are stored because the packet structure is freed in the handle functions */
 				msgid = ack.msgId;
+				msgtype = pack->header.bits.type;
+				if (ack.MQTTVersion >= MQTTVERSION_5)
+				{
+					ackrc = ack.rc;
+					msgprops = MQTTProperties_copy(&ack.properties);
+					mqttversion = ack.MQTTVersion;
+				}
 
 				if (pack->header.bits.type == PUBCOMP)
 				{
@@ -3777,7 +3816,7 @@ static MQTTPacket* MQTTAsync_cycle(int* sock, unsigned long timeout, int* rc)
 				}
 				if (!m)
 					Log(LOG_ERROR, -1, "PUBCOMP, PUBACK or PUBREC received for no client, msgid %d", msgid);
-				if (m && (pack->header.bits.type != PUBREC || ack.rc >= MQTTREASONCODE_UNSPECIFIED_ERROR))
+				if (m && (msgtype != PUBREC || ackrc >= MQTTREASONCODE_UNSPECIFIED_ERROR))
 				{
 					ListElement* current = NULL;
 
@@ -3807,7 +3846,7 @@ static MQTTPacket* MQTTAsync_cycle(int* sock, unsigned long timeout, int* rc)
 								Log(TRACE_MIN, -1, "Calling publish success for client %s", m->c->clientID);
 								(*(command->command.onSuccess))(command->command.context, &data);
 							}
-							else if (command->command.onSuccess5 && ack.rc < MQTTREASONCODE_UNSPECIFIED_ERROR)
+							else if (command->command.onSuccess5 && ackrc < MQTTREASONCODE_UNSPECIFIED_ERROR)
 							{
 								MQTTAsync_successData5 data = MQTTAsync_successData5_initializer;
 
@@ -3821,14 +3860,14 @@ static MQTTPacket* MQTTAsync_cycle(int* sock, unsigned long timeout, int* rc)
 								Log(TRACE_MIN, -1, "Calling publish success for client %s", m->c->clientID);
 								(*(command->command.onSuccess5))(command->command.context, &data);
 							}
-							else if (command->command.onFailure5 && ack.rc >= MQTTREASONCODE_UNSPECIFIED_ERROR)
+							else if (command->command.onFailure5 && ackrc >= MQTTREASONCODE_UNSPECIFIED_ERROR)
 							{
 								MQTTAsync_failureData5 data = MQTTAsync_failureData5_initializer;
 
 								data.token = command->command.token;
-								data.reasonCode = ack.rc;
-								data.properties = ack.properties;
-								data.packet_type = pack->header.bits.type;
+								data.reasonCode = ackrc;
+								data.properties = msgprops;
+								data.packet_type = msgtype;
 								Log(TRACE_MIN, -1, "Calling publish failure for client %s", m->c->clientID);
 								(*(command->command.onFailure5))(command->command.context, &data);
 							}
@@ -3837,6 +3876,8 @@ static MQTTPacket* MQTTAsync_cycle(int* sock, unsigned long timeout, int* rc)
 						}
 					}
 				}
+				if (mqttversion >= MQTTVERSION_5)
+					MQTTProperties_free(&msgprops);
 			}
 			else if (pack->header.bits.type == PUBREL)
 				*rc = MQTTProtocol_handlePubrels(pack, *sock);
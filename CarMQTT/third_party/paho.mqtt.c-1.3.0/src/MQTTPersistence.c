@@ -34,6 +34,7 @@
 
 static MQTTPersistence_qEntry* MQTTPersistence_restoreQueueEntry(char* buffer, size_t buflen, int MQTTVersion);
 static void MQTTPersistence_insertInSeqOrder(List* list, MQTTPersistence_qEntry* qEntry, size_t size);
+static void MQTTPersistence_indexMessages(List* list, MessageIDs* ids);
 
 /**
  * Creates a ::MQTTClient_persistence structure representing a persistence implementation.
@@ -308,11 +309,29 @@ int MQTTPersistence_restore(Clients *c)
 		msgs_sent, msgs_rcvd, c->clientID);
 	MQTTPersistence_wrapMsgID(c);
 exit:
+	MQTTPersistence_indexMessages(c->outboundMsgs, &c->outboundIDs);
+	MQTTPersistence_indexMessages(c->inboundMsgs, &c->inboundIDs);
 	FUNC_EXIT_RC(rc);
 	return rc;
 }
 
 
+/**
+ * Indexes the restored messages by message id, once they are all in their place in the list.
+ * @param list the outbound or inbound message list of a client.
+ * @param ids the index of the list.
+ */
+static void MQTTPersistence_indexMessages(List* list, MessageIDs* ids)
+{
+	ListElement* current = NULL;
+
+	FUNC_ENTRY;
+	while (ListNextElement(list, &current) != NULL)
+		(void)MessageIDs_add(ids, ((Messages*)(current->content))->msgid, current);
+	FUNC_EXIT;
+}
+
+
 /**
  * Returns a MQTT packet restored from persisted data.
  * @param buffer the persisted data.
@@ -393,7 +412,6 @@ int MQTTPersistence_put(int socket, char* buf0, size_t buf0len, int count,
 						char** buffers, size_t* buflens, int htype, int msgId, int scr, int MQTTVersion)
 {
 	int rc = 0;
-	extern ClientStates* bstate;
 	int nbufs, i;
 	int* lens = NULL;
 	char** bufs = NULL;
@@ -401,7 +419,7 @@ int MQTTPersistence_put(int socket, char* buf0, size_t buf0len, int count,
 	Clients* client = NULL;
 
 	FUNC_ENTRY;
-	client = (Clients*)(ListFindItem(bstate->clients, &socket, clientSocketCompare)->content);
+	client = MQTTProtocol_findClient(socket);
 	if (client->persistence != NULL)
 	{
 		key = malloc(MESSAGE_FILENAME_LENGTH + 1);
@@ -0,0 +1,50 @@
+/*******************************************************************************
+ * Copyright (c) 2020 HiHope Community.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    HiSpark Product Team - log structured persistence
+ *******************************************************************************/
+
+#if !defined(MQTTPERSISTENCELOG_H)
+#define MQTTPERSISTENCELOG_H
+
+#include <stddef.h>
+
+#include "MQTTClientPersistence.h"
+
+/** Extension of the segment files */
+#define LOG_SEGMENT_EXTENSION ".plog"
+
+/**
+ * Options of the log store, see MQTTPersistenceLog_create()
+ */
+typedef struct
+{
+	/** the base directory, a sub-directory is made beneath it per client as for the default persistence */
+	const char* directory;
+	/** a new segment is started once a record would take the current one past this many bytes */
+	size_t segment_size;
+	/** the records are synced to the disk once this many are written, 1 syncs each one, 0 leaves it to sync_ms */
+	int sync_records;
+	/** the records not synced yet are synced after this many milliseconds (10 ms steps) by the
+	 * store thread, which also compacts the segments.  0 for no thread, the segments are then compacted
+	 * as the records are written */
+	int sync_ms;
+	/** the oldest segment is compacted once less than this percentage of it is live */
+	int compact_percent;
+} MQTTPersistenceLog_options;
+
+#define MQTTPersistenceLog_options_initializer { ".", 1024 * 1024, 64, 50, 50 }
+
+int MQTTPersistenceLog_create(MQTTClient_persistence* persistence, MQTTPersistenceLog_options* options);
+
+#endif
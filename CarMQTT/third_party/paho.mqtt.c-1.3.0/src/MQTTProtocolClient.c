@@ -46,6 +46,7 @@
 
 extern MQTTProtocol state;
 extern ClientStates* bstate;
+extern mutex_type socket_mutex;
 
 
 static void MQTTProtocol_storeQoS0(Clients* pubclient, Publish* publish);
@@ -55,6 +56,10 @@ static int MQTTProtocol_startPublishCommon(
 		int qos,
 		int retained);
 static void MQTTProtocol_retries(time_t now, Clients* client, int regardless);
+static ListElement* MQTTProtocol_findMessage(List* list, MessageIDs* ids, int msgid);
+static void MQTTProtocol_addMessage(List* list, MessageIDs* ids, Messages* m, size_t size);
+static void MQTTProtocol_removeMessage(List* list, MessageIDs* ids, Messages* m);
+static void MQTTProtocol_unlinkPublication(Publications* p);
 
 /**
  * List callback function for comparing Message structures by message id
@@ -69,6 +74,80 @@ int messageIDCompare(void* a, void* b)
 }
 
 
+/**
+ * Find the client a socket belongs to.  The client list is only changed with the socket mutex held,
+ * so the search is safe from clients being added or removed on other threads.
+ * @param sock the socket
+ * @return the client, or NULL if none has the socket
+ */
+Clients* MQTTProtocol_findClient(int sock)
+{
+	Clients* client = NULL;
+	ListElement* found = NULL;
+
+	Thread_lock_mutex(socket_mutex);
+	if ((found = ListFindItem(bstate->clients, &sock, clientSocketCompare)) != NULL)
+		client = (Clients*)(found->content);
+	Thread_unlock_mutex(socket_mutex);
+	return client;
+}
+
+
+/**
+ * Find a message in the inbound or outbound list of a client by message id, through the index
+ * of the list.  The list is only searched if some messages could not be indexed.
+ * @param list the message list
+ * @param ids the index of the list
+ * @param msgid the message id to look for
+ * @return the list element found, or NULL.  It is also the current element of the list, so that
+ * ListRemove takes it without a search
+ */
+static ListElement* MQTTProtocol_findMessage(List* list, MessageIDs* ids, int msgid)
+{
+	ListElement* elem = MessageIDs_find(ids, msgid);
+
+	if (elem != NULL)
+		list->current = elem;
+	else if (ids->count < list->count)
+		elem = ListFindItem(list, &msgid, messageIDCompare);
+	return elem;
+}
+
+
+/**
+ * Append a message to the inbound or outbound list of a client and index it
+ * @param list the message list
+ * @param ids the index of the list
+ * @param m the message
+ * @param size the size of the message
+ */
+static void MQTTProtocol_addMessage(List* list, MessageIDs* ids, Messages* m, size_t size)
+{
+	ListAppend(list, m, size);
+	if (MessageIDs_add(ids, m->msgid, list->last) != 0)
+		Log(TRACE_MIN, -1, "Message id %d not indexed, the list is searched for it", m->msgid);
+}
+
+
+/**
+ * Remove and free a message from the inbound or outbound list of a client, and from the index
+ * @param list the message list
+ * @param ids the index of the list
+ * @param m the message
+ */
+static void MQTTProtocol_removeMessage(List* list, MessageIDs* ids, Messages* m)
+{
+	ListElement* elem = MessageIDs_find(ids, m->msgid);
+
+	if (elem != NULL && elem->content == m)
+	{
+		MessageIDs_remove(ids, m->msgid);
+		list->current = elem;
+	}
+	ListRemove(list, m);
+}
+
+
 /**
  * Assign a new message id for a client.  Make sure it isn't already being used and does
  * not exceed the maximum.
@@ -82,7 +161,7 @@ int MQTTProtocol_assignMsgId(Clients* client)
 
 	FUNC_ENTRY;
 	msgid = (msgid == MAX_MSG_ID) ? 1 : msgid + 1;
-	while (ListFindItem(client->outboundMsgs, &msgid, messageIDCompare) != NULL)
+	while (MQTTProtocol_findMessage(client->outboundMsgs, &client->outboundIDs, msgid) != NULL)
 	{
 		msgid = (msgid == MAX_MSG_ID) ? 1 : msgid + 1;
 		if (msgid == start_msgid)
@@ -109,11 +188,87 @@ static void MQTTProtocol_storeQoS0(Clients* pubclient, Publish* publish)
 	Log(TRACE_MIN, 12, NULL);
 	pw->p = MQTTProtocol_storePublication(publish, &len);
 	pw->socket = pubclient->net.socket;
+	Thread_lock_mutex(socket_mutex);
 	ListAppend(&(state.pending_writes), pw, sizeof(pending_write)+len);
 	/* we don't copy QoS 0 messages unless we have to, so now we have to tell the socket buffer where
 	the saved copy is */
 	if (SocketBuffer_updateWrite(pw->socket, pw->p->topic, pw->p->payload) == NULL)
 		Log(LOG_SEVERE, 0, "Error updating write");
+	Thread_unlock_mutex(socket_mutex);
+	FUNC_EXIT;
+}
+
+
+/**
+ * Send a PUBLISH packet, with a topic alias for the topic if the connection has them and the
+ * caller did not set one, and count its bytes.
+ * @param pubclient the client to send the publication to
+ * @param publish the publication data
+ * @param dup boolean - whether to set the MQTT DUP flag
+ * @param qos the MQTT QoS to use
+ * @param retained boolean - whether to set the MQTT retained flag
+ * @return the completion code
+ */
+static int MQTTProtocol_sendPublish(Clients* pubclient, Publish* publish, int dup, int qos, int retained)
+{
+	static char noTopic[] = "";
+	MQTTProperty props[MQTTPROTOCOL_ALIAS_PROPS];
+	Publish p = *publish;
+	int alias = 0, assigned = 0;
+	int rc, len;
+
+	FUNC_ENTRY;
+	/* the publishes with more properties are rare, they go without an alias rather than a malloc */
+	if (publish->MQTTVersion >= MQTTVERSION_5 && pubclient->outboundAliases.max > 0 &&
+			publish->properties.count < MQTTPROTOCOL_ALIAS_PROPS &&
+			!MQTTProperties_hasProperty(&publish->properties, MQTTPROPERTY_CODE_TOPIC_ALIAS))
+		alias = TopicAliases_get(&pubclient->outboundAliases, publish->topic, &assigned);
+	if (alias > 0)
+	{
+		/* the properties are written out by the send, a copy with the alias added will do */
+		if (publish->properties.count > 0)
+			memcpy(props, publish->properties.array, publish->properties.count * sizeof(MQTTProperty));
+		props[publish->properties.count].identifier = MQTTPROPERTY_CODE_TOPIC_ALIAS;
+		props[publish->properties.count].value.integer2 = (unsigned short)alias;
+		p.properties.array = props;
+		p.properties.count = publish->properties.count + 1;
+		p.properties.max_count = MQTTPROTOCOL_ALIAS_PROPS;
+		p.properties.length = publish->properties.length + 3; /* identifier and two byte integer */
+		if (!assigned)
+			p.topic = noTopic;
+	}
+
+	len = 2 + (int)strlen(p.topic) + ((qos > 0) ? 2 : 0) + p.payloadlen;
+	if (p.MQTTVersion >= MQTTVERSION_5)
+		len += MQTTProperties_len(&p.properties);
+	rc = MQTTPacket_send_publish(&p, dup, qos, retained, &pubclient->net, pubclient->clientID);
+	if (rc != SOCKET_ERROR)
+	{
+		++(pubclient->publishCount);
+		if (alias > 0 && !assigned)
+			++(pubclient->publishAliased);
+		pubclient->publishBytes += 1 + MQTTPacket_VBIlen(len) + len;
+	}
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/**
+ * Take the topic alias maximum of a CONNACK for the publishes of the new connection, the aliases
+ * of the previous one are forgotten.
+ * @param client the client which is connected
+ * @param connackProps the properties of the CONNACK, NULL for an MQTT 3 connection
+ */
+void MQTTProtocol_setTopicAliasMax(Clients* client, MQTTProperties* connackProps)
+{
+	int max = 0;
+
+	FUNC_ENTRY;
+	if (connackProps && MQTTProperties_hasProperty(connackProps, MQTTPROPERTY_CODE_TOPIC_ALIAS_MAXIMUM))
+		max = MQTTProperties_getNumericValue(connackProps, MQTTPROPERTY_CODE_TOPIC_ALIAS_MAXIMUM);
+	if (TopicAliases_reset(&client->outboundAliases, max) != 0)
+		Log(LOG_ERROR, -1, "No memory for %d topic aliases of client %s", max, client->clientID);
 	FUNC_EXIT;
 }
 
@@ -131,7 +286,7 @@ static int MQTTProtocol_startPublishCommon(Clients* pubclient, Publish* publish,
 	int rc = TCPSOCKET_COMPLETE;
 
 	FUNC_ENTRY;
-	rc = MQTTPacket_send_publish(publish, 0, qos, retained, &pubclient->net, pubclient->clientID);
+	rc = MQTTProtocol_sendPublish(pubclient, publish, 0, qos, retained);
 	if (qos == 0 && rc == TCPSOCKET_INTERRUPTED)
 		MQTTProtocol_storeQoS0(pubclient, publish);
 	FUNC_EXIT_RC(rc);
@@ -157,7 +312,7 @@ int MQTTProtocol_startPublish(Clients* pubclient, Publish* publish, int qos, int
 	if (qos > 0)
 	{
 		*mm = MQTTProtocol_createMessage(publish, mm, qos, retained);
-		ListAppend(pubclient->outboundMsgs, *mm, (*mm)->len);
+		MQTTProtocol_addMessage(pubclient->outboundMsgs, &pubclient->outboundIDs, *mm, (*mm)->len);
 		/* we change these pointers to the saved message location just in case the packet could not be written
 		entirely; the socket buffer will use these locations to finish writing the packet */
 		p.payload = (*mm)->publish->payload;
@@ -241,7 +396,11 @@ Publications* MQTTProtocol_storePublication(Publish* publish, int* len)
 	memcpy(p->payload, publish->payload, p->payloadlen);
 	*len += publish->payloadlen;
 
+	/* the list is shared by all the clients */
+	Thread_lock_mutex(socket_mutex);
 	ListAppend(&(state.publications), p, *len);
+	p->elem = state.publications.last;
+	Thread_unlock_mutex(socket_mutex);
 	FUNC_EXIT;
 	return p;
 }
@@ -257,11 +416,24 @@ void MQTTProtocol_removePublication(Publications* p)
 	{
 		free(p->payload);
 		free(p->topic);
-		ListRemove(&(state.publications), p);
+		MQTTProtocol_unlinkPublication(p);
 	}
 	FUNC_EXIT;
 }
 
+
+/**
+ * Remove stored message data from the publications list, going straight to its element
+ * @param p stored publication to remove
+ */
+static void MQTTProtocol_unlinkPublication(Publications* p)
+{
+	Thread_lock_mutex(socket_mutex);
+	state.publications.current = p->elem;
+	ListRemove(&(state.publications), p);
+	Thread_unlock_mutex(socket_mutex);
+}
+
 /**
  * Process an incoming publish packet for a socket
  * @param pack pointer to the publish packet
@@ -276,7 +448,7 @@ int MQTTProtocol_handlePublishes(void* pack, int sock)
 	int rc = TCPSOCKET_COMPLETE;
 
 	FUNC_ENTRY;
-	client = (Clients*)(ListFindItem(bstate->clients, &sock, clientSocketCompare)->content);
+	client = MQTTProtocol_findClient(sock);
 	clientid = client->clientID;
 	Log(LOG_PROTOCOL, 11, NULL, sock, clientid, publish->msgId, publish->header.bits.qos,
 					publish->header.bits.retain, min(20, publish->payloadlen), publish->payload);
@@ -309,17 +481,18 @@ int MQTTProtocol_handlePublishes(void* pack, int sock)
 		if (m->MQTTVersion >= MQTTVERSION_5)
 			m->properties = MQTTProperties_copy(&publish->properties);
 		m->nextMessageType = PUBREL;
-		if ((listElem = ListFindItem(client->inboundMsgs, &(m->msgid), messageIDCompare)) != NULL)
+		if ((listElem = MQTTProtocol_findMessage(client->inboundMsgs, &client->inboundIDs, m->msgid)) != NULL)
 		{   /* discard queued publication with same msgID that the current incoming message */
 			Messages* msg = (Messages*)(listElem->content);
 			MQTTProtocol_removePublication(msg->publish);
 			if (msg->MQTTVersion >= MQTTVERSION_5)
 				MQTTProperties_free(&msg->properties);
 			ListInsert(client->inboundMsgs, m, sizeof(Messages) + len, listElem);
+			(void)MessageIDs_add(&client->inboundIDs, m->msgid, listElem->prev); /* the new one is before the old one */
 			ListRemove(client->inboundMsgs, msg);
 			already_received = 1;
 		} else
-			ListAppend(client->inboundMsgs, m, sizeof(Messages) + len);
+			MQTTProtocol_addMessage(client->inboundMsgs, &client->inboundIDs, m, sizeof(Messages) + len);
 		rc = MQTTPacket_send_pubrec(publish->msgId, &client->net, client->clientID);
 		if (m->MQTTVersion >= MQTTVERSION_5 && already_received == 0)
 		{
@@ -336,7 +509,7 @@ int MQTTProtocol_handlePublishes(void* pack, int sock)
 			publish1.properties = m->properties;
 
 			Protocol_processPublication(&publish1, client);
-			ListRemove(&(state.publications), m->publish);
+			MQTTProtocol_unlinkPublication(m->publish);
 			m->publish = NULL;
 		}
 		publish->topic = NULL;
@@ -359,11 +532,11 @@ int MQTTProtocol_handlePubacks(void* pack, int sock)
 	int rc = TCPSOCKET_COMPLETE;
 
 	FUNC_ENTRY;
-	client = (Clients*)(ListFindItem(bstate->clients, &sock, clientSocketCompare)->content);
+	client = MQTTProtocol_findClient(sock);
 	Log(LOG_PROTOCOL, 14, NULL, sock, client->clientID, puback->msgId);
 
 	/* look for the message by message id in the records of outbound messages for this client */
-	if (ListFindItem(client->outboundMsgs, &(puback->msgId), messageIDCompare) == NULL)
+	if (MQTTProtocol_findMessage(client->outboundMsgs, &client->outboundIDs, puback->msgId) == NULL)
 		Log(TRACE_MIN, 3, NULL, "PUBACK", client->clientID, puback->msgId);
 	else
 	{
@@ -381,7 +554,7 @@ int MQTTProtocol_handlePubacks(void* pack, int sock)
 			MQTTProtocol_removePublication(m->publish);
 			if (m->MQTTVersion >= MQTTVERSION_5)
 				MQTTProperties_free(&m->properties);
-			ListRemove(client->outboundMsgs, m);
+			MQTTProtocol_removeMessage(client->outboundMsgs, &client->outboundIDs, m);
 		}
 	}
 	if (puback->MQTTVersion >= MQTTVERSION_5)
@@ -405,12 +578,11 @@ int MQTTProtocol_handlePubrecs(void* pack, int sock)
 	int rc = TCPSOCKET_COMPLETE;
 
 	FUNC_ENTRY;
-	client = (Clients*)(ListFindItem(bstate->clients, &sock, clientSocketCompare)->content);
+	client = MQTTProtocol_findClient(sock);
 	Log(LOG_PROTOCOL, 15, NULL, sock, client->clientID, pubrec->msgId);
 
 	/* look for the message by message id in the records of outbound messages for this client */
-	client->outboundMsgs->current = NULL;
-	if (ListFindItem(client->outboundMsgs, &(pubrec->msgId), messageIDCompare) == NULL)
+	if (MQTTProtocol_findMessage(client->outboundMsgs, &client->outboundIDs, pubrec->msgId) == NULL)
 	{
 		if (pubrec->header.bits.dup == 0)
 			Log(TRACE_MIN, 3, NULL, "PUBREC", client->clientID, pubrec->msgId);
@@ -442,7 +614,7 @@ int MQTTProtocol_handlePubrecs(void* pack, int sock)
 				MQTTProtocol_removePublication(m->publish);
 				if (m->MQTTVersion >= MQTTVERSION_5)
 					MQTTProperties_free(&m->properties);
-				ListRemove(client->outboundMsgs, m);
+				MQTTProtocol_removeMessage(client->outboundMsgs, &client->outboundIDs, m);
 				(++state.msgs_sent);
 			}
 			else
@@ -474,11 +646,11 @@ int MQTTProtocol_handlePubrels(void* pack, int sock)
 	int rc = TCPSOCKET_COMPLETE;
 
 	FUNC_ENTRY;
-	client = (Clients*)(ListFindItem(bstate->clients, &sock, clientSocketCompare)->content);
+	client = MQTTProtocol_findClient(sock);
 	Log(LOG_PROTOCOL, 17, NULL, sock, client->clientID, pubrel->msgId);
 
 	/* look for the message by message id in the records of inbound messages for this client */
-	if (ListFindItem(client->inboundMsgs, &(pubrel->msgId), messageIDCompare) == NULL)
+	if (MQTTProtocol_findMessage(client->inboundMsgs, &client->inboundIDs, pubrel->msgId) == NULL)
 	{
 		if (pubrel->header.bits.dup == 0)
 			Log(TRACE_MIN, 3, NULL, "PUBREL", client->clientID, pubrel->msgId);
@@ -527,8 +699,8 @@ int MQTTProtocol_handlePubrels(void* pack, int sock)
 			if (m->MQTTVersion >= MQTTVERSION_5)
 				MQTTProperties_free(&m->properties);
 			if (m->publish)
-				ListRemove(&(state.publications), m->publish);
-			ListRemove(client->inboundMsgs, m);
+				MQTTProtocol_unlinkPublication(m->publish);
+			MQTTProtocol_removeMessage(client->inboundMsgs, &client->inboundIDs, m);
 			++(state.msgs_received);
 		}
 	}
@@ -553,11 +725,11 @@ int MQTTProtocol_handlePubcomps(void* pack, int sock)
 	int rc = TCPSOCKET_COMPLETE;
 
 	FUNC_ENTRY;
-	client = (Clients*)(ListFindItem(bstate->clients, &sock, clientSocketCompare)->content);
+	client = MQTTProtocol_findClient(sock);
 	Log(LOG_PROTOCOL, 19, NULL, sock, client->clientID, pubcomp->msgId);
 
 	/* look for the message by message id in the records of outbound messages for this client */
-	if (ListFindItem(client->outboundMsgs, &(pubcomp->msgId), messageIDCompare) == NULL)
+	if (MQTTProtocol_findMessage(client->outboundMsgs, &client->outboundIDs, pubcomp->msgId) == NULL)
 	{
 		if (pubcomp->header.bits.dup == 0)
 			Log(TRACE_MIN, 3, NULL, "PUBCOMP", client->clientID, pubcomp->msgId);
@@ -584,7 +756,7 @@ int MQTTProtocol_handlePubcomps(void* pack, int sock)
 				MQTTProtocol_removePublication(m->publish);
 				if (m->MQTTVersion >= MQTTVERSION_5)
 					MQTTProperties_free(&m->properties);
-				ListRemove(client->outboundMsgs, m);
+				MQTTProtocol_removeMessage(client->outboundMsgs, &client->outboundIDs, m);
 				(++state.msgs_sent);
 			}
 		}
@@ -597,6 +769,44 @@ int MQTTProtocol_handlePubcomps(void* pack, int sock)
 }
 
 
+/**
+ * MQTT protocol keepAlive processing for one client.  Sends a PINGREQ packet if required.
+ * @param now current time
+ * @param client the client
+ */
+void MQTTProtocol_keepaliveClient(time_t now, Clients* client)
+{
+	FUNC_ENTRY;
+	if (client->connected && client->keepAliveInterval > 0 &&
+		(difftime(now, client->net.lastSent) >= client->keepAliveInterval ||
+				difftime(now, client->net.lastReceived) >= client->keepAliveInterval))
+	{
+		if (client->ping_outstanding == 0)
+		{
+			if (Socket_noPendingWrites(client->net.socket))
+			{
+				if (MQTTPacket_send_pingreq(&client->net, client->clientID) != TCPSOCKET_COMPLETE)
+				{
+					Log(TRACE_PROTOCOL, -1, "Error sending PINGREQ for client %s on socket %d, disconnecting", client->clientID, client->net.socket);
+					MQTTProtocol_closeSession(client, 1);
+				}
+				else
+				{
+					client->net.lastSent = now;
+					client->ping_outstanding = 1;
+				}
+			}
+		}
+		else
+		{
+			Log(TRACE_PROTOCOL, -1, "PINGRESP not received in keepalive interval for client %s on socket %d, disconnecting", client->clientID, client->net.socket);
+			MQTTProtocol_closeSession(client, 1);
+		}
+	}
+	FUNC_EXIT;
+}
+
+
 /**
  * MQTT protocol keepAlive processing.  Sends PINGREQ packets as required.
  * @param now current time
@@ -611,32 +821,7 @@ void MQTTProtocol_keepalive(time_t now)
 	{
 		Clients* client =	(Clients*)(current->content);
 		ListNextElement(bstate->clients, &current);
-		if (client->connected && client->keepAliveInterval > 0 &&
-			(difftime(now, client->net.lastSent) >= client->keepAliveInterval ||
-					difftime(now, client->net.lastReceived) >= client->keepAliveInterval))
-		{
-			if (client->ping_outstanding == 0)
-			{
-				if (Socket_noPendingWrites(client->net.socket))
-				{
-					if (MQTTPacket_send_pingreq(&client->net, client->clientID) != TCPSOCKET_COMPLETE)
-					{
-						Log(TRACE_PROTOCOL, -1, "Error sending PINGREQ for client %s on socket %d, disconnecting", client->clientID, client->net.socket);
-						MQTTProtocol_closeSession(client, 1);
-					}
-					else
-					{
-						client->net.lastSent = now;
-						client->ping_outstanding = 1;
-					}
-				}
-			}
-			else
-			{
-				Log(TRACE_PROTOCOL, -1, "PINGRESP not received in keepalive interval for client %s on socket %d, disconnecting", client->clientID, client->net.socket);
-				MQTTProtocol_closeSession(client, 1);
-			}
-		}
+		MQTTProtocol_keepaliveClient(now, client);
 	}
 	FUNC_EXIT;
 }
@@ -677,7 +862,7 @@ static void MQTTProtocol_retries(time_t now, Clients* client, int regardless)
 				publish.payloadlen = m->publish->payloadlen;
 				publish.properties = m->properties;
 				publish.MQTTVersion = m->MQTTVersion;
-				rc = MQTTPacket_send_publish(&publish, 1, m->qos, m->retain, &client->net, client->clientID);
+				rc = MQTTProtocol_sendPublish(client, &publish, 1, m->qos, m->retain);
 				if (rc == SOCKET_ERROR)
 				{
 					client->good = 0;
@@ -715,6 +900,32 @@ exit:
 }
 
 
+/**
+ * MQTT retry protocol and socket pending writes processing for one client.
+ * @param now current time
+ * @param client the client
+ * @param doRetry boolean - retries as well as pending writes?
+ * @param regardless boolean - retry packets regardless of retry interval (used on reconnect)
+ */
+void MQTTProtocol_retryClient(time_t now, Clients* client, int doRetry, int regardless)
+{
+	FUNC_ENTRY;
+	if (client->connected == 0)
+		goto exit;
+	if (client->good == 0)
+	{
+		MQTTProtocol_closeSession(client, 1);
+		goto exit;
+	}
+	if (Socket_noPendingWrites(client->net.socket) == 0)
+		goto exit;
+	if (doRetry)
+		MQTTProtocol_retries(now, client, regardless);
+exit:
+	FUNC_EXIT;
+}
+
+
 /**
  * MQTT retry protocol and socket pending writes processing.
  * @param now current time
@@ -732,17 +943,7 @@ void MQTTProtocol_retry(time_t now, int doRetry, int regardless)
 	{
 		Clients* client = (Clients*)(current->content);
 		ListNextElement(bstate->clients, &current);
-		if (client->connected == 0)
-			continue;
-		if (client->good == 0)
-		{
-			MQTTProtocol_closeSession(client, 1);
-			continue;
-		}
-		if (Socket_noPendingWrites(client->net.socket) == 0)
-			continue;
-		if (doRetry)
-			MQTTProtocol_retries(now, client, regardless);
+		MQTTProtocol_retryClient(now, client, doRetry, regardless);
 	}
 	FUNC_EXIT;
 }
@@ -758,6 +959,9 @@ void MQTTProtocol_freeClient(Clients* client)
 	/* free up pending message lists here, and any other allocated data */
 	MQTTProtocol_freeMessageList(client->outboundMsgs);
 	MQTTProtocol_freeMessageList(client->inboundMsgs);
+	MessageIDs_clear(&client->outboundIDs);
+	MessageIDs_clear(&client->inboundIDs);
+	TopicAliases_free(&client->outboundAliases);
 	ListFree(client->messageQueue);
 	free(client->clientID);
         client->clientID = NULL;
@@ -793,6 +997,9 @@ void MQTTProtocol_freeClient(Clients* client)
 		free(client->sslopts);
                 client->sslopts = NULL;
 	}
+#endif
+#if defined(MBEDTLS)
+	SSLSocket_freeSession(&client->session);
 #endif
 	/* don't free the client structure itself... this is done elsewhere */
 	FUNC_EXIT;
@@ -38,8 +38,6 @@
 #include "Heap.h"
 #include "WebSocket.h"
 
-extern ClientStates* bstate;
-
 
 
 /**
@@ -171,7 +169,7 @@ int MQTTProtocol_handlePingresps(void* pack, int sock)
 	int rc = TCPSOCKET_COMPLETE;
 
 	FUNC_ENTRY;
-	client = (Clients*)(ListFindItem(bstate->clients, &sock, clientSocketCompare)->content);
+	client = MQTTProtocol_findClient(sock);
 	Log(LOG_PROTOCOL, 21, NULL, sock, client->clientID);
 	client->ping_outstanding = 0;
 	FUNC_EXIT_RC(rc);
@@ -213,7 +211,7 @@ int MQTTProtocol_handleSubacks(void* pack, int sock)
 	int rc = TCPSOCKET_COMPLETE;
 
 	FUNC_ENTRY;
-	client = (Clients*)(ListFindItem(bstate->clients, &sock, clientSocketCompare)->content);
+	client = MQTTProtocol_findClient(sock);
 	Log(LOG_PROTOCOL, 23, NULL, sock, client->clientID, suback->msgId);
 	MQTTPacket_freeSuback(suback);
 	FUNC_EXIT_RC(rc);
@@ -251,7 +249,7 @@ int MQTTProtocol_handleUnsubacks(void* pack, int sock)
 	int rc = TCPSOCKET_COMPLETE;
 
 	FUNC_ENTRY;
-	client = (Clients*)(ListFindItem(bstate->clients, &sock, clientSocketCompare)->content);
+	client = MQTTProtocol_findClient(sock);
 	Log(LOG_PROTOCOL, 24, NULL, sock, client->clientID, unsuback->msgId);
 	MQTTPacket_freeUnsuback(unsuback);
 	FUNC_EXIT_RC(rc);
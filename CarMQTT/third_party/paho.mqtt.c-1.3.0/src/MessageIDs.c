@@ -0,0 +1,186 @@
+/*******************************************************************************
+ * Copyright (c) 2020 HiHope Community.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    HiSpark Product Team - index of the inflight messages by message id
+ *******************************************************************************/
+
+/**
+ * @file
+ * \brief Index of the messages of a list by message id.
+ *
+ * Message ids are given out in sequence, so the id masked to the table size spreads them
+ * without hashing. A removed id leaves a marker rather than moving the ids behind it, as the
+ * ids in sequence fill one long run of slots.  The table is rebuilt when it gets half used,
+ * twice as large if the ids need it, and halved when it gets below an eighth, so a burst of
+ * inflight messages does not keep its memory afterwards. A direct table of all 65535 ids
+ * would not fit the smaller devices.
+ */
+
+#include "MessageIDs.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Heap.h"
+
+/** the smallest table, enough for the usual inflight window */
+#define MESSAGEIDS_MIN_SIZE 16
+/** message id of a slot whose id was removed */
+#define MESSAGEIDS_REMOVED -1
+
+
+static int MessageIDs_resize(MessageIDs* ids, int size);
+
+
+/**
+ * Position of a message id in the index, or of the free slot where the search for it ended
+ * @param ids the index
+ * @param msgid the message id
+ * @return the slot position
+ */
+static int MessageIDs_slot(MessageIDs* ids, int msgid)
+{
+	int mask = ids->size - 1;
+	int i = msgid & mask;
+
+	while (ids->slots[i].msgid != 0 && ids->slots[i].msgid != msgid)
+		i = (i + 1) & mask;
+	return i;
+}
+
+
+/**
+ * Move all the ids to a new table, which drops the removed markers
+ * @param ids the index
+ * @param size the new number of slots, a power of 2
+ * @return 0, or -1 if the table could not be allocated and the index is unchanged
+ */
+static int MessageIDs_resize(MessageIDs* ids, int size)
+{
+	MessageIDSlot* old = ids->slots;
+	int oldsize = ids->size;
+	int i;
+
+	if ((ids->slots = malloc(size * sizeof(MessageIDSlot))) == NULL)
+	{
+		ids->slots = old;
+		return -1;
+	}
+	memset(ids->slots, '\0', size * sizeof(MessageIDSlot));
+	ids->size = size;
+	ids->used = ids->count;
+	for (i = 0; i < oldsize; ++i)
+	{
+		if (old[i].msgid > 0)
+			ids->slots[MessageIDs_slot(ids, old[i].msgid)] = old[i];
+	}
+	free(old);
+	return 0;
+}
+
+
+/**
+ * Add a message id to the index, or point it to a new element if it is there already
+ * @param ids the index
+ * @param msgid the message id, 1 to 65535
+ * @param elem the element of the message in its list
+ * @return 0, or -1 if there was no memory and the id was not added
+ */
+int MessageIDs_add(MessageIDs* ids, int msgid, ListElement* elem)
+{
+	int mask, i;
+	int reuse = -1;
+
+	if ((ids->used + 1) * 2 > ids->size)
+	{
+		int size = ids->size;
+
+		if (size == 0)
+			size = MESSAGEIDS_MIN_SIZE;
+		else if ((ids->count + 1) * 4 > size)
+			size *= 2; /* otherwise the same size, without the removed markers */
+		if (MessageIDs_resize(ids, size) != 0)
+			return -1;
+	}
+	mask = ids->size - 1;
+	for (i = msgid & mask; ids->slots[i].msgid != 0; i = (i + 1) & mask)
+	{
+		if (ids->slots[i].msgid == msgid)
+		{
+			ids->slots[i].elem = elem;
+			return 0;
+		}
+		if (ids->slots[i].msgid == MESSAGEIDS_REMOVED && reuse == -1)
+			reuse = i;
+	}
+	if (reuse == -1)
+	{
+		reuse = i;
+		++(ids->used);
+	}
+	ids->slots[reuse].msgid = msgid;
+	ids->slots[reuse].elem = elem;
+	++(ids->count);
+	return 0;
+}
+
+
+/**
+ * Find the element of a message by its id
+ * @param ids the index
+ * @param msgid the message id
+ * @return the list element, or NULL if the id is not in the index
+ */
+ListElement* MessageIDs_find(MessageIDs* ids, int msgid)
+{
+	if (ids->count == 0)
+		return NULL;
+	return ids->slots[MessageIDs_slot(ids, msgid)].elem;
+}
+
+
+/**
+ * Remove a message id from the index
+ * @param ids the index
+ * @param msgid the message id
+ * @return the list element the id was for, or NULL if it was not in the index
+ */
+ListElement* MessageIDs_remove(MessageIDs* ids, int msgid)
+{
+	ListElement* elem = NULL;
+	int i;
+
+	if (ids->count == 0)
+		goto exit;
+	i = MessageIDs_slot(ids, msgid);
+	if ((elem = ids->slots[i].elem) == NULL)
+		goto exit;
+	ids->slots[i].msgid = MESSAGEIDS_REMOVED;
+	ids->slots[i].elem = NULL;
+	--(ids->count);
+	if (ids->size > MESSAGEIDS_MIN_SIZE && ids->count * 8 < ids->size)
+		(void)MessageIDs_resize(ids, ids->size / 2); /* the larger table is still good if this fails */
+exit:
+	return elem;
+}
+
+
+/**
+ * Remove all the ids and free the table
+ * @param ids the index
+ */
+void MessageIDs_clear(MessageIDs* ids)
+{
+	free(ids->slots);
+	memset(ids, '\0', sizeof(MessageIDs));
+}
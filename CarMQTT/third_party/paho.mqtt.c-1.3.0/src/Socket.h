@@ -96,14 +96,14 @@ def FD_SET
 
 def SOCKETS
 {
-	FD_SET "rset"
-	FD_SET "rset_saved"
-	n32 dec "maxfdp1"
 	n32 ptr INTList "clientsds"
-	n32 ptr INTItem "cur_clientsds"
 	n32 ptr INTList "connect_pending"
 	n32 ptr INTList "write_pending"
-	FD_SET "pending_wset"
+	n32 ptr INTList "pending_wsds"
+	n32 ptr INTList "readahead_sds"
+	n32 ptr INTList "corked_sds"
+	n32 dec "nevents"
+	n32 dec "cur_event"
 }
 BE*/
 
@@ -111,22 +111,72 @@ BE*/
 /**
  * Structure to hold all socket data for the module
  */
+/**
+ * How the sockets are waited on: epoll on Linux, poll on other Posix systems, and select
+ * on lwIP (LiteOS), Windows and VxWorks. Define one of these to choose another.
+ */
+#if !defined(SOCKET_USE_SELECT) && !defined(SOCKET_USE_POLL) && !defined(SOCKET_USE_EPOLL)
+#if defined(WIN32) || defined(WIN64) || defined(__LITEOS__) || defined(_WRS_KERNEL)
+#define SOCKET_USE_SELECT
+#elif defined(__linux__)
+#define SOCKET_USE_EPOLL
+#else
+#define SOCKET_USE_POLL
+#endif
+#endif
+
+#if defined(SOCKET_USE_POLL)
+#include <poll.h>
+#endif
+
+/** the socket can be read */
+#define SOCKET_READ 1
+/** the socket can be written */
+#define SOCKET_WRITE 2
+/** the most ready sockets returned by one wait, the rest are returned by the next */
+#define SOCKET_MAX_EVENTS 64
+
+/**
+ * A socket returned by a wait
+ */
+typedef struct
+{
+	int socket; /**< the socket, -1 once it is closed */
+	int events; /**< SOCKET_READ and/or SOCKET_WRITE */
+} Socket_event;
+
 typedef struct
 {
-	fd_set rset, /**< socket read set (see select doc) */
-		rset_saved; /**< saved socket read set */
+#if defined(SOCKET_USE_SELECT)
+	fd_set rset_saved; /**< saved socket read set */
 	int maxfdp1; /**< max descriptor used +1 (again see select doc) */
+	ListElement* next_clientsds; /**< where the next scan of clientsds starts, so that none starve */
+#elif defined(SOCKET_USE_POLL)
+	struct pollfd* fds; /**< one per client socket */
+	struct pollfd* fds_wait; /**< the copy of fds being polled */
+	int nfds; /**< the number of fds in use */
+	int fds_max; /**< the number of fds allocated */
+	int next_fds; /**< where the next scan of fds_wait starts, so that none starve */
+#else
+	int epfd; /**< the epoll descriptor */
+#endif
 	List* clientsds; /**< list of client socket descriptors */
-	ListElement* cur_clientsds; /**< current client socket descriptor (iterator) */
 	List* connect_pending; /**< list of sockets for which a connect is pending */
 	List* write_pending; /**< list of sockets for which a write is pending */
-	fd_set pending_wset; /**< socket pending write set for select */
+	List* pending_wsds; /**< list of sockets waited on for writing */
+	List* readahead_sds; /**< list of sockets with bytes read ahead, ready without a wait */
+	List* corked_sds; /**< list of sockets with bytes corked, written before any wait */
+	Socket_event events[SOCKET_MAX_EVENTS]; /**< the ready sockets of the last wait */
+	int nevents; /**< the number of events */
+	int cur_event; /**< the next event to return (iterator) */
+	unsigned int closes; /**< count of sockets closed, to spot ones closed while waiting */
 } Sockets;
 
 
 void Socket_outInitialize(void);
 void Socket_outTerminate(void);
 int Socket_getReadySocket(int more_work, struct timeval *tp, mutex_type mutex);
+int Socket_readable(int socket);
 int Socket_getch(int socket, char* c);
 char *Socket_getdata(int socket, size_t bytes, size_t* actual_len);
 int Socket_putdatas(int socket, char* buf0, size_t buf0len, int count, char** buffers, size_t* buflens, int* frees);
@@ -139,6 +189,10 @@ char* Socket_getpeer(int sock);
 void Socket_addPendingWrite(int socket);
 void Socket_clearPendingWrite(int socket);
 
+void Socket_cork(void);
+void Socket_uncork(void);
+void Socket_flush(void);
+
 typedef void Socket_writeComplete(int socket, int rc);
 void Socket_setWriteCompleteCallback(Socket_writeComplete*);
 
@@ -49,6 +49,41 @@ typedef struct
 	char* buf;
 } socket_queue;
 
+#if !defined(SOCKETBUFFER_READAHEAD)
+/** bytes read from a socket in one go, ahead of the packet being read, 0 reads only what is asked for */
+#define SOCKETBUFFER_READAHEAD 1024
+#endif
+
+#if SOCKETBUFFER_READAHEAD > 0
+typedef struct
+{
+	int socket;
+	size_t start, 			/**< offset of the first byte not yet read */
+		end; 				/**< offset after the last byte */
+	char buf[SOCKETBUFFER_READAHEAD];
+} socket_readahead;
+#endif
+
+#if !defined(SOCKETBUFFER_CORK)
+/** bytes a corking thread holds per socket before they are written, 0 writes every packet when it is sent */
+#define SOCKETBUFFER_CORK 0
+#endif
+
+#if !defined(SOCKETBUFFER_CORK_USECS)
+/** the longest the first of the corked bytes waits for the ones after it, in microseconds */
+#define SOCKETBUFFER_CORK_USECS 2000
+#endif
+
+#if SOCKETBUFFER_CORK > 0
+typedef struct
+{
+	int socket;
+	size_t len;				/**< bytes corked */
+	unsigned long start;	/**< clock of the first corked byte, in microseconds */
+	char* buf;				/**< SOCKETBUFFER_CORK bytes, NULL once given to a pending write */
+} socket_cork;
+#endif
+
 typedef struct
 {
 	int socket, count;
@@ -75,6 +110,12 @@ int SocketBuffer_getQueuedChar(int socket, char* c);
 void SocketBuffer_interrupted(int socket, size_t actual_len);
 char* SocketBuffer_complete(int socket);
 void SocketBuffer_queueChar(int socket, char c);
+#if SOCKETBUFFER_READAHEAD > 0
+socket_readahead* SocketBuffer_getReadAhead(int socket);
+#endif
+#if SOCKETBUFFER_CORK > 0
+socket_cork* SocketBuffer_getCork(int socket);
+#endif
 
 #if defined(OPENSSL) || defined(MBEDTLS)
 void SocketBuffer_pendingWrite(int socket, SSL* ssl, int count, iobuf* iovecs, int* frees, size_t total, size_t bytes);
@@ -9,6 +9,8 @@
 #include "iot_log.h"
 #include "iot_main.h"
 #include "iot_profile.h"
+#include "iot_cmd.h"
+#include "iot_shadow.h"
 #include <hi_task.h>
 #include <string.h>
 #include <app_demo_traffic_sample.h>
@@ -35,8 +37,9 @@ extern hi_u32 g_green_led_human_modu_time_count;
 hi_u8 oc_beep_status = BEEP_OFF;
 /*attribute initiative to report */
 #define TAKE_THE_INITIATIVE_TO_REPORT
-/*oc request id*/
-#define CN_COMMADN_INDEX "commands/request_id="
+/*the oc topics routed to the demo, the others go to DemoMsgRcvCallBack*/
+#define CN_DEMO_TOPIC_PROPERTYGET "$oc/devices/" CONFIG_DEVICE_ID "/sys/properties/get/#"
+#define CN_DEMO_TOPIC_COMMAND "$oc/devices/" CONFIG_DEVICE_ID "/sys/commands/#"
 /*oc report HiSpark attribute*/
 #define TRAFFIC_LIGHT_CMD_PAYLOAD "led_value"
 #define TRAFFIC_LIGHT_CMD_CONTROL_MODE "ControlModule"
@@ -51,6 +54,14 @@ hi_u8 oc_beep_status = BEEP_OFF;
 #define TRAFFIC_LIGHT_BEEP_OFF "BEEP_OFF"
 #define TRAFFIC_LIGHT_HUMAN_INTERVENTION_ON "HUMAN_MODULE_ON"
 #define TRAFFIC_LIGHT_HUMAN_INTERVENTION_OFF "HUMAN_MODULE_OFF"
+#define CN_TRAFFIC_CMD_MASK 3
+#define CN_TRAFFIC_CMD_SEED 10
+/*the properties reported within this window go out together*/
+#define CN_REPORT_WINDOW_MS 200
+/*only the changes are reported, the counters at most every 10s, and all of them every 5min*/
+#define CN_SHADOW_MIN_INTERVAL_MS 0
+#define CN_SHADOW_COUNTER_INTERVAL_MS 10000
+#define CN_SHADOW_RESYNC_MS 300000
 
 hi_void oc_traffic_light_app_option(hi_traffic_light_mode app_option_mode, hi_control_mode_type app_option_type)
 {
@@ -74,78 +85,118 @@ hi_void oc_traffic_light_app_option(hi_traffic_light_mode app_option_mode, hi_co
     }
 }
 
-///< this is the callback function, set to the mqtt, and if any messages come, it will be called
+static int TrafficCmdControl(const IoTCmd_t *cmd)
+{
+    g_current_mode = TRAFFIC_CONTROL_MODE;
+    if (IoTCmdHasStrValue(cmd, TRAFFIC_LIGHT_YELLOW_ON_PAYLOAD))
+    { //YELLOW LED
+        g_current_type = YELLOW_ON;
+    }
+    else if (IoTCmdHasStrValue(cmd, TRAFFIC_LIGHT_RED_ON_PAYLOAD))
+    { //RED LED
+        g_current_type = RED_ON;
+    }
+    else if (IoTCmdHasStrValue(cmd, TRAFFIC_LIGHT_GREEN_ON_PAYLOAD))
+    { //GREEN LED
+        g_current_type = GREEN_ON;
+    }
+    oc_traffic_light_app_option(g_current_mode, g_current_type);
+    return 0;
+}
+
+static int TrafficCmdAuto(const IoTCmd_t *cmd)
+{
+    (void)cmd;
+    g_current_mode = TRAFFIC_AUTO_MODE;
+    g_current_type = NULL;
+    oc_traffic_light_app_option(g_current_mode, g_current_type);
+    return 0;
+}
+
+static int TrafficCmdHuman(const IoTCmd_t *cmd)
+{
+    g_current_mode = TRAFFIC_HUMAN_MODE;
+    if (IoTCmdHasStrValue(cmd, TRAFFIC_LIGHT_HUMAN_INTERVENTION_ON))
+    {
+        g_current_type = TRAFFIC_HUMAN_TYPE;
+    }
+    else if (IoTCmdHasStrValue(cmd, TRAFFIC_LIGHT_HUMAN_INTERVENTION_OFF))
+    {
+        g_current_type = TRAFFIC_NORMAL_TYPE;
+    }
+    oc_traffic_light_app_option(g_current_mode, g_current_type);
+    return 0;
+}
+
+static int TrafficCmdBeep(const IoTCmd_t *cmd)
+{
+    if (IoTCmdHasStrValue(cmd, TRAFFIC_LIGHT_BEEP_ON))
+    { //BEEP ON
+        oc_beep_status = BEEP_ON;
+    }
+    else if (IoTCmdHasStrValue(cmd, TRAFFIC_LIGHT_BEEP_OFF))
+    { //BEEP OFF
+        oc_beep_status = BEEP_OFF;
+    }
+    return 0;
+}
+
+///< indexed by IoTCmdHash(name, CN_TRAFFIC_CMD_SEED) & CN_TRAFFIC_CMD_MASK, rerun IoTCmdTableCheck after editing
+static const IoTCmdEntry_t gTrafficCmdEntry[CN_TRAFFIC_CMD_MASK + 1] = {
+    [0] = {TRAFFIC_LIGHT_CMD_HUMAN_MODE,   TrafficCmdHuman},
+    [1] = {TRAFFIC_LIGHT_CMD_AUTO_MODE,    TrafficCmdAuto},
+    [2] = {TRAFFIC_LIGHT_CMD_CONTROL_MODE, TrafficCmdControl},
+    [3] = {TRAFFIC_LIGHT_BEEP_CONTROL,     TrafficCmdBeep},
+};
+
+static const IoTCmdTable_t gTrafficCmdTable = {
+    .entry = gTrafficCmdEntry,
+    .mask = CN_TRAFFIC_CMD_MASK,
+    .seed = CN_TRAFFIC_CMD_SEED,
+};
+
+/*app 下发的操作, 只解析一遍*/
+static void DemoTrafficCmd(const char *payload)
+{
+    IoTCmd_t cmd;
+
+    if ((IoTCmdDecode(payload, &cmd) == 0) && IoTCmdSliceEq(&cmd.serviceID, TRAFFIC_LIGHT_SERVICE_ID_PAYLOAD))
+    { //traffic light module
+        (void)IoTCmdDispatch(&gTrafficCmdTable, &cmd);
+    }
+    return;
+}
+
+///< this is the callback function, set to the mqtt, and if any messages no route takes come, it will be called
 ///< The payload here is the json string
 static void DemoMsgRcvCallBack(int qos, const char *topic, const char *payload)
 {
-    const char *requesID;
-    char *tmp;
-    IoTCmdResp_t resp;
     IOT_LOG_DEBUG("RCVMSG:QOS:%d TOPIC:%s PAYLOAD:%s\r\n", qos, topic, payload);
-    /*app 下发的操作*/
-    if (strstr(payload, TRAFFIC_LIGHT_SERVICE_ID_PAYLOAD) != NULL)
-    { //traffic light module
-        if (strstr(payload, TRAFFIC_LIGHT_CMD_CONTROL_MODE) != NULL)
-        {
-            g_current_mode = TRAFFIC_CONTROL_MODE;
-            if (strstr(payload, TRAFFIC_LIGHT_YELLOW_ON_PAYLOAD) != NULL)
-            { //YELLOW LED
-                g_current_type = YELLOW_ON;
-            }
-            else if (strstr(payload, TRAFFIC_LIGHT_RED_ON_PAYLOAD) != NULL)
-            { //RED LED
-                g_current_type = RED_ON;
-            }
-            else if (strstr(payload, TRAFFIC_LIGHT_GREEN_ON_PAYLOAD) != NULL)
-            { //GREEN LED
-                g_current_type = GREEN_ON;
-            }
-            oc_traffic_light_app_option(g_current_mode, g_current_type);
-        }
-        else if (strstr(payload, TRAFFIC_LIGHT_CMD_AUTO_MODE) != NULL)
-        { //Auto module
-            g_current_mode = TRAFFIC_AUTO_MODE;
-            g_current_type = NULL;
-            oc_traffic_light_app_option(g_current_mode, g_current_type);
-        }
-        else if (strstr(payload, TRAFFIC_LIGHT_CMD_HUMAN_MODE) != NULL)
-        { //Human module
-            g_current_mode = TRAFFIC_HUMAN_MODE;
-            if (strstr(payload, TRAFFIC_LIGHT_HUMAN_INTERVENTION_ON) != NULL)
-            {
-                g_current_type = TRAFFIC_HUMAN_TYPE;
-            }
-            else if (strstr(payload, TRAFFIC_LIGHT_HUMAN_INTERVENTION_OFF))
-            {
-                g_current_type = TRAFFIC_NORMAL_TYPE;
-            }
-            oc_traffic_light_app_option(g_current_mode, g_current_type);
-        }
-        else if (strstr(payload, TRAFFIC_LIGHT_BEEP_CONTROL) != NULL)
-        { //BEEP option
-            if (strstr(payload, TRAFFIC_LIGHT_BEEP_ON) != NULL)
-            { //BEEP ON
-                oc_beep_status = BEEP_ON;
-            }
-            else if (strstr(payload, TRAFFIC_LIGHT_BEEP_OFF) != NULL)
-            { //BEEP OFF
-                oc_beep_status = BEEP_OFF;
-            }
-        }
-    }
+    DemoTrafficCmd(payload);
+    return;
+}
 
-    tmp = strstr(topic, CN_COMMADN_INDEX);
-    if (tmp != NULL)
-    {
-        ///< now you could deal your own works here --THE COMMAND FROM THE PLATFORM
+/*属性查询由影子直接回复*/
+static void DemoPropertyGet(int qos, const char *topic, const char *requestID, const char *payload, void *arg)
+{
+    (void)IoTShadowHandleGet(requestID, payload);
+    return;
+}
 
+///< the command from the platform, the route gives the request id of the topic
+static void DemoCommand(int qos, const char *topic, const char *requestID, const char *payload, void *arg)
+{
+    IoTCmdResp_t resp;
+
+    IOT_LOG_DEBUG("RCVCMD:QOS:%d TOPIC:%s PAYLOAD:%s\r\n", qos, topic, payload);
+    DemoTrafficCmd(payload);
+    if (requestID != NULL)
+    {
         ///< now er roport the command execute result to the platform
-        requesID = tmp + strlen(CN_COMMADN_INDEX);
-        resp.requestID = requesID;
+        resp.requestID = requestID;
         resp.respName = NULL;
         resp.retCode = 0; ////< which means 0 success and others failed
         resp.paras = NULL;
-        // IOT_LOG_DEBUG("respose paras------------------------------ = %s\r\n", resp.paras);
         (void)IoTProfileCmdResp(CONFIG_DEVICE_PWD, &resp);
     }
     return;
@@ -165,7 +216,7 @@ hi_void setup_clean_trfl_status(hi_traffic_light_mode early_mode)
         memset(&service, 0, sizeof(service));
         service.serviceID = "TrafficLight";
         service.serviceProperty = &property;
-        IoTProfilePropertyReport(CONFIG_DEVICE_ID, &service);
+        (void)IoTShadowReport(&service);
     }
     else if (early_mode == TRAFFIC_AUTO_MODE)
     {
@@ -176,7 +227,7 @@ hi_void setup_clean_trfl_status(hi_traffic_light_mode early_mode)
         memset(&service, 0, sizeof(service));
         service.serviceID = "TrafficLight";
         service.serviceProperty = &property;
-        IoTProfilePropertyReport(CONFIG_DEVICE_ID, &service);
+        (void)IoTShadowReport(&service);
     }
     else if (early_mode == TRAFFIC_HUMAN_MODE)
     {
@@ -187,7 +238,7 @@ hi_void setup_clean_trfl_status(hi_traffic_light_mode early_mode)
         memset(&service, 0, sizeof(service));
         service.serviceID = "TrafficLight";
         service.serviceProperty = &property;
-        IoTProfilePropertyReport(CONFIG_DEVICE_ID, &service);
+        (void)IoTShadowReport(&service);
     }
 }
 /*traffic light:1.control module*/
@@ -222,7 +273,7 @@ hi_void setup_trfl_control_module(hi_traffic_light_mode current_mode, hi_control
     memset(&service, 0, sizeof(service));
     service.serviceID = "TrafficLight";
     service.serviceProperty = &property;
-    IoTProfilePropertyReport(CONFIG_DEVICE_ID, &service);
+    (void)IoTShadowReport(&service);
     /*report beep status*/
     memset(&property, 0, sizeof(property));
     property.type = EN_IOT_DATATYPE_STRING;
@@ -238,7 +289,7 @@ hi_void setup_trfl_control_module(hi_traffic_light_mode current_mode, hi_control
     memset(&service, 0, sizeof(service));
     service.serviceID = "TrafficLight";
     service.serviceProperty = &property;
-    IoTProfilePropertyReport(CONFIG_DEVICE_ID, &service);
+    (void)IoTShadowReport(&service);
 }
 /*report light time count*/
 hi_void report_led_light_time_count(hi_void)
@@ -253,7 +304,7 @@ hi_void report_led_light_time_count(hi_void)
     memset(&service, 0, sizeof(service));
     service.serviceID = "TrafficLight";
     service.serviceProperty = &property;
-    IoTProfilePropertyReport(CONFIG_DEVICE_ID, &service);
+    (void)IoTShadowReport(&service);
     /*report yellow led light time count*/
     memset(&property, 0, sizeof(property));
     property.type = EN_IOT_DATATYPE_INT;
@@ -262,7 +313,7 @@ hi_void report_led_light_time_count(hi_void)
     memset(&service, 0, sizeof(service));
     service.serviceID = "TrafficLight";
     service.serviceProperty = &property;
-    IoTProfilePropertyReport(CONFIG_DEVICE_ID, &service);
+    (void)IoTShadowReport(&service);
     /*report green led light time count*/
     memset(&property, 0, sizeof(property));
     property.type = EN_IOT_DATATYPE_INT;
@@ -271,7 +322,7 @@ hi_void report_led_light_time_count(hi_void)
     memset(&service, 0, sizeof(service));
     service.serviceID = "TrafficLight";
     service.serviceProperty = &property;
-    IoTProfilePropertyReport(CONFIG_DEVICE_ID, &service);
+    (void)IoTShadowReport(&service);
 }
 /*traffic light:2.auto module*/
 hi_void setup_trfl_auto_module(hi_traffic_light_mode current_mode, hi_control_mode_type current_type)
@@ -301,7 +352,7 @@ hi_void setup_trfl_auto_module(hi_traffic_light_mode current_mode, hi_control_mo
     memset(&service, 0, sizeof(service));
     service.serviceID = "TrafficLight";
     service.serviceProperty = &property;
-    IoTProfilePropertyReport(CONFIG_DEVICE_ID, &service);
+    (void)IoTShadowReport(&service);
     /*report light time count*/
     report_led_light_time_count();
 }
@@ -333,7 +384,7 @@ hi_void setup_trfl_human_module(hi_traffic_light_mode current_mode, hi_control_m
     memset(&service, 0, sizeof(service));
     service.serviceID = "TrafficLight";
     service.serviceProperty = &property;
-    IoTProfilePropertyReport(CONFIG_DEVICE_ID, &service);
+    (void)IoTShadowReport(&service);
 
     /*red led light time count*/
     memset(&property, 0, sizeof(property));
@@ -343,7 +394,7 @@ hi_void setup_trfl_human_module(hi_traffic_light_mode current_mode, hi_control_m
     memset(&service, 0, sizeof(service));
     service.serviceID = "TrafficLight";
     service.serviceProperty = &property;
-    IoTProfilePropertyReport(CONFIG_DEVICE_ID, &service);
+    (void)IoTShadowReport(&service);
     /*yellow led light time count*/
     memset(&property, 0, sizeof(property));
     property.type = EN_IOT_DATATYPE_INT;
@@ -352,7 +403,7 @@ hi_void setup_trfl_human_module(hi_traffic_light_mode current_mode, hi_control_m
     memset(&service, 0, sizeof(service));
     service.serviceID = "TrafficLight";
     service.serviceProperty = &property;
-    IoTProfilePropertyReport(CONFIG_DEVICE_ID, &service);
+    (void)IoTShadowReport(&service);
     /*green led light time count*/
     memset(&property, 0, sizeof(property));
     property.type = EN_IOT_DATATYPE_INT;
@@ -361,7 +412,7 @@ hi_void setup_trfl_human_module(hi_traffic_light_mode current_mode, hi_control_m
     memset(&service, 0, sizeof(service));
     service.serviceID = "TrafficLight";
     service.serviceProperty = &property;
-    IoTProfilePropertyReport(CONFIG_DEVICE_ID, &service);
+    (void)IoTShadowReport(&service);
 }
 
 /*call back func and report status to huawei ocean cloud*/
@@ -382,6 +433,8 @@ hi_void oc_traffic_light_status_report(hi_traffic_light_mode current_mode, oc_tr
     default:
         break;
     }
+    /*the status of one refresh goes out in one report*/
+    (void)IoTProfileReportFlush(HI_TRUE);
     return HI_NULL;
 }
 
@@ -400,6 +453,16 @@ static hi_void *DemoEntry(hi_void *arg)
     cJsonInit();
 
     IoTMain();
+    (void)IoTProfileReportInit(CONFIG_DEVICE_ID, CN_REPORT_WINDOW_MS, CN_PROFILE_REPORT_SIZECAP);
+    (void)IoTShadowInit(CN_SHADOW_MIN_INTERVAL_MS, CN_SHADOW_RESYNC_MS);
+    (void)IoTShadowSetMinInterval("TrafficLight", "AutoModuleRLedTC", CN_SHADOW_COUNTER_INTERVAL_MS);
+    (void)IoTShadowSetMinInterval("TrafficLight", "AutoModuleYLedTC", CN_SHADOW_COUNTER_INTERVAL_MS);
+    (void)IoTShadowSetMinInterval("TrafficLight", "AutoModuleGLedTC", CN_SHADOW_COUNTER_INTERVAL_MS);
+    (void)IoTShadowSetMinInterval("TrafficLight", "HumanModuleRledTC", CN_SHADOW_COUNTER_INTERVAL_MS);
+    (void)IoTShadowSetMinInterval("TrafficLight", "HumanModuleYledTC", CN_SHADOW_COUNTER_INTERVAL_MS);
+    (void)IoTShadowSetMinInterval("TrafficLight", "HumanModuleGledTC", CN_SHADOW_COUNTER_INTERVAL_MS);
+    (void)IoTSetMsgRoute(CN_DEMO_TOPIC_PROPERTYGET, DemoPropertyGet, NULL);
+    (void)IoTSetMsgRoute(CN_DEMO_TOPIC_COMMAND, DemoCommand, NULL);
     IoTSetMsgCallback(DemoMsgRcvCallBack);
 /*主动上报*/
 #ifdef TAKE_THE_INITIATIVE_TO_REPORT
@@ -428,6 +491,9 @@ static hi_void *DemoEntry(hi_void *arg)
                 break;
             }
         }
+        /*the changes hold back by the min interval go out when they are due, in every menu*/
+        (void)IoTShadowPoll();
+        (void)IoTProfileReportFlush(HI_TRUE);
     }
 #endif
     return NULL;
@@ -0,0 +1,336 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: IoT platform command decoder and dispatcher
+ * Author: HiSpark Product Team.
+ * Create: 2020-5-20
+ */
+
+#include "iot_cmd.h"
+#include <string.h>
+
+#define CN_IOT_CMD_KEY_SERVICEID "service_id"
+#define CN_IOT_CMD_KEY_CMDNAME   "command_name"
+#define CN_IOT_CMD_KEY_PARAS     "paras"
+
+#define CN_IOT_CMD_FNV_PRIME 16777619U
+
+#define CN_IOT_CMD_NUM_MAX 2147483647U ///< the magnitude of hi_s32, one more when negative
+
+static hi_bool IsWs(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+
+static const char *SkipWs(const char *p)
+{
+    while (IsWs(*p))
+    {
+        p++;
+    }
+    return p;
+}
+
+///< p points to the '"', return the position after the closing '"' or NULL
+static const char *ParseString(const char *p, IoTCmdSlice_t *slice)
+{
+    const char *start = ++p;
+
+    while (*p != '"')
+    {
+        if (*p == '\0')
+        {
+            return NULL;
+        }
+        if ((*p == '\\') && (p[1] != '\0'))
+        {
+            p++; ///< the escapes are kept as they are in the slice
+        }
+        p++;
+    }
+    if (slice != NULL)
+    {
+        slice->str = start;
+        slice->len = (hi_u16)(p - start);
+    }
+    return p + 1;
+}
+
+///< only the integer part is kept, the fraction and exponent are skipped; NULL if it does not fit in hi_s32
+static const char *ParseNumber(const char *p, hi_s32 *num)
+{
+    hi_u32 val = 0;
+    hi_u32 max = CN_IOT_CMD_NUM_MAX;
+    hi_u32 digit;
+    hi_bool neg = HI_FALSE;
+
+    if (*p == '-')
+    {
+        neg = HI_TRUE;
+        max++;
+        p++;
+    }
+    while ((*p >= '0') && (*p <= '9'))
+    {
+        digit = (hi_u32)(*p - '0');
+        if (val > (max - digit) / 10)
+        {
+            return NULL; ///< the para is skipped as if it was not there
+        }
+        val = val * 10 + digit;
+        p++;
+    }
+    while ((*p == '.') || (*p == 'e') || (*p == 'E') || (*p == '+') || (*p == '-') || ((*p >= '0') && (*p <= '9')))
+    {
+        p++;
+    }
+    *num = neg ? (-(hi_s32)(val - 1) - 1) : (hi_s32)val;
+    return p;
+}
+
+///< skip any value, including the nested object and array
+static const char *SkipValue(const char *p)
+{
+    hi_u32 depth = 0;
+
+    do
+    {
+        p = SkipWs(p);
+        if (*p == '"')
+        {
+            p = ParseString(p, NULL);
+            if (p == NULL)
+            {
+                return NULL;
+            }
+        }
+        else if ((*p == '{') || (*p == '['))
+        {
+            depth++;
+            p++;
+        }
+        else if ((*p == '}') || (*p == ']'))
+        {
+            if (depth == 0)
+            {
+                return p;
+            }
+            depth--;
+            p++;
+        }
+        else if (*p == '\0')
+        {
+            return NULL;
+        }
+        else if ((*p == ',') || (*p == ':'))
+        {
+            if (depth == 0)
+            {
+                return p;
+            }
+            p++;
+        }
+        else
+        {
+            while ((*p != '\0') && (*p != ',') && (*p != '}') && (*p != ']') && !IsWs(*p))
+            {
+                p++;
+            }
+        }
+    } while (depth > 0);
+
+    return p;
+}
+
+///< p points to the value of a member
+static const char *ParseParaValue(const char *p, IoTCmdPara_t *para)
+{
+    if (*p == '"')
+    {
+        para->isStr = HI_TRUE;
+        return ParseString(p, &para->str);
+    }
+    if ((*p == '-') || ((*p >= '0') && (*p <= '9')))
+    {
+        para->isStr = HI_FALSE;
+        return ParseNumber(p, &para->num);
+    }
+    return NULL;
+}
+
+///< the members of an object, p points to the '{'; cmd NULL means the paras object
+static const char *ParseObject(const char *p, IoTCmd_t *cmd, IoTCmd_t *parasOwner)
+{
+    IoTCmdSlice_t key;
+    const char *next;
+
+    p = SkipWs(p + 1);
+    if (*p == '}')
+    {
+        return p + 1;
+    }
+    while (1)
+    {
+        if (*p != '"')
+        {
+            return NULL;
+        }
+        p = ParseString(p, &key);
+        if (p == NULL)
+        {
+            return NULL;
+        }
+        p = SkipWs(p);
+        if (*p != ':')
+        {
+            return NULL;
+        }
+        p = SkipWs(p + 1);
+
+        next = NULL;
+        if (parasOwner != NULL)
+        {
+            if (parasOwner->paraNum < CN_IOT_CMD_PARANUM)
+            {
+                parasOwner->para[parasOwner->paraNum].key = key;
+                next = ParseParaValue(p, &parasOwner->para[parasOwner->paraNum]);
+                if (next != NULL)
+                {
+                    parasOwner->paraNum++;
+                }
+            }
+        }
+        else if ((*p == '"') && IoTCmdSliceEq(&key, CN_IOT_CMD_KEY_SERVICEID))
+        {
+            next = ParseString(p, &cmd->serviceID);
+        }
+        else if ((*p == '"') && IoTCmdSliceEq(&key, CN_IOT_CMD_KEY_CMDNAME))
+        {
+            next = ParseString(p, &cmd->cmdName);
+        }
+        else if ((*p == '{') && IoTCmdSliceEq(&key, CN_IOT_CMD_KEY_PARAS))
+        {
+            next = ParseObject(p, NULL, cmd);
+        }
+        p = (next != NULL) ? next : SkipValue(p);
+        if (p == NULL)
+        {
+            return NULL;
+        }
+
+        p = SkipWs(p);
+        if (*p == '}')
+        {
+            return p + 1;
+        }
+        if (*p != ',')
+        {
+            return NULL;
+        }
+        p = SkipWs(p + 1);
+    }
+}
+
+int IoTCmdDecode(const char *payload, IoTCmd_t *cmd)
+{
+    const char *p;
+
+    if ((NULL == payload) || (NULL == cmd))
+    {
+        return -1;
+    }
+    (void)memset(cmd, 0, sizeof(IoTCmd_t));
+
+    p = SkipWs(payload);
+    if (*p != '{')
+    {
+        return -1;
+    }
+    return (ParseObject(p, cmd, NULL) != NULL) ? 0 : -1;
+}
+
+hi_bool IoTCmdSliceEq(const IoTCmdSlice_t *slice, const char *str)
+{
+    hi_u32 len = strlen(str);
+
+    return (slice->str != NULL) && (slice->len == len) && (memcmp(slice->str, str, len) == 0);
+}
+
+const IoTCmdPara_t *IoTCmdGetPara(const IoTCmd_t *cmd, const char *key)
+{
+    hi_u8 i;
+
+    for (i = 0; i < cmd->paraNum; i++)
+    {
+        if (IoTCmdSliceEq(&cmd->para[i].key, key))
+        {
+            return &cmd->para[i];
+        }
+    }
+    return NULL;
+}
+
+hi_s32 IoTCmdGetParaInt(const IoTCmd_t *cmd, const char *key, hi_s32 dft)
+{
+    const IoTCmdPara_t *para = IoTCmdGetPara(cmd, key);
+
+    return ((para != NULL) && (!para->isStr)) ? para->num : dft;
+}
+
+hi_bool IoTCmdHasStrValue(const IoTCmd_t *cmd, const char *value)
+{
+    hi_u8 i;
+
+    for (i = 0; i < cmd->paraNum; i++)
+    {
+        if (cmd->para[i].isStr && IoTCmdSliceEq(&cmd->para[i].str, value))
+        {
+            return HI_TRUE;
+        }
+    }
+    return HI_FALSE;
+}
+
+///< FNV-1a with the seed as the offset basis, folded so the low bits see the whole name
+hi_u32 IoTCmdHash(const char *str, hi_u32 len, hi_u32 seed)
+{
+    hi_u32 v = seed;
+    hi_u32 i;
+
+    for (i = 0; i < len; i++)
+    {
+        v = (v ^ (hi_u8)str[i]) * CN_IOT_CMD_FNV_PRIME;
+    }
+    return v ^ (v >> 16);
+}
+
+int IoTCmdDispatch(const IoTCmdTable_t *table, const IoTCmd_t *cmd)
+{
+    const IoTCmdEntry_t *entry;
+
+    if (cmd->cmdName.str == NULL)
+    {
+        return -1;
+    }
+    entry = &table->entry[IoTCmdHash(cmd->cmdName.str, cmd->cmdName.len, table->seed) & table->mask];
+    if ((entry->name == NULL) || (!IoTCmdSliceEq(&cmd->cmdName, entry->name)))
+    {
+        return -1;
+    }
+    return entry->handler(cmd);
+}
+
+int IoTCmdTableCheck(const IoTCmdTable_t *table)
+{
+    hi_u32 i;
+    const char *name;
+
+    for (i = 0; i <= table->mask; i++)
+    {
+        name = table->entry[i].name;
+        if ((name != NULL) && ((IoTCmdHash(name, strlen(name), table->seed) & table->mask) != i))
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
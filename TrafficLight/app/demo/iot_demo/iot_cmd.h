@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: IoT platform command decoder and dispatcher
+ * Author: HiSpark Product Team.
+ * Create: 2020-5-20
+ */
+#ifndef IOT_CMD_H_
+#define IOT_CMD_H_
+
+#include <hi_types_base.h>
+
+#define CN_IOT_CMD_PARANUM 4 ///< the paras after this are ignored
+
+///< a piece of the payload, not ended with '\0'
+typedef struct
+{
+    const char *str;
+    hi_u16 len;
+} IoTCmdSlice_t;
+
+typedef struct
+{
+    IoTCmdSlice_t key;
+    IoTCmdSlice_t str;    ///< the string value, valid when isStr
+    hi_s32 num;           ///< the integer part of a number value, valid when not isStr
+    hi_bool isStr;
+} IoTCmdPara_t;
+
+/**
+ * The platform command looks like:
+ * {"service_id":"CAR_CTRL","command_name":"GO_FORWARD","paras":{"DURATION":1000}}
+ * All the fields point into the payload, which is not modified and must outlive the command.
+*/
+typedef struct
+{
+    IoTCmdSlice_t serviceID;
+    IoTCmdSlice_t cmdName;
+    hi_u8 paraNum;
+    IoTCmdPara_t para[CN_IOT_CMD_PARANUM];
+} IoTCmd_t;
+
+typedef int (*IoTCmdHandler)(const IoTCmd_t *cmd);
+
+typedef struct
+{
+    const char *name;     ///< the command_name, NULL for the empty slot
+    IoTCmdHandler handler;
+} IoTCmdEntry_t;
+
+/**
+ * The entries are placed at IoTCmdHash(name, seed) & mask, the seed is chosen offline so that
+ * every known name gets its own slot, so a lookup is one hash and one compare.
+*/
+typedef struct
+{
+    const IoTCmdEntry_t *entry; ///< mask + 1 entries
+    hi_u32 mask;
+    hi_u32 seed;
+} IoTCmdTable_t;
+
+/**
+ * Decode the payload in one pass
+ *
+ * @return 0 success while others failed(not a json object)
+*/
+int IoTCmdDecode(const char *payload, IoTCmd_t *cmd);
+
+/**
+ * @return HI_TRUE if the slice equals to the string
+*/
+hi_bool IoTCmdSliceEq(const IoTCmdSlice_t *slice, const char *str);
+
+/**
+ * @return the para with the key, or NULL
+*/
+const IoTCmdPara_t *IoTCmdGetPara(const IoTCmd_t *cmd, const char *key);
+
+/**
+ * @return the number value of the para with the key, or dft if not found or out of the range of hi_s32
+*/
+hi_s32 IoTCmdGetParaInt(const IoTCmd_t *cmd, const char *key, hi_s32 dft);
+
+/**
+ * @return HI_TRUE if any para has the string value, for the paras whose key does not matter
+*/
+hi_bool IoTCmdHasStrValue(const IoTCmd_t *cmd, const char *value);
+
+hi_u32 IoTCmdHash(const char *str, hi_u32 len, hi_u32 seed);
+
+/**
+ * Call the handler of the command_name
+ *
+ * @return the handler return, or -1 if the command_name is unknown
+*/
+int IoTCmdDispatch(const IoTCmdTable_t *table, const IoTCmd_t *cmd);
+
+/**
+ * Check every entry sits in its hash slot, use it after the table has been edited
+ *
+ * @return 0 success while others failed
+*/
+int IoTCmdTableCheck(const IoTCmdTable_t *table);
+
+#endif /* IOT_CMD_H_ */
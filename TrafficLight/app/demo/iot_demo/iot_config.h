@@ -25,6 +25,13 @@
 // #define CONFIG_MQTT_SSL                  ///< which means use the tls
 // #define CONFIG_MQTT_SSL_X509             ///< which means use the x509 mode, and must enable the SSL; if both disabled, it means use the tcp mode
 
+///< the sync client sends one publish at a time; the async one keeps up to CONFIG_MQTT_INFLIGHT on the way
+// #define CONFIG_MQTT_ASYNC                ///< which means use the MQTTAsync client instead of MQTTClient
+#define CONFIG_MQTT_INFLIGHT 8              ///< the async inflight window, must be less than the IoT queue depth
+
+///< MQTT 5 sends the topics the device publishes often as 2 byte aliases, if the server takes them
+// #define CONFIG_MQTT_V5                   ///< which means connect with MQTT 5 instead of 3.1.1
+
 /*app_demo_iot entery function */
 int app_demo_iot(void);
 #endif
\ No newline at end of file
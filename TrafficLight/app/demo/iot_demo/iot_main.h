@@ -11,6 +11,20 @@
 
 typedef void  (*fnMsgCallBack)(int qos, const char *topic, const char *payload);
 
+/**
+ * The callback of a route: requestID is the value of the "request_id=" level of the topic,
+ * NULL if it has none, arg is as given to IoTSetMsgRoute
+*/
+typedef void (*fnMsgRouteCallBack)(int qos, const char *topic, const char *requestID, const char *payload, void *arg);
+
+/**
+ * The publish is done: result 0 means it has been sent (qos 0) or acknowledged (qos 1),
+ * others mean it failed after the retries
+*/
+typedef void (*fnPubCallBack)(void *arg, int result);
+
+typedef void (*fnDueCallBack)(void);
+
 /**
  * This is the iot main function. Please call this function first
  * 
@@ -24,6 +38,25 @@ int IoTMain(void);
 */
 int IoTSetMsgCallback(fnMsgCallBack msgCallback);
 
+/**
+ * Use this function to route the messages of a topic filter to their own callback, the filter
+ * may have the '+' and '#' wildcards. A message goes to the route of every filter it matches,
+ * and to the message callback only if it matches none. Call it after IoTMain
+ * @param filter: kept by reference, so use the constant strings
+ *
+ * @return 0 success while others failed
+*/
+int IoTSetMsgRoute(const char *filter, fnMsgRouteCallBack routeCallback, void *arg);
+
+/**
+ * Have the IoTMain task call dueCallback once, delayMs from now, for the work that has a deadline
+ * but nothing else to wake it up. There is one of it, a later call replaces the earlier one. It is
+ * called while connected, as the messages could not go out anyway before
+ *
+ * @return 0 success while others failed
+*/
+int IoTSetDueCallback(fnDueCallBack dueCallback, uint32_t delayMs);
+
 /**
  * When you want to send some messages to the iot server(including the response message),
  * please call this api
@@ -37,4 +70,73 @@ int IoTSetMsgCallback(fnMsgCallBack msgCallback);
 */
 int IotSendMsg(int qos, const char *topic, const char *payload);
 
+/**
+ * Same as IotSendMsg, and pubCallback is called in the IoTMain task when the message is done.
+ * At most the inflight window of messages are on the way; when it is full the call waits for
+ * a place, and fails if none comes within the queue timeout
+ *
+ * @return 0 success while others failed
+*/
+int IotSendMsgEx(int qos, const char *topic, const char *payload, fnPubCallBack pubCallback, void *arg);
+
+typedef struct
+{
+    uint16_t capacity;   ///< slots in the message store, equals to the queue depth
+    uint16_t slotSize;   ///< the max bytes of message header + topic + payload
+    uint16_t used;       ///< slots in use now
+    uint16_t highWater;  ///< the max slots ever in use
+    uint32_t total;      ///< messages put to the queue since start
+    uint32_t drops;      ///< messages dropped because no slot, no heap or the queue is full
+    uint32_t oversize;   ///< messages larger than a slot, put on the heap instead
+} IoTMsgStat_t;
+
+/**
+ * Use this function to get the occupancy and drop counters of the message queue
+ *
+ * @return 0 success while others failed
+*/
+int IoTGetMsgStat(IoTMsgStat_t *stat);
+
+typedef struct
+{
+    uint32_t connectCnt;       ///< connects done, the first one included
+    uint32_t failCnt;          ///< connect attempts failed
+    uint32_t reconnectCnt;     ///< connects done after a connection lost
+    uint32_t resumeCnt;        ///< connects where the server kept the session, so no resubscribe
+    uint32_t resolveCnt;       ///< times the server name was resolved
+    uint32_t lastConnectMs;    ///< the time the last connect took, the tls handshake included
+    uint32_t lastReconnectMs;  ///< from the last connection lost to connected again
+    uint32_t maxReconnectMs;   ///< the longest outage ever
+} IoTConnStat_t;
+
+/**
+ * Use this function to get the connect counters and the reconnect time
+ *
+ * @return 0 success while others failed
+*/
+int IoTGetConnStat(IoTConnStat_t *stat);
+
+typedef struct
+{
+    uint32_t window;         ///< publishes allowed on the way at the same time
+    uint32_t inflight;       ///< publishes handed to the async client and not done yet
+    uint32_t highWater;      ///< the max inflight ever
+    uint32_t okCnt;          ///< publishes done
+    uint32_t failCnt;        ///< publishes failed after the retries
+    uint32_t retryCnt;       ///< publishes sent again
+    uint32_t busyCnt;        ///< IotSendMsg failed because the window stayed full
+    uint32_t lastLatencyUs;  ///< from IotSendMsg to done of the last publish
+    uint32_t maxLatencyUs;
+    uint32_t packetCnt;      ///< PUBLISH packets paho sent, the retries included
+    uint32_t aliasedCnt;     ///< of them, those with an MQTT 5 topic alias in place of the topic
+    uint64_t packetBytes;    ///< their bytes on air, from the MQTT fixed header to the payload
+} IoTPubStat_t;
+
+/**
+ * Use this function to get the publish counters and latency
+ *
+ * @return 0 success while others failed
+*/
+int IoTGetPubStat(IoTPubStat_t *stat);
+
 #endif /* IOT_MAIN_H_ */
\ No newline at end of file
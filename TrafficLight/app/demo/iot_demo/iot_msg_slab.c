@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: fixed-capacity message slab for the IoT main queue
+ * Author: HiSpark Product Team.
+ * Create: 2020-5-20
+ */
+
+#include "iot_msg_slab.h"
+#include <hi_task.h>
+#include <hi_mem.h>
+#include <stddef.h>
+
+///< the critical sections here are a few instructions long, so we just lock the task switch
+#define SLAB_LOCK()   hi_task_lock()
+#define SLAB_UNLOCK() hi_task_unlock()
+
+int IoTMsgSlabInit(IoTMsgSlab_t *slab, hi_pvoid mem, hi_u16 *freeList, hi_u16 slotSize, hi_u16 slotNum)
+{
+    hi_u16 i;
+
+    if ((NULL == slab) || (NULL == mem) || (NULL == freeList) || (0 == slotSize) || (0 == slotNum)) {
+        return -1;
+    }
+
+    slab->mem = (hi_u8 *)mem;
+    slab->freeList = freeList;
+    slab->slotSize = slotSize;
+    slab->slotNum = slotNum;
+    slab->highWater = 0;
+    slab->allocCnt = 0;
+    slab->dropCnt = 0;
+    slab->oversizeCnt = 0;
+    ///< pop from the tail, so the slot 0 will be used first
+    for (i = 0; i < slotNum; i++) {
+        freeList[i] = slotNum - 1 - i;
+    }
+    slab->freeNum = slotNum;
+
+    return 0;
+}
+
+hi_pvoid IoTMsgSlabAlloc(IoTMsgSlab_t *slab, hi_u32 size)
+{
+    hi_pvoid ret = NULL;
+    hi_u16 used;
+
+    if (size > slab->slotSize) {
+        ret = hi_malloc(0, size);
+        SLAB_LOCK();
+        slab->oversizeCnt++;
+        if (ret == NULL) {
+            slab->dropCnt++;
+        }
+        SLAB_UNLOCK();
+        return ret;
+    }
+
+    SLAB_LOCK();
+    if (slab->freeNum > 0) {
+        slab->freeNum--;
+        ret = slab->mem + (hi_u32)slab->freeList[slab->freeNum] * slab->slotSize;
+        slab->allocCnt++;
+        used = slab->slotNum - slab->freeNum;
+        if (used > slab->highWater) {
+            slab->highWater = used;
+        }
+    } else {
+        slab->dropCnt++;
+    }
+    SLAB_UNLOCK();
+
+    return ret;
+}
+
+hi_void IoTMsgSlabFree(IoTMsgSlab_t *slab, hi_pvoid slot)
+{
+    hi_u32 offset;
+
+    if (NULL == slot) {
+        return;
+    }
+    if (((hi_u8 *)slot < slab->mem) || ((hi_u8 *)slot >= (slab->mem + (hi_u32)slab->slotNum * slab->slotSize))) {
+        ///< not one of the slots, so an oversize message from the heap
+        hi_free(0, slot);
+        return;
+    }
+    offset = (hi_u32)((hi_u8 *)slot - slab->mem);
+
+    SLAB_LOCK();
+    if (slab->freeNum < slab->slotNum) {
+        slab->freeList[slab->freeNum] = (hi_u16)(offset / slab->slotSize);
+        slab->freeNum++;
+    }
+    SLAB_UNLOCK();
+
+    return;
+}
+
+hi_void IoTMsgSlabGetStat(IoTMsgSlab_t *slab, IoTMsgSlabStat_t *stat)
+{
+    SLAB_LOCK();
+    stat->slotSize = slab->slotSize;
+    stat->slotNum = slab->slotNum;
+    stat->used = slab->slotNum - slab->freeNum;
+    stat->highWater = slab->highWater;
+    stat->allocCnt = slab->allocCnt;
+    stat->dropCnt = slab->dropCnt;
+    stat->oversizeCnt = slab->oversizeCnt;
+    SLAB_UNLOCK();
+
+    return;
+}
@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: write the IoT platform messages into the caller buffer
+ * Author: HiSpark Product Team.
+ * Create: 2020-5-20
+ */
+
+/**
+ * The messages have fixed shapes, so the keys and the punctuation between them are constant
+ * pieces known at compile time; only the values are formatted here. Nothing is allocated and
+ * the output is the same as the cJSON tree printed unformatted.
+*/
+#include "iot_profile_fmt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    char *buf;
+    hi_u32 size;
+    hi_u32 len;
+    hi_bool bad;          ///< overflow or bad value, the output is useless
+} FmtWriter_t;
+
+#define FMT_PUT_LIT(w, lit) FmtPut((w), (lit), sizeof(lit) - 1)
+
+typedef struct
+{
+    const char *full;     ///< for CONFIG_DEVICE_ID
+    hi_u32 fullLen;
+    const char *suffix;   ///< after the device id
+    hi_u32 suffixLen;
+} FmtTopic_t;
+
+#define FMT_TOPIC(suffix) {CN_PROFILE_TOPIC_PREFIX suffix, sizeof(CN_PROFILE_TOPIC_PREFIX suffix) - 1, \
+    suffix, sizeof(suffix) - 1}
+static const FmtTopic_t gFmtTopic[EN_PROFILE_TOPIC_LAST] = {
+    [EN_PROFILE_TOPIC_PROPERTYREPORT] = FMT_TOPIC("/sys/properties/report"),
+    [EN_PROFILE_TOPIC_PROPERTYGETRESP] = FMT_TOPIC("/sys/properties/get/response/request_id="),
+    [EN_PROFILE_TOPIC_CMDRESP] = FMT_TOPIC("/sys/commands/response/request_id="),
+    [EN_PROFILE_TOPIC_EVENTREPORT] = FMT_TOPIC("/sys/events/up"),
+};
+
+static hi_void FmtPut(FmtWriter_t *w, const char *str, hi_u32 len)
+{
+    if (w->bad || (len >= w->size - w->len))
+    {
+        w->bad = HI_TRUE;
+        return;
+    }
+    (void)memcpy(w->buf + w->len, str, len);
+    w->len += len;
+    return;
+}
+
+///< escape the string the way cJSON prints it, the plain runs are copied at once
+static hi_void FmtPutString(FmtWriter_t *w, const char *str)
+{
+    const char *run;
+    char esc[7]; ///< \u00xx
+    hi_u8 c;
+
+    if (NULL == str)
+    {
+        w->bad = HI_TRUE;
+        return;
+    }
+    FMT_PUT_LIT(w, "\"");
+    while (*str != '\0')
+    {
+        run = str;
+        while (((hi_u8)*str >= 32) && (*str != '"') && (*str != '\\'))
+        {
+            str++;
+        }
+        FmtPut(w, run, (hi_u32)(str - run));
+        c = (hi_u8)*str;
+        if (c == '\0')
+        {
+            break;
+        }
+        switch (c)
+        {
+            case '"':
+                FMT_PUT_LIT(w, "\\\"");
+                break;
+            case '\\':
+                FMT_PUT_LIT(w, "\\\\");
+                break;
+            case '\b':
+                FMT_PUT_LIT(w, "\\b");
+                break;
+            case '\f':
+                FMT_PUT_LIT(w, "\\f");
+                break;
+            case '\n':
+                FMT_PUT_LIT(w, "\\n");
+                break;
+            case '\r':
+                FMT_PUT_LIT(w, "\\r");
+                break;
+            case '\t':
+                FMT_PUT_LIT(w, "\\t");
+                break;
+            default:
+                (void)snprintf(esc, sizeof(esc), "\\u%04x", c);
+                FmtPut(w, esc, sizeof(esc) - 1);
+                break;
+        }
+        str++;
+    }
+    FMT_PUT_LIT(w, "\"");
+    return;
+}
+
+///< the same digits as cJSON: integers as they are, -0 as 0 too, others with %1.15g unless it loses precision
+static hi_void FmtPutNumber(FmtWriter_t *w, double d)
+{
+    char num[26];
+    char *p = &num[sizeof(num)];
+    hi_u64 u;
+    int len;
+
+    if ((d * 0) != 0)
+    {
+        FMT_PUT_LIT(w, "null");
+        return;
+    }
+    if ((d > -1e15) && (d < 1e15) && (d == (double)(hi_s64)d))
+    {
+        u = (d < 0) ? (hi_u64)(-d) : (hi_u64)d;
+        do
+        {
+            *--p = (char)('0' + (u % 10));
+            u /= 10;
+        } while (u != 0);
+        if (d < 0)
+        {
+            *--p = '-';
+        }
+        FmtPut(w, p, (hi_u32)(&num[sizeof(num)] - p));
+        return;
+    }
+    len = snprintf(num, sizeof(num), "%1.15g", d);
+    if (strtod(num, NULL) != d)
+    {
+        len = snprintf(num, sizeof(num), "%1.17g", d);
+    }
+    if ((len < 0) || (len >= (int)sizeof(num)))
+    {
+        w->bad = HI_TRUE;
+        return;
+    }
+    FmtPut(w, num, (hi_u32)len);
+    return;
+}
+
+///< {"key":value,...}
+static hi_void FmtPutKvs(FmtWriter_t *w, IoTProfileKV_t *kv)
+{
+    double num;
+
+    FMT_PUT_LIT(w, "{");
+    for (; NULL != kv; kv = kv->nxt)
+    {
+        FmtPutString(w, kv->key);
+        FMT_PUT_LIT(w, ":");
+        if (IoTProfileKvNumber(kv, &num))
+        {
+            FmtPutNumber(w, num);
+        }
+        else if (EN_IOT_DATATYPE_STRING == kv->type)
+        {
+            FmtPutString(w, kv->value);
+        }
+        else
+        {
+            w->bad = HI_TRUE;
+        }
+        if (NULL != kv->nxt)
+        {
+            FMT_PUT_LIT(w, ",");
+        }
+    }
+    FMT_PUT_LIT(w, "}");
+    return;
+}
+
+static int FmtEnd(FmtWriter_t *w)
+{
+    if (w->bad || (w->len >= w->size))
+    {
+        if (w->size > 0)
+        {
+            w->buf[0] = '\0';
+        }
+        return -1;
+    }
+    w->buf[w->len] = '\0';
+    return (int)w->len;
+}
+
+int IoTProfileFmtTopic(char *buf, hi_u32 size, IoTProfileTopic_t topic, const char *deviceID, const char *requestID)
+{
+    FmtWriter_t w = {buf, size, 0, HI_FALSE};
+    const FmtTopic_t *fmt;
+
+    if ((NULL == buf) || (topic >= EN_PROFILE_TOPIC_LAST))
+    {
+        return -1;
+    }
+    fmt = &gFmtTopic[topic];
+    if ((NULL == deviceID) || (0 == strcmp(deviceID, CONFIG_DEVICE_ID)))
+    {
+        FmtPut(&w, fmt->full, fmt->fullLen);
+    }
+    else
+    {
+        FMT_PUT_LIT(&w, "$oc/devices/");
+        FmtPut(&w, deviceID, strlen(deviceID));
+        FmtPut(&w, fmt->suffix, fmt->suffixLen);
+    }
+    if (NULL != requestID)
+    {
+        FmtPut(&w, requestID, strlen(requestID));
+    }
+    return FmtEnd(&w);
+}
+
+int IoTProfileFmtPropertyReport(char *buf, hi_u32 size, IoTProfileService_t *payload)
+{
+    FmtWriter_t w = {buf, size, 0, HI_FALSE};
+    IoTProfileService_t *service;
+
+    if (NULL == buf)
+    {
+        return -1;
+    }
+    FMT_PUT_LIT(&w, "{\"services\":[");
+    for (service = payload; NULL != service; service = service->nxt)
+    {
+        FMT_PUT_LIT(&w, "{\"service_id\":");
+        FmtPutString(&w, service->serviceID);
+        FMT_PUT_LIT(&w, ",\"properties\":");
+        FmtPutKvs(&w, service->serviceProperty);
+        if (NULL != service->eventTime)
+        {
+            FMT_PUT_LIT(&w, ",\"event_time\":");
+            FmtPutString(&w, service->eventTime);
+        }
+        FMT_PUT_LIT(&w, "}");
+        if (NULL != service->nxt)
+        {
+            FMT_PUT_LIT(&w, ",");
+        }
+    }
+    FMT_PUT_LIT(&w, "]}");
+    return FmtEnd(&w);
+}
+
+int IoTProfileFmtCmdResp(char *buf, hi_u32 size, IoTCmdResp_t *payload)
+{
+    FmtWriter_t w = {buf, size, 0, HI_FALSE};
+
+    if ((NULL == buf) || (NULL == payload))
+    {
+        return -1;
+    }
+    FMT_PUT_LIT(&w, "{\"result_code\":");
+    FmtPutNumber(&w, payload->retCode);
+    if (NULL != payload->respName)
+    {
+        FMT_PUT_LIT(&w, ",\"response_name\":");
+        FmtPutString(&w, payload->respName);
+    }
+    if (NULL != payload->paras)
+    {
+        FMT_PUT_LIT(&w, ",\"paras\":");
+        FmtPutKvs(&w, payload->paras);
+    }
+    FMT_PUT_LIT(&w, "}");
+    return FmtEnd(&w);
+}
+
+int IoTProfileFmtEvent(char *buf, hi_u32 size, const char *deviceID, IoTProfileEvent_t *payload)
+{
+    FmtWriter_t w = {buf, size, 0, HI_FALSE};
+
+    if ((NULL == buf) || (NULL == payload))
+    {
+        return -1;
+    }
+    if ((NULL == deviceID) || (0 == strcmp(deviceID, CONFIG_DEVICE_ID)))
+    {
+        FMT_PUT_LIT(&w, "{\"object_device_id\":\"" CONFIG_DEVICE_ID "\",\"services\":[{\"service_id\":");
+    }
+    else
+    {
+        FMT_PUT_LIT(&w, "{\"object_device_id\":");
+        FmtPutString(&w, deviceID);
+        FMT_PUT_LIT(&w, ",\"services\":[{\"service_id\":");
+    }
+    FmtPutString(&w, payload->serviceID);
+    FMT_PUT_LIT(&w, ",\"event_type\":");
+    FmtPutString(&w, payload->eventType);
+    if (NULL != payload->eventTime)
+    {
+        FMT_PUT_LIT(&w, ",\"event_time\":");
+        FmtPutString(&w, payload->eventTime);
+    }
+    FMT_PUT_LIT(&w, ",\"paras\":");
+    FmtPutKvs(&w, payload->paras);
+    FMT_PUT_LIT(&w, "}]}");
+    return FmtEnd(&w);
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: write the IoT platform messages into the caller buffer
+ * Author: HiSpark Product Team.
+ * Create: 2020-5-20
+ */
+#ifndef IOT_PROFILE_FMT_H_
+#define IOT_PROFILE_FMT_H_
+
+#include "iot_config.h"
+#include "iot_profile.h"
+
+///< the topics of this device are made by the compiler
+#define CN_PROFILE_TOPIC_PREFIX             "$oc/devices/" CONFIG_DEVICE_ID
+#define CN_PROFILE_TOPIC_PROPERTYREPORT     CN_PROFILE_TOPIC_PREFIX "/sys/properties/report"
+
+#define CN_PROFILE_TOPIC_SIZE   128   ///< enough for the topics with the request id
+#define CN_PROFILE_MSG_SIZE     448   ///< the payload which fits one IoT queue slot with the topic
+
+typedef enum
+{
+    EN_PROFILE_TOPIC_PROPERTYREPORT = 0,
+    EN_PROFILE_TOPIC_PROPERTYGETRESP,  ///< followed by the request id
+    EN_PROFILE_TOPIC_CMDRESP,          ///< followed by the request id
+    EN_PROFILE_TOPIC_EVENTREPORT,
+    EN_PROFILE_TOPIC_LAST,
+} IoTProfileTopic_t;
+
+/**
+ * Write the topic, the prefix of CONFIG_DEVICE_ID is copied as it is, other devices are made here
+ *
+ * @param requestID: NULL for the topics without the request id
+ *
+ * @return the length written (without the '\0'), or -1 if the buffer is too small
+*/
+int IoTProfileFmtTopic(char *buf, hi_u32 size, IoTProfileTopic_t topic, const char *deviceID, const char *requestID);
+
+/**
+ * Write the payloads, they are the same as what cJSON_PrintUnformatted makes for the message
+ *
+ * @return the length written (without the '\0'), or -1 if the buffer is too small or the value is bad
+*/
+int IoTProfileFmtPropertyReport(char *buf, hi_u32 size, IoTProfileService_t *payload);
+
+int IoTProfileFmtCmdResp(char *buf, hi_u32 size, IoTCmdResp_t *payload);
+
+int IoTProfileFmtEvent(char *buf, hi_u32 size, const char *deviceID, IoTProfileEvent_t *payload);
+
+#endif /* IOT_PROFILE_FMT_H_ */
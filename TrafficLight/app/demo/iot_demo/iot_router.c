@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: topic router of the received messages
+ * Author: HiSpark Product Team.
+ * Create: 2020-7-28
+ */
+
+#include "iot_router.h"
+#include "iot_cmd.h"
+#include <string.h>
+
+#define CN_ROUTE_SEED 2166136261u ///< the FNV offset basis, the parent index is mixed into it
+
+///< the levels of the topic, split once before the walk
+typedef struct
+{
+    const char *level[CN_IOT_ROUTE_LEVELNUM];
+    hi_u16 levelLen[CN_IOT_ROUTE_LEVELNUM];
+    hi_u8 levelNum;
+    hi_u8 matchNum;
+    hi_u16 match[CN_IOT_ROUTE_MATCHNUM];
+    const char *requestID;
+    hi_u16 requestIDLen;
+} RouteWalk_t;
+
+static hi_u32 RouteSlot(const IoTRouter_t *router, hi_u16 parent, const char *level, hi_u16 len)
+{
+    return IoTCmdHash(level, len, CN_ROUTE_SEED ^ parent) & router->edgeMask;
+}
+
+static hi_u16 RouteFindChild(const IoTRouter_t *router, hi_u16 parent, const char *level, hi_u16 len)
+{
+    const IoTRouteNode_t *node;
+    hi_u32 slot;
+    hi_u16 index;
+
+    slot = RouteSlot(router, parent, level, len);
+    while ((index = router->edge[slot]) != CN_IOT_ROUTE_NONE)
+    {
+        node = &router->node[index];
+        if ((node->parent == parent) && (node->levelLen == len) && (0 == memcmp(node->level, level, len)))
+        {
+            return index;
+        }
+        slot = (slot + 1) & router->edgeMask;
+    }
+    return CN_IOT_ROUTE_NONE;
+}
+
+///< write the node first and link it after, the walk sees no half written node
+static hi_u16 RouteNewChild(IoTRouter_t *router, hi_u16 parent, const char *level, hi_u16 len)
+{
+    IoTRouteNode_t *node;
+    hi_u16 index;
+    hi_u32 slot;
+
+    if (router->nodeUsed == router->nodeNum)
+    {
+        return CN_IOT_ROUTE_NONE;
+    }
+    index = router->nodeUsed;
+    node = &router->node[index];
+    node->level = level;
+    node->levelLen = len;
+    node->parent = parent;
+    node->handler = NULL;
+    node->arg = NULL;
+    node->plus = CN_IOT_ROUTE_NONE;
+    node->multi = CN_IOT_ROUTE_NONE;
+    router->nodeUsed++;
+
+    if ((len == 1) && (level[0] == '+'))
+    {
+        router->node[parent].plus = index;
+    }
+    else if ((len == 1) && (level[0] == '#'))
+    {
+        router->node[parent].multi = index;
+    }
+    else
+    {
+        ///< edgeNum > nodeNum, so there is always an empty slot
+        slot = RouteSlot(router, parent, level, len);
+        while (router->edge[slot] != CN_IOT_ROUTE_NONE)
+        {
+            slot = (slot + 1) & router->edgeMask;
+        }
+        router->edge[slot] = index;
+    }
+    return index;
+}
+
+///< the wildcards take a whole level, and the '#' only the last one
+static int RouteCheckFilter(const char *filter)
+{
+    const char *c;
+    hi_u32 levelNum = 1;
+
+    for (c = filter; *c != '\0'; c++)
+    {
+        if (*c == '/')
+        {
+            levelNum++;
+        }
+        else if ((*c == '+') || (*c == '#'))
+        {
+            if (((c != filter) && (c[-1] != '/')) || ((c[1] != '/') && (c[1] != '\0')) ||
+                ((*c == '#') && (c[1] != '\0')))
+            {
+                return -1;
+            }
+        }
+    }
+    return (levelNum <= CN_IOT_ROUTE_LEVELNUM) ? 0 : -1;
+}
+
+int IoTRouterInit(IoTRouter_t *router, IoTRouteNode_t *node, hi_u16 nodeNum, hi_u16 *edge, hi_u16 edgeNum)
+{
+    hi_u16 i;
+
+    if ((NULL == router) || (NULL == node) || (NULL == edge) || (0 == nodeNum) || (nodeNum >= edgeNum) ||
+        ((edgeNum & (edgeNum - 1)) != 0))
+    {
+        return -1;
+    }
+    router->node = node;
+    router->nodeNum = nodeNum;
+    router->edge = edge;
+    router->edgeMask = edgeNum - 1;
+    router->filterNum = 0;
+    for (i = 0; i < edgeNum; i++)
+    {
+        edge[i] = CN_IOT_ROUTE_NONE;
+    }
+    ///< the root has no level
+    node[0].level = "";
+    node[0].levelLen = 0;
+    node[0].parent = CN_IOT_ROUTE_NONE;
+    node[0].handler = NULL;
+    node[0].arg = NULL;
+    node[0].plus = CN_IOT_ROUTE_NONE;
+    node[0].multi = CN_IOT_ROUTE_NONE;
+    router->nodeUsed = 1;
+    return 0;
+}
+
+int IoTRouterAdd(IoTRouter_t *router, const char *filter, fnIoTRouteHandler handler, hi_pvoid arg)
+{
+    const char *level;
+    const char *end;
+    hi_u16 len;
+    hi_u16 index = 0;
+    hi_u16 child;
+
+    if ((NULL == router) || (NULL == filter) || (NULL == handler) || (0 != RouteCheckFilter(filter)))
+    {
+        return -1;
+    }
+    for (level = filter; ; level = end + 1)
+    {
+        end = strchr(level, '/');
+        len = (end == NULL) ? (hi_u16)strlen(level) : (hi_u16)(end - level);
+        if ((len == 1) && (level[0] == '+'))
+        {
+            child = router->node[index].plus;
+        }
+        else if ((len == 1) && (level[0] == '#'))
+        {
+            child = router->node[index].multi;
+        }
+        else
+        {
+            child = RouteFindChild(router, index, level, len);
+        }
+        if ((child == CN_IOT_ROUTE_NONE) && ((child = RouteNewChild(router, index, level, len)) == CN_IOT_ROUTE_NONE))
+        {
+            return -1; ///< the levels added so far have no handler and match nothing
+        }
+        index = child;
+        if (end == NULL)
+        {
+            break;
+        }
+    }
+    if (router->node[index].handler == NULL)
+    {
+        router->filterNum++;
+    }
+    router->node[index].arg = arg;
+    router->node[index].handler = handler;
+    return 0;
+}
+
+static int RouteSplit(const char *topic, RouteWalk_t *walk)
+{
+    const char *c = topic;
+    hi_u8 num = 0;
+
+    walk->requestID = NULL;
+    for (;;)
+    {
+        if (num == CN_IOT_ROUTE_LEVELNUM)
+        {
+            return -1;
+        }
+        walk->level[num] = c;
+        while ((*c != '/') && (*c != '\0'))
+        {
+            c++;
+        }
+        walk->levelLen[num] = (hi_u16)(c - walk->level[num]);
+        if ((walk->requestID == NULL) && (walk->levelLen[num] >= sizeof(CN_IOT_ROUTE_REQID) - 1) &&
+            (0 == memcmp(walk->level[num], CN_IOT_ROUTE_REQID, sizeof(CN_IOT_ROUTE_REQID) - 1)))
+        {
+            walk->requestID = walk->level[num] + sizeof(CN_IOT_ROUTE_REQID) - 1;
+            walk->requestIDLen = walk->levelLen[num] - (sizeof(CN_IOT_ROUTE_REQID) - 1);
+        }
+        num++;
+        if (*c == '\0')
+        {
+            break;
+        }
+        c++;
+    }
+    walk->levelNum = num;
+    return 0;
+}
+
+static hi_void RouteAddMatch(const IoTRouter_t *router, RouteWalk_t *walk, hi_u16 index)
+{
+    if ((router->node[index].handler != NULL) && (walk->matchNum < CN_IOT_ROUTE_MATCHNUM))
+    {
+        walk->match[walk->matchNum++] = index;
+    }
+    return;
+}
+
+///< every node is on one path only, so none is matched twice
+static hi_void RouteMatch(const IoTRouter_t *router, RouteWalk_t *walk, hi_u16 index, hi_u8 depth)
+{
+    const IoTRouteNode_t *node = &router->node[index];
+    hi_bool wild;
+    hi_u16 child;
+
+    wild = (depth != 0) || (walk->level[0][0] != '$');
+    ///< "a/#" matches "a" too
+    if (wild && (node->multi != CN_IOT_ROUTE_NONE))
+    {
+        RouteAddMatch(router, walk, node->multi);
+    }
+    if (depth == walk->levelNum)
+    {
+        RouteAddMatch(router, walk, index);
+        return;
+    }
+    child = RouteFindChild(router, index, walk->level[depth], walk->levelLen[depth]);
+    if (child != CN_IOT_ROUTE_NONE)
+    {
+        RouteMatch(router, walk, child, depth + 1);
+    }
+    if (wild && (node->plus != CN_IOT_ROUTE_NONE))
+    {
+        RouteMatch(router, walk, node->plus, depth + 1);
+    }
+    return;
+}
+
+int IoTRouterDispatch(const IoTRouter_t *router, int qos, const char *topic, const char *payload)
+{
+    RouteWalk_t walk;
+    char buf[CN_IOT_ROUTE_REQIDSIZE];
+    const char *requestID;
+    const IoTRouteNode_t *node;
+    hi_u8 i;
+
+    if ((NULL == router) || (NULL == topic) || (0 != RouteSplit(topic, &walk)))
+    {
+        return 0;
+    }
+    walk.matchNum = 0;
+    RouteMatch(router, &walk, 0, 0);
+    if (walk.matchNum == 0)
+    {
+        return 0;
+    }
+
+    ///< the request id is the last level of the platform topics, so it is mostly ended already
+    requestID = walk.requestID;
+    if ((requestID != NULL) && (requestID[walk.requestIDLen] != '\0'))
+    {
+        requestID = NULL;
+        if (walk.requestIDLen < sizeof(buf))
+        {
+            (void)memcpy(buf, walk.requestID, walk.requestIDLen);
+            buf[walk.requestIDLen] = '\0';
+            requestID = buf;
+        }
+    }
+    for (i = 0; i < walk.matchNum; i++)
+    {
+        node = &router->node[walk.match[i]];
+        node->handler(qos, topic, requestID, payload, node->arg);
+    }
+    return walk.matchNum;
+}
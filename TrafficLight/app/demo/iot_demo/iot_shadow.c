@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: device side shadow of the reported properties
+ * Author: HiSpark Product Team.
+ * Create: 2020-5-20
+ */
+
+/**
+ * The shadow keeps the last value handed to the report builder for every property, which is
+ * what the platform has (the reports are qos 0, so there is no later ack to wait for). A value
+ * equal to the shadow is not reported again until the next full resync.
+*/
+#include "iot_shadow.h"
+#include "iot_config.h"
+#include "iot_cmd.h"
+#include "iot_log.h"
+#include <hi_mux.h>
+#include <hi_time.h>
+#include <hi_errno.h>
+#include <string.h>
+
+#define CN_SHADOW_SERVICENUM 4
+
+typedef struct
+{
+    const char *serviceID;
+    const char *key;
+    double num;
+    char str[CN_SHADOW_STRSIZE];
+    hi_bool isStr;
+    hi_bool dirty;        ///< changed and not reported yet
+    hi_bool sent;         ///< reported at least once
+    hi_u32 lastMs;        ///< when it was reported last time
+    hi_u32 minIntervalMs;
+} ShadowProperty_t;
+
+typedef struct
+{
+    hi_bool init;
+    hi_u32 mux;
+    hi_u32 minIntervalMs;
+    hi_u32 resyncMs;
+    hi_u32 lastResyncMs;
+    ShadowProperty_t property[CN_SHADOW_PROPERTYNUM];
+    hi_u8 propertyNum;
+    IoTProfileService_t listService[CN_SHADOW_SERVICENUM];  ///< the report or the get response being made
+    IoTProfileKV_t listKv[CN_SHADOW_PROPERTYNUM];
+    IoTShadowStat_t stat;
+} IoTShadowCb_t;
+static IoTShadowCb_t gShadow;
+
+static ShadowProperty_t *ShadowFind(const char *serviceID, const char *key, hi_bool create)
+{
+    hi_u8 i;
+    ShadowProperty_t *property;
+
+    for (i = 0; i < gShadow.propertyNum; i++)
+    {
+        property = &gShadow.property[i];
+        if ((0 == strcmp(property->key, key)) && (0 == strcmp(property->serviceID, serviceID)))
+        {
+            return property;
+        }
+    }
+    if ((!create) || (gShadow.propertyNum == CN_SHADOW_PROPERTYNUM))
+    {
+        return NULL;
+    }
+    property = &gShadow.property[gShadow.propertyNum++];
+    (void)memset(property, 0, sizeof(ShadowProperty_t));
+    property->serviceID = serviceID;
+    property->key = key;
+    property->minIntervalMs = gShadow.minIntervalMs;
+    return property;
+}
+
+///< fill the kv with the shadow value
+static hi_void ShadowMakeKv(ShadowProperty_t *property, IoTProfileKV_t *kv)
+{
+    (void)memset(kv, 0, sizeof(IoTProfileKV_t));
+    kv->key = property->key;
+    if (property->isStr)
+    {
+        kv->type = EN_IOT_DATATYPE_STRING;
+        kv->value = property->str;
+    }
+    else
+    {
+        kv->type = EN_IOT_DATATYPE_DOUBLE;
+        kv->value = (const char *)&property->num;
+    }
+    return;
+}
+
+///< link the picked properties to the profile services, return NULL if none is picked. The ones of the
+///< services past CN_SHADOW_SERVICENUM are left out and moved to the end of pick, after the linkNum linked
+static IoTProfileService_t *ShadowMakeList(hi_u8 *pick, hi_u8 pickNum, hi_u8 *linkNum)
+{
+    hi_u8 i;
+    hi_u8 svc;
+    hi_u8 serviceNum = 0;
+    hi_u8 linked = 0;
+    hi_u8 left[CN_SHADOW_PROPERTYNUM];
+    hi_u8 leftNum = 0;
+    ShadowProperty_t *property;
+    IoTProfileKV_t *kv;
+
+    (void)memset(gShadow.listService, 0, sizeof(gShadow.listService));
+    for (i = 0; i < pickNum; i++)
+    {
+        property = &gShadow.property[pick[i]];
+        for (svc = 0; svc < serviceNum; svc++)
+        {
+            if (0 == strcmp(gShadow.listService[svc].serviceID, property->serviceID))
+            {
+                break;
+            }
+        }
+        if (svc == serviceNum)
+        {
+            if (serviceNum == CN_SHADOW_SERVICENUM)
+            {
+                left[leftNum++] = pick[i];
+                continue;
+            }
+            gShadow.listService[svc].serviceID = (char *)property->serviceID;
+            if (svc > 0)
+            {
+                gShadow.listService[svc - 1].nxt = &gShadow.listService[svc];
+            }
+            serviceNum++;
+        }
+        kv = &gShadow.listKv[linked];
+        ShadowMakeKv(property, kv);
+        kv->nxt = gShadow.listService[svc].serviceProperty;
+        gShadow.listService[svc].serviceProperty = kv;
+        pick[linked++] = pick[i]; ///< never ahead of i, so no pick is lost
+    }
+    (void)memcpy(&pick[linked], left, leftNum);
+    *linkNum = linked;
+    return (serviceNum > 0) ? &gShadow.listService[0] : NULL;
+}
+
+///< report the dirty properties that are due, all of them when the resync is due
+static hi_void ShadowFlushDue(hi_void)
+{
+    hi_u8 i;
+    hi_u32 now = hi_get_milli_seconds();
+    hi_bool resync = HI_FALSE;
+    hi_u8 pick[CN_SHADOW_PROPERTYNUM];
+    hi_u8 pickNum = 0;
+    hi_u8 linkNum;
+    ShadowProperty_t *property;
+
+    if ((gShadow.resyncMs > 0) && ((hi_u32)(now - gShadow.lastResyncMs) >= gShadow.resyncMs))
+    {
+        resync = HI_TRUE;
+        gShadow.lastResyncMs = now;
+        gShadow.stat.resyncCnt++;
+    }
+    for (i = 0; i < gShadow.propertyNum; i++)
+    {
+        property = &gShadow.property[i];
+        if ((!resync) && (!property->dirty))
+        {
+            continue;
+        }
+        if ((!resync) && property->sent && ((hi_u32)(now - property->lastMs) < property->minIntervalMs))
+        {
+            continue;
+        }
+        pick[pickNum++] = i;
+    }
+    ///< all the due ones go to the report builder together, the ones left out of a list go in the next
+    while (pickNum > 0)
+    {
+        if (0 != IoTProfileReportAdd(ShadowMakeList(pick, pickNum, &linkNum)))
+        {
+            return;
+        }
+        for (i = 0; i < linkNum; i++)
+        {
+            property = &gShadow.property[pick[i]];
+            property->dirty = HI_FALSE;
+            property->sent = HI_TRUE;
+            property->lastMs = now;
+        }
+        gShadow.stat.sentCnt += linkNum;
+        pickNum -= linkNum;
+        (void)memmove(pick, &pick[linkNum], pickNum);
+    }
+    return;
+}
+
+///< update the shadow with the kv, return -1 if the kv could not be cached
+static int ShadowUpdate(const char *serviceID, IoTProfileKV_t *kv)
+{
+    double num = 0;
+    hi_bool isStr;
+    hi_bool same;
+    ShadowProperty_t *property;
+
+    isStr = !IoTProfileKvNumber(kv, &num);
+    if (isStr && ((EN_IOT_DATATYPE_STRING != kv->type) || (NULL == kv->value) ||
+        (strlen(kv->value) >= CN_SHADOW_STRSIZE)))
+    {
+        return -1;
+    }
+    property = ShadowFind(serviceID, kv->key, HI_TRUE);
+    if (NULL == property)
+    {
+        return -1;
+    }
+
+    if (isStr)
+    {
+        same = property->isStr && (0 == strcmp(property->str, kv->value));
+    }
+    else
+    {
+        same = (!property->isStr) && (property->num == num);
+    }
+    gShadow.stat.offerCnt++;
+    if ((property->sent || property->dirty) && same)
+    {
+        gShadow.stat.unchangedCnt++;
+        return 0;
+    }
+
+    property->isStr = isStr;
+    if (isStr)
+    {
+        (void)memcpy(property->str, kv->value, strlen(kv->value) + 1);
+    }
+    else
+    {
+        property->num = num;
+    }
+    if (property->dirty || (property->sent &&
+        ((hi_u32)(hi_get_milli_seconds() - property->lastMs) < property->minIntervalMs)))
+    {
+        gShadow.stat.deferCnt++;
+    }
+    property->dirty = HI_TRUE;
+    return 0;
+}
+
+int IoTShadowInit(hi_u32 minIntervalMs, hi_u32 resyncMs)
+{
+    if (gShadow.init)
+    {
+        return -1;
+    }
+    if (HI_ERR_SUCCESS != hi_mux_create(&gShadow.mux))
+    {
+        return -1;
+    }
+    gShadow.minIntervalMs = minIntervalMs;
+    gShadow.resyncMs = resyncMs;
+    gShadow.lastResyncMs = hi_get_milli_seconds();
+    gShadow.init = HI_TRUE;
+    return 0;
+}
+
+int IoTShadowSetMinInterval(const char *serviceID, const char *key, hi_u32 minIntervalMs)
+{
+    int ret = -1;
+    ShadowProperty_t *property;
+
+    if ((!gShadow.init) || (NULL == serviceID) || (NULL == key))
+    {
+        return ret;
+    }
+    (void)hi_mux_pend(gShadow.mux, HI_SYS_WAIT_FOREVER);
+    property = ShadowFind(serviceID, key, HI_TRUE);
+    if (NULL != property)
+    {
+        property->minIntervalMs = minIntervalMs;
+        ret = 0;
+    }
+    (void)hi_mux_post(gShadow.mux);
+    return ret;
+}
+
+int IoTShadowReport(IoTProfileService_t *payload)
+{
+    int ret = 0;
+    IoTProfileService_t *service;
+    IoTProfileService_t single;
+    IoTProfileKV_t *kv;
+    IoTProfileKV_t one;
+
+    if ((!gShadow.init) || (NULL == payload))
+    {
+        return -1;
+    }
+
+    (void)hi_mux_pend(gShadow.mux, HI_SYS_WAIT_FOREVER);
+    for (service = payload; NULL != service; service = service->nxt)
+    {
+        if (NULL == service->serviceID)
+        {
+            ret = -1;
+            continue;
+        }
+        for (kv = service->serviceProperty; NULL != kv; kv = kv->nxt)
+        {
+            if (NULL == kv->key)
+            {
+                ret = -1;
+            }
+            else if (0 != ShadowUpdate(service->serviceID, kv))
+            {
+                ///< not cached, so it could only be passed through
+                one = *kv;
+                one.nxt = NULL;
+                (void)memset(&single, 0, sizeof(single));
+                single.serviceID = service->serviceID;
+                single.serviceProperty = &one;
+                ret |= IoTProfileReportAdd(&single);
+            }
+        }
+    }
+    ShadowFlushDue();
+    (void)hi_mux_post(gShadow.mux);
+
+    return ret;
+}
+
+int IoTShadowPoll(hi_void)
+{
+    if (!gShadow.init)
+    {
+        return -1;
+    }
+    (void)hi_mux_pend(gShadow.mux, HI_SYS_WAIT_FOREVER);
+    ShadowFlushDue();
+    (void)hi_mux_post(gShadow.mux);
+    return 0;
+}
+
+int IoTShadowHandleGet(const char *requestID, const char *payload)
+{
+    int ret;
+    hi_u8 i;
+    hi_u8 pick[CN_SHADOW_PROPERTYNUM];
+    hi_u8 pickNum = 0;
+    hi_u8 linkNum;
+    IoTCmd_t req;
+    ShadowProperty_t *property;
+
+    if ((!gShadow.init) || (NULL == requestID))
+    {
+        return -1;
+    }
+    ///< the request names the service in service_id, or none for all of them
+    if (0 != IoTCmdDecode(payload, &req))
+    {
+        (void)memset(&req, 0, sizeof(req));
+    }
+
+    (void)hi_mux_pend(gShadow.mux, HI_SYS_WAIT_FOREVER);
+    for (i = 0; i < gShadow.propertyNum; i++)
+    {
+        property = &gShadow.property[i];
+        if ((property->sent || property->dirty) &&
+            ((NULL == req.serviceID.str) || IoTCmdSliceEq(&req.serviceID, property->serviceID)))
+        {
+            pick[pickNum++] = i;
+        }
+    }
+    ///< one response only, it has the first CN_SHADOW_SERVICENUM services
+    ret = IoTProfilePropertyGetResp(CONFIG_DEVICE_ID, requestID, ShadowMakeList(pick, pickNum, &linkNum));
+    gShadow.stat.getCnt++;
+    (void)hi_mux_post(gShadow.mux);
+
+    if (0 != ret)
+    {
+        IOT_LOG_ERROR("Answer the properties get failed\r\n");
+    }
+    return 0;
+}
+
+int IoTShadowGetStat(IoTShadowStat_t *stat)
+{
+    if (NULL == stat)
+    {
+        return -1;
+    }
+    *stat = gShadow.stat;
+    return 0;
+}
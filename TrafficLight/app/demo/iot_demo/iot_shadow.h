@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2020 HiHope Community.
+ * Description: device side shadow of the reported properties
+ * Author: HiSpark Product Team.
+ * Create: 2020-5-20
+ */
+#ifndef IOT_SHADOW_H_
+#define IOT_SHADOW_H_
+
+#include <hi_types_base.h>
+#include "iot_profile.h"
+
+#define CN_SHADOW_PROPERTYNUM 24
+#define CN_SHADOW_STRSIZE     24   ///< the longer string values are reported every time, not cached
+
+typedef struct
+{
+    hi_u32 offerCnt;      ///< property values offered by the application
+    hi_u32 sentCnt;       ///< property values handed to the report builder
+    hi_u32 unchangedCnt;  ///< property values dropped because the platform already has them
+    hi_u32 deferCnt;      ///< changes hold back by the min interval
+    hi_u32 resyncCnt;     ///< full resyncs done
+    hi_u32 getCnt;        ///< sys/properties/get answered from the shadow
+} IoTShadowStat_t;
+
+/**
+ * Set up the shadow, the reports go through the report builder, so init it first
+ *
+ * @param minIntervalMs: the default min interval between two reports of one property
+ * @param resyncMs: every resyncMs all the properties are reported again, 0 means never
+ *
+ * @return 0 success while others failed
+*/
+int IoTShadowInit(hi_u32 minIntervalMs, hi_u32 resyncMs);
+
+/**
+ * Set the min interval of one property, like a counter that changes every second
+ *
+ * @return 0 success while others failed
+*/
+int IoTShadowSetMinInterval(const char *serviceID, const char *key, hi_u32 minIntervalMs);
+
+/**
+ * Use it instead of IoTProfileReportAdd: only the changed properties are added to the report,
+ * and a change within the min interval is kept until the interval passes. The serviceID and the
+ * keys are kept by reference, so use the constant strings. Flush the report builder after it.
+ *
+ * @return 0 success while others failed
+*/
+int IoTShadowReport(IoTProfileService_t *payload);
+
+/**
+ * Add the changes that were hold back and are due now, call it when there is no report for a while
+ *
+ * @return 0 success while others failed
+*/
+int IoTShadowPoll(hi_void);
+
+/**
+ * Answer the sys/properties/get request from the shadow, call it in the route of sys/properties/get/#
+ * with the request id of the topic
+ *
+ * @return 0 the request has been answered, others not
+*/
+int IoTShadowHandleGet(const char *requestID, const char *payload);
+
+/**
+ * Get the shadow counters
+ *
+ * @return 0 success while others failed
+*/
+int IoTShadowGetStat(IoTShadowStat_t *stat);
+
+#endif /* IOT_SHADOW_H_ */
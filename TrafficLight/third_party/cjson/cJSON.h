@@ -120,6 +120,11 @@ typedef struct cJSON
 
     /* The item's name string, if this item is the child of, or is in the list of subitems of an object. */
     char *string;
+
+#ifdef CJSON_OBJECT_INDEX
+    /* The index of the children by name, which a lookup in a wide object builds. Change the children through these functions, or cJSON_DropIndex after. */
+    struct cJSON_Index *index;
+#endif
 } cJSON;
 
 typedef struct cJSON_Hooks
@@ -137,6 +142,12 @@ typedef int cJSON_bool;
 #define CJSON_NESTING_LIMIT 1000
 #endif
 
+/* Define CJSON_OBJECT_INDEX, the same for cJSON and all of its users, to index wide objects by name.
+ * A lookup by name which walks past this many children indexes the object for the next lookups. */
+#if defined(CJSON_OBJECT_INDEX) && !defined(CJSON_INDEX_THRESHOLD)
+#define CJSON_INDEX_THRESHOLD 16
+#endif
+
 /* returns the version of cJSON as a string */
 CJSON_PUBLIC(const char*) cJSON_Version(void);
 
@@ -152,6 +163,66 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
 
+/* An arena the items and the strings of a parse are carved from, instead of one allocation each.
+ * It starts with the buffer given to cJSON_ArenaInit and, if chunk_size is not 0, goes on in chunks
+ * taken from the hooks. cJSON_ArenaReset releases all that was parsed into it at once, the chunks
+ * included. Never cJSON_Delete an item parsed into an arena, nor delete or replace its children. */
+typedef struct cJSON_Arena
+{
+    unsigned char *buffer;
+    size_t size;
+    size_t offset;
+    size_t chunk_size;
+    struct cJSON_ArenaChunk *chunks; /* the last one taken first */
+} cJSON_Arena;
+
+/* buffer may be NULL with a chunk_size, the arena is then only chunks. */
+CJSON_PUBLIC(void) cJSON_ArenaInit(cJSON_Arena *arena, void *buffer, size_t size, size_t chunk_size);
+/* Release all the items parsed into the arena and free its chunks, the arena can be parsed into again. */
+CJSON_PUBLIC(void) cJSON_ArenaReset(cJSON_Arena *arena);
+/* As cJSON_ParseWithOpts, into the arena. The memory of a failed parse is released with the next reset. */
+CJSON_PUBLIC(cJSON *) cJSON_ParseInArena(cJSON_Arena *arena, const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
+/* As cJSON_ParseInArena, but the strings are unescaped in place and point into value, which must stay
+ * until the reset. Only the items are taken from the arena. value is changed even if the parse fails. */
+CJSON_PUBLIC(cJSON *) cJSON_ParseInPlace(cJSON_Arena *arena, char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
+
+/* The callbacks of a streaming parse, in the order of the document. Any of them may be NULL, and any
+ * returning false stops the parse. key and the strings of value are only valid during the call, value
+ * is an item of type cJSON_NULL, cJSON_False, cJSON_True, cJSON_Number or cJSON_String. */
+typedef struct cJSON_SaxHandler
+{
+    cJSON_bool (*start_object)(void *context);
+    cJSON_bool (*end_object)(void *context);
+    cJSON_bool (*start_array)(void *context);
+    cJSON_bool (*end_array)(void *context);
+    cJSON_bool (*key)(void *context, const char *key);
+    cJSON_bool (*value)(void *context, const cJSON *value);
+} cJSON_SaxHandler;
+
+/* A streaming parse, fed the document in chunks of any size and calling back the handler as it goes,
+ * without the heap. A string, number or literal is gathered into token before it is decoded, so token
+ * bounds the longest of them. The depth is bounded by CJSON_NESTING_LIMIT. */
+typedef struct cJSON_Sax
+{
+    const cJSON_SaxHandler *handler;
+    void *context;
+    char *token;
+    size_t token_size;
+    size_t token_length;
+    size_t offset; /* of the next byte of the document, or of the byte the parse failed on */
+    size_t depth;
+    int state;
+    cJSON_bool escaped; /* the token is a string and its last byte starts an escape */
+    cJSON_bool stopped; /* a callback returned false */
+    unsigned char objects[(CJSON_NESTING_LIMIT + 7) / 8]; /* a bit per depth, set in an object */
+} cJSON_Sax;
+
+CJSON_PUBLIC(void) cJSON_SaxInit(cJSON_Sax *sax, const cJSON_SaxHandler *handler, void *context, char *token, size_t token_size);
+/* Parse the next chunk of the document, false if it is not JSON or a callback stopped the parse. */
+CJSON_PUBLIC(cJSON_bool) cJSON_SaxFeed(cJSON_Sax *sax, const char *chunk, size_t length);
+/* The end of the document, false if it ends before its value does. */
+CJSON_PUBLIC(cJSON_bool) cJSON_SaxFinish(cJSON_Sax *sax);
+
 /* Render a cJSON entity to text for transfer/storage. */
 CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item);
 /* Render a cJSON entity to text for transfer/storage without any formatting. */
@@ -161,6 +232,11 @@ CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON
 /* Render a cJSON entity to text using a buffer already allocated in memory with given length. Returns 1 on success and 0 on failure. */
 /* NOTE: cJSON is not always 100% accurate in estimating how much memory it will use, so to be safe allocate 5 bytes more than you actually need */
 CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format);
+/* Receives the text of a print in order, a chunk at a time. Returning false stops the print. */
+typedef cJSON_bool (*cJSON_Writer)(void *context, const char *chunk, size_t length);
+/* Render a cJSON entity through the writer. The text is gathered in buffer and handed over in chunks of
+ * at most length - 1 bytes, so a print of any size takes only the buffer. length must be at least 32. */
+CJSON_PUBLIC(cJSON_bool) cJSON_PrintToWriter(const cJSON *item, char *buffer, const int length, const cJSON_bool format, cJSON_Writer writer, void *context);
 /* Delete a cJSON entity and all subentities. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *item);
 
@@ -172,6 +248,9 @@ CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index);
 CJSON_PUBLIC(cJSON *) cJSON_GetObjectItem(const cJSON * const object, const char * const string);
 CJSON_PUBLIC(cJSON *) cJSON_GetObjectItemCaseSensitive(const cJSON * const object, const char * const string);
 CJSON_PUBLIC(cJSON_bool) cJSON_HasObjectItem(const cJSON *object, const char *string);
+/* With CJSON_OBJECT_INDEX the lookups above may build the index of the object, lock around them as around changes if several threads look up one object. */
+/* Drop the index of the object, after its children were changed other than through these functions. Does nothing without CJSON_OBJECT_INDEX. */
+CJSON_PUBLIC(void) cJSON_DropIndex(cJSON *object);
 /* For analysing failed parses. This returns a pointer to the parse error. You'll probably need to look a few chars back to make sense of it. Defined when cJSON_Parse() returns 0. 0 when cJSON_Parse() succeeds. */
 CJSON_PUBLIC(const char *) cJSON_GetErrorPtr(void);
 
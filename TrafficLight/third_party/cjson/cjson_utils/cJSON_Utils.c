@@ -298,9 +298,42 @@ static cJSON_bool decode_array_index_from_pointer(const unsigned char * const po
     return 1;
 }
 
+/* Decode the ~0 and ~1 escapes of the path token the pointer starts with into name, false if the
+ * token has an invalid escape or does not fit. */
+static cJSON_bool decode_pointer_token(const unsigned char *pointer, unsigned char * const name, const size_t name_size)
+{
+    size_t length = 0;
+
+    for (; (*pointer != '\0') && (*pointer != '/'); pointer++)
+    {
+        if (length == (name_size - 1))
+        {
+            return false;
+        }
+
+        if (*pointer == '~')
+        {
+            if ((pointer[1] != '0') && (pointer[1] != '1'))
+            {
+                return false;
+            }
+            pointer++;
+            name[length++] = (*pointer == '0') ? '~' : '/';
+        }
+        else
+        {
+            name[length++] = *pointer;
+        }
+    }
+    name[length] = '\0';
+
+    return true;
+}
+
 static cJSON *get_item_from_pointer(cJSON * const object, const char * pointer, const cJSON_bool case_sensitive)
 {
     cJSON *current_element = object;
+    unsigned char name[64];
 
     if (pointer == NULL)
     {
@@ -321,6 +354,11 @@ static cJSON *get_item_from_pointer(cJSON * const object, const char * pointer,
 
             current_element = get_array_item(current_element, index);
         }
+        else if (cJSON_IsObject(current_element) && decode_pointer_token((const unsigned char*)pointer, name, sizeof(name)))
+        {
+            /* through GetObjectItem, which indexes wide objects */
+            current_element = case_sensitive ? cJSON_GetObjectItemCaseSensitive(current_element, (const char*)name) : cJSON_GetObjectItem(current_element, (const char*)name);
+        }
         else if (cJSON_IsObject(current_element))
         {
             current_element = current_element->child;
@@ -403,9 +441,9 @@ static cJSON *detach_item_from_array(cJSON *array, size_t which)
         /* item doesn't exist */
         return NULL;
     }
-    if (c->prev)
+    if (c != array->child)
     {
-        /* not the first element */
+        /* not the first element, the prev of the first one is the last */
         c->prev->next = c->next;
     }
     if (c->next)
@@ -416,6 +454,11 @@ static cJSON *detach_item_from_array(cJSON *array, size_t which)
     {
         array->child = c->next;
     }
+    else if (c->next == NULL)
+    {
+        /* last element */
+        array->child->prev = c->prev;
+    }
     /* make sure the detached item doesn't point anywhere anymore */
     c->prev = c->next = NULL;
 
@@ -595,6 +638,18 @@ static void sort_object(cJSON * const object, const cJSON_bool case_sensitive)
         return;
     }
     object->child = sort_list(object->child, case_sensitive);
+    if (object->child != NULL)
+    {
+        /* the prev of the first element is the last, which the sort has moved */
+        cJSON *last = object->child;
+        while (last->next != NULL)
+        {
+            last = last->next;
+        }
+        object->child->prev = last;
+    }
+    /* the order of the index follows the list */
+    cJSON_DropIndex(object);
 }
 
 static cJSON_bool compare_json(cJSON *a, cJSON *b, const cJSON_bool case_sensitive)
@@ -796,6 +851,7 @@ static void overwrite_item(cJSON * const root, const cJSON replacement)
     {
         cJSON_Delete(root->child);
     }
+    cJSON_DropIndex(root);
 
     memcpy(root, &replacement, sizeof(cJSON));
 }
@@ -836,7 +892,11 @@ static int apply_patch(cJSON *object, const cJSON *patch, const cJSON_bool case_
     {
         if (opcode == REMOVE)
         {
-            static const cJSON invalid = { NULL, NULL, NULL, cJSON_Invalid, NULL, 0, 0, NULL};
+            static const cJSON invalid = { NULL, NULL, NULL, cJSON_Invalid, NULL, 0, 0, NULL
+#ifdef CJSON_OBJECT_INDEX
+                , NULL
+#endif
+            };
 
             overwrite_item(object, invalid);
 
@@ -37,6 +37,8 @@
 
 #include "MQTTClient.h"
 #include "LinkedList.h"
+#include "MessageIDs.h"
+#include "TopicAliases.h"
 #include "MQTTClientPersistence.h"
 
 
@@ -50,6 +52,7 @@ typedef struct
 	char* payload;
 	int payloadlen;
 	int refcount;
+	ListElement* elem; /**< element in the publications list, to remove it without a search */
 } Publications;
 
 /**
@@ -147,6 +150,8 @@ typedef struct
 	willMessages* will;
 	List* inboundMsgs;
 	List* outboundMsgs;				/**< in flight */
+	MessageIDs inboundIDs;			/**< inboundMsgs by message id */
+	MessageIDs outboundIDs;			/**< outboundMsgs by message id */
 	List* messageQueue;
 	unsigned int qentry_seqno;
 	void* phandle;  /* the persistence handle */
@@ -154,6 +159,10 @@ typedef struct
 	void* context; /* calling context - used when calling disconnect_internal */
 	int MQTTVersion;
 	int sessionExpiry; /**< MQTT 5 session expiry */
+	TopicAliases outboundAliases;	/**< MQTT 5 topic aliases of the publishes on this connection */
+	unsigned int publishCount;		/**< PUBLISH packets sent, the retries included */
+	unsigned int publishAliased;	/**< of them, those sent with a topic alias and no topic */
+	unsigned long long publishBytes;	/**< their bytes on the network, the fixed headers included */
 #if defined(OPENSSL) || defined(MBEDTLS)
 	MQTTClient_SSLOptions *sslopts;
 	SSL_SESSION* session;    /***< SSL session pointer for fast handhake */
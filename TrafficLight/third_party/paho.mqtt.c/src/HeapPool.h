@@ -0,0 +1,46 @@
+/*******************************************************************************
+ * Copyright (c) 2020 HiHope Community.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    HiSpark Product Team - pools of the tracked heap
+ *******************************************************************************/
+
+#if !defined(HEAPPOOL_H)
+#define HEAPPOOL_H
+
+#include "Heap.h"
+
+#if defined(HEAP_POOLS)
+
+#if !defined(HEAP_POOL_CHUNK)
+/** bytes a pool takes from the system at a time */
+#define HEAP_POOL_CHUNK 4096
+#endif
+
+/** the largest size class, larger blocks up to HEAP_POOL_ARENA_MAX come from the arena */
+#define HEAP_POOL_CLASS_MAX 256
+
+#if !defined(HEAP_POOL_ARENA_MAX)
+/** the largest block the arena takes, larger ones are tracked one by one */
+#define HEAP_POOL_ARENA_MAX (HEAP_POOL_CHUNK / 4)
+#endif
+
+void* HeapPool_malloc(size_t* size);
+size_t HeapPool_free(void* p);
+size_t HeapPool_size(void* p);
+void* HeapPool_findItem(void* p);
+void HeapPool_trim(void);
+void HeapPool_get_info(heap_pool_info* info);
+
+#endif
+
+#endif
@@ -111,6 +111,7 @@
 #if !defined(NO_PERSISTENCE)
 #include "MQTTClientPersistence.h"
 #endif
+#include "MQTTClient.h" /* cert_string and key_string of the LiteOS ssl options */
 
 /**
  * Return code: No error. Indicates successful completion of an MQTT client
@@ -1004,7 +1005,11 @@ typedef struct
 
 } MQTTAsync_SSLOptions;
 
+#if defined (__LITEOS__)
 #define MQTTAsync_SSLOptions_initializer { {'M', 'Q', 'T', 'S'}, 4, NULL, NULL, NULL, NULL, NULL, 1, MQTT_SSL_VERSION_DEFAULT, 0, NULL, NULL, NULL, NULL, NULL, 0, NULL, NULL, NULL}
+#else
+#define MQTTAsync_SSLOptions_initializer { {'M', 'Q', 'T', 'S'}, 4, NULL, NULL, NULL, NULL, NULL, 1, MQTT_SSL_VERSION_DEFAULT, 0, NULL, NULL, NULL, NULL, NULL, 0}
+#endif
 
 /**
  * MQTTAsync_connectOptions defines several settings that control the way the
@@ -1296,6 +1301,27 @@ DLLExport int MQTTAsync_disconnect(MQTTAsync handle, const MQTTAsync_disconnectO
   */
 DLLExport int MQTTAsync_isConnected(MQTTAsync handle);
 
+/**
+ * The PUBLISH packets a client sent, see MQTTAsync_getPublishStats()
+ */
+typedef struct
+{
+	unsigned int count;		/**< PUBLISH packets sent since the client was created, the retries included */
+	unsigned int aliased;	/**< of them, those sent with an MQTT 5 topic alias in place of the topic */
+	unsigned long long bytes;	/**< their bytes on the network, the fixed headers included */
+} MQTTAsync_publishStats;
+
+/**
+  * This function returns how many PUBLISH packets the client sent and their size, so that
+  * the saving of the MQTT 5 topic aliases can be seen. The size is that of the MQTT packets,
+  * without the TCP or TLS overhead.
+  * @param handle A valid client handle from a successful call to
+  * MQTTAsync_create().
+  * @param stats Set to the counts of the client.
+  * @return ::MQTTASYNC_SUCCESS, or ::MQTTASYNC_FAILURE if the handle is not valid.
+  */
+DLLExport int MQTTAsync_getPublishStats(MQTTAsync handle, MQTTAsync_publishStats* stats);
+
 
 /**
   * This function attempts to subscribe a client to a single topic, which may
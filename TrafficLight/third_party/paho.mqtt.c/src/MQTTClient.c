@@ -103,12 +103,21 @@ ClientStates* bstate = &ClientState;
 
 MQTTProtocol state;
 
+/*
+ * Locking.  Each client has its own mutex, m->mutex, which guards the state of that client.  It is held
+ * by the API calls for the client and while its packets are handled, so clients driven from different
+ * threads do not wait for each other.  mqttclient_mutex only guards the library initialization, the
+ * handles and client lists and the background thread.  socket_mutex belongs to the Socket module and
+ * guards the socket set, the socket buffers and the publications shared by all the clients.
+ *
+ * The order they are taken in is m->connect_mutex, m->subscribe_mutex or m->unsubscribe_mutex, then
+ * mqttclient_mutex, m->mutex and socket_mutex.  A thread holding a client mutex never waits for
+ * mqttclient_mutex or for the mutex of another client, so it releases it before reading the network
+ * on behalf of all the clients in MQTTClient_yield and MQTTClient_waitfor.
+ */
 #if defined(WIN32) || defined(WIN64)
 static mutex_type mqttclient_mutex = NULL;
-static mutex_type socket_mutex = NULL;
-static mutex_type subscribe_mutex = NULL;
-static mutex_type unsubscribe_mutex = NULL;
-static mutex_type connect_mutex = NULL;
+extern mutex_type socket_mutex;
 extern mutex_type stack_mutex;
 extern mutex_type heap_mutex;
 extern mutex_type log_mutex;
@@ -123,9 +132,6 @@ BOOL APIENTRY DllMain(HANDLE hModule,
 			if (mqttclient_mutex == NULL)
 			{
 				mqttclient_mutex = CreateMutex(NULL, 0, NULL);
-				subscribe_mutex = CreateMutex(NULL, 0, NULL);
-				unsubscribe_mutex = CreateMutex(NULL, 0, NULL);
-				connect_mutex = CreateMutex(NULL, 0, NULL);
 				stack_mutex = CreateMutex(NULL, 0, NULL);
 				heap_mutex = CreateMutex(NULL, 0, NULL);
 				log_mutex = CreateMutex(NULL, 0, NULL);
@@ -143,18 +149,7 @@ BOOL APIENTRY DllMain(HANDLE hModule,
 #else
 static pthread_mutex_t mqttclient_mutex_store = PTHREAD_MUTEX_INITIALIZER;
 static mutex_type mqttclient_mutex = &mqttclient_mutex_store;
-
-static pthread_mutex_t socket_mutex_store = PTHREAD_MUTEX_INITIALIZER;
-static mutex_type socket_mutex = &socket_mutex_store;
-
-static pthread_mutex_t subscribe_mutex_store = PTHREAD_MUTEX_INITIALIZER;
-static mutex_type subscribe_mutex = &subscribe_mutex_store;
-
-static pthread_mutex_t unsubscribe_mutex_store = PTHREAD_MUTEX_INITIALIZER;
-static mutex_type unsubscribe_mutex = &unsubscribe_mutex_store;
-
-static pthread_mutex_t connect_mutex_store = PTHREAD_MUTEX_INITIALIZER;
-static mutex_type connect_mutex = &connect_mutex_store;
+extern mutex_type socket_mutex;
 
 void MQTTClient_init(void)
 {
@@ -169,14 +164,6 @@ void MQTTClient_init(void)
 #endif /* !defined(_WRS_KERNEL) */
 	if ((rc = pthread_mutex_init(mqttclient_mutex, &attr)) != 0)
 		printf("MQTTClient: error %d initializing client_mutex\n", rc);
-	if ((rc = pthread_mutex_init(socket_mutex, &attr)) != 0)
-		printf("MQTTClient: error %d initializing socket_mutex\n", rc);
-	if ((rc = pthread_mutex_init(subscribe_mutex, &attr)) != 0)
-		printf("MQTTClient: error %d initializing subscribe_mutex\n", rc);
-	if ((rc = pthread_mutex_init(unsubscribe_mutex, &attr)) != 0)
-		printf("MQTTClient: error %d initializing unsubscribe_mutex\n", rc);
-	if ((rc = pthread_mutex_init(connect_mutex, &attr)) != 0)
-		printf("MQTTClient: error %d initializing connect_mutex\n", rc);
 }
 
 #define WINAPI
@@ -185,7 +172,7 @@ void MQTTClient_init(void)
 static volatile int library_initialized = 0;
 static List* handles = NULL;
 static int running = 0;
-static int tostop = 0;
+static volatile int tostop = 0; /* set by MQTTClient_stop without mqttclient_mutex */
 static thread_id_type run_id = 0;
 
 typedef struct
@@ -221,6 +208,12 @@ typedef struct
 	void* auth_handle_context; /* the context to be associated with the authHandle callback*/
 #endif
 
+	mutex_type mutex; /* guards the client state */
+	mutex_type connect_mutex;
+	mutex_type subscribe_mutex;
+	mutex_type unsubscribe_mutex;
+	int connecting; /* a connect call is in progress, guarded by mqttclient_mutex */
+
 	sem_type connect_sem;
 	int rc; /* getsockopt return code in connect */
 	sem_type connack_sem;
@@ -313,10 +306,11 @@ static int MQTTClient_deliverMessage(
 		int rc, MQTTClients* m,
 		char** topicName, int* topicLen,
 		MQTTClient_message** message);
-static int clientSockCompare(void* a, void* b);
+static MQTTClients* MQTTClient_findHandle(int sock);
 static thread_return_type WINAPI connectionLost_call(void* context);
 static thread_return_type WINAPI MQTTClient_run(void* n);
 static void MQTTClient_stop(void);
+static int MQTTClient_stopping(void);
 static void MQTTClient_closeSession(Clients* client, enum MQTTReasonCodes reason, MQTTProperties* props);
 static int MQTTClient_cleanSession(Clients* client);
 static MQTTResponse MQTTClient_connectURIVersion(
@@ -397,6 +391,10 @@ int MQTTClient_createWithOptions(MQTTClient* handle, const char* serverURI, cons
 	m = malloc(sizeof(MQTTClients));
 	*handle = m;
 	memset(m, '\0', sizeof(MQTTClients));
+	m->mutex = Thread_create_mutex();
+	m->connect_mutex = Thread_create_mutex();
+	m->subscribe_mutex = Thread_create_mutex();
+	m->unsubscribe_mutex = Thread_create_mutex();
 	if (strncmp(URI_TCP, serverURI, strlen(URI_TCP)) == 0)
 		serverURI += strlen(URI_TCP);
 	else if (strncmp(URI_WS, serverURI, strlen(URI_WS)) == 0)
@@ -450,7 +448,9 @@ int MQTTClient_createWithOptions(MQTTClient* handle, const char* serverURI, cons
 			MQTTPersistence_restoreMessageQueue(m->c);
 	}
 #endif
+	Thread_lock_mutex(socket_mutex);
 	ListAppend(bstate->clients, m->c, sizeof(Clients) + 3*sizeof(List));
+	Thread_unlock_mutex(socket_mutex);
 
 exit:
 	Thread_unlock_mutex(mqttclient_mutex);
@@ -471,6 +471,18 @@ static void MQTTClient_terminate(void)
 {
 	FUNC_ENTRY;
 	MQTTClient_stop();
+	if (running && Thread_getid() != run_id)
+	{
+		int count = 0;
+
+		while (running && ++count < 100)
+		{
+			Thread_unlock_mutex(mqttclient_mutex);
+			Log(TRACE_MIN, -1, "sleeping");
+			MQTTClient_sleep(100L);
+			Thread_lock_mutex(mqttclient_mutex);
+		}
+	}
 	if (library_initialized)
 	{
 		ListFree(bstate->clients);
@@ -518,6 +530,8 @@ void MQTTClient_destroy(MQTTClient* handle)
 	if (m == NULL)
 		goto exit;
 
+	/* wait for a thread handling the packets of this client to finish with it */
+	Thread_lock_mutex(m->mutex);
 	if (m->c)
 	{
 		int saved_socket = m->c->net.socket;
@@ -526,11 +540,13 @@ void MQTTClient_destroy(MQTTClient* handle)
 		MQTTPersistence_close(m->c);
 #endif
 		MQTTClient_emptyMessageQueue(m->c);
+		Thread_lock_mutex(socket_mutex);
 		MQTTProtocol_freeClient(m->c);
 		if (!ListRemove(bstate->clients, m->c))
 			Log(LOG_ERROR, 0, NULL);
 		else
 			Log(TRACE_MIN, 1, NULL, saved_clientid, saved_socket);
+		Thread_unlock_mutex(socket_mutex);
 		free(saved_clientid);
 	}
 	if (m->serverURI)
@@ -539,6 +555,11 @@ void MQTTClient_destroy(MQTTClient* handle)
 	Thread_destroy_sem(m->connack_sem);
 	Thread_destroy_sem(m->suback_sem);
 	Thread_destroy_sem(m->unsuback_sem);
+	Thread_unlock_mutex(m->mutex);
+	Thread_destroy_mutex(m->mutex);
+	Thread_destroy_mutex(m->connect_mutex);
+	Thread_destroy_mutex(m->subscribe_mutex);
+	Thread_destroy_mutex(m->unsubscribe_mutex);
 	if (!ListRemove(handles, m))
 		Log(LOG_ERROR, -1, "free error");
 	*handle = NULL;
@@ -605,15 +626,19 @@ static int MQTTClient_deliverMessage(int rc, MQTTClients* m, char** topicName, i
 
 
 /**
- * List callback function for comparing clients by socket
- * @param a first integer value
- * @param b second integer value
- * @return boolean indicating whether a and b are equal
+ * Find the client handle a socket belongs to.  Called with mqttclient_mutex held, so that the handle
+ * cannot be destroyed before the caller has taken its mutex.
+ * @param sock the socket
+ * @return the client handle, or NULL if no client has the socket
  */
-static int clientSockCompare(void* a, void* b)
+static MQTTClients* MQTTClient_findHandle(int sock)
 {
-	MQTTClients* m = (MQTTClients*)a;
-	return m->c->net.socket == *(int*)b;
+	MQTTClients* m = NULL;
+	Clients* client = NULL;
+
+	if (sock > 0 && (client = MQTTProtocol_findClient(sock)) != NULL)
+		m = (MQTTClients*)(client->context);
+	return m;
 }
 
 
@@ -638,17 +663,21 @@ int MQTTClient_setDisconnected(MQTTClient handle, void* context, MQTTClient_disc
 	MQTTClients* m = handle;
 
 	FUNC_ENTRY;
-	Thread_lock_mutex(mqttclient_mutex);
-
-	if (m == NULL || m->c->connect_state != NOT_IN_PROGRESS)
+	if (m == NULL)
 		rc = MQTTCLIENT_FAILURE;
 	else
 	{
-		m->disconnected_context = context;
-		m->disconnected = disconnected;
+		Thread_lock_mutex(m->mutex);
+		if (m->c->connect_state != NOT_IN_PROGRESS)
+			rc = MQTTCLIENT_FAILURE;
+		else
+		{
+			m->disconnected_context = context;
+			m->disconnected = disconnected;
+		}
+		Thread_unlock_mutex(m->mutex);
 	}
 
-	Thread_unlock_mutex(mqttclient_mutex);
 	FUNC_EXIT_RC(rc);
 	return rc;
 }
@@ -679,17 +708,21 @@ int MQTTClient_setPublished(MQTTClient handle, void* context, MQTTClient_publish
 	MQTTClients* m = handle;
 
 	FUNC_ENTRY;
-	Thread_lock_mutex(mqttclient_mutex);
-
-	if (m == NULL || m->c->connect_state != NOT_IN_PROGRESS)
+	if (m == NULL)
 		rc = MQTTCLIENT_FAILURE;
 	else
 	{
-		m->published_context = context;
-		m->published = published;
+		Thread_lock_mutex(m->mutex);
+		if (m->c->connect_state != NOT_IN_PROGRESS)
+			rc = MQTTCLIENT_FAILURE;
+		else
+		{
+			m->published_context = context;
+			m->published = published;
+		}
+		Thread_unlock_mutex(m->mutex);
 	}
 
-	Thread_unlock_mutex(mqttclient_mutex);
 	FUNC_EXIT_RC(rc);
 	return rc;
 }
@@ -702,17 +735,21 @@ int MQTTClient_setHandleAuth(MQTTClient handle, void* context, MQTTClient_handle
 	MQTTClients* m = handle;
 
 	FUNC_ENTRY;
-	Thread_lock_mutex(mqttclient_mutex);
-
-	if (m == NULL || m->c->connect_state != NOT_IN_PROGRESS)
+	if (m == NULL)
 		rc = MQTTCLIENT_FAILURE;
 	else
 	{
-		m->auth_handle_context = context;
-		m->auth_handle = auth_handle;
+		Thread_lock_mutex(m->mutex);
+		if (m->c->connect_state != NOT_IN_PROGRESS)
+			rc = MQTTCLIENT_FAILURE;
+		else
+		{
+			m->auth_handle_context = context;
+			m->auth_handle = auth_handle;
+		}
+		Thread_unlock_mutex(m->mutex);
 	}
 
-	Thread_unlock_mutex(mqttclient_mutex);
 	FUNC_EXIT_RC(rc);
 	return rc;
 }
@@ -744,11 +781,10 @@ static thread_return_type WINAPI MQTTClient_run(void* n)
 	long timeout = 10L; /* first time in we have a small timeout.  Gets things started more quickly */
 
 	FUNC_ENTRY;
-	running = 1;
 	run_id = Thread_getid();
 
 	Thread_lock_mutex(mqttclient_mutex);
-	while (!tostop)
+	while (!MQTTClient_stopping())
 	{
 		int rc = SOCKET_ERROR;
 		int sock = -1;
@@ -758,22 +794,35 @@ static thread_return_type WINAPI MQTTClient_run(void* n)
 		Thread_unlock_mutex(mqttclient_mutex);
 		pack = MQTTClient_cycle(&sock, timeout, &rc);
 		Thread_lock_mutex(mqttclient_mutex);
-		if (tostop)
+		if (MQTTClient_stopping())
 			break;
 		timeout = 1000L;
 
 		/* find client corresponding to socket */
-		if (ListFindItem(handles, &sock, clientSockCompare) == NULL)
-		{
-			/* assert: should not happen */
-			continue;
-		}
-		m = (MQTTClient)(handles->current->content);
-		if (m == NULL)
+		if ((m = MQTTClient_findHandle(sock)) != NULL)
+			Thread_lock_mutex(m->mutex);
+		else
 		{
-			/* assert: should not happen */
-			continue;
+			ListElement* current = NULL;
+
+			/* no socket ready: deliver a message still queued rather than wait for more network traffic */
+			while (ListNextElement(handles, &current))
+			{
+				MQTTClients* queued = (MQTTClient)(current->content);
+
+				Thread_lock_mutex(queued->mutex);
+				if (queued->c->connected && queued->c->messageQueue->count > 0)
+				{
+					m = queued;
+					break;
+				}
+				Thread_unlock_mutex(queued->mutex);
+			}
+			if (m == NULL)
+				continue;
+			rc = TCPSOCKET_COMPLETE;
 		}
+		Thread_unlock_mutex(mqttclient_mutex);
 		if (rc == SOCKET_ERROR)
 		{
 			if (m->c->connected)
@@ -806,9 +855,9 @@ static thread_return_type WINAPI MQTTClient_run(void* n)
 
 				Log(TRACE_MIN, -1, "Calling messageArrived for client %s, queue depth %d",
 					m->c->clientID, m->c->messageQueue->count);
-				Thread_unlock_mutex(mqttclient_mutex);
+				Thread_unlock_mutex(m->mutex);
 				rc = (*(m->ma))(m->context, qe->topicName, topicLen, qe->msg);
-				Thread_lock_mutex(mqttclient_mutex);
+				Thread_lock_mutex(m->mutex);
 				/* if 0 (false) is returned by the callback then it failed, so we don't remove the message from
 				 * the queue, and it will be retried later.  If 1 is returned then the message data may have been freed,
 				 * so we must be careful how we use it.
@@ -820,6 +869,9 @@ static thread_return_type WINAPI MQTTClient_run(void* n)
 						MQTTPersistence_unpersistQueueEntry(m->c, (MQTTPersistence_qEntry*)qe);
 					#endif
 					ListRemove(m->c->messageQueue, qe);
+					/* only one message is delivered per cycle, so don't wait in select while more are queued */
+					if (m->c->messageQueue->count > 0)
+						timeout = 0L;
 				}
 				else
 					Log(TRACE_MIN, -1, "False returned from messageArrived for client %s, message remains on queue",
@@ -827,25 +879,8 @@ static thread_return_type WINAPI MQTTClient_run(void* n)
 			}
 			if (pack)
 			{
-				if (pack->header.bits.type == CONNACK)
-				{
-					Log(TRACE_MIN, -1, "Posting connack semaphore for client %s", m->c->clientID);
-					m->pack = pack;
-					Thread_post_sem(m->connack_sem);
-				}
-				else if (pack->header.bits.type == SUBACK)
-				{
-					Log(TRACE_MIN, -1, "Posting suback semaphore for client %s", m->c->clientID);
-					m->pack = pack;
-					Thread_post_sem(m->suback_sem);
-				}
-				else if (pack->header.bits.type == UNSUBACK)
-				{
-					Log(TRACE_MIN, -1, "Posting unsuback semaphore for client %s", m->c->clientID);
-					m->pack = pack;
-					Thread_post_sem(m->unsuback_sem);
-				}
-				else if (m->c->MQTTVersion >= MQTTVERSION_5)
+				/* CONNACK, SUBACK and UNSUBACK have been handed to the waiting call by MQTTClient_cycle */
+				if (m->c->MQTTVersion >= MQTTVERSION_5)
 				{
 					if (pack->header.bits.type == DISCONNECT && m->disconnected)
 					{
@@ -906,7 +941,7 @@ static thread_return_type WINAPI MQTTClient_run(void* n)
 						m->c->session = SSL_get1_session(m->c->net.ssl);
 #endif
 #if defined(MBEDTLS)
-						mbedtls_ssl_get_session(m->c->net.ssl, m->c->session);
+						SSLSocket_saveSession(m->c->net.ssl, &m->c->session);
 #endif
 #if defined(OPENSSL) || defined(MBEDTLS)
 					m->rc = rc;
@@ -923,6 +958,8 @@ static thread_return_type WINAPI MQTTClient_run(void* n)
 				Thread_post_sem(m->connect_sem);
 			}
 		}
+		Thread_unlock_mutex(m->mutex);
+		Thread_lock_mutex(mqttclient_mutex);
 	}
 	run_id = 0;
 	running = tostop = 0;
@@ -932,46 +969,48 @@ static thread_return_type WINAPI MQTTClient_run(void* n)
 }
 
 
+/**
+ * Ask the background thread to stop.  It decides itself, in MQTTClient_stopping, whether it is
+ * still needed, so this can be called with a client mutex held.
+ */
 static void MQTTClient_stop(void)
 {
-	int rc = 0;
-
 	FUNC_ENTRY;
-	if (running == 1 && tostop == 0)
-	{
-		int conn_count = 0;
-		ListElement* current = NULL;
+	if (running)
+		tostop = 1;
+	FUNC_EXIT;
+}
 
-		if (handles != NULL)
-		{
-			/* find out how many handles are still connected */
-			while (ListNextElement(handles, &current))
-			{
-				if (((MQTTClients*)(current->content))->c->connect_state > NOT_IN_PROGRESS ||
-						((MQTTClients*)(current->content))->c->connected)
-					++conn_count;
-			}
-		}
-		Log(TRACE_MIN, -1, "Conn_count is %d", conn_count);
-		/* stop the background thread, if we are the last one to be using it */
-		if (conn_count == 0)
+
+/**
+ * Act on a request to stop the background thread.  The thread is only stopped if no client is
+ * connected or connecting, as it is shared by all the clients.
+ * mqttclient_mutex must be locked when you call this function
+ * @return boolean - should the background thread stop?
+ */
+static int MQTTClient_stopping(void)
+{
+	int conn_count = 0;
+	ListElement* current = NULL;
+
+	if (!tostop)
+		return 0;
+	tostop = 0; /* a request made while the clients are looked at is acted on next time */
+	if (handles != NULL)
+	{
+		/* find out how many handles are still connected */
+		while (ListNextElement(handles, &current))
 		{
-			int count = 0;
-			tostop = 1;
-			if (Thread_getid() != run_id)
-			{
-				while (running && ++count < 100)
-				{
-					Thread_unlock_mutex(mqttclient_mutex);
-					Log(TRACE_MIN, -1, "sleeping");
-					MQTTClient_sleep(100L);
-					Thread_lock_mutex(mqttclient_mutex);
-				}
-			}
-			rc = 1;
+			MQTTClients* m = (MQTTClients*)(current->content);
+
+			Thread_lock_mutex(m->mutex);
+			if (m->connecting || m->c->connect_state > NOT_IN_PROGRESS || m->c->connected)
+				++conn_count;
+			Thread_unlock_mutex(m->mutex);
 		}
 	}
-	FUNC_EXIT_RC(rc);
+	Log(TRACE_MIN, -1, "Conn_count is %d", conn_count);
+	return conn_count == 0;
 }
 
 
@@ -982,19 +1021,23 @@ int MQTTClient_setCallbacks(MQTTClient handle, void* context, MQTTClient_connect
 	MQTTClients* m = handle;
 
 	FUNC_ENTRY;
-	Thread_lock_mutex(mqttclient_mutex);
-
-	if (m == NULL || ma == NULL || m->c->connect_state != NOT_IN_PROGRESS)
+	if (m == NULL || ma == NULL)
 		rc = MQTTCLIENT_FAILURE;
 	else
 	{
-		m->context = context;
-		m->cl = cl;
-		m->ma = ma;
-		m->dc = dc;
+		Thread_lock_mutex(m->mutex);
+		if (m->c->connect_state != NOT_IN_PROGRESS)
+			rc = MQTTCLIENT_FAILURE;
+		else
+		{
+			m->context = context;
+			m->cl = cl;
+			m->ma = ma;
+			m->dc = dc;
+		}
+		Thread_unlock_mutex(m->mutex);
 	}
 
-	Thread_unlock_mutex(mqttclient_mutex);
 	FUNC_EXIT_RC(rc);
 	return rc;
 }
@@ -1016,8 +1059,8 @@ static void MQTTClient_closeSession(Clients* client, enum MQTTReasonCodes reason
 		SSLSocket_close(&client->net);
 #endif
 		Socket_close(client->net.socket);
-		Thread_unlock_mutex(socket_mutex);
 		client->net.socket = 0;
+		Thread_unlock_mutex(socket_mutex);
 #if defined(OPENSSL) || defined(MBEDTLS)
 		client->net.ssl = NULL;
 #endif
@@ -1041,6 +1084,8 @@ static int MQTTClient_cleanSession(Clients* client)
 #endif
 	MQTTProtocol_emptyMessageList(client->inboundMsgs);
 	MQTTProtocol_emptyMessageList(client->outboundMsgs);
+	MessageIDs_clear(&client->inboundIDs);
+	MessageIDs_clear(&client->outboundIDs);
 	MQTTClient_emptyMessageQueue(client);
 	client->msgID = 0;
 	FUNC_EXIT_RC(rc);
@@ -1107,17 +1152,6 @@ static MQTTResponse MQTTClient_connectURIVersion(MQTTClient handle, MQTTClient_c
 
 	FUNC_ENTRY;
 	resp.reasonCode = SOCKET_ERROR;
-	if (m->ma && !running)
-	{
-		Thread_start(MQTTClient_run, handle);
-		if (MQTTClient_elapsed(start) >= millisecsTimeout)
-		{
-			rc = SOCKET_ERROR;
-			goto exit;
-		}
-		MQTTClient_sleep(100L);
-	}
-
 	Log(TRACE_MIN, -1, "Connecting to serverURI %s with MQTT version %d", serverURI, MQTTVersion);
 #if defined(OPENSSL) || defined(MBEDTLS)
 	rc = MQTTProtocol_connect(serverURI, m->c, m->ssl, m->websocket, MQTTVersion, connectProperties, willProperties);
@@ -1135,9 +1169,9 @@ static MQTTResponse MQTTClient_connectURIVersion(MQTTClient handle, MQTTClient_c
 
 	if (m->c->connect_state == TCP_IN_PROGRESS) /* TCP connect started - wait for completion */
 	{
-		Thread_unlock_mutex(mqttclient_mutex);
+		Thread_unlock_mutex(m->mutex);
 		MQTTClient_waitfor(handle, CONNECT, &rc, millisecsTimeout - MQTTClient_elapsed(start));
-		Thread_lock_mutex(mqttclient_mutex);
+		Thread_lock_mutex(m->mutex);
 		if (rc != 0)
 		{
 			rc = SOCKET_ERROR;
@@ -1203,7 +1237,7 @@ static MQTTResponse MQTTClient_connectURIVersion(MQTTClient handle, MQTTClient_c
 							m->c->session = SSL_get1_session(m->c->net.ssl);
 #endif
 #if defined(MBEDTLS)
-							mbedtls_ssl_get_session(m->c->net.ssl, m->c->session);
+							SSLSocket_saveSession(m->c->net.ssl, &m->c->session);
 #endif
 #if defined(OPENSSL) || defined(MBEDTLS)
 					}
@@ -1239,9 +1273,9 @@ static MQTTResponse MQTTClient_connectURIVersion(MQTTClient handle, MQTTClient_c
 #if defined(OPENSSL) || defined(MBEDTLS)
 	if (m->c->connect_state == SSL_IN_PROGRESS) /* SSL connect sent - wait for completion */
 	{
-		Thread_unlock_mutex(mqttclient_mutex);
+		Thread_unlock_mutex(m->mutex);
 		MQTTClient_waitfor(handle, CONNECT, &rc, millisecsTimeout - MQTTClient_elapsed(start));
-		Thread_lock_mutex(mqttclient_mutex);
+		Thread_lock_mutex(m->mutex);
 		if (rc != 1)
 		{
 			rc = SOCKET_ERROR;
@@ -1253,7 +1287,7 @@ static MQTTResponse MQTTClient_connectURIVersion(MQTTClient handle, MQTTClient_c
 			m->c->session = SSL_get1_session(m->c->net.ssl);
 #endif
 #if defined(MBEDTLS)
-			mbedtls_ssl_get_session(m->c->net.ssl, m->c->session);
+			SSLSocket_saveSession(m->c->net.ssl, &m->c->session);
 #endif
 #if defined(OPENSSL) || defined(MBEDTLS)
 
@@ -1282,9 +1316,9 @@ static MQTTResponse MQTTClient_connectURIVersion(MQTTClient handle, MQTTClient_c
 
 	if (m->c->connect_state == WEBSOCKET_IN_PROGRESS) /* websocket request sent - wait for upgrade */
 	{
-		Thread_unlock_mutex(mqttclient_mutex);
+		Thread_unlock_mutex(m->mutex);
 		MQTTClient_waitfor(handle, CONNECT, &rc, millisecsTimeout - MQTTClient_elapsed(start));
-		Thread_lock_mutex(mqttclient_mutex);
+		Thread_lock_mutex(m->mutex);
 		m->c->connect_state = WAIT_FOR_CONNACK; /* websocket upgrade complete */
 		if (MQTTPacket_send_connect(m->c, MQTTVersion, connectProperties, willProperties) == SOCKET_ERROR)
 		{
@@ -1296,9 +1330,9 @@ static MQTTResponse MQTTClient_connectURIVersion(MQTTClient handle, MQTTClient_c
 	if (m->c->connect_state == WAIT_FOR_CONNACK) /* MQTT connect sent - wait for CONNACK */
 	{
 		MQTTPacket* pack = NULL;
-		Thread_unlock_mutex(mqttclient_mutex);
+		Thread_unlock_mutex(m->mutex);
 		pack = MQTTClient_waitfor(handle, CONNACK, &rc, millisecsTimeout - MQTTClient_elapsed(start));
-		Thread_lock_mutex(mqttclient_mutex);
+		Thread_lock_mutex(m->mutex);
 		if (pack == NULL)
 			rc = SOCKET_ERROR;
 		else
@@ -1310,6 +1344,7 @@ static MQTTResponse MQTTClient_connectURIVersion(MQTTClient handle, MQTTClient_c
 				m->c->connected = 1;
 				m->c->good = 1;
 				m->c->connect_state = NOT_IN_PROGRESS;
+				MQTTProtocol_setTopicAliasMax(m->c, (m->c->MQTTVersion >= MQTTVERSION_5) ? &connack->properties : NULL);
 				if (MQTTVersion == 4)
 					sessionPresent = connack->flags.bits.sessionPresent;
 				if (m->c->cleansession || m->c->cleanstart)
@@ -1323,7 +1358,7 @@ static MQTTResponse MQTTClient_connectURIVersion(MQTTClient handle, MQTTClient_c
 						Messages* m = (Messages*)(outcurrent->content);
 						m->lastTouch = 0;
 					}
-					MQTTProtocol_retry((time_t)0, 1, 1);
+					MQTTProtocol_retryClient((time_t)0, m->c, 1, 1);
 					if (m->c->connected != 1)
 						rc = MQTTCLIENT_DISCONNECTED;
 				}
@@ -1386,7 +1421,6 @@ static MQTTResponse MQTTClient_connectURI(MQTTClient handle, MQTTClient_connectO
 
 	m->c->keepAliveInterval = options->keepAliveInterval;
 	m->c->retryInterval = options->retryInterval;
-	setRetryLoopInterval(options->keepAliveInterval);
 	m->c->MQTTVersion = options->MQTTVersion;
 	m->c->cleanstart = m->c->cleansession = 0;
 	if (m->c->MQTTVersion >= MQTTVERSION_5)
@@ -1586,8 +1620,19 @@ MQTTResponse MQTTClient_connectAll(MQTTClient handle, MQTTClient_connectOptions*
 	MQTTResponse rc = MQTTResponse_initializer;
 
 	FUNC_ENTRY;
-	Thread_lock_mutex(connect_mutex);
+	Thread_lock_mutex(m->connect_mutex);
 	Thread_lock_mutex(mqttclient_mutex);
+	m->connecting = 1; /* keeps the background thread from stopping while this client connects */
+	if (options != NULL)
+		setRetryLoopInterval(options->keepAliveInterval);
+	if (m->ma && !running)
+	{
+		running = 1;
+		tostop = 0;
+		Thread_start(MQTTClient_run, handle);
+	}
+	Thread_unlock_mutex(mqttclient_mutex);
+	Thread_lock_mutex(m->mutex);
 
 	rc.reasonCode = SOCKET_ERROR;
 	if (options == NULL)
@@ -1721,15 +1766,20 @@ exit:
 		free(m->c->will);
 		m->c->will = NULL;
 	}
+	Thread_unlock_mutex(m->mutex);
+	Thread_lock_mutex(mqttclient_mutex);
+	m->connecting = 0;
 	Thread_unlock_mutex(mqttclient_mutex);
-	Thread_unlock_mutex(connect_mutex);
+	if (rc.reasonCode != MQTTCLIENT_SUCCESS)
+		MQTTClient_stop();
+	Thread_unlock_mutex(m->connect_mutex);
 	FUNC_EXIT_RC(rc.reasonCode);
 	return rc;
 }
 
 
 /**
- * mqttclient_mutex must be locked when you call this function, if multi threaded
+ * The client mutex, m->mutex, must be locked when you call this function, if multi threaded
  */
 static int MQTTClient_disconnect1(MQTTClient handle, int timeout, int call_connection_lost, int stop,
 		enum MQTTReasonCodes reason, MQTTProperties* props)
@@ -1754,9 +1804,9 @@ static int MQTTClient_disconnect1(MQTTClient handle, int timeout, int call_conne
 		{ /* wait for all inflight message flows to finish, up to timeout */
 			if (MQTTClient_elapsed(start) >= timeout)
 				break;
-			Thread_unlock_mutex(mqttclient_mutex);
+			Thread_unlock_mutex(m->mutex);
 			MQTTClient_yield();
-			Thread_lock_mutex(mqttclient_mutex);
+			Thread_lock_mutex(m->mutex);
 		}
 	}
 
@@ -1776,7 +1826,7 @@ exit:
 
 
 /**
- * mqttclient_mutex must be locked when you call this function, if multi threaded
+ * The client mutex, m->mutex, must be locked when you call this function, if multi threaded
  */
 static int MQTTClient_disconnect_internal(MQTTClient handle, int timeout)
 {
@@ -1785,7 +1835,7 @@ static int MQTTClient_disconnect_internal(MQTTClient handle, int timeout)
 
 
 /**
- * mqttclient_mutex must be locked when you call this function, if multi threaded
+ * The client mutex, m->mutex, must be locked when you call this function, if multi threaded
  */
 void MQTTProtocol_closeSession(Clients* c, int sendwill)
 {
@@ -1796,22 +1846,30 @@ void MQTTProtocol_closeSession(Clients* c, int sendwill)
 
 int MQTTClient_disconnect(MQTTClient handle, int timeout)
 {
-	int rc = 0;
+	MQTTClients* m = handle;
+	int rc = MQTTCLIENT_FAILURE;
 
-	Thread_lock_mutex(mqttclient_mutex);
-	rc = MQTTClient_disconnect1(handle, timeout, 0, 1, MQTTREASONCODE_SUCCESS, NULL);
-	Thread_unlock_mutex(mqttclient_mutex);
+	if (m != NULL)
+	{
+		Thread_lock_mutex(m->mutex);
+		rc = MQTTClient_disconnect1(handle, timeout, 0, 1, MQTTREASONCODE_SUCCESS, NULL);
+		Thread_unlock_mutex(m->mutex);
+	}
 	return rc;
 }
 
 
 int MQTTClient_disconnect5(MQTTClient handle, int timeout, enum MQTTReasonCodes reason, MQTTProperties* props)
 {
-	int rc = 0;
+	MQTTClients* m = handle;
+	int rc = MQTTCLIENT_FAILURE;
 
-	Thread_lock_mutex(mqttclient_mutex);
-	rc = MQTTClient_disconnect1(handle, timeout, 0, 1, reason, props);
-	Thread_unlock_mutex(mqttclient_mutex);
+	if (m != NULL)
+	{
+		Thread_lock_mutex(m->mutex);
+		rc = MQTTClient_disconnect1(handle, timeout, 0, 1, reason, props);
+		Thread_unlock_mutex(m->mutex);
+	}
 	return rc;
 }
 
@@ -1822,15 +1880,53 @@ int MQTTClient_isConnected(MQTTClient handle)
 	int rc = 0;
 
 	FUNC_ENTRY;
-	Thread_lock_mutex(mqttclient_mutex);
 	if (m && m->c)
+	{
+		Thread_lock_mutex(m->mutex);
 		rc = m->c->connected;
-	Thread_unlock_mutex(mqttclient_mutex);
+		Thread_unlock_mutex(m->mutex);
+	}
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+int MQTTClient_getPublishStats(MQTTClient handle, MQTTClient_publishStats* stats)
+{
+	MQTTClients* m = handle;
+	int rc = MQTTCLIENT_FAILURE;
+
+	FUNC_ENTRY;
+	if (m && m->c && stats)
+	{
+		Thread_lock_mutex(m->mutex);
+		stats->count = m->c->publishCount;
+		stats->aliased = m->c->publishAliased;
+		stats->bytes = m->c->publishBytes;
+		Thread_unlock_mutex(m->mutex);
+		rc = MQTTCLIENT_SUCCESS;
+	}
 	FUNC_EXIT_RC(rc);
 	return rc;
 }
 
 
+void MQTTClient_cork(void)
+{
+	FUNC_ENTRY;
+	Socket_cork();
+	FUNC_EXIT;
+}
+
+
+void MQTTClient_uncork(void)
+{
+	FUNC_ENTRY;
+	Socket_uncork();
+	FUNC_EXIT;
+}
+
+
 MQTTResponse MQTTClient_subscribeMany5(MQTTClient handle, int count, char* const* topic,
 		int* qos, MQTTSubscribe_options* opts, MQTTProperties* props)
 {
@@ -1843,38 +1939,38 @@ MQTTResponse MQTTClient_subscribeMany5(MQTTClient handle, int count, char* const
 	int msgid = 0;
 
 	FUNC_ENTRY;
-	Thread_lock_mutex(subscribe_mutex);
-	Thread_lock_mutex(mqttclient_mutex);
-
 	resp.reasonCode = MQTTCLIENT_FAILURE;
 	if (m == NULL || m->c == NULL)
 	{
 		rc = MQTTCLIENT_FAILURE;
 		goto exit;
 	}
+	Thread_lock_mutex(m->subscribe_mutex);
+	Thread_lock_mutex(m->mutex);
+
 	if (m->c->connected == 0)
 	{
 		rc = MQTTCLIENT_DISCONNECTED;
-		goto exit;
+		goto unlock;
 	}
 	for (i = 0; i < count; i++)
 	{
 		if (!UTF8_validateString(topic[i]))
 		{
 			rc = MQTTCLIENT_BAD_UTF8_STRING;
-			goto exit;
+			goto unlock;
 		}
 
 		if (qos[i] < 0 || qos[i] > 2)
 		{
 			rc = MQTTCLIENT_BAD_QOS;
-			goto exit;
+			goto unlock;
 		}
 	}
 	if ((msgid = MQTTProtocol_assignMsgId(m->c)) == 0)
 	{
 		rc = MQTTCLIENT_MAX_MESSAGES_INFLIGHT;
-		goto exit;
+		goto unlock;
 	}
 
 	topics = ListInitialize();
@@ -1893,9 +1989,9 @@ MQTTResponse MQTTClient_subscribeMany5(MQTTClient handle, int count, char* const
 	{
 		MQTTPacket* pack = NULL;
 
-		Thread_unlock_mutex(mqttclient_mutex);
+		Thread_unlock_mutex(m->mutex);
 		pack = MQTTClient_waitfor(handle, SUBACK, &rc, 10000L);
-		Thread_lock_mutex(mqttclient_mutex);
+		Thread_lock_mutex(m->mutex);
 		if (pack != NULL)
 		{
 			Suback* sub = (Suback*)pack;
@@ -1942,11 +2038,12 @@ MQTTResponse MQTTClient_subscribeMany5(MQTTClient handle, int count, char* const
 	else if (rc == TCPSOCKET_COMPLETE)
 		rc = MQTTCLIENT_SUCCESS;
 
+unlock:
+	Thread_unlock_mutex(m->mutex);
+	Thread_unlock_mutex(m->subscribe_mutex);
 exit:
 	if (rc < 0)
 		resp.reasonCode = rc;
-	Thread_unlock_mutex(mqttclient_mutex);
-	Thread_unlock_mutex(subscribe_mutex);
 	FUNC_EXIT_RC(resp.reasonCode);
 	return resp;
 }
@@ -2007,32 +2104,32 @@ MQTTResponse MQTTClient_unsubscribeMany5(MQTTClient handle, int count, char* con
 	int msgid = 0;
 
 	FUNC_ENTRY;
-	Thread_lock_mutex(unsubscribe_mutex);
-	Thread_lock_mutex(mqttclient_mutex);
-
 	resp.reasonCode = MQTTCLIENT_FAILURE;
 	if (m == NULL || m->c == NULL)
 	{
 		rc = MQTTCLIENT_FAILURE;
 		goto exit;
 	}
+	Thread_lock_mutex(m->unsubscribe_mutex);
+	Thread_lock_mutex(m->mutex);
+
 	if (m->c->connected == 0)
 	{
 		rc = MQTTCLIENT_DISCONNECTED;
-		goto exit;
+		goto unlock;
 	}
 	for (i = 0; i < count; i++)
 	{
 		if (!UTF8_validateString(topic[i]))
 		{
 			rc = MQTTCLIENT_BAD_UTF8_STRING;
-			goto exit;
+			goto unlock;
 		}
 	}
 	if ((msgid = MQTTProtocol_assignMsgId(m->c)) == 0)
 	{
 		rc = MQTTCLIENT_MAX_MESSAGES_INFLIGHT;
-		goto exit;
+		goto unlock;
 	}
 
 	topics = ListInitialize();
@@ -2045,9 +2142,9 @@ MQTTResponse MQTTClient_unsubscribeMany5(MQTTClient handle, int count, char* con
 	{
 		MQTTPacket* pack = NULL;
 
-		Thread_unlock_mutex(mqttclient_mutex);
+		Thread_unlock_mutex(m->mutex);
 		pack = MQTTClient_waitfor(handle, UNSUBACK, &rc, 10000L);
-		Thread_lock_mutex(mqttclient_mutex);
+		Thread_lock_mutex(m->mutex);
 		if (pack != NULL)
 		{
 			Unsuback* unsub = (Unsuback*)pack;
@@ -2083,11 +2180,12 @@ MQTTResponse MQTTClient_unsubscribeMany5(MQTTClient handle, int count, char* con
 	if (rc == SOCKET_ERROR)
 		MQTTClient_disconnect_internal(handle, 0);
 
+unlock:
+	Thread_unlock_mutex(m->mutex);
+	Thread_unlock_mutex(m->unsubscribe_mutex);
 exit:
 	if (rc < 0)
 		resp.reasonCode = rc;
-	Thread_unlock_mutex(mqttclient_mutex);
-	Thread_unlock_mutex(unsubscribe_mutex);
 	FUNC_EXIT_RC(resp.reasonCode);
 	return resp;
 }
@@ -2131,17 +2229,20 @@ MQTTResponse MQTTClient_publish5(MQTTClient handle, const char* topicName, int p
 	MQTTResponse resp = MQTTResponse_initializer;
 
 	FUNC_ENTRY;
-	Thread_lock_mutex(mqttclient_mutex);
-
 	if (m == NULL || m->c == NULL)
+	{
 		rc = MQTTCLIENT_FAILURE;
-	else if (m->c->connected == 0)
+		goto exit;
+	}
+	Thread_lock_mutex(m->mutex);
+
+	if (m->c->connected == 0)
 		rc = MQTTCLIENT_DISCONNECTED;
 	else if (!UTF8_validateString(topicName))
 		rc = MQTTCLIENT_BAD_UTF8_STRING;
 
 	if (rc != MQTTCLIENT_SUCCESS)
-		goto exit;
+		goto unlock;
 
 	/* If outbound queue is full, block until it is not */
 	while (m->c->outboundMsgs->count >= m->c->maxInflightMessages ||
@@ -2152,13 +2253,13 @@ MQTTResponse MQTTClient_publish5(MQTTClient handle, const char* topicName, int p
 			blocked = 1;
 			Log(TRACE_MIN, -1, "Blocking publish on queue full for client %s", m->c->clientID);
 		}
-		Thread_unlock_mutex(mqttclient_mutex);
+		Thread_unlock_mutex(m->mutex);
 		MQTTClient_yield();
-		Thread_lock_mutex(mqttclient_mutex);
+		Thread_lock_mutex(m->mutex);
 		if (m->c->connected == 0)
 		{
 			rc = MQTTCLIENT_FAILURE;
-			goto exit;
+			goto unlock;
 		}
 	}
 	if (blocked == 1)
@@ -2166,7 +2267,7 @@ MQTTResponse MQTTClient_publish5(MQTTClient handle, const char* topicName, int p
 	if (qos > 0 && (msgid = MQTTProtocol_assignMsgId(m->c)) == 0)
 	{	/* this should never happen as we've waited for spaces in the queue */
 		rc = MQTTCLIENT_MAX_MESSAGES_INFLIGHT;
-		goto exit;
+		goto unlock;
 	}
 
 	p = malloc(sizeof(Publish) + payloadlen);
@@ -2201,11 +2302,11 @@ MQTTResponse MQTTClient_publish5(MQTTClient handle, const char* topicName, int p
 	 */
 	if (rc == TCPSOCKET_INTERRUPTED)
 	{
-		while (m->c->connected == 1 && SocketBuffer_getWrite(m->c->net.socket))
+		while (m->c->connected == 1 && !Socket_noPendingWrites(m->c->net.socket))
 		{
-			Thread_unlock_mutex(mqttclient_mutex);
+			Thread_unlock_mutex(m->mutex);
 			MQTTClient_yield();
-			Thread_lock_mutex(mqttclient_mutex);
+			Thread_lock_mutex(m->mutex);
 		}
 		rc = (qos > 0 || m->c->connected == 1) ? MQTTCLIENT_SUCCESS : MQTTCLIENT_FAILURE;
 	}
@@ -2223,8 +2324,9 @@ MQTTResponse MQTTClient_publish5(MQTTClient handle, const char* topicName, int p
 		rc = (qos > 0) ? MQTTCLIENT_SUCCESS : MQTTCLIENT_FAILURE;
 	}
 
+unlock:
+	Thread_unlock_mutex(m->mutex);
 exit:
-	Thread_unlock_mutex(mqttclient_mutex);
 	resp.reasonCode = rc;
 	FUNC_EXIT_RC(resp.reasonCode);
 	return resp;
@@ -2300,14 +2402,25 @@ static void MQTTClient_retry(void)
 
 	FUNC_ENTRY;
 	time(&(now));
+	Thread_lock_mutex(mqttclient_mutex);
 	if (difftime(now, last) > retryLoopInterval)
 	{
+		ListElement* current = NULL;
+
 		time(&(last));
-		MQTTProtocol_keepalive(now);
-		MQTTProtocol_retry(now, 1, 0);
+		/* each client is retried under its own mutex; sessions which are no longer good are closed
+		 * by the thread handling their packets, in MQTTClient_cycle */
+		while (ListNextElement(handles, &current))
+		{
+			MQTTClients* m = (MQTTClients*)(current->content);
+
+			Thread_lock_mutex(m->mutex);
+			MQTTProtocol_keepaliveClient(now, m->c);
+			MQTTProtocol_retryClient(now, m->c, 1, 0);
+			Thread_unlock_mutex(m->mutex);
+		}
 	}
-	else
-		MQTTProtocol_retry(now, 0, 0);
+	Thread_unlock_mutex(mqttclient_mutex);
 	FUNC_EXIT;
 }
 
@@ -2315,8 +2428,9 @@ static void MQTTClient_retry(void)
 static MQTTPacket* MQTTClient_cycle(int* sock, unsigned long timeout, int* rc)
 {
 	struct timeval tp = {0L, 0L};
-	static Ack ack;
+	Ack ack;
 	MQTTPacket* pack = NULL;
+	MQTTClients* m = NULL;
 
 	FUNC_ENTRY;
 	if (timeout > 0L)
@@ -2334,25 +2448,34 @@ static MQTTPacket* MQTTClient_cycle(int* sock, unsigned long timeout, int* rc)
 #if defined(OPENSSL) || defined(MBEDTLS)
 	}
 #endif
-	Thread_lock_mutex(mqttclient_mutex);
 	if (*sock > 0)
 	{
-		MQTTClients* m = NULL;
-		if (ListFindItem(handles, sock, clientSockCompare) != NULL)
-			m = (MQTTClient)(handles->current->content);
-		if (m != NULL)
+		Thread_lock_mutex(mqttclient_mutex);
+		if ((m = MQTTClient_findHandle(*sock)) != NULL)
+			Thread_lock_mutex(m->mutex);
+		Thread_unlock_mutex(mqttclient_mutex);
+	}
+	if (m != NULL)
+	{
+		/* the socket buffers are shared by all the clients, so packets are read one at a time */
+		Thread_lock_mutex(socket_mutex);
+		if (m->c->connect_state == TCP_IN_PROGRESS || m->c->connect_state == SSL_IN_PROGRESS)
+			*rc = 0;  /* waiting for connect state to clear */
+		else if (m->c->connect_state == WEBSOCKET_IN_PROGRESS)
+			*rc = WebSocket_upgrade(&m->c->net);
+#if defined(OPENSSL) || defined(MBEDTLS)
+		else if (m->c->net.ssl == NULL && !Socket_readable(*sock))
+#else
+		else if (!Socket_readable(*sock))
+#endif
+			*rc = 0;  /* another thread read it first */
+		else
 		{
-			if (m->c->connect_state == TCP_IN_PROGRESS || m->c->connect_state == SSL_IN_PROGRESS)
-				*rc = 0;  /* waiting for connect state to clear */
-			else if (m->c->connect_state == WEBSOCKET_IN_PROGRESS)
-				*rc = WebSocket_upgrade(&m->c->net);
-			else
-			{
-				pack = MQTTPacket_Factory(m->c->MQTTVersion, &m->c->net, rc);
-				if (*rc == TCPSOCKET_INTERRUPTED)
-					*rc = 0;
-			}
+			pack = MQTTPacket_Factory(m->c->MQTTVersion, &m->c->net, rc);
+			if (*rc == TCPSOCKET_INTERRUPTED)
+				*rc = 0;
 		}
+		Thread_unlock_mutex(socket_mutex);
 
 		if (pack)
 		{
@@ -2367,14 +2490,14 @@ static MQTTPacket* MQTTClient_cycle(int* sock, unsigned long timeout, int* rc)
 
 				ack = (pack->header.bits.type == PUBCOMP) ? *(Pubcomp*)pack : *(Puback*)pack;
 				msgid = ack.msgId;
-				if (m && m->c->MQTTVersion >= MQTTVERSION_5 && m->published)
+				if (m->c->MQTTVersion >= MQTTVERSION_5 && m->published)
 				{
 					Log(TRACE_MIN, -1, "Calling published for client %s, msgid %d", m->c->clientID, msgid);
 					(*(m->published))(m->published_context, msgid, pack->header.bits.type, &ack.properties, ack.rc);
 				}
 				*rc = (pack->header.bits.type == PUBCOMP) ?
 					MQTTProtocol_handlePubcomps(pack, *sock) : MQTTProtocol_handlePubacks(pack, *sock);
-				if (m && m->dc)
+				if (m->dc)
 				{
 					Log(TRACE_MIN, -1, "Calling deliveryComplete for client %s, msgid %d", m->c->clientID, msgid);
 					(*(m->dc))(m->context, msgid);
@@ -2384,9 +2507,9 @@ static MQTTPacket* MQTTClient_cycle(int* sock, unsigned long timeout, int* rc)
 			{
 				Pubrec* pubrec = (Pubrec*)pack;
 
-				if (m && m->c->MQTTVersion >= MQTTVERSION_5 && m->published && pubrec->rc >= MQTTREASONCODE_UNSPECIFIED_ERROR)
+				if (m->c->MQTTVersion >= MQTTVERSION_5 && m->published && pubrec->rc >= MQTTREASONCODE_UNSPECIFIED_ERROR)
 				{
-					Log(TRACE_MIN, -1, "Calling published for client %s, msgid %d", m->c->clientID, ack.msgId);
+					Log(TRACE_MIN, -1, "Calling published for client %s, msgid %d", m->c->clientID, pubrec->msgId);
 					(*(m->published))(m->published_context, pubrec->msgId, pack->header.bits.type,
 							&pubrec->properties, pubrec->rc);
 				}
@@ -2396,14 +2519,29 @@ static MQTTPacket* MQTTClient_cycle(int* sock, unsigned long timeout, int* rc)
 				*rc = MQTTProtocol_handlePubrels(pack, *sock);
 			else if (pack->header.bits.type == PINGRESP)
 				*rc = MQTTProtocol_handlePingresps(pack, *sock);
+			else if (pack->header.bits.type == CONNACK || pack->header.bits.type == SUBACK ||
+					pack->header.bits.type == UNSUBACK)
+			{
+				/* hand the acknowledgement to the call waiting for it, which may be on another thread */
+				Log(TRACE_MIN, -1, "Posting %s semaphore for client %s",
+					MQTTPacket_name(pack->header.bits.type), m->c->clientID);
+				m->pack = pack;
+				if (pack->header.bits.type == CONNACK)
+					Thread_post_sem(m->connack_sem);
+				else if (pack->header.bits.type == SUBACK)
+					Thread_post_sem(m->suback_sem);
+				else
+					Thread_post_sem(m->unsuback_sem);
+			}
 			else
 				freed = 0;
 			if (freed)
 				pack = NULL;
 		}
+		MQTTProtocol_retryClient((time_t)0, m->c, 0, 0); /* close the session if it is no longer good */
+		Thread_unlock_mutex(m->mutex);
 	}
 	MQTTClient_retry();
-	Thread_unlock_mutex(mqttclient_mutex);
 	FUNC_EXIT_RC(*rc);
 	return pack;
 }
@@ -2424,6 +2562,7 @@ static MQTTPacket* MQTTClient_waitfor(MQTTClient handle, int packet_type, int* r
 
 	if (running)
 	{
+		Socket_flush(); /* the receive thread may be in its wait already */
 		if (packet_type == CONNECT)
 		{
 			if ((*rc = Thread_wait_sem(m->connect_sem, timeout)) == 0)
@@ -2446,12 +2585,19 @@ static MQTTPacket* MQTTClient_waitfor(MQTTClient handle, int packet_type, int* r
 		{
 			int sock = -1;
 			pack = MQTTClient_cycle(&sock, 100L, rc);
+			/* the acknowledgement is handed over by whichever thread read it */
+			if ((packet_type == CONNACK && Thread_check_sem(m->connack_sem)) ||
+					(packet_type == SUBACK && Thread_check_sem(m->suback_sem)) ||
+					(packet_type == UNSUBACK && Thread_check_sem(m->unsuback_sem)))
+			{
+				*rc = TCPSOCKET_COMPLETE;
+				pack = m->pack;
+				break;
+			}
 			if (sock == m->c->net.socket)
 			{
 				if (*rc == SOCKET_ERROR)
 					break;
-				if (pack && (pack->header.bits.type == packet_type))
-					break;
 				if (m->c->connect_state == TCP_IN_PROGRESS)
 				{
 					int error;
@@ -2479,7 +2625,7 @@ static MQTTPacket* MQTTClient_waitfor(MQTTClient handle, int packet_type, int* r
 							m->c->session = SSL_get1_session(m->c->net.ssl);
 #endif
 #if defined(MBEDTLS)
-							mbedtls_ssl_get_session(m->c->net.ssl, m->c->session);
+							SSLSocket_saveSession(m->c->net.ssl, &m->c->session);
 #endif
 #if defined(OPENSSL) || defined(MBEDTLS)
 						break;
@@ -2553,21 +2699,20 @@ int MQTTClient_receive(MQTTClient handle, char** topicName, int* topicLen, MQTTC
 		int sock = 0;
 		MQTTClient_cycle(&sock, (timeout > elapsed) ? timeout - elapsed : 0L, &rc);
 
-		if (rc == SOCKET_ERROR)
-		{
-			if (ListFindItem(handles, &sock, clientSockCompare) && 	/* find client corresponding to socket */
-			  (MQTTClient)(handles->current->content) == handle)
-				break; /* there was an error on the socket we are interested in */
-		}
+		if (rc == SOCKET_ERROR && sock > 0 && sock == m->c->net.socket)
+			break; /* there was an error on the socket we are interested in */
 		elapsed = MQTTClient_elapsed(start);
 	}
 	while (elapsed < timeout && m->c->messageQueue->count == 0);
 
+	/* the queue is filled by whichever thread reads the messages */
+	Thread_lock_mutex(m->mutex);
 	if (m->c->messageQueue->count > 0)
 		rc = MQTTClient_deliverMessage(rc, m, topicName, topicLen, message);
 
 	if (rc == SOCKET_ERROR)
 		MQTTClient_disconnect_internal(handle, 0);
+	Thread_unlock_mutex(m->mutex);
 
 exit:
 	FUNC_EXIT_RC(rc);
@@ -2585,6 +2730,7 @@ void MQTTClient_yield(void)
 	FUNC_ENTRY;
 	if (running) /* yield is not meant to be called in a multi-thread environment */
 	{
+		Socket_flush(); /* what is waited for may be the answer to corked packets */
 		MQTTClient_sleep(timeout);
 		goto exit;
 	}
@@ -2594,14 +2740,21 @@ void MQTTClient_yield(void)
 	{
 		int sock = -1;
 		MQTTClient_cycle(&sock, (timeout > elapsed) ? timeout - elapsed : 0L, &rc);
-		Thread_lock_mutex(mqttclient_mutex);
-		if (rc == SOCKET_ERROR && ListFindItem(handles, &sock, clientSockCompare))
+		if (rc == SOCKET_ERROR)
 		{
-			MQTTClients* m = (MQTTClient)(handles->current->content);
-			if (m->c->connect_state != DISCONNECTING)
-				MQTTClient_disconnect_internal(m, 0);
+			MQTTClients* m = NULL;
+
+			Thread_lock_mutex(mqttclient_mutex);
+			if ((m = MQTTClient_findHandle(sock)) != NULL)
+				Thread_lock_mutex(m->mutex);
+			Thread_unlock_mutex(mqttclient_mutex);
+			if (m != NULL)
+			{
+				if (m->c->connect_state != DISCONNECTING)
+					MQTTClient_disconnect_internal(m, 0);
+				Thread_unlock_mutex(m->mutex);
+			}
 		}
-		Thread_unlock_mutex(mqttclient_mutex);
 		elapsed = MQTTClient_elapsed(start);
 	}
 	while (elapsed < timeout);
@@ -2625,13 +2778,12 @@ int MQTTClient_waitForCompletion(MQTTClient handle, MQTTClient_deliveryToken mdt
 	MQTTClients* m = handle;
 
 	FUNC_ENTRY;
-	Thread_lock_mutex(mqttclient_mutex);
-
 	if (m == NULL || m->c == NULL)
 	{
 		rc = MQTTCLIENT_FAILURE;
 		goto exit;
 	}
+	Thread_lock_mutex(m->mutex);
 
 	elapsed = MQTTClient_elapsed(start);
 	while (elapsed < timeout)
@@ -2639,21 +2791,22 @@ int MQTTClient_waitForCompletion(MQTTClient handle, MQTTClient_deliveryToken mdt
 		if (m->c->connected == 0)
 		{
 			rc = MQTTCLIENT_DISCONNECTED;
-			goto exit;
+			goto unlock;
 		}
 		if (ListFindItem(m->c->outboundMsgs, &mdt, messageIDCompare) == NULL)
 		{
 			rc = MQTTCLIENT_SUCCESS; /* well we couldn't find it */
-			goto exit;
+			goto unlock;
 		}
-		Thread_unlock_mutex(mqttclient_mutex);
+		Thread_unlock_mutex(m->mutex);
 		MQTTClient_yield();
-		Thread_lock_mutex(mqttclient_mutex);
+		Thread_lock_mutex(m->mutex);
 		elapsed = MQTTClient_elapsed(start);
 	}
 
+unlock:
+	Thread_unlock_mutex(m->mutex);
 exit:
-	Thread_unlock_mutex(mqttclient_mutex);
 	FUNC_EXIT_RC(rc);
 	return rc;
 }
@@ -2666,13 +2819,12 @@ int MQTTClient_getPendingDeliveryTokens(MQTTClient handle, MQTTClient_deliveryTo
 	*tokens = NULL;
 
 	FUNC_ENTRY;
-	Thread_lock_mutex(mqttclient_mutex);
-
 	if (m == NULL)
 	{
 		rc = MQTTCLIENT_FAILURE;
 		goto exit;
 	}
+	Thread_lock_mutex(m->mutex);
 
 	if (m->c && m->c->outboundMsgs->count > 0)
 	{
@@ -2688,9 +2840,9 @@ int MQTTClient_getPendingDeliveryTokens(MQTTClient handle, MQTTClient_deliveryTo
 		}
 		(*tokens)[count] = -1;
 	}
+	Thread_unlock_mutex(m->mutex);
 
 exit:
-	Thread_unlock_mutex(mqttclient_mutex);
 	FUNC_EXIT_RC(rc);
 	return rc;
 }
@@ -2796,6 +2948,7 @@ const char* MQTTClient_strerror(int code)
 static void MQTTProtocol_checkPendingWrites(void)
 {
 	FUNC_ENTRY;
+	Thread_lock_mutex(socket_mutex);
 	if (state.pending_writes.count > 0)
 	{
 		ListElement* le = state.pending_writes.first;
@@ -2812,6 +2965,7 @@ static void MQTTProtocol_checkPendingWrites(void)
 				ListNextElement(&(state.pending_writes), &le);
 		}
 	}
+	Thread_unlock_mutex(socket_mutex);
 	FUNC_EXIT;
 }
 
@@ -2819,7 +2973,7 @@ static void MQTTProtocol_checkPendingWrites(void)
 static void MQTTClient_writeComplete(int socket, int rc)
 {
     (void)rc;
-	ListElement* found = NULL;
+	Clients* client = NULL;
 
 	FUNC_ENTRY;
 	/* a partial write is now complete for a socket - this will be on a publish*/
@@ -2827,11 +2981,7 @@ static void MQTTClient_writeComplete(int socket, int rc)
 	MQTTProtocol_checkPendingWrites();
 
 	/* find the client using this socket */
-	if ((found = ListFindItem(handles, &socket, clientSockCompare)) != NULL)
-	{
-		MQTTClients* m = (MQTTClients*)(found->content);
-
-		time(&(m->c->net.lastSent));
-	}
+	if ((client = MQTTProtocol_findClient(socket)) != NULL)
+		time(&(client->net.lastSent));
 	FUNC_EXIT;
 }
@@ -763,7 +763,11 @@ typedef struct
 
 } MQTTClient_SSLOptions;
 
+#if defined (__LITEOS__)
 #define MQTTClient_SSLOptions_initializer { {'M', 'Q', 'T', 'S'}, 4, NULL, NULL, NULL, NULL, NULL, 1, MQTT_SSL_VERSION_DEFAULT, 0, NULL, NULL, NULL, NULL, NULL, 0, NULL, NULL, NULL }
+#else
+#define MQTTClient_SSLOptions_initializer { {'M', 'Q', 'T', 'S'}, 4, NULL, NULL, NULL, NULL, NULL, 1, MQTT_SSL_VERSION_DEFAULT, 0, NULL, NULL, NULL, NULL, NULL, 0 }
+#endif
 
 /**
  * MQTTClient_connectOptions defines several settings that control the way the
@@ -1013,6 +1017,46 @@ DLLExport int MQTTClient_disconnect5(MQTTClient handle, int timeout, enum MQTTRe
   */
 DLLExport int MQTTClient_isConnected(MQTTClient handle);
 
+/**
+ * The PUBLISH packets a client sent, see MQTTClient_getPublishStats()
+ */
+typedef struct
+{
+	unsigned int count;		/**< PUBLISH packets sent since the client was created, the retries included */
+	unsigned int aliased;	/**< of them, those sent with an MQTT 5 topic alias in place of the topic */
+	unsigned long long bytes;	/**< their bytes on the network, the fixed headers included */
+} MQTTClient_publishStats;
+
+/**
+  * This function returns how many PUBLISH packets the client sent and their size, so that
+  * the saving of the MQTT 5 topic aliases can be seen. The size is that of the MQTT packets,
+  * without the TCP or TLS overhead.
+  * @param handle A valid client handle from a successful call to
+  * MQTTClient_create().
+  * @param stats Set to the counts of the client.
+  * @return ::MQTTCLIENT_SUCCESS, or ::MQTTCLIENT_FAILURE if the handle is not valid.
+  */
+DLLExport int MQTTClient_getPublishStats(MQTTClient handle, MQTTClient_publishStats* stats);
+
+/**
+  * This function holds back the packets the calling thread sends from now on, through any
+  * client, so that several of them go to the network in one write. They are written once the
+  * library's threshold of bytes is held for a connection, once the first of them is older than
+  * the library's latency cap when the next one is sent, when the thread waits for a reply from
+  * the server, and at the matching MQTTClient_uncork(). A packet another thread sends on the
+  * connection, a PUBACK of the background thread for instance, takes the held ones with it.
+  * Call MQTTClient_uncork() before blocking on anything else, what is held is not written
+  * meanwhile. The calls nest. This does nothing unless the library is built with
+  * SOCKETBUFFER_CORK, the threshold, set; SOCKETBUFFER_CORK_USECS is the latency cap.
+  */
+DLLExport void MQTTClient_cork(void);
+
+/**
+  * This function undoes an MQTTClient_cork() of the calling thread, the last one writes the
+  * packets held back.
+  */
+DLLExport void MQTTClient_uncork(void);
+
 
 /* Subscribe is synchronous.  QoS list parameter is changed on return to granted QoSs.
    Returns return code, MQTTCLIENT_SUCCESS == success, non-zero some sort of error (TBD) */
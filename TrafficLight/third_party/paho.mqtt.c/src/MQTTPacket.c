@@ -988,21 +988,29 @@ exit:
 }
 
 
-static char* bufptr;
-
-int bufchar(char* c, int count)
-{
-	int i;
-
-	for (i = 0; i < count; ++i)
-		*c = *bufptr++;
-	return count;
-}
-
-
+/**
+ * Decodes a variable byte integer from a buffer, as MQTTPacket_VBIdecode does from a data source.
+ * The buffer is read directly rather than through a static read pointer, as properties are
+ * decoded by clients on different threads.
+ * @param buf the buffer to read from
+ * @param value the decoded value returned
+ * @return the number of bytes read from the buffer
+ */
 int MQTTPacket_decodeBuf(char* buf, unsigned int* value)
 {
-	bufptr = buf;
-	return MQTTPacket_VBIdecode(bufchar, value);
+	char c = 0;
+	int multiplier = 1;
+	int len = 0;
+
+	*value = 0;
+	do
+	{
+		if (++len > MAX_NO_OF_REMAINING_LENGTH_BYTES)
+			break;	/* bad data */
+		c = buf[len - 1];
+		*value += (c & 127) * multiplier;
+		multiplier *= 128;
+	} while ((c & 128) != 0);
+	return len;
 }
 
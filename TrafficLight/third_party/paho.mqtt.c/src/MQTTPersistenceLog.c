@@ -0,0 +1,989 @@
+/*******************************************************************************
+ * Copyright (c) 2020 HiHope Community.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    HiSpark Product Team - log structured persistence
+ *******************************************************************************/
+
+/**
+ * @file
+ * \brief A log structured persistence, plugged in as a user persistence.
+ *
+ * The records are appended to segment files in the client directory of the default
+ * persistence, a put as the key and the data, a remove as the key alone, each with a
+ * checksum and written with one call.  The key of each live record is in an index in memory,
+ * which is all a get, a remove or a list of the keys needs, so no file is made or removed per
+ * message.
+ *
+ * The records are synced to the disk in groups, every sync_records records and every sync_ms
+ * by the store thread.  A record not synced yet is lost if the system goes down, not if the
+ * process does.
+ *
+ * Open maps each segment in turn and reads its records into the index, cutting the segment at
+ * the first record that is not whole.  Once less than compact_percent of the oldest segment is
+ * live, its live records are written again at the end of the log and it is removed.  Only the
+ * oldest segment is compacted, as a remove record must stay while an older put of its key is on
+ * the disk.
+ */
+
+#if !defined(NO_PERSISTENCE)
+
+#include "MQTTPersistenceLog.h"
+
+#if defined(WIN32) || defined(WIN64) || defined(__LITEOS__)
+
+/* no mmap, or no file system */
+int MQTTPersistenceLog_create(MQTTClient_persistence* persistence, MQTTPersistenceLog_options* options)
+{
+	(void)persistence;
+	(void)options;
+	return MQTTCLIENT_PERSISTENCE_ERROR;
+}
+
+#else
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "MQTTPersistenceDefault.h"
+#include "MQTTProtocolClient.h"
+#include "LinkedList.h"
+#include "Tree.h"
+#include "Thread.h"
+#include "Log.h"
+#include "StackTrace.h"
+#include "Heap.h"
+
+/** "PLO" and the record type in the low byte */
+#define PLOG_RECORD_MAGIC 0x504c4f00u
+#define PLOG_RECORD_PUT 1
+#define PLOG_RECORD_REMOVE 2
+
+/** a put with up to this many buffers needs no allocation for its write */
+#define PLOG_IOV_MAX 8
+
+/** Thread_wait_sem polls every 10 ms, a shorter wait would not wait at all */
+#define PLOG_SYNC_MS_MIN 20
+
+#define PLOG_SUM_START 2166136261u
+
+/**
+ * The header of each record, followed by the key and the data
+ */
+typedef struct
+{
+	unsigned int magic;		/**< PLOG_RECORD_MAGIC with the type */
+	unsigned int sum;		/**< FNV-1a of the other fields, the key and the data */
+	unsigned int keylen;	/**< length of the key, without a terminator */
+	unsigned int datalen;	/**< length of the data, 0 for a remove */
+} plog_record;
+
+/**
+ * One segment file
+ */
+typedef struct
+{
+	int no;			/**< number of the file, the segments are written in this order */
+	int fd;			/**< open while the store is */
+	size_t size;	/**< bytes of whole records */
+	size_t live;	/**< bytes of the records in the index */
+} plog_segment;
+
+/**
+ * Where the live record of a key is
+ */
+typedef struct
+{
+	char* key;
+	plog_segment* segment;
+	size_t offset;	/**< of the record header */
+	size_t len;		/**< of the whole record */
+} plog_entry;
+
+/**
+ * The handle of an open store
+ */
+typedef struct
+{
+	MQTTPersistenceLog_options options;
+	char* dir;				/**< the client directory */
+	Tree* index;			/**< plog_entry by key */
+	List* segments;			/**< plog_segment, oldest first */
+	plog_segment* current;	/**< the last segment, written to */
+	int unsynced;			/**< records written to current and not synced */
+	mutex_type mutex;
+	sem_type wake;
+	sem_type stopped;
+	int running;			/**< whether the store thread was started */
+	int stopping;
+} plog_store;
+
+
+static int plog_compare(void* a, void* b, int content)
+{
+	return strcmp(((plog_entry*)a)->key, content ? ((plog_entry*)b)->key : (char*)b);
+}
+
+
+static int plog_compareno(const void* a, const void* b)
+{
+	return *(const int*)a - *(const int*)b;
+}
+
+
+static unsigned int plog_sum(unsigned int sum, const void* data, size_t len)
+{
+	const unsigned char* p = data;
+	size_t i;
+
+	for (i = 0; i < len; ++i)
+		sum = (sum ^ p[i]) * 16777619u;
+	return sum;
+}
+
+
+/** the sum of the header fields, to go on with the key and the data */
+static unsigned int plog_headersum(plog_record* rec)
+{
+	unsigned int sum = plog_sum(PLOG_SUM_START, &rec->magic, sizeof(rec->magic));
+
+	sum = plog_sum(sum, &rec->keylen, sizeof(rec->keylen));
+	return plog_sum(sum, &rec->datalen, sizeof(rec->datalen));
+}
+
+
+static char* plog_path(plog_store* store, int no)
+{
+	/* consider '/' + 10 digits + '\0' */
+	char* path = malloc(strlen(store->dir) + strlen(LOG_SEGMENT_EXTENSION) + 12);
+
+	if (path)
+		sprintf(path, "%s/%08d%s", store->dir, no, LOG_SEGMENT_EXTENSION);
+	return path;
+}
+
+
+static plog_segment* plog_openSegment(plog_store* store, int no, int flags)
+{
+	plog_segment* seg = NULL;
+	char* path = plog_path(store, no);
+	int fd;
+
+	FUNC_ENTRY;
+	if (path == NULL)
+		goto exit;
+	if ((fd = open(path, O_RDWR | O_CLOEXEC | flags, S_IRUSR | S_IWUSR)) < 0)
+		Log(LOG_ERROR, -1, "Persistence log: cannot open %s: %s", path, strerror(errno));
+	else if ((seg = malloc(sizeof(plog_segment))) == NULL)
+		close(fd);
+	else
+	{
+		seg->no = no;
+		seg->fd = fd;
+		seg->size = 0;
+		seg->live = 0;
+		ListAppend(store->segments, seg, sizeof(plog_segment));
+	}
+	free(path);
+exit:
+	FUNC_EXIT;
+	return seg;
+}
+
+
+/** closes and removes the file of a segment, and frees it */
+static void plog_dropSegment(plog_store* store, plog_segment* seg)
+{
+	char* path = plog_path(store, seg->no);
+
+	if (path && unlink(path) != 0)
+		Log(LOG_ERROR, -1, "Persistence log: cannot remove %s: %s", path, strerror(errno));
+	free(path);
+	close(seg->fd);
+	if (store->current == seg)
+		store->current = NULL;
+	ListRemove(store->segments, seg);
+}
+
+
+/** a new segment is only found after a crash once its directory entry is on the disk */
+static void plog_syncDir(plog_store* store)
+{
+	int fd = open(store->dir, O_RDONLY | O_CLOEXEC);
+
+	if (fd >= 0)
+	{
+		(void)fsync(fd);
+		close(fd);
+	}
+}
+
+
+static int plog_sync(plog_store* store)
+{
+	int rc = 0;
+
+	if (store->unsynced > 0 && store->current)
+	{
+		if (fdatasync(store->current->fd) != 0)
+		{
+			Log(LOG_ERROR, -1, "Persistence log: sync of segment %d: %s", store->current->no, strerror(errno));
+			rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		}
+		else
+			store->unsynced = 0;
+	}
+	return rc;
+}
+
+
+static int plog_newSegment(plog_store* store)
+{
+	plog_segment* seg = NULL;
+	int no = 0;
+	int rc = 0;
+
+	FUNC_ENTRY;
+	if (store->current)
+	{
+		if ((rc = plog_sync(store)) != 0)
+			goto exit;
+		no = store->current->no + 1;
+	}
+	if ((seg = plog_openSegment(store, no, O_CREAT | O_TRUNC)) == NULL)
+		rc = MQTTCLIENT_PERSISTENCE_ERROR;
+	else
+	{
+		store->current = seg;
+		plog_syncDir(store);
+	}
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/**
+ * Writes a record at the end of the log.
+ * @param store the store
+ * @param iov the header, key and data of the record
+ * @param iovcnt number of iov entries
+ * @param len length of the record
+ * @param seg returns the segment it went to
+ * @param offset returns where it went in the segment
+ * @return 0 if success, #MQTTCLIENT_PERSISTENCE_ERROR otherwise.
+ */
+static int plog_append(plog_store* store, struct iovec* iov, int iovcnt, size_t len, plog_segment** seg, size_t* offset)
+{
+	ssize_t written;
+	int rc = 0;
+
+	if (store->current == NULL ||
+			(store->current->size > 0 && store->current->size + len > store->options.segment_size))
+	{
+		if ((rc = plog_newSegment(store)) != 0)
+			goto exit;
+	}
+	written = pwritev(store->current->fd, iov, iovcnt, (off_t)store->current->size);
+	if (written != (ssize_t)len)
+	{
+		Log(LOG_ERROR, -1, "Persistence log: write to segment %d: %s", store->current->no,
+				(written < 0) ? strerror(errno) : "short write");
+		if (written > 0)
+			(void)ftruncate(store->current->fd, (off_t)store->current->size);
+		rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		goto exit;
+	}
+	*seg = store->current;
+	*offset = store->current->size;
+	store->current->size += len;
+	if (++(store->unsynced) >= store->options.sync_records && store->options.sync_records > 0)
+		rc = plog_sync(store);
+exit:
+	return rc;
+}
+
+
+/** points the key at a record, the record it pointed at is no longer live */
+static int plog_index(plog_store* store, const char* key, plog_segment* seg, size_t offset, size_t len)
+{
+	Node* node = TreeFind(store->index, (void*)key);
+	plog_entry* entry;
+	int rc = 0;
+
+	if (node)
+	{
+		entry = node->content;
+		entry->segment->live -= entry->len;
+	}
+	else if ((entry = malloc(sizeof(plog_entry))) == NULL || (entry->key = MQTTStrdup(key)) == NULL)
+	{
+		free(entry);
+		rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		goto exit;
+	}
+	else
+		TreeAdd(store->index, entry, sizeof(plog_entry) + strlen(key) + 1);
+	entry->segment = seg;
+	entry->offset = offset;
+	entry->len = len;
+	seg->live += len;
+exit:
+	return rc;
+}
+
+
+static void plog_unindex(plog_store* store, const char* key)
+{
+	plog_entry* entry = TreeRemoveKey(store->index, (void*)key);
+
+	if (entry)
+	{
+		entry->segment->live -= entry->len;
+		free(entry->key);
+		free(entry);
+	}
+}
+
+
+static void plog_unindexAll(plog_store* store)
+{
+	while (store->index->count > 0)
+	{
+		plog_entry* entry = TreeRemove(store->index, TreeNextElement(store->index, NULL)->content);
+
+		entry->segment->live -= entry->len;
+		free(entry->key);
+		free(entry);
+	}
+}
+
+
+/**
+ * Moves the live records of the oldest segment to the end of the log and removes it, for as
+ * long as less than compact_percent of the oldest segment is live.
+ * @param store the store
+ * @return 0 if success, #MQTTCLIENT_PERSISTENCE_ERROR otherwise.
+ */
+static int plog_compact(plog_store* store)
+{
+	plog_segment* head;
+	char* buf = NULL;
+	size_t buflen = 0;
+	int rc = 0;
+
+	FUNC_ENTRY;
+	while (rc == 0 && (head = store->segments->first->content) != store->current &&
+			(head->live == 0 || head->live * 100 < head->size * (size_t)store->options.compact_percent))
+	{
+		Node* node = NULL;
+
+		while (rc == 0 && head->live > 0 && (node = TreeNextElement(store->index, node)) != NULL)
+		{
+			plog_entry* entry = node->content;
+			plog_segment* seg = NULL;
+			size_t offset = 0;
+			struct iovec iov;
+
+			if (entry->segment != head)
+				continue;
+			if (entry->len > buflen)
+			{
+				char* newbuf = buf ? realloc(buf, entry->len) : malloc(entry->len); /* the heap reallocates its own items only */
+
+				if (newbuf == NULL)
+				{
+					rc = MQTTCLIENT_PERSISTENCE_ERROR;
+					break;
+				}
+				buf = newbuf;
+				buflen = entry->len;
+			}
+			if (pread(head->fd, buf, entry->len, (off_t)entry->offset) != (ssize_t)entry->len)
+			{
+				Log(LOG_ERROR, -1, "Persistence log: read of segment %d: %s", head->no, strerror(errno));
+				rc = MQTTCLIENT_PERSISTENCE_ERROR;
+				break;
+			}
+			iov.iov_base = buf;
+			iov.iov_len = entry->len;
+			if ((rc = plog_append(store, &iov, 1, entry->len, &seg, &offset)) == 0)
+			{
+				head->live -= entry->len;
+				seg->live += entry->len;
+				entry->segment = seg;
+				entry->offset = offset;
+			}
+		}
+		/* the moved records are on the disk before the segment goes */
+		if (rc == 0 && (rc = plog_sync(store)) == 0)
+			plog_dropSegment(store, head);
+	}
+	free(buf);
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/**
+ * Reads the records of a segment into the index, through a map of the file.  The segment is cut
+ * at the first record that is not whole, the rest of a write the system did not finish.
+ * @param store the store
+ * @param seg the segment, the newest read so far
+ * @return 0 if success, #MQTTCLIENT_PERSISTENCE_ERROR otherwise.
+ */
+static int plog_scan(plog_store* store, plog_segment* seg)
+{
+	struct stat st;
+	char* map = NULL;
+	size_t size = 0;
+	size_t off = 0;
+	int rc = 0;
+
+	FUNC_ENTRY;
+	if (fstat(seg->fd, &st) != 0)
+	{
+		rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		goto exit;
+	}
+	size = (size_t)st.st_size;
+	if (size > 0 && (map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, seg->fd, 0)) == MAP_FAILED)
+	{
+		Log(LOG_ERROR, -1, "Persistence log: cannot map segment %d: %s", seg->no, strerror(errno));
+		map = NULL;
+		rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		goto exit;
+	}
+	(void)madvise(map, size, MADV_SEQUENTIAL);
+
+	while (rc == 0 && size - off >= sizeof(plog_record))
+	{
+		plog_record rec;
+		unsigned int type;
+		size_t len;
+		char* key;
+
+		memcpy(&rec, map + off, sizeof(rec));
+		type = rec.magic & 0xffu;
+		if ((rec.magic & ~0xffu) != PLOG_RECORD_MAGIC || (type != PLOG_RECORD_PUT && type != PLOG_RECORD_REMOVE) ||
+				rec.keylen == 0 || rec.keylen > size - off || rec.datalen > size - off)
+			break;
+		len = sizeof(rec) + rec.keylen + rec.datalen;
+		if (len > size - off ||
+				plog_sum(plog_headersum(&rec), map + off + sizeof(rec), rec.keylen + rec.datalen) != rec.sum)
+			break;
+
+		if ((key = malloc(rec.keylen + 1)) == NULL)
+		{
+			rc = MQTTCLIENT_PERSISTENCE_ERROR;
+			break;
+		}
+		memcpy(key, map + off + sizeof(rec), rec.keylen);
+		key[rec.keylen] = '\0';
+		if (type == PLOG_RECORD_PUT)
+			rc = plog_index(store, key, seg, off, len);
+		else
+			plog_unindex(store, key);
+		free(key);
+		off += len;
+	}
+
+	if (rc == 0 && off < size)
+	{
+		Log(LOG_ERROR, -1, "Persistence log: segment %d cut to %lu of %lu bytes", seg->no,
+				(unsigned long)off, (unsigned long)size);
+		if (ftruncate(seg->fd, (off_t)off) != 0)
+			rc = MQTTCLIENT_PERSISTENCE_ERROR;
+	}
+	seg->size = off;
+exit:
+	if (map)
+		munmap(map, size);
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/** syncs the records and compacts the segments, every sync_ms */
+static thread_return_type plog_run(void* n)
+{
+	plog_store* store = n;
+	int stopping = 0;
+
+	FUNC_ENTRY;
+	while (!stopping)
+	{
+		Thread_wait_sem(store->wake, store->options.sync_ms);
+		Thread_lock_mutex(store->mutex);
+		stopping = store->stopping;
+		if (!stopping)
+		{
+			(void)plog_sync(store);
+			(void)plog_compact(store);
+		}
+		Thread_unlock_mutex(store->mutex);
+	}
+	Thread_post_sem(store->stopped);
+	FUNC_EXIT;
+	return 0;
+}
+
+
+static void plog_stop(plog_store* store)
+{
+	if (store->running)
+	{
+		Thread_lock_mutex(store->mutex);
+		store->stopping = 1;
+		Thread_unlock_mutex(store->mutex);
+		Thread_post_sem(store->wake);
+		while (Thread_wait_sem(store->stopped, 1000) != 0)
+			;
+		store->running = 0;
+	}
+}
+
+
+static void plog_free(plog_store* store)
+{
+	plog_stop(store);
+	if (store->index)
+	{
+		plog_unindexAll(store);
+		TreeFree(store->index);
+	}
+	if (store->segments)
+	{
+		ListElement* current = NULL;
+
+		while (ListNextElement(store->segments, &current))
+			close(((plog_segment*)(current->content))->fd);
+		ListFree(store->segments);
+	}
+	if (store->mutex)
+		Thread_destroy_mutex(store->mutex);
+	if (store->wake)
+		Thread_destroy_sem(store->wake);
+	if (store->stopped)
+		Thread_destroy_sem(store->stopped);
+	free(store->dir);
+	free(store);
+}
+
+
+/** Opens the segments in the client directory and reads them into the index.
+ *  See ::Persistence_open
+ */
+static int plogopen(void** handle, const char* clientID, const char* serverURI, void* context)
+{
+	MQTTPersistenceLog_options* options = context;
+	plog_store* store = NULL;
+	DIR* dp = NULL;
+	struct dirent* dir_entry;
+	int* nos = NULL;
+	int count = 0;
+	int max = 0;
+	int i;
+	int rc = 0;
+
+	FUNC_ENTRY;
+	if ((store = malloc(sizeof(plog_store))) == NULL)
+	{
+		rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		goto exit;
+	}
+	memset(store, '\0', sizeof(plog_store));
+	store->options = *options;
+	if (store->options.sync_ms > 0 && store->options.sync_ms < PLOG_SYNC_MS_MIN)
+		store->options.sync_ms = PLOG_SYNC_MS_MIN;
+	store->index = TreeInitialize(plog_compare);
+	store->segments = ListInitialize();
+	store->mutex = Thread_create_mutex();
+	if ((rc = pstopen((void**)&store->dir, clientID, serverURI, (void*)options->directory)) != 0)
+		goto exit;
+
+	if ((dp = opendir(store->dir)) == NULL)
+	{
+		rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		goto exit;
+	}
+	while ((dir_entry = readdir(dp)) != NULL)
+	{
+		char* end = NULL;
+		long no = strtol(dir_entry->d_name, &end, 10);
+
+		if (end == dir_entry->d_name || strcmp(end, LOG_SEGMENT_EXTENSION) != 0 || no < 0 || no > 99999999)
+			continue;
+		if (count == max)
+		{
+			int* newnos = nos ? realloc(nos, (max + 16) * sizeof(int)) : malloc(16 * sizeof(int));
+
+			if (newnos == NULL)
+			{
+				rc = MQTTCLIENT_PERSISTENCE_ERROR;
+				goto exit;
+			}
+			nos = newnos;
+			max += 16;
+		}
+		nos[count++] = (int)no;
+	}
+	qsort(nos, count, sizeof(int), plog_compareno);
+
+	for (i = 0; rc == 0 && i < count; ++i)
+	{
+		plog_segment* seg = plog_openSegment(store, nos[i], 0);
+
+		rc = (seg == NULL) ? MQTTCLIENT_PERSISTENCE_ERROR : plog_scan(store, seg);
+		store->current = seg;
+	}
+	if (rc == 0 && (store->current == NULL || store->current->size >= store->options.segment_size))
+		rc = plog_newSegment(store);
+
+	if (rc == 0 && store->options.sync_ms > 0)
+	{
+		store->wake = Thread_create_sem();
+		store->stopped = Thread_create_sem();
+		store->running = (Thread_start(plog_run, store) != 0);
+	}
+
+exit:
+	if (dp)
+		closedir(dp);
+	free(nos);
+	if (rc != 0 && store)
+	{
+		plog_free(store);
+		store = NULL;
+	}
+	*handle = store;
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/** Syncs the log and closes the store, removing the segments and the client directory if
+ *  nothing is live.
+ *  See ::Persistence_close
+ */
+static int plogclose(void* handle)
+{
+	plog_store* store = handle;
+	int rc = 0;
+
+	FUNC_ENTRY;
+	if (store == NULL)
+	{
+		rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		goto exit;
+	}
+	plog_stop(store);
+	rc = plog_sync(store);
+	if (store->index->count == 0)
+	{
+		while (store->segments->count > 0)
+			plog_dropSegment(store, store->segments->first->content);
+		if (rmdir(store->dir) != 0 && errno != ENOENT && errno != ENOTEMPTY)
+			rc = MQTTCLIENT_PERSISTENCE_ERROR;
+	}
+	plog_free(store);
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/** Appends a put record of the buffers.
+ *  See ::Persistence_put
+ */
+static int plogput(void* handle, char* key, int bufcount, char* buffers[], int buflens[])
+{
+	plog_store* store = handle;
+	struct iovec local[PLOG_IOV_MAX + 2];
+	struct iovec* iov = local;
+	plog_record rec;
+	plog_segment* seg = NULL;
+	size_t offset = 0;
+	int i;
+	int rc = 0;
+
+	FUNC_ENTRY;
+	if (store == NULL || bufcount < 0)
+	{
+		rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		goto exit;
+	}
+	if (bufcount > PLOG_IOV_MAX && (iov = malloc((bufcount + 2) * sizeof(struct iovec))) == NULL)
+	{
+		rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		goto exit;
+	}
+
+	rec.magic = PLOG_RECORD_MAGIC | PLOG_RECORD_PUT;
+	rec.keylen = (unsigned int)strlen(key);
+	rec.datalen = 0;
+	for (i = 0; i < bufcount; ++i)
+		rec.datalen += (unsigned int)buflens[i];
+	rec.sum = plog_sum(plog_headersum(&rec), key, rec.keylen);
+	iov[0].iov_base = &rec;
+	iov[0].iov_len = sizeof(rec);
+	iov[1].iov_base = key;
+	iov[1].iov_len = rec.keylen;
+	for (i = 0; i < bufcount; ++i)
+	{
+		rec.sum = plog_sum(rec.sum, buffers[i], buflens[i]);
+		iov[i + 2].iov_base = buffers[i];
+		iov[i + 2].iov_len = buflens[i];
+	}
+
+	Thread_lock_mutex(store->mutex);
+	rc = plog_append(store, iov, bufcount + 2, sizeof(rec) + rec.keylen + rec.datalen, &seg, &offset);
+	if (rc == 0)
+		rc = plog_index(store, key, seg, offset, sizeof(rec) + rec.keylen + rec.datalen);
+	if (rc == 0 && !store->running)
+		rc = plog_compact(store);
+	Thread_unlock_mutex(store->mutex);
+
+	if (iov != local)
+		free(iov);
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/** Reads the data of the live record of a key.
+ *  See ::Persistence_get
+ */
+static int plogget(void* handle, char* key, char** buffer, int* buflen)
+{
+	plog_store* store = handle;
+	plog_entry* entry;
+	Node* node;
+	size_t keylen;
+	size_t datalen;
+	char* buf;
+	int rc = 0;
+
+	FUNC_ENTRY;
+	if (store == NULL)
+	{
+		rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		goto exit;
+	}
+	Thread_lock_mutex(store->mutex);
+	if ((node = TreeFind(store->index, key)) == NULL)
+		rc = MQTTCLIENT_PERSISTENCE_ERROR;
+	else
+	{
+		entry = node->content;
+		keylen = strlen(entry->key);
+		datalen = entry->len - sizeof(plog_record) - keylen;
+		if ((buf = malloc(datalen ? datalen : 1)) == NULL)
+			rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		else if (pread(entry->segment->fd, buf, datalen, (off_t)(entry->offset + sizeof(plog_record) + keylen))
+				!= (ssize_t)datalen)
+		{
+			free(buf);
+			rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		}
+		else
+		{
+			*buffer = buf; /* the caller must free buf */
+			*buflen = (int)datalen;
+		}
+	}
+	Thread_unlock_mutex(store->mutex);
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/** Appends a remove record if the key is live.
+ *  See ::Persistence_remove
+ */
+static int plogremove(void* handle, char* key)
+{
+	plog_store* store = handle;
+	plog_record rec;
+	plog_segment* seg = NULL;
+	size_t offset = 0;
+	struct iovec iov[2];
+	int rc = 0;
+
+	FUNC_ENTRY;
+	if (store == NULL)
+	{
+		rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		goto exit;
+	}
+	Thread_lock_mutex(store->mutex);
+	if (TreeFind(store->index, key) != NULL)
+	{
+		rec.magic = PLOG_RECORD_MAGIC | PLOG_RECORD_REMOVE;
+		rec.keylen = (unsigned int)strlen(key);
+		rec.datalen = 0;
+		rec.sum = plog_sum(plog_headersum(&rec), key, rec.keylen);
+		iov[0].iov_base = &rec;
+		iov[0].iov_len = sizeof(rec);
+		iov[1].iov_base = key;
+		iov[1].iov_len = rec.keylen;
+		if ((rc = plog_append(store, iov, 2, sizeof(rec) + rec.keylen, &seg, &offset)) == 0)
+			plog_unindex(store, key);
+		if (rc == 0 && !store->running)
+			rc = plog_compact(store);
+	}
+	Thread_unlock_mutex(store->mutex);
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/** Lists the live keys from the index.
+ *  See ::Persistence_keys
+ */
+static int plogkeys(void* handle, char*** keys, int* nkeys)
+{
+	plog_store* store = handle;
+	Node* node = NULL;
+	char** fkeys = NULL;
+	int i = 0;
+	int rc = 0;
+
+	FUNC_ENTRY;
+	if (store == NULL)
+	{
+		rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		goto exit;
+	}
+	Thread_lock_mutex(store->mutex);
+	if (store->index->count > 0 && (fkeys = malloc(store->index->count * sizeof(char*))) == NULL)
+		rc = MQTTCLIENT_PERSISTENCE_ERROR;
+	while (rc == 0 && (node = TreeNextElement(store->index, node)) != NULL)
+	{
+		if ((fkeys[i] = MQTTStrdup(((plog_entry*)(node->content))->key)) == NULL)
+			rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		else
+			++i;
+	}
+	Thread_unlock_mutex(store->mutex);
+	if (rc != 0)
+	{
+		while (--i >= 0)
+			free(fkeys[i]);
+		free(fkeys);
+		goto exit;
+	}
+	*nkeys = i;
+	*keys = fkeys;
+	/* the caller must free keys */
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/** Removes all the segments and starts the log again.
+ *  See ::Persistence_clear
+ */
+static int plogclear(void* handle)
+{
+	plog_store* store = handle;
+	int rc = 0;
+
+	FUNC_ENTRY;
+	if (store == NULL)
+	{
+		rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		goto exit;
+	}
+	Thread_lock_mutex(store->mutex);
+	plog_unindexAll(store);
+	while (store->segments->count > 0)
+		plog_dropSegment(store, store->segments->first->content);
+	store->unsynced = 0;
+	rc = plog_newSegment(store);
+	Thread_unlock_mutex(store->mutex);
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/** Whether a key is live, from the index.
+ *  See ::Persistence_containskey
+ */
+static int plogcontainskey(void* handle, char* key)
+{
+	plog_store* store = handle;
+	int rc = MQTTCLIENT_PERSISTENCE_ERROR;
+
+	FUNC_ENTRY;
+	if (store != NULL)
+	{
+		Thread_lock_mutex(store->mutex);
+		if (TreeFind(store->index, key) != NULL)
+			rc = 0;
+		Thread_unlock_mutex(store->mutex);
+	}
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/**
+ * Fills in a user persistence with the functions of the log store.  The persistence is then
+ * passed to MQTTClient_create() or MQTTAsync_create() with ::MQTTCLIENT_PERSISTENCE_USER.  The
+ * options are its context, so both must stay valid until the client is destroyed.
+ * @param persistence the persistence to fill in
+ * @param options the options of the store
+ * @return 0 if success, #MQTTCLIENT_PERSISTENCE_ERROR if an option is not valid.
+ */
+int MQTTPersistenceLog_create(MQTTClient_persistence* persistence, MQTTPersistenceLog_options* options)
+{
+	int rc = 0;
+
+	FUNC_ENTRY;
+	if (persistence == NULL || options == NULL || options->directory == NULL || options->segment_size == 0 ||
+			options->sync_records < 0 || options->sync_ms < 0 ||
+			options->compact_percent < 0 || options->compact_percent > 100)
+	{
+		rc = MQTTCLIENT_PERSISTENCE_ERROR;
+		goto exit;
+	}
+	persistence->context = options;
+	persistence->popen = plogopen;
+	persistence->pclose = plogclose;
+	persistence->pput = plogput;
+	persistence->pget = plogget;
+	persistence->premove = plogremove;
+	persistence->pkeys = plogkeys;
+	persistence->pclear = plogclear;
+	persistence->pcontainskey = plogcontainskey;
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+#endif
+
+#endif
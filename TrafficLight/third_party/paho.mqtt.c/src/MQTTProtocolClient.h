@@ -30,11 +30,14 @@
 
 #define MAX_MSG_ID 65535
 #define MAX_CLIENTID_LEN 65535
+/** properties of a publish, the topic alias included, that it can be sent with an alias */
+#define MQTTPROTOCOL_ALIAS_PROPS 4
 
 int MQTTProtocol_startPublish(Clients* pubclient, Publish* publish, int qos, int retained, Messages** m);
 Messages* MQTTProtocol_createMessage(Publish* publish, Messages** mm, int qos, int retained);
 Publications* MQTTProtocol_storePublication(Publish* publish, int* len);
 int messageIDCompare(void* a, void* b);
+Clients* MQTTProtocol_findClient(int sock);
 int MQTTProtocol_assignMsgId(Clients* client);
 void MQTTProtocol_removePublication(Publications* p);
 void Protocol_processPublication(Publish* publish, Clients* client);
@@ -47,8 +50,11 @@ int MQTTProtocol_handlePubcomps(void* pack, int sock);
 
 void MQTTProtocol_closeSession(Clients* c, int sendwill);
 void MQTTProtocol_keepalive(time_t);
+void MQTTProtocol_keepaliveClient(time_t now, Clients* client);
 void MQTTProtocol_retry(time_t, int, int);
+void MQTTProtocol_retryClient(time_t now, Clients* client, int doRetry, int regardless);
 void MQTTProtocol_freeClient(Clients* client);
+void MQTTProtocol_setTopicAliasMax(Clients* client, MQTTProperties* connackProps);
 void MQTTProtocol_emptyMessageList(List* msgList);
 void MQTTProtocol_freeMessageList(List* msgList);
 
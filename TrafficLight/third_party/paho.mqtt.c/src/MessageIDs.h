@@ -0,0 +1,48 @@
+/*******************************************************************************
+ * Copyright (c) 2020 HiHope Community.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    HiSpark Product Team - index of the inflight messages by message id
+ *******************************************************************************/
+
+#if !defined(MESSAGEIDS_H)
+#define MESSAGEIDS_H
+
+#include "LinkedList.h"
+
+/**
+ * One slot of a message id index
+ */
+typedef struct
+{
+	int msgid;				/**< the message id, 0 for a free slot, -1 for a removed one */
+	ListElement* elem;		/**< the element of the message in its list */
+} MessageIDSlot;
+
+/**
+ * Message ids to the list elements of the messages, kept alongside a message list so that
+ * finding a message does not walk the list. All zero is an empty index.
+ */
+typedef struct
+{
+	MessageIDSlot* slots;	/**< open addressing table, the message id is its own hash */
+	int size;				/**< number of slots, a power of 2 or 0 */
+	int count;				/**< number of ids in the index */
+	int used;				/**< number of slots not free, the ids and the removed ones */
+} MessageIDs;
+
+int MessageIDs_add(MessageIDs* ids, int msgid, ListElement* elem);
+ListElement* MessageIDs_find(MessageIDs* ids, int msgid);
+ListElement* MessageIDs_remove(MessageIDs* ids, int msgid);
+void MessageIDs_clear(MessageIDs* ids);
+
+#endif
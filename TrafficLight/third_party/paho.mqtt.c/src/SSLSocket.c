@@ -964,7 +964,7 @@ int SSLSocket_putdatas(SSL* ssl, int socket, char* buf0, size_t buf0len, int cou
 			SocketBuffer_pendingWrite(socket, ssl, 1, &iovec, &free, iovec.iov_len, 0);
 			*sockmem = socket;
 			ListAppend(s.write_pending, sockmem, sizeof(int));
-			FD_SET(socket, &(s.pending_wset));
+			Socket_addPendingWrite(socket);
 			rc = TCPSOCKET_INTERRUPTED;
 		}
 		else
@@ -1349,7 +1349,7 @@ free_ctx:
 		mbedtls_x509_crt_free(&net->ctx->cacert);
 		mbedtls_x509_crt_free(&net->ctx->clicert);
 		mbedtls_pk_free(&net->ctx->pkey);
-		mbedtls_free(net->ctx);
+		free(net->ctx);
 		net->ctx = NULL;
 	}
 exit:
@@ -1573,7 +1573,7 @@ int SSLSocket_close(networkHandles* net)
 	{
 		rc = mbedtls_ssl_close_notify(net->ssl);
 		mbedtls_ssl_free(net->ssl);
-		mbedtls_free(net->ssl);
+		free(net->ssl); /* it is from the malloc of Heap.h, as the context */
 		net->ssl = NULL;
 	}
 	SSLSocket_destroyContext(net);
@@ -1624,7 +1624,7 @@ int SSLSocket_putdatas(SSL* ssl, int socket, char* buf0, size_t buf0len, int cou
 			SocketBuffer_pendingWrite(socket, ssl, 1, &iovec, &free, iovec.iov_len, 0);
 			*sockmem = socket;
 			ListAppend(s.write_pending, sockmem, sizeof(int));
-			FD_SET(socket, &(s.pending_wset));
+			Socket_addPendingWrite(socket);
 			rc = TCPSOCKET_INTERRUPTED;
 		}
 		else
@@ -1706,4 +1706,45 @@ int SSLSocket_continueWrite(pending_writes* pw)
 	return rc;
 }
 
+/**
+ * Keep the session of the handshake just done in the client, the next connect offers it to the
+ * server to resume instead of a full handshake
+ * @param ssl the ssl context of the connection
+ * @param session the session of the client, allocated the first time
+ * @return 0 on success
+ */
+int SSLSocket_saveSession(SSL* ssl, SSL_SESSION** session)
+{
+	int rc = 0;
+
+	FUNC_ENTRY;
+	if (*session == NULL)
+	{
+		if ((*session = malloc(sizeof(SSL_SESSION))) == NULL)
+		{
+			rc = -1;
+			goto exit;
+		}
+		mbedtls_ssl_session_init(*session);
+	}
+	if ((rc = mbedtls_ssl_get_session(ssl, *session)) != 0)
+		Log(TRACE_MIN, -1, "mbedtls_ssl_get_session returned %d, the next connect does a full handshake", rc);
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+void SSLSocket_freeSession(SSL_SESSION** session)
+{
+	FUNC_ENTRY;
+	if (*session != NULL)
+	{
+		mbedtls_ssl_session_free(*session);
+		free(*session);
+		*session = NULL;
+	}
+	FUNC_EXIT;
+}
+
 #endif
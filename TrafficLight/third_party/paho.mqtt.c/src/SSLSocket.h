@@ -52,4 +52,9 @@ int SSLSocket_connect(SSL* ssl, int sock, const char* hostname, int verify, int
 int SSLSocket_getPendingRead(void);
 int SSLSocket_continueWrite(pending_writes* pw);
 
+#if defined(MBEDTLS)
+int SSLSocket_saveSession(SSL* ssl, SSL_SESSION** session);
+void SSLSocket_freeSession(SSL_SESSION** session);
+#endif
+
 #endif
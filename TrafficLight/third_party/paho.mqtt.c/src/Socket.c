@@ -26,6 +26,9 @@
  *
  * Some other related functions are in the SocketBuffer module
  */
+#if !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* for PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP */
+#endif
 #include "lwip/netdb.h"
 #include "lwip/sockets.h"
 #include "Socket.h"
@@ -41,30 +44,107 @@
 #include <string.h>
 #include <signal.h>
 #include <ctype.h>
+#include <time.h>
+#if defined(SOCKET_USE_EPOLL)
+#include <sys/epoll.h>
+#endif
 
 #include "Heap.h"
 
 int Socket_setnonblocking(int sock);
 int Socket_error(char* aString, int sock);
 int Socket_addSocket(int newSd);
-int isReady(int socket, fd_set* read_set, fd_set* write_set);
+int isReady(Socket_event* ev);
 int Socket_writev(int socket, iobuf* iovecs, int count, unsigned long* bytes);
 int Socket_close_only(int socket);
 int Socket_continueWrite(int socket);
-int Socket_continueWrites(fd_set* pwset);
+int Socket_continueWrites(void);
 char* Socket_getaddrname(struct sockaddr* sa, int sock);
 int Socket_abortWrite(int socket);
+static int Socket_waitInitialize(void);
+static void Socket_waitTerminate(void);
+static int Socket_waitAdd(int sock);
+static void Socket_waitRemove(int sock);
+static void Socket_waitWrite(int sock);
+static int Socket_wait(struct timeval* timeout, mutex_type mutex);
+static void Socket_addReadAheads(void);
+static int Socket_wantsWrite(int sock);
+#if SOCKETBUFFER_READAHEAD > 0
+static int Socket_recv(int socket, char* buf, size_t len);
+static char* Socket_getReadAhead(int socket, size_t bytes);
+static void Socket_readAheadChanged(int socket);
+#else
+#define Socket_recv(socket, buf, len) recv(socket, buf, len, 0)
+#endif
+static void Socket_pendWrite(int socket, int count, iobuf* iovecs, int* frees, size_t total, size_t bytes);
+#if SOCKETBUFFER_CORK > 0
+static unsigned long Socket_clockUs(void);
+static int Socket_corking(void);
+static int Socket_putCorked(int socket, int count, iobuf* iovecs, int* frees, size_t total);
+static int Socket_writeCorked(socket_cork* cork, int count, iobuf* iovecs, int* frees, size_t total);
+static void Socket_flushCorks(void);
+#endif
 
 #if defined(WIN32) || defined(WIN64)
 #define iov_len len
 #define iov_base buf
 #endif
 
+#if !defined(min)
+#define min(A,B) ( (A) < (B) ? (A):(B))
+#endif
+
 /**
  * Structure to hold all socket data for the module
  */
 Sockets s;
-static fd_set wset;
+
+/**
+ * Guards the socket data and the socket buffers against clients on other threads.  The functions
+ * which change them from the send path take it themselves, the caller holds it around
+ * Socket_getReadySocket and the packet reads.  It is recursive, those functions are also called
+ * with it held.  It is initialized once and never destroyed, a client on another thread may still
+ * take it while the socket module is terminated and initialized again.
+ */
+#if defined(WIN32) || defined(WIN64)
+mutex_type socket_mutex = NULL;
+#elif defined(PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP)
+static pthread_mutex_t socket_mutex_store = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+mutex_type socket_mutex = &socket_mutex_store;
+#else
+static pthread_mutex_t socket_mutex_store; /* made recursive once by Socket_mutexInitialize */
+static pthread_once_t socket_mutex_once = PTHREAD_ONCE_INIT;
+mutex_type socket_mutex = &socket_mutex_store;
+
+static void Socket_mutexInitialize(void)
+{
+	pthread_mutexattr_t attr;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	if (pthread_mutex_init(socket_mutex, &attr) != 0)
+		Log(LOG_ERROR, -1, "Failed to initialize the socket mutex");
+	pthread_mutexattr_destroy(&attr);
+}
+#endif
+
+#if SOCKETBUFFER_CORK > 0
+#if !defined(SOCKET_CORK_THREADS)
+/** the threads which can cork at the same time, the ones after them write each packet at once */
+#define SOCKET_CORK_THREADS 4
+#endif
+
+/**
+ * The threads between Socket_cork and Socket_uncork, with the number of Socket_cork calls not yet
+ * undone.  Guarded by socket_mutex.
+ */
+static struct
+{
+	thread_id_type id;
+	int depth;
+} cork_threads[SOCKET_CORK_THREADS];
+static int cork_nthreads = 0;
+#endif
 
 /**
  * Set a socket non-blocking, OS independently
@@ -131,20 +211,26 @@ void Socket_outInitialize(void)
 
 	FUNC_ENTRY;
 	WSAStartup(winsockVer, &wsd);
+	if (socket_mutex == NULL)
+		socket_mutex = CreateMutex(NULL, 0, NULL); /* recursive already */
 #else
 	FUNC_ENTRY;
 	signal(SIGPIPE, SIG_IGN);
+#if !defined(PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP)
+	pthread_once(&socket_mutex_once, Socket_mutexInitialize);
+#endif
 #endif
 
 	SocketBuffer_initialize();
 	s.clientsds = ListInitialize();
 	s.connect_pending = ListInitialize();
 	s.write_pending = ListInitialize();
-	s.cur_clientsds = NULL;
-	FD_ZERO(&(s.rset));														/* Initialize the descriptor set */
-	FD_ZERO(&(s.pending_wset));
-	s.maxfdp1 = 0;
-	memcpy((void*)&(s.rset_saved), (void*)&(s.rset), sizeof(s.rset_saved));
+	s.pending_wsds = ListInitialize();
+	s.readahead_sds = ListInitialize();
+	s.corked_sds = ListInitialize();
+	s.nevents = s.cur_event = 0;
+	if (Socket_waitInitialize() != 0)
+		Log(LOG_ERROR, -1, "Failed to initialize the socket wait");
 	FUNC_EXIT;
 }
 
@@ -157,7 +243,11 @@ void Socket_outTerminate(void)
 	FUNC_ENTRY;
 	ListFree(s.connect_pending);
 	ListFree(s.write_pending);
+	ListFree(s.pending_wsds);
+	ListFree(s.readahead_sds);
+	ListFree(s.corked_sds);
 	ListFree(s.clientsds);
+	Socket_waitTerminate();
 	SocketBuffer_terminate();
 #if defined(WIN32) || defined(WIN64)
 	WSACleanup();
@@ -167,7 +257,7 @@ void Socket_outTerminate(void)
 
 
 /**
- * Add a socket to the list of socket to check with select
+ * Add a socket to the list of socket to wait on
  * @param newSd the new socket to add
  */
 int Socket_addSocket(int newSd)
@@ -177,18 +267,13 @@ int Socket_addSocket(int newSd)
 	FUNC_ENTRY;
 	if (ListFindItem(s.clientsds, &newSd, intcompare) == NULL) /* make sure we don't add the same socket twice */
 	{
-		if (s.clientsds->count >= FD_SETSIZE)
-		{
-			Log(LOG_ERROR, -1, "addSocket: exceeded FD_SETSIZE %d", FD_SETSIZE);
+		if (Socket_waitAdd(newSd) != 0)
 			rc = SOCKET_ERROR;
-		}
 		else
 		{
 			int* pnewSd = (int*)malloc(sizeof(newSd));
 			*pnewSd = newSd;
 			ListAppend(s.clientsds, pnewSd, sizeof(newSd));
-			FD_SET(newSd, &(s.rset_saved));
-			s.maxfdp1 = max(s.maxfdp1, newSd + 1);
 			rc = Socket_setnonblocking(newSd);
 			if (rc == SOCKET_ERROR)
 				Log(LOG_ERROR, -1, "addSocket: setnonblocking");
@@ -205,30 +290,34 @@ int Socket_addSocket(int newSd)
 /**
  * Don't accept work from a client unless it is accepting work back, i.e. its socket is writeable
  * this seems like a reasonable form of flow control, and practically, seems to work.
- * @param socket the socket to check
- * @param read_set the socket read set (see select doc)
- * @param write_set the socket write set (see select doc)
+ * @param ev the socket and how it is ready
  * @return boolean - is the socket ready to go?
  */
-int isReady(int socket, fd_set* read_set, fd_set* write_set)
+int isReady(Socket_event* ev)
 {
 	int rc = 1;
+	int socket = ev->socket;
 
 	FUNC_ENTRY;
-	if  (ListFindItem(s.connect_pending, &socket, intcompare) && FD_ISSET(socket, write_set))
+	if (socket == -1)
+		rc = 0;
+	else if (ListFindItem(s.connect_pending, &socket, intcompare) && (ev->events & SOCKET_WRITE))
+	{
 		ListRemoveItem(s.connect_pending, &socket, intcompare);
+		Socket_waitWrite(socket);
+	}
 	else
-		rc = FD_ISSET(socket, read_set) && FD_ISSET(socket, write_set) && Socket_noPendingWrites(socket);
+		rc = (ev->events & SOCKET_READ) && (ev->events & SOCKET_WRITE) && Socket_noPendingWrites(socket);
 	FUNC_EXIT_RC(rc);
 	return rc;
 }
 
 
 /**
- *  Returns the next socket ready for communications as indicated by select
+ *  Returns the next socket ready for communications as indicated by the wait
  *  @param more_work flag to indicate more work is waiting, and thus a timeout value of 0 should
- *  be used for the select
- *  @param tp the timeout to be used for the select, unless overridden
+ *  be used for the wait
+ *  @param tp the timeout to be used for the wait, unless overridden
  *  @return the socket next ready, or 0 if none is ready
  */
 int Socket_getReadySocket(int more_work, struct timeval *tp, mutex_type mutex)
@@ -248,66 +337,36 @@ int Socket_getReadySocket(int more_work, struct timeval *tp, mutex_type mutex)
 	else if (tp)
 		timeout = *tp;
 
-	while (s.cur_clientsds != NULL)
-	{
-		if (isReady(*((int*)(s.cur_clientsds->content)), &(s.rset), &wset))
-			break;
-		ListNextElement(s.clientsds, &s.cur_clientsds);
-	}
+	while (s.cur_event < s.nevents && !isReady(&s.events[s.cur_event]))
+		++s.cur_event;
 
-	if (s.cur_clientsds == NULL)
+	if (s.cur_event == s.nevents)
 	{
-		int rc1;
-		fd_set pwset;
-
-		memcpy((void*)&(s.rset), (void*)&(s.rset_saved), sizeof(s.rset));
-		memcpy((void*)&(pwset), (void*)&(s.pending_wset), sizeof(pwset));
-		/* Prevent performance issue by unlocking the socket_mutex while waiting for a ready socket. */
-		Thread_unlock_mutex(mutex);
-		rc = select(s.maxfdp1, &(s.rset), &pwset, NULL, &timeout);
-		Thread_lock_mutex(mutex);
-		if (rc == SOCKET_ERROR)
-		{
-			Socket_error("read select", 0);
+		if (s.readahead_sds->count > 0) /* they have bytes now, don't wait for more */
+			timeout = zero;
+#if SOCKETBUFFER_CORK > 0
+		else if (s.corked_sds->count > 0) /* no bytes stay corked while the thread which would write them waits */
+			Socket_flushCorks();
+#endif
+		if ((rc = Socket_wait(&timeout, mutex)) == SOCKET_ERROR)
 			goto exit;
-		}
-		Log(TRACE_MAX, -1, "Return code %d from read select", rc);
+		Log(TRACE_MAX, -1, "Return code %d from wait", rc);
+		Socket_addReadAheads();
 
-		if (Socket_continueWrites(&pwset) == SOCKET_ERROR)
+		if (Socket_continueWrites() == SOCKET_ERROR)
 		{
 			rc = 0;
 			goto exit;
 		}
 
-		memcpy((void*)&wset, (void*)&(s.rset_saved), sizeof(wset));
-		if ((rc1 = select(s.maxfdp1, NULL, &(wset), NULL, &zero)) == SOCKET_ERROR)
-		{
-			Socket_error("write select", 0);
-			rc = rc1;
-			goto exit;
-		}
-		Log(TRACE_MAX, -1, "Return code %d from write select", rc1);
-
-		if (rc == 0 && rc1 == 0)
-			goto exit; /* no work to do */
-
-		s.cur_clientsds = s.clientsds->first;
-		while (s.cur_clientsds != NULL)
-		{
-			int cursock = *((int*)(s.cur_clientsds->content));
-			if (isReady(cursock, &(s.rset), &wset))
-				break;
-			ListNextElement(s.clientsds, &s.cur_clientsds);
-		}
+		while (s.cur_event < s.nevents && !isReady(&s.events[s.cur_event]))
+			++s.cur_event;
 	}
 
-	if (s.cur_clientsds == NULL)
+	if (s.cur_event == s.nevents)
 		rc = 0;
 	else
-	{
-		rc = *((int*)(s.cur_clientsds->content));
-		ListNextElement(s.clientsds, &s.cur_clientsds);
-	}
+		rc = s.events[s.cur_event++].socket;
 exit:
 	Thread_unlock_mutex(mutex);
 	FUNC_EXIT_RC(rc);
@@ -315,6 +374,40 @@ exit:
 } /* end getReadySocket */
 
 
+/**
+ *  Whether a socket returned by Socket_getReadySocket still has bytes to read.  Each client reads
+ *  its own socket, and between the wait and the read another thread may have taken the bytes that
+ *  made the socket ready; the sockets are left blocking on the board, so the read would then block.
+ *  @param socket the socket to check
+ *  @return boolean - can the socket be read without waiting?
+ */
+int Socket_readable(int socket)
+{
+#if SOCKETBUFFER_READAHEAD > 0
+	socket_readahead* ra;
+#endif
+#if !defined(WIN32) && !defined(WIN64)
+	char c;
+#endif
+	int buffered = 0; /* bytes read ahead are left */
+	int rc = 1;
+
+	FUNC_ENTRY;
+	Thread_lock_mutex(socket_mutex);
+#if SOCKETBUFFER_READAHEAD > 0
+	buffered = (ra = SocketBuffer_getReadAhead(socket)) != NULL && ra->start < ra->end;
+#endif
+#if !defined(WIN32) && !defined(WIN64)
+	if (!buffered && recv(socket, &c, (size_t)1, MSG_PEEK | MSG_DONTWAIT) == SOCKET_ERROR &&
+			(errno == EWOULDBLOCK || errno == EAGAIN))
+		rc = 0; /* a close or another error is left to the read */
+#endif
+	Thread_unlock_mutex(socket_mutex);
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
 /**
  *  Reads one byte from a socket
  *  @param socket the socket to read from
@@ -329,7 +422,7 @@ int Socket_getch(int socket, char* c)
 	if ((rc = SocketBuffer_getQueuedChar(socket, c)) != SOCKETBUFFER_INTERRUPTED)
 		goto exit;
 
-	if ((rc = recv(socket, c, (size_t)1, 0)) == SOCKET_ERROR)
+	if ((rc = Socket_recv(socket, c, (size_t)1)) == SOCKET_ERROR)
 	{
 		int err = Socket_error("recv - getch", socket);
 		if (err == EWOULDBLOCK || err == EAGAIN)
@@ -373,7 +466,22 @@ char *Socket_getdata(int socket, size_t bytes, size_t* actual_len)
 
 	buf = SocketBuffer_getQueuedData(socket, bytes, actual_len);
 
-	if ((rc = recv(socket, buf + (*actual_len), (int)(bytes - (*actual_len)), 0)) == SOCKET_ERROR)
+#if SOCKETBUFFER_READAHEAD > 0
+	if (*actual_len == 0)
+	{
+		char* ahead = Socket_getReadAhead(socket, bytes);
+
+		if (ahead != NULL)
+		{ /* the whole packet was read ahead, so it is used from there rather than copied */
+			*actual_len = bytes;
+			SocketBuffer_complete(socket);
+			buf = ahead;
+			goto exit;
+		}
+	}
+#endif
+
+	if ((rc = Socket_recv(socket, buf + (*actual_len), (int)(bytes - (*actual_len)))) == SOCKET_ERROR)
 	{
 		rc = Socket_error("recv - getdata", socket);
 		if (rc != EAGAIN && rc != EWOULDBLOCK)
@@ -398,6 +506,9 @@ char *Socket_getdata(int socket, size_t bytes, size_t* actual_len)
 		Log(TRACE_MAX, -1, "%d bytes expected but %d bytes now received", (int)bytes, (int)*actual_len);
 	}
 exit:
+#if SOCKETBUFFER_READAHEAD > 0
+	Socket_readAheadChanged(socket);
+#endif
 	FUNC_EXIT;
 	return buf;
 }
@@ -410,7 +521,13 @@ exit:
 int Socket_noPendingWrites(int socket)
 {
 	int cursock = socket;
-	return ListFindItem(s.write_pending, &cursock, intcompare) == NULL;
+	int rc = 1;
+
+	Thread_lock_mutex(socket_mutex);
+	if (s.write_pending->count > 0)
+		rc = ListFindItem(s.write_pending, &cursock, intcompare) == NULL;
+	Thread_unlock_mutex(socket_mutex);
+	return rc;
 }
 
 
@@ -524,23 +641,28 @@ int Socket_putdatas(int socket, char* buf0, size_t buf0len, int count, char** bu
 		frees1[i+1] = frees[i];
 	}
 
+#if SOCKETBUFFER_CORK > 0
+	/* a thread adds itself to the corking ones, and corks bytes only for a socket it writes to, so when
+	 * neither is seen without the lock this thread does not cork and its socket has no corked bytes */
+	if (cork_nthreads > 0 || s.corked_sds->count > 0)
+	{
+		Thread_lock_mutex(socket_mutex);
+		rc = Socket_putCorked(socket, count+1, iovecs, frees1, total);
+		Thread_unlock_mutex(socket_mutex);
+		if (rc != 1)
+			goto exit;
+	}
+#endif
+
 	if ((rc = Socket_writev(socket, iovecs, count+1, &bytes)) != SOCKET_ERROR)
 	{
 		if (bytes == total)
 			rc = TCPSOCKET_COMPLETE;
 		else
 		{
-			int* sockmem = (int*)malloc(sizeof(int));
 			Log(TRACE_MIN, -1, "Partial write: %lu bytes of %lu actually written on socket %d",
 					bytes, total, socket);
-#if defined(OPENSSL) || defined(MBEDTLS)
-			SocketBuffer_pendingWrite(socket, NULL, count+1, iovecs, frees1, total, bytes);
-#else
-			SocketBuffer_pendingWrite(socket, count+1, iovecs, frees1, total, bytes);
-#endif
-			*sockmem = socket;
-			ListAppend(s.write_pending, sockmem, sizeof(int));
-			FD_SET(socket, &(s.pending_wset));
+			Socket_pendWrite(socket, count+1, iovecs, frees1, total, bytes);
 			rc = TCPSOCKET_INTERRUPTED;
 		}
 	}
@@ -557,14 +679,289 @@ exit:
 
 
 /**
- *  Add a socket to the pending write list, so that it is checked for writing in select.  This is used
+ *  Keep the rest of an interrupted write, to be continued when the socket can be written again
+ *  @param socket the socket written to
+ *  @param count number of buffers in iovecs
+ *  @param iovecs the buffers of the write
+ *  @param frees which of the buffers to free once the write is complete
+ *  @param total the length of the write
+ *  @param bytes the bytes of it already written
+ */
+static void Socket_pendWrite(int socket, int count, iobuf* iovecs, int* frees, size_t total, size_t bytes)
+{
+	int* sockmem = (int*)malloc(sizeof(int));
+
+	Thread_lock_mutex(socket_mutex);
+#if defined(OPENSSL) || defined(MBEDTLS)
+	SocketBuffer_pendingWrite(socket, NULL, count, iovecs, frees, total, bytes);
+#else
+	SocketBuffer_pendingWrite(socket, count, iovecs, frees, total, bytes);
+#endif
+	*sockmem = socket;
+	ListAppend(s.write_pending, sockmem, sizeof(int));
+	Socket_addPendingWrite(socket);
+	Thread_unlock_mutex(socket_mutex);
+}
+
+
+#if SOCKETBUFFER_CORK > 0
+/**
+ *  A clock in microseconds for the age of the corked bytes, it wraps but their ages are differences
+ *  @return the clock
+ */
+static unsigned long Socket_clockUs(void)
+{
+#if defined(WIN32) || defined(WIN64)
+	return GetTickCount() * 1000UL;
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long)now.tv_sec * 1000000UL + (unsigned long)now.tv_nsec / 1000UL;
+#endif
+}
+
+
+/**
+ *  Whether the calling thread is between Socket_cork and Socket_uncork, socket_mutex held
+ *  @return boolean
+ */
+static int Socket_corking(void)
+{
+	thread_id_type id;
+	int i;
+
+	if (cork_nthreads == 0)
+		return 0;
+	id = Thread_getid();
+	for (i = 0; i < cork_nthreads; ++i)
+	{
+		if (cork_threads[i].id == id)
+			return 1;
+	}
+	return 0;
+}
+
+
+/**
+ *  Cork a packet if the calling thread corks, or write it with the bytes corked for its socket in
+ *  front of it.  socket_mutex held.
+ *  @param socket the socket to write to
+ *  @param count number of buffers in iovecs
+ *  @param iovecs the buffers of the packet
+ *  @param frees which of the buffers are to be freed if the write is interrupted
+ *  @param total the length of the packet
+ *  @return completion code as Socket_putdatas, or 1 if the packet is to be written on its own
+ */
+static int Socket_putCorked(int socket, int count, iobuf* iovecs, int* frees, size_t total)
+{
+	socket_cork* cork = NULL;
+	int rc = 1, i;
+
+	if (s.corked_sds->count > 0 && ListFindItem(s.corked_sds, &socket, intcompare) != NULL)
+		cork = SocketBuffer_getCork(socket);
+	if (!Socket_corking())
+	{
+		if (cork)
+			rc = Socket_writeCorked(cork, count, iovecs, frees, total);
+		goto exit;
+	}
+	if (cork == NULL && (total >= SOCKETBUFFER_CORK || (cork = SocketBuffer_getCork(socket)) == NULL))
+		goto exit; /* a packet as large as the threshold is written at once */
+	if (cork->len > 0 && (cork->len + total > SOCKETBUFFER_CORK ||
+			Socket_clockUs() - cork->start >= SOCKETBUFFER_CORK_USECS))
+	{
+		rc = Socket_writeCorked(cork, count, iovecs, frees, total);
+		goto exit;
+	}
+	if (cork->buf == NULL && (cork->buf = malloc(SOCKETBUFFER_CORK)) == NULL)
+		goto exit;
+	if (cork->len == 0)
+	{
+		int* psock = (int*)malloc(sizeof(int));
+
+		if (psock == NULL)
+			goto exit;
+		*psock = socket;
+		ListAppend(s.corked_sds, psock, sizeof(int));
+		cork->start = Socket_clockUs();
+	}
+	for (i = 0; i < count; ++i)
+	{
+		memcpy(cork->buf + cork->len, iovecs[i].iov_base, iovecs[i].iov_len);
+		cork->len += iovecs[i].iov_len;
+	}
+	rc = TCPSOCKET_COMPLETE; /* the caller is done with its buffers, whatever the write of the cork does */
+	if (cork->len == SOCKETBUFFER_CORK && Socket_writeCorked(cork, 0, NULL, NULL, 0) == SOCKET_ERROR)
+		rc = SOCKET_ERROR;
+exit:
+	return rc;
+}
+
+
+/**
+ *  Write the bytes corked for a socket, with a packet behind them, in one system call.  If the write
+ *  is interrupted in the corked bytes, the packet is copied behind them into the pending write.
+ *  socket_mutex held, so that no other thread writes the socket in the meantime.
+ *  @param cork the cork of the socket
+ *  @param count number of buffers of the packet, 0 for none
+ *  @param iovecs the buffers of the packet
+ *  @param frees which of the buffers of the packet are to be freed if the write is interrupted
+ *  @param total the length of the packet
+ *  @return completion code, TCPSOCKET_INTERRUPTED only if the packet's own buffers are pending
+ */
+static int Socket_writeCorked(socket_cork* cork, int count, iobuf* iovecs, int* frees, size_t total)
+{
+	unsigned long bytes = 0L;
+	iobuf iovecs1[6];
+	int frees1[6];
+	size_t corked = cork->len;
+	char* buf = NULL;
+	int rc, i;
+
+	FUNC_ENTRY;
+	iovecs1[0].iov_base = cork->buf;
+	iovecs1[0].iov_len = (ULONG)corked;
+	frees1[0] = 1;
+	for (i = 0; i < count; ++i)
+	{
+		iovecs1[i+1] = iovecs[i];
+		frees1[i+1] = frees[i];
+	}
+	cork->len = 0;
+	ListRemoveItem(s.corked_sds, &cork->socket, intcompare);
+
+	if ((rc = Socket_writev(cork->socket, iovecs1, count+1, &bytes)) == SOCKET_ERROR)
+		goto exit;
+	rc = TCPSOCKET_COMPLETE;
+	if (bytes == corked + total)
+		goto exit;
+	Log(TRACE_MIN, -1, "Partial write: %lu bytes of %lu corked and %lu more actually written on socket %d",
+			bytes, (unsigned long)corked, (unsigned long)total, cork->socket);
+	if (bytes >= corked)
+	{ /* the rest is the packet's own, pending as if it was written alone */
+		Socket_pendWrite(cork->socket, count, iovecs, frees, total, bytes - corked);
+		rc = TCPSOCKET_INTERRUPTED;
+	}
+	else if ((buf = (total > 0) ? realloc(cork->buf, corked + total) : cork->buf) == NULL)
+		rc = SOCKET_ERROR; /* some of the corked bytes are written, the rest cannot follow */
+	else
+	{ /* the cork buffer becomes the pending write, with the packet copied behind the corked bytes */
+		cork->buf = NULL;
+		for (i = 0; i < count; ++i)
+		{
+			memcpy(buf + corked, iovecs[i].iov_base, iovecs[i].iov_len);
+			corked += iovecs[i].iov_len;
+		}
+		iovecs1[0].iov_base = buf;
+		iovecs1[0].iov_len = (ULONG)corked;
+		Socket_pendWrite(cork->socket, 1, iovecs1, frees1, corked, bytes);
+	}
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/**
+ *  Write the bytes corked for every socket.  socket_mutex held.
+ */
+static void Socket_flushCorks(void)
+{
+	while (s.corked_sds->count > 0)
+	{
+		int socket = *(int*)(s.corked_sds->first->content);
+		socket_cork* cork = SocketBuffer_getCork(socket);
+
+		if (cork == NULL)
+			ListRemoveItem(s.corked_sds, &socket, intcompare);
+		else if (Socket_writeCorked(cork, 0, NULL, NULL, 0) == SOCKET_ERROR)
+			Log(LOG_ERROR, -1, "Failed to write the corked bytes of socket %d", socket);
+	}
+}
+#endif
+
+
+/**
+ *  Cork the packets the calling thread writes, until it calls Socket_uncork as many times.  They are
+ *  copied to a buffer per socket and written together: once SOCKETBUFFER_CORK bytes are corked, once
+ *  the first of them is SOCKETBUFFER_CORK_USECS old when another comes, before any wait on the
+ *  sockets and at Socket_uncork.  A packet another thread writes to the socket takes the corked bytes
+ *  with it.  Nothing if SOCKETBUFFER_CORK is 0.
+ */
+void Socket_cork(void)
+{
+#if SOCKETBUFFER_CORK > 0
+	thread_id_type id = Thread_getid();
+	int i;
+
+	Thread_lock_mutex(socket_mutex);
+	for (i = 0; i < cork_nthreads && cork_threads[i].id != id; ++i)
+		;
+	if (i < cork_nthreads)
+		++cork_threads[i].depth;
+	else if (cork_nthreads < SOCKET_CORK_THREADS)
+	{
+		cork_threads[cork_nthreads].id = id;
+		cork_threads[cork_nthreads++].depth = 1;
+	}
+	Thread_unlock_mutex(socket_mutex);
+#endif
+}
+
+
+/**
+ *  Undo a Socket_cork of the calling thread, the last one writes what is corked
+ */
+void Socket_uncork(void)
+{
+#if SOCKETBUFFER_CORK > 0
+	thread_id_type id = Thread_getid();
+	int i;
+
+	Thread_lock_mutex(socket_mutex);
+	for (i = 0; i < cork_nthreads && cork_threads[i].id != id; ++i)
+		;
+	if (i < cork_nthreads && --cork_threads[i].depth == 0)
+	{
+		cork_threads[i] = cork_threads[--cork_nthreads];
+		Socket_flushCorks();
+	}
+	Thread_unlock_mutex(socket_mutex);
+#endif
+}
+
+
+/**
+ *  Write the corked bytes now, for a thread which is going to wait for the answer to them
+ */
+void Socket_flush(void)
+{
+#if SOCKETBUFFER_CORK > 0
+	Thread_lock_mutex(socket_mutex);
+	Socket_flushCorks();
+	Thread_unlock_mutex(socket_mutex);
+#endif
+}
+
+
+/**
+ *  Add a socket to the pending write list, so that it is checked for writing in the wait.  This is used
  *  in connect processing when the TCP connect is incomplete, as we need to check the socket for both
  *  ready to read and write states.
  *  @param socket the socket to add
  */
 void Socket_addPendingWrite(int socket)
 {
-	FD_SET(socket, &(s.pending_wset));
+	Thread_lock_mutex(socket_mutex);
+	if (ListFindItem(s.pending_wsds, &socket, intcompare) == NULL)
+	{
+		int* psock = (int*)malloc(sizeof(int));
+		*psock = socket;
+		ListAppend(s.pending_wsds, psock, sizeof(int));
+		Socket_waitWrite(socket);
+	}
+	Thread_unlock_mutex(socket_mutex);
 }
 
 
@@ -574,8 +971,10 @@ void Socket_addPendingWrite(int socket)
  */
 void Socket_clearPendingWrite(int socket)
 {
-	if (FD_ISSET(socket, &(s.pending_wset)))
-		FD_CLR(socket, &(s.pending_wset));
+	Thread_lock_mutex(socket_mutex);
+	if (ListRemoveItem(s.pending_wsds, &socket, intcompare))
+		Socket_waitWrite(socket);
+	Thread_unlock_mutex(socket_mutex);
 }
 
 
@@ -608,39 +1007,37 @@ int Socket_close_only(int socket)
 
 
 /**
- *  Close a socket and remove it from the select list.
+ *  Close a socket and remove it from the wait list.
  *  @param socket the socket to close
  *  @return completion code
  */
 void Socket_close(int socket)
 {
+	int i;
+
 	FUNC_ENTRY;
+	Thread_lock_mutex(socket_mutex);
+	Socket_waitRemove(socket); /* before the close, as epoll needs the descriptor */
 	Socket_close_only(socket);
-	FD_CLR(socket, &(s.rset_saved));
-	if (FD_ISSET(socket, &(s.pending_wset)))
-		FD_CLR(socket, &(s.pending_wset));
-	if (s.cur_clientsds != NULL && *(int*)(s.cur_clientsds->content) == socket)
-		s.cur_clientsds = s.cur_clientsds->next;
+	for (i = s.cur_event; i < s.nevents; ++i)
+	{
+		if (s.events[i].socket == socket)
+			s.events[i].socket = -1;
+	}
+	++s.closes;
 	Socket_abortWrite(socket);
 	SocketBuffer_cleanup(socket);
 	ListRemoveItem(s.connect_pending, &socket, intcompare);
 	ListRemoveItem(s.write_pending, &socket, intcompare);
+	ListRemoveItem(s.pending_wsds, &socket, intcompare);
+	ListRemoveItem(s.readahead_sds, &socket, intcompare);
+	ListRemoveItem(s.corked_sds, &socket, intcompare);
 
 	if (ListRemoveItem(s.clientsds, &socket, intcompare))
 		Log(TRACE_MIN, -1, "Removed socket %d", socket);
 	else
 		Log(LOG_ERROR, -1, "Failed to remove socket %d", socket);
-	if (socket + 1 >= s.maxfdp1)
-	{
-		/* now we have to reset s.maxfdp1 */
-		ListElement* cur_clientsds = NULL;
-
-		s.maxfdp1 = 0;
-		while (ListNextElement(s.clientsds, &cur_clientsds))
-			s.maxfdp1 = max(*((int*)(cur_clientsds->content)), s.maxfdp1);
-		++(s.maxfdp1);
-		Log(TRACE_MAX, -1, "Reset max fdp1 to %d", s.maxfdp1);
-	}
+	Thread_unlock_mutex(socket_mutex);
 	FUNC_EXIT;
 }
 
@@ -750,6 +1147,7 @@ int Socket_new(const char* addr, size_t addr_len, int port, int* sock)
 				}
 #endif
 			Log(TRACE_MIN, -1, "New socket %d for %s, port %d",	*sock, addr, port);
+			Thread_lock_mutex(socket_mutex);
 			if (Socket_addSocket(*sock) == SOCKET_ERROR)
 				rc = Socket_error("addSocket", *sock);
 			else
@@ -772,6 +1170,7 @@ int Socket_new(const char* addr, size_t addr_len, int port, int* sock)
 					int* pnewSd = (int*)malloc(sizeof(int));
 					*pnewSd = *sock;
 					ListAppend(s.connect_pending, pnewSd, sizeof(int));
+					Socket_waitWrite(*sock);
 					Log(TRACE_MIN, 15, "Connect pending");
 				}
 			}
@@ -784,6 +1183,7 @@ int Socket_new(const char* addr, size_t addr_len, int port, int* sock)
                             Socket_close(*sock); /* close socket and remove from our list of sockets */
                             *sock = -1; /* as initialized before */
                         }
+			Thread_unlock_mutex(socket_mutex);
 		}
 	}
 
@@ -924,38 +1324,34 @@ exit:
 
 
 /**
- *  Continue any outstanding writes for a socket set
- *  @param pwset the set of sockets
+ *  Continue any outstanding writes for the sockets the last wait found writable
  *  @return completion code
  */
-int Socket_continueWrites(fd_set* pwset)
+int Socket_continueWrites(void)
 {
 	int rc1 = 0;
-	ListElement* curpending = s.write_pending->first;
+	int i;
 
 	FUNC_ENTRY;
-	while (curpending)
+	for (i = 0; i < s.nevents; ++i)
 	{
-		int socket = *(int*)(curpending->content);
+		int socket = s.events[i].socket;
 		int rc = 0;
 
-		if (FD_ISSET(socket, pwset) && ((rc = Socket_continueWrite(socket)) != 0))
+		if (socket == -1 || !(s.events[i].events & SOCKET_WRITE) ||
+				ListFindItem(s.write_pending, &socket, intcompare) == NULL)
+			continue;
+		if ((rc = Socket_continueWrite(socket)) != 0)
 		{
 			if (!SocketBuffer_writeComplete(socket))
 				Log(LOG_SEVERE, -1, "Failed to remove pending write from socket buffer list");
-			FD_CLR(socket, &(s.pending_wset));
-			if (!ListRemove(s.write_pending, curpending->content))
-			{
+			if (!ListRemove(s.write_pending, s.write_pending->current->content))
 				Log(LOG_SEVERE, -1, "Failed to remove pending write from list");
-				ListNextElement(s.write_pending, &curpending);
-			}
-			curpending = s.write_pending->current;
+			Socket_clearPendingWrite(socket);
 
 			if (writecomplete)
 				(*writecomplete)(socket, rc);
 		}
-		else
-			ListNextElement(s.write_pending, &curpending);
 	}
 	FUNC_EXIT_RC(rc1);
 	return rc1;
@@ -1019,6 +1415,486 @@ char* Socket_getpeer(int sock)
 }
 
 
+#if SOCKETBUFFER_READAHEAD > 0
+/**
+ *  Keep the list of sockets with bytes read ahead up to date, once a packet read is done or interrupted,
+ *  as the reads of one packet follow each other anyway
+ *  @param socket the socket read from
+ */
+static void Socket_readAheadChanged(int socket)
+{
+	socket_readahead* ra = SocketBuffer_getReadAhead(socket);
+	int listed = ListFindItem(s.readahead_sds, &socket, intcompare) != NULL;
+
+	if (ra == NULL)
+		return;
+	if (ra->start < ra->end && !listed)
+	{
+		int* psock = (int*)malloc(sizeof(int));
+		*psock = socket;
+		ListAppend(s.readahead_sds, psock, sizeof(int));
+	}
+	else if (ra->start == ra->end && listed)
+		ListRemove(s.readahead_sds, s.readahead_sds->current->content);
+}
+
+
+/**
+ *  Reads from a socket through its read ahead buffer: the bytes read ahead first, then one recv of
+ *  as many as fit in the buffer, or straight into buf if more than that is still wanted
+ *  @param socket the socket to read from
+ *  @param buf where to put the bytes
+ *  @param len the number of bytes wanted
+ *  @return the number of bytes read, 0 if the other end closed or SOCKET_ERROR, as recv
+ */
+static int Socket_recv(int socket, char* buf, size_t len)
+{
+	socket_readahead* ra = SocketBuffer_getReadAhead(socket);
+	size_t got = 0;
+	int rc;
+
+	if (ra == NULL)
+		return recv(socket, buf, len, 0);
+	if (ra->start < ra->end)
+	{
+		got = min(len, ra->end - ra->start);
+		memcpy(buf, &ra->buf[ra->start], got);
+		ra->start += got;
+	}
+	if (got < len)
+	{
+		if (len - got >= sizeof(ra->buf))
+			rc = recv(socket, buf + got, len - got, 0);
+		else if ((rc = recv(socket, ra->buf, sizeof(ra->buf), 0)) > 0)
+		{
+			ra->end = (size_t)rc;
+			rc = (int)min(len - got, ra->end);
+			memcpy(buf + got, ra->buf, rc);
+			ra->start = (size_t)rc;
+		}
+		if (rc > 0)
+			got += rc;
+		else if (got == 0)
+			return rc; /* else the close or error comes again with the next read */
+	}
+	return (int)got;
+}
+
+
+/**
+ *  Takes a whole packet from the read ahead buffer of a socket
+ *  @param socket the socket
+ *  @param bytes the packet length
+ *  @return the packet, valid until the next read from the socket, or NULL if not all of it was read ahead
+ */
+static char* Socket_getReadAhead(int socket, size_t bytes)
+{
+	socket_readahead* ra = SocketBuffer_getReadAhead(socket);
+	char* buf = NULL;
+
+	if (ra != NULL && ra->end - ra->start >= bytes)
+	{
+		buf = &ra->buf[ra->start];
+		ra->start += bytes;
+	}
+	return buf;
+}
+#endif
+
+
+/**
+ *  Add the sockets with bytes read ahead to the events of a wait, as the wait only sees the ones
+ *  with bytes still to read
+ */
+static void Socket_addReadAheads(void)
+{
+	ListElement* cur = NULL;
+
+	while (ListNextElement(s.readahead_sds, &cur) && s.nevents < SOCKET_MAX_EVENTS)
+	{
+		int sock = *((int*)(cur->content));
+		int i;
+
+		for (i = 0; i < s.nevents && s.events[i].socket != sock; ++i)
+			;
+		if (i < s.nevents)
+			s.events[i].events |= SOCKET_READ;
+		else
+		{
+			s.events[s.nevents].socket = sock;
+			s.events[s.nevents++].events = Socket_wantsWrite(sock) ? SOCKET_READ : (SOCKET_READ | SOCKET_WRITE);
+		}
+	}
+}
+
+
+/**
+ *  Whether to wait on a socket for writing: its connect or a write is pending
+ *  @param sock the socket
+ *  @return boolean
+ */
+static int Socket_wantsWrite(int sock)
+{
+	return ListFindItem(s.pending_wsds, &sock, intcompare) != NULL ||
+		ListFindItem(s.connect_pending, &sock, intcompare) != NULL;
+}
+
+
+/**
+ *  Add a socket the wait found ready to the events, unless it was closed during the wait
+ *  @param sock the socket
+ *  @param events SOCKET_READ and/or SOCKET_WRITE
+ *  @param closes the count of closed sockets when the wait started
+ */
+static void Socket_addEvent(int sock, int events, unsigned int closes)
+{
+	if (closes != s.closes && ListFindItem(s.clientsds, &sock, intcompare) == NULL)
+		return;
+	s.events[s.nevents].socket = sock;
+	s.events[s.nevents++].events = events;
+}
+
+
+#if !defined(SOCKET_USE_SELECT)
+/**
+ *  Convert a wait timeout to milliseconds, rounded up
+ *  @param timeout the timeout
+ *  @return milliseconds
+ */
+static int Socket_waitMs(struct timeval* timeout)
+{
+	return (int)(timeout->tv_sec * 1000 + (timeout->tv_usec + 999) / 1000);
+}
+#endif
+
+
+#if defined(SOCKET_USE_SELECT)
+
+static int Socket_waitInitialize(void)
+{
+	FD_ZERO(&(s.rset_saved));
+	s.maxfdp1 = 0;
+	s.next_clientsds = NULL;
+	return 0;
+}
+
+
+static void Socket_waitTerminate(void)
+{
+}
+
+
+static int Socket_waitAdd(int sock)
+{
+	if (s.clientsds->count >= FD_SETSIZE)
+	{
+		Log(LOG_ERROR, -1, "addSocket: exceeded FD_SETSIZE %d", FD_SETSIZE);
+		return SOCKET_ERROR;
+	}
+	FD_SET(sock, &(s.rset_saved));
+	s.maxfdp1 = max(s.maxfdp1, sock + 1);
+	return 0;
+}
+
+
+static void Socket_waitRemove(int sock)
+{
+	FD_CLR(sock, &(s.rset_saved));
+	if (s.next_clientsds != NULL && *(int*)(s.next_clientsds->content) == sock)
+		s.next_clientsds = s.next_clientsds->next;
+	if (sock + 1 >= s.maxfdp1)
+	{
+		/* now we have to reset s.maxfdp1 */
+		ListElement* cur_clientsds = NULL;
+
+		s.maxfdp1 = 0;
+		while (ListNextElement(s.clientsds, &cur_clientsds))
+		{
+			if (*((int*)(cur_clientsds->content)) != sock)
+				s.maxfdp1 = max(*((int*)(cur_clientsds->content)), s.maxfdp1);
+		}
+		++(s.maxfdp1);
+		Log(TRACE_MAX, -1, "Reset max fdp1 to %d", s.maxfdp1);
+	}
+}
+
+
+static void Socket_waitWrite(int sock)
+{
+	(void)sock; /* the write set is built from pending_wsds for each wait */
+}
+
+
+static int Socket_wait(struct timeval* timeout, mutex_type mutex)
+{
+	static struct timeval zero = {0L, 0L}; /* 0 seconds */
+	fd_set rset, pwset, wset;
+	ListElement* cur = NULL;
+	unsigned int closes = s.closes;
+	int maxfdp1 = s.maxfdp1;
+	int rc, rc1, i;
+
+	s.nevents = s.cur_event = 0;
+	memcpy((void*)&rset, (void*)&(s.rset_saved), sizeof(rset));
+	FD_ZERO(&pwset);
+	while (ListNextElement(s.pending_wsds, &cur))
+		FD_SET(*((int*)(cur->content)), &pwset);
+	/* Prevent performance issue by unlocking the socket_mutex while waiting for a ready socket. */
+	Thread_unlock_mutex(mutex);
+	rc = select(maxfdp1, &rset, &pwset, NULL, timeout);
+	Thread_lock_mutex(mutex);
+	if (rc == SOCKET_ERROR)
+	{
+		Socket_error("read select", 0);
+		goto exit;
+	}
+
+	memcpy((void*)&wset, (void*)&(s.rset_saved), sizeof(wset));
+	if ((rc1 = select(s.maxfdp1, NULL, &wset, NULL, &zero)) == SOCKET_ERROR)
+	{
+		Socket_error("write select", 0);
+		rc = rc1;
+		goto exit;
+	}
+	Log(TRACE_MAX, -1, "Return code %d from write select", rc1);
+
+	/* go on from where the last scan stopped, in case more than SOCKET_MAX_EVENTS were ready */
+	if ((cur = s.next_clientsds) == NULL)
+		cur = s.clientsds->first;
+	for (i = 0; cur && i < s.clientsds->count && s.nevents < SOCKET_MAX_EVENTS; ++i)
+	{
+		int sock = *((int*)(cur->content));
+		int events = 0;
+
+		if (FD_ISSET(sock, &rset))
+			events |= SOCKET_READ;
+		if (FD_ISSET(sock, &wset) || FD_ISSET(sock, &pwset))
+			events |= SOCKET_WRITE;
+		if ((events & SOCKET_READ) || ((events & SOCKET_WRITE) && Socket_wantsWrite(sock)))
+			Socket_addEvent(sock, events, closes);
+		cur = (cur->next) ? cur->next : s.clientsds->first;
+	}
+	s.next_clientsds = cur;
+	rc = s.nevents;
+exit:
+	return rc;
+}
+
+#elif defined(SOCKET_USE_POLL)
+
+static int Socket_waitInitialize(void)
+{
+	s.fds = NULL;
+	s.nfds = s.fds_max = s.next_fds = 0;
+	return 0;
+}
+
+
+static void Socket_waitTerminate(void)
+{
+	if (s.fds)
+		free(s.fds);
+	s.fds = NULL;
+	s.nfds = s.fds_max = 0;
+}
+
+
+static int Socket_waitAdd(int sock)
+{
+	if (s.nfds == s.fds_max)
+	{
+		int fds_max = (s.fds_max == 0) ? 16 : s.fds_max * 2;
+		struct pollfd* fds;
+
+		if (s.fds == NULL) /* the Heap realloc needs one it allocated */
+			fds = (struct pollfd*)malloc(fds_max * sizeof(struct pollfd));
+		else
+			fds = (struct pollfd*)realloc(s.fds, fds_max * sizeof(struct pollfd));
+
+		if (fds == NULL)
+			return SOCKET_ERROR;
+		s.fds = fds;
+		s.fds_max = fds_max;
+	}
+	s.fds[s.nfds].fd = sock;
+	s.fds[s.nfds].events = POLLIN;
+	s.fds[s.nfds++].revents = 0;
+	return 0;
+}
+
+
+static void Socket_waitRemove(int sock)
+{
+	int i;
+
+	for (i = 0; i < s.nfds; ++i)
+	{
+		if (s.fds[i].fd == sock)
+		{
+			s.fds[i] = s.fds[--s.nfds];
+			break;
+		}
+	}
+}
+
+
+static void Socket_waitWrite(int sock)
+{
+	int i;
+
+	for (i = 0; i < s.nfds; ++i)
+	{
+		if (s.fds[i].fd == sock)
+		{
+			s.fds[i].events = Socket_wantsWrite(sock) ? (POLLIN | POLLOUT) : POLLIN;
+			break;
+		}
+	}
+}
+
+
+static int Socket_wait(struct timeval* timeout, mutex_type mutex)
+{
+	struct pollfd local[SOCKET_MAX_EVENTS];
+	struct pollfd* fds = local;
+	unsigned int closes = s.closes;
+	int nfds = s.nfds;
+	int rc, i, j;
+
+	s.nevents = s.cur_event = 0;
+	/* poll a copy, as sockets can be added and removed while the mutex is unlocked */
+	if (nfds > SOCKET_MAX_EVENTS && (fds = (struct pollfd*)malloc(nfds * sizeof(struct pollfd))) == NULL)
+		return SOCKET_ERROR;
+	memcpy(fds, s.fds, nfds * sizeof(struct pollfd));
+	Thread_unlock_mutex(mutex);
+	rc = poll(fds, nfds, Socket_waitMs(timeout));
+	Thread_lock_mutex(mutex);
+	if (rc == SOCKET_ERROR)
+	{
+		Socket_error("poll", 0);
+		goto exit;
+	}
+
+	/* go on from where the last scan stopped, in case more than SOCKET_MAX_EVENTS were ready */
+	j = (nfds > 0) ? s.next_fds % nfds : 0;
+	for (i = 0; i < nfds && rc > 0 && s.nevents < SOCKET_MAX_EVENTS; ++i, j = (j + 1) % nfds)
+	{
+		short revents = fds[j].revents;
+		int events = 0;
+
+		if (revents == 0)
+			continue;
+		--rc;
+		if (revents & POLLNVAL)
+			continue;
+		if (revents & (POLLIN | POLLHUP | POLLERR))
+			events |= SOCKET_READ;
+		/* only the sockets with a pending connect or write are polled for writing */
+		if ((revents & (POLLOUT | POLLERR)) || !(fds[j].events & POLLOUT))
+			events |= SOCKET_WRITE;
+		Socket_addEvent(fds[j].fd, events, closes);
+	}
+	s.next_fds = j;
+	rc = s.nevents;
+exit:
+	if (fds != local)
+		free(fds);
+	return rc;
+}
+
+#else /* SOCKET_USE_EPOLL */
+
+static int Socket_waitInitialize(void)
+{
+	if ((s.epfd = epoll_create1(EPOLL_CLOEXEC)) == SOCKET_ERROR)
+		return Socket_error("epoll_create1", 0);
+	return 0;
+}
+
+
+static void Socket_waitTerminate(void)
+{
+	if (s.epfd != SOCKET_ERROR)
+		close(s.epfd);
+	s.epfd = SOCKET_ERROR;
+}
+
+
+static int Socket_waitAdd(int sock)
+{
+	struct epoll_event ev;
+
+	memset(&ev, '\0', sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = sock;
+	if (epoll_ctl(s.epfd, EPOLL_CTL_ADD, sock, &ev) == SOCKET_ERROR)
+	{
+		Socket_error("epoll_ctl add", sock);
+		return SOCKET_ERROR;
+	}
+	return 0;
+}
+
+
+static void Socket_waitRemove(int sock)
+{
+	struct epoll_event ev; /* ignored, but must not be NULL before Linux 2.6.9 */
+
+	memset(&ev, '\0', sizeof(ev));
+	if (epoll_ctl(s.epfd, EPOLL_CTL_DEL, sock, &ev) == SOCKET_ERROR)
+		Socket_error("epoll_ctl del", sock);
+}
+
+
+static void Socket_waitWrite(int sock)
+{
+	struct epoll_event ev;
+
+	memset(&ev, '\0', sizeof(ev));
+	ev.events = Socket_wantsWrite(sock) ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+	ev.data.fd = sock;
+	if (epoll_ctl(s.epfd, EPOLL_CTL_MOD, sock, &ev) == SOCKET_ERROR)
+		Socket_error("epoll_ctl mod", sock);
+}
+
+
+static int Socket_wait(struct timeval* timeout, mutex_type mutex)
+{
+	struct epoll_event evs[SOCKET_MAX_EVENTS];
+	unsigned int closes = s.closes;
+	int epfd = s.epfd;
+	int rc, i;
+
+	s.nevents = s.cur_event = 0;
+	Thread_unlock_mutex(mutex);
+	rc = epoll_wait(epfd, evs, SOCKET_MAX_EVENTS, Socket_waitMs(timeout));
+	Thread_lock_mutex(mutex);
+	if (rc == SOCKET_ERROR)
+	{
+		Socket_error("epoll_wait", 0);
+		goto exit;
+	}
+
+	for (i = 0; i < rc; ++i)
+	{
+		int sock = evs[i].data.fd;
+		int events = 0;
+
+		if (evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+			events |= SOCKET_READ;
+		/* only the sockets with a pending connect or write are waited on for writing */
+		if ((evs[i].events & (EPOLLOUT | EPOLLERR)) || !Socket_wantsWrite(sock))
+			events |= SOCKET_WRITE;
+		Socket_addEvent(sock, events, closes);
+	}
+	rc = s.nevents;
+exit:
+	return rc;
+}
+
+#endif
+
+
 #if defined(Socket_TEST)
 
 int main(int argc, char *argv[])
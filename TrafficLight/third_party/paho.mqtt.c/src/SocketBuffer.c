@@ -27,6 +27,7 @@
 #include "Log.h"
 #include "Messages.h"
 #include "StackTrace.h"
+#include "Tree.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -54,6 +55,25 @@ static List* queues;
  */
 static List writes;
 
+#if SOCKETBUFFER_READAHEAD > 0
+/**
+ * Read ahead buffers, by socket
+ */
+static Tree* readaheads;
+
+/**
+ * The read ahead buffer used last, as the reads of a packet are all for one socket
+ */
+static socket_readahead* last_readahead;
+#endif
+
+#if SOCKETBUFFER_CORK > 0
+/**
+ * Cork buffers, by socket
+ */
+static Tree* corks;
+#endif
+
 
 int socketcompare(void* a, void* b);
 void SocketBuffer_newDefQ(void);
@@ -95,6 +115,13 @@ void SocketBuffer_initialize(void)
 	SocketBuffer_newDefQ();
 	queues = ListInitialize();
 	ListZero(&writes);
+#if SOCKETBUFFER_READAHEAD > 0
+	readaheads = TreeInitialize(TreeIntCompare);
+	last_readahead = NULL;
+#endif
+#if SOCKETBUFFER_CORK > 0
+	corks = TreeInitialize(TreeIntCompare);
+#endif
 	FUNC_EXIT;
 }
 
@@ -122,6 +149,32 @@ void SocketBuffer_terminate(void)
 	while (ListNextElement(queues, &cur))
 		free(((socket_queue*)(cur->content))->buf);
 	ListFree(queues);
+#if SOCKETBUFFER_READAHEAD > 0
+	{
+		Node* node;
+
+		while ((node = TreeNextElement(readaheads, NULL)) != NULL)
+			free(TreeRemove(readaheads, node->content));
+		TreeFree(readaheads);
+		readaheads = NULL;
+		last_readahead = NULL;
+	}
+#endif
+#if SOCKETBUFFER_CORK > 0
+	{
+		Node* node;
+
+		while ((node = TreeNextElement(corks, NULL)) != NULL)
+		{
+			socket_cork* cork = TreeRemove(corks, node->content);
+
+			free(cork->buf);
+			free(cork);
+		}
+		TreeFree(corks);
+		corks = NULL;
+	}
+#endif
 	SocketBuffer_freeDefQ();
 	FUNC_EXIT;
 }
@@ -145,10 +198,85 @@ void SocketBuffer_cleanup(int socket)
 		def_queue->socket = def_queue->index = 0;
 		def_queue->headerlen = def_queue->datalen = 0;
 	}
+#if SOCKETBUFFER_READAHEAD > 0
+	{
+		socket_readahead* ra;
+
+		if (last_readahead && last_readahead->socket == socket)
+			last_readahead = NULL;
+		if ((ra = TreeRemoveKey(readaheads, &socket)) != NULL)
+			free(ra);
+	}
+#endif
+#if SOCKETBUFFER_CORK > 0
+	{
+		socket_cork* cork;
+
+		if ((cork = TreeRemoveKey(corks, &socket)) != NULL)
+		{
+			free(cork->buf);
+			free(cork);
+		}
+	}
+#endif
 	FUNC_EXIT;
 }
 
 
+#if SOCKETBUFFER_READAHEAD > 0
+/**
+ * Get the read ahead buffer of a socket, a new empty one the first time
+ * @param socket the socket
+ * @return the buffer, or NULL if it could not be allocated
+ */
+socket_readahead* SocketBuffer_getReadAhead(int socket)
+{
+	socket_readahead* ra = last_readahead;
+	Node* node;
+
+	if (ra && ra->socket == socket)
+		goto exit;
+	if ((node = TreeFind(readaheads, &socket)) != NULL)
+		ra = (socket_readahead*)(node->content);
+	else if ((ra = malloc(sizeof(socket_readahead))) != NULL)
+	{
+		ra->socket = socket;
+		ra->start = ra->end = 0;
+		TreeAdd(readaheads, ra, sizeof(socket_readahead));
+	}
+	last_readahead = ra;
+exit:
+	return ra;
+}
+#endif
+
+
+#if SOCKETBUFFER_CORK > 0
+/**
+ * Get the cork buffer of a socket, a new empty one the first time
+ * @param socket the socket
+ * @return the cork, or NULL if it could not be allocated
+ */
+socket_cork* SocketBuffer_getCork(int socket)
+{
+	socket_cork* cork = NULL;
+	Node* node;
+
+	if ((node = TreeFind(corks, &socket)) != NULL)
+		cork = (socket_cork*)(node->content);
+	else if ((cork = malloc(sizeof(socket_cork))) != NULL)
+	{
+		cork->socket = socket;
+		cork->len = 0;
+		cork->start = 0L;
+		cork->buf = NULL;
+		TreeAdd(corks, cork, sizeof(socket_cork));
+	}
+	return cork;
+}
+#endif
+
+
 /**
  * Get any queued data for a specific socket
  * @param socket the socket to get queued data for
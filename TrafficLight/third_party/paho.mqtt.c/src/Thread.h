@@ -17,7 +17,9 @@
  *    Ian Craggs - change MacOS semaphore implementation
  *******************************************************************************/
 #include "MQTTClient.h"
+#if !defined(NOSTACKTRACE)
 #define NOSTACKTRACE
+#endif
 #if !defined(THREAD_H)
 #define THREAD_H
 
@@ -0,0 +1,154 @@
+/*******************************************************************************
+ * Copyright (c) 2020 HiHope Community.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    HiSpark Product Team - MQTT 5 topic aliases of the outbound publishes
+ *******************************************************************************/
+
+/**
+ * @file
+ * \brief MQTT 5 topic aliases of the outbound publishes.
+ *
+ * The server gives the number of aliases it takes in the CONNACK, and they last as long as the
+ * network connection. A publish of a topic with an alias carries the alias and no topic, the
+ * publish which assigns it carries both.
+ *
+ * A topic gets an alias the second time it is sent within a while, so the topics sent once, as
+ * the responses to a request id, go in full and do not push the periodic ones out. When all the
+ * aliases are assigned, the one used the longest ago is given to the new topic. There are a few
+ * aliases at most, so they are searched one after the other, by hash first.
+ */
+
+#include "TopicAliases.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "MQTTProtocolClient.h"
+#include "Heap.h"
+
+/** hashes of the topics sent in full, for each alias */
+#define TOPICALIASES_SEEN_PER_ALIAS 4
+
+
+/**
+ * FNV-1a hash of a topic, never 0 so that 0 is a free seen slot
+ * @param topic the topic
+ * @return the hash
+ */
+static unsigned int TopicAliases_hash(const char* topic)
+{
+	unsigned int hash = 2166136261u;
+
+	while (*topic)
+		hash = (hash ^ (unsigned char)*topic++) * 16777619u;
+	return hash | 1;
+}
+
+
+/**
+ * Forget the aliases of the previous connection and take the number the server gave for this one
+ * @param aliases the topic aliases of the client
+ * @param max the topic alias maximum of the CONNACK, 0 or less for none
+ * @return 0, or -1 if there was no memory and the connection goes without aliases
+ */
+int TopicAliases_reset(TopicAliases* aliases, int max)
+{
+	int seen = 1;
+
+	TopicAliases_free(aliases);
+	if (max > TOPIC_ALIAS_MAX)
+		max = TOPIC_ALIAS_MAX;
+	if (max <= 0)
+		return 0;
+	while (seen < max * TOPICALIASES_SEEN_PER_ALIAS)
+		seen *= 2;
+	aliases->aliases = malloc(max * sizeof(TopicAlias));
+	aliases->seen = malloc(seen * sizeof(unsigned int));
+	if (aliases->aliases == NULL || aliases->seen == NULL)
+	{
+		TopicAliases_free(aliases);
+		return -1;
+	}
+	memset(aliases->aliases, '\0', max * sizeof(TopicAlias));
+	memset(aliases->seen, '\0', seen * sizeof(unsigned int));
+	aliases->seenmask = seen - 1;
+	aliases->max = max;
+	return 0;
+}
+
+
+/**
+ * Find the alias to publish a topic with, assigning one if the topic is worth it
+ * @param aliases the topic aliases of the client
+ * @param topic the topic of the publish
+ * @param assigned set to 1 if the alias is new to the server and the topic must go with it
+ * @return the alias, 1 to the maximum, or 0 to send the topic without one
+ */
+int TopicAliases_get(TopicAliases* aliases, const char* topic, int* assigned)
+{
+	unsigned int hash;
+	unsigned int* seen;
+	TopicAlias* alias = NULL;
+	int i;
+
+	*assigned = 0;
+	if (aliases->max == 0 || *topic == '\0')
+		return 0;
+	hash = TopicAliases_hash(topic);
+	++(aliases->clock);
+	for (i = 0; i < aliases->max; ++i)
+	{
+		TopicAlias* a = &aliases->aliases[i];
+
+		if (a->topic && a->hash == hash && strcmp(a->topic, topic) == 0)
+		{
+			a->used = aliases->clock;
+			return i + 1;
+		}
+		/* a free alias first, then the one unused the longest, the stamps may wrap */
+		if (alias == NULL || (alias->topic && (a->topic == NULL ||
+				aliases->clock - a->used > aliases->clock - alias->used)))
+			alias = a;
+	}
+
+	seen = &aliases->seen[hash & aliases->seenmask];
+	if (*seen != hash)
+	{
+		*seen = hash;
+		return 0;
+	}
+	free(alias->topic);
+	if ((alias->topic = MQTTStrdup(topic)) == NULL)
+		return 0;
+	*seen = 0;
+	alias->hash = hash;
+	alias->used = aliases->clock;
+	*assigned = 1;
+	return (int)(alias - aliases->aliases) + 1;
+}
+
+
+/**
+ * Free the aliases, the client has none afterwards
+ * @param aliases the topic aliases of the client
+ */
+void TopicAliases_free(TopicAliases* aliases)
+{
+	int i;
+
+	for (i = 0; i < aliases->max; ++i)
+		free(aliases->aliases[i].topic);
+	free(aliases->aliases);
+	free(aliases->seen);
+	memset(aliases, '\0', sizeof(TopicAliases));
+}
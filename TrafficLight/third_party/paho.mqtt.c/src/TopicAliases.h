@@ -0,0 +1,52 @@
+/*******************************************************************************
+ * Copyright (c) 2020 HiHope Community.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    HiSpark Product Team - MQTT 5 topic aliases of the outbound publishes
+ *******************************************************************************/
+
+#if !defined(TOPICALIASES_H)
+#define TOPICALIASES_H
+
+/** the aliases used at most, whatever the server takes; 0 sends every topic in full */
+#if !defined(TOPIC_ALIAS_MAX)
+#define TOPIC_ALIAS_MAX 16
+#endif
+
+/**
+ * One topic alias
+ */
+typedef struct
+{
+	char* topic;			/**< the topic of the alias, NULL while it is not assigned */
+	unsigned int hash;		/**< of the topic, compared before the topic */
+	unsigned int used;		/**< stamp of the last publish with it, the oldest one is reassigned */
+} TopicAlias;
+
+/**
+ * The topic aliases of one network connection, from the client to the server. All zero is a
+ * connection without aliases.
+ */
+typedef struct
+{
+	TopicAlias* aliases;	/**< alias n is aliases[n - 1] */
+	unsigned int* seen;		/**< hashes of the topics sent in full lately, seenmask + 1 of them */
+	int seenmask;
+	int max;				/**< aliases this connection can use */
+	unsigned int clock;		/**< the use stamp */
+} TopicAliases;
+
+int TopicAliases_reset(TopicAliases* aliases, int max);
+int TopicAliases_get(TopicAliases* aliases, const char* topic, int* assigned);
+void TopicAliases_free(TopicAliases* aliases);
+
+#endif